@@ -0,0 +1,111 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+/**
+ * Http 客户端压测工具
+ *
+ * 先运行 examples/http/server/simple，然后：
+ *   bench [server_addr] [total] [conns] [pipeline] [window]
+ * 如：bench 127.0.0.1:12345 100000 4 8 256
+ */
+#include <iostream>
+#include <chrono>
+#include <tbox/base/log.h>
+#include <tbox/base/scope_exit.hpp>
+#include <tbox/log/async_stdout_sink.h>
+#include <tbox/event/signal_event.h>
+#include <tbox/http/client/client.h>
+
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::http;
+using namespace tbox::http::client;
+
+int main(int argc, char **argv)
+{
+    std::string server_addr = "127.0.0.1:12345";
+    int total = 100000;
+    int window = 256;   //! 同时未完成的请求数
+
+    Client::Config config;
+    config.max_pipeline = 8;
+
+    if (argc > 1) server_addr = argv[1];
+    if (argc > 2) total = std::stoi(argv[2]);
+    if (argc > 3) config.max_conns_per_host = std::stoi(argv[3]);
+    if (argc > 4) config.max_pipeline = std::stoi(argv[4]);
+    if (argc > 5) window = std::stoi(argv[5]);
+
+    log::AsyncStdoutSink log;
+    log.enable();
+    log.enableColor(true);
+    log.setLevel(LOG_LEVEL_NOTICE);
+
+    auto sp_loop = Loop::New();
+    auto sp_sig_event = sp_loop->newSignalEvent();
+
+    SetScopeExitAction(
+        [=] {
+            delete sp_sig_event;
+            delete sp_loop;
+        }
+    );
+
+    sp_sig_event->initialize(SIGINT, Event::Mode::kPersist);
+    sp_sig_event->enable();
+    sp_sig_event->setCallback([&] (int) { sp_loop->exitLoop(); });
+
+    Client client(sp_loop);
+    client.setConfig(config);
+    client.initialize(network::SockAddr::FromString(server_addr));
+
+    Request req;
+    req.method = Method::kGet;
+    req.url.path = "/";
+
+    int sent = 0, done = 0, fail = 0;
+    std::function<void()> send_one = [&] {
+        ++sent;
+        client.request(req,
+            [&] (Client::Error err, const Respond &) {
+                if (err != Client::Error::kNone)
+                    ++fail;
+                if (++done == total)
+                    sp_loop->exitLoop();
+                else if (sent < total)
+                    send_one();
+            }
+        );
+    };
+
+    auto start_ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < window && i < total; ++i)
+        send_one();
+
+    sp_loop->runLoop();
+
+    auto cost = std::chrono::steady_clock::now() - start_ts;
+    auto cost_us = std::chrono::duration_cast<std::chrono::microseconds>(cost).count();
+    std::cout << "conns: " << config.max_conns_per_host << ", pipeline: " << config.max_pipeline
+              << ", done: " << done << ", fail: " << fail << ", cost: " << cost_us << " us"
+              << ", " << (done * 1000000ull / (cost_us + 1)) << " req/s" << std::endl;
+
+    client.cleanup();
+    return 0;
+}
@@ -79,6 +79,7 @@ R"(
 <body>
     <p> <a href="/1" target="_blank">page_1</a> </p>
     <p> <a href="/2" target="_blank">page_2</a> </p>
+    <p> <a href="/user/hevake" target="_blank">user hevake</a> </p>
 </body>
 )";
         })
@@ -89,6 +90,10 @@ R"(
         .get("/2", [](ContextSptr ctx, const NextFunc &next) {
             ctx->res().status_code = StatusCode::k200_OK;
             ctx->res().body = "<p>page 2</p>";
+        })
+        .get("/user/:name", [](ContextSptr ctx, const NextFunc &next) {
+            ctx->res().status_code = StatusCode::k200_OK;
+            ctx->res().body = "<p>hello " + ctx->param("name") + "</p>";
         });
 
     sp_sig_event->setCallback(
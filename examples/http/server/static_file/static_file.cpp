@@ -0,0 +1,89 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <tbox/base/log.h>
+#include <tbox/base/scope_exit.hpp>
+#include <tbox/log/async_stdout_sink.h>
+#include <tbox/event/signal_event.h>
+#include <tbox/http/server/server.h>
+#include <tbox/http/server/static_file.h>
+
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::http;
+using namespace tbox::http::server;
+
+int main(int argc, char **argv)
+{
+    std::string bind_addr = "0.0.0.0:12345";
+    std::string root_dir = ".";
+
+    if (argc >= 2)
+        root_dir = argv[1];
+    if (argc >= 3)
+        bind_addr = argv[2];
+
+    log::AsyncStdoutSink log;
+    log.enable();
+    log.enableColor(true);
+    log.setLevel(LOG_LEVEL_TRACE);
+
+    LogInfo("enter");
+
+    auto sp_loop = Loop::New();
+    auto sp_sig_event = sp_loop->newSignalEvent();
+
+    SetScopeExitAction(
+        [=] {
+            delete sp_sig_event;
+            delete sp_loop;
+        }
+    );
+
+    sp_sig_event->initialize(SIGINT, Event::Mode::kPersist);
+    sp_sig_event->enable();
+
+    Server srv(sp_loop);
+    if (!srv.initialize(network::SockAddr::FromString(bind_addr), 1)) {
+        LogErr("init srv fail");
+        return 0;
+    }
+
+    srv.start();
+
+    //! 浏览 http://<ip>:12345/files/ 即可访问 root_dir 下的文件
+    StaticFile static_file;
+    static_file.bind("/files/", root_dir);
+    srv.use(&static_file);
+
+    sp_sig_event->setCallback(
+        [&] (int) {
+            srv.stop();
+            sp_loop->exitLoop();
+        }
+    );
+
+    LogInfo("start, serving %s", root_dir.c_str());
+    sp_loop->runLoop();
+    LogInfo("stop");
+    srv.cleanup();
+
+    LogInfo("exit");
+    return 0;
+}
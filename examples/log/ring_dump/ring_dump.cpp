@@ -0,0 +1,90 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+/**
+ * 解析 MmapRingSink 写下的环形日志文件，按从旧到新的顺序输出其中的日志
+ */
+#include <signal.h>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <tbox/log/mmap_ring.h>
+#include <tbox/log/encoder.h>
+
+using namespace std;
+using namespace tbox;
+
+void PrintUsage(const char *proc)
+{
+    cout << "Usage: " << proc << " <ring_file> [text|json|logfmt]" << endl
+         << "Exp  : " << proc << " /var/log/sample.ring" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    std::string format = argc >= 3 ? argv[2] : "text";
+    if (format != "text" && format != "json" && format != "logfmt") {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    log::MmapRingReader reader;
+    if (!reader.open(argv[1])) {
+        cerr << "Err: " << argv[1] << " is not a valid ring file" << endl;
+        return 1;
+    }
+
+    std::string line;
+    char timestamp_str[32];
+    uint32_t timestamp_sec = 0;
+    timestamp_str[0] = '\0';
+
+    size_t count = reader.foreach(
+        [&] (const LogContent *content) {
+            if (timestamp_sec != content->timestamp.sec || timestamp_str[0] == '\0') {
+                time_t ts_sec = content->timestamp.sec;
+                struct tm tm;
+                localtime_r(&ts_sec, &tm);
+                strftime(timestamp_str, sizeof(timestamp_str), "%F %H:%M:%S", &tm);
+                timestamp_sec = content->timestamp.sec;
+            }
+
+            line.clear();
+            if (format == "json")
+                log::EncodeJson(content, timestamp_str, line);
+            else if (format == "logfmt")
+                log::EncodeLogfmt(content, timestamp_str, line);
+            else
+                log::EncodeText(content, timestamp_str, false, line);
+            cout << line << endl;
+        }
+    );
+
+    cerr << "pid: " << reader.pid() << ", records: " << count;
+    if (reader.crashSignal() != 0)
+        cerr << ", crashed by signal " << reader.crashSignal() << " (" << strsignal(reader.crashSignal()) << ")";
+    cerr << endl;
+
+    return 0;
+}
@@ -18,10 +18,13 @@
  * of the source tree.
  */
 #include "log_imp.h"
+#include "log_kv.h"
 
-#include <sys/time.h>
 #include <sys/syscall.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <atomic>
 #include <cstring>
 #include <vector>
 #include <iostream>
@@ -42,6 +45,32 @@ struct OutputChannel {
 
 std::vector<OutputChannel> _output_channels;
 
+std::atomic_bool _is_coarse_clock_enabled(false);
+
+//! 缓存本线程的线程号，避免每条日志都调 syscall(SYS_gettid)
+thread_local long _thread_id = 0;
+pthread_once_t _atfork_once = PTHREAD_ONCE_INIT;
+
+void ResetThreadIdInChild()
+{
+    //! fork()之后子进程的线程号变了，但thread_local变量被复制了过来，需要清除
+    _thread_id = 0;
+}
+
+void RegisterAtFork()
+{
+    ::pthread_atfork(nullptr, nullptr, ResetThreadIdInChild);
+}
+
+long GetThreadId()
+{
+    if (_thread_id == 0) {
+        ::pthread_once(&_atfork_once, RegisterAtFork);
+        _thread_id = ::syscall(SYS_gettid);
+    }
+    return _thread_id;
+}
+
 const char* Basename(const char *full_path)
 {
     const char *p_last = full_path;
@@ -69,6 +98,37 @@ void Dispatch(const LogContent &content)
     }
 }
 
+LogContent MakeContent(const char *module_id, const char *func_name, const char *file_name,
+                       int line, int level)
+{
+    if (level < 0) level = 0;
+    if (level >= LOG_LEVEL_MAX) level = (LOG_LEVEL_MAX - 1);
+
+    const char *module_id_be_print = (module_id != nullptr) ? module_id : "???";
+
+    //! clock_gettime() 走vDSO，不陷入内核；COARSE时钟更快，但精度只有一个tick(1~4ms)
+    struct timespec ts;
+    clock_gettime(_is_coarse_clock_enabled ? CLOCK_REALTIME_COARSE : CLOCK_REALTIME, &ts);
+
+    LogContent content = {
+        .thread_id = GetThreadId(),
+        .timestamp = {
+            .sec  = static_cast<uint32_t>(ts.tv_sec),
+            .usec = static_cast<uint32_t>(ts.tv_nsec / 1000),
+        },
+        .module_id = module_id_be_print,
+        .func_name = func_name,
+        .file_name = Basename(file_name),
+        .line = line,
+        .level = level,
+        .text_len = 0,
+        .text_ptr = nullptr,
+        .field_num = 0,
+        .fields = nullptr,
+    };
+    return content;
+}
+
 }
 
 const char  LOG_LEVEL_LEVEL_CODE[LOG_LEVEL_MAX] = {
@@ -98,29 +158,7 @@ void LogPrintfFunc(const char *module_id, const char *func_name, const char *fil
     if (CantDispatch())
         return;
 
-    if (level < 0) level = 0;
-    if (level >= LOG_LEVEL_MAX) level = (LOG_LEVEL_MAX - 1);
-
-    const char *module_id_be_print = (module_id != nullptr) ? module_id : "???";
-
-    struct timeval tv;
-    struct timezone tz;
-    gettimeofday(&tv, &tz);
-
-    LogContent content = {
-        .thread_id = syscall(SYS_gettid),
-        .timestamp = {
-            .sec  = static_cast<uint32_t>(tv.tv_sec),
-            .usec = static_cast<uint32_t>(tv.tv_usec),
-        },
-        .module_id = module_id_be_print,
-        .func_name = func_name,
-        .file_name = Basename(file_name),
-        .line = line,
-        .level = level,
-        .text_len = 0,
-        .text_ptr = nullptr,
-    };
+    LogContent content = MakeContent(module_id, func_name, file_name, line, level);
 
     if (fmt != nullptr) {
         if (with_args) {
@@ -156,6 +194,31 @@ void LogPrintfFunc(const char *module_id, const char *func_name, const char *fil
     }
 }
 
+void LogKvFunc(const char *module_id, const char *func_name, const char *file_name,
+               int line, int level, const char *msg, std::initializer_list<LogKvField> fields)
+{
+    if (CantDispatch())
+        return;
+
+    LogContent content = MakeContent(module_id, func_name, file_name, line, level);
+
+    if (msg != nullptr) {
+        content.text_len = ::strlen(msg);
+        content.text_ptr = msg;
+    }
+
+    //! 字段只记录原始值，不在前端格式化，编码工作交由各Sink完成
+    content.field_num = fields.size();
+    content.fields = fields.begin();
+
+    Dispatch(content);
+}
+
+void LogEnableCoarseClock(bool enable)
+{
+    _is_coarse_clock_enabled = enable;
+}
+
 uint32_t LogAddPrintfFunc(LogPrintfFuncType func, void *ptr)
 {
     std::lock_guard<std::mutex> lg(_lock);
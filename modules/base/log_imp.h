@@ -34,6 +34,31 @@
 extern "C" {
 #endif
 
+//! 结构化日志字段类型
+enum LogFieldType {
+    LOG_FIELD_TYPE_BOOL,    //!< 布尔
+    LOG_FIELD_TYPE_INT,     //!< 有符号整数
+    LOG_FIELD_TYPE_UINT,    //!< 无符号整数
+    LOG_FIELD_TYPE_DOUBLE,  //!< 浮点数
+    LOG_FIELD_TYPE_STRING,  //!< 字串
+};
+
+//! 结构化日志字段，只记录类型与原始值，由Sink决定如何编码
+struct LogField {
+    const char *key;        //!< 字段名
+    int         type;       //!< 字段类型，见 LogFieldType
+    union {
+        bool        b;
+        int64_t     i;
+        uint64_t    u;
+        double      d;
+        struct {
+            const char *ptr;
+            uint32_t    len;
+        } s;
+    } value;                //!< 字段值
+};
+
 //! 日志内容
 struct LogContent {
     long thread_id;         //!< 线程ID
@@ -49,6 +74,8 @@ struct LogContent {
     int         level;      //!< 日志等级
     uint32_t    text_len;   //!< 内容大小
     const char *text_ptr;   //!< 内容地址
+    uint32_t    field_num;  //!< 结构化字段个数
+    const LogField *fields; //!< 结构化字段数组
 };
 
 //! 日志等级颜色表
@@ -62,6 +89,9 @@ typedef void (*LogPrintfFuncType)(const LogContent *content, void *ptr);
 uint32_t LogAddPrintfFunc(LogPrintfFuncType func, void *ptr);
 bool     LogRemovePrintfFunc(uint32_t id);
 
+//! 是否使用 CLOCK_REALTIME_COARSE 获取时间戳，更快但精度低，默认关闭
+void     LogEnableCoarseClock(bool enable);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,132 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <iostream>
+
+#include "log.h"
+#include "log_imp.h"
+
+namespace {
+
+void StoreThreadId(const LogContent *content, void *ptr)
+{
+    *static_cast<long*>(ptr) = content->thread_id;
+}
+
+void DoNothing(const LogContent *, void *) { }
+
+}
+
+TEST(LogImp, ThreadId)
+{
+    long thread_id = 0;
+    auto id = LogAddPrintfFunc(StoreThreadId, &thread_id);
+
+    LogInfo("main");
+    EXPECT_EQ(thread_id, ::syscall(SYS_gettid));
+
+    long sub_thread_id = 0;
+    std::thread t([&] {
+        LogInfo("sub");
+        sub_thread_id = ::syscall(SYS_gettid);
+    });
+    t.join();
+    EXPECT_EQ(thread_id, sub_thread_id);
+
+    LogRemovePrintfFunc(id);
+}
+
+TEST(LogImp, ThreadIdAfterFork)
+{
+    long thread_id = 0;
+    auto id = LogAddPrintfFunc(StoreThreadId, &thread_id);
+    LogInfo("parent");
+
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        LogInfo("child");
+        ::_exit(thread_id == ::syscall(SYS_gettid) ? 0 : 1);
+    }
+
+    int status = -1;
+    ::waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+
+    LogRemovePrintfFunc(id);
+}
+
+TEST(LogImp, CoarseClock)
+{
+    uint32_t sec = 0;
+    auto id = LogAddPrintfFunc(
+        [](const LogContent *content, void *ptr) {
+            *static_cast<uint32_t*>(ptr) = content->timestamp.sec;
+        }, &sec);
+
+    LogEnableCoarseClock(true);
+    LogInfo("coarse");
+    LogEnableCoarseClock(false);
+
+    auto now = static_cast<uint32_t>(::time(nullptr));
+    EXPECT_LE(sec, now);
+    EXPECT_GE(sec + 1, now);
+
+    LogRemovePrintfFunc(id);
+}
+
+TEST(LogImp, Benchmark)
+{
+    auto id = LogAddPrintfFunc(DoNothing, nullptr);
+
+    constexpr int kTimes = 1000000;
+    auto measure = [] (const std::function<void()> &func) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kTimes; ++i)
+            func();
+        auto cost = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(cost).count() / kTimes;
+    };
+
+    //! 原来每条日志都要做的：gettimeofday() + syscall(SYS_gettid)
+    auto legacy_ns = measure([] {
+        struct timeval tv;
+        ::gettimeofday(&tv, nullptr);
+        ::syscall(SYS_gettid);
+    });
+
+    auto precise_ns = measure([] { LogPuts(LOG_LEVEL_INFO, "benchmark"); });
+    LogEnableCoarseClock(true);
+    auto coarse_ns = measure([] { LogPuts(LOG_LEVEL_INFO, "benchmark"); });
+    LogEnableCoarseClock(false);
+
+    std::cout << "legacy time+tid: " << legacy_ns << " ns" << std::endl
+              << "per record, precise clock: " << precise_ns << " ns" << std::endl
+              << "per record, coarse clock : " << coarse_ns << " ns" << std::endl;
+
+    LogRemovePrintfFunc(id);
+}
@@ -0,0 +1,106 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+//! tbox/base/log_kv.h
+#ifndef TBOX_LOG_KV_H_20251019
+#define TBOX_LOG_KV_H_20251019
+
+/**
+ * 结构化日志（key/value）
+ *
+ * 与 LogInfo() 等宏不同，这里的字段在前端只记录类型与原始值，不做格式化。
+ * 由各 Sink 在后端按需要编码成文本、JSON 或 logfmt。
+ *
+ * 使用方法：
+ *   LogKvInfo("user login", {"uid", 1001}, {"name", name}, {"ok", true});
+ *
+ * 注意：字段的 key 与字串值在本次调用期间必须有效
+ */
+
+#include <string>
+#include <cstdint>
+#include <type_traits>
+#include <initializer_list>
+
+#include "log.h"
+#include "log_imp.h"
+
+//! 对 LogField 的C++封装，便于使用 {"key", value} 的方式构造字段
+struct LogKvField : public LogField {
+    LogKvField(const char *k, bool v) { key = k; type = LOG_FIELD_TYPE_BOOL; value.b = v; }
+    LogKvField(const char *k, double v) { key = k; type = LOG_FIELD_TYPE_DOUBLE; value.d = v; }
+    LogKvField(const char *k, float v) { key = k; type = LOG_FIELD_TYPE_DOUBLE; value.d = v; }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    LogKvField(const char *k, T v) { key = k; type = LOG_FIELD_TYPE_INT; value.i = v; }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, int>::type = 0>
+    LogKvField(const char *k, T v) { key = k; type = LOG_FIELD_TYPE_UINT; value.u = v; }
+
+    LogKvField(const char *k, const char *v) { key = k; setString(v, (v != nullptr) ? std::char_traits<char>::length(v) : 0); }
+    LogKvField(const char *k, const std::string &v) { key = k; setString(v.data(), v.size()); }
+
+  private:
+    void setString(const char *ptr, size_t len) {
+        type = LOG_FIELD_TYPE_STRING;
+        value.s.ptr = ptr;
+        value.s.len = static_cast<uint32_t>(len);
+    }
+};
+
+static_assert(sizeof(LogKvField) == sizeof(LogField), "LogKvField must not add members");
+
+//! Define structured log macros
+#define LogKv(level, msg, ...) \
+    LogKvFunc(LOG_MODULE_ID, __func__, __FILE__, __LINE__, level, msg, {__VA_ARGS__})
+
+#define LogKvFatal(msg, ...)     LogKv(LOG_LEVEL_FATAL,  msg, __VA_ARGS__)
+#define LogKvErr(msg, ...)       LogKv(LOG_LEVEL_ERROR,  msg, __VA_ARGS__)
+#define LogKvWarn(msg, ...)      LogKv(LOG_LEVEL_WARN,   msg, __VA_ARGS__)
+#define LogKvNotice(msg, ...)    LogKv(LOG_LEVEL_NOTICE, msg, __VA_ARGS__)
+#define LogKvImportant(msg, ...) LogKv(LOG_LEVEL_IMPORTANT, msg, __VA_ARGS__)
+#define LogKvInfo(msg, ...)      LogKv(LOG_LEVEL_INFO,   msg, __VA_ARGS__)
+
+#if !defined(STATIC_LOG_LEVEL) || (STATIC_LOG_LEVEL >= LOG_LEVEL_DEBUG)
+    #define LogKvDbg(msg, ...)   LogKv(LOG_LEVEL_DEBUG, msg, __VA_ARGS__)
+#else
+    #define LogKvDbg(msg, ...)
+#endif
+
+#if !defined(STATIC_LOG_LEVEL) || (STATIC_LOG_LEVEL >= LOG_LEVEL_TRACE)
+    #define LogKvTrace(msg, ...) LogKv(LOG_LEVEL_TRACE, msg, __VA_ARGS__)
+#else
+    #define LogKvTrace(msg, ...)
+#endif
+
+//!
+//! \brief  Structured log function
+//!
+//! \param  module_id   Module Id
+//! \param  func_name   Function name
+//! \param  file_name   File name
+//! \param  line        Code line
+//! \param  level       Log level
+//! \param  msg         Log message, without format
+//! \param  fields      Typed key/value fields
+//!
+void LogKvFunc(const char *module_id, const char *func_name, const char *file_name,
+               int line, int level, const char *msg, std::initializer_list<LogKvField> fields);
+
+#endif //TBOX_LOG_KV_H_20251019
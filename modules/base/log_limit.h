@@ -0,0 +1,189 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+//! tbox/base/log_limit.h
+#ifndef TBOX_LOG_LIMIT_H_20251019
+#define TBOX_LOG_LIMIT_H_20251019
+
+/**
+ * 采样与限频日志
+ *
+ * 在热路径上出错时，同一行日志每秒可能会打印成千上万次，把网络问题变成磁盘与CPU问题。
+ * 本文件提供以下宏，每个调用点都有自己独立的状态：
+ *
+ *   LogEvery(level, n, fmt, ...)              每n次打印一次
+ *   LogFirstN(level, n, fmt, ...)             只打印前n次
+ *   LogEveryMs(level, ms, fmt, ...)           每ms毫秒最多打印一次
+ *   LogRateLimit(level, rate, burst, fmt, ...) 令牌桶，每秒rate条，最多突发burst条
+ *
+ * 被抑制的次数会在下一次打印时以 " (suppressed N)" 的形式附在内容后面。
+ *
+ * 注意：fmt 必须是字串常量
+ */
+
+#include <time.h>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+
+#include "log.h"
+
+namespace tbox {
+
+//! 调用点的限频状态，需要定义为静态变量
+class LogLimiter {
+  public:
+    constexpr LogLimiter() { }
+
+    bool everyN(uint32_t n, uint32_t &suppressed);
+    bool firstN(uint32_t n);
+    bool everyMs(uint32_t ms, uint32_t &suppressed);
+    bool tokenBucket(uint32_t rate, uint32_t burst, uint32_t &suppressed);
+
+  private:
+    static uint64_t NowMs();
+
+  private:
+    std::atomic<uint32_t> count_{0};
+
+    std::mutex lock_;
+    bool     is_started_ = false;
+    uint32_t suppressed_ = 0;
+    uint64_t last_ms_ = 0;
+    uint64_t milli_tokens_ = 0;   //!< 令牌数 x 1000
+};
+
+inline uint64_t LogLimiter::NowMs()
+{
+    //! 限频不需要高精度，COARSE时钟走vDSO，足够快
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+inline bool LogLimiter::everyN(uint32_t n, uint32_t &suppressed)
+{
+    if (n <= 1) {
+        suppressed = 0;
+        return true;
+    }
+
+    auto count = count_.fetch_add(1, std::memory_order_relaxed);
+    if (count % n != 0)
+        return false;
+
+    suppressed = (count == 0) ? 0 : (n - 1);
+    return true;
+}
+
+inline bool LogLimiter::firstN(uint32_t n)
+{
+    //! 先检查，避免计数一直累加而回绕
+    if (count_.load(std::memory_order_relaxed) >= n)
+        return false;
+    return count_.fetch_add(1, std::memory_order_relaxed) < n;
+}
+
+inline bool LogLimiter::everyMs(uint32_t ms, uint32_t &suppressed)
+{
+    auto now_ms = NowMs();
+
+    std::lock_guard<std::mutex> lg(lock_);
+    if (!is_started_ || (now_ms - last_ms_) >= ms) {
+        is_started_ = true;
+        last_ms_ = now_ms;
+        suppressed = suppressed_;
+        suppressed_ = 0;
+        return true;
+    }
+
+    ++suppressed_;
+    return false;
+}
+
+inline bool LogLimiter::tokenBucket(uint32_t rate, uint32_t burst, uint32_t &suppressed)
+{
+    auto now_ms = NowMs();
+    uint64_t max_milli_tokens = static_cast<uint64_t>(burst == 0 ? 1 : burst) * 1000;
+
+    std::lock_guard<std::mutex> lg(lock_);
+    if (!is_started_) {
+        is_started_ = true;
+        milli_tokens_ = max_milli_tokens;
+    } else {
+        //! 每秒补充rate个令牌，即每毫秒补充rate个千分之一令牌
+        milli_tokens_ += (now_ms - last_ms_) * rate;
+        if (milli_tokens_ > max_milli_tokens)
+            milli_tokens_ = max_milli_tokens;
+    }
+    last_ms_ = now_ms;
+
+    if (milli_tokens_ >= 1000) {
+        milli_tokens_ -= 1000;
+        suppressed = suppressed_;
+        suppressed_ = 0;
+        return true;
+    }
+
+    ++suppressed_;
+    return false;
+}
+
+}
+
+#define LogLimitedPrintf(level, suppressed, fmt, ...) \
+    do { \
+        if ((suppressed) == 0) \
+            LogPrintf(level, fmt, ## __VA_ARGS__); \
+        else \
+            LogPrintf(level, fmt " (suppressed %u)", ## __VA_ARGS__, (suppressed)); \
+    } while (0)
+
+#define LogEvery(level, n, fmt, ...) \
+    do { \
+        static ::tbox::LogLimiter _log_limiter_; \
+        uint32_t _log_suppressed_ = 0; \
+        if (_log_limiter_.everyN((n), _log_suppressed_)) \
+            LogLimitedPrintf(level, _log_suppressed_, fmt, ## __VA_ARGS__); \
+    } while (0)
+
+#define LogFirstN(level, n, fmt, ...) \
+    do { \
+        static ::tbox::LogLimiter _log_limiter_; \
+        if (_log_limiter_.firstN(n)) \
+            LogPrintf(level, fmt, ## __VA_ARGS__); \
+    } while (0)
+
+#define LogEveryMs(level, ms, fmt, ...) \
+    do { \
+        static ::tbox::LogLimiter _log_limiter_; \
+        uint32_t _log_suppressed_ = 0; \
+        if (_log_limiter_.everyMs((ms), _log_suppressed_)) \
+            LogLimitedPrintf(level, _log_suppressed_, fmt, ## __VA_ARGS__); \
+    } while (0)
+
+#define LogRateLimit(level, rate, burst, fmt, ...) \
+    do { \
+        static ::tbox::LogLimiter _log_limiter_; \
+        uint32_t _log_suppressed_ = 0; \
+        if (_log_limiter_.tokenBucket((rate), (burst), _log_suppressed_)) \
+            LogLimitedPrintf(level, _log_suppressed_, fmt, ## __VA_ARGS__); \
+    } while (0)
+
+#endif //TBOX_LOG_LIMIT_H_20251019
@@ -0,0 +1,137 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include "log_limit.h"
+#include "log_imp.h"
+
+namespace tbox {
+namespace {
+
+std::vector<std::string> _logs;
+
+void CaptureLog(const LogContent *content, void *)
+{
+    _logs.emplace_back(content->text_ptr, content->text_len);
+}
+
+class LogLimitTest : public testing::Test {
+  protected:
+    virtual void SetUp() override {
+        _logs.clear();
+        id_ = LogAddPrintfFunc(CaptureLog, nullptr);
+    }
+    virtual void TearDown() override {
+        LogRemovePrintfFunc(id_);
+    }
+  private:
+    uint32_t id_ = 0;
+};
+
+TEST_F(LogLimitTest, Every)
+{
+    for (int i = 0; i < 10; ++i)
+        LogEvery(LOG_LEVEL_INFO, 3, "i:%d", i);
+
+    ASSERT_EQ(_logs.size(), 4u);
+    EXPECT_EQ(_logs[0], "i:0");
+    EXPECT_EQ(_logs[1], "i:3 (suppressed 2)");
+    EXPECT_EQ(_logs[3], "i:9 (suppressed 2)");
+}
+
+TEST_F(LogLimitTest, FirstN)
+{
+    for (int i = 0; i < 10; ++i)
+        LogFirstN(LOG_LEVEL_INFO, 2, "first");
+
+    EXPECT_EQ(_logs.size(), 2u);
+}
+
+TEST_F(LogLimitTest, EveryMs)
+{
+    for (int i = 0; i < 10; ++i)
+        LogEveryMs(LOG_LEVEL_INFO, 100, "every_ms");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    LogEveryMs(LOG_LEVEL_INFO, 100, "every_ms");    //! 不同的调用点，状态独立
+
+    ASSERT_EQ(_logs.size(), 2u);
+    EXPECT_EQ(_logs[0], "every_ms");
+    EXPECT_EQ(_logs[1], "every_ms");
+}
+
+TEST_F(LogLimitTest, EveryMsSuppressed)
+{
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 5; ++j)
+            LogEveryMs(LOG_LEVEL_INFO, 50, "tick");
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    }
+
+    ASSERT_EQ(_logs.size(), 3u);
+    EXPECT_EQ(_logs[0], "tick");
+    EXPECT_EQ(_logs[1], "tick (suppressed 4)");
+    EXPECT_EQ(_logs[2], "tick (suppressed 4)");
+}
+
+TEST_F(LogLimitTest, RateLimit)
+{
+    auto burst = [] {
+        for (int i = 0; i < 100; ++i)
+            LogRateLimit(LOG_LEVEL_INFO, 10, 5, "rate");
+    };
+
+    burst();
+    EXPECT_EQ(_logs.size(), 5u);    //! 只有突发的5条
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    burst();
+    //! 250ms 补充了约2个令牌，COARSE时钟有几毫秒误差
+    ASSERT_GE(_logs.size(), 6u);
+    EXPECT_LE(_logs.size(), 8u);
+    EXPECT_EQ(_logs[5], "rate (suppressed 95)");
+}
+
+TEST(LogLimiter, MultiThreadEvery)
+{
+    LogLimiter limiter;
+    std::atomic<int> pass_count(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            uint32_t suppressed = 0;
+            for (int i = 0; i < 1000; ++i)
+                if (limiter.everyN(10, suppressed))
+                    ++pass_count;
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+
+    EXPECT_EQ(pass_count, 400);
+}
+
+}
+}
@@ -25,6 +25,7 @@
 #include <cinttypes>
 
 #include <tbox/base/log.h>
+#include <tbox/base/log_limit.h>
 #include <tbox/base/assert.h>
 #include <tbox/base/defines.h>
 
@@ -118,7 +119,7 @@ void CommonLoop::endLoopProcess()
         loop_peak_cost_ = cost;
 
     if (cost > water_line_.loop_cost)
-        LogNotice("loop_cost: %" PRIu64 " us", cost.count()/1000);
+        LogEveryMs(LOG_LEVEL_NOTICE, 1000, "loop_cost: %" PRIu64 " us", cost.count()/1000);
 }
 
 void CommonLoop::beginEventProcess()
@@ -130,8 +131,8 @@ void CommonLoop::endEventProcess(Event *event)
 {
     auto cost = steady_clock::now() - event_cb_stat_start_;
     if (cost > water_line_.event_cb_cost)
-        LogNotice("event_cb_cost: %" PRIu64 " us, what: '%s'",
-                  cost.count()/1000, event->what().c_str());
+        LogEveryMs(LOG_LEVEL_NOTICE, 1000, "event_cb_cost: %" PRIu64 " us, what: '%s'",
+                   cost.count()/1000, event->what().c_str());
 }
 
 Stat CommonLoop::getStat() const
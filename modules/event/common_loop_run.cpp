@@ -23,6 +23,7 @@
 #include <inttypes.h>
 #include <algorithm>
 #include <tbox/base/log.h>
+#include <tbox/base/log_limit.h>
 #include <tbox/base/assert.h>
 
 namespace tbox {
@@ -64,7 +65,7 @@ Loop::RunId CommonLoop::runInLoop(Func &&func, const std::string &what)
 
     auto queue_size = run_in_loop_func_queue_.size();
     if (queue_size > water_line_.run_in_loop_queue_size)
-        LogNotice("run_in_loop_queue_size: %u", queue_size);
+        LogEveryMs(LOG_LEVEL_NOTICE, 1000, "run_in_loop_queue_size: %u", queue_size);
 
     if (queue_size > run_in_loop_peak_num_)
         run_in_loop_peak_num_ = queue_size;
@@ -85,7 +86,7 @@ Loop::RunId CommonLoop::runNext(Func &&func, const std::string &what)
 
     auto queue_size = run_next_func_queue_.size();
     if (queue_size > water_line_.run_next_queue_size)
-        LogNotice("run_next_queue_size: %u", queue_size);
+        LogEveryMs(LOG_LEVEL_NOTICE, 1000, "run_next_queue_size: %u", queue_size);
 
     if (queue_size > run_next_peak_num_)
         run_next_peak_num_ = queue_size;
@@ -173,8 +174,8 @@ void CommonLoop::handleNextFunc()
         auto now = steady_clock::now();
         auto delay = now - item.commit_time_point;
         if (delay > water_line_.run_next_delay)
-            LogNotice("run_next_delay: %" PRIu64 " us, what: '%s'",
-                      delay.count()/1000, item.what.c_str());
+            LogEveryMs(LOG_LEVEL_NOTICE, 1000, "run_next_delay: %" PRIu64 " us, what: '%s'",
+                       delay.count()/1000, item.what.c_str());
 
         if (item.func) {
             ++cb_level_;
@@ -184,8 +185,8 @@ void CommonLoop::handleNextFunc()
 
         auto cost = steady_clock::now() - now;
         if (cost > water_line_.run_cb_cost)
-            LogNotice("run_cb_cost: %" PRIu64 " us, what: '%s'",
-                      cost.count()/1000, item.what.c_str());
+            LogEveryMs(LOG_LEVEL_NOTICE, 1000, "run_cb_cost: %" PRIu64 " us, what: '%s'",
+                       cost.count()/1000, item.what.c_str());
     }
 }
 
@@ -210,8 +211,8 @@ void CommonLoop::handleRunInLoopFunc()
         auto now = steady_clock::now();
         auto delay = now - item.commit_time_point;
         if (delay > water_line_.run_in_loop_delay)
-            LogNotice("run_in_loop_delay: %" PRIu64 " us, what: '%s'",
-                      delay.count()/1000, item.what.c_str());
+            LogEveryMs(LOG_LEVEL_NOTICE, 1000, "run_in_loop_delay: %" PRIu64 " us, what: '%s'",
+                       delay.count()/1000, item.what.c_str());
 
         if (item.func) {
             ++cb_level_;
@@ -221,8 +222,8 @@ void CommonLoop::handleRunInLoopFunc()
 
         auto cost = steady_clock::now() - now;
         if (cost > water_line_.run_cb_cost)
-            LogNotice("run_cb_cost: %" PRIu64 " us, what: '%s'",
-                      cost.count()/1000, item.what.c_str());
+            LogEveryMs(LOG_LEVEL_NOTICE, 1000, "run_cb_cost: %" PRIu64 " us, what: '%s'",
+                       cost.count()/1000, item.what.c_str());
     }
 }
 
@@ -277,7 +278,7 @@ void CommonLoop::finishRunRequest()
 {
     auto delay = loop_stat_start_ - request_stat_start_;
     if (delay > water_line_.wake_delay)
-        LogNotice("wake_delay: %" PRIu64 " us", delay.count()/1000);
+        LogEveryMs(LOG_LEVEL_NOTICE, 1000, "wake_delay: %" PRIu64 " us", delay.count()/1000);
 
     uint64_t one = 1;
     ssize_t rsize = read(run_event_fd_, &one, sizeof(one));
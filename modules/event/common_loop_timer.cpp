@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <tbox/base/defines.h>
 #include <tbox/base/assert.h>
+#include <tbox/base/log_limit.h>
 
 #include "timer_event_impl.h"
 
@@ -65,7 +66,7 @@ void CommonLoop::handleExpiredTimers()
 
         int delay_ms = now - t->expired;
         if (delay_ms > (water_line_.timer_delay.count() / 1000000))
-            LogNotice("timer delay over waterline: %d ms", delay_ms);
+            LogEveryMs(LOG_LEVEL_NOTICE, 1000, "timer delay over waterline: %d ms", delay_ms);
 
         auto tobe_run = t->cb;
 
@@ -23,6 +23,7 @@
 #include "fd_event.h"
 #include "loop.h"
 #include <tbox/base/log.h>
+#include <tbox/base/log_limit.h>
 #include <tbox/base/assert.h>
 #include <tbox/base/defines.h>
 
@@ -164,7 +165,7 @@ void EpollFdEvent::OnEventCallback(int fd, uint32_t events, void *obj)
     }
 
     if (events) {
-        LogNotice("unhandle events:%08X, fd:%d", events, fd);
+        LogEveryMs(LOG_LEVEL_NOTICE, 1000, "unhandle events:%08X, fd:%d", events, fd);
     }
 }
 
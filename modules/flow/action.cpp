@@ -59,6 +59,21 @@ void Action::toJson(Json &js) const {
   js["result"] = ToString(result_);
 }
 
+void Action::toJson(util::json::Writer &writer) const {
+  Json js;
+  toJson(js);
+  writer.value(js);
+}
+
+void Action::writeJsonFields(util::json::Writer &writer) const {
+  writer.field("id", id_)
+        .field("type", type_);
+  if (!label_.empty())
+    writer.field("label", label_);
+  writer.field("state", ToString(state_))
+        .field("result", ToString(result_));
+}
+
 int Action::addChild(Action *) {
   LogWarn("%d:%s[%s] not implement this function", id_, type_.c_str(), label_.c_str());
   return -1;
@@ -27,6 +27,7 @@
 
 #include <tbox/base/defines.h>
 #include <tbox/base/json_fwd.h>
+#include <tbox/util/json_writer.h>
 #include <tbox/event/loop.h>
 
 namespace tbox {
@@ -86,6 +87,14 @@ class Action {
     void resetTimeout();
 
     virtual void toJson(Json &js) const;
+    /**
+     * 用 Writer 流式地写出，与 toJson(Json&) 的内容相同，省去构建整个 Json 对象
+     *
+     * 默认经 toJson(Json&) 生成后再写出，所以只重写了 toJson(Json&) 的动作也是对的。
+     * 内置的组合动作都重写了本函数，直接写出子动作。继承这些组合动作并重写了
+     * toJson(Json&) 的类，也要一并重写本函数
+     */
+    virtual void toJson(util::json::Writer &writer) const;
 
     virtual bool isReady() const = 0;
 
@@ -106,6 +115,9 @@ class Action {
     virtual void onFinished(bool is_succ) { (void)is_succ; }
     virtual void onTimeout() { finish(false); }
 
+    //! 写出 Action 本身的字段，不含 '{' 与 '}'，供重写 toJson(Writer&) 的子类使用
+    void writeJsonFields(util::json::Writer &writer) const;
+
   protected:
     event::Loop &loop_;
 
@@ -20,7 +20,20 @@
 #include <gtest/gtest.h>
 #include <tbox/event/loop.h>
 #include <tbox/base/scope_exit.hpp>
+#include <chrono>
+#include <iostream>
+#include <tbox/base/json.hpp>
+#include <tbox/util/json_writer.h>
 #include "action.h"
+#include "actions/function_action.h"
+#include "actions/succ_fail_action.h"
+#include "actions/sequence_action.h"
+#include "actions/parallel_action.h"
+#include "actions/if_else_action.h"
+#include "actions/loop_action.h"
+#include "actions/loop_if_action.h"
+#include "actions/repeat_action.h"
+#include "actions/wrapper_action.h"
 
 namespace tbox {
 namespace flow {
@@ -61,5 +74,79 @@ TEST(Action, Timeout) {
   EXPECT_GE(cout_50, 49);
 }
 
+//! toJson(Writer&) 写出的内容要与 toJson(Json&) 的相同
+TEST(Action, ToJsonWriter) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  auto seq = new SequenceAction(*loop);
+  seq->set_label("root");
+
+  auto para = new ParallelAction(*loop);
+  para->addChild(new SuccAction(*loop));
+  para->addChild(new FailAction(*loop));
+  seq->addChild(para);
+
+  auto if_else = new IfElseAction(*loop);
+  if_else->setChildAs(new SuccAction(*loop), "if");
+  if_else->setChildAs(new FunctionAction(*loop, [] { return true; }), "succ");
+  seq->addChild(if_else);
+
+  auto loop_if = new LoopIfAction(*loop);
+  loop_if->setChildAs(new SuccAction(*loop), "if");
+  loop_if->setChildAs(new FailAction(*loop), "exec");
+  seq->addChild(loop_if);
+
+  seq->addChild(new LoopAction(*loop, new SuccAction(*loop)));
+  seq->addChild(new RepeatAction(*loop, new SuccAction(*loop), 3));
+  seq->addChild(new WrapperAction(*loop, new FailAction(*loop), WrapperAction::Mode::kInvert));
+  seq->addChild(new SequenceAction(*loop));   //! 没有子动作
+
+  Json js;
+  seq->toJson(js);
+
+  std::string text;
+  {
+    util::json::Writer writer(text);
+    seq->toJson(writer);
+    EXPECT_TRUE(writer.isComplete());
+  }
+  EXPECT_EQ(Json::parse(text), js);
+
+  delete seq;
+}
+
+//! 有2万个子动作时，比较 toJson(Json&) 再 dump() 与 toJson(Writer&) 的耗时
+TEST(Action, BenchmarkToJsonWriter) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  SequenceAction seq(*loop);
+  for (int i = 0; i < 20000; ++i)
+    seq.addChild(new WrapperAction(*loop, new SuccAction(*loop)));
+
+  auto start_ts = std::chrono::steady_clock::now();
+  std::string dump_text;
+  {
+    Json js;
+    seq.toJson(js);
+    dump_text = js.dump();
+  }
+  auto dump_cost = std::chrono::steady_clock::now() - start_ts;
+
+  start_ts = std::chrono::steady_clock::now();
+  std::string writer_text;
+  {
+    util::json::Writer writer(writer_text);
+    seq.toJson(writer);
+  }
+  auto writer_cost = std::chrono::steady_clock::now() - start_ts;
+
+  EXPECT_EQ(Json::parse(writer_text), Json::parse(dump_text));
+
+  std::cout << "dump cost: " << std::chrono::duration_cast<std::chrono::microseconds>(dump_cost).count() << " us" << std::endl;
+  std::cout << "writer cost: " << std::chrono::duration_cast<std::chrono::microseconds>(writer_cost).count() << " us" << std::endl;
+}
+
 }
 }
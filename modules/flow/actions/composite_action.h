@@ -52,6 +52,7 @@ class CompositeAction : public Action {
     virtual ~CompositeAction();
 
   public:
+    using Action::toJson;
     virtual void toJson(Json &js) const override;
 
     virtual bool setChild(Action *child) override;
@@ -48,6 +48,24 @@ void IfElseAction::toJson(Json &js) const {
         fail_action_->toJson(js_children["2.fail"]);
 }
 
+void IfElseAction::toJson(util::json::Writer &writer) const {
+    writer.beginObject();
+    writeJsonFields(writer);
+    writer.key("children").beginObject();
+    writer.key("0.if");
+    if_action_->toJson(writer);
+    if (succ_action_ != nullptr) {
+        writer.key("1.succ");
+        succ_action_->toJson(writer);
+    }
+    if (fail_action_ != nullptr) {
+        writer.key("2.fail");
+        fail_action_->toJson(writer);
+    }
+    writer.endObject()
+          .endObject();
+}
+
 bool IfElseAction::setChildAs(Action *child, const std::string &role) {
     if (role == "if") {
         CHECK_DELETE_RESET_OBJ(if_action_);
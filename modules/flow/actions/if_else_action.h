@@ -39,6 +39,7 @@ class IfElseAction : public Action {
     virtual ~IfElseAction();
 
     virtual void toJson(Json &js) const override;
+    virtual void toJson(util::json::Writer &writer) const override;
 
     //! role: "if", "succ", "fail"
     virtual bool setChildAs(Action *child, const std::string &role) override;
@@ -49,6 +49,14 @@ void LoopAction::toJson(Json &js) const {
     child_->toJson(js["child"]);
 }
 
+void LoopAction::toJson(util::json::Writer &writer) const {
+    writer.beginObject();
+    writeJsonFields(writer);
+    writer.key("child");
+    child_->toJson(writer);
+    writer.endObject();
+}
+
 bool LoopAction::setChild(Action *child) {
     CHECK_DELETE_RESET_OBJ(child_);
     child_ = child;
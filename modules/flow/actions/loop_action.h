@@ -37,6 +37,7 @@ class LoopAction : public Action {
     virtual ~LoopAction();
 
     virtual void toJson(Json &js) const override;
+    virtual void toJson(util::json::Writer &writer) const override;
     virtual bool setChild(Action *child) override;
     virtual bool isReady() const override;
 
@@ -42,6 +42,16 @@ void LoopIfAction::toJson(Json &js) const {
   exec_action_->toJson(js["1.exec"]);
 }
 
+void LoopIfAction::toJson(util::json::Writer &writer) const {
+  writer.beginObject();
+  writeJsonFields(writer);
+  writer.key("0.if");
+  if_action_->toJson(writer);
+  writer.key("1.exec");
+  exec_action_->toJson(writer);
+  writer.endObject();
+}
+
 bool LoopIfAction::setChildAs(Action *child, const std::string &role) {
     if (role == "if") {
         CHECK_DELETE_RESET_OBJ(if_action_);
@@ -31,6 +31,7 @@ class LoopIfAction : public Action {
     virtual ~LoopIfAction();
 
     virtual void toJson(Json &js) const override;
+    virtual void toJson(util::json::Writer &writer) const override;
 
     //! role: "if", "exec"
     virtual bool setChildAs(Action *child, const std::string &role) override;
@@ -48,6 +48,22 @@ void ParallelAction::toJson(Json &js) const {
     }
 }
 
+void ParallelAction::toJson(util::json::Writer &writer) const {
+    writer.beginObject();
+    writeJsonFields(writer);
+    writer.key("children");
+    //! 与 toJson(Json&) 一致，没有子动作时为 null
+    if (children_.empty()) {
+        writer.value(nullptr);
+    } else {
+        writer.beginArray();
+        for (auto action : children_)
+            action->toJson(writer);
+        writer.endArray();
+    }
+    writer.endObject();
+}
+
 int ParallelAction::addChild(Action *action) {
     TBOX_ASSERT(action != nullptr);
 
@@ -34,6 +34,7 @@ class ParallelAction : public Action {
     virtual ~ParallelAction();
 
     virtual void toJson(Json &js) const override;
+    virtual void toJson(util::json::Writer &writer) const override;
 
     virtual int addChild(Action *action) override;
     virtual bool isReady() const override;
@@ -53,6 +53,16 @@ void RepeatAction::toJson(Json &js) const {
     js["remain_times"] = remain_times_;
 }
 
+void RepeatAction::toJson(util::json::Writer &writer) const {
+    writer.beginObject();
+    writeJsonFields(writer);
+    writer.key("child");
+    child_->toJson(writer);
+    writer.field("repeat_times", repeat_times_)
+          .field("remain_times", remain_times_)
+          .endObject();
+}
+
 bool RepeatAction::setChild(Action *child) {
     CHECK_DELETE_RESET_OBJ(child_);
     child_ = child;
@@ -38,6 +38,7 @@ class RepeatAction : public Action {
     virtual ~RepeatAction();
 
     virtual void toJson(Json &js) const override;
+    virtual void toJson(util::json::Writer &writer) const override;
     virtual bool setChild(Action *action) override;
     virtual bool isReady() const override;
 
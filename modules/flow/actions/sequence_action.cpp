@@ -49,6 +49,23 @@ void SequenceAction::toJson(Json &js) const {
     js["index"] = index_;
 }
 
+void SequenceAction::toJson(util::json::Writer &writer) const {
+    writer.beginObject();
+    writeJsonFields(writer);
+    writer.key("children");
+    //! 与 toJson(Json&) 一致，没有子动作时为 null
+    if (children_.empty()) {
+        writer.value(nullptr);
+    } else {
+        writer.beginArray();
+        for (auto action : children_)
+            action->toJson(writer);
+        writer.endArray();
+    }
+    writer.field("index", index_)
+          .endObject();
+}
+
 int SequenceAction::addChild(Action *action) {
     TBOX_ASSERT(action != nullptr);
 
@@ -51,6 +51,7 @@ class SequenceAction : public Action {
     virtual ~SequenceAction();
 
     virtual void toJson(Json &js) const override;
+    virtual void toJson(util::json::Writer &writer) const override;
     virtual int addChild(Action *action) override;
     virtual bool isReady() const override;
 
@@ -51,6 +51,15 @@ void WrapperAction::toJson(Json &js) const {
     child_->toJson(js["child"]);
 }
 
+void WrapperAction::toJson(util::json::Writer &writer) const {
+    writer.beginObject();
+    writeJsonFields(writer);
+    writer.field("mode", ToString(mode_))
+          .key("child");
+    child_->toJson(writer);
+    writer.endObject();
+}
+
 bool WrapperAction::setChild(Action *child) {
     CHECK_DELETE_RESET_OBJ(child_);
     child_ = child;
@@ -47,6 +47,7 @@ class WrapperAction : public Action {
 
   protected:
     virtual void toJson(Json &js) const override;
+    virtual void toJson(util::json::Writer &writer) const override;
 
     virtual void onStart() override;
     virtual void onStop() override;
@@ -19,35 +19,617 @@
  */
 #include "client.h"
 
+#include <map>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include <tbox/base/log.h>
+#include <tbox/base/assert.h>
+#include <tbox/base/defines.h>
+#include <tbox/event/timer_event.h>
+#include <tbox/network/tcp_connector.h>
+#include <tbox/network/tcp_connection.h>
+
+#include "respond_parser.h"
+
 namespace tbox {
 namespace http {
 namespace client {
 
 using namespace event;
 using namespace network;
+using namespace std;
+
+using Clock = chrono::steady_clock;
+
+namespace {
+//! 超时与空闲检查的周期
+const chrono::milliseconds kTickInterval(100);
+const Respond kEmptyRespond;
+}
+
+class Client::Impl {
+  public:
+    explicit Impl(Loop *wp_loop);
+    ~Impl();
+
+    void setConfig(const Config &config) { config_ = config; }
+    const Config& config() const { return config_; }
+
+    bool initialize(const SockAddr &server_addr);
+    void request(const SockAddr &server_addr, const Request &req, const RespondCallback &cb, chrono::milliseconds timeout);
+    void request(const Request &req, const RespondCallback &cb, chrono::milliseconds timeout);
+    void cleanup();
+
+  private:
+    //! 一个请求
+    struct Task {
+        string data;            //!< 序列化后的请求
+        RespondCallback cb;
+        Clock::time_point deadline;
+        bool is_no_body = false;    //!< HEAD 请求，回复没有Body
+        bool is_idempotent = false; //!< 幂等的请求可以 pipelining，也可以在连接断开后重发
+        bool is_retried = false;    //!< 已经重发过一次
+    };
+
+    struct Host;
+
+    //! 一个连接
+    struct Conn {
+        Host *wp_host = nullptr;
+        TcpConnector *sp_connector = nullptr;
+        TcpConnection *sp_connection = nullptr;
+        RespondParser parser;
+        deque<Task*> in_flight;     //!< 已发出，等待回复的请求，按发送顺序
+        Clock::time_point since;    //!< 开始连接或开始空闲的时间
+        bool is_reused = false;     //!< 该连接上已收到过回复
+        bool is_closing = false;
+
+        ~Conn() {
+            CHECK_DELETE_RESET_OBJ(sp_connection);
+            CHECK_DELETE_RESET_OBJ(sp_connector);
+        }
+    };
+
+    //! 一个目标地址
+    struct Host {
+        SockAddr addr;
+        string host_str;        //!< 填入 Host 头的值
+        vector<Conn*> conns;
+        deque<Task*> queue;     //!< 排队等待发送的请求
+    };
+
+    using FailedTasks = vector<pair<Task*, Error>>;
+
+    Host* getHost(const SockAddr &addr);
+    void dispatch(Host *host);
+    Conn* newConn(Host *host);
+    void sendTask(Conn *conn, Task *task);
+    void closeConn(Conn *conn);
+    void detachConn(Conn *conn);
+    void requeueInFlight(Conn *conn, FailedTasks &failed, Error err);
+
+    void onConnected(Conn *conn, TcpConnection *new_conn);
+    void onConnectFail(Conn *conn);
+    void onReceived(Conn *conn, Buffer &buff);
+    void onDisconnected(Conn *conn);
+    void onTick();
+
+    void finishTask(Task *task, Error err, const Respond &res);
+    void finishTasks(FailedTasks &failed);
+    void finishTasksLater(FailedTasks &failed);
+    void updateTimer();
+
+  private:
+    Loop *wp_loop_;
+    Config config_;
+    TimerEvent *sp_tick_ev_;
 
-Client::Client(Loop *wp_loop)
+    SockAddr default_addr_;
+    bool has_default_addr_ = false;
+
+    map<string, Host*> hosts_;
+    size_t task_count_ = 0;     //!< 未完成的请求数，含排队中的
+    size_t conn_count_ = 0;
+};
+
+Client::Impl::Impl(Loop *wp_loop) :
+    wp_loop_(wp_loop),
+    sp_tick_ev_(wp_loop->newTimerEvent("http::Client::sp_tick_ev_"))
 {
-    (void)wp_loop;
+    sp_tick_ev_->initialize(kTickInterval, Event::Mode::kPersist);
+    sp_tick_ev_->setCallback(std::bind(&Impl::onTick, this));
 }
 
-Client::~Client()
+Client::Impl::~Impl()
+{
+    cleanup();
+    CHECK_DELETE_RESET_OBJ(sp_tick_ev_);
+}
+
+bool Client::Impl::initialize(const SockAddr &server_addr)
+{
+    default_addr_ = server_addr;
+    has_default_addr_ = true;
+    return true;
+}
+
+void Client::Impl::request(const Request &req, const RespondCallback &cb, chrono::milliseconds timeout)
+{
+    if (!has_default_addr_) {
+        LogWarn("no default server address, call initialize() first");
+        if (cb)
+            wp_loop_->runNext([cb] { cb(Error::kConnectFail, kEmptyRespond); }, "http::Client::request");
+        return;
+    }
+
+    request(default_addr_, req, cb, timeout);
+}
+
+void Client::Impl::request(const SockAddr &server_addr, const Request &req, const RespondCallback &cb, chrono::milliseconds timeout)
+{
+    //! 出错也以异步的方式回调，以免在 request() 中重入
+    if (task_count_ >= config_.max_in_flight) {
+        if (cb)
+            wp_loop_->runNext([cb] { cb(Error::kOverload, kEmptyRespond); }, "http::Client::request");
+        return;
+    }
+
+    Host *host = getHost(server_addr);
+
+    Task *task = new Task;
+    task->cb = cb;
+    task->deadline = Clock::now() + (timeout > chrono::milliseconds::zero() ? timeout : config_.request_timeout);
+    task->is_no_body = req.method == Method::kHead;
+    task->is_idempotent = req.method == Method::kGet || req.method == Method::kHead;
+
+    //! 只在请求缺少必要信息时才复制一份
+    if (req.http_ver == HttpVer::kUnset || req.headers.find(HeaderId::kHost) == req.headers.end()) {
+        Request tmp(req);
+        if (tmp.http_ver == HttpVer::kUnset)
+            tmp.http_ver = HttpVer::k1_1;
+        if (tmp.headers.find(HeaderId::kHost) == tmp.headers.end())
+            tmp.headers[HeaderId::kHost] = host->host_str;
+        task->data = tmp.toString();
+    } else {
+        task->data = req.toString();
+    }
+
+    ++task_count_;
+    host->queue.push_back(task);
+    dispatch(host);
+    updateTimer();
+}
+
+void Client::Impl::cleanup()
+{
+    FailedTasks failed;
+
+    for (auto &item : hosts_) {
+        Host *host = item.second;
+        while (!host->conns.empty()) {
+            Conn *conn = host->conns.back();
+            for (auto task : conn->in_flight)
+                failed.emplace_back(task, Error::kCancelled);
+            conn->in_flight.clear();
+            closeConn(conn);
+        }
+        for (auto task : host->queue)
+            failed.emplace_back(task, Error::kCancelled);
+        host->queue.clear();
+        //! 可能正处于该 Host 下某个连接的回调中，延后释放
+        wp_loop_->runNext([host] { delete host; }, "http::Client::cleanup");
+    }
+    hosts_.clear();
+
+    has_default_addr_ = false;
+    sp_tick_ev_->disable();
+
+    finishTasks(failed);
+}
+
+Client::Impl::Host* Client::Impl::getHost(const SockAddr &addr)
+{
+    auto key = addr.toString();
+    auto iter = hosts_.find(key);
+    if (iter != hosts_.end())
+        return iter->second;
+
+    Host *host = new Host;
+    host->addr = addr;
+    host->host_str = key;
+    hosts_.emplace(key, host);
+    return host;
+}
+
+void Client::Impl::dispatch(Host *host)
+{
+    while (!host->queue.empty()) {
+        Task *task = host->queue.front();
+
+        //! 选在途请求最少的已连接连接，非幂等的请求只交给空闲的连接
+        size_t limit = task->is_idempotent ? std::max<size_t>(config_.max_pipeline, 1) : 1;
+        Conn *best = nullptr;
+        for (auto conn : host->conns) {
+            if (conn->sp_connection == nullptr || conn->in_flight.size() >= limit)
+                continue;
+            if (best == nullptr || conn->in_flight.size() < best->in_flight.size())
+                best = conn;
+            if (best->in_flight.empty())
+                break;
+        }
+
+        if (best == nullptr)
+            break;
+
+        host->queue.pop_front();
+        sendTask(best, task);
+    }
+
+    if (host->queue.empty())
+        return;
+
+    //! 还有排队的请求，按需新建连接，正在建立中的连接也算在内
+    size_t connecting_num = std::count_if(host->conns.begin(), host->conns.end(),
+        [] (const Conn *conn) { return conn->sp_connection == nullptr; });
+
+    while (host->conns.size() < config_.max_conns_per_host && connecting_num < host->queue.size()) {
+        if (newConn(host) == nullptr)
+            break;
+        ++connecting_num;
+    }
+}
+
+Client::Impl::Conn* Client::Impl::newConn(Host *host)
+{
+    Conn *conn = new Conn;
+    conn->wp_host = host;
+    conn->since = Clock::now();
+    conn->sp_connector = new TcpConnector(wp_loop_);
+    conn->sp_connector->initialize(host->addr);
+    conn->sp_connector->setTryTimes(1);
+    conn->sp_connector->setConnectedCallback(std::bind(&Impl::onConnected, this, conn, std::placeholders::_1));
+    conn->sp_connector->setConnectFailCallback(std::bind(&Impl::onConnectFail, this, conn));
+
+    host->conns.push_back(conn);
+    ++conn_count_;
+
+    //! 连接被拒绝时，start() 中就会回调 onConnectFail()
+    if (!conn->sp_connector->start()) {
+        detachConn(conn);
+        return nullptr;
+    }
+
+    return conn;
+}
+
+void Client::Impl::sendTask(Conn *conn, Task *task)
+{
+    if (conn->in_flight.empty())
+        conn->parser.setNoBody(task->is_no_body);
+
+    conn->in_flight.push_back(task);
+    conn->sp_connection->send(task->data.data(), task->data.size());
+}
+
+//! 关闭连接，在途的请求须由调用者先行处理
+void Client::Impl::closeConn(Conn *conn)
+{
+    if (conn->is_closing)
+        return;
+
+    if (conn->sp_connection != nullptr)
+        conn->sp_connection->disconnect();
+    else
+        conn->sp_connector->stop();
+
+    detachConn(conn);
+}
+
+//! 将连接从 Host 中移除，并延后释放
+void Client::Impl::detachConn(Conn *conn)
+{
+    conn->is_closing = true;
+
+    auto &conns = conn->wp_host->conns;
+    conns.erase(std::remove(conns.begin(), conns.end(), conn), conns.end());
+    --conn_count_;
+
+    //! 可能正处于该连接的回调中，不能立即释放
+    wp_loop_->runNext([conn] { delete conn; }, "http::Client::detachConn");
+}
+
+//! 连接断开后处理其上的在途请求：幂等且未重发过的放回队首重发，其它的以 err 失败
+void Client::Impl::requeueInFlight(Conn *conn, FailedTasks &failed, Error err)
+{
+    auto &queue = conn->wp_host->queue;
+    for (auto iter = conn->in_flight.rbegin(); iter != conn->in_flight.rend(); ++iter) {
+        Task *task = *iter;
+        if (task->is_idempotent && !task->is_retried) {
+            task->is_retried = true;
+            queue.push_front(task);
+        } else {
+            failed.emplace_back(task, err);
+        }
+    }
+    conn->in_flight.clear();
+}
+
+void Client::Impl::onConnected(Conn *conn, TcpConnection *new_conn)
+{
+    conn->sp_connection = new_conn;
+    conn->since = Clock::now();
+    new_conn->setReceiveCallback(std::bind(&Impl::onReceived, this, conn, std::placeholders::_1), 0);
+    new_conn->setDisconnectedCallback(std::bind(&Impl::onDisconnected, this, conn));
+
+    dispatch(conn->wp_host);
+}
+
+void Client::Impl::onConnectFail(Conn *conn)
+{
+    Host *host = conn->wp_host;
+    //! TcpConnector 在回调之后自行回到 kInited 状态，此时不能 stop()
+    detachConn(conn);
+
+    //! 没有其它可用的连接了，排队的请求都失败
+    FailedTasks failed;
+    if (host->conns.empty()) {
+        for (auto task : host->queue)
+            failed.emplace_back(task, Error::kConnectFail);
+        host->queue.clear();
+    }
+
+    //! 可能正处于 request() 中，延后回调
+    finishTasksLater(failed);
+    updateTimer();
+}
+
+void Client::Impl::onReceived(Conn *conn, Buffer &buff)
+{
+    while (!conn->is_closing && buff.readableSize() > 0) {
+        auto &parser = conn->parser;
+        auto size = parser.parse(buff.readableBegin(), buff.readableSize());
+        buff.hasRead(size);
+
+        auto state = parser.state();
+        if (state == RespondParser::State::kFinishedAll) {
+            Respond *res = parser.getRespond();
+            if (conn->in_flight.empty()) {
+                //! 没有请求却收到了回复
+                LogNotice("unexpected respond from %s", conn->wp_host->host_str.c_str());
+                delete res;
+                closeConn(conn);
+                break;
+            }
+
+            Task *task = conn->in_flight.front();
+            conn->in_flight.pop_front();
+            conn->is_reused = true;
+            if (!conn->in_flight.empty())
+                parser.setNoBody(conn->in_flight.front()->is_no_body);
+            else
+                conn->since = Clock::now();
+
+            //! 服务端要求关闭连接，后面的请求不会有回复了
+            bool is_close = false;
+            auto iter = res->headers.find(HeaderId::kConnection);
+            if (iter != res->headers.end())
+                is_close = ::strcasestr(iter->second.c_str(), "close") != nullptr;
+            else
+                is_close = res->http_ver == HttpVer::k1_0;
+
+            FailedTasks failed;
+            if (is_close) {
+                requeueInFlight(conn, failed, Error::kDisconnected);
+                closeConn(conn);
+            }
+
+            finishTask(task, Error::kNone, *res);
+            delete res;
+            finishTasks(failed);
+
+        } else if (state == RespondParser::State::kFail) {
+            LogNotice("parse respond from %s fail", conn->wp_host->host_str.c_str());
+            //! 空闲的连接上收到了无效的数据
+            if (conn->in_flight.empty()) {
+                closeConn(conn);
+                break;
+            }
+
+            FailedTasks failed;
+            failed.emplace_back(conn->in_flight.front(), Error::kBadRespond);
+            conn->in_flight.pop_front();
+            requeueInFlight(conn, failed, Error::kBadRespond);
+            closeConn(conn);
+            finishTasks(failed);
+            break;
+
+        } else {
+            break;
+        }
+    }
+
+    if (!conn->is_closing && !conn->wp_host->queue.empty())
+        dispatch(conn->wp_host);
+}
+
+void Client::Impl::onDisconnected(Conn *conn)
+{
+    FailedTasks failed;
+    if (!conn->in_flight.empty() && conn->parser.finishOnClose()) {
+        //! 以断开连接表示结束的回复
+        Respond *res = conn->parser.getRespond();
+        Task *task = conn->in_flight.front();
+        conn->in_flight.pop_front();
+        requeueInFlight(conn, failed, Error::kDisconnected);
+        detachConn(conn);
+        finishTask(task, Error::kNone, *res);
+        delete res;
+    } else {
+        requeueInFlight(conn, failed, Error::kDisconnected);
+        detachConn(conn);
+    }
+
+    Host *host = conn->wp_host;
+    finishTasks(failed);
+
+    if (!host->queue.empty())
+        dispatch(host);
+    updateTimer();
+}
+
+void Client::Impl::onTick()
+{
+    auto now = Clock::now();
+    FailedTasks failed;
+    vector<Host*> tobe_dispatch;
+
+    for (auto &item : hosts_) {
+        Host *host = item.second;
+
+        //! 排队中超时的请求
+        auto &queue = host->queue;
+        for (auto iter = queue.begin(); iter != queue.end(); ) {
+            if ((*iter)->deadline <= now) {
+                failed.emplace_back(*iter, Error::kTimeout);
+                iter = queue.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+
+        auto conns = host->conns;   //! closeConn() 会修改 host->conns
+        for (auto conn : conns) {
+            if (conn->sp_connection == nullptr) {
+                //! 连接建立太久
+                if (now - conn->since >= config_.request_timeout)
+                    closeConn(conn);
+                continue;
+            }
+
+            if (conn->in_flight.empty()) {
+                if (now - conn->since >= config_.idle_timeout)
+                    closeConn(conn);
+                continue;
+            }
+
+            //! 回复是按顺序到来的，只要有一个请求超时，该连接上之后的回复都无法及时收到，
+            //! 所以关闭连接，超时的请求失败，其余的与断开时一样，只有幂等且未重试过的才重新发送
+            auto &in_flight = conn->in_flight;
+            auto timeout_begin = std::stable_partition(in_flight.begin(), in_flight.end(),
+                [now] (const Task *task) { return task->deadline > now; });
+            if (timeout_begin == in_flight.end())
+                continue;
+
+            for (auto iter = timeout_begin; iter != in_flight.end(); ++iter)
+                failed.emplace_back(*iter, Error::kTimeout);
+            in_flight.erase(timeout_begin, in_flight.end());
+
+            requeueInFlight(conn, failed, Error::kTimeout);
+            closeConn(conn);
+        }
+
+        if (!queue.empty())
+            tobe_dispatch.push_back(host);
+    }
+
+    finishTasks(failed);
+
+    for (auto host : tobe_dispatch)
+        dispatch(host);
+
+    updateTimer();
+}
+
+void Client::Impl::finishTask(Task *task, Error err, const Respond &res)
+{
+    --task_count_;
+    if (task->cb)
+        task->cb(err, res);
+    delete task;
+}
+
+void Client::Impl::finishTasks(FailedTasks &failed)
+{
+    for (auto &item : failed)
+        finishTask(item.first, item.second, kEmptyRespond);
+    failed.clear();
+}
+
+//! 回调时不再访问 Impl，Client 在此之前被释放也没有关系
+void Client::Impl::finishTasksLater(FailedTasks &failed)
+{
+    if (failed.empty())
+        return;
+
+    task_count_ -= failed.size();
+    wp_loop_->runNext(
+        [failed] {
+            for (auto &item : failed) {
+                Task *task = item.first;
+                if (task->cb)
+                    task->cb(item.second, kEmptyRespond);
+                delete task;
+            }
+        },
+        "http::Client::finishTasksLater"
+    );
+    failed.clear();
+}
+
+//! 只在有请求或有连接时才需要定时检查
+void Client::Impl::updateTimer()
+{
+    if (task_count_ > 0 || conn_count_ > 0) {
+        if (!sp_tick_ev_->isEnabled())
+            sp_tick_ev_->enable();
+    } else {
+        sp_tick_ev_->disable();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+Client::Client(Loop *wp_loop) :
+    impl_(new Impl(wp_loop))
 { }
 
+Client::~Client()
+{
+    delete impl_;
+}
+
+void Client::setConfig(const Config &config)
+{
+    impl_->setConfig(config);
+}
+
+const Client::Config& Client::config() const
+{
+    return impl_->config();
+}
+
 bool Client::initialize(const SockAddr &server_addr)
 {
-    (void)server_addr;
-    return false;
+    return impl_->initialize(server_addr);
 }
 
-void Client::request(const Request &req, const RespondCallback &cb)
+void Client::request(const Request &req, const RespondCallback &cb, std::chrono::milliseconds timeout)
 {
-    (void)req;
-    (void)cb;
+    impl_->request(req, cb, timeout);
+}
+
+void Client::request(const SockAddr &server_addr, const Request &req, const RespondCallback &cb, std::chrono::milliseconds timeout)
+{
+    impl_->request(server_addr, req, cb, timeout);
 }
 
 void Client::cleanup()
-{ }
+{
+    impl_->cleanup();
+}
 
 }
 }
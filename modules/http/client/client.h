@@ -20,6 +20,9 @@
 #ifndef TBOX_HTTP_CLIENT_H_20220504
 #define TBOX_HTTP_CLIENT_H_20220504
 
+#include <chrono>
+#include <functional>
+
 #include <tbox/event/loop.h>
 #include <tbox/network/sockaddr.h>
 
@@ -30,26 +33,63 @@ namespace tbox {
 namespace http {
 namespace client {
 
+/**
+ * Http客户端
+ *
+ * 按目标地址维护 keep-alive 连接池，同一个目标最多建立 max_conns_per_host 个连接，
+ * 请求优先分配给空闲的连接，没有空闲连接时排队等候；
+ * max_pipeline 大于1时，幂等的请求(GET/HEAD)可以不等前面的回复就在同一个连接上发出；
+ * 每个请求都有超时，空闲的连接超过 idle_timeout 后被关闭
+ */
 class Client {
   public:
     explicit Client(event::Loop *wp_loop);
     virtual ~Client();
 
   public:
-    //! 初始化，设置目标服务器
+    //! 错误码
+    enum class Error {
+        kNone,          //!< 成功
+        kTimeout,       //!< 超时
+        kConnectFail,   //!< 连接失败
+        kDisconnected,  //!< 等待回复时连接断开
+        kBadRespond,    //!< 回复格式错误
+        kOverload,      //!< 未完成的请求太多
+        kCancelled,     //!< 被 cleanup() 取消
+    };
+
+    //! 配置项
+    struct Config {
+        size_t max_conns_per_host = 4;  //!< 每个目标地址最多的连接数
+        size_t max_pipeline = 1;        //!< 每个连接上最多同时等待回复的请求数，为1时不启用 pipelining
+        size_t max_in_flight = 1024;    //!< 所有未完成(含排队中)的请求上限，超过的直接以 kOverload 失败
+        std::chrono::milliseconds request_timeout{5000};    //!< 默认的请求超时，从调用 request() 开始计
+        std::chrono::milliseconds idle_timeout{30000};      //!< 空闲连接的保留时长
+    };
+
+    void setConfig(const Config &config);
+    const Config& config() const;
+
+    //! 初始化，设置默认的目标服务器
     bool initialize(const network::SockAddr &server_addr);
 
-    //! 收到回复时的回调
-    using RespondCallback = std::function<void(const Respond &res)>;
+    //! 收到回复或出错时的回调，err 不为 kNone 时 res 为空
+    using RespondCallback = std::function<void(Error err, const Respond &res)>;
 
     /**
-     * \brief   发送请求
-     * \param   req     请求数据
-     * \param   cb      回复的回调
+     * \brief   向默认的目标服务器发送请求
+     * \param   req     请求数据，http_ver 未设置时为 HTTP/1.1，没有 Host 头时自动添加
+     * \param   cb      回复的回调，每个请求有且只有一次回调
+     * \param   timeout 超时时长，为0表示使用 Config::request_timeout
      */
-    void request(const Request &req, const RespondCallback &cb);
+    void request(const Request &req, const RespondCallback &cb,
+                 std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
+    //! 向指定的目标服务器发送请求，参数同上
+    void request(const network::SockAddr &server_addr, const Request &req, const RespondCallback &cb,
+                 std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
 
-    //! 清理，与initialize()是逆操作
+    //! 清理，与initialize()是逆操作。未完成的请求都以 kCancelled 回调
     void cleanup();
 
   private:
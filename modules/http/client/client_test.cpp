@@ -0,0 +1,528 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <tbox/event/loop.h>
+#include <tbox/event/timer_event.h>
+#include <tbox/network/tcp_server.h>
+
+#include "client.h"
+#include "../server/server.h"
+
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::network;
+using namespace tbox::http;
+using namespace tbox::http::client;
+
+namespace {
+
+const char *kBindAddr = "127.0.0.1:51082";
+
+Request MakeGet(const std::string &path)
+{
+    Request req;
+    req.method = Method::kGet;
+    req.url.path = path;
+    return req;
+}
+
+//! 在 ms 毫秒后退出 Loop，以防测试卡住
+TimerEvent* ExitLater(Loop *wp_loop, int ms)
+{
+    auto timer = wp_loop->newTimerEvent();
+    timer->initialize(std::chrono::milliseconds(ms), Event::Mode::kOneshot);
+    timer->setCallback([wp_loop] { wp_loop->exitLoop(); });
+    timer->enable();
+    return timer;
+}
+
+//! 回复 path 的 Http 服务，"/slow" 不回复
+class EchoServer {
+  public:
+    explicit EchoServer(Loop *wp_loop) : server_(wp_loop) {
+        server_.initialize(SockAddr::FromString(kBindAddr), 64);
+        server_.use(
+            [this] (server::ContextSptr ctx, const server::NextFunc &) {
+                ++req_count;
+                if (ctx->req().url.path == "/slow") {
+                    slow_ctxs.push_back(ctx);
+                    return;
+                }
+                ctx->res().status_code = StatusCode::k200_OK;
+                ctx->res().body = ctx->req().url.path;
+            }
+        );
+        server_.start();
+    }
+
+    ~EchoServer() {
+        slow_ctxs.clear();
+        server_.cleanup();
+    }
+
+    int req_count = 0;
+    std::vector<server::ContextSptr> slow_ctxs;
+
+  private:
+    server::Server server_;
+};
+
+//! 用 TcpServer 模拟的服务端，便于观察连接与控制断开
+class RawServer {
+  public:
+    explicit RawServer(Loop *wp_loop) : server_(wp_loop) {
+        server_.initialize(SockAddr::FromString(kBindAddr), 64);
+        server_.setConnectedCallback([this] (const TcpServer::ConnToken &) { ++conn_count; });
+        server_.setDisconnectedCallback([this] (const TcpServer::ConnToken &) { ++disconn_count; });
+        server_.setReceiveCallback(
+            [this] (const TcpServer::ConnToken &ct, Buffer &buff) {
+                std::string data(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+                buff.hasReadAll();
+                for (size_t pos = 0; (pos = data.find("\r\n\r\n", pos)) != std::string::npos; pos += 4) {
+                    ++req_count;
+                    if (on_request)
+                        on_request(ct);
+                    else
+                        reply(ct);
+                }
+            }, 0
+        );
+        server_.start();
+    }
+
+    ~RawServer() { server_.cleanup(); }
+
+    void reply(const TcpServer::ConnToken &ct) {
+        const char *res = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+        server_.send(ct, res, ::strlen(res));
+    }
+    void disconnect(const TcpServer::ConnToken &ct) { server_.disconnect(ct); }
+    void send(const TcpServer::ConnToken &ct, const std::string &data) { server_.send(ct, data.data(), data.size()); }
+
+    int conn_count = 0;
+    int disconn_count = 0;
+    int req_count = 0;
+    std::function<void(const TcpServer::ConnToken &)> on_request;
+
+  private:
+    TcpServer server_;
+};
+
+}
+
+TEST(Client, Get)
+{
+    auto sp_loop = Loop::New();
+    {
+        EchoServer server(sp_loop);
+
+        Client client(sp_loop);
+        ASSERT_TRUE(client.initialize(SockAddr::FromString(kBindAddr)));
+
+        int count = 0;
+        client.request(MakeGet("/hello"),
+            [&] (Client::Error err, const Respond &res) {
+                EXPECT_EQ(err, Client::Error::kNone);
+                EXPECT_EQ(res.status_code, StatusCode::k200_OK);
+                EXPECT_EQ(res.body, "/hello");
+                //! 在回调中继续发请求，复用同一个连接
+                client.request(MakeGet("/world"),
+                    [&] (Client::Error err, const Respond &res) {
+                        EXPECT_EQ(err, Client::Error::kNone);
+                        EXPECT_EQ(res.body, "/world");
+                        ++count;
+                        sp_loop->exitLoop();
+                    }
+                );
+                ++count;
+            }
+        );
+
+        auto timer = ExitLater(sp_loop, 1000);
+        sp_loop->runLoop();
+
+        EXPECT_EQ(count, 2);
+        EXPECT_EQ(server.req_count, 2);
+
+        client.cleanup();
+        delete timer;
+    }
+    delete sp_loop;
+}
+
+//! 回复须按请求的顺序对应，连接数不超过 max_conns_per_host
+TEST(Client, PoolAndPipelining)
+{
+    auto sp_loop = Loop::New();
+    {
+        RawServer server(sp_loop);
+
+        Client client(sp_loop);
+        Client::Config config;
+        config.max_conns_per_host = 2;
+        config.max_pipeline = 8;
+        client.setConfig(config);
+        client.initialize(SockAddr::FromString(kBindAddr));
+
+        const int kReqNum = 50;
+        int count = 0;
+        for (int i = 0; i < kReqNum; ++i) {
+            client.request(MakeGet("/" + std::to_string(i)),
+                [&] (Client::Error err, const Respond &res) {
+                    EXPECT_EQ(err, Client::Error::kNone);
+                    EXPECT_EQ(res.body, "ok");
+                    if (++count == kReqNum)
+                        sp_loop->exitLoop();
+                }
+            );
+        }
+
+        auto timer = ExitLater(sp_loop, 1000);
+        sp_loop->runLoop();
+
+        EXPECT_EQ(count, kReqNum);
+        EXPECT_EQ(server.req_count, kReqNum);
+        EXPECT_EQ(server.conn_count, 2);
+
+        client.cleanup();
+        delete timer;
+    }
+    delete sp_loop;
+}
+
+TEST(Client, Timeout)
+{
+    auto sp_loop = Loop::New();
+    {
+        EchoServer server(sp_loop);
+
+        Client client(sp_loop);
+        client.initialize(SockAddr::FromString(kBindAddr));
+
+        auto start_ts = std::chrono::steady_clock::now();
+        std::vector<Client::Error> errs;
+        client.request(MakeGet("/slow"),
+            [&] (Client::Error err, const Respond &) {
+                errs.push_back(err);
+                //! 超时的连接被关闭了，之后的请求仍可以正常完成
+                client.request(MakeGet("/fast"),
+                    [&] (Client::Error err, const Respond &res) {
+                        errs.push_back(err);
+                        EXPECT_EQ(res.body, "/fast");
+                        sp_loop->exitLoop();
+                    }
+                );
+            },
+            std::chrono::milliseconds(200)
+        );
+
+        auto timer = ExitLater(sp_loop, 2000);
+        sp_loop->runLoop();
+
+        auto cost = std::chrono::steady_clock::now() - start_ts;
+        EXPECT_GE(cost, std::chrono::milliseconds(200));
+        EXPECT_LT(cost, std::chrono::milliseconds(1000));
+        ASSERT_EQ(errs.size(), 2u);
+        EXPECT_EQ(errs[0], Client::Error::kTimeout);
+        EXPECT_EQ(errs[1], Client::Error::kNone);
+
+        client.cleanup();
+        delete timer;
+    }
+    delete sp_loop;
+}
+
+TEST(Client, IdleEvict)
+{
+    auto sp_loop = Loop::New();
+    {
+        RawServer server(sp_loop);
+
+        Client client(sp_loop);
+        Client::Config config;
+        config.idle_timeout = std::chrono::milliseconds(200);
+        client.setConfig(config);
+        client.initialize(SockAddr::FromString(kBindAddr));
+
+        client.request(MakeGet("/"), [] (Client::Error err, const Respond &) { EXPECT_EQ(err, Client::Error::kNone); });
+
+        auto timer = ExitLater(sp_loop, 500);
+        sp_loop->runLoop();
+
+        EXPECT_EQ(server.conn_count, 1);
+        EXPECT_EQ(server.disconn_count, 1);
+
+        client.cleanup();
+        delete timer;
+    }
+    delete sp_loop;
+}
+
+//! 复用的连接被服务端断开，幂等的请求重发一次
+TEST(Client, RetryOnReusedConnection)
+{
+    auto sp_loop = Loop::New();
+    {
+        RawServer server(sp_loop);
+        server.on_request = [&] (const TcpServer::ConnToken &ct) {
+            if (server.req_count == 2)
+                server.disconnect(ct);
+            else
+                server.reply(ct);
+        };
+
+        Client client(sp_loop);
+        client.initialize(SockAddr::FromString(kBindAddr));
+
+        std::vector<Client::Error> errs;
+        client.request(MakeGet("/"),
+            [&] (Client::Error err, const Respond &) {
+                errs.push_back(err);
+                client.request(MakeGet("/"),
+                    [&] (Client::Error err, const Respond &res) {
+                        errs.push_back(err);
+                        EXPECT_EQ(res.body, "ok");
+                        sp_loop->exitLoop();
+                    }
+                );
+            }
+        );
+
+        auto timer = ExitLater(sp_loop, 1000);
+        sp_loop->runLoop();
+
+        ASSERT_EQ(errs.size(), 2u);
+        EXPECT_EQ(errs[0], Client::Error::kNone);
+        EXPECT_EQ(errs[1], Client::Error::kNone);
+        EXPECT_EQ(server.req_count, 3);
+        EXPECT_EQ(server.conn_count, 2);
+
+        client.cleanup();
+        delete timer;
+    }
+    delete sp_loop;
+}
+
+//! 管道中排在 POST 之后的 GET 超时，POST 不能被重发
+TEST(Client, TimeoutNotResendPost)
+{
+    auto sp_loop = Loop::New();
+    {
+        RawServer server(sp_loop);
+        server.on_request = [] (const TcpServer::ConnToken &) { };
+
+        Client client(sp_loop);
+        Client::Config config;
+        config.max_conns_per_host = 1;
+        config.max_pipeline = 8;
+        client.setConfig(config);
+        client.initialize(SockAddr::FromString(kBindAddr));
+
+        std::vector<std::string> results;
+        Request post_req = MakeGet("/post");
+        post_req.method = Method::kPost;
+        client.request(post_req,
+            [&] (Client::Error err, const Respond &) {
+                EXPECT_EQ(err, Client::Error::kTimeout);
+                results.push_back("post");
+            },
+            std::chrono::milliseconds(3000)
+        );
+        client.request(MakeGet("/get"),
+            [&] (Client::Error err, const Respond &) {
+                EXPECT_EQ(err, Client::Error::kTimeout);
+                results.push_back("get");
+            },
+            std::chrono::milliseconds(200)
+        );
+
+        auto timer = ExitLater(sp_loop, 1000);
+        sp_loop->runLoop();
+
+        ASSERT_EQ(results.size(), 2u);
+        EXPECT_EQ(results[0], "get");
+        EXPECT_EQ(results[1], "post");
+        EXPECT_EQ(server.req_count, 2);
+        EXPECT_EQ(server.conn_count, 1);
+
+        client.cleanup();
+        delete timer;
+    }
+    delete sp_loop;
+}
+
+//! 空闲的连接上收到无效的数据，关闭该连接
+TEST(Client, GarbageOnIdleConnection)
+{
+    auto sp_loop = Loop::New();
+    {
+        RawServer server(sp_loop);
+        TcpServer::ConnToken last_ct;
+        server.on_request = [&] (const TcpServer::ConnToken &ct) {
+            last_ct = ct;
+            server.reply(ct);
+        };
+
+        Client client(sp_loop);
+        client.initialize(SockAddr::FromString(kBindAddr));
+
+        int count = 0;
+        client.request(MakeGet("/"),
+            [&] (Client::Error err, const Respond &) {
+                EXPECT_EQ(err, Client::Error::kNone);
+                ++count;
+                server.send(last_ct, "garbage\r\n\r\n");
+            }
+        );
+
+        auto timer = ExitLater(sp_loop, 100);
+        sp_loop->runLoop();
+
+        EXPECT_EQ(count, 1);
+        EXPECT_EQ(server.disconn_count, 1);
+
+        client.cleanup();
+        delete timer;
+    }
+    delete sp_loop;
+}
+
+TEST(Client, ConnectFailAndOverload)
+{
+    auto sp_loop = Loop::New();
+    {
+
+        Client client(sp_loop);
+        Client::Config config;
+        config.max_in_flight = 1;
+        client.setConfig(config);
+
+        std::vector<Client::Error> errs;
+        client.request(SockAddr::FromString("127.0.0.1:51083"), MakeGet("/"),
+            [&] (Client::Error err, const Respond &) {
+                errs.push_back(err);
+                sp_loop->exitLoop();
+            }
+        );
+        client.request(SockAddr::FromString("127.0.0.1:51083"), MakeGet("/"),
+            [&] (Client::Error err, const Respond &) { errs.push_back(err); }
+        );
+
+        auto timer = ExitLater(sp_loop, 1000);
+        sp_loop->runLoop();
+
+        ASSERT_EQ(errs.size(), 2u);
+        EXPECT_EQ(errs[0], Client::Error::kOverload);
+        EXPECT_EQ(errs[1], Client::Error::kConnectFail);
+
+        client.cleanup();
+        delete timer;
+    }
+    delete sp_loop;
+}
+
+TEST(Client, Cancel)
+{
+    auto sp_loop = Loop::New();
+    {
+        EchoServer server(sp_loop);
+
+        Client client(sp_loop);
+        client.initialize(SockAddr::FromString(kBindAddr));
+
+        std::vector<Client::Error> errs;
+        for (int i = 0; i < 3; ++i)
+            client.request(MakeGet("/slow"), [&] (Client::Error err, const Respond &) { errs.push_back(err); });
+
+        auto timer = ExitLater(sp_loop, 100);
+        sp_loop->runLoop();
+
+        client.cleanup();
+        ASSERT_EQ(errs.size(), 3u);
+        for (auto err : errs)
+            EXPECT_EQ(err, Client::Error::kCancelled);
+
+        delete timer;
+    }
+    delete sp_loop;
+}
+
+//! 对比不同连接数与 pipelining 深度下的吞吐
+TEST(Client, Benchmark)
+{
+    struct Case { size_t conns; size_t pipeline; };
+    Case cases[] = { {1, 1}, {1, 8}, {4, 1}, {4, 8} };
+
+    for (auto &c : cases) {
+        auto sp_loop = Loop::New();
+        {
+            EchoServer server(sp_loop);
+
+            Client client(sp_loop);
+            Client::Config config;
+            config.max_conns_per_host = c.conns;
+            config.max_pipeline = c.pipeline;
+            client.setConfig(config);
+            client.initialize(SockAddr::FromString(kBindAddr));
+
+            const int kReqNum = 20000;
+            const int kWindow = 64;     //! 同时未完成的请求数
+            int sent = 0, done = 0, fail = 0;
+
+            std::function<void()> send_one;
+            send_one = [&] {
+                ++sent;
+                client.request(MakeGet("/bench"),
+                    [&] (Client::Error err, const Respond &) {
+                        if (err != Client::Error::kNone)
+                            ++fail;
+                        if (++done == kReqNum)
+                            sp_loop->exitLoop();
+                        else if (sent < kReqNum)
+                            send_one();
+                    }
+                );
+            };
+
+            auto start_ts = std::chrono::steady_clock::now();
+            for (int i = 0; i < kWindow; ++i)
+                send_one();
+
+            auto timer = ExitLater(sp_loop, 20000);
+            sp_loop->runLoop();
+            auto cost = std::chrono::steady_clock::now() - start_ts;
+            auto cost_us = std::chrono::duration_cast<std::chrono::microseconds>(cost).count();
+
+            EXPECT_EQ(done, kReqNum);
+            EXPECT_EQ(fail, 0);
+            std::cout << "conns: " << c.conns << ", pipeline: " << c.pipeline
+                      << ", requests: " << done << ", cost: " << cost_us << " us"
+                      << ", " << (done * 1000000ull / (cost_us + 1)) << " req/s" << std::endl;
+
+            client.cleanup();
+            delete timer;
+        }
+        delete sp_loop;
+    }
+}
@@ -0,0 +1,178 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "respond_parser.h"
+
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace http {
+namespace client {
+
+RespondParser::~RespondParser()
+{
+    CHECK_DELETE_RESET_OBJ(sp_respond_);
+}
+
+size_t RespondParser::parse(const void *data_ptr, size_t data_size)
+{
+    const char *data_begin = static_cast<const char*>(data_ptr);
+    const char *data_end = data_begin + data_size;
+    const char *pos = data_begin;
+
+    for (;;) {
+        if (state_ == State::kInit) {
+            beginMessage();
+            if (sp_respond_ == nullptr)
+                sp_respond_ = new Respond;
+        }
+
+        while (state_ == State::kInit || state_ == State::kFinishedStartLine) {
+            const char *line_end, *next_line;
+            if (!findLine(pos, data_end, line_end, next_line))
+                return pos - data_begin;
+
+            if (state_ == State::kInit) {
+                if (!parseStatusLine(pos, line_end)) {
+                    state_ = State::kFail;
+                    return pos - data_begin;
+                }
+                state_ = State::kFinishedStartLine;
+
+            } else if (line_end == pos) {   //! 找到了空白行
+                state_ = State::kFinishedHeads;
+
+                int code = static_cast<int>(sp_respond_->status_code);
+                if (no_body_ || code == 204 || code == 304 || (code >= 100 && code < 200))
+                    body_type_ = BodyType::kNone;
+                else if (is_chunked_)
+                    body_type_ = BodyType::kChunked;
+                else if (content_length_ != kNoContentLength)
+                    body_type_ = BodyType::kLength;
+                else
+                    body_type_ = BodyType::kUntilClose;
+
+                if (body_type_ == BodyType::kLength)
+                    sp_respond_->body.reserve(std::min<size_t>(content_length_, 1 << 20));
+
+            } else if (!parseHeader(pos, line_end, sp_respond_->headers)) {
+                state_ = State::kFail;
+                return pos - data_begin;
+            }
+
+            pos = next_line;
+        }
+
+        if (state_ != State::kFinishedHeads)
+            break;
+
+        size_t remain_size = data_end - pos;
+        if (body_type_ == BodyType::kNone) {
+            state_ = State::kFinishedAll;
+
+        } else if (body_type_ == BodyType::kLength) {
+            size_t take_size = std::min(content_length_ - sp_respond_->body.size(), remain_size);
+            onBody(pos, take_size);
+            pos += take_size;
+            if (sp_respond_->body.size() == content_length_)
+                state_ = State::kFinishedAll;
+
+        } else if (body_type_ == BodyType::kChunked) {
+            ChunkResult result;
+            pos = parseChunkedBody(pos, data_end, result);
+            if (result == ChunkResult::kFail)
+                state_ = State::kFail;
+            else if (result == ChunkResult::kFinished)
+                state_ = State::kFinishedAll;
+
+        } else {
+            onBody(pos, remain_size);
+            pos = data_end;
+        }
+
+        //! 跳过 1xx 的临时回复，继续解析后面的
+        int code = static_cast<int>(sp_respond_->status_code);
+        if (state_ == State::kFinishedAll && code >= 100 && code < 200) {
+            CHECK_DELETE_RESET_OBJ(sp_respond_);
+            state_ = State::kInit;
+            continue;
+        }
+        break;
+    }
+
+    return pos - data_begin;
+}
+
+bool RespondParser::finishOnClose()
+{
+    if (state_ == State::kFinishedHeads && body_type_ == BodyType::kUntilClose) {
+        state_ = State::kFinishedAll;
+        return true;
+    }
+    return false;
+}
+
+Respond* RespondParser::getRespond()
+{
+    Respond *ret = nullptr;
+    if (state_ == State::kFinishedAll) {
+        std::swap(ret, sp_respond_);
+        state_ = State::kInit;
+    }
+    return ret;
+}
+
+/* 解析："HTTP/1.1 200 OK" */
+bool RespondParser::parseStatusLine(const char *begin, const char *end)
+{
+    const char *ver_end = static_cast<const char*>(::memchr(begin, ' ', end - begin));
+    if (ver_end == nullptr)
+        return false;
+
+    auto ver = StringToHttpVer(std::string(begin, ver_end));
+    if (ver == HttpVer::kUnset)
+        return false;
+
+    const char *code_begin = ver_end;
+    while (code_begin < end && *code_begin == ' ')
+        ++code_begin;
+
+    //! 状态码必须是3位数字，原因短语可以为空
+    if (end - code_begin < 3 || !::isdigit(code_begin[0]) || !::isdigit(code_begin[1]) || !::isdigit(code_begin[2]))
+        return false;
+    if (end - code_begin > 3 && code_begin[3] != ' ')
+        return false;
+
+    int code = (code_begin[0] - '0') * 100 + (code_begin[1] - '0') * 10 + (code_begin[2] - '0');
+    sp_respond_->http_ver = ver;
+    sp_respond_->status_code = static_cast<StatusCode>(code);
+    return true;
+}
+
+void RespondParser::onBody(const char *data_ptr, size_t data_size)
+{
+    sp_respond_->body.append(data_ptr, data_size);
+}
+
+}
+}
+}
@@ -0,0 +1,100 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_CLIENT_RESPOND_PARSER_H_20251019
+#define TBOX_HTTP_CLIENT_RESPOND_PARSER_H_20251019
+
+#include "../respond.h"
+#include "../message_parser.h"
+
+namespace tbox {
+namespace http {
+namespace client {
+
+//! 回复解析器
+class RespondParser : public MessageParser {
+  public:
+    //! 状态
+    enum class State {
+        kInit,              //!< 初始化，未开始
+        kFinishedStartLine, //!< 完成了状态行解析
+        kFinishedHeads,     //!< 完成heads的解析
+        kFinishedAll,       //!< 完成了整个Http的解析
+        kFail,              //!< 出错
+    };
+
+    virtual ~RespondParser() override;
+
+    /**
+     * \brief   解析
+     * \param   data_ptr    数据地址
+     * \param   data_size   数据大小
+     * \return  size_t      已处理数据大小
+     *
+     * \note    与 server::RequestParser 一样是可续的，未处理的数据在下一次调用时须原样放在开头
+     *          Body 的长度依次由 Content-Length、Transfer-Encoding: chunked 决定，都没有时
+     *          读到连接断开为止，见 finishOnClose()。1xx 的临时回复会被跳过
+     */
+    size_t parse(const void *data_ptr, size_t data_size);
+
+    //! 当前的回复是否没有Body，如 HEAD 请求的回复。须在开始解析该回复之前设置
+    void setNoBody(bool no_body) { no_body_ = no_body; }
+
+    /**
+     * 连接断开时调用
+     * 如果当前的回复是以断开连接表示结束的，则完成解析并返回 true
+     */
+    bool finishOnClose();
+
+    //! 获取状态
+    State state() const { return state_; }
+
+    /**
+     * \brief   取走Respond对象
+     * \return  Respond*    回复对象，只有state为kFinishedAll时才有，否则为nullptr
+     * \note    取走后由调用者负责释放
+     */
+    Respond* getRespond();
+
+  protected:
+    virtual void onBody(const char *data_ptr, size_t data_size) override;
+
+  private:
+    bool parseStatusLine(const char *begin, const char *end);
+
+    enum class BodyType {
+        kNone,          //!< 没有Body
+        kLength,        //!< 由 Content-Length 指定
+        kChunked,       //!< chunked 编码
+        kUntilClose,    //!< 读到断开为止
+    };
+
+  private:
+    State state_ = State::kInit;
+    Respond *sp_respond_ = nullptr;
+    bool no_body_ = false;
+
+    BodyType body_type_ = BodyType::kNone;
+};
+
+}
+}
+}
+
+#endif //TBOX_HTTP_CLIENT_RESPOND_PARSER_H_20251019
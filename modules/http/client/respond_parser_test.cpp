@@ -0,0 +1,161 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+#include "respond_parser.h"
+
+namespace tbox {
+namespace http {
+namespace client {
+namespace {
+
+TEST(RespondParser, ContentLength)
+{
+    const char *text = \
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "Hello"
+        ;
+    size_t text_len = ::strlen(text);
+    RespondParser pp;
+    EXPECT_EQ(pp.parse(text, text_len), text_len);
+    ASSERT_EQ(pp.state(), RespondParser::State::kFinishedAll);
+    auto res = pp.getRespond();
+    ASSERT_NE(res, nullptr);
+    EXPECT_EQ(res->http_ver, HttpVer::k1_1);
+    EXPECT_EQ(res->status_code, StatusCode::k200_OK);
+    EXPECT_EQ(res->headers["Content-Type"], "text/plain");
+    EXPECT_EQ(res->body, "Hello");
+    EXPECT_EQ(pp.state(), RespondParser::State::kInit);
+    delete res;
+}
+
+//! 逐字节输入，并且两个回复连在一起
+TEST(RespondParser, ByteByByteAndPipelined)
+{
+    std::string text = \
+        "HTTP/1.1 404 Not Found\r\n"
+        "Content-Length: 3\r\n"
+        "\r\n"
+        "abc"
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "3\r\nxyz\r\n"
+        "a;ext=1\r\n0123456789\r\n"
+        "0\r\n"
+        "Trailer: 1\r\n"
+        "\r\n"
+        ;
+
+    RespondParser pp;
+    std::vector<Respond*> res_vec;
+    std::string buff;
+    for (char ch : text) {
+        buff.push_back(ch);
+        auto size = pp.parse(buff.data(), buff.size());
+        buff.erase(0, size);
+        ASSERT_NE(pp.state(), RespondParser::State::kFail);
+        if (pp.state() == RespondParser::State::kFinishedAll)
+            res_vec.push_back(pp.getRespond());
+    }
+
+    ASSERT_EQ(res_vec.size(), 2u);
+    EXPECT_EQ(res_vec[0]->status_code, StatusCode::k404_NotFound);
+    EXPECT_EQ(res_vec[0]->body, "abc");
+    EXPECT_EQ(res_vec[1]->status_code, StatusCode::k200_OK);
+    EXPECT_EQ(res_vec[1]->body, "xyz0123456789");
+    for (auto res : res_vec)
+        delete res;
+}
+
+TEST(RespondParser, NoBody)
+{
+    std::string text = \
+        "HTTP/1.1 100 Continue\r\n"
+        "\r\n"
+        "HTTP/1.1 204 No Content\r\n"
+        "\r\n"
+        ;
+
+    RespondParser pp;
+    EXPECT_EQ(pp.parse(text.data(), text.size()), text.size());
+    ASSERT_EQ(pp.state(), RespondParser::State::kFinishedAll);
+    auto res = pp.getRespond();
+    EXPECT_EQ(res->status_code, StatusCode::k204_NoContent);
+    delete res;
+
+    //! HEAD 请求的回复带有 Content-Length，但没有 Body
+    text = \
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 100\r\n"
+        "\r\n"
+        ;
+    pp.setNoBody(true);
+    EXPECT_EQ(pp.parse(text.data(), text.size()), text.size());
+    ASSERT_EQ(pp.state(), RespondParser::State::kFinishedAll);
+    res = pp.getRespond();
+    EXPECT_EQ(res->headers["Content-Length"], "100");
+    EXPECT_EQ(res->body, "");
+    delete res;
+}
+
+TEST(RespondParser, UntilClose)
+{
+    std::string text = \
+        "HTTP/1.0 200 OK\r\n"
+        "\r\n"
+        "some data"
+        ;
+
+    RespondParser pp;
+    EXPECT_EQ(pp.parse(text.data(), text.size()), text.size());
+    EXPECT_EQ(pp.state(), RespondParser::State::kFinishedHeads);
+    EXPECT_TRUE(pp.finishOnClose());
+    auto res = pp.getRespond();
+    ASSERT_NE(res, nullptr);
+    EXPECT_EQ(res->http_ver, HttpVer::k1_0);
+    EXPECT_EQ(res->body, "some data");
+    delete res;
+}
+
+TEST(RespondParser, Error)
+{
+    const char *bad_texts[] = {
+        "HTTP/1.1 20 OK\r\n\r\n",
+        "HTTX/1.1 200 OK\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nContent-Length: abc\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nxyz\r\n",
+    };
+
+    for (auto text : bad_texts) {
+        RespondParser pp;
+        pp.parse(text, ::strlen(text));
+        EXPECT_EQ(pp.state(), RespondParser::State::kFail) << text;
+    }
+}
+
+}
+}
+}
+}
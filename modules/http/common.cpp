@@ -19,6 +19,7 @@
  */
 #include "common.h"
 #include <algorithm>
+#include <cstdint>
 #include <tbox/base/defines.h>
 
 namespace tbox {
@@ -107,6 +108,7 @@ Method StringToMethod(const std::string &str)
 namespace {
 using StatusCodePair = std::pair<StatusCode, std::string>;
 StatusCodePair _status_code_map[] = {
+    { StatusCode::k101_SwitchingProtocols, "101 Switching Protocols"},
     { StatusCode::k200_OK, "200 OK"},
     { StatusCode::k201_Created, "201 Created"},
     { StatusCode::k202_Accepted, "202 Accepted"},
@@ -139,6 +141,7 @@ StatusCodePair _status_code_map[] = {
     { StatusCode::k415_UnsupportedMediaType, "415 Unsupported Media Type"},
     { StatusCode::k416_RequestedRangeNotSatisfiable, "416 Requested Range Not Satisfiable"},
     { StatusCode::k417_ExpectationFailed, "417 Expectation Failed"},
+    { StatusCode::k426_UpgradeRequired, "426 Upgrade Required"},
     { StatusCode::k500_InternalServerError, "500 Internal Server Error"},
     { StatusCode::k501_NotImplemented, "501 Not Implemented"},
     { StatusCode::k502_BadGateway, "502 Bad Gateway"},
@@ -162,6 +165,49 @@ std::string StatusCodeToString(StatusCode code)
         return "";
 }
 
+namespace {
+//! 状态行表，在第一次使用时生成
+class StatusLineTable {
+  public:
+    StatusLineTable() {
+        for (auto &index : index_)
+            index = -1;
+
+        for (size_t i = 0; i < NUMBER_OF_ARRAY(_status_code_map); ++i) {
+            auto &item = _status_code_map[i];
+            index_[static_cast<size_t>(item.first)] = i;
+            for (size_t ver = 0; ver < kVerNum; ++ver) {
+                auto ver_str = HttpVerToString(static_cast<HttpVer>(ver));
+                if (!ver_str.empty())
+                    lines_[ver][i] = ver_str + " " + item.second + CRLF;
+            }
+        }
+    }
+
+    const std::string& get(HttpVer ver, StatusCode code) const {
+        auto ver_index = static_cast<size_t>(ver);
+        auto code_index = static_cast<size_t>(code);
+        if (ver_index >= kVerNum || code_index >= kCodeNum || index_[code_index] < 0)
+            return empty_;
+        return lines_[ver_index][index_[code_index]];
+    }
+
+  private:
+    static constexpr size_t kVerNum = static_cast<size_t>(HttpVer::kMax);
+    static constexpr size_t kCodeNum = static_cast<size_t>(StatusCode::kMax);
+
+    int8_t index_[kCodeNum];    //!< 状态码在 _status_code_map 中的位置
+    std::string lines_[kVerNum][NUMBER_OF_ARRAY(_status_code_map)];
+    std::string empty_;
+};
+}
+
+const std::string& StatusLine(HttpVer ver, StatusCode code)
+{
+    static const StatusLineTable table;
+    return table.get(ver, code);
+}
+
 StatusCode StringToStatusCode(const std::string &str)
 {
     auto table_begin = _status_code_map;
@@ -21,15 +21,14 @@
 #define TBOX_HTTP_COMMON_H_20220501
 
 #include <string>
-#include <map>
+
+#include "headers.h"
 
 #define CRLF "\r\n"
 
 namespace tbox {
 namespace http {
 
-using Headers = std::map<std::string, std::string>;
-
 enum class HttpVer {
     kUnset,
     k1_0,  //!< http 1.0
@@ -61,6 +60,9 @@ Method      StringToMethod(const std::string &str);
 enum class StatusCode {
     kUnset,
 
+    //! 协议切换
+    k101_SwitchingProtocols = 101,
+
     //! 正常
     k200_OK = 200,
     k201_Created = 201,
@@ -98,6 +100,7 @@ enum class StatusCode {
     k415_UnsupportedMediaType = 415,
     k416_RequestedRangeNotSatisfiable = 416,
     k417_ExpectationFailed = 417,
+    k426_UpgradeRequired = 426,
 
     //! 服务端出错
     k500_InternalServerError = 500,
@@ -113,6 +116,9 @@ enum class StatusCode {
 std::string StatusCodeToString(StatusCode ver);
 StatusCode  StringToStatusCode(const std::string &str);
 
+//! 获取状态行，如 "HTTP/1.1 200 OK\r\n"。各状态行预先生成，无需拼接；未知的返回空串
+const std::string& StatusLine(HttpVer ver, StatusCode code);
+
 }
 }
 
@@ -51,6 +51,16 @@ TEST(common, StateCodeToStream)
     EXPECT_EQ(StatusCodeToString(StatusCode::k505_HTTPVersionNotSupported), "505 HTTP Version Not Supported");
 }
 
+TEST(common, StatusLine)
+{
+    EXPECT_EQ(StatusLine(HttpVer::k1_1, StatusCode::k200_OK), "HTTP/1.1 200 OK\r\n");
+    EXPECT_EQ(StatusLine(HttpVer::k1_0, StatusCode::k404_NotFound), "HTTP/1.0 404 Not Found\r\n");
+    EXPECT_EQ(StatusLine(HttpVer::k1_1, StatusCode::k505_HTTPVersionNotSupported), "HTTP/1.1 505 HTTP Version Not Supported\r\n");
+    EXPECT_EQ(StatusLine(HttpVer::kUnset, StatusCode::k200_OK), "");
+    EXPECT_EQ(StatusLine(HttpVer::k1_1, StatusCode::kUnset), "");
+    EXPECT_EQ(StatusLine(HttpVer::k1_1, static_cast<StatusCode>(299)), "");
+}
+
 }
 }
 }
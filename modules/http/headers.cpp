@@ -0,0 +1,208 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "headers.h"
+
+#include <strings.h>
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace http {
+
+namespace {
+
+struct HeaderName {
+    HeaderId id;
+    const char *name;
+    size_t len;
+};
+
+#define HEADER_NAME(id, name) { HeaderId::id, name, sizeof(name) - 1 }
+
+//! 顺序与 HeaderId 一致
+const HeaderName _header_names[] = {
+    HEADER_NAME(kUnknown, ""),
+    HEADER_NAME(kAccept, "Accept"),
+    HEADER_NAME(kAcceptEncoding, "Accept-Encoding"),
+    HEADER_NAME(kAcceptLanguage, "Accept-Language"),
+    HEADER_NAME(kAcceptRanges, "Accept-Ranges"),
+    HEADER_NAME(kAuthorization, "Authorization"),
+    HEADER_NAME(kCacheControl, "Cache-Control"),
+    HEADER_NAME(kConnection, "Connection"),
+    HEADER_NAME(kContentEncoding, "Content-Encoding"),
+    HEADER_NAME(kContentLength, "Content-Length"),
+    HEADER_NAME(kContentRange, "Content-Range"),
+    HEADER_NAME(kContentType, "Content-Type"),
+    HEADER_NAME(kCookie, "Cookie"),
+    HEADER_NAME(kDate, "Date"),
+    HEADER_NAME(kETag, "ETag"),
+    HEADER_NAME(kExpect, "Expect"),
+    HEADER_NAME(kHost, "Host"),
+    HEADER_NAME(kIfModifiedSince, "If-Modified-Since"),
+    HEADER_NAME(kIfNoneMatch, "If-None-Match"),
+    HEADER_NAME(kIfRange, "If-Range"),
+    HEADER_NAME(kKeepAlive, "Keep-Alive"),
+    HEADER_NAME(kLastModified, "Last-Modified"),
+    HEADER_NAME(kLocation, "Location"),
+    HEADER_NAME(kRange, "Range"),
+    HEADER_NAME(kReferer, "Referer"),
+    HEADER_NAME(kServer, "Server"),
+    HEADER_NAME(kSetCookie, "Set-Cookie"),
+    HEADER_NAME(kTransferEncoding, "Transfer-Encoding"),
+    HEADER_NAME(kUpgrade, "Upgrade"),
+    HEADER_NAME(kUserAgent, "User-Agent"),
+};
+
+#undef HEADER_NAME
+
+static_assert(NUMBER_OF_ARRAY(_header_names) == static_cast<size_t>(HeaderId::kMax), "_header_names size error");
+
+constexpr size_t kInitCapacity = 16;
+
+}
+
+HeaderId ToHeaderId(const char *name, size_t name_len)
+{
+    if (name_len == 0)
+        return HeaderId::kUnknown;
+
+    //! 先比较长度与首字母，大部分不匹配的项在这里就被排除了
+    char first = name[0] | 0x20;
+    for (size_t i = 1; i < NUMBER_OF_ARRAY(_header_names); ++i) {
+        auto &item = _header_names[i];
+        if (item.len == name_len && (item.name[0] | 0x20) == first &&
+            ::strncasecmp(item.name, name, name_len) == 0)
+            return item.id;
+    }
+    return HeaderId::kUnknown;
+}
+
+const char* HeaderIdToString(HeaderId id)
+{
+    auto index = static_cast<size_t>(id);
+    if (index < NUMBER_OF_ARRAY(_header_names))
+        return _header_names[index].name;
+    return "";
+}
+
+Headers::iterator Headers::findByName(const char *name, size_t name_len, HeaderId id)
+{
+    if (id != HeaderId::kUnknown)
+        return find(id);
+
+    for (auto iter = fields_.begin(); iter != fields_.end(); ++iter) {
+        if (iter->id == HeaderId::kUnknown && iter->first.size() == name_len &&
+            ::strncasecmp(iter->first.data(), name, name_len) == 0)
+            return iter;
+    }
+    return fields_.end();
+}
+
+Headers::iterator Headers::find(const std::string &name)
+{
+    return findByName(name.data(), name.size(), ToHeaderId(name));
+}
+
+Headers::const_iterator Headers::find(const std::string &name) const
+{
+    return const_cast<Headers*>(this)->find(name);
+}
+
+Headers::iterator Headers::find(HeaderId id)
+{
+    for (auto iter = fields_.begin(); iter != fields_.end(); ++iter) {
+        if (iter->id == id)
+            return iter;
+    }
+    return fields_.end();
+}
+
+Headers::const_iterator Headers::find(HeaderId id) const
+{
+    return const_cast<Headers*>(this)->find(id);
+}
+
+const std::string* Headers::get(const std::string &name) const
+{
+    auto iter = find(name);
+    return iter != end() ? &iter->second : nullptr;
+}
+
+const std::string* Headers::get(HeaderId id) const
+{
+    auto iter = find(id);
+    return iter != end() ? &iter->second : nullptr;
+}
+
+std::string& Headers::operator [] (const std::string &name)
+{
+    auto id = ToHeaderId(name);
+    auto iter = findByName(name.data(), name.size(), id);
+    if (iter == fields_.end())
+        iter = append(std::string(name), std::string(), id);
+    return iter->second;
+}
+
+std::string& Headers::operator [] (HeaderId id)
+{
+    auto iter = find(id);
+    if (iter == fields_.end())
+        iter = append(HeaderIdToString(id), std::string(), id);
+    return iter->second;
+}
+
+HeaderId Headers::set(const char *name, size_t name_len, const char *value, size_t value_len)
+{
+    auto id = ToHeaderId(name, name_len);
+    auto iter = findByName(name, name_len, id);
+    if (iter == fields_.end())
+        append(std::string(name, name_len), std::string(value, value_len), id);
+    else
+        iter->second.assign(value, value_len);
+    return id;
+}
+
+size_t Headers::erase(const std::string &name)
+{
+    auto iter = find(name);
+    if (iter == fields_.end())
+        return 0;
+    fields_.erase(iter);
+    return 1;
+}
+
+size_t Headers::erase(HeaderId id)
+{
+    auto iter = find(id);
+    if (iter == fields_.end())
+        return 0;
+    fields_.erase(iter);
+    return 1;
+}
+
+Headers::iterator Headers::append(std::string &&name, std::string &&value, HeaderId id)
+{
+    if (fields_.capacity() == 0)
+        fields_.reserve(kInitCapacity);
+    fields_.emplace_back(std::move(name), std::move(value), id);
+    return fields_.end() - 1;
+}
+
+}
+}
@@ -0,0 +1,136 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_HEADERS_H_20251019
+#define TBOX_HTTP_HEADERS_H_20251019
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace tbox {
+namespace http {
+
+//! 常用的Header，解析时识别出来，查找时只需比较ID
+enum class HeaderId : uint8_t {
+    kUnknown,
+    kAccept,
+    kAcceptEncoding,
+    kAcceptLanguage,
+    kAcceptRanges,
+    kAuthorization,
+    kCacheControl,
+    kConnection,
+    kContentEncoding,
+    kContentLength,
+    kContentRange,
+    kContentType,
+    kCookie,
+    kDate,
+    kETag,
+    kExpect,
+    kHost,
+    kIfModifiedSince,
+    kIfNoneMatch,
+    kIfRange,
+    kKeepAlive,
+    kLastModified,
+    kLocation,
+    kRange,
+    kReferer,
+    kServer,
+    kSetCookie,
+    kTransferEncoding,
+    kUpgrade,
+    kUserAgent,
+    kMax
+};
+
+//! 由名称获取ID，不区分大小写，不是常用Header时返回 kUnknown
+HeaderId ToHeaderId(const char *name, size_t name_len);
+inline HeaderId ToHeaderId(const std::string &name) { return ToHeaderId(name.data(), name.size()); }
+//! 获取ID对应的标准名称，如 "Content-Length"
+const char* HeaderIdToString(HeaderId id);
+
+/**
+ * Http头部容器
+ *
+ * 按插入顺序存放在连续的 vector 中，查找时名称不区分大小写。
+ * 常用的Header在插入时就识别出ID，查找时只需比较ID。
+ * Header 通常只有十几个，顺序查找比 std::map 的树查找更快，也省去了节点的内存分配
+ *
+ * 接口与 std::map<std::string, std::string> 保持兼容，元素的 first 为名称，second 为值
+ */
+class Headers {
+  public:
+    struct Field : public std::pair<std::string, std::string> {
+        HeaderId id = HeaderId::kUnknown;
+
+        Field(std::string &&name, std::string &&value, HeaderId id_) :
+            std::pair<std::string, std::string>(std::move(name), std::move(value)), id(id_) { }
+    };
+
+    using Fields = std::vector<Field>;
+    using iterator = Fields::iterator;
+    using const_iterator = Fields::const_iterator;
+
+  public:
+    iterator begin() { return fields_.begin(); }
+    iterator end() { return fields_.end(); }
+    const_iterator begin() const { return fields_.begin(); }
+    const_iterator end() const { return fields_.end(); }
+
+    size_t size() const { return fields_.size(); }
+    bool empty() const { return fields_.empty(); }
+    void clear() { fields_.clear(); }
+
+    iterator find(const std::string &name);
+    const_iterator find(const std::string &name) const;
+    iterator find(HeaderId id);
+    const_iterator find(HeaderId id) const;
+
+    size_t count(const std::string &name) const { return find(name) != end() ? 1 : 0; }
+    size_t count(HeaderId id) const { return find(id) != end() ? 1 : 0; }
+
+    //! 获取值，没有时返回 nullptr
+    const std::string* get(const std::string &name) const;
+    const std::string* get(HeaderId id) const;
+
+    //! 获取值的引用，没有时插入一个空值
+    std::string& operator [] (const std::string &name);
+    std::string& operator [] (HeaderId id);
+
+    //! 设置值，已存在则替换，返回其ID。供解析器使用，无需先构造 std::string
+    HeaderId set(const char *name, size_t name_len, const char *value, size_t value_len);
+
+    size_t erase(const std::string &name);
+    size_t erase(HeaderId id);
+
+  private:
+    iterator findByName(const char *name, size_t name_len, HeaderId id);
+    iterator append(std::string &&name, std::string &&value, HeaderId id);
+
+    Fields fields_;
+};
+
+}
+}
+
+#endif //TBOX_HTTP_HEADERS_H_20251019
@@ -0,0 +1,143 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <cstring>
+#include "headers.h"
+
+namespace tbox {
+namespace http {
+namespace {
+
+TEST(Headers, HeaderId)
+{
+    EXPECT_EQ(ToHeaderId("Content-Length"), HeaderId::kContentLength);
+    EXPECT_EQ(ToHeaderId("content-length"), HeaderId::kContentLength);
+    EXPECT_EQ(ToHeaderId("CONNECTION"), HeaderId::kConnection);
+    EXPECT_EQ(ToHeaderId("X-Custom"), HeaderId::kUnknown);
+    EXPECT_EQ(ToHeaderId(""), HeaderId::kUnknown);
+    EXPECT_STREQ(HeaderIdToString(HeaderId::kETag), "ETag");
+    EXPECT_STREQ(HeaderIdToString(HeaderId::kMax), "");
+
+    for (int i = 1; i < static_cast<int>(HeaderId::kMax); ++i) {
+        auto id = static_cast<HeaderId>(i);
+        EXPECT_EQ(ToHeaderId(HeaderIdToString(id)), id);
+    }
+}
+
+TEST(Headers, FindCaseInsensitive)
+{
+    Headers headers;
+    headers["Content-Type"] = "text/plain";
+    headers["X-Request-Id"] = "123";
+
+    EXPECT_EQ(headers.size(), 2u);
+    EXPECT_EQ(headers["content-type"], "text/plain");
+    EXPECT_EQ(headers[HeaderId::kContentType], "text/plain");
+    EXPECT_EQ(headers["x-request-id"], "123");
+    EXPECT_EQ(headers.size(), 2u);
+
+    EXPECT_NE(headers.find("X-REQUEST-ID"), headers.end());
+    EXPECT_EQ(headers.find("X-Request"), headers.end());
+    EXPECT_EQ(headers.count("Connection"), 0u);
+    EXPECT_EQ(headers.get("Connection"), nullptr);
+    ASSERT_NE(headers.get(HeaderId::kContentType), nullptr);
+    EXPECT_EQ(*headers.get(HeaderId::kContentType), "text/plain");
+}
+
+TEST(Headers, SetAndErase)
+{
+    Headers headers;
+    EXPECT_EQ(headers.set("connection", 10, "close", 5), HeaderId::kConnection);
+    EXPECT_EQ(headers.set("X-A", 3, "1", 1), HeaderId::kUnknown);
+    EXPECT_EQ(headers.set("Connection", 10, "keep-alive", 10), HeaderId::kConnection);
+    EXPECT_EQ(headers.set("x-a", 3, "2", 1), HeaderId::kUnknown);
+
+    ASSERT_EQ(headers.size(), 2u);
+    //! 保留第一次出现时的名称与顺序
+    auto iter = headers.begin();
+    EXPECT_EQ(iter->first, "connection");
+    EXPECT_EQ(iter->second, "keep-alive");
+    ++iter;
+    EXPECT_EQ(iter->first, "X-A");
+    EXPECT_EQ(iter->second, "2");
+
+    EXPECT_EQ(headers.erase("CONNECTION"), 1u);
+    EXPECT_EQ(headers.erase(HeaderId::kConnection), 0u);
+    EXPECT_EQ(headers.erase("x-a"), 1u);
+    EXPECT_TRUE(headers.empty());
+
+    headers[HeaderId::kDate] = "now";
+    EXPECT_EQ(headers.begin()->first, "Date");
+}
+
+/**
+ * 模拟解析一个有14个Header的请求，再查找其中几个
+ * 对比 std::map<std::string, std::string>
+ */
+TEST(Headers, Benchmark)
+{
+    const char *fields[][2] = {
+        {"Host", "192.168.0.15:55555"},
+        {"User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0"},
+        {"Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8"},
+        {"Accept-Language", "zh-CN,zh;q=0.8,en-US;q=0.3,en;q=0.2"},
+        {"Accept-Encoding", "gzip, deflate"},
+        {"Connection", "keep-alive"},
+        {"Referer", "http://192.168.0.15:55555/"},
+        {"Cookie", "session=8f2a9c7e41d04b6a; theme=dark"},
+        {"Upgrade-Insecure-Requests", "1"},
+        {"If-None-Match", "\"65a1b2c3-1f40\""},
+        {"If-Modified-Since", "Fri, 12 Jan 2024 08:00:00 GMT"},
+        {"Cache-Control", "max-age=0"},
+        {"DNT", "1"},
+        {"X-Request-Id", "42"},
+    };
+    const int kTimes = 100000;
+    size_t check_sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i) {
+        std::map<std::string, std::string> headers;
+        for (auto &field : fields)
+            headers[std::string(field[0], ::strlen(field[0]))].assign(field[1], ::strlen(field[1]));
+        check_sum += headers.count("Connection") + headers.count("Content-Length") + headers.count("If-None-Match");
+    }
+    auto map_cost = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i) {
+        Headers headers;
+        for (auto &field : fields)
+            headers.set(field[0], ::strlen(field[0]), field[1], ::strlen(field[1]));
+        check_sum -= headers.count(HeaderId::kConnection) + headers.count(HeaderId::kContentLength) + headers.count(HeaderId::kIfNoneMatch);
+    }
+    auto headers_cost = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(check_sum, 0u);
+    std::cout << "std::map: " << std::chrono::duration_cast<std::chrono::nanoseconds>(map_cost).count() / kTimes << " ns/req" << std::endl
+              << "Headers : " << std::chrono::duration_cast<std::chrono::nanoseconds>(headers_cost).count() / kTimes << " ns/req" << std::endl;
+}
+
+}
+}
+}
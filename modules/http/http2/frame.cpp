@@ -0,0 +1,58 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "frame.h"
+
+namespace tbox {
+namespace http {
+namespace http2 {
+
+const char kClientPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+void ParseFrameHead(const uint8_t *data_ptr, FrameHead &head)
+{
+    head.length = (static_cast<uint32_t>(data_ptr[0]) << 16) | (static_cast<uint32_t>(data_ptr[1]) << 8) | data_ptr[2];
+    head.type = static_cast<FrameType>(data_ptr[3]);
+    head.flags = data_ptr[4];
+    head.stream_id = ReadUint32(data_ptr + 5) & 0x7fffffff;
+}
+
+void WriteFrameHead(uint8_t *buff, uint32_t length, FrameType type, uint8_t flags, uint32_t stream_id)
+{
+    buff[0] = static_cast<uint8_t>(length >> 16);
+    buff[1] = static_cast<uint8_t>(length >> 8);
+    buff[2] = static_cast<uint8_t>(length);
+    buff[3] = static_cast<uint8_t>(type);
+    buff[4] = flags;
+    buff[5] = static_cast<uint8_t>(stream_id >> 24) & 0x7f;
+    buff[6] = static_cast<uint8_t>(stream_id >> 16);
+    buff[7] = static_cast<uint8_t>(stream_id >> 8);
+    buff[8] = static_cast<uint8_t>(stream_id);
+}
+
+void AppendFrameHead(std::string &out, uint32_t length, FrameType type, uint8_t flags, uint32_t stream_id)
+{
+    uint8_t buff[kFrameHeadSize];
+    WriteFrameHead(buff, length, type, flags, stream_id);
+    out.append(reinterpret_cast<const char*>(buff), kFrameHeadSize);
+}
+
+}
+}
+}
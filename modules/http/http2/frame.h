@@ -0,0 +1,121 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_HTTP2_FRAME_H_20251019
+#define TBOX_HTTP_HTTP2_FRAME_H_20251019
+
+#include <string>
+#include <cstdint>
+
+namespace tbox {
+namespace http {
+namespace http2 {
+
+//! 客户端连接序言 "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+extern const char kClientPreface[];
+constexpr size_t kClientPrefaceSize = 24;
+
+constexpr size_t kFrameHeadSize = 9;
+constexpr uint32_t kDefaultWindowSize = 65535;
+constexpr uint32_t kMaxWindowSize = 0x7fffffff;
+constexpr uint32_t kDefaultMaxFrameSize = 16384;
+constexpr uint32_t kMaxMaxFrameSize = 0xffffff;
+
+//! 帧类型
+enum class FrameType : uint8_t {
+    kData = 0,
+    kHeaders = 1,
+    kPriority = 2,
+    kRstStream = 3,
+    kSettings = 4,
+    kPushPromise = 5,
+    kPing = 6,
+    kGoaway = 7,
+    kWindowUpdate = 8,
+    kContinuation = 9,
+};
+
+//! 帧标志
+constexpr uint8_t kFlagEndStream  = 0x01;
+constexpr uint8_t kFlagAck        = 0x01;
+constexpr uint8_t kFlagEndHeaders = 0x04;
+constexpr uint8_t kFlagPadded     = 0x08;
+constexpr uint8_t kFlagPriority   = 0x20;
+
+//! SETTINGS 参数
+enum class SettingId : uint16_t {
+    kHeaderTableSize = 1,
+    kEnablePush = 2,
+    kMaxConcurrentStreams = 3,
+    kInitialWindowSize = 4,
+    kMaxFrameSize = 5,
+    kMaxHeaderListSize = 6,
+};
+
+//! 错误码，用于 RST_STREAM 与 GOAWAY
+enum class ErrorCode : uint32_t {
+    kNoError = 0x0,
+    kProtocolError = 0x1,
+    kInternalError = 0x2,
+    kFlowControlError = 0x3,
+    kSettingsTimeout = 0x4,
+    kStreamClosed = 0x5,
+    kFrameSizeError = 0x6,
+    kRefusedStream = 0x7,
+    kCancel = 0x8,
+    kCompressionError = 0x9,
+    kConnectError = 0xa,
+    kEnhanceYourCalm = 0xb,
+    kInadequateSecurity = 0xc,
+    kHttp11Required = 0xd,
+};
+
+//! 帧头
+struct FrameHead {
+    uint32_t length = 0;    //!< 负载长度，24位
+    FrameType type = FrameType::kData;
+    uint8_t flags = 0;
+    uint32_t stream_id = 0; //!< 31位，最高位保留
+};
+
+//! 从 kFrameHeadSize 个字节中解析帧头
+void ParseFrameHead(const uint8_t *data_ptr, FrameHead &head);
+//! 将帧头写入 kFrameHeadSize 个字节的缓冲
+void WriteFrameHead(uint8_t *buff, uint32_t length, FrameType type, uint8_t flags, uint32_t stream_id);
+//! 将帧头追加到 out
+void AppendFrameHead(std::string &out, uint32_t length, FrameType type, uint8_t flags, uint32_t stream_id);
+
+inline uint32_t ReadUint32(const uint8_t *p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline void AppendUint32(std::string &out, uint32_t value) {
+    char buff[4] = {
+        static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+        static_cast<char>(value >> 8), static_cast<char>(value)
+    };
+    out.append(buff, 4);
+}
+
+}
+}
+}
+
+#endif //TBOX_HTTP_HTTP2_FRAME_H_20251019
@@ -0,0 +1,587 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "hpack.h"
+
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+namespace tbox {
+namespace http {
+namespace http2 {
+
+namespace {
+
+const HeaderField kStaticTable[HpackTable::kStaticSize] = {
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+};
+
+constexpr size_t kEntryOverhead = 32;
+
+struct HuffmanCode {
+    uint32_t code;
+    uint8_t  bits;
+};
+
+//! 各字符的 Huffman 编码，最后一项为 EOS
+const HuffmanCode kHuffmanCodes[257] = {
+    {0x00001ff8, 13}, {0x007fffd8, 23}, {0x0fffffe2, 28}, {0x0fffffe3, 28},
+    {0x0fffffe4, 28}, {0x0fffffe5, 28}, {0x0fffffe6, 28}, {0x0fffffe7, 28},
+    {0x0fffffe8, 28}, {0x00ffffea, 24}, {0x3ffffffc, 30}, {0x0fffffe9, 28},
+    {0x0fffffea, 28}, {0x3ffffffd, 30}, {0x0fffffeb, 28}, {0x0fffffec, 28},
+    {0x0fffffed, 28}, {0x0fffffee, 28}, {0x0fffffef, 28}, {0x0ffffff0, 28},
+    {0x0ffffff1, 28}, {0x0ffffff2, 28}, {0x3ffffffe, 30}, {0x0ffffff3, 28},
+    {0x0ffffff4, 28}, {0x0ffffff5, 28}, {0x0ffffff6, 28}, {0x0ffffff7, 28},
+    {0x0ffffff8, 28}, {0x0ffffff9, 28}, {0x0ffffffa, 28}, {0x0ffffffb, 28},
+    {0x00000014,  6}, {0x000003f8, 10}, {0x000003f9, 10}, {0x00000ffa, 12},
+    {0x00001ff9, 13}, {0x00000015,  6}, {0x000000f8,  8}, {0x000007fa, 11},
+    {0x000003fa, 10}, {0x000003fb, 10}, {0x000000f9,  8}, {0x000007fb, 11},
+    {0x000000fa,  8}, {0x00000016,  6}, {0x00000017,  6}, {0x00000018,  6},
+    {0x00000000,  5}, {0x00000001,  5}, {0x00000002,  5}, {0x00000019,  6},
+    {0x0000001a,  6}, {0x0000001b,  6}, {0x0000001c,  6}, {0x0000001d,  6},
+    {0x0000001e,  6}, {0x0000001f,  6}, {0x0000005c,  7}, {0x000000fb,  8},
+    {0x00007ffc, 15}, {0x00000020,  6}, {0x00000ffb, 12}, {0x000003fc, 10},
+    {0x00001ffa, 13}, {0x00000021,  6}, {0x0000005d,  7}, {0x0000005e,  7},
+    {0x0000005f,  7}, {0x00000060,  7}, {0x00000061,  7}, {0x00000062,  7},
+    {0x00000063,  7}, {0x00000064,  7}, {0x00000065,  7}, {0x00000066,  7},
+    {0x00000067,  7}, {0x00000068,  7}, {0x00000069,  7}, {0x0000006a,  7},
+    {0x0000006b,  7}, {0x0000006c,  7}, {0x0000006d,  7}, {0x0000006e,  7},
+    {0x0000006f,  7}, {0x00000070,  7}, {0x00000071,  7}, {0x00000072,  7},
+    {0x000000fc,  8}, {0x00000073,  7}, {0x000000fd,  8}, {0x00001ffb, 13},
+    {0x0007fff0, 19}, {0x00001ffc, 13}, {0x00003ffc, 14}, {0x00000022,  6},
+    {0x00007ffd, 15}, {0x00000003,  5}, {0x00000023,  6}, {0x00000004,  5},
+    {0x00000024,  6}, {0x00000005,  5}, {0x00000025,  6}, {0x00000026,  6},
+    {0x00000027,  6}, {0x00000006,  5}, {0x00000074,  7}, {0x00000075,  7},
+    {0x00000028,  6}, {0x00000029,  6}, {0x0000002a,  6}, {0x00000007,  5},
+    {0x0000002b,  6}, {0x00000076,  7}, {0x0000002c,  6}, {0x00000008,  5},
+    {0x00000009,  5}, {0x0000002d,  6}, {0x00000077,  7}, {0x00000078,  7},
+    {0x00000079,  7}, {0x0000007a,  7}, {0x0000007b,  7}, {0x00007ffe, 15},
+    {0x000007fc, 11}, {0x00003ffd, 14}, {0x00001ffd, 13}, {0x0ffffffc, 28},
+    {0x000fffe6, 20}, {0x003fffd2, 22}, {0x000fffe7, 20}, {0x000fffe8, 20},
+    {0x003fffd3, 22}, {0x003fffd4, 22}, {0x003fffd5, 22}, {0x007fffd9, 23},
+    {0x003fffd6, 22}, {0x007fffda, 23}, {0x007fffdb, 23}, {0x007fffdc, 23},
+    {0x007fffdd, 23}, {0x007fffde, 23}, {0x00ffffeb, 24}, {0x007fffdf, 23},
+    {0x00ffffec, 24}, {0x00ffffed, 24}, {0x003fffd7, 22}, {0x007fffe0, 23},
+    {0x00ffffee, 24}, {0x007fffe1, 23}, {0x007fffe2, 23}, {0x007fffe3, 23},
+    {0x007fffe4, 23}, {0x001fffdc, 21}, {0x003fffd8, 22}, {0x007fffe5, 23},
+    {0x003fffd9, 22}, {0x007fffe6, 23}, {0x007fffe7, 23}, {0x00ffffef, 24},
+    {0x003fffda, 22}, {0x001fffdd, 21}, {0x000fffe9, 20}, {0x003fffdb, 22},
+    {0x003fffdc, 22}, {0x007fffe8, 23}, {0x007fffe9, 23}, {0x001fffde, 21},
+    {0x007fffea, 23}, {0x003fffdd, 22}, {0x003fffde, 22}, {0x00fffff0, 24},
+    {0x001fffdf, 21}, {0x003fffdf, 22}, {0x007fffeb, 23}, {0x007fffec, 23},
+    {0x001fffe0, 21}, {0x001fffe1, 21}, {0x003fffe0, 22}, {0x001fffe2, 21},
+    {0x007fffed, 23}, {0x003fffe1, 22}, {0x007fffee, 23}, {0x007fffef, 23},
+    {0x000fffea, 20}, {0x003fffe2, 22}, {0x003fffe3, 22}, {0x003fffe4, 22},
+    {0x007ffff0, 23}, {0x003fffe5, 22}, {0x003fffe6, 22}, {0x007ffff1, 23},
+    {0x03ffffe0, 26}, {0x03ffffe1, 26}, {0x000fffeb, 20}, {0x0007fff1, 19},
+    {0x003fffe7, 22}, {0x007ffff2, 23}, {0x003fffe8, 22}, {0x01ffffec, 25},
+    {0x03ffffe2, 26}, {0x03ffffe3, 26}, {0x03ffffe4, 26}, {0x07ffffde, 27},
+    {0x07ffffdf, 27}, {0x03ffffe5, 26}, {0x00fffff1, 24}, {0x01ffffed, 25},
+    {0x0007fff2, 19}, {0x001fffe3, 21}, {0x03ffffe6, 26}, {0x07ffffe0, 27},
+    {0x07ffffe1, 27}, {0x03ffffe7, 26}, {0x07ffffe2, 27}, {0x00fffff2, 24},
+    {0x001fffe4, 21}, {0x001fffe5, 21}, {0x03ffffe8, 26}, {0x03ffffe9, 26},
+    {0x0ffffffd, 28}, {0x07ffffe3, 27}, {0x07ffffe4, 27}, {0x07ffffe5, 27},
+    {0x000fffec, 20}, {0x00fffff3, 24}, {0x000fffed, 20}, {0x001fffe6, 21},
+    {0x003fffe9, 22}, {0x001fffe7, 21}, {0x001fffe8, 21}, {0x007ffff3, 23},
+    {0x003fffea, 22}, {0x003fffeb, 22}, {0x01ffffee, 25}, {0x01ffffef, 25},
+    {0x00fffff4, 24}, {0x00fffff5, 24}, {0x03ffffea, 26}, {0x007ffff4, 23},
+    {0x03ffffeb, 26}, {0x07ffffe6, 27}, {0x03ffffec, 26}, {0x03ffffed, 26},
+    {0x07ffffe7, 27}, {0x07ffffe8, 27}, {0x07ffffe9, 27}, {0x07ffffea, 27},
+    {0x07ffffeb, 27}, {0x0ffffffe, 28}, {0x07ffffec, 27}, {0x07ffffed, 27},
+    {0x07ffffee, 27}, {0x07ffffef, 27}, {0x07fffff0, 27}, {0x03ffffee, 26},
+    {0x3fffffff, 30},
+};
+
+//! 按码长、码值排序的字符。HPACK 的 Huffman 编码是规范的，同一码长的码值连续
+const uint16_t kHuffmanSymbols[257] = {
+     48,  49,  50,  97,  99, 101, 105, 111, 115, 116,  32,  37,  45,  46,  47,  51,
+     52,  53,  54,  55,  56,  57,  61,  65,  95,  98, 100, 102, 103, 104, 108, 109,
+    110, 112, 114, 117,  58,  66,  67,  68,  69,  70,  71,  72,  73,  74,  75,  76,
+     77,  78,  79,  80,  81,  82,  83,  84,  85,  86,  87,  89, 106, 107, 113, 118,
+    119, 120, 121, 122,  38,  42,  44,  59,  88,  90,  33,  34,  40,  41,  63,  39,
+     43, 124,  35,  62,   0,  36,  64,  91,  93, 126,  94, 125,  60,  96, 123,  92,
+    195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161, 167, 172, 176, 177,
+    179, 209, 216, 217, 227, 229, 230, 129, 132, 133, 134, 136, 146, 154, 156, 160,
+    163, 164, 169, 170, 173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+    233,   1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155, 157,
+    158, 165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231, 239,   9, 142,
+    144, 145, 148, 159, 171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+    200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243, 255, 203, 204, 211,
+    212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248, 250, 251, 252, 253, 254,
+      2,   3,   4,   5,   6,   7,   8,  11,  12,  14,  15,  16,  17,  18,  19,  20,
+     21,  23,  24,  25,  26,  27,  28,  29,  30,  31, 127, 220, 249,  10,  13,  22,
+    256,
+};
+
+//! 每种码长的首个码值、个数，以及在 kHuffmanSymbols 中的起始位置
+struct HuffmanGroup {
+    uint8_t  bits;
+    uint32_t first_code;
+    uint16_t count;
+    uint16_t offset;
+};
+
+const HuffmanGroup kHuffmanGroups[] = {
+    { 5, 0x00000000, 10,   0},
+    { 6, 0x00000014, 26,  10},
+    { 7, 0x0000005c, 32,  36},
+    { 8, 0x000000f8,  6,  68},
+    {10, 0x000003f8,  5,  74},
+    {11, 0x000007fa,  3,  79},
+    {12, 0x00000ffa,  2,  82},
+    {13, 0x00001ff8,  6,  84},
+    {14, 0x00003ffc,  2,  90},
+    {15, 0x00007ffc,  3,  92},
+    {19, 0x0007fff0,  3,  95},
+    {20, 0x000fffe6,  8,  98},
+    {21, 0x001fffdc, 13, 106},
+    {22, 0x003fffd2, 26, 119},
+    {23, 0x007fffd8, 29, 145},
+    {24, 0x00ffffea, 12, 174},
+    {25, 0x01ffffec,  4, 186},
+    {26, 0x03ffffe0, 15, 190},
+    {27, 0x07ffffde, 19, 205},
+    {28, 0x0fffffe2, 29, 224},
+    {30, 0x3ffffffc,  4, 253},
+};
+
+inline bool IsNotIndexed(const char *name, size_t name_len)
+{
+    //! 每次都会变的值，加入动态表只会挤掉有用的项
+    static const char *names[] = {
+        "content-length", "content-range", "etag", "last-modified", "location",
+        "set-cookie", "cookie", "authorization", ":path",
+    };
+
+    for (auto item : names) {
+        if (::strlen(item) == name_len && ::memcmp(item, name, name_len) == 0)
+            return true;
+    }
+    return false;
+}
+
+void EncodeString(const char *data_ptr, size_t data_size, std::string &out)
+{
+    size_t huffman_len = HuffmanEncodedLength(data_ptr, data_size);
+    if (huffman_len < data_size) {
+        EncodeInteger(0x80, 7, huffman_len, out);
+        HuffmanEncode(data_ptr, data_size, out);
+    } else {
+        EncodeInteger(0x00, 7, data_size, out);
+        out.append(data_ptr, data_size);
+    }
+}
+
+bool DecodeString(const uint8_t *&pos, const uint8_t *end, std::string &str)
+{
+    if (pos >= end)
+        return false;
+
+    bool is_huffman = (*pos & 0x80) != 0;
+    uint64_t len = 0;
+    if (!DecodeInteger(pos, end, 7, len) || len > static_cast<uint64_t>(end - pos))
+        return false;
+
+    str.clear();
+    if (is_huffman) {
+        if (!HuffmanDecode(pos, len, str))
+            return false;
+    } else {
+        str.assign(reinterpret_cast<const char*>(pos), len);
+    }
+
+    pos += len;
+    return true;
+}
+
+}
+
+void EncodeInteger(uint8_t prefix, int prefix_bits, uint64_t value, std::string &out)
+{
+    uint64_t max_prefix = (1u << prefix_bits) - 1;
+    if (value < max_prefix) {
+        out.push_back(static_cast<char>(prefix | value));
+        return;
+    }
+
+    out.push_back(static_cast<char>(prefix | max_prefix));
+    value -= max_prefix;
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool DecodeInteger(const uint8_t *&pos, const uint8_t *end, int prefix_bits, uint64_t &value)
+{
+    if (pos >= end)
+        return false;
+
+    uint64_t max_prefix = (1u << prefix_bits) - 1;
+    value = *pos++ & max_prefix;
+    if (value < max_prefix)
+        return true;
+
+    //! 限制在32位内，防止溢出
+    for (int shift = 0; shift < 32; shift += 7) {
+        if (pos >= end)
+            return false;
+        uint8_t byte = *pos++;
+        value += static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+size_t HuffmanEncodedLength(const char *data_ptr, size_t data_size)
+{
+    size_t bits = 0;
+    for (size_t i = 0; i < data_size; ++i)
+        bits += kHuffmanCodes[static_cast<uint8_t>(data_ptr[i])].bits;
+    return (bits + 7) / 8;
+}
+
+void HuffmanEncode(const char *data_ptr, size_t data_size, std::string &out)
+{
+    uint64_t acc = 0;
+    int bits = 0;
+
+    for (size_t i = 0; i < data_size; ++i) {
+        auto &code = kHuffmanCodes[static_cast<uint8_t>(data_ptr[i])];
+        acc = (acc << code.bits) | code.code;
+        bits += code.bits;
+        while (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>(acc >> bits));
+        }
+    }
+
+    //! 用 EOS 的高位，即全1，补齐最后一个字节
+    if (bits > 0)
+        out.push_back(static_cast<char>((acc << (8 - bits)) | (0xff >> bits)));
+}
+
+bool HuffmanDecode(const uint8_t *data_ptr, size_t data_size, std::string &out)
+{
+    uint64_t acc = 0;   //!< 待解码的位，左对齐
+    int bits = 0;
+    size_t pos = 0;
+
+    for (;;) {
+        while (bits <= 56 && pos < data_size) {
+            acc |= static_cast<uint64_t>(data_ptr[pos++]) << (56 - bits);
+            bits += 8;
+        }
+
+        if (bits == 0)
+            return true;
+
+        const HuffmanGroup *group = nullptr;
+        for (auto &item : kHuffmanGroups) {
+            if (item.bits > bits)
+                break;
+            uint32_t code = static_cast<uint32_t>(acc >> (64 - item.bits));
+            if (code - item.first_code < item.count) {
+                group = &item;
+                break;
+            }
+        }
+
+        if (group == nullptr) {
+            //! 剩下的只能是不足8位的填充，且必须全是1
+            return pos == data_size && bits < 8 && (acc >> (64 - bits)) == ((1u << bits) - 1);
+        }
+
+        uint32_t code = static_cast<uint32_t>(acc >> (64 - group->bits));
+        uint16_t symbol = kHuffmanSymbols[group->offset + code - group->first_code];
+        if (symbol == 256)  //! 不允许出现 EOS
+            return false;
+
+        out.push_back(static_cast<char>(symbol));
+        acc <<= group->bits;
+        bits -= group->bits;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void HpackTable::setMaxSize(size_t max_size)
+{
+    max_size_ = max_size;
+    evict(max_size_);
+}
+
+const HeaderField* HpackTable::get(size_t index) const
+{
+    if (index == 0)
+        return nullptr;
+
+    if (index <= kStaticSize)
+        return &kStaticTable[index - 1];
+
+    index -= kStaticSize + 1;
+    if (index < entries_.size())
+        return &entries_[index];
+
+    return nullptr;
+}
+
+void HpackTable::add(const std::string &name, const std::string &value)
+{
+    size_t entry_size = name.size() + value.size() + kEntryOverhead;
+    if (entry_size > max_size_) {
+        evict(0);
+        return;
+    }
+
+    evict(max_size_ - entry_size);
+    entries_.push_front(HeaderField{name, value});
+    size_ += entry_size;
+}
+
+size_t HpackTable::find(const char *name, size_t name_len, const char *value, size_t value_len, size_t &name_index) const
+{
+    name_index = 0;
+
+    auto match = [&] (const HeaderField &field, size_t index) -> bool {
+        if (field.name.size() != name_len || ::memcmp(field.name.data(), name, name_len) != 0)
+            return false;
+        if (name_index == 0)
+            name_index = index;
+        return field.value.size() == value_len && ::memcmp(field.value.data(), value, value_len) == 0;
+    };
+
+    for (size_t i = 0; i < kStaticSize; ++i) {
+        if (match(kStaticTable[i], i + 1))
+            return i + 1;
+    }
+
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (match(entries_[i], i + kStaticSize + 1))
+            return i + kStaticSize + 1;
+    }
+
+    return 0;
+}
+
+void HpackTable::evict(size_t target_size)
+{
+    while (size_ > target_size && !entries_.empty()) {
+        auto &field = entries_.back();
+        size_ -= field.name.size() + field.value.size() + kEntryOverhead;
+        entries_.pop_back();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void HpackDecoder::setMaxTableSize(size_t max_size)
+{
+    max_size_limit_ = max_size;
+    if (table_.maxSize() > max_size)
+        table_.setMaxSize(max_size);
+}
+
+bool HpackDecoder::decode(const void *data_ptr, size_t data_size, HeaderFields &fields)
+{
+    bool is_oversize = false;
+    return decode(data_ptr, data_size, fields, std::numeric_limits<size_t>::max(), is_oversize);
+}
+
+bool HpackDecoder::decode(const void *data_ptr, size_t data_size, HeaderFields &fields,
+                          size_t max_list_size, bool &is_oversize)
+{
+    const uint8_t *pos = static_cast<const uint8_t*>(data_ptr);
+    const uint8_t *end = pos + data_size;
+
+    is_oversize = false;
+    size_t list_size = 0;
+    //! 未超出上限时才追加
+    auto append = [&] (const HeaderField &field) -> bool {
+        if (is_oversize)
+            return false;
+        size_t field_size = field.name.size() + field.value.size() + 32;
+        if (field_size > max_list_size - list_size) {
+            is_oversize = true;
+            return false;
+        }
+        list_size += field_size;
+        return true;
+    };
+
+    while (pos < end) {
+        uint8_t byte = *pos;
+
+        if (byte & 0x80) {  //! 索引
+            uint64_t index = 0;
+            if (!DecodeInteger(pos, end, 7, index))
+                return false;
+            auto field = table_.get(index);
+            if (field == nullptr)
+                return false;
+            if (append(*field))
+                fields.push_back(*field);
+
+        } else if ((byte & 0xe0) == 0x20) { //! 动态表容量更新
+            uint64_t size = 0;
+            if (!DecodeInteger(pos, end, 5, size) || size > max_size_limit_)
+                return false;
+            table_.setMaxSize(size);
+
+        } else {    //! 字面值，01 为加入动态表，0000 为不加入，0001 为永不加入
+            bool is_indexing = (byte & 0xc0) == 0x40;
+            uint64_t name_index = 0;
+            if (!DecodeInteger(pos, end, is_indexing ? 6 : 4, name_index))
+                return false;
+
+            HeaderField field;
+            if (name_index != 0) {
+                auto name_field = table_.get(name_index);
+                if (name_field == nullptr)
+                    return false;
+                field.name = name_field->name;
+            } else if (!DecodeString(pos, end, field.name)) {
+                return false;
+            }
+
+            if (!DecodeString(pos, end, field.value))
+                return false;
+
+            if (is_indexing)
+                table_.add(field.name, field.value);
+            if (append(field))
+                fields.push_back(std::move(field));
+        }
+    }
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void HpackEncoder::setMaxTableSize(size_t max_size)
+{
+    //! 我们的动态表不会超过默认的 4096，对方允许得更大也不用
+    max_size = std::min<size_t>(max_size, 4096);
+    if (max_size != table_.maxSize()) {
+        table_.setMaxSize(max_size);
+        pending_table_size_ = max_size;
+        has_pending_table_size_ = true;
+    }
+}
+
+void HpackEncoder::begin(std::string &out)
+{
+    if (has_pending_table_size_) {
+        EncodeInteger(0x20, 5, pending_table_size_, out);
+        has_pending_table_size_ = false;
+    }
+}
+
+void HpackEncoder::encode(const char *name, size_t name_len, const char *value, size_t value_len, std::string &out)
+{
+    size_t name_index = 0;
+    size_t index = table_.find(name, name_len, value, value_len, name_index);
+    if (index != 0) {
+        EncodeInteger(0x80, 7, index, out);
+        return;
+    }
+
+    bool is_indexing = table_.maxSize() > 0 && !IsNotIndexed(name, name_len) &&
+                       (name_len + value_len + kEntryOverhead) * 4 <= table_.maxSize() * 3;
+
+    if (is_indexing)
+        EncodeInteger(0x40, 6, name_index, out);
+    else
+        EncodeInteger(0x00, 4, name_index, out);
+
+    if (name_index == 0)
+        EncodeString(name, name_len, out);
+    EncodeString(value, value_len, out);
+
+    if (is_indexing)
+        table_.add(std::string(name, name_len), std::string(value, value_len));
+}
+
+}
+}
+}
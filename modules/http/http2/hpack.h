@@ -0,0 +1,149 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_HTTP2_HPACK_H_20251019
+#define TBOX_HTTP_HTTP2_HPACK_H_20251019
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+namespace tbox {
+namespace http {
+namespace http2 {
+
+//! 头部字段，HTTP/2 中名字都是小写的
+struct HeaderField {
+    std::string name;
+    std::string value;
+};
+
+using HeaderFields = std::vector<HeaderField>;
+
+/**
+ * HPACK 索引表 (RFC 7541)
+ *
+ * 由61项的静态表与FIFO的动态表组成，index 从1开始，先静态表后动态表，
+ * 动态表中新加入的项 index 最小。每项大小按 name + value + 32 计
+ */
+class HpackTable {
+  public:
+    static constexpr size_t kStaticSize = 61;
+
+    explicit HpackTable(size_t max_size = 4096) : max_size_(max_size) { }
+
+    //! 修改动态表的容量，多出的项被淘汰
+    void setMaxSize(size_t max_size);
+    size_t maxSize() const { return max_size_; }
+    size_t size() const { return size_; }
+
+    //! 获取 index 对应的项，不存在时返回 nullptr
+    const HeaderField* get(size_t index) const;
+
+    //! 加入动态表，太大放不下时会清空动态表
+    void add(const std::string &name, const std::string &value);
+
+    /**
+     * \brief   查找
+     * \return  size_t  name 与 value 都匹配的 index，没有时为0
+     * \param   name_index  name 匹配的 index，没有时为0
+     */
+    size_t find(const char *name, size_t name_len, const char *value, size_t value_len, size_t &name_index) const;
+
+  private:
+    void evict(size_t target_size);
+
+  private:
+    std::deque<HeaderField> entries_;   //!< 动态表，新的在前
+    size_t size_ = 0;
+    size_t max_size_;
+};
+
+//! HPACK 解码器
+class HpackDecoder {
+  public:
+    /**
+     * 设置我方允许的动态表容量上限，即通过 SETTINGS_HEADER_TABLE_SIZE 告知对方的值
+     * 对方可以在此范围内通过 "动态表容量更新" 调整实际的容量
+     */
+    void setMaxTableSize(size_t max_size);
+
+    /**
+     * \brief   解码一个完整的头部块
+     * \param   fields  解出的头部字段，追加在后面
+     * \return  false   格式错误，此时应以 COMPRESSION_ERROR 断开连接
+     */
+    bool decode(const void *data_ptr, size_t data_size, HeaderFields &fields);
+
+    /**
+     * \brief   解码一个完整的头部块，限制解出的头部列表大小
+     *
+     * 头部列表大小为各字段 name + value + 32 之和。超出 max_list_size 后不再追加字段，
+     * 以免少量的索引引用大的表项时拷贝出大量的数据；剩余部分仍会解码以保持动态表同步
+     *
+     * \param   is_oversize 是否超出了 max_list_size，此时 fields 不完整
+     */
+    bool decode(const void *data_ptr, size_t data_size, HeaderFields &fields,
+                size_t max_list_size, bool &is_oversize);
+
+  private:
+    HpackTable table_;
+    size_t max_size_limit_ = 4096;
+};
+
+//! HPACK 编码器
+class HpackEncoder {
+  public:
+    //! 设置对方的 SETTINGS_HEADER_TABLE_SIZE，在下一个头部块开头告知对方
+    void setMaxTableSize(size_t max_size);
+
+    //! 开始一个新的头部块，须在编码该块的第一个字段前调用
+    void begin(std::string &out);
+
+    /**
+     * \brief   编码一个头部字段，追加到 out
+     * \note    name 须为小写。常见的项会加入动态表，之后只需发送 index；
+     *          content-length、etag 等每次都不同的值不加入动态表，以免挤掉有用的项
+     */
+    void encode(const char *name, size_t name_len, const char *value, size_t value_len, std::string &out);
+    void encode(const std::string &name, const std::string &value, std::string &out) {
+        encode(name.data(), name.size(), value.data(), value.size(), out);
+    }
+
+  private:
+    HpackTable table_;
+    size_t pending_table_size_ = 0;
+    bool has_pending_table_size_ = false;
+};
+
+//! 整数编解码，见 RFC 7541 5.1。prefix 为首字节中整数前面的标志位
+void EncodeInteger(uint8_t prefix, int prefix_bits, uint64_t value, std::string &out);
+bool DecodeInteger(const uint8_t *&pos, const uint8_t *end, int prefix_bits, uint64_t &value);
+
+//! Huffman 编解码，见 RFC 7541 附录B
+size_t HuffmanEncodedLength(const char *data_ptr, size_t data_size);
+void HuffmanEncode(const char *data_ptr, size_t data_size, std::string &out);
+bool HuffmanDecode(const uint8_t *data_ptr, size_t data_size, std::string &out);
+
+}
+}
+}
+
+#endif //TBOX_HTTP_HTTP2_HPACK_H_20251019
@@ -0,0 +1,213 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include "hpack.h"
+
+namespace tbox {
+namespace http {
+namespace http2 {
+namespace {
+
+std::string FromHex(const std::string &hex)
+{
+    std::string bin;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2)
+        bin.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    return bin;
+}
+
+TEST(Hpack, Integer)
+{
+    //! RFC 7541 C.1
+    std::string out;
+    EncodeInteger(0x00, 5, 10, out);
+    EXPECT_EQ(out, FromHex("0a"));
+
+    out.clear();
+    EncodeInteger(0x00, 5, 1337, out);
+    EXPECT_EQ(out, FromHex("1f9a0a"));
+
+    const uint8_t *pos = reinterpret_cast<const uint8_t*>(out.data());
+    uint64_t value = 0;
+    EXPECT_TRUE(DecodeInteger(pos, pos + out.size(), 5, value));
+    EXPECT_EQ(value, 1337u);
+
+    //! 不完整
+    pos = reinterpret_cast<const uint8_t*>(out.data());
+    EXPECT_FALSE(DecodeInteger(pos, pos + 2, 5, value));
+}
+
+TEST(Hpack, Huffman)
+{
+    std::string out;
+    HuffmanEncode("www.example.com", 15, out);
+    EXPECT_EQ(out, FromHex("f1e3c2e5f23a6ba0ab90f4ff"));
+    EXPECT_EQ(HuffmanEncodedLength("www.example.com", 15), out.size());
+
+    std::string all;
+    for (int i = 0; i < 256; ++i)
+        all.push_back(static_cast<char>(i));
+
+    std::string encoded, decoded;
+    HuffmanEncode(all.data(), all.size(), encoded);
+    EXPECT_TRUE(HuffmanDecode(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size(), decoded));
+    EXPECT_EQ(decoded, all);
+
+    //! 填充必须全为1
+    decoded.clear();
+    std::string bad = FromHex("f1e3c2e5f23a6ba0ab90f4fe");
+    EXPECT_FALSE(HuffmanDecode(reinterpret_cast<const uint8_t*>(bad.data()), bad.size(), decoded));
+}
+
+//! RFC 7541 C.4，使用 Huffman 编码的连续两个请求
+TEST(Hpack, DecodeRequests)
+{
+    HpackDecoder decoder;
+
+    HeaderFields fields;
+    std::string block = FromHex("828684418cf1e3c2e5f23a6ba0ab90f4ff");
+    ASSERT_TRUE(decoder.decode(block.data(), block.size(), fields));
+    ASSERT_EQ(fields.size(), 4u);
+    EXPECT_EQ(fields[0].name, ":method");
+    EXPECT_EQ(fields[0].value, "GET");
+    EXPECT_EQ(fields[2].value, "/");
+    EXPECT_EQ(fields[3].name, ":authority");
+    EXPECT_EQ(fields[3].value, "www.example.com");
+
+    fields.clear();
+    block = FromHex("828684be5886a8eb10649cbf");
+    ASSERT_TRUE(decoder.decode(block.data(), block.size(), fields));
+    ASSERT_EQ(fields.size(), 5u);
+    EXPECT_EQ(fields[3].value, "www.example.com");
+    EXPECT_EQ(fields[4].name, "cache-control");
+    EXPECT_EQ(fields[4].value, "no-cache");
+}
+
+TEST(Hpack, DecodeError)
+{
+    const char *bad_blocks[] = {
+        "80",           //! index 0
+        "ff00",         //! 超出范围的 index
+        "3fe21f",       //! 动态表容量超过上限
+        "418cf1e3",     //! 字串不完整
+    };
+
+    for (auto hex : bad_blocks) {
+        HpackDecoder decoder;
+        HeaderFields fields;
+        std::string block = FromHex(hex);
+        EXPECT_FALSE(decoder.decode(block.data(), block.size(), fields)) << hex;
+    }
+}
+
+//! 大量索引引用一个大的表项时，超出上限后不再拷贝，但动态表仍保持同步
+TEST(Hpack, DecodeListSizeLimit)
+{
+    std::string block;
+    block += "\x40\x01x\x7f\xa1\x1e";    //! 加入动态表，name 为 "x"，value 长 4000
+    block += std::string(4000, 'v');
+    block += std::string(60000, '\xbe');    //! 索引 62，即上面的表项
+
+    HpackDecoder decoder;
+    HeaderFields fields;
+    bool is_oversize = false;
+    EXPECT_TRUE(decoder.decode(block.data(), block.size(), fields, 64 << 10, is_oversize));
+    EXPECT_TRUE(is_oversize);
+    EXPECT_EQ(fields.size(), 16u);  //! (64 << 10) / (1 + 4000 + 32)
+
+    std::string next_block = "\xbe";
+    fields.clear();
+    EXPECT_TRUE(decoder.decode(next_block.data(), next_block.size(), fields, 64 << 10, is_oversize));
+    EXPECT_FALSE(is_oversize);
+    ASSERT_EQ(fields.size(), 1u);
+    EXPECT_EQ(fields[0].value, std::string(4000, 'v'));
+}
+
+TEST(Hpack, EncodeAndDecode)
+{
+    HpackEncoder encoder;
+    HpackDecoder decoder;
+
+    HeaderFields input = {
+        {":status", "200"},
+        {"content-type", "application/json"},
+        {"content-length", "1234"},
+        {"server", "cpp-tbox"},
+        {"x-request-id", "abcdefg"},
+    };
+
+    std::string first_block, second_block;
+    for (auto block : { &first_block, &second_block }) {
+        encoder.begin(*block);
+        for (auto &field : input)
+            encoder.encode(field.name, field.value, *block);
+
+        HeaderFields output;
+        ASSERT_TRUE(decoder.decode(block->data(), block->size(), output));
+        ASSERT_EQ(output.size(), input.size());
+        for (size_t i = 0; i < input.size(); ++i) {
+            EXPECT_EQ(output[i].name, input[i].name);
+            EXPECT_EQ(output[i].value, input[i].value);
+        }
+    }
+
+    //! 第二次除了 content-length 之外都命中动态表，每项只需1个字节
+    EXPECT_LT(second_block.size(), first_block.size());
+    EXPECT_EQ(second_block.size(), 4u + 6);
+
+    //! 对方缩小了动态表，编码器要先发出容量更新
+    encoder.setMaxTableSize(0);
+    std::string block;
+    encoder.begin(block);
+    encoder.encode("server", "cpp-tbox", block);
+    EXPECT_EQ(static_cast<uint8_t>(block[0]), 0x20);
+
+    HeaderFields output;
+    ASSERT_TRUE(decoder.decode(block.data(), block.size(), output));
+    ASSERT_EQ(output.size(), 1u);
+    EXPECT_EQ(output[0].value, "cpp-tbox");
+}
+
+TEST(Hpack, TableEvict)
+{
+    HpackTable table(100);
+    table.add("aaaa", "1111");  //! 40
+    table.add("bbbb", "2222");  //! 80
+    table.add("cccc", "3333");  //! 淘汰 aaaa
+    EXPECT_EQ(table.size(), 80u);
+    EXPECT_EQ(table.get(62)->name, "cccc");
+    EXPECT_EQ(table.get(63)->name, "bbbb");
+    EXPECT_EQ(table.get(64), nullptr);
+
+    size_t name_index = 0;
+    EXPECT_EQ(table.find("bbbb", 4, "2222", 4, name_index), 63u);
+    EXPECT_EQ(table.find("cccc", 4, "0000", 4, name_index), 0u);
+    EXPECT_EQ(name_index, 62u);
+    EXPECT_EQ(table.find(":status", 7, "200", 3, name_index), 8u);
+
+    table.setMaxSize(50);
+    EXPECT_EQ(table.size(), 40u);
+    EXPECT_EQ(table.get(63), nullptr);
+}
+
+}
+}
+}
+}
@@ -0,0 +1,200 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "message_parser.h"
+
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+
+namespace tbox {
+namespace http {
+
+namespace {
+
+inline bool IsBlank(char ch) { return ch == ' ' || ch == '\t'; }
+
+//! 去掉首尾的空白
+void Trim(const char *&begin, const char *&end)
+{
+    while (begin < end && IsBlank(*begin))
+        ++begin;
+    while (end > begin && IsBlank(*(end - 1)))
+        --end;
+}
+
+//! 解析十进制数，不允许有其它字符，也不能等于 kNoContentLength
+bool ParseSize(const char *begin, const char *end, size_t &value)
+{
+    if (begin == end)
+        return false;
+
+    size_t tmp = 0;
+    for (const char *p = begin; p < end; ++p) {
+        if (*p < '0' || *p > '9')
+            return false;
+        size_t digit = *p - '0';
+        if (tmp > (std::numeric_limits<size_t>::max() - 1 - digit) / 10)
+            return false;
+        tmp = tmp * 10 + digit;
+    }
+
+    value = tmp;
+    return true;
+}
+
+}
+
+constexpr size_t MessageParser::kNoContentLength;
+
+void MessageParser::beginMessage()
+{
+    content_length_ = kNoContentLength;
+    is_chunked_ = false;
+    chunk_state_ = ChunkState::kSize;
+    chunk_remain_size_ = 0;
+}
+
+bool MessageParser::findLine(const char *begin, const char *end, const char *&line_end, const char *&next_line)
+{
+    const char *scan_begin = begin + scanned_size_;
+    const char *lf = static_cast<const char*>(::memchr(scan_begin, '\n', end - scan_begin));
+    if (lf == nullptr) {
+        scanned_size_ = end - begin;
+        return false;
+    }
+
+    scanned_size_ = 0;
+    next_line = lf + 1;
+    line_end = (lf > begin && *(lf - 1) == '\r') ? lf - 1 : lf;
+    return true;
+}
+
+bool MessageParser::parseHeader(const char *begin, const char *end, Headers &headers)
+{
+    const char *colon = static_cast<const char*>(::memchr(begin, ':', end - begin));
+    if (colon == nullptr)
+        return false;
+
+    const char *key_begin = begin, *key_end = colon;
+    Trim(key_begin, key_end);
+    if (key_begin == key_end)
+        return false;
+
+    const char *value_begin = colon + 1, *value_end = end;
+    Trim(value_begin, value_end);
+
+    size_t value_len = value_end - value_begin;
+    auto id = headers.set(key_begin, key_end - key_begin, value_begin, value_len);
+
+    if (id == HeaderId::kContentLength) {
+        if (!ParseSize(value_begin, value_end, content_length_))
+            return false;
+
+    } else if (id == HeaderId::kTransferEncoding) {
+        //! chunked 必须是最后一个编码
+        if (value_len >= 7 && ::strncasecmp(value_end - 7, "chunked", 7) == 0)
+            is_chunked_ = true;
+    }
+
+    return true;
+}
+
+/**
+ * 解析 chunked Body：
+ *  1a;ext=xx\r\n
+ *  <0x1a字节的数据>\r\n
+ *  0\r\n
+ *  Trailer: xx\r\n
+ *  \r\n
+ */
+const char* MessageParser::parseChunkedBody(const char *begin, const char *end, ChunkResult &result)
+{
+    const char *pos = begin;
+
+    for (;;) {
+        if (chunk_state_ == ChunkState::kData) {
+            size_t take_size = std::min(chunk_remain_size_, static_cast<size_t>(end - pos));
+            if (take_size > 0)
+                onBody(pos, take_size);
+            pos += take_size;
+            chunk_remain_size_ -= take_size;
+            if (chunk_remain_size_ > 0) {
+                result = ChunkResult::kMore;
+                return pos;
+            }
+            chunk_state_ = ChunkState::kDataEnd;
+            continue;
+        }
+
+        const char *line_end, *next_line;
+        if (!findLine(pos, end, line_end, next_line)) {
+            result = ChunkResult::kMore;
+            return pos;
+        }
+
+        if (chunk_state_ == ChunkState::kSize) {
+            size_t chunk_size = 0;
+            const char *p = pos;
+            for (; p < line_end && ::isxdigit(static_cast<unsigned char>(*p)); ++p) {
+                if (p - pos >= 15) {    //! 防止溢出
+                    result = ChunkResult::kFail;
+                    return pos;
+                }
+                chunk_size = chunk_size * 16 + (::isdigit(static_cast<unsigned char>(*p)) ? *p - '0' : (*p | 0x20) - 'a' + 10);
+            }
+
+            //! 大小后面只允许出现空白或 ;ext
+            if (p == pos || (p < line_end && *p != ';' && !IsBlank(*p))) {
+                result = ChunkResult::kFail;
+                return pos;
+            }
+
+            chunk_remain_size_ = chunk_size;
+            chunk_state_ = chunk_size > 0 ? ChunkState::kData : ChunkState::kTrailer;
+
+        } else if (chunk_state_ == ChunkState::kDataEnd) {
+            if (line_end != pos) {
+                result = ChunkResult::kFail;
+                return pos;
+            }
+            chunk_state_ = ChunkState::kSize;
+
+        } else if (line_end == pos) {   //! kTrailer，遇到空行结束，trailer 忽略
+            chunk_state_ = ChunkState::kSize;
+            result = ChunkResult::kFinished;
+            return next_line;
+        }
+
+        pos = next_line;
+    }
+}
+
+void MessageParser::swap(MessageParser &other)
+{
+    std::swap(content_length_, other.content_length_);
+    std::swap(is_chunked_, other.is_chunked_);
+    std::swap(scanned_size_, other.scanned_size_);
+    std::swap(chunk_state_, other.chunk_state_);
+    std::swap(chunk_remain_size_, other.chunk_remain_size_);
+}
+
+}
+}
@@ -0,0 +1,90 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_MESSAGE_PARSER_H_20251019
+#define TBOX_HTTP_MESSAGE_PARSER_H_20251019
+
+#include <cstddef>
+#include <limits>
+#include "headers.h"
+
+namespace tbox {
+namespace http {
+
+/**
+ * HTTP/1 报文解析器的公共部分，由 server::RequestParser 与 client::RespondParser 继承
+ *
+ * 包括：可续的逐行扫描、头部行的解析（记录 Content-Length 与 chunked）、
+ * 以及 chunked Body 的解析。Body 数据通过 onBody() 交给子类
+ */
+class MessageParser {
+  public:
+    virtual ~MessageParser() { }
+
+  protected:
+    static constexpr size_t kNoContentLength = std::numeric_limits<size_t>::max();
+
+    //! chunked Body 的解析结果
+    enum class ChunkResult {
+        kMore,      //!< 需要更多的数据
+        kFinished,  //!< Body 结束
+        kFail,      //!< 格式错误
+    };
+
+    //! 开始解析一个新的报文前调用，清除上一个报文的 Content-Length、chunked 等信息
+    void beginMessage();
+
+    /**
+     * 查找行尾，兼容只有 \n 的情况
+     * 没有找到时记下已扫描过的长度，下次从这里继续，所以 begin 须与上次的相同
+     */
+    bool findLine(const char *begin, const char *end, const char *&line_end, const char *&next_line);
+
+    /* 解析："Content-Length: 12"，存入 headers */
+    bool parseHeader(const char *begin, const char *end, Headers &headers);
+
+    //! 解析 chunked Body，返回处理到的位置
+    const char* parseChunkedBody(const char *begin, const char *end, ChunkResult &result);
+
+    //! 收到 Body 数据
+    virtual void onBody(const char *data_ptr, size_t data_size) = 0;
+
+    void swap(MessageParser &other);
+
+    size_t content_length_ = kNoContentLength;  //!< 没有 Content-Length 时为 kNoContentLength
+    bool is_chunked_ = false;
+
+  private:
+    //! chunked Body 的解析状态
+    enum class ChunkState {
+        kSize,      //!< 等待 chunk 大小行
+        kData,      //!< 接收 chunk 数据
+        kDataEnd,   //!< 等待 chunk 数据后的 CRLF
+        kTrailer,   //!< 等待结尾的 trailer 与空行
+    };
+
+    size_t scanned_size_ = 0;   //!< 未处理数据中已扫描过、确认没有行尾的长度
+    ChunkState chunk_state_ = ChunkState::kSize;
+    size_t chunk_remain_size_ = 0;
+};
+
+}
+}
+
+#endif //TBOX_HTTP_MESSAGE_PARSER_H_20251019
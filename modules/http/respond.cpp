@@ -18,7 +18,6 @@
  * of the source tree.
  */
 #include "respond.h"
-#include <sstream>
 
 namespace tbox {
 namespace http {
@@ -30,15 +29,25 @@ bool Respond::isValid() const
 
 std::string Respond::toString() const
 {
-    std::ostringstream oss;
-    oss << HttpVerToString(http_ver) << " " << StatusCodeToString(status_code) << CRLF;
-    for (auto &head : headers)
-        oss << head.first << ": " << head.second << CRLF;
-    oss << "Content-Length: " << body.length() << CRLF;
-    oss << CRLF;
-    oss << body;
+    std::string str;
+    str.reserve(256 + body.size());
+    appendHeadTo(str);
+    str += "Content-Length: ";
+    str += std::to_string(body.size());
+    str += CRLF CRLF;
+    str += body;
+    return str;
+}
 
-    return oss.str();
+void Respond::appendHeadTo(std::string &buff) const
+{
+    buff += StatusLine(http_ver, status_code);
+    for (auto &head : headers) {
+        buff += head.first;
+        buff += ": ";
+        buff += head.second;
+        buff += CRLF;
+    }
 }
 
 }
@@ -34,6 +34,10 @@ struct Respond {
 
     bool isValid() const;
     std::string toString() const;
+
+    //! 将状态行与 headers 追加到 buff 中，不含 Content-Length 与结尾的空行
+    //! 用于直接写入复用的缓冲，避免生成临时字符串
+    void appendHeadTo(std::string &buff) const;
 };
 
 }
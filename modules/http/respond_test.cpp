@@ -18,6 +18,9 @@
  * of the source tree.
  */
 #include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <sstream>
 #include "respond.h"
 
 namespace tbox {
@@ -46,6 +49,69 @@ TEST(Respond, ToString)
     EXPECT_EQ(rsp.toString(), target_str);
 }
 
+TEST(Respond, AppendHeadTo)
+{
+    Respond rsp;
+    rsp.status_code = StatusCode::k404_NotFound;
+    rsp.http_ver = HttpVer::k1_0;
+    rsp.headers["Server"] = "tbox";
+
+    std::string buff = "prefix|";
+    rsp.appendHeadTo(buff);
+    EXPECT_EQ(buff, "prefix|HTTP/1.0 404 Not Found\r\nServer: tbox\r\n");
+}
+
+/**
+ * 对比旧的 ostringstream 拼接方式与 appendHeadTo() 写入复用缓冲的方式
+ * 旧方式：格式化到 ostringstream，取出 string，再拷入发送缓冲
+ * 新方式：头写入复用的缓冲，Body 不拷贝
+ */
+TEST(Respond, Benchmark)
+{
+    Respond rsp;
+    rsp.status_code = StatusCode::k200_OK;
+    rsp.http_ver = HttpVer::k1_1;
+    rsp.headers["Content-Type"] = "application/json";
+    rsp.headers["Cache-Control"] = "no-cache";
+    rsp.body.assign(1024, 'x');
+
+    const int kTimes = 200000;
+    std::string send_buff;
+    size_t check_sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i) {
+        std::ostringstream oss;
+        oss << HttpVerToString(rsp.http_ver) << " " << StatusCodeToString(rsp.status_code) << CRLF;
+        for (auto &head : rsp.headers)
+            oss << head.first << ": " << head.second << CRLF;
+        oss << "Content-Length: " << rsp.body.length() << CRLF;
+        oss << CRLF;
+        oss << rsp.body;
+        const std::string &content = oss.str();
+        send_buff.assign(content);
+        check_sum += send_buff.size();
+    }
+    auto old_cost = std::chrono::steady_clock::now() - start;
+
+    std::string head_buff;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i) {
+        head_buff.clear();
+        rsp.appendHeadTo(head_buff);
+        head_buff += "Content-Length: ";
+        head_buff += std::to_string(rsp.body.size());
+        head_buff += CRLF CRLF;
+        check_sum -= head_buff.size() + rsp.body.size();
+    }
+    auto new_cost = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(check_sum, 0u);
+    std::cout << "ostringstream: " << std::chrono::duration_cast<std::chrono::nanoseconds>(old_cost).count() / kTimes << " ns/res" << std::endl
+              << "appendHeadTo : " << std::chrono::duration_cast<std::chrono::nanoseconds>(new_cost).count() / kTimes << " ns/res" << std::endl;
+}
+
+
 }
 }
 }
@@ -19,40 +19,130 @@
  */
 #include "context.h"
 #include "server_imp.h"
+#include "context_pool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
 namespace tbox {
 namespace http {
 namespace server {
 
 struct Context::Data {
-    Server::Impl *wp_server;
+    Server::Impl *wp_server = nullptr;
+    ContextPool *wp_pool = nullptr;     //!< 不为空时 sp_req 与 sp_res 归还到池中
     cabinet::Token conn_token;
-    int req_index;
+    int req_index = 0;
 
-    Request    *sp_req;
-    Respond    *sp_res;
+    Request    *sp_req = nullptr;
+    Respond    *sp_res = nullptr;
     /**
      * 重点说明一下 sp_req 与 sp_res 的生命期
      * sp_req 是由 Server::Impl 创建，通过构造函数传进来的，后面的生命期由 Context 负责
-     * sp_res 是由 Context 在构造的时候创建的。在 Context::done() 时移交给 Server::Impl
+     * sp_res 是由 Context 在构造或复用的时候创建的。在 Context::end() 时移交给 Server::Impl
      *        在移交之前，生命期由Context管，但移交之后便由Server::Impl管。
      * 一定要注意！
      */
+
+    RouteTree::Param params[RouteTree::kMaxParamNum];
+    size_t param_num = 0;
+
+    bool is_body_streaming = false; //!< 请求Body是否为流式接收
+    bool is_body_ended = false;
+    BodyReader body_reader;
+
+    bool is_stream_started = false; //!< 是否已开始流式回复，开始后 sp_res 不再移交
+    bool is_stream_ended = false;
+    bool is_chunked = false;
+
+    size_t handler_index = 0;   //!< 当前执行的中间件序号
+    uint32_t generation = 0;    //!< 每次复用时递增，用于识别过期的 next
+    NextFunc next;
+
+    void startStream();
 };
 
 Context::Context(Server *wp_server, const cabinet::Token &ct, int req_index, Request *req) :
-    d_(new Data{ wp_server->impl_, ct, req_index, req, new Respond })
+    d_(new Data)
+{
+    reset(wp_server, ct, req_index, req, new Respond);
+}
+
+Context::Context(ContextPool *wp_pool) :
+    d_(new Data)
+{
+    d_->wp_pool = wp_pool;
+}
+
+Context::~Context()
+{
+    recycle();
+    CHECK_DELETE_RESET_OBJ(d_);
+}
+
+void Context::reset(Server *wp_server, const cabinet::Token &ct, int req_index, Request *req, Respond *res)
 {
+    d_->wp_server = wp_server->impl_;
+    d_->conn_token = ct;
+    d_->req_index = req_index;
+    d_->sp_req = req;
+    d_->sp_res = res;
     d_->sp_res->status_code = StatusCode::k404_NotFound;
     d_->sp_res->http_ver = HttpVer::k1_1;
+
+    d_->param_num = 0;
+    d_->is_body_streaming = false;
+    d_->is_body_ended = false;
+    d_->is_stream_started = false;
+    d_->is_stream_ended = false;
+    d_->is_chunked = false;
+    d_->handler_index = 0;
+
+    ++d_->generation;
+    initNext();
 }
 
-Context::~Context()
+void Context::recycle()
 {
-    d_->wp_server->commitRespond(d_->conn_token, d_->req_index, d_->sp_res);
+    if (d_->sp_req == nullptr)
+        return;
 
-    CHECK_DELETE_RESET_OBJ(d_->sp_req);
-    CHECK_DELETE_RESET_OBJ(d_);
+    end();
+
+    d_->body_reader = nullptr;
+    ++d_->generation;
+
+    if (d_->wp_pool != nullptr) {
+        d_->wp_pool->freeRespond(d_->sp_res);
+        d_->wp_pool->freeRequest(d_->sp_req);
+        d_->sp_res = nullptr;
+        d_->sp_req = nullptr;
+    } else {
+        CHECK_DELETE_RESET_OBJ(d_->sp_res);
+        CHECK_DELETE_RESET_OBJ(d_->sp_req);
+    }
+}
+
+/**
+ * 所有中间件共用同一个 next，靠 handler_index 推进，避免每一级都构造一个 std::function。
+ * 只捕获 this 与 generation，std::function 可以就地存放，无需分配内存
+ */
+void Context::initNext()
+{
+    auto generation = d_->generation;
+    d_->next = [this, generation] {
+        //! Context 已释放或被其它请求复用
+        if (d_->generation != generation)
+            return;
+        d_->wp_server->handle(shared_from_this(), ++d_->handler_index, d_->next);
+    };
+}
+
+void Context::dispatch()
+{
+    d_->handler_index = 0;
+    d_->wp_server->handle(shared_from_this(), 0, d_->next);
 }
 
 Request& Context::req() const
@@ -65,6 +155,214 @@ Respond& Context::res() const
     return *(d_->sp_res);
 }
 
+std::string Context::param(const std::string &name) const
+{
+    const char *value_ptr = nullptr;
+    size_t value_len = 0;
+    if (param(name, value_ptr, value_len))
+        return std::string(value_ptr, value_len);
+    return std::string();
+}
+
+bool Context::param(const std::string &name, const char* &value_ptr, size_t &value_len) const
+{
+    for (size_t i = 0; i < d_->param_num; ++i) {
+        auto &item = d_->params[i];
+        if (name == item.name) {
+            value_ptr = item.value_ptr;
+            value_len = item.value_len;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Context::setParams(const RouteTree::Param *params, size_t param_num)
+{
+    if (param_num > RouteTree::kMaxParamNum)
+        param_num = RouteTree::kMaxParamNum;
+
+    std::copy(params, params + param_num, d_->params);
+    d_->param_num = param_num;
+}
+
+bool Context::isBodyStreaming() const
+{
+    return d_->is_body_streaming;
+}
+
+void Context::setBodyReader(const BodyReader &reader)
+{
+    d_->body_reader = reader;
+    if (!reader)
+        return;
+
+    auto &body = d_->sp_req->body;
+    if (!body.empty()) {
+        reader(body.data(), body.size());
+        body.clear();
+    }
+
+    //! 非流式接收的请求，Body 已完整
+    if (!d_->is_body_streaming || d_->is_body_ended) {
+        d_->body_reader = nullptr;
+        reader(nullptr, 0);
+    }
+}
+
+void Context::setBodyStreaming()
+{
+    d_->is_body_streaming = true;
+}
+
+void Context::onBody(const char *data_ptr, size_t data_size)
+{
+    if (data_size == 0) {
+        d_->is_body_ended = true;
+        //! 结束后释放 reader，以免其持有 Context 造成循环引用
+        auto reader = std::move(d_->body_reader);
+        d_->body_reader = nullptr;
+        if (reader)
+            reader(nullptr, 0);
+
+    } else if (d_->body_reader) {
+        d_->body_reader(data_ptr, data_size);
+
+    } else {
+        d_->sp_req->body.append(data_ptr, data_size);
+    }
+}
+
+void Context::Data::startStream()
+{
+    is_stream_started = true;
+
+    auto &res = *sp_res;
+
+    //! HTTP/2 的头部由 Server 编码，数据以 DATA 帧分隔，无需 chunked
+    if (sp_req->http_ver == HttpVer::k2_0) {
+        is_chunked = false;
+        wp_server->appendRespondHead(conn_token, req_index, res);
+        return;
+    }
+
+    is_chunked = res.headers.find(HeaderId::kContentLength) == res.headers.end();
+
+    //! HTTP/1.0 不支持 chunked，只能以断开连接表示结束
+    bool is_close = is_chunked && sp_req->http_ver == HttpVer::k1_0;
+    if (is_close)
+        is_chunked = false;
+
+    std::string head;
+    res.appendHeadTo(head);
+    if (res.headers.find(HeaderId::kDate) == res.headers.end())
+        head += wp_server->dateHeader();
+    if (is_chunked)
+        head += "Transfer-Encoding: chunked" CRLF;
+    if (is_close) {
+        head += "Connection: close" CRLF;
+        wp_server->markClose(conn_token, req_index);
+    }
+    head += CRLF;
+
+    wp_server->appendRespond(conn_token, req_index, head.data(), head.size(), false);
+}
+
+bool Context::write(const void *data_ptr, size_t data_size)
+{
+    if (d_->is_stream_ended)
+        return false;
+
+    if (!d_->is_stream_started)
+        d_->startStream();
+
+    //! 长度为0的chunk表示结束，所以不能发送
+    if (data_size > 0) {
+        if (d_->is_chunked) {
+            char size_str[20];
+            int size_len = ::snprintf(size_str, sizeof(size_str), "%zx" CRLF, data_size);
+
+            std::string chunk;
+            chunk.reserve(size_len + data_size + 2);
+            chunk.append(size_str, size_len);
+            chunk.append(static_cast<const char*>(data_ptr), data_size);
+            chunk.append(CRLF);
+            d_->wp_server->appendRespond(d_->conn_token, d_->req_index, chunk.data(), chunk.size(), false);
+
+        } else {
+            d_->wp_server->appendRespond(d_->conn_token, d_->req_index,
+                                         static_cast<const char*>(data_ptr), data_size, false);
+        }
+    }
+
+    return isWritable();
+}
+
+bool Context::writeFile(const network::Fd &file_fd, off_t offset, size_t size)
+{
+    if (d_->is_stream_ended)
+        return false;
+
+    if (!d_->is_stream_started)
+        d_->startStream();
+
+    if (size > 0) {
+        if (d_->is_chunked) {
+            char size_str[20];
+            int size_len = ::snprintf(size_str, sizeof(size_str), "%zx" CRLF, size);
+            d_->wp_server->appendRespond(d_->conn_token, d_->req_index, size_str, size_len, false);
+            d_->wp_server->appendFile(d_->conn_token, d_->req_index, file_fd, offset, size);
+            d_->wp_server->appendRespond(d_->conn_token, d_->req_index, CRLF, 2, false);
+
+        } else {
+            d_->wp_server->appendFile(d_->conn_token, d_->req_index, file_fd, offset, size);
+        }
+    }
+
+    return isWritable();
+}
+
+void Context::end()
+{
+    if (d_->is_stream_ended)
+        return;
+    d_->is_stream_ended = true;
+
+    if (d_->is_stream_started) {
+        const char *tail = d_->is_chunked ? "0" CRLF CRLF : "";
+        d_->wp_server->appendRespond(d_->conn_token, d_->req_index, tail, ::strlen(tail), true);
+
+    } else {
+        //! 没有流式写过，整体回复。sp_res 移交给 Server::Impl
+        d_->wp_server->commitRespond(d_->conn_token, d_->req_index, d_->sp_res);
+        d_->sp_res = nullptr;
+    }
+}
+
+bool Context::upgrade(UpgradeHandler *sp_handler)
+{
+    if (d_->is_stream_started || d_->is_stream_ended)
+        return false;
+
+    if (!d_->wp_server->upgrade(d_->conn_token, d_->req_index, *d_->sp_res, sp_handler))
+        return false;
+
+    //! 回复已发出，析构时不再提交
+    d_->is_stream_ended = true;
+    return true;
+}
+
+bool Context::isWritable() const
+{
+    return !d_->is_stream_ended && d_->wp_server->isWritable(d_->conn_token, d_->req_index);
+}
+
+void Context::setWritableCallback(const WritableCallback &cb)
+{
+    if (!d_->is_stream_ended)
+        d_->wp_server->setWritableCallback(d_->conn_token, d_->req_index, cb);
+}
+
 }
 }
 }
@@ -20,23 +20,34 @@
 #ifndef TBOX_HTTP_CONTEXT_H_20220502
 #define TBOX_HTTP_CONTEXT_H_20220502
 
+#include <memory>
+#include <functional>
 #include <tbox/base/defines.h>
 #include <tbox/base/cabinet_token.h>
+#include <tbox/network/fd.h>
 
 #include "../common.h"
 #include "../request.h"
 #include "../respond.h"
+#include "route_tree.h"
+#include "types.h"
 
 namespace tbox {
 namespace http {
 namespace server {
 
 class Server;
+class UpgradeHandler;
+class ContextPool;
 
 /**
  * Http请求上下文
+ *
+ * Server 中的 Context 由池分配，释放后会被下一个请求复用
  */
-class Context {
+class Context : public std::enable_shared_from_this<Context> {
+    friend ContextPool;
+
   public:
     Context(Server *wp_server, const cabinet::Token &ct,
             int req_index, Request *req);
@@ -46,7 +57,72 @@ class Context {
 
   public:
     Request& req() const;
-    Respond& res() const;   //! 注意: 在 done() 之后就不可以再使用该函数
+    Respond& res() const;   //! 注意: 在 end() 之后就不可以再使用该函数
+
+    //! 获取路径参数，如 Router 中注册了 "/devices/:id"，可用 param("id") 获取，没有时返回空串
+    std::string param(const std::string &name) const;
+    //! 同上，但不拷贝，value_ptr 指向 req().url.path 内部
+    bool param(const std::string &name, const char* &value_ptr, size_t &value_len) const;
+
+    //! 供 Router 使用，name 与 value_ptr 所指的内存须在 Context 的生命期内有效
+    void setParams(const RouteTree::Param *params, size_t param_num);
+
+  public:
+    /**
+     * 流式接收请求Body
+     *
+     * 当 Server::setBodyStreamThreshold() 启用后，chunked 或 Content-Length 超过阈值的请求
+     * 在收到Head后就会交给中间件处理，此时 req().body 为空，Body 通过 BodyReader 陆续交出，
+     * 结束时以 data_size 为 0 回调一次。在设置 BodyReader 之前收到的数据会暂存在 req().body 中，
+     * 设置时一次性交出。Body 接收完成前，Context 由 Server 持有
+     */
+    using BodyReader = std::function<void(const char *data_ptr, size_t data_size)>;
+    bool isBodyStreaming() const;
+    void setBodyReader(const BodyReader &reader);
+
+    /**
+     * 流式回复
+     *
+     * 第一次 write() 时，以 res() 中的状态码与Headers发出回复头，之后 res().body 不再使用。
+     * 如果 res().headers 中指定了 Content-Length，则原样发送数据；否则使用 chunked 编码，
+     * HTTP/1.0 的请求则在回复完成后断开连接。end() 结束回复，Context 析构时会自动 end()
+     *
+     * 流控：isWritable() 为 false 时表示发送缓冲已满，或前面还有未完成的回复，
+     * 应停止 write()，等待 WritableCallback 回调后再继续。
+     * 注意：WritableCallback 持有的对象在 end() 之后才会释放
+     */
+    bool write(const void *data_ptr, size_t data_size);
+    bool write(const std::string &data) { return write(data.data(), data.size()); }
+    //! 发送文件中的一段，由内核直接从文件拷贝到socket，不经过用户空间
+    bool writeFile(const network::Fd &file_fd, off_t offset, size_t size);
+    void end();
+
+    bool isWritable() const;
+    using WritableCallback = std::function<void()>;
+    void setWritableCallback(const WritableCallback &cb);
+
+    /**
+     * 协议升级，供 WebSocket 等中间件使用
+     *
+     * 立即发出 res() 作为回复 (通常为 101)，之后该连接交由 sp_handler 处理，不再有HTTP请求。
+     * 只有该请求是连接上最后收到、且前面的回复都已完成的请求时才能升级，HTTP/2 中不能升级。
+     * 成功时 sp_handler 由 Server 负责释放，失败时返回 false，由调用者释放
+     */
+    bool upgrade(UpgradeHandler *sp_handler);
+
+    //! 供 Server 使用
+    void setBodyStreaming();
+    void onBody(const char *data_ptr, size_t data_size);
+    //! 从第一个中间件开始处理
+    void dispatch();
+
+  private:
+    explicit Context(ContextPool *wp_pool);
+
+    void reset(Server *wp_server, const cabinet::Token &ct, int req_index, Request *req, Respond *res);
+    //! 结束回复，归还 Request 与 Respond
+    void recycle();
+    void initNext();
 
   private:
     struct Data;
@@ -0,0 +1,223 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "context_pool.h"
+
+#include <tbox/base/assert.h>
+
+#include "../request.h"
+#include "../respond.h"
+#include "context.h"
+
+namespace tbox {
+namespace http {
+namespace server {
+
+namespace {
+//! 归还时 body 的容量超过该值就释放掉，以免个别大请求长期占用内存
+constexpr size_t kMaxKeepBodyCapacity = 64 << 10;
+
+void ClearBody(std::string &body)
+{
+    if (body.capacity() > kMaxKeepBodyCapacity)
+        std::string().swap(body);
+    else
+        body.clear();
+}
+}
+
+/**
+ * 用于分配 ContextSptr 的控制块
+ *
+ * 控制块的类型由 shared_ptr 内部决定，大小固定，所以池中只缓存一种大小的块
+ */
+template <typename T>
+class BlockAllocator {
+  public:
+    using value_type = T;
+
+    explicit BlockAllocator(ContextPool *wp_pool) : wp_pool_(wp_pool) { }
+    template <typename U>
+    BlockAllocator(const BlockAllocator<U> &other) : wp_pool_(other.wp_pool_) { }
+
+    T* allocate(size_t n) { return static_cast<T*>(wp_pool_->allocBlock(n * sizeof(T))); }
+    void deallocate(T *p, size_t n) { wp_pool_->freeBlock(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator == (const BlockAllocator<U> &other) const { return wp_pool_ == other.wp_pool_; }
+    template <typename U>
+    bool operator != (const BlockAllocator<U> &other) const { return wp_pool_ != other.wp_pool_; }
+
+  private:
+    template <typename U> friend class BlockAllocator;
+    ContextPool *wp_pool_;
+};
+
+ContextPool::ContextPool(size_t keep_number) :
+    keep_number_(keep_number)
+{ }
+
+ContextPool::~ContextPool()
+{
+    for (auto req : requests_)
+        delete req;
+    for (auto res : responds_)
+        delete res;
+    for (auto ctx : contexts_)
+        delete ctx;
+    for (auto block : blocks_)
+        ::operator delete(block);
+}
+
+/**
+ * 池中空闲的 Context 仍以 weak_ptr 引用着上一次的控制块，先删除它们，
+ * 控制块才能归还。删除期间多计一个，以免提前删除自己
+ */
+void ContextPool::release()
+{
+    is_released_ = true;
+
+    ++outstanding_blocks_;
+    for (auto ctx : contexts_)
+        delete ctx;
+    contexts_.clear();
+    --outstanding_blocks_;
+
+    if (outstanding_blocks_ == 0)
+        delete this;
+}
+
+Request* ContextPool::allocRequest()
+{
+    if (requests_.empty())
+        return new Request;
+
+    auto req = requests_.back();
+    requests_.pop_back();
+    return req;
+}
+
+void ContextPool::freeRequest(Request *req)
+{
+    if (req == nullptr)
+        return;
+
+    if (is_released_ || requests_.size() >= keep_number_) {
+        delete req;
+        return;
+    }
+
+    req->method = Method::kUnset;
+    req->http_ver = HttpVer::kUnset;
+    req->url.path.clear();
+    req->url.params.clear();
+    req->url.query.clear();
+    req->url.frag.clear();
+    req->headers.clear();
+    ClearBody(req->body);
+    requests_.push_back(req);
+}
+
+Respond* ContextPool::allocRespond()
+{
+    if (responds_.empty())
+        return new Respond;
+
+    auto res = responds_.back();
+    responds_.pop_back();
+    return res;
+}
+
+void ContextPool::freeRespond(Respond *res)
+{
+    if (res == nullptr)
+        return;
+
+    if (is_released_ || responds_.size() >= keep_number_) {
+        delete res;
+        return;
+    }
+
+    res->http_ver = HttpVer::kUnset;
+    res->status_code = StatusCode::kUnset;
+    res->headers.clear();
+    ClearBody(res->body);
+    responds_.push_back(res);
+}
+
+ContextSptr ContextPool::newContext(Server *wp_server, const cabinet::Token &ct, int req_index, Request *req)
+{
+    Context *ctx = nullptr;
+    if (contexts_.empty()) {
+        ctx = new Context(this);
+    } else {
+        ctx = contexts_.back();
+        contexts_.pop_back();
+    }
+
+    ctx->reset(wp_server, ct, req_index, req, allocRespond());
+    return ContextSptr(ctx, [this] (Context *ctx) { freeContext(ctx); }, BlockAllocator<Context>(this));
+}
+
+/**
+ * Context 不受 keep_number 限制，其数量不超过同时存在的请求数的峰值。
+ * 这样池存在期间 Context 的内存始终有效，过期的 NextFunc 被调用时能安全地识别出来
+ */
+void ContextPool::freeContext(Context *ctx)
+{
+    ctx->recycle();
+    if (is_released_)
+        delete ctx;
+    else
+        contexts_.push_back(ctx);
+}
+
+void* ContextPool::allocBlock(size_t size)
+{
+    ++outstanding_blocks_;
+
+    if (block_size_ == 0)
+        block_size_ = size;
+
+    if (size == block_size_ && !blocks_.empty()) {
+        auto block = blocks_.back();
+        blocks_.pop_back();
+        return block;
+    }
+    return ::operator new(size);
+}
+
+void ContextPool::freeBlock(void *block, size_t size)
+{
+    TBOX_ASSERT(outstanding_blocks_ > 0);
+    --outstanding_blocks_;
+
+    if (!is_released_ && size == block_size_) {
+        blocks_.push_back(block);
+        return;
+    }
+
+    ::operator delete(block);
+    if (is_released_ && outstanding_blocks_ == 0)
+        delete this;
+}
+
+}
+}
+}
@@ -0,0 +1,90 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_SERVER_CONTEXT_POOL_H_20251019
+#define TBOX_HTTP_SERVER_CONTEXT_POOL_H_20251019
+
+#include <vector>
+#include <tbox/base/defines.h>
+#include <tbox/base/cabinet_token.h>
+
+#include "types.h"
+
+namespace tbox {
+namespace http {
+
+struct Request;
+struct Respond;
+
+namespace server {
+
+class Server;
+
+/**
+ * 请求处理过程中 Request, Respond, Context 对象的池，每个 Server 一个，只在其 Loop 线程中使用
+ *
+ * 归还的 Request 与 Respond 只清空内容，保留 body 与 headers 已分配的容量，下一个请求直接复用；
+ * Context 连同其内部数据一起复用；ContextSptr 的控制块也从池中分配。
+ *
+ * Server 析构时调用 release()。如果此时仍有 Context 未释放，池会等它们都释放后再删除自己
+ */
+class ContextPool {
+  public:
+    explicit ContextPool(size_t keep_number);
+
+    NONCOPYABLE(ContextPool);
+    IMMOVABLE(ContextPool);
+
+  public:
+    Request* allocRequest();
+    void freeRequest(Request *req);
+
+    Respond* allocRespond();
+    void freeRespond(Respond *res);
+
+    ContextSptr newContext(Server *wp_server, const cabinet::Token &ct, int req_index, Request *req);
+
+    void release();
+
+  private:
+    ~ContextPool();
+
+    template <typename T> friend class BlockAllocator;
+    void* allocBlock(size_t size);
+    void freeBlock(void *block, size_t size);
+
+    void freeContext(Context *ctx);
+
+  private:
+    size_t keep_number_;
+    bool is_released_ = false;
+    size_t block_size_ = 0;         //!< 控制块的大小，由第一次分配确定
+    size_t outstanding_blocks_ = 0; //!< 尚未归还的控制块，即存活的 Context 数
+
+    std::vector<Request*> requests_;
+    std::vector<Respond*> responds_;
+    std::vector<Context*> contexts_;
+    std::vector<void*> blocks_;
+};
+
+}
+}
+}
+
+#endif //TBOX_HTTP_SERVER_CONTEXT_POOL_H_20251019
@@ -0,0 +1,1061 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "http2_session.h"
+#include "server_imp.h"
+#include "context.h"
+#include "context_pool.h"
+
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <tbox/base/log.h>
+#include <tbox/util/base64.h>
+
+namespace tbox {
+namespace http {
+namespace server {
+
+using namespace std;
+using namespace event;
+using namespace network;
+using namespace http2;
+
+namespace {
+constexpr uint32_t kMaxConcurrentStreams = 100;
+constexpr int64_t  kStreamRecvWindow = 256 << 10;   //!< 通过 SETTINGS_INITIAL_WINDOW_SIZE 告知对方
+constexpr int64_t  kConnRecvWindow = 1 << 20;       //!< 开始时通过 WINDOW_UPDATE 扩大
+constexpr size_t   kMaxHeaderBlockSize = 64 << 10;
+constexpr size_t   kMaxHeaderListSize = 64 << 10;
+constexpr size_t   kStreamPendingHighWater = 64 << 10;
+constexpr size_t   kSendBufferHighWater = 256 << 10;
+
+void AppendSetting(string &out, SettingId id, uint32_t value)
+{
+    uint16_t id_value = static_cast<uint16_t>(id);
+    out.push_back(static_cast<char>(id_value >> 8));
+    out.push_back(static_cast<char>(id_value));
+    AppendUint32(out, value);
+}
+
+//! HTTP/2 中禁止出现的逐跳头部
+bool IsConnectionSpecific(HeaderId id)
+{
+    return id == HeaderId::kConnection || id == HeaderId::kKeepAlive ||
+           id == HeaderId::kTransferEncoding || id == HeaderId::kUpgrade;
+}
+
+//! 由解出的头部字段生成请求，伪头部必须在普通头部之前
+bool FillRequest(const HeaderFields &fields, Request &req)
+{
+    req.http_ver = HttpVer::k2_0;
+
+    bool is_regular_started = false;
+    const string *authority = nullptr;
+
+    //! 头部列表的大小已在解码时限制
+    for (auto &field : fields) {
+        if (!field.name.empty() && field.name[0] == ':') {
+            if (is_regular_started)
+                return false;
+
+            if (field.name == ":method") {
+                req.method = StringToMethod(field.value);
+            } else if (field.name == ":path") {
+                if (!StringToUrlPath(field.value, req.url))
+                    return false;
+            } else if (field.name == ":authority") {
+                authority = &field.value;
+            } else if (field.name != ":scheme") {
+                return false;
+            }
+            continue;
+        }
+
+        is_regular_started = true;
+        auto id = ToHeaderId(field.name);
+        if (IsConnectionSpecific(id))
+            continue;
+
+        //! 拆开发送的多个 cookie 要合并
+        if (id == HeaderId::kCookie) {
+            auto iter = req.headers.find(HeaderId::kCookie);
+            if (iter != req.headers.end()) {
+                iter->second += "; ";
+                iter->second += field.value;
+                continue;
+            }
+        }
+
+        req.headers.set(field.name.data(), field.name.size(), field.value.data(), field.value.size());
+    }
+
+    if (req.method == Method::kUnset || req.url.path.empty())
+        return false;
+
+    if (authority != nullptr && req.headers.find(HeaderId::kHost) == req.headers.end())
+        req.headers[HeaderId::kHost] = *authority;
+
+    return true;
+}
+}
+
+Http2Session::Stream::~Stream()
+{
+    CHECK_DELETE_RESET_OBJ(sp_req);
+}
+
+Http2Session::Http2Session(Server::Impl *wp_server, const TcpServer::ConnToken &ct) :
+    wp_server_(wp_server),
+    wp_loop_(wp_server->wp_loop_),
+    tcp_server_(wp_server->tcp_server_),
+    ct_(ct)
+{
+    //! 帧头、WINDOW_UPDATE 等小块数据很多，不关闭 Nagle 的话会与对方的延迟确认相互等待
+    tcp_server_.getClientSocketFd(ct_).setSocketOpt(IPPROTO_TCP, TCP_NODELAY, 1);
+}
+
+Http2Session::~Http2Session()
+{
+    wp_loop_->cancel(writable_run_id_);
+    wp_loop_->cancel(close_run_id_);
+
+    //! 先取出再释放，释放 Context 时会回调到 commitRespond()
+    auto tobe_delete = std::move(streams_);
+    streams_.clear();
+    for (auto &item : tobe_delete)
+        delete item.second;
+}
+
+void Http2Session::start()
+{
+    sendSettings();
+}
+
+void Http2Session::startUpgrade(const string &settings, Request *req)
+{
+    sendSettings();
+    applySettings(reinterpret_cast<const uint8_t*>(settings.data()), settings.size());
+
+    //! 升级的请求为 stream 1，已处于 half-closed (remote) 状态
+    req->http_ver = HttpVer::k2_0;
+    last_stream_id_ = 1;
+    openStream(1, req, true);
+}
+
+bool Http2Session::DecodeSettings(const string &value, string &settings)
+{
+    //! base64url 转为 base64 再解码
+    string b64 = value;
+    for (auto &ch : b64) {
+        if (ch == '-')
+            ch = '+';
+        else if (ch == '_')
+            ch = '/';
+    }
+    while (b64.size() % 4 != 0)
+        b64.push_back('=');
+
+    settings.resize(util::base64::DecodeLength(b64));
+    size_t len = settings.empty() ? 0 : util::base64::Decode(b64.data(), b64.size(), &settings[0], settings.size());
+    settings.resize(len);
+    return settings.size() % 6 == 0 && (len > 0 || value.empty());
+}
+
+void Http2Session::onReceived(Buffer &buff)
+{
+    while (!is_goaway_sent_) {
+        const uint8_t *data_ptr = buff.readableBegin();
+        size_t data_size = buff.readableSize();
+
+        if (!is_preface_received_) {
+            if (data_size < kClientPrefaceSize)
+                return;
+            if (::memcmp(data_ptr, kClientPreface, kClientPrefaceSize) != 0) {
+                LogNotice("invalid preface");
+                goaway(ErrorCode::kProtocolError);
+                break;
+            }
+            buff.hasRead(kClientPrefaceSize);
+            is_preface_received_ = true;
+            continue;
+        }
+
+        if (data_size < kFrameHeadSize)
+            return;
+
+        FrameHead head;
+        ParseFrameHead(data_ptr, head);
+        if (head.length > kDefaultMaxFrameSize) {
+            goaway(ErrorCode::kFrameSizeError);
+            break;
+        }
+
+        if (data_size < kFrameHeadSize + head.length)
+            return;
+
+        onFrame(head, data_ptr + kFrameHeadSize);
+        buff.hasRead(kFrameHeadSize + head.length);
+    }
+
+    buff.hasReadAll();
+}
+
+void Http2Session::onSendCompleted()
+{
+    scheduleWritable();
+}
+
+void Http2Session::onFrame(const FrameHead &head, const uint8_t *payload)
+{
+    //! 头部块未收齐时，只能是同一个 stream 的 CONTINUATION
+    if (continuation_stream_id_ != 0 &&
+        (head.type != FrameType::kContinuation || head.stream_id != continuation_stream_id_)) {
+        goaway(ErrorCode::kProtocolError);
+        return;
+    }
+
+    switch (head.type) {
+        case FrameType::kData:
+            onDataFrame(head, payload);
+            break;
+
+        case FrameType::kHeaders:
+            onHeadersFrame(head, payload);
+            break;
+
+        case FrameType::kContinuation:
+            onContinuationFrame(head, payload);
+            break;
+
+        case FrameType::kPriority:
+            if (head.stream_id == 0)
+                goaway(ErrorCode::kProtocolError);
+            else if (head.length != 5)
+                sendRstStream(head.stream_id, ErrorCode::kFrameSizeError);
+            break;
+
+        case FrameType::kRstStream:
+            onRstStreamFrame(head, payload);
+            break;
+
+        case FrameType::kSettings:
+            onSettingsFrame(head, payload);
+            break;
+
+        case FrameType::kPushPromise:   //! 客户端不能推送
+            goaway(ErrorCode::kProtocolError);
+            break;
+
+        case FrameType::kPing:
+            if (head.stream_id != 0)
+                goaway(ErrorCode::kProtocolError);
+            else if (head.length != 8)
+                goaway(ErrorCode::kFrameSizeError);
+            else if ((head.flags & kFlagAck) == 0)
+                sendFrame(FrameType::kPing, kFlagAck, 0, payload, 8);
+            break;
+
+        case FrameType::kGoaway:
+            is_goaway_received_ = true;
+            if (streams_.empty())
+                scheduleClose();
+            break;
+
+        case FrameType::kWindowUpdate:
+            onWindowUpdateFrame(head, payload);
+            break;
+
+        default:    //! 未知的帧类型须忽略
+            break;
+    }
+}
+
+void Http2Session::onHeadersFrame(const FrameHead &head, const uint8_t *payload)
+{
+    if (head.stream_id == 0 || (head.stream_id & 1) == 0) {
+        goaway(ErrorCode::kProtocolError);
+        return;
+    }
+
+    const uint8_t *begin = payload;
+    const uint8_t *end = payload + head.length;
+
+    if (head.flags & kFlagPadded) {
+        if (begin == end || *begin >= head.length) {
+            goaway(ErrorCode::kProtocolError);
+            return;
+        }
+        end -= *begin++;
+    }
+
+    if (head.flags & kFlagPriority) {
+        if (end - begin < 5) {
+            goaway(ErrorCode::kProtocolError);
+            return;
+        }
+        begin += 5;
+    }
+
+    header_block_.assign(reinterpret_cast<const char*>(begin), end - begin);
+    bool is_end_stream = (head.flags & kFlagEndStream) != 0;
+
+    if (head.flags & kFlagEndHeaders) {
+        onHeaderBlock(head.stream_id, is_end_stream);
+    } else {
+        continuation_stream_id_ = head.stream_id;
+        is_continuation_end_stream_ = is_end_stream;
+    }
+}
+
+void Http2Session::onContinuationFrame(const FrameHead &head, const uint8_t *payload)
+{
+    if (continuation_stream_id_ == 0) {
+        goaway(ErrorCode::kProtocolError);
+        return;
+    }
+
+    header_block_.append(reinterpret_cast<const char*>(payload), head.length);
+    if (header_block_.size() > kMaxHeaderBlockSize) {
+        goaway(ErrorCode::kEnhanceYourCalm);
+        return;
+    }
+
+    if (head.flags & kFlagEndHeaders) {
+        continuation_stream_id_ = 0;
+        onHeaderBlock(head.stream_id, is_continuation_end_stream_);
+    }
+}
+
+void Http2Session::onHeaderBlock(uint32_t stream_id, bool is_end_stream)
+{
+    //! 即使最终不处理该 stream 也要解码，以保持 HPACK 动态表同步。
+    //! 头部列表超出上限时，解码器不再追加字段，该 stream 被拒绝
+    Fields fields;
+    bool is_oversize = false;
+    if (!decoder_.decode(header_block_.data(), header_block_.size(), fields, kMaxHeaderListSize, is_oversize)) {
+        goaway(ErrorCode::kCompressionError);
+        return;
+    }
+
+    auto stream = findStream(stream_id);
+    if (stream != nullptr) {
+        //! 已存在的 stream 上只能是 trailers，忽略其内容
+        if (stream->is_remote_closed || !is_end_stream)
+            sendRstStream(stream_id, ErrorCode::kProtocolError);
+        else
+            onRemoteEnd(stream_id);
+        return;
+    }
+
+    if (stream_id <= last_stream_id_) {
+        goaway(ErrorCode::kStreamClosed);
+        return;
+    }
+    last_stream_id_ = stream_id;
+
+    if (is_goaway_received_)
+        return;
+
+    if (streams_.size() >= kMaxConcurrentStreams) {
+        sendRstStream(stream_id, ErrorCode::kRefusedStream);
+        return;
+    }
+
+    Request *req = is_oversize ? nullptr : makeRequest(fields);
+    if (req == nullptr) {
+        sendRstStream(stream_id, ErrorCode::kProtocolError);
+        return;
+    }
+
+    openStream(stream_id, req, is_end_stream);
+}
+
+Request* Http2Session::makeRequest(const Fields &fields)
+{
+    Request *req = wp_server_->sp_pool_->allocRequest();
+    if (!FillRequest(fields, *req)) {
+        wp_server_->sp_pool_->freeRequest(req);
+        return nullptr;
+    }
+    return req;
+}
+
+void Http2Session::openStream(uint32_t stream_id, Request *req, bool is_end_stream)
+{
+    auto stream = new Stream;
+    stream->id = stream_id;
+    stream->send_window = peer_initial_window_;
+    stream->recv_window = kStreamRecvWindow;
+    streams_[stream_id] = stream;
+
+    if (is_end_stream) {
+        stream->is_remote_closed = true;
+        dispatch(stream_id, req, false);
+        tryCloseStream(stream_id);
+        return;
+    }
+
+    //! 与 HTTP/1.1 一样，没有 Content-Length 或超过阈值时流式接收Body
+    bool is_body_streaming = false;
+    auto threshold = wp_server_->body_stream_threshold_;
+    if (threshold != numeric_limits<size_t>::max()) {
+        auto value = req->headers.get(HeaderId::kContentLength);
+        is_body_streaming = value == nullptr || ::strtoull(value->c_str(), nullptr, 10) > threshold;
+    }
+
+    if (is_body_streaming)
+        dispatch(stream_id, req, true);
+    else
+        stream->sp_req = req;
+}
+
+void Http2Session::onRemoteEnd(uint32_t stream_id)
+{
+    auto stream = findStream(stream_id);
+    stream->is_remote_closed = true;
+
+    if (stream->sp_ctx != nullptr) {
+        auto sp_ctx = std::move(stream->sp_ctx);
+        sp_ctx->onBody(nullptr, 0);
+        sp_ctx.reset();
+
+    } else if (stream->sp_req != nullptr) {
+        Request *req = nullptr;
+        std::swap(req, stream->sp_req);
+        dispatch(stream_id, req, false);
+    }
+
+    //! 处理过程中 stream 可能已被释放
+    tryCloseStream(stream_id);
+}
+
+void Http2Session::dispatch(uint32_t stream_id, Request *req, bool is_body_streaming)
+{
+    if (wp_server_->context_log_enable_)
+        LogDbg("REQ: [%s]", req->toString().c_str());
+
+    auto sp_ctx = wp_server_->sp_pool_->newContext(wp_server_->wp_parent_, ct_, static_cast<int>(stream_id), req);
+    if (is_body_streaming) {
+        sp_ctx->setBodyStreaming();
+        findStream(stream_id)->sp_ctx = sp_ctx;
+    }
+
+    sp_ctx->dispatch();
+}
+
+void Http2Session::onDataFrame(const FrameHead &head, const uint8_t *payload)
+{
+    if (head.stream_id == 0) {
+        goaway(ErrorCode::kProtocolError);
+        return;
+    }
+
+    //! 连接级的窗口，不论 stream 状态如何都要计入
+    if (head.length > conn_recv_window_) {
+        goaway(ErrorCode::kFlowControlError);
+        return;
+    }
+    consumeRecvWindow(nullptr, head.length);
+
+    const uint8_t *begin = payload;
+    const uint8_t *end = payload + head.length;
+    if (head.flags & kFlagPadded) {
+        if (begin == end || *begin >= head.length) {
+            goaway(ErrorCode::kProtocolError);
+            return;
+        }
+        end -= *begin++;
+    }
+
+    auto stream = findStream(head.stream_id);
+    if (stream == nullptr || stream->is_remote_closed) {
+        if (head.stream_id > last_stream_id_)
+            goaway(ErrorCode::kProtocolError);
+        else
+            sendRstStream(head.stream_id, ErrorCode::kStreamClosed);
+        return;
+    }
+
+    if (head.length > stream->recv_window) {
+        sendRstStream(head.stream_id, ErrorCode::kFlowControlError);
+        return;
+    }
+
+    const char *data_ptr = reinterpret_cast<const char*>(begin);
+    size_t data_size = end - begin;
+    bool is_end_stream = (head.flags & kFlagEndStream) != 0;
+
+    if (!is_end_stream)
+        consumeRecvWindow(stream, head.length);
+
+    if (data_size > 0) {
+        if (stream->sp_ctx != nullptr) {
+            auto sp_ctx = stream->sp_ctx;
+            sp_ctx->onBody(data_ptr, data_size);
+        } else if (stream->sp_req != nullptr) {
+            stream->sp_req->body.append(data_ptr, data_size);
+        }
+    }
+
+    if (is_end_stream && findStream(head.stream_id) != nullptr)
+        onRemoteEnd(head.stream_id);
+}
+
+//! Body 收到即被取走，所以直接归还窗口，用完一半时再告知对方，以减少 WINDOW_UPDATE 帧
+void Http2Session::consumeRecvWindow(Stream *stream, size_t size)
+{
+    if (stream == nullptr) {
+        conn_recv_window_ -= size;
+        if (conn_recv_window_ <= kConnRecvWindow / 2) {
+            sendWindowUpdate(0, kConnRecvWindow - conn_recv_window_);
+            conn_recv_window_ = kConnRecvWindow;
+        }
+    } else {
+        stream->recv_window -= size;
+        if (stream->recv_window <= kStreamRecvWindow / 2) {
+            sendWindowUpdate(stream->id, kStreamRecvWindow - stream->recv_window);
+            stream->recv_window = kStreamRecvWindow;
+        }
+    }
+}
+
+void Http2Session::onSettingsFrame(const FrameHead &head, const uint8_t *payload)
+{
+    if (head.stream_id != 0) {
+        goaway(ErrorCode::kProtocolError);
+        return;
+    }
+
+    if (head.flags & kFlagAck) {
+        if (head.length != 0)
+            goaway(ErrorCode::kFrameSizeError);
+        return;
+    }
+
+    if (head.length % 6 != 0) {
+        goaway(ErrorCode::kFrameSizeError);
+        return;
+    }
+
+    if (!applySettings(payload, head.length))
+        return;
+
+    sendFrame(FrameType::kSettings, kFlagAck, 0);
+    flushAllStreams();
+}
+
+bool Http2Session::applySettings(const uint8_t *data_ptr, size_t data_size)
+{
+    for (size_t pos = 0; pos + 6 <= data_size; pos += 6) {
+        auto id = static_cast<SettingId>((data_ptr[pos] << 8) | data_ptr[pos + 1]);
+        uint32_t value = ReadUint32(data_ptr + pos + 2);
+
+        switch (id) {
+            case SettingId::kHeaderTableSize:
+                encoder_.setMaxTableSize(value);
+                break;
+
+            case SettingId::kEnablePush:
+                if (value > 1) {
+                    goaway(ErrorCode::kProtocolError);
+                    return false;
+                }
+                break;
+
+            case SettingId::kInitialWindowSize: {
+                if (value > kMaxWindowSize) {
+                    goaway(ErrorCode::kFlowControlError);
+                    return false;
+                }
+                //! 调整所有 stream 的发送窗口
+                int64_t delta = static_cast<int64_t>(value) - peer_initial_window_;
+                peer_initial_window_ = value;
+                for (auto &item : streams_)
+                    item.second->send_window += delta;
+                break;
+            }
+
+            case SettingId::kMaxFrameSize:
+                if (value < kDefaultMaxFrameSize || value > kMaxMaxFrameSize) {
+                    goaway(ErrorCode::kProtocolError);
+                    return false;
+                }
+                peer_max_frame_size_ = value;
+                break;
+
+            default:    //! 其它的不影响发送
+                break;
+        }
+    }
+    return true;
+}
+
+void Http2Session::onWindowUpdateFrame(const FrameHead &head, const uint8_t *payload)
+{
+    if (head.length != 4) {
+        goaway(ErrorCode::kFrameSizeError);
+        return;
+    }
+
+    uint32_t increment = ReadUint32(payload) & 0x7fffffff;
+
+    if (head.stream_id == 0) {
+        if (increment == 0 || conn_send_window_ + increment > kMaxWindowSize) {
+            goaway(increment == 0 ? ErrorCode::kProtocolError : ErrorCode::kFlowControlError);
+            return;
+        }
+        conn_send_window_ += increment;
+        flushAllStreams();
+        return;
+    }
+
+    auto stream = findStream(head.stream_id);
+    if (stream == nullptr)
+        return;
+
+    if (increment == 0 || stream->send_window + increment > kMaxWindowSize) {
+        sendRstStream(head.stream_id, increment == 0 ? ErrorCode::kProtocolError : ErrorCode::kFlowControlError);
+        return;
+    }
+
+    stream->send_window += increment;
+    flushStream(stream);
+    //! 剩余的数据可能已连同 END_STREAM 一起发出
+    tryCloseStream(head.stream_id);
+    scheduleWritable();
+}
+
+void Http2Session::onRstStreamFrame(const FrameHead &head, const uint8_t *)
+{
+    if (head.stream_id == 0 || head.stream_id > last_stream_id_) {
+        goaway(ErrorCode::kProtocolError);
+        return;
+    }
+
+    if (head.length != 4) {
+        goaway(ErrorCode::kFrameSizeError);
+        return;
+    }
+
+    removeStream(head.stream_id);
+}
+
+Http2Session::Stream* Http2Session::findStream(uint32_t stream_id) const
+{
+    auto iter = streams_.find(stream_id);
+    return iter != streams_.end() ? iter->second : nullptr;
+}
+
+void Http2Session::tryCloseStream(uint32_t stream_id)
+{
+    auto stream = findStream(stream_id);
+    if (stream != nullptr && stream->is_remote_closed && stream->is_local_closed)
+        removeStream(stream_id);
+}
+
+void Http2Session::removeStream(uint32_t stream_id)
+{
+    auto iter = streams_.find(stream_id);
+    if (iter == streams_.end())
+        return;
+
+    //! 先移出再释放，因为释放 Context 时会回调到本对象
+    auto stream = iter->second;
+    streams_.erase(iter);
+    delete stream;
+
+    if (is_goaway_received_ && streams_.empty())
+        scheduleClose();
+}
+
+void Http2Session::sendFrame(FrameType type, uint8_t flags, uint32_t stream_id, const void *data_ptr, size_t data_size)
+{
+    uint8_t head[kFrameHeadSize];
+    WriteFrameHead(head, data_size, type, flags, stream_id);
+
+    struct iovec iov[2] = {
+        { head, kFrameHeadSize },
+        { const_cast<void*>(data_ptr), data_size },
+    };
+    tcp_server_.sendv(ct_, iov, data_size > 0 ? 2 : 1);
+}
+
+void Http2Session::sendSettings(const string &extra_settings)
+{
+    string payload;
+    AppendSetting(payload, SettingId::kMaxConcurrentStreams, kMaxConcurrentStreams);
+    AppendSetting(payload, SettingId::kInitialWindowSize, kStreamRecvWindow);
+    AppendSetting(payload, SettingId::kMaxHeaderListSize, kMaxHeaderListSize);
+    payload += extra_settings;
+    sendFrame(FrameType::kSettings, 0, 0, payload.data(), payload.size());
+
+    //! 连接级的窗口不能通过 SETTINGS 设置
+    sendWindowUpdate(0, kConnRecvWindow - kDefaultWindowSize);
+    conn_recv_window_ = kConnRecvWindow;
+}
+
+void Http2Session::sendHeaders(Stream *stream, const string &block, bool is_end_stream)
+{
+    stream->is_head_sent = true;
+
+    //! 超出帧大小的部分用 CONTINUATION 发送
+    size_t pos = 0;
+    FrameType type = FrameType::kHeaders;
+    do {
+        size_t size = std::min<size_t>(block.size() - pos, peer_max_frame_size_);
+        uint8_t flags = 0;
+        if (type == FrameType::kHeaders && is_end_stream)
+            flags |= kFlagEndStream;
+        if (pos + size == block.size())
+            flags |= kFlagEndHeaders;
+        sendFrame(type, flags, stream->id, block.data() + pos, size);
+        pos += size;
+        type = FrameType::kContinuation;
+    } while (pos < block.size());
+
+    if (is_end_stream) {
+        stream->is_local_closed = true;
+        stream->writable_cb = nullptr;
+    }
+}
+
+void Http2Session::sendRstStream(uint32_t stream_id, ErrorCode code)
+{
+    string payload;
+    AppendUint32(payload, static_cast<uint32_t>(code));
+    sendFrame(FrameType::kRstStream, 0, stream_id, payload.data(), payload.size());
+    removeStream(stream_id);
+}
+
+void Http2Session::sendWindowUpdate(uint32_t stream_id, uint32_t increment)
+{
+    string payload;
+    AppendUint32(payload, increment);
+    sendFrame(FrameType::kWindowUpdate, 0, stream_id, payload.data(), payload.size());
+}
+
+void Http2Session::goaway(ErrorCode code)
+{
+    if (is_goaway_sent_)
+        return;
+    is_goaway_sent_ = true;
+
+    if (code != ErrorCode::kNoError)
+        LogNotice("goaway, error:%u", static_cast<uint32_t>(code));
+
+    string payload;
+    AppendUint32(payload, last_stream_id_);
+    AppendUint32(payload, static_cast<uint32_t>(code));
+    sendFrame(FrameType::kGoaway, 0, 0, payload.data(), payload.size());
+    scheduleClose();
+}
+
+void Http2Session::encodeHead(const Respond &res, bool has_body_size, size_t body_size, string &block)
+{
+    char status[8];
+    int status_len = ::snprintf(status, sizeof(status), "%d", static_cast<int>(res.status_code));
+
+    block.clear();
+    encoder_.begin(block);
+    encoder_.encode(":status", 7, status, status_len, block);
+
+    string name;
+    bool has_date = false;
+    bool has_content_length = false;
+    for (auto &field : res.headers) {
+        if (IsConnectionSpecific(field.id))
+            continue;
+        if (field.id == HeaderId::kDate)
+            has_date = true;
+        else if (field.id == HeaderId::kContentLength)
+            has_content_length = true;
+
+        //! HTTP/2 的头部名称必须为小写
+        name = field.first;
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        encoder_.encode(name, field.second, block);
+    }
+
+    if (!has_date) {
+        auto &date = wp_server_->dateHeader();
+        //! 去掉 "Date: " 与结尾的 CRLF
+        encoder_.encode("date", 4, date.data() + 6, date.size() - 8, block);
+    }
+
+    if (has_body_size && !has_content_length) {
+        char size_str[24];
+        int size_len = ::snprintf(size_str, sizeof(size_str), "%zu", body_size);
+        encoder_.encode("content-length", 14, size_str, size_len, block);
+    }
+}
+
+void Http2Session::commitRespond(int stream_id, Respond *res)
+{
+    auto stream = findStream(stream_id);
+    if (stream == nullptr || stream->is_head_sent) {
+        wp_server_->sp_pool_->freeRespond(res);
+        return;
+    }
+
+    if (wp_server_->context_log_enable_)
+        LogDbg("RES: [%d %s]", static_cast<int>(res->status_code), res->body.c_str());
+
+    encodeHead(*res, true, res->body.size(), head_buff_);
+
+    if (res->body.empty()) {
+        sendHeaders(stream, head_buff_, true);
+    } else {
+        sendHeaders(stream, head_buff_, false);
+        struct iovec iov = { const_cast<char*>(res->body.data()), res->body.size() };
+        appendRespond(stream_id, &iov, 1, true);
+    }
+
+    wp_server_->sp_pool_->freeRespond(res);
+    tryCloseStream(stream_id);
+}
+
+void Http2Session::appendRespondHead(int stream_id, const Respond &res)
+{
+    auto stream = findStream(stream_id);
+    if (stream == nullptr || stream->is_head_sent)
+        return;
+
+    encodeHead(res, false, 0, head_buff_);
+    sendHeaders(stream, head_buff_, false);
+}
+
+/**
+ * 前面没有积压时，窗口允许的部分直接从调用者的缓冲发出，只有超出窗口的部分才拷贝暂存
+ */
+void Http2Session::appendRespond(int stream_id, const struct iovec *iov, int iovcnt, bool is_finished)
+{
+    auto stream = findStream(stream_id);
+    if (stream == nullptr || !stream->is_head_sent || stream->is_local_closed || stream->is_end_pending)
+        return;
+
+    for (int i = 0; i < iovcnt; ++i) {
+        const char *data_ptr = static_cast<const char*>(iov[i].iov_base);
+        size_t data_size = iov[i].iov_len;
+        if (data_size == 0)
+            continue;
+
+        size_t sent_size = 0;
+        if (stream->chunks.empty())
+            sent_size = sendData(stream, data_ptr, data_size, is_finished && i == iovcnt - 1);
+
+        if (sent_size < data_size) {
+            Chunk chunk;
+            chunk.data.assign(data_ptr + sent_size, data_size - sent_size);
+            stream->pending_size += chunk.data.size();
+            stream->chunks.push_back(std::move(chunk));
+        }
+    }
+
+    if (is_finished) {
+        stream->is_end_pending = true;
+        stream->writable_cb = nullptr;
+        flushStream(stream);
+        tryCloseStream(stream_id);
+    }
+}
+
+void Http2Session::appendFile(int stream_id, Fd file_fd, off_t offset, size_t size)
+{
+    auto stream = findStream(stream_id);
+    if (stream == nullptr || !stream->is_head_sent || stream->is_local_closed || stream->is_end_pending || size == 0)
+        return;
+
+    Chunk chunk;
+    chunk.fd = file_fd;
+    chunk.offset = offset;
+    chunk.size = size;
+    stream->pending_size += size;
+    stream->chunks.push_back(std::move(chunk));
+    flushStream(stream);
+}
+
+//! 按窗口发送 DATA 帧，返回已发送的长度。is_last 表示这是最后的数据，全部发出时带上 END_STREAM
+size_t Http2Session::sendData(Stream *stream, const char *data_ptr, size_t data_size, bool is_last)
+{
+    size_t sent_size = 0;
+    while (sent_size < data_size) {
+        int64_t window = std::min(conn_send_window_, stream->send_window);
+        if (window <= 0)
+            break;
+
+        size_t size = std::min<size_t>({ data_size - sent_size, static_cast<size_t>(window), peer_max_frame_size_ });
+        bool is_end = is_last && sent_size + size == data_size;
+        sendFrame(FrameType::kData, is_end ? kFlagEndStream : 0, stream->id, data_ptr + sent_size, size);
+
+        sent_size += size;
+        conn_send_window_ -= size;
+        stream->send_window -= size;
+        if (is_end)
+            stream->is_local_closed = true;
+    }
+    return sent_size;
+}
+
+void Http2Session::flushStream(Stream *stream)
+{
+    while (!stream->chunks.empty()) {
+        auto &chunk = stream->chunks.front();
+        bool is_last = stream->is_end_pending && stream->chunks.size() == 1;
+
+        if (chunk.fd.isNull()) {
+            size_t remain_size = chunk.data.size() - chunk.offset;
+            size_t sent_size = sendData(stream, chunk.data.data() + chunk.offset, remain_size, is_last);
+            chunk.offset += sent_size;
+            stream->pending_size -= sent_size;
+            if (sent_size < remain_size)
+                return;
+
+        } else {
+            //! 文件数据用 sendfile() 发送，帧头单独发
+            while (chunk.size > 0) {
+                int64_t window = std::min(conn_send_window_, stream->send_window);
+                if (window <= 0)
+                    return;
+
+                size_t size = std::min<size_t>({ chunk.size, static_cast<size_t>(window), peer_max_frame_size_ });
+                bool is_end = is_last && size == chunk.size;
+                uint8_t head[kFrameHeadSize];
+                WriteFrameHead(head, size, FrameType::kData, is_end ? kFlagEndStream : 0, stream->id);
+                tcp_server_.send(ct_, head, kFrameHeadSize);
+                tcp_server_.sendFile(ct_, chunk.fd, chunk.offset, size);
+
+                chunk.offset += size;
+                chunk.size -= size;
+                stream->pending_size -= size;
+                conn_send_window_ -= size;
+                stream->send_window -= size;
+                if (is_end)
+                    stream->is_local_closed = true;
+            }
+        }
+
+        stream->chunks.pop_front();
+    }
+
+    //! 没有数据了，用空的 DATA 帧结束
+    if (stream->is_end_pending && !stream->is_local_closed) {
+        sendFrame(FrameType::kData, kFlagEndStream, stream->id);
+        stream->is_local_closed = true;
+    }
+}
+
+void Http2Session::flushAllStreams()
+{
+    vector<uint32_t> closed_ids;
+    for (auto &item : streams_) {
+        auto stream = item.second;
+        if (stream->chunks.empty())
+            continue;
+
+        flushStream(stream);
+        if (stream->is_local_closed)
+            closed_ids.push_back(stream->id);
+        if (conn_send_window_ <= 0)
+            break;
+    }
+
+    for (auto id : closed_ids)
+        tryCloseStream(id);
+
+    scheduleWritable();
+}
+
+bool Http2Session::isWritable(int stream_id) const
+{
+    auto stream = findStream(stream_id);
+    if (stream == nullptr || stream->is_local_closed || stream->is_end_pending)
+        return false;
+
+    return stream->pending_size < kStreamPendingHighWater &&
+           tcp_server_.getSendBufferSize(ct_) < kSendBufferHighWater;
+}
+
+void Http2Session::setWritableCallback(int stream_id, const function<void()> &cb)
+{
+    auto stream = findStream(stream_id);
+    if (stream == nullptr || stream->is_local_closed || stream->is_end_pending)
+        return;
+
+    stream->writable_cb = cb;
+    scheduleWritable();
+}
+
+/**
+ * 在下一轮回调所有可写的流式回复，不在当前调用栈中直接回调，理由同 Server::Impl::scheduleWritable()
+ */
+void Http2Session::scheduleWritable()
+{
+    if (writable_run_id_ != 0)
+        return;
+
+    bool has_cb = std::any_of(streams_.begin(), streams_.end(),
+        [] (const pair<const uint32_t, Stream*> &item) { return bool(item.second->writable_cb); });
+    if (!has_cb)
+        return;
+
+    writable_run_id_ = wp_loop_->runNext(
+        [this] {
+            writable_run_id_ = 0;
+
+            vector<uint32_t> ids;
+            for (auto &item : streams_) {
+                if (item.second->writable_cb && isWritable(item.first))
+                    ids.push_back(item.first);
+            }
+
+            //! 回调中可能会释放 stream，每次都要重新查找
+            for (auto id : ids) {
+                auto stream = findStream(id);
+                if (stream == nullptr || !stream->writable_cb || !isWritable(id))
+                    continue;
+                auto cb = stream->writable_cb;
+                cb();
+            }
+        },
+        "http::Http2Session::scheduleWritable"
+    );
+}
+
+//! 不能在当前调用栈中关闭，因为关闭会释放本对象
+void Http2Session::scheduleClose()
+{
+    if (close_run_id_ != 0)
+        return;
+
+    close_run_id_ = wp_loop_->runNext(
+        [this] {
+            close_run_id_ = 0;
+            wp_server_->closeConnection(ct_);
+        },
+        "http::Http2Session::scheduleClose"
+    );
+}
+
+}
+}
+}
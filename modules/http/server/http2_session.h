@@ -0,0 +1,182 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_SERVER_HTTP2_SESSION_H_20251019
+#define TBOX_HTTP_SERVER_HTTP2_SESSION_H_20251019
+
+#include <map>
+#include <deque>
+#include <string>
+#include <functional>
+#include <sys/uio.h>
+
+#include <tbox/base/defines.h>
+#include <tbox/event/loop.h>
+#include <tbox/network/tcp_server.h>
+
+#include "../http2/frame.h"
+#include "../http2/hpack.h"
+#include "server.h"
+
+namespace tbox {
+namespace http {
+namespace server {
+
+/**
+ * 一个 HTTP/2 连接 (h2c)
+ *
+ * 由 Server::Impl 在收到连接序言 (prior knowledge)，或 HTTP/1.1 的 Upgrade: h2c 请求后创建，
+ * 接管该连接的收发。每个 stream 上的请求都生成一个 Context 交给中间件处理，
+ * Context 的 index 即为 stream id，回复经 Server::Impl 转到这里编成 HEADERS 与 DATA 帧发出。
+ * 不同 stream 的回复互不等待，DATA 帧受对方的连接与 stream 两级流控窗口约束
+ */
+class Http2Session {
+  public:
+    Http2Session(Server::Impl *wp_server, const network::TcpServer::ConnToken &ct);
+    ~Http2Session();
+
+    NONCOPYABLE(Http2Session);
+
+    //! 以 prior knowledge 方式开始，对方会先发出连接序言
+    void start();
+
+    /**
+     * 由 HTTP/1.1 的 Upgrade: h2c 请求升级而来，调用前须已回复 101
+     * \param settings  已解码的 HTTP2-Settings，见 DecodeSettings()
+     * \param req       升级的请求，作为 stream 1 处理
+     */
+    void startUpgrade(const std::string &settings, Request *req);
+
+    //! 解码 HTTP2-Settings 头的值 (base64url)，格式不对时返回 false
+    static bool DecodeSettings(const std::string &value, std::string &settings);
+
+    //! 处理收到的数据
+    void onReceived(network::Buffer &buff);
+    //! 发送缓冲已空
+    void onSendCompleted();
+
+    //! 以下对应 Server::Impl 中的同名函数，index 即 stream id
+    void commitRespond(int stream_id, Respond *res);
+    void appendRespondHead(int stream_id, const Respond &res);
+    void appendRespond(int stream_id, const struct iovec *iov, int iovcnt, bool is_finished);
+    void appendFile(int stream_id, network::Fd file_fd, off_t offset, size_t size);
+    bool isWritable(int stream_id) const;
+    void setWritableCallback(int stream_id, const std::function<void()> &cb);
+
+  private:
+    //! 一段待发送的 DATA 负载，内存数据或文件
+    struct Chunk {
+        std::string data;
+        network::Fd fd;
+        off_t offset = 0;   //!< 内存数据中已发出的长度，或文件中的位置
+        size_t size = 0;    //!< 文件中未发出的长度
+    };
+
+    struct Stream {
+        uint32_t id = 0;
+        Request *sp_req = nullptr;  //!< 正在接收Body的请求，收齐后再交给中间件
+        ContextSptr sp_ctx;         //!< 流式接收Body的请求
+        bool is_remote_closed = false;
+        bool is_local_closed = false;   //!< 已发出 END_STREAM
+        bool is_head_sent = false;
+        bool is_end_pending = false;    //!< 回复已结束，待 chunks 发完后发出 END_STREAM
+        int64_t send_window = 0;
+        int64_t recv_window = 0;
+        std::deque<Chunk> chunks;   //!< 受流控窗口限制未能发出的数据
+        size_t pending_size = 0;
+        std::function<void()> writable_cb;
+
+        ~Stream();
+    };
+
+    using Fields = http2::HeaderFields;
+
+    void onFrame(const http2::FrameHead &head, const uint8_t *payload);
+    void onHeadersFrame(const http2::FrameHead &head, const uint8_t *payload);
+    void onContinuationFrame(const http2::FrameHead &head, const uint8_t *payload);
+    void onDataFrame(const http2::FrameHead &head, const uint8_t *payload);
+    void onSettingsFrame(const http2::FrameHead &head, const uint8_t *payload);
+    void onWindowUpdateFrame(const http2::FrameHead &head, const uint8_t *payload);
+    void onRstStreamFrame(const http2::FrameHead &head, const uint8_t *payload);
+
+    void onHeaderBlock(uint32_t stream_id, bool is_end_stream);
+    Request* makeRequest(const Fields &fields);
+    void openStream(uint32_t stream_id, Request *req, bool is_end_stream);
+    void onRemoteEnd(uint32_t stream_id);
+    void dispatch(uint32_t stream_id, Request *req, bool is_body_streaming);
+    bool applySettings(const uint8_t *data_ptr, size_t data_size);
+
+    Stream* findStream(uint32_t stream_id) const;
+    void tryCloseStream(uint32_t stream_id);
+    void removeStream(uint32_t stream_id);
+
+    void sendFrame(http2::FrameType type, uint8_t flags, uint32_t stream_id, const void *data_ptr = nullptr, size_t data_size = 0);
+    void sendSettings(const std::string &extra_settings = "");
+    void sendHeaders(Stream *stream, const std::string &block, bool is_end_stream);
+    void sendRstStream(uint32_t stream_id, http2::ErrorCode code);
+    void sendWindowUpdate(uint32_t stream_id, uint32_t increment);
+    void goaway(http2::ErrorCode code);
+
+    void encodeHead(const Respond &res, bool has_body_size, size_t body_size, std::string &block);
+    size_t sendData(Stream *stream, const char *data_ptr, size_t data_size, bool is_last);
+    void flushStream(Stream *stream);
+    void flushAllStreams();
+    void consumeRecvWindow(Stream *stream, size_t size);
+
+    void scheduleWritable();
+    void scheduleClose();
+
+  private:
+    Server::Impl *wp_server_;
+    event::Loop *wp_loop_;
+    network::TcpServer &tcp_server_;
+    network::TcpServer::ConnToken ct_;
+
+    http2::HpackDecoder decoder_;
+    http2::HpackEncoder encoder_;
+
+    std::map<uint32_t, Stream*> streams_;
+    uint32_t last_stream_id_ = 0;   //!< 对方开启的最大的 stream id
+
+    bool is_preface_received_ = false;
+    bool is_goaway_sent_ = false;
+    bool is_goaway_received_ = false;
+
+    //! 未收齐的头部块
+    uint32_t continuation_stream_id_ = 0;
+    bool is_continuation_end_stream_ = false;
+    std::string header_block_;
+
+    //! 对方的设置
+    uint32_t peer_initial_window_ = http2::kDefaultWindowSize;
+    uint32_t peer_max_frame_size_ = http2::kDefaultMaxFrameSize;
+
+    int64_t conn_send_window_ = http2::kDefaultWindowSize;
+    int64_t conn_recv_window_ = http2::kDefaultWindowSize;
+
+    std::string head_buff_;     //!< 复用的头部块缓冲
+    event::Loop::RunId writable_run_id_ = 0;
+    event::Loop::RunId close_run_id_ = 0;
+};
+
+}
+}
+}
+
+#endif //TBOX_HTTP_SERVER_HTTP2_SESSION_H_20251019
@@ -0,0 +1,499 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <tbox/event/loop.h>
+#include <tbox/event/timer_event.h>
+#include <tbox/network/buffered_fd.h>
+
+#include "server.h"
+#include "../http2/frame.h"
+#include "../http2/hpack.h"
+
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::network;
+using namespace tbox::http;
+using namespace tbox::http::server;
+using namespace tbox::http::http2;
+
+namespace {
+
+const char *kBindAddr = "127.0.0.1:51084";
+
+BufferedFd* Connect(Loop *wp_loop)
+{
+    int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(51084);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (::connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        ::close(sock);
+        return nullptr;
+    }
+
+    Fd fd(sock);
+    fd.setNonBlock(true);
+
+    auto client = new BufferedFd(wp_loop);
+    client->initialize(fd);
+    client->enable();
+    return client;
+}
+
+std::string MakeFrame(FrameType type, uint8_t flags, uint32_t stream_id, const std::string &payload = "")
+{
+    std::string frame;
+    AppendFrameHead(frame, payload.size(), type, flags, stream_id);
+    return frame + payload;
+}
+
+std::string MakeSetting(SettingId id, uint32_t value)
+{
+    std::string setting;
+    setting.push_back(static_cast<char>(static_cast<uint16_t>(id) >> 8));
+    setting.push_back(static_cast<char>(id));
+    AppendUint32(setting, value);
+    return setting;
+}
+
+std::string MakeRequestHeaders(HpackEncoder &encoder, const char *method, const char *path)
+{
+    std::string block;
+    encoder.begin(block);
+    encoder.encode(":method", 7, method, ::strlen(method), block);
+    encoder.encode(":scheme", 7, "http", 4, block);
+    encoder.encode(":path", 5, path, ::strlen(path), block);
+    encoder.encode(":authority", 10, "localhost", 9, block);
+    return block;
+}
+
+//! 客户端收到的各 stream 的回复
+struct StreamResult {
+    HeaderFields heads;
+    std::string body;
+    bool is_ended = false;
+};
+
+struct Received {
+    std::map<uint32_t, StreamResult> streams;
+    std::vector<uint32_t> end_order;    //!< 各 stream 结束的先后
+    bool is_goaway = false;
+    uint32_t goaway_error = 0;
+    std::vector<uint32_t> rst_streams;
+};
+
+//! 解析收到的帧，跳过前面的 HTTP/1.1 101 回复
+void ParseFrames(std::string data, HpackDecoder &decoder, Received &result)
+{
+    if (data.compare(0, 5, "HTTP/") == 0)
+        data.erase(0, data.find("\r\n\r\n") + 4);
+
+    size_t pos = 0;
+    while (data.size() - pos >= kFrameHeadSize) {
+        FrameHead head;
+        ParseFrameHead(reinterpret_cast<const uint8_t*>(data.data() + pos), head);
+        if (data.size() - pos < kFrameHeadSize + head.length)
+            break;
+
+        const char *payload = data.data() + pos + kFrameHeadSize;
+        auto &stream = result.streams[head.stream_id];
+        if (head.type == FrameType::kHeaders) {
+            decoder.decode(payload, head.length, stream.heads);
+        } else if (head.type == FrameType::kData) {
+            stream.body.append(payload, head.length);
+        } else if (head.type == FrameType::kGoaway) {
+            result.is_goaway = true;
+            result.goaway_error = ReadUint32(reinterpret_cast<const uint8_t*>(payload) + 4);
+        } else if (head.type == FrameType::kRstStream) {
+            result.rst_streams.push_back(head.stream_id);
+        }
+
+        if ((head.type == FrameType::kHeaders || head.type == FrameType::kData) && (head.flags & kFlagEndStream)) {
+            stream.is_ended = true;
+            result.end_order.push_back(head.stream_id);
+        }
+        pos += kFrameHeadSize + head.length;
+    }
+    result.streams.erase(0);
+}
+
+std::string GetHead(const StreamResult &stream, const std::string &name)
+{
+    for (auto &field : stream.heads)
+        if (field.name == name)
+            return field.value;
+    return "";
+}
+
+}
+
+TEST(Http2, PriorKnowledgeMultiplex)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        //! /slow 延后回复，不应阻塞后面的 /fast
+        ContextSptr slow_ctx;
+        server.use(
+            [&] (ContextSptr ctx, const NextFunc &) {
+                EXPECT_EQ(ctx->req().http_ver, HttpVer::k2_0);
+                EXPECT_EQ(ctx->req().headers["Host"], "localhost");
+                ctx->res().status_code = StatusCode::k200_OK;
+                if (ctx->req().url.path == "/slow") {
+                    ctx->res().body = "slow";
+                    slow_ctx = ctx;
+                } else {
+                    ctx->res().headers["Content-Type"] = "text/plain";
+                    ctx->res().body = "fast:" + ctx->req().body;
+                }
+            }
+        );
+        server.start();
+
+        auto client = Connect(sp_loop);
+        ASSERT_NE(client, nullptr);
+
+        std::string received;
+        client->setReceiveCallback(
+            [&] (Buffer &buff) {
+                received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+
+        HpackEncoder encoder;
+        std::string text(kClientPreface, kClientPrefaceSize);
+        text += MakeFrame(FrameType::kSettings, 0, 0);
+        text += MakeFrame(FrameType::kHeaders, kFlagEndHeaders | kFlagEndStream, 1, MakeRequestHeaders(encoder, "GET", "/slow"));
+        text += MakeFrame(FrameType::kHeaders, kFlagEndHeaders, 3, MakeRequestHeaders(encoder, "POST", "/fast"));
+        text += MakeFrame(FrameType::kData, 0, 3, "abc");
+        text += MakeFrame(FrameType::kData, kFlagEndStream, 3, "def");
+        client->send(text.data(), text.size());
+
+        auto timer = sp_loop->newTimerEvent();
+        timer->initialize(std::chrono::milliseconds(20), Event::Mode::kOneshot);
+        timer->setCallback([&] { slow_ctx.reset(); });
+        timer->enable();
+
+        sp_loop->exitLoop(std::chrono::milliseconds(100));
+        sp_loop->runLoop();
+
+        HpackDecoder decoder;
+        Received result;
+        ParseFrames(received, decoder, result);
+
+        ASSERT_EQ(result.end_order, (std::vector<uint32_t>{3, 1}));
+        auto &fast = result.streams[3];
+        EXPECT_EQ(GetHead(fast, ":status"), "200");
+        EXPECT_EQ(GetHead(fast, "content-type"), "text/plain");
+        EXPECT_EQ(GetHead(fast, "content-length"), "11");
+        EXPECT_NE(GetHead(fast, "date"), "");
+        EXPECT_EQ(fast.body, "fast:abcdef");
+        EXPECT_EQ(result.streams[1].body, "slow");
+        EXPECT_FALSE(result.is_goaway);
+
+        delete timer;
+        delete client;
+    }
+    delete sp_loop;
+}
+
+TEST(Http2, Upgrade)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+        server.use(
+            [&] (ContextSptr ctx, const NextFunc &) {
+                EXPECT_EQ(ctx->req().http_ver, HttpVer::k2_0);
+                ctx->res().status_code = StatusCode::k200_OK;
+                ctx->res().body = ctx->req().url.path;
+            }
+        );
+        server.start();
+
+        auto client = Connect(sp_loop);
+        ASSERT_NE(client, nullptr);
+
+        std::string received;
+        client->setReceiveCallback(
+            [&] (Buffer &buff) {
+                received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+
+        //! HTTP2-Settings: SETTINGS_MAX_CONCURRENT_STREAMS = 100
+        HpackEncoder encoder;
+        std::string text = \
+            "GET /first HTTP/1.1\r\n"
+            "Host: localhost\r\n"
+            "Connection: Upgrade, HTTP2-Settings\r\n"
+            "Upgrade: h2c\r\n"
+            "HTTP2-Settings: AAMAAABk\r\n"
+            "\r\n";
+        text.append(kClientPreface, kClientPrefaceSize);
+        text += MakeFrame(FrameType::kSettings, 0, 0);
+        text += MakeFrame(FrameType::kHeaders, kFlagEndHeaders | kFlagEndStream, 3, MakeRequestHeaders(encoder, "GET", "/second"));
+        client->send(text.data(), text.size());
+
+        sp_loop->exitLoop(std::chrono::milliseconds(50));
+        sp_loop->runLoop();
+
+        EXPECT_EQ(received.compare(0, 34, "HTTP/1.1 101 Switching Protocols\r\n"), 0);
+
+        HpackDecoder decoder;
+        Received result;
+        ParseFrames(received, decoder, result);
+        EXPECT_EQ(result.streams[1].body, "/first");
+        EXPECT_EQ(result.streams[3].body, "/second");
+        EXPECT_EQ(result.end_order.size(), 2u);
+
+        delete client;
+    }
+    delete sp_loop;
+}
+
+TEST(Http2, FlowControl)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        int writable_count = 0;
+        server.use(
+            [&] (ContextSptr ctx, const NextFunc &) {
+                ctx->res().status_code = StatusCode::k200_OK;
+                if (ctx->req().url.path == "/end") {
+                    ctx->write(std::string(300, 'c'));
+                    ctx->end();
+                    return;
+                }
+                ctx->write(std::string(300, 'a'));
+                ctx->setWritableCallback(
+                    [&, ctx] {
+                        ++writable_count;
+                        ctx->write(std::string(300, 'b'));
+                        ctx->end();
+                    }
+                );
+            }
+        );
+        server.start();
+
+        auto client = Connect(sp_loop);
+        ASSERT_NE(client, nullptr);
+
+        std::string received;
+        client->setReceiveCallback(
+            [&] (Buffer &buff) {
+                received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+
+        //! stream 的窗口只有 100
+        HpackEncoder encoder;
+        std::string text(kClientPreface, kClientPrefaceSize);
+        text += MakeFrame(FrameType::kSettings, 0, 0, MakeSetting(SettingId::kInitialWindowSize, 100));
+        text += MakeFrame(FrameType::kHeaders, kFlagEndHeaders | kFlagEndStream, 1, MakeRequestHeaders(encoder, "GET", "/"));
+        client->send(text.data(), text.size());
+
+        auto timer = sp_loop->newTimerEvent();
+        timer->initialize(std::chrono::milliseconds(20), Event::Mode::kOneshot);
+        timer->setCallback(
+            [&] {
+                HpackDecoder decoder;
+                Received result;
+                ParseFrames(received, decoder, result);
+                EXPECT_EQ(result.streams[1].body, std::string(100, 'a'));
+                EXPECT_FALSE(result.streams[1].is_ended);
+
+                //! 放开窗口，剩下的数据与 END_STREAM 都应发出
+                std::string increment;
+                AppendUint32(increment, 1000);
+                std::string text = MakeFrame(FrameType::kWindowUpdate, 0, 1, increment);
+
+                //! 再依次发起超过并发上限个数的 stream，END_STREAM 都在 WINDOW_UPDATE 时发出，
+                //! 结束的 stream 须被释放，否则之后的 stream 会被拒绝
+                for (uint32_t id = 3; id <= 201; id += 2) {
+                    text += MakeFrame(FrameType::kHeaders, kFlagEndHeaders | kFlagEndStream, id, MakeRequestHeaders(encoder, "GET", "/end"));
+                    text += MakeFrame(FrameType::kWindowUpdate, 0, id, increment);
+                }
+                client->send(text.data(), text.size());
+            }
+        );
+        timer->enable();
+
+        sp_loop->exitLoop(std::chrono::milliseconds(100));
+        sp_loop->runLoop();
+
+        HpackDecoder decoder;
+        Received result;
+        ParseFrames(received, decoder, result);
+        EXPECT_EQ(writable_count, 1);
+        EXPECT_EQ(result.streams[1].body, std::string(300, 'a') + std::string(300, 'b'));
+        EXPECT_TRUE(result.streams[1].is_ended);
+        EXPECT_EQ(GetHead(result.streams[1], "transfer-encoding"), "");
+
+        EXPECT_TRUE(result.rst_streams.empty());
+        for (uint32_t id = 3; id <= 201; id += 2) {
+            EXPECT_EQ(result.streams[id].body, std::string(300, 'c')) << id;
+            EXPECT_TRUE(result.streams[id].is_ended) << id;
+        }
+
+        delete timer;
+        delete client;
+    }
+    delete sp_loop;
+}
+
+TEST(Http2, ProtocolError)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        int req_count = 0;
+        server.use(
+            [&] (ContextSptr ctx, const NextFunc &) {
+                ++req_count;
+                ctx->res().status_code = StatusCode::k200_OK;
+            }
+        );
+        server.start();
+
+        auto client = Connect(sp_loop);
+        ASSERT_NE(client, nullptr);
+
+        std::string received;
+        bool is_disconnected = false;
+        client->setReceiveCallback(
+            [&] (Buffer &buff) {
+                received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+        client->setReadZeroCallback([&] { is_disconnected = true; });
+
+        //! 缺少 :method 的请求只重置该 stream，偶数的 stream id 则是连接错误
+        HpackEncoder encoder;
+        std::string bad_block;
+        encoder.begin(bad_block);
+        encoder.encode(":path", 5, "/", 1, bad_block);
+
+        std::string text(kClientPreface, kClientPrefaceSize);
+        text += MakeFrame(FrameType::kSettings, 0, 0);
+        text += MakeFrame(FrameType::kHeaders, kFlagEndHeaders | kFlagEndStream, 1, bad_block);
+        text += MakeFrame(FrameType::kHeaders, kFlagEndHeaders | kFlagEndStream, 3, MakeRequestHeaders(encoder, "GET", "/"));
+        text += MakeFrame(FrameType::kHeaders, kFlagEndHeaders | kFlagEndStream, 4, MakeRequestHeaders(encoder, "GET", "/"));
+        client->send(text.data(), text.size());
+
+        sp_loop->exitLoop(std::chrono::milliseconds(50));
+        sp_loop->runLoop();
+
+        HpackDecoder decoder;
+        Received result;
+        ParseFrames(received, decoder, result);
+        EXPECT_EQ(req_count, 1);
+        EXPECT_EQ(result.rst_streams, std::vector<uint32_t>{1});
+        EXPECT_TRUE(result.streams[3].is_ended);
+        EXPECT_TRUE(result.is_goaway);
+        EXPECT_EQ(result.goaway_error, static_cast<uint32_t>(ErrorCode::kProtocolError));
+        EXPECT_TRUE(is_disconnected);
+
+        delete client;
+    }
+    delete sp_loop;
+}
+
+//! 少量字节的索引引用大的表项，解出的头部列表超出上限，只重置该 stream，连接仍可用
+TEST(Http2, HeaderListBomb)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        int req_count = 0;
+        server.use(
+            [&] (ContextSptr ctx, const NextFunc &) {
+                ++req_count;
+                ctx->res().status_code = StatusCode::k200_OK;
+            }
+        );
+        server.start();
+
+        auto client = Connect(sp_loop);
+        ASSERT_NE(client, nullptr);
+
+        std::string received;
+        client->setReceiveCallback(
+            [&] (Buffer &buff) {
+                received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+
+        HpackEncoder encoder;
+        std::string block = MakeRequestHeaders(encoder, "GET", "/");
+        std::string value(3000, 'v');
+        encoder.encode("x", 1, value.data(), value.size(), block);  //! 加入动态表，索引为 62
+        block += std::string(60000, '\xbe');
+
+        std::string text(kClientPreface, kClientPrefaceSize);
+        text += MakeFrame(FrameType::kSettings, 0, 0);
+        const size_t kFrameSize = 16384;
+        for (size_t pos = 0; pos < block.size(); pos += kFrameSize) {
+            bool is_first = pos == 0;
+            bool is_last = pos + kFrameSize >= block.size();
+            text += MakeFrame(is_first ? FrameType::kHeaders : FrameType::kContinuation,
+                              (is_first ? kFlagEndStream : 0) | (is_last ? kFlagEndHeaders : 0),
+                              1, block.substr(pos, kFrameSize));
+        }
+        text += MakeFrame(FrameType::kHeaders, kFlagEndHeaders | kFlagEndStream, 3, MakeRequestHeaders(encoder, "GET", "/"));
+        client->send(text.data(), text.size());
+
+        sp_loop->exitLoop(std::chrono::milliseconds(50));
+        sp_loop->runLoop();
+
+        HpackDecoder decoder;
+        Received result;
+        ParseFrames(received, decoder, result);
+        EXPECT_EQ(req_count, 1);
+        EXPECT_EQ(result.rst_streams, std::vector<uint32_t>{1});
+        EXPECT_TRUE(result.streams[3].is_ended);
+        EXPECT_FALSE(result.is_goaway);
+
+        delete client;
+    }
+    delete sp_loop;
+}
@@ -18,9 +18,10 @@
  * of the source tree.
  */
 #include "request_parser.h"
-#include <limits>
+#include <cstring>
+#include <algorithm>
 #include <tbox/base/defines.h>
-#include <tbox/util/string.h>
+#include "context_pool.h"
 
 namespace tbox {
 namespace http {
@@ -28,132 +29,163 @@ namespace server {
 
 RequestParser::~RequestParser()
 {
+    if (wp_pool_ != nullptr) {
+        wp_pool_->freeRequest(sp_request_);
+        sp_request_ = nullptr;
+    }
     CHECK_DELETE_RESET_OBJ(sp_request_);
 }
 
 size_t RequestParser::parse(const void *data_ptr, size_t data_size)
 {
-    std::string str(static_cast<const char*>(data_ptr), data_size);
-    size_t pos = 0;
+    const char *data_begin = static_cast<const char*>(data_ptr);
+    const char *data_end = data_begin + data_size;
+    const char *pos = data_begin;
 
     if (state_ == State::kInit) {
-        content_length_ = std::numeric_limits<size_t>::max();
+        beginMessage();
+        body_size_ = 0;
+        is_body_streaming_ = false;
         if (sp_request_ == nullptr)
-            sp_request_ = new Request;
-
-        //! 获取 method
-        auto method_str_end = str.find_first_of(' ', pos);
-        auto method_str = str.substr(pos, method_str_end);
-        auto method = StringToMethod(method_str);
-        if (method == Method::kUnset) {
-            state_ = State::kFail;
-            return pos;
-        }
-
-        /* 解析："GET /index.html HTTP/1.1\r\n" */
-        auto end_pos = str.find(CRLF, method_str_end);
-        if (end_pos == std::string::npos)   //! 如果没有找到首行 \r\n，则放弃
-            return 0;
+            sp_request_ = wp_pool_ != nullptr ? wp_pool_->allocRequest() : new Request;
+    }
 
-        sp_request_->method = method;
+    /**
+     * 逐行解析首行与Head：
+     *  GET /index.html HTTP/1.1\r\n
+     *  Content-Length: 12\r\n
+     *  Content-Type: plan/text\r\n
+     *  \r\n
+     * 用 memchr() 查找行尾，libc 中的实现已用上了SIMD指令
+     */
+    while (state_ == State::kInit || state_ == State::kFinishedStartLine) {
+        const char *line_end, *next_line;
+        if (!findLine(pos, data_end, line_end, next_line))
+            return pos - data_begin;
+
+        if (state_ == State::kInit) {
+            if (!parseStartLine(pos, line_end)) {
+                state_ = State::kFail;
+                return pos - data_begin;
+            }
+            state_ = State::kFinishedStartLine;
 
-        //! 获取 url
-        auto url_str_begin = str.find_first_not_of(' ', method_str_end);
-        if (url_str_begin == std::string::npos || url_str_begin >= end_pos) {
-            state_ = State::kFail;
-            return pos;
-        }
+        } else if (line_end == pos) {   //! 找到了空白行
+            state_ = State::kFinishedHeads;
 
-        auto url_str_end = str.find_first_of(' ', url_str_begin);
-        auto url_str = str.substr(url_str_begin, url_str_end - url_str_begin);
-        if (!StringToUrlPath(url_str, sp_request_->url)) {
-            state_ = State::kFail;
-            return pos;
-        }
-
-        //! 获取版本
-        auto ver_str_begin = str.find_first_not_of(' ', url_str_end);
-        if (ver_str_begin == std::string::npos || ver_str_begin >= end_pos) {
-            state_ = State::kFail;
-            return pos;
-        }
+            if (body_stream_threshold_ != kNoContentLength &&
+                (is_chunked_ || (content_length_ != kNoContentLength && content_length_ > body_stream_threshold_))) {
+                //! 流式接收Body，先返回，让使用者有机会取走Request
+                is_body_streaming_ = true;
+                return next_line - data_begin;
+            }
 
-        auto ver_str_end = end_pos;
-        auto ver_str = str.substr(ver_str_begin, ver_str_end - ver_str_begin);
-        if (ver_str.compare(0, 5, "HTTP/") != 0) {
-            state_ = State::kFail;
-            return pos;
-        }
+            if (!is_chunked_ && content_length_ != kNoContentLength && content_length_ > 0)
+                sp_request_->body.reserve(std::min<size_t>(content_length_, 1 << 20));
 
-        auto ver = StringToHttpVer(ver_str);
-        if (ver == HttpVer::kUnset) {
+        } else if (!parseHeader(pos, line_end, sp_request_->headers)) {
             state_ = State::kFail;
-            return pos;
+            return pos - data_begin;
         }
 
-        sp_request_->http_ver = ver;
-
-        pos = end_pos + 2;
-        state_ = State::kFinishedStartLine;
+        pos = next_line;
     }
 
-    if (state_ == State::kFinishedStartLine) {
-        /**
-         * 解析：
-         *  Content-Length: 12\r\n
-         *  Content-Type: plan/text\r\n
-         * 直接遇到空白行
-         */
-        for (;;) {
-            auto end_pos = str.find(CRLF, pos);
-
-            if (end_pos == pos) {   //! 找到了空白行
-                state_ = State::kFinishedHeads;
-                pos += 2;
-                break;
-            } else if (end_pos == std::string::npos) {  //! 当前的Head不完整
-                break;
-            }
+    if (state_ == State::kFinishedHeads) {
+        size_t remain_size = data_end - pos;
 
-            auto colon_pos = str.find_first_of(':', pos);
-            if (colon_pos == std::string::npos || colon_pos >= end_pos) {
+        if (is_chunked_) {
+            ChunkResult result;
+            pos = parseChunkedBody(pos, data_end, result);
+            if (result == ChunkResult::kFail)
                 state_ = State::kFail;
-                return pos;
-            }
+            else if (result == ChunkResult::kFinished)
+                finishBody();
 
-            auto head_key = util::string::Strip(str.substr(pos, colon_pos - pos));
-            auto head_value_start_pos = str.find_first_not_of(' ', colon_pos + 1);  //! 要略掉空白
-            if (head_value_start_pos == std::string::npos || head_value_start_pos >= end_pos) {
-                state_ = State::kFail;
-                return pos;
+        } else if (content_length_ != kNoContentLength) { //! 如果有指定 Content-Length，收到多少取多少
+            size_t take_size = std::min(content_length_ - body_size_, remain_size);
+            onBody(pos, take_size);
+            pos += take_size;
+            if (body_size_ == content_length_)
+                finishBody();
+
+        } else {
+            //! 没有 Content-Length 时，仅 POST 与 PUT 将剩下的数据视为Body，其它请求无Body
+            auto method = sp_request_->method;
+            if (method == Method::kPost || method == Method::kPut) {
+                onBody(pos, remain_size);
+                pos = data_end;
             }
+            finishBody();
+        }
+    }
 
-            auto head_value_end_pos   = end_pos;
-            auto head_value = util::string::Strip(str.substr(head_value_start_pos, head_value_end_pos - head_value_start_pos));
-            sp_request_->headers[head_key] = head_value;
+    return pos - data_begin;
+}
 
-            if (head_key == "Content-Length")
-                content_length_ = std::stoi(head_value);
+void RequestParser::onBody(const char *data_ptr, size_t data_size)
+{
+    if (data_size == 0)
+        return;
+
+    body_size_ += data_size;
+    if (!is_body_streaming_)
+        sp_request_->body.append(data_ptr, data_size);
+    else if (body_cb_)
+        body_cb_(data_ptr, data_size);
+}
 
-            pos = end_pos + 2;
-        }
-    }
-    
-    if (state_ == State::kFinishedHeads) {
-        if (content_length_ != std::numeric_limits<size_t>::max()) { //! 如果有指定 Content-Lenght
-            if ((data_size - pos) >= content_length_) {
-                sp_request_->body = str.substr(pos, content_length_);
-                pos += content_length_;
-                state_ = State::kFinishedAll;
-            }
-        } else {
-            sp_request_->body = str.substr(pos);
-            pos = data_size;
-            state_ = State::kFinishedAll;
-        }
+void RequestParser::finishBody()
+{
+    state_ = State::kFinishedAll;
+    if (is_body_streaming_) {
+        //! Request 已在 kFinishedHeads 时被取走，直接进入下一个请求
+        if (sp_request_ == nullptr)
+            state_ = State::kInit;
+        if (body_cb_)
+            body_cb_(nullptr, 0);
     }
+}
 
-    return pos;
+/* 解析："GET /index.html HTTP/1.1" */
+bool RequestParser::parseStartLine(const char *begin, const char *end)
+{
+    //! 获取 method
+    const char *method_end = static_cast<const char*>(::memchr(begin, ' ', end - begin));
+    if (method_end == nullptr)
+        return false;
+
+    auto method = StringToMethod(std::string(begin, method_end));
+    if (method == Method::kUnset)
+        return false;
+
+    //! 获取 url
+    const char *url_begin = method_end;
+    while (url_begin < end && *url_begin == ' ')
+        ++url_begin;
+
+    const char *url_end = static_cast<const char*>(::memchr(url_begin, ' ', end - url_begin));
+    if (url_end == nullptr)
+        return false;
+
+    if (!StringToUrlPath(std::string(url_begin, url_end), sp_request_->url))
+        return false;
+
+    //! 获取版本
+    const char *ver_begin = url_end;
+    while (ver_begin < end && *ver_begin == ' ')
+        ++ver_begin;
+
+    if (end - ver_begin < 5 || ::memcmp(ver_begin, "HTTP/", 5) != 0)
+        return false;
+
+    auto ver = StringToHttpVer(std::string(ver_begin, end));
+    if (ver == HttpVer::kUnset)
+        return false;
+
+    sp_request_->method = method;
+    sp_request_->http_ver = ver;
+    return true;
 }
 
 Request* RequestParser::getRequest()
@@ -162,15 +194,21 @@ Request* RequestParser::getRequest()
     if (state_ == State::kFinishedAll) {
         std::swap(ret, sp_request_);
         state_ = State::kInit;
+    } else if (state_ == State::kFinishedHeads && is_body_streaming_) {
+        std::swap(ret, sp_request_);
     }
     return ret;
 }
 
+//! 只交换解析的状态，流式接收的配置不交换
 void RequestParser::swap(RequestParser &other)
 {
     if (&other != this) {
+        MessageParser::swap(other);
         std::swap(sp_request_, other.sp_request_);
         std::swap(state_, other.state_);
+        std::swap(body_size_, other.body_size_);
+        std::swap(is_body_streaming_, other.is_body_streaming_);
     }
 }
 
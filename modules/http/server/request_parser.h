@@ -20,14 +20,19 @@
 #ifndef TBOX_HTTP_REQUEST_PARSER_H_20220502
 #define TBOX_HTTP_REQUEST_PARSER_H_20220502
 
+#include <functional>
+#include <limits>
 #include "../request.h"
+#include "../message_parser.h"
 
 namespace tbox {
 namespace http {
 namespace server {
 
+class ContextPool;
+
 //! 请求解析器
-class RequestParser {
+class RequestParser : public MessageParser {
   public:
     //! 状态
     enum class State {
@@ -38,13 +43,18 @@ class RequestParser {
         kFail,              //!< 出错
     };
 
-    ~RequestParser();
+    virtual ~RequestParser() override;
 
     /**
      * \brief   解析
      * \param   data_ptr    数据地址
      * \param   data_size   数据大小
      * \return  size_t      已处理数据大小
+     *
+     * \note    解析是可续的：未处理的数据在下一次调用时须原样放在 data_ptr 的开头，
+     *          解析器会记住已扫描过的位置，不会从头重新扫描；
+     *          Body 数据到达即被取走，不需要等整个 Body 收齐；
+     *          支持 Transfer-Encoding: chunked 的 Body
      */
     size_t parse(const void *data_ptr, size_t data_size);
 
@@ -55,21 +65,53 @@ class RequestParser {
      * \brief   取走Request对象
      * \return  Request*    请求对象
      * \note    只有state为kFinishedAll才会返回真实的对象，否则都是返回nullptr
+     *          流式接收Body时，在state为kFinishedHeads时就可以取走
      *          一旦Request对象被取走，RequestParser则不再管辖被取走对象的生命期
      *          交由用户自己管理
      */
     Request* getRequest();
 
+    /**
+     * 流式接收Body
+     *
+     * 当请求为 chunked，或 Content-Length 大于 threshold 时，parse() 在解析完Head后
+     * 便以 kFinishedHeads 状态返回，此时可用 getRequest() 取走不含Body的请求；
+     * 后面的Body数据不再存入 Request::body，而是到达即通过 BodyCallback 交出，
+     * Body 结束时以 data_size 为 0 回调一次；若Request已被取走，状态直接回到 kInit
+     *
+     * 默认不启用
+     */
+    using BodyCallback = std::function<void(const char *data_ptr, size_t data_size)>;
+    void setBodyStreamThreshold(size_t threshold) { body_stream_threshold_ = threshold; }
+    void setBodyCallback(const BodyCallback &cb) { body_cb_ = cb; }
+    //! 当前请求的Body是否为流式接收
+    bool isBodyStreaming() const { return is_body_streaming_; }
+
+    //! 从池中分配 Request，默认为空，直接 new
+    void setPool(ContextPool *wp_pool) { wp_pool_ = wp_pool; }
+
     //! 交换
     void swap(RequestParser &other);
 
     //! 重置
     void reset();
 
+  protected:
+    virtual void onBody(const char *data_ptr, size_t data_size) override;
+
+  private:
+    bool parseStartLine(const char *begin, const char *end);
+    void finishBody();
+
   private:
     State state_ = State::kInit;
     Request *sp_request_ = nullptr;
-    size_t content_length_ = 0;
+    size_t body_size_ = 0;      //!< 已接收的Body大小
+
+    size_t body_stream_threshold_ = std::numeric_limits<size_t>::max();
+    ContextPool *wp_pool_ = nullptr;
+    bool is_body_streaming_ = false;
+    BodyCallback body_cb_;
 };
 
 }
@@ -19,6 +19,9 @@
  */
 #include <gtest/gtest.h>
 #include <cstring>
+#include <chrono>
+#include <iostream>
+#include <vector>
 #include "request_parser.h"
 
 namespace tbox {
@@ -390,8 +393,308 @@ TEST(RequestParser, HeaderError_Empty)
     EXPECT_EQ(pp.state(), RequestParser::State::kFail);
 }
 
+//! 测试 Head 与 Body 都被拆成很多小段的情况
+TEST(RequestParser, ByteByByte)
+{
+    std::string text = \
+        "POST /upload HTTP/1.1\r\n"
+        "content-length: 10\r\n"
+        "X-Empty:\r\n"
+        "\r\n"
+        "0123456789"
+        "GET /next HTTP/1.1\r\n"
+        "\r\n"
+        ;
+
+    RequestParser pp;
+    std::string buff;
+    std::vector<Request*> reqs;
+    for (char ch : text) {
+        buff.push_back(ch);
+        auto rsize = pp.parse(buff.data(), buff.size());
+        buff.erase(0, rsize);
+        ASSERT_NE(pp.state(), RequestParser::State::kFail);
+        if (pp.state() == RequestParser::State::kFinishedAll)
+            reqs.push_back(pp.getRequest());
+    }
+
+    ASSERT_EQ(reqs.size(), 2u);
+    EXPECT_EQ(reqs[0]->method, Method::kPost);
+    EXPECT_EQ(reqs[0]->url.path, "/upload");
+    EXPECT_EQ(reqs[0]->headers["content-length"], "10");
+    EXPECT_EQ(reqs[0]->headers["X-Empty"], "");
+    EXPECT_EQ(reqs[0]->body, "0123456789");
+    EXPECT_EQ(reqs[1]->method, Method::kGet);
+    EXPECT_EQ(reqs[1]->url.path, "/next");
+    EXPECT_EQ(reqs[1]->body, "");
+
+    for (auto req : reqs)
+        delete req;
+}
+
+//! 没有 Content-Length 的 GET 请求不应吞掉后面管道化的请求
+TEST(RequestParser, PipelinedGetWithoutContentLength)
+{
+    const char *text = \
+        "GET /a HTTP/1.1\r\n"
+        "Host: x\r\n"
+        "\r\n"
+        "GET /b HTTP/1.1\r\n"
+        "\r\n"
+        ;
+    size_t text_len = ::strlen(text);
+    RequestParser pp;
+    size_t pos = pp.parse(text, text_len);
+    ASSERT_EQ(pp.state(), RequestParser::State::kFinishedAll);
+    auto req1 = pp.getRequest();
+    EXPECT_EQ(req1->url.path, "/a");
+    delete req1;
+
+    ASSERT_EQ(pp.parse(text + pos, text_len - pos), text_len - pos);
+    ASSERT_EQ(pp.state(), RequestParser::State::kFinishedAll);
+    auto req2 = pp.getRequest();
+    EXPECT_EQ(req2->url.path, "/b");
+    delete req2;
+}
+
+TEST(RequestParser, HeaderError_BadContentLength)
+{
+    RequestParser pp;
+
+    std::string text = \
+        "POST /login.php HTTP/1.1\r\n"
+        "Content-Length: 12a\r\n"
+        ;
+    pp.parse(text.c_str(), text.size());
+    EXPECT_EQ(pp.state(), RequestParser::State::kFail);
+}
+
+TEST(RequestParser, Chunked)
+{
+    std::string text = \
+        "POST /upload HTTP/1.1\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5\r\n"
+        "hello\r\n"
+        "7;name=value\r\n"
+        ", world\r\n"
+        "0\r\n"
+        "X-Trailer: 1\r\n"
+        "\r\n"
+        "GET /next HTTP/1.1\r\n"
+        "\r\n"
+        ;
+
+    RequestParser pp;
+    std::string buff;
+    std::vector<Request*> reqs;
+    for (char ch : text) {
+        buff.push_back(ch);
+        auto rsize = pp.parse(buff.data(), buff.size());
+        buff.erase(0, rsize);
+        ASSERT_NE(pp.state(), RequestParser::State::kFail);
+        if (pp.state() == RequestParser::State::kFinishedAll)
+            reqs.push_back(pp.getRequest());
+    }
+
+    ASSERT_EQ(reqs.size(), 2u);
+    EXPECT_EQ(reqs[0]->body, "hello, world");
+    EXPECT_EQ(reqs[1]->url.path, "/next");
+
+    for (auto req : reqs)
+        delete req;
+}
+
+TEST(RequestParser, ChunkedError_BadSize)
+{
+    const char *text = \
+        "POST /upload HTTP/1.1\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "xyz\r\n"
+        ;
+
+    RequestParser pp;
+    pp.parse(text, ::strlen(text));
+    EXPECT_EQ(pp.state(), RequestParser::State::kFail);
+}
+
+TEST(RequestParser, StreamBody)
+{
+    std::string text = \
+        "POST /upload HTTP/1.1\r\n"
+        "Content-Length: 10\r\n"
+        "\r\n"
+        "0123456789"
+        "POST /small HTTP/1.1\r\n"
+        "Content-Length: 2\r\n"
+        "\r\n"
+        "ab"
+        ;
+
+    RequestParser pp;
+    pp.setBodyStreamThreshold(4);
+
+    std::string body;
+    int end_count = 0;
+    pp.setBodyCallback(
+        [&] (const char *data_ptr, size_t data_size) {
+            if (data_size == 0)
+                ++end_count;
+            else
+                body.append(data_ptr, data_size);
+        }
+    );
+
+    //! 分两次送入，Body 被拆开
+    size_t pos = pp.parse(text.data(), 49);
+    EXPECT_EQ(pos, 45u);
+    EXPECT_EQ(pp.state(), RequestParser::State::kFinishedHeads);
+    EXPECT_TRUE(pp.isBodyStreaming());
+
+    Request *req = pp.getRequest();
+    ASSERT_NE(req, nullptr);
+    EXPECT_EQ(req->url.path, "/upload");
+    EXPECT_EQ(req->body, "");
+    delete req;
+
+    pos += pp.parse(text.data() + pos, 49 - pos);
+    EXPECT_EQ(body, "0123");
+    pos += pp.parse(text.data() + pos, text.size() - pos);
+    EXPECT_EQ(body, "0123456789");
+    EXPECT_EQ(end_count, 1);
+    EXPECT_EQ(pp.state(), RequestParser::State::kInit);
+
+    //! 小于阈值的请求，照常存入 body
+    pos += pp.parse(text.data() + pos, text.size() - pos);
+    EXPECT_EQ(pos, text.size());
+    EXPECT_EQ(pp.state(), RequestParser::State::kFinishedAll);
+    EXPECT_FALSE(pp.isBodyStreaming());
+    req = pp.getRequest();
+    ASSERT_NE(req, nullptr);
+    EXPECT_EQ(req->body, "ab");
+    delete req;
 }
+
+TEST(RequestParser, Benchmark_Pipelined)
+{
+    const char *one_req = \
+        "GET /api/v1/devices/12/status?verbose=1 HTTP/1.1\r\n"
+        "Host: 192.168.0.15:55555\r\n"
+        "User-Agent: curl/7.81.0\r\n"
+        "Accept: */*\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        ;
+
+    const int kReqNum = 100000;
+    std::string text;
+    for (int i = 0; i < kReqNum; ++i)
+        text += one_req;
+
+    RequestParser pp;
+    int count = 0;
+    size_t pos = 0;
+    auto start_ts = std::chrono::steady_clock::now();
+    while (pos < text.size()) {
+        pos += pp.parse(text.data() + pos, text.size() - pos);
+        ASSERT_EQ(pp.state(), RequestParser::State::kFinishedAll);
+        delete pp.getRequest();
+        ++count;
+    }
+    auto cost = std::chrono::steady_clock::now() - start_ts;
+    auto cost_us = std::chrono::duration_cast<std::chrono::microseconds>(cost).count();
+
+    EXPECT_EQ(count, kReqNum);
+    std::cout << "requests: " << count << ", cost: " << cost_us << " us"
+              << ", " << (count * 1000000ull / (cost_us + 1)) << " req/s" << std::endl;
 }
+
+//! 浏览器发出的典型请求，有十多个Header
+TEST(RequestParser, Benchmark_BrowserHeaders)
+{
+    const char *one_req = \
+        "GET /dashboard/index.html HTTP/1.1\r\n"
+        "Host: 192.168.0.15:55555\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+        "Accept-Language: zh-CN,zh;q=0.8,zh-TW;q=0.7,zh-HK;q=0.5,en-US;q=0.3,en;q=0.2\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Connection: keep-alive\r\n"
+        "Referer: http://192.168.0.15:55555/\r\n"
+        "Cookie: session=8f2a9c7e41d04b6a; theme=dark\r\n"
+        "Upgrade-Insecure-Requests: 1\r\n"
+        "If-None-Match: \"65a1b2c3-1f40\"\r\n"
+        "If-Modified-Since: Fri, 12 Jan 2024 08:00:00 GMT\r\n"
+        "Cache-Control: max-age=0\r\n"
+        "DNT: 1\r\n"
+        "\r\n"
+        ;
+
+    const int kReqNum = 100000;
+    std::string text;
+    for (int i = 0; i < kReqNum; ++i)
+        text += one_req;
+
+    RequestParser pp;
+    int count = 0;
+    size_t pos = 0;
+    auto start_ts = std::chrono::steady_clock::now();
+    while (pos < text.size()) {
+        pos += pp.parse(text.data() + pos, text.size() - pos);
+        ASSERT_EQ(pp.state(), RequestParser::State::kFinishedAll);
+        Request *req = pp.getRequest();
+        //! 模拟服务端处理时的查找
+        EXPECT_EQ(req->headers.count("Connection"), 1u);
+        EXPECT_EQ(req->headers.count("Content-Length"), 0u);
+        delete req;
+        ++count;
+    }
+    auto cost = std::chrono::steady_clock::now() - start_ts;
+    auto cost_us = std::chrono::duration_cast<std::chrono::microseconds>(cost).count();
+
+    EXPECT_EQ(count, kReqNum);
+    std::cout << "requests: " << count << ", cost: " << cost_us << " us"
+              << ", " << (count * 1000000ull / (cost_us + 1)) << " req/s" << std::endl;
 }
+
+TEST(RequestParser, Benchmark_Upload)
+{
+    const size_t kBodySize = 10 << 20;
+    const size_t kSegmentSize = 1460;   //!< 一个TCP分段的大小
+
+    std::string text = \
+        "POST /upload HTTP/1.1\r\n"
+        "Content-Length: " + std::to_string(kBodySize) + "\r\n"
+        "\r\n";
+    text.append(kBodySize, 'x');
+
+    RequestParser pp;
+    std::string buff;   //!< 模拟连接中的接收缓冲
+    Request *req = nullptr;
+
+    auto start_ts = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos < text.size(); pos += kSegmentSize) {
+        buff.append(text, pos, kSegmentSize);
+        buff.erase(0, pp.parse(buff.data(), buff.size()));
+        ASSERT_NE(pp.state(), RequestParser::State::kFail);
+        if (pp.state() == RequestParser::State::kFinishedAll)
+            req = pp.getRequest();
+    }
+    auto cost = std::chrono::steady_clock::now() - start_ts;
+    auto cost_us = std::chrono::duration_cast<std::chrono::microseconds>(cost).count();
+
+    ASSERT_NE(req, nullptr);
+    EXPECT_EQ(req->body.size(), kBodySize);
+    EXPECT_TRUE(buff.empty());
+    delete req;
+
+    std::cout << "upload " << (kBodySize >> 20) << " MB in " << kSegmentSize << " bytes segments"
+              << ", cost: " << cost_us << " us" << std::endl;
 }
 
+}
+}
+}
+}
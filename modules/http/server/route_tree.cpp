@@ -0,0 +1,222 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "route_tree.h"
+
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <tbox/base/log.h>
+
+namespace tbox {
+namespace http {
+namespace server {
+
+struct RouteTree::Node {
+    std::string prefix;             //!< 静态部分
+    std::string indices;            //!< 各静态子节点 prefix 的首字符，与 children 一一对应
+    std::vector<Node*> children;    //!< 静态子节点
+
+    std::string param_name;
+    Node *param_child = nullptr;    //!< ":name" 子节点
+
+    std::string wildcard_name;
+    RequestCallback wildcard_cb;    //!< "*name" 的回调
+
+    RequestCallback cb;
+
+    ~Node() {
+        for (auto child : children)
+            delete child;
+        CHECK_DELETE_OBJ(param_child);
+    }
+};
+
+namespace {
+
+//! 查找静态部分的结束位置，即下一个以 ':' 或 '*' 开头的段，begin 处的字符一定是静态的
+const char* FindStaticEnd(const char *begin, const char *end)
+{
+    for (const char *p = begin + 1; p < end; ++p) {
+        if ((*p == ':' || *p == '*') && *(p - 1) == '/')
+            return p;
+    }
+    return end;
+}
+
+}
+
+RouteTree::RouteTree() :
+    root_(new Node)
+{ }
+
+RouteTree::~RouteTree()
+{
+    delete root_;
+}
+
+bool RouteTree::insert(const std::string &path, const RequestCallback &cb)
+{
+    Node *node = root_;
+    const char *p = path.data();
+    const char *end = p + path.size();
+    size_t param_num = 0;
+
+    while (p < end) {
+        if (*p == ':' && (p == path.data() || *(p - 1) == '/')) {
+            const char *name_end = static_cast<const char*>(::memchr(p, '/', end - p));
+            if (name_end == nullptr)
+                name_end = end;
+
+            std::string name(p + 1, name_end);
+            if (node->param_child == nullptr) {
+                node->param_child = new Node;
+                node->param_name = name;
+            } else if (node->param_name != name) {
+                LogWarn("param name conflict, '%s' vs '%s', in '%s'",
+                        node->param_name.c_str(), name.c_str(), path.c_str());
+                return false;
+            }
+
+            if (++param_num > kMaxParamNum) {
+                LogWarn("too many params in '%s'", path.c_str());
+                return false;
+            }
+
+            node = node->param_child;
+            p = name_end;
+
+        } else if (*p == '*' && (p == path.data() || *(p - 1) == '/')) {
+            if (::memchr(p, '/', end - p) != nullptr) {
+                LogWarn("wildcard must be at the end, '%s'", path.c_str());
+                return false;
+            }
+
+            if (++param_num > kMaxParamNum) {
+                LogWarn("too many params in '%s'", path.c_str());
+                return false;
+            }
+
+            node->wildcard_name.assign(p + 1, end);
+            node->wildcard_cb = cb;
+            return true;
+
+        } else {
+            const char *static_end = FindStaticEnd(p, end);
+            size_t static_len = static_end - p;
+
+            auto pos = node->indices.find(*p);
+            if (pos == std::string::npos) {
+                auto child = new Node;
+                child->prefix.assign(p, static_len);
+                node->indices.push_back(*p);
+                node->children.push_back(child);
+                node = child;
+                p = static_end;
+                continue;
+            }
+
+            //! 求与子节点的公共前缀，不完全相同时要将子节点一分为二
+            Node *child = node->children[pos];
+            size_t common_len = 0;
+            size_t max_len = std::min(static_len, child->prefix.size());
+            while (common_len < max_len && child->prefix[common_len] == p[common_len])
+                ++common_len;
+
+            if (common_len < child->prefix.size()) {
+                auto mid = new Node;
+                mid->prefix = child->prefix.substr(0, common_len);
+                child->prefix.erase(0, common_len);
+                mid->indices.push_back(child->prefix[0]);
+                mid->children.push_back(child);
+                node->children[pos] = mid;
+                child = mid;
+            }
+
+            node = child;
+            p += common_len;
+        }
+    }
+
+    node->cb = cb;
+    return true;
+}
+
+const RequestCallback* RouteTree::find(const char *path_ptr, size_t path_len,
+                                       Param *params, size_t &param_num) const
+{
+    const RequestCallback *cb = nullptr;
+    param_num = 0;
+
+    if (Match(root_, path_ptr, path_ptr + path_len, params, param_num, cb))
+        return cb;
+
+    param_num = 0;
+    return nullptr;
+}
+
+/**
+ * 按 静态 > 参数 > 通配 的优先级逐级匹配，匹配失败时回溯
+ * 回溯深度不超过路径的段数
+ */
+bool RouteTree::Match(const Node *node, const char *p, const char *end,
+                      Param *params, size_t &param_num, const RequestCallback *&cb)
+{
+    if (p == end && node->cb) {
+        cb = &node->cb;
+        return true;
+    }
+
+    if (p < end) {
+        auto index_ptr = static_cast<const char*>(::memchr(node->indices.data(), *p, node->indices.size()));
+        if (index_ptr != nullptr) {
+            auto child = node->children[index_ptr - node->indices.data()];
+            auto &prefix = child->prefix;
+            if (static_cast<size_t>(end - p) >= prefix.size() &&
+                ::memcmp(p, prefix.data(), prefix.size()) == 0 &&
+                Match(child, p + prefix.size(), end, params, param_num, cb))
+                return true;
+        }
+
+        if (node->param_child != nullptr) {
+            auto value_end = static_cast<const char*>(::memchr(p, '/', end - p));
+            if (value_end == nullptr)
+                value_end = end;
+
+            if (value_end > p) {
+                params[param_num++] = { node->param_name.c_str(), p, static_cast<size_t>(value_end - p) };
+                if (Match(node->param_child, value_end, end, params, param_num, cb))
+                    return true;
+                --param_num;
+            }
+        }
+    }
+
+    if (node->wildcard_cb) {
+        params[param_num++] = { node->wildcard_name.c_str(), p, static_cast<size_t>(end - p) };
+        cb = &node->wildcard_cb;
+        return true;
+    }
+
+    return false;
+}
+
+}
+}
+}
@@ -0,0 +1,83 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_SERVER_ROUTE_TREE_H_20251019
+#define TBOX_HTTP_SERVER_ROUTE_TREE_H_20251019
+
+#include <string>
+#include <tbox/base/defines.h>
+#include "types.h"
+
+namespace tbox {
+namespace http {
+namespace server {
+
+//! 路由表，压缩前缀树(radix tree)
+//!
+//! 路径中以 ':' 开头的段为参数，匹配一个段，如 "/devices/:id/status"；
+//! 以 '*' 开头的段为通配，匹配余下的所有字符，只能放在最后，如 "/static/*path"。
+//! 同一位置上的匹配优先级为：静态 > 参数 > 通配。
+//!
+//! 查找的耗时只与路径长度有关，与路由条数无关，且不分配内存
+class RouteTree {
+  public:
+    RouteTree();
+    ~RouteTree();
+
+    NONCOPYABLE(RouteTree);
+
+  public:
+    //! 路径参数，name 指向路由表内部，value 指向被查找的路径
+    struct Param {
+        const char *name;
+        const char *value_ptr;
+        size_t      value_len;
+    };
+
+    static constexpr size_t kMaxParamNum = 8;
+
+    bool insert(const std::string &path, const RequestCallback &cb);
+
+    /**
+     * 查找路径对应的回调
+     *
+     * \param   path_ptr, path_len  路径
+     * \param   params              用于存放参数的数组，至少 kMaxParamNum 个元素
+     * \param   param_num           存放参数的个数
+     *
+     * \return  找到的回调，没有找到返回 nullptr
+     */
+    const RequestCallback* find(const char *path_ptr, size_t path_len,
+                                Param *params, size_t &param_num) const;
+
+  private:
+    struct Node;
+
+    static bool Match(const Node *node, const char *p, const char *end,
+                      Param *params, size_t &param_num, const RequestCallback *&cb);
+
+  private:
+    Node *root_;
+};
+
+}
+}
+}
+
+#endif //TBOX_HTTP_SERVER_ROUTE_TREE_H_20251019
@@ -0,0 +1,255 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include "route_tree.h"
+
+namespace tbox {
+namespace http {
+namespace server {
+namespace {
+
+//! 用回调的序号来区分命中了哪一条路由
+RequestCallback MakeCb(int &tag, int value)
+{
+    return [&tag, value] (ContextSptr, const NextFunc &) { tag = value; };
+}
+
+int Find(const RouteTree &tree, const std::string &path, std::map<std::string, std::string> *params = nullptr)
+{
+    RouteTree::Param param_array[RouteTree::kMaxParamNum];
+    size_t param_num = 0;
+    auto cb = tree.find(path.data(), path.size(), param_array, param_num);
+    if (cb == nullptr)
+        return 0;
+
+    if (params != nullptr) {
+        params->clear();
+        for (size_t i = 0; i < param_num; ++i)
+            (*params)[param_array[i].name] = std::string(param_array[i].value_ptr, param_array[i].value_len);
+    }
+
+    int tag = 0;
+    (*cb)(nullptr, nullptr);
+    return tag;
+}
+
+}
+
+TEST(RouteTree, Static)
+{
+    int tag = 0;
+    RouteTree tree;
+    EXPECT_TRUE(tree.insert("/", MakeCb(tag, 1)));
+    EXPECT_TRUE(tree.insert("/index.html", MakeCb(tag, 2)));
+    EXPECT_TRUE(tree.insert("/info", MakeCb(tag, 3)));
+    EXPECT_TRUE(tree.insert("/in", MakeCb(tag, 4)));
+    EXPECT_TRUE(tree.insert("/api/v1/status", MakeCb(tag, 5)));
+
+    auto find = [&] (const std::string &path) {
+        RouteTree::Param params[RouteTree::kMaxParamNum];
+        size_t param_num = 0;
+        tag = 0;
+        auto cb = tree.find(path.data(), path.size(), params, param_num);
+        if (cb != nullptr)
+            (*cb)(nullptr, nullptr);
+        EXPECT_EQ(param_num, 0u);
+        return tag;
+    };
+
+    EXPECT_EQ(find("/"), 1);
+    EXPECT_EQ(find("/index.html"), 2);
+    EXPECT_EQ(find("/info"), 3);
+    EXPECT_EQ(find("/in"), 4);
+    EXPECT_EQ(find("/api/v1/status"), 5);
+    EXPECT_EQ(find("/i"), 0);
+    EXPECT_EQ(find("/index"), 0);
+    EXPECT_EQ(find("/api/v1/status/"), 0);
+    EXPECT_EQ(find(""), 0);
+}
+
+TEST(RouteTree, Param)
+{
+    int tag = 0;
+    RouteTree tree;
+    EXPECT_TRUE(tree.insert("/v1/devices/:id", MakeCb(tag, 1)));
+    EXPECT_TRUE(tree.insert("/v1/devices/:id/status", MakeCb(tag, 2)));
+    EXPECT_TRUE(tree.insert("/v1/devices/:id/ports/:port", MakeCb(tag, 3)));
+    EXPECT_TRUE(tree.insert("/v1/devices/list", MakeCb(tag, 4)));
+
+    auto find = [&] (const std::string &path, std::map<std::string, std::string> &params) {
+        RouteTree::Param param_array[RouteTree::kMaxParamNum];
+        size_t param_num = 0;
+        tag = 0;
+        params.clear();
+        auto cb = tree.find(path.data(), path.size(), param_array, param_num);
+        if (cb != nullptr) {
+            (*cb)(nullptr, nullptr);
+            for (size_t i = 0; i < param_num; ++i)
+                params[param_array[i].name] = std::string(param_array[i].value_ptr, param_array[i].value_len);
+        }
+        return tag;
+    };
+
+    std::map<std::string, std::string> params;
+    EXPECT_EQ(find("/v1/devices/12", params), 1);
+    EXPECT_EQ(params, (std::map<std::string, std::string>{{"id", "12"}}));
+
+    EXPECT_EQ(find("/v1/devices/abc/status", params), 2);
+    EXPECT_EQ(params, (std::map<std::string, std::string>{{"id", "abc"}}));
+
+    EXPECT_EQ(find("/v1/devices/7/ports/3", params), 3);
+    EXPECT_EQ(params, (std::map<std::string, std::string>{{"id", "7"}, {"port", "3"}}));
+
+    //! 静态优先
+    EXPECT_EQ(find("/v1/devices/list", params), 4);
+    EXPECT_TRUE(params.empty());
+
+    EXPECT_EQ(find("/v1/devices/", params), 0);
+    EXPECT_EQ(find("/v1/devices/12/", params), 0);
+    EXPECT_EQ(find("/v1/devices/12/other", params), 0);
+}
+
+TEST(RouteTree, Wildcard)
+{
+    int tag = 0;
+    RouteTree tree;
+    EXPECT_TRUE(tree.insert("/static/*path", MakeCb(tag, 1)));
+    EXPECT_TRUE(tree.insert("/static/index.html", MakeCb(tag, 2)));
+    EXPECT_TRUE(tree.insert("/static/:name/info", MakeCb(tag, 3)));
+
+    RouteTree::Param params[RouteTree::kMaxParamNum];
+    size_t param_num = 0;
+    std::string path;   //!< params 中的 value_ptr 指向它，须保持有效
+
+    auto find = [&] (const std::string &p) {
+        tag = 0;
+        path = p;
+        auto cb = tree.find(path.data(), path.size(), params, param_num);
+        if (cb != nullptr)
+            (*cb)(nullptr, nullptr);
+        return tag;
+    };
+
+    EXPECT_EQ(find("/static/js/app.js"), 1);
+    ASSERT_EQ(param_num, 1u);
+    EXPECT_STREQ(params[0].name, "path");
+    EXPECT_EQ(std::string(params[0].value_ptr, params[0].value_len), "js/app.js");
+
+    EXPECT_EQ(find("/static/"), 1);
+    ASSERT_EQ(param_num, 1u);
+    EXPECT_EQ(params[0].value_len, 0u);
+
+    EXPECT_EQ(find("/static/index.html"), 2);
+    EXPECT_EQ(param_num, 0u);
+
+    EXPECT_EQ(find("/static/abc/info"), 3);
+    ASSERT_EQ(param_num, 1u);
+    EXPECT_STREQ(params[0].name, "name");
+
+    //! 参数路由匹配失败后回溯到通配
+    EXPECT_EQ(find("/static/abc/other"), 1);
+    ASSERT_EQ(param_num, 1u);
+    EXPECT_EQ(std::string(params[0].value_ptr, params[0].value_len), "abc/other");
+
+    EXPECT_EQ(find("/stat"), 0);
+}
+
+TEST(RouteTree, InsertFail)
+{
+    int tag = 0;
+    RouteTree tree;
+    EXPECT_TRUE(tree.insert("/a/:id", MakeCb(tag, 1)));
+    EXPECT_FALSE(tree.insert("/a/:name/b", MakeCb(tag, 2)));
+    EXPECT_FALSE(tree.insert("/b/*path/c", MakeCb(tag, 3)));
+    EXPECT_FALSE(tree.insert("/:a/:b/:c/:d/:e/:f/:g/:h/:i", MakeCb(tag, 4)));
+}
+
+TEST(RouteTree, Replace)
+{
+    int tag = 0;
+    RouteTree tree;
+    EXPECT_TRUE(tree.insert("/a", MakeCb(tag, 1)));
+    EXPECT_TRUE(tree.insert("/a", MakeCb(tag, 2)));
+    EXPECT_EQ(Find(tree, "/a"), 0); //! Find() 中的 tag 与这里的不同
+    RouteTree::Param params[RouteTree::kMaxParamNum];
+    size_t param_num = 0;
+    auto cb = tree.find("/a", 2, params, param_num);
+    ASSERT_NE(cb, nullptr);
+    (*cb)(nullptr, nullptr);
+    EXPECT_EQ(tag, 2);
+}
+
+TEST(RouteTree, Benchmark)
+{
+    const int kRouteNum = 1000;
+    int tag = 0;
+
+    RouteTree tree;
+    std::map<std::string, RequestCallback> map;    //!< 原来 Router 所用的方式，只支持精确匹配
+    std::vector<std::string> paths;
+
+    for (int i = 0; i < kRouteNum / 2; ++i) {
+        std::string base = "/api/v1/resource" + std::to_string(i);
+        tree.insert(base + "/list", MakeCb(tag, i * 2));
+        tree.insert(base + "/:id/status", MakeCb(tag, i * 2 + 1));
+        map["get:" + base + "/list"] = MakeCb(tag, i * 2);
+        paths.push_back(base + "/list");
+        paths.push_back(base + "/" + std::to_string(i * 7) + "/status");
+    }
+
+    const int kLoop = 200;
+    RouteTree::Param params[RouteTree::kMaxParamNum];
+    size_t param_num = 0;
+
+    size_t found = 0;
+    auto start_ts = std::chrono::steady_clock::now();
+    for (int loop = 0; loop < kLoop; ++loop) {
+        for (auto &path : paths) {
+            if (tree.find(path.data(), path.size(), params, param_num) != nullptr)
+                ++found;
+        }
+    }
+    auto tree_cost = std::chrono::steady_clock::now() - start_ts;
+    EXPECT_EQ(found, paths.size() * kLoop);
+
+    found = 0;
+    start_ts = std::chrono::steady_clock::now();
+    for (int loop = 0; loop < kLoop; ++loop) {
+        for (auto &path : paths) {
+            if (map.find("get:" + path) != map.end())
+                ++found;
+        }
+    }
+    auto map_cost = std::chrono::steady_clock::now() - start_ts;
+    EXPECT_EQ(found, paths.size() / 2 * kLoop);
+
+    size_t lookup_num = paths.size() * kLoop;
+    std::cout << "routes: " << kRouteNum << ", lookups: " << lookup_num << std::endl
+              << "radix tree: " << std::chrono::duration_cast<std::chrono::nanoseconds>(tree_cost).count() / lookup_num << " ns/lookup" << std::endl
+              << "std::map  : " << std::chrono::duration_cast<std::chrono::nanoseconds>(map_cost).count() / lookup_num << " ns/lookup"
+              << " (exact match only, found " << found << ")" << std::endl;
+}
+
+}
+}
+}
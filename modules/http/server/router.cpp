@@ -18,14 +18,14 @@
  * of the source tree.
  */
 #include "router.h"
-#include <map>
+#include "route_tree.h"
 
 namespace tbox {
 namespace http {
 namespace server {
 
 struct Router::Data {
-    std::map<std::string, RequestCallback> cbs_;
+    RouteTree trees[static_cast<size_t>(Method::kMax)];  //!< 每种方法一棵
 };
 
 Router::Router() :
@@ -39,46 +39,42 @@ Router::~Router()
 
 void Router::handle(ContextSptr sp_ctx, const NextFunc &next)
 {
-    std::string prefix;
-    switch (sp_ctx->req().method) {
-        case Method::kGet:      prefix = "get:";   break;
-        case Method::kPut:      prefix = "put:";   break;
-        case Method::kPost:     prefix = "post:";  break;
-        case Method::kDelete:   prefix = "del:";   break;
-        default:;
-    }
+    const auto &req = sp_ctx->req();
+    const auto &tree = d_->trees[static_cast<size_t>(req.method)];
+
+    RouteTree::Param params[RouteTree::kMaxParamNum];
+    size_t param_num = 0;
 
-    auto iter = d_->cbs_.find(prefix + sp_ctx->req().url.path);
-    if (iter != d_->cbs_.end()) {
-        if (iter->second) {
-            iter->second(sp_ctx, next);
-            return;
-        }
+    auto cb = tree.find(req.url.path.data(), req.url.path.size(), params, param_num);
+    if (cb != nullptr) {
+        sp_ctx->setParams(params, param_num);
+        (*cb)(sp_ctx, next);
+        return;
     }
     next();
 }
 
 Router& Router::get(const std::string &path, const RequestCallback &cb)
 {
-    d_->cbs_[std::string("get:") + path] = cb;
+    d_->trees[static_cast<size_t>(Method::kGet)].insert(path, cb);
     return *this;
 }
 
 Router& Router::post(const std::string &path, const RequestCallback &cb)
 {
-    d_->cbs_[std::string("post:") + path] = cb;
+    d_->trees[static_cast<size_t>(Method::kPost)].insert(path, cb);
     return *this;
 }
 
 Router& Router::put(const std::string &path, const RequestCallback &cb)
 {
-    d_->cbs_[std::string("put:") + path] = cb;
+    d_->trees[static_cast<size_t>(Method::kPut)].insert(path, cb);
     return *this;
 }
 
 Router& Router::del(const std::string &path, const RequestCallback &cb)
 {
-    d_->cbs_[std::string("del:") + path] = cb;
+    d_->trees[static_cast<size_t>(Method::kDelete)].insert(path, cb);
     return *this;
 }
 
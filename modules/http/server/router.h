@@ -27,6 +27,9 @@ namespace tbox {
 namespace http {
 namespace server {
 
+//! 路由器，路径支持参数与通配，如：
+//!   router.get("/devices/:id/status", ...);  用 ctx->param("id") 获取
+//!   router.get("/static/*path", ...);        用 ctx->param("path") 获取
 class Router : public Middleware {
   public:
     Router();
@@ -63,6 +63,16 @@ void Server::setContextLogEnable(bool enable)
     return impl_->setContextLogEnable(enable);
 }
 
+void Server::setBodyStreamThreshold(size_t threshold)
+{
+    impl_->setBodyStreamThreshold(threshold);
+}
+
+void Server::setHttp2Enable(bool enable)
+{
+    impl_->setHttp2Enable(enable);
+}
+
 void Server::use(const RequestCallback &cb)
 {
     impl_->use(cb);
@@ -35,9 +35,13 @@ namespace http {
 namespace server {
 
 class Middleware;
+class Http2Session;
+class UpgradeHandler;
 
 class Server {
     friend Context;
+    friend Http2Session;
+    friend UpgradeHandler;
 
   public:
     explicit Server(event::Loop *wp_loop);
@@ -53,6 +57,20 @@ class Server {
     State state() const;
     void setContextLogEnable(bool enable);
 
+    /**
+     * 设置流式接收请求Body的阈值，默认不启用
+     * chunked 或 Content-Length 大于该值的请求，在收到Head后就交给中间件处理，
+     * Body 通过 Context::setBodyReader() 读取，见 Context
+     */
+    void setBodyStreamThreshold(size_t threshold);
+
+    /**
+     * 是否支持 HTTP/2 (h2c)，默认支持
+     * 支持时，以连接序言开头的连接 (prior knowledge)，或带 Upgrade: h2c 的请求会切换到 HTTP/2，
+     * 每个 stream 的请求同样交给中间件处理，中间件无需区分
+     */
+    void setHttp2Enable(bool enable);
+
   public:
     void use(const RequestCallback &cb);
     void use(Middleware *wp_middleware);
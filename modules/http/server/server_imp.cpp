@@ -23,7 +23,13 @@
 #include <tbox/base/assert.h>
 #include <tbox/network/buffer.h>
 
+#include <ctime>
+#include <cstring>
+
 #include "middleware.h"
+#include "http2_session.h"
+#include "upgrade_handler.h"
+#include "context_pool.h"
 
 namespace tbox {
 namespace http {
@@ -34,15 +40,28 @@ using namespace std::placeholders;
 using namespace event;
 using namespace network;
 
+namespace {
+//! 发送缓冲中的数据超过该值时，流式回复不可再写
+constexpr size_t kSendBufferHighWater = 256 << 10;
+//! 池中最多保留的空闲 Request 与 Respond 数
+constexpr size_t kPoolKeepNumber = 1024;
+//! 复用输出槽位时，缓冲的容量超过该值就释放掉
+constexpr size_t kMaxKeepOutputCapacity = 64 << 10;
+}
+
 Server::Impl::Impl(Server *wp_parent, Loop *wp_loop) :
     wp_parent_(wp_parent),
-    tcp_server_(wp_loop)
+    wp_loop_(wp_loop),
+    tcp_server_(wp_loop),
+    sp_pool_(new ContextPool(kPoolKeepNumber))
 { }
 
 Server::Impl::~Impl()
 {
     TBOX_ASSERT(cb_level_ == 0);
     cleanup();
+    //! 池要等到所有 Context 都释放后才会删除
+    sp_pool_->release();
 }
 
 bool Server::Impl::initialize(const network::SockAddr &bind_addr, int listen_backlog)
@@ -53,6 +72,7 @@ bool Server::Impl::initialize(const network::SockAddr &bind_addr, int listen_bac
     tcp_server_.setConnectedCallback(bind(&Impl::onTcpConnected, this, _1));
     tcp_server_.setDisconnectedCallback(bind(&Impl::onTcpDisconnected, this, _1));
     tcp_server_.setReceiveCallback(bind(&Impl::onTcpReceived, this, _1, _2), 0);
+    tcp_server_.setSendCompleteCallback(bind(&Impl::onTcpSendCompleted, this, _1));
 
     state_ = State::kInited;
     return true;
@@ -83,9 +103,15 @@ void Server::Impl::cleanup()
         req_cb_.clear();
         tcp_server_.cleanup();
 
-        for (auto conn : conns_)
-            delete conn;
+        //! 先取出再释放，避免释放 Context 时访问到 conns_
+        auto tobe_delete = std::move(conns_);
         conns_.clear();
+        for (auto conn : tobe_delete) {
+            wp_loop_->cancel(conn->writable_run_id);
+            CHECK_DELETE_RESET_OBJ(conn->sp_h2);
+            CHECK_DELETE_RESET_OBJ(conn->sp_upgrade);
+            delete conn;
+        }
 
         state_ = State::kNone;
     }
@@ -101,9 +127,26 @@ void Server::Impl::use(Middleware *wp_middleware)
     req_cb_.push_back(bind(&Middleware::handle, wp_middleware, _1, _2));
 }
 
+void Server::Impl::setBodyStreamThreshold(size_t threshold)
+{
+    body_stream_threshold_ = threshold;
+    for (auto conn : conns_)
+        conn->req_parser.setBodyStreamThreshold(threshold);
+}
+
 void Server::Impl::onTcpConnected(const TcpServer::ConnToken &ct)
 {
     auto conn = new Connection;
+    conn->req_parser.setBodyStreamThreshold(body_stream_threshold_);
+    conn->req_parser.setPool(sp_pool_);
+    conn->req_parser.setBodyCallback(
+        [conn] (const char *data_ptr, size_t data_size) {
+            if (conn->sp_stream_ctx != nullptr)
+                conn->sp_stream_ctx->onBody(data_ptr, data_size);
+            if (data_size == 0)
+                conn->is_stream_ended = true;
+        }
+    );
     tcp_server_.setContext(ct, conn);
     conns_.insert(conn);
 }
@@ -111,27 +154,27 @@ void Server::Impl::onTcpConnected(const TcpServer::ConnToken &ct)
 void Server::Impl::onTcpDisconnected(const TcpServer::ConnToken &ct)
 {
     Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
-    conns_.erase(conn);
-    delete conn;
+    if (conn != nullptr)
+        deleteConnection(ct, conn);
 }
 
 namespace {
 bool IsLastRequest(const Request *req)
 {
-    auto iter = req->headers.find("Connection");
+    auto value = req->headers.get(HeaderId::kConnection);
     if (req->http_ver == HttpVer::k1_0) {
         //! 1.0 版本默认为一连接一请求，需要特定的 Connection: Keep-Alive 才能持处
-        if (iter == req->headers.end()) {
+        if (value == nullptr) {
             return true;
         } else {
-            return iter->second.find("keep-alive") == std::string::npos;
+            return ::strcasestr(value->c_str(), "keep-alive") == nullptr;
         }
     } else {
         //! 否则为 1.1 及以上的版本，默认为持久连接；除非出现 Connection: close
-        if (iter == req->headers.end()) {
+        if (value == nullptr) {
             return false;
         } else {
-            return iter->second.find("close") != std::string::npos;
+            return ::strcasestr(value->c_str(), "close") != nullptr;
         }
     }
 }
@@ -141,8 +184,21 @@ void Server::Impl::onTcpReceived(const TcpServer::ConnToken &ct, Buffer &buff)
 {
     Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
 
+    if (conn->sp_h2 != nullptr) {
+        conn->sp_h2->onReceived(buff);
+        return;
+    }
+
+    if (conn->sp_upgrade != nullptr) {
+        conn->sp_upgrade->onReceived(buff);
+        return;
+    }
+
+    if (checkHttp2Preface(ct, conn, buff))
+        return;
+
     //! 如果已被标记为最后的请求，就不应该再有请求来
-    if (conn->close_index != numeric_limits<int>::max()) {
+    if (conn->close_index != numeric_limits<int>::max() && conn->sp_stream_ctx == nullptr) {
         buff.hasReadAll();
         LogWarn("should not recv any data");
         return;
@@ -152,120 +208,572 @@ void Server::Impl::onTcpReceived(const TcpServer::ConnToken &ct, Buffer &buff)
         size_t rsize = conn->req_parser.parse(buff.readableBegin(), buff.readableSize());
         buff.hasRead(rsize);
 
-        if (conn->req_parser.state() == RequestParser::State::kFinishedAll) {
+        auto state = conn->req_parser.state();
+
+        //! 流式接收的Body已结束，释放Context。释放时可能会断开连接，所以要检查
+        if (conn->is_stream_ended) {
+            conn->is_stream_ended = false;
+            auto sp_ctx = std::move(conn->sp_stream_ctx);
+            sp_ctx.reset();
+            if (tcp_server_.isClientValid(ct))
+                flush(ct, conn);
+            if (!tcp_server_.isClientValid(ct) || conn->close_index != numeric_limits<int>::max()) {
+                buff.hasReadAll();
+                return;
+            }
+        }
+
+        bool is_heads_streaming = state == RequestParser::State::kFinishedHeads &&
+                                  conn->req_parser.isBodyStreaming() && conn->sp_stream_ctx == nullptr;
+
+        if (state == RequestParser::State::kFinishedAll || is_heads_streaming) {
             Request *req = conn->req_parser.getRequest();
 
+            if (!is_heads_streaming && checkHttp2Upgrade(ct, conn, req)) {
+                conn->sp_h2->onReceived(buff);
+                return;
+            }
+
             if (context_log_enable_)
                 LogDbg("REQ: [%s]", req->toString().c_str());
 
-            if (IsLastRequest(req)) {
+            bool is_last = IsLastRequest(req);
+            if (is_last) {
                 //! 标记当前请求为close请求
                 conn->close_index = conn->req_index;
                 LogDbg("mark close at %d", conn->close_index);
+            }
 
+            prepareOutput(conn);
+            auto sp_ctx = sp_pool_->newContext(wp_parent_, ct, conn->req_index++, req);
+            if (is_heads_streaming) {
+                sp_ctx->setBodyStreaming();
+                conn->sp_stream_ctx = sp_ctx;
+            } else if (is_last) {
                 tcp_server_.shutdown(ct, SHUT_RD);
             }
 
-            auto sp_ctx = make_shared<Context>(wp_parent_, ct, conn->req_index++, req);
-            handle(sp_ctx, 0);
+            sp_ctx->dispatch();
+            sp_ctx.reset();
 
-        } else if (conn->req_parser.state() == RequestParser::State::kFail) {
+            //! 回复后连接可能已被断开
+            if (!tcp_server_.isClientValid(ct))
+                return;
+
+            //! 已升级，后面的数据属于新协议
+            if (conn->sp_upgrade != nullptr) {
+                if (buff.readableSize() > 0)
+                    conn->sp_upgrade->onReceived(buff);
+                return;
+            }
+
+            if (is_last && !is_heads_streaming) {
+                buff.hasReadAll();
+                return;
+            }
+
+        } else if (state == RequestParser::State::kFail) {
             LogNotice("parse http from %s fail", tcp_server_.getClientAddress(ct).toString().c_str());
             tcp_server_.disconnect(ct);
-            conns_.erase(conn);
-            delete conn;
+            deleteConnection(ct, conn);
             break;
 
-        } else {
+        } else if (state != RequestParser::State::kInit || rsize == 0) {
             break;
         }
     }
 }
 
+void Server::Impl::onTcpSendCompleted(const TcpServer::ConnToken &ct)
+{
+    Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
+    if (conn == nullptr)
+        return;
+
+    if (conn->is_closing) {
+        tcp_server_.disconnect(ct);
+        deleteConnection(ct, conn);
+        return;
+    }
+
+    if (conn->sp_h2 != nullptr) {
+        conn->sp_h2->onSendCompleted();
+        return;
+    }
+
+    if (conn->sp_upgrade != nullptr) {
+        conn->sp_upgrade->onSendCompleted();
+        return;
+    }
+
+    //! 发送缓冲已空，通知正在流式回复的请求继续写
+    auto output = findOutput(conn, conn->res_index);
+    if (output != nullptr && output->writable_cb) {
+        auto cb = output->writable_cb;
+        ++cb_level_;
+        cb();
+        --cb_level_;
+    }
+}
+
 /**
- * 为了保证管道化连接中Respond与Request的顺序一致性，要做特殊处理。
- * 如果所提交的index不是当前需要回复的res_index，那么就先暂存起来，等前面的发送完成后再发送；
- * 如果是，则可以直接回复。然后再将暂存中的未发送的其它数据也一同发送。
+ * 回复头写入复用的 head_buff_，状态行取自预先生成的表，Body 不拷贝，与头一起用 writev() 发出。
+ * 只有 socket 发不完或需要暂存以保证顺序时，才会拷贝
  */
 void Server::Impl::commitRespond(const TcpServer::ConnToken &ct, int index, Respond *res)
 {
-    if (!tcp_server_.isClientValid(ct)) {
-        delete res;
+    Connection *conn = tcp_server_.isClientValid(ct) ? static_cast<Connection*>(tcp_server_.getContext(ct)) : nullptr;
+    if (conn == nullptr) {
+        sp_pool_->freeRespond(res);
+        return;
+    }
+
+    if (conn->sp_h2 != nullptr) {
+        if (!conn->is_closing)
+            conn->sp_h2->commitRespond(index, res);
+        else
+            sp_pool_->freeRespond(res);
+        return;
+    }
+
+    auto &head = head_buff_;
+    head.clear();
+    res->appendHeadTo(head);
+    if (res->headers.find(HeaderId::kDate) == res->headers.end())
+        head += dateHeader();
+    head += "Content-Length: ";
+    head += to_string(res->body.size());
+    head += CRLF CRLF;
+
+    if (context_log_enable_)
+        LogDbg("RES: [%s%s]", head.c_str(), res->body.c_str());
+
+    struct iovec iov[2] = {
+        { const_cast<char*>(head.data()), head.size() },
+        { const_cast<char*>(res->body.data()), res->body.size() },
+    };
+    appendRespond(ct, index, iov, 2, true);
+    sp_pool_->freeRespond(res);
+}
+
+void Server::Impl::appendRespondHead(const TcpServer::ConnToken &ct, int index, const Respond &res)
+{
+    if (!tcp_server_.isClientValid(ct))
         return;
+
+    Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
+    if (conn != nullptr && !conn->is_closing && conn->sp_h2 != nullptr)
+        conn->sp_h2->appendRespondHead(index, res);
+}
+
+const string& Server::Impl::dateHeader()
+{
+    time_t now = ::time(nullptr);
+    if (now != date_time_) {
+        date_time_ = now;
+        struct tm tm;
+        ::gmtime_r(&now, &tm);
+        char buff[64];
+        size_t len = ::strftime(buff, sizeof(buff), "Date: %a, %d %b %Y %H:%M:%S GMT" CRLF, &tm);
+        date_header_.assign(buff, len);
     }
+    return date_header_;
+}
+
+/**
+ * 为了保证管道化连接中Respond与Request的顺序一致性，要做特殊处理。
+ * 如果所提交的index不是当前需要回复的res_index，那么就先暂存起来，等前面的完成后再发送；
+ * 如果是，则可以直接发送。当前的回复完成后，再将暂存中的后续回复也一同发送。
+ */
+void Server::Impl::appendRespond(const TcpServer::ConnToken &ct, int index, const struct iovec *iov, int iovcnt, bool is_finished)
+{
+    if (!tcp_server_.isClientValid(ct))
+        return;
 
     Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
-    if (index == conn->res_index) {
-        //! 将当前的数据直接发送出去
-        {
-            const string &content = res->toString();
-            tcp_server_.send(ct, content.data(), content.size());
-            delete res;
-            if (context_log_enable_)
-                LogDbg("RES: [%s]", content.c_str());
+    if (conn == nullptr || conn->is_closing)
+        return;
+
+    if (conn->sp_h2 != nullptr) {
+        conn->sp_h2->appendRespond(index, iov, iovcnt, is_finished);
+        return;
+    }
+
+    auto output_ptr = findOutput(conn, index);
+    if (output_ptr == nullptr)
+        return;
+
+    auto &output = *output_ptr;
+    if (index == conn->res_index && output.data.empty() && output.files.empty()) {
+        tcp_server_.sendv(ct, iov, iovcnt);
+    } else {
+        string &buff = output.files.empty() ? output.data : output.files.back().tail;
+        for (int i = 0; i < iovcnt; ++i)
+            buff.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+    }
+
+    if (is_finished) {
+        output.is_finished = true;
+        output.writable_cb = nullptr;
+    }
+
+    if (index == conn->res_index)
+        flush(ct, conn);
+}
+
+void Server::Impl::appendFile(const TcpServer::ConnToken &ct, int index, Fd file_fd, off_t offset, size_t size)
+{
+    if (!tcp_server_.isClientValid(ct))
+        return;
+
+    Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
+    if (conn == nullptr || conn->is_closing || size == 0)
+        return;
+
+    if (conn->sp_h2 != nullptr) {
+        conn->sp_h2->appendFile(index, file_fd, offset, size);
+        return;
+    }
+
+    auto output = findOutput(conn, index);
+    if (output == nullptr)
+        return;
+
+    if (index == conn->res_index && output->data.empty() && output->files.empty())
+        tcp_server_.sendFile(ct, file_fd, offset, size);
+    else
+        output->files.push_back(Output::File{ file_fd, offset, size, string() });
+}
+
+void Server::Impl::flush(const TcpServer::ConnToken &ct, Connection *conn)
+{
+    auto output_ptr = findOutput(conn, conn->res_index);
+
+    while (output_ptr != nullptr) {
+        auto &output = *output_ptr;
+        if (!output.data.empty()) {
+            tcp_server_.send(ct, output.data.data(), output.data.size());
+            output.data.clear();
+        }
+
+        for (auto &file : output.files) {
+            tcp_server_.sendFile(ct, file.fd, file.offset, file.size);
+            if (!file.tail.empty())
+                tcp_server_.send(ct, file.tail.data(), file.tail.size());
         }
+        output.files.clear();
+
+        if (!output.is_finished)
+            return;
 
         //! 如果当前这个回复是最后一个，则需要断开连接
-        if (index == conn->close_index) {
-            tcp_server_.disconnect(ct);
-            conns_.erase(conn);
-            delete conn;
+        //! 但如果该请求的Body还在接收中，则要等接收完再断开，见 onTcpReceived()
+        if (conn->res_index == conn->close_index) {
+            if (conn->sp_stream_ctx != nullptr)
+                return;
+            resetOutput(output);
+            closeConnection(ct, conn);
             return;
         }
 
+        resetOutput(output);
         ++conn->res_index;
+        output_ptr = findOutput(conn, conn->res_index);
+        //! 后面可能有正在等待可写的流式回复
+        scheduleWritable(ct, conn);
+    }
+}
 
-        //! 尝试发送 conn->res_buff 缓冲中的数据
-        auto &res_buff = conn->res_buff;
-        auto iter = res_buff.find(conn->res_index);
-
-        while (iter != res_buff.end()) {
-            Respond *res = iter->second;
-            {
-                const string &content = res->toString();
-                tcp_server_.send(ct, content.data(), content.size());
-                delete res;
-                if (context_log_enable_)
-                    LogDbg("RES: [%s]", content.c_str());
-            }
+bool Server::Impl::isWritable(const TcpServer::ConnToken &ct, int index) const
+{
+    if (!tcp_server_.isClientValid(ct))
+        return false;
 
-            //! 如果当前这个回复是最后一个，则需要断开连接
-            if (index == conn->close_index) {
-                tcp_server_.disconnect(ct);
-                conns_.erase(conn);
-                delete conn;
+    Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
+    if (conn == nullptr || conn->is_closing)
+        return false;
+
+    if (conn->sp_h2 != nullptr)
+        return conn->sp_h2->isWritable(index);
+
+    if (index != conn->res_index)
+        return false;
+
+    return tcp_server_.getSendBufferSize(ct) < kSendBufferHighWater;
+}
+
+void Server::Impl::setWritableCallback(const TcpServer::ConnToken &ct, int index, const std::function<void()> &cb)
+{
+    if (!tcp_server_.isClientValid(ct))
+        return;
+
+    Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
+    if (conn == nullptr)
+        return;
+
+    if (conn->sp_h2 != nullptr) {
+        if (!conn->is_closing)
+            conn->sp_h2->setWritableCallback(index, cb);
+        return;
+    }
+
+    auto output = findOutput(conn, index);
+    if (output == nullptr || output->is_finished)
+        return;
+
+    output->writable_cb = cb;
+    if (index == conn->res_index)
+        scheduleWritable(ct, conn);
+}
+
+/**
+ * 升级时连接上不能有其它的请求，否则它们的回复会与新协议的数据混在一起。
+ * 101 回复没有Body，不能带 Content-Length，所以不经过 commitRespond()
+ */
+bool Server::Impl::upgrade(const TcpServer::ConnToken &ct, int index, const Respond &res, UpgradeHandler *sp_handler)
+{
+    if (!tcp_server_.isClientValid(ct))
+        return false;
+
+    Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
+    if (conn == nullptr || conn->is_closing || conn->sp_h2 != nullptr || conn->sp_upgrade != nullptr ||
+        conn->sp_stream_ctx != nullptr || index != conn->res_index || conn->req_index != index + 1)
+        return false;
+
+    auto &head = head_buff_;
+    head.clear();
+    res.appendHeadTo(head);
+    head += CRLF;
+
+    if (context_log_enable_)
+        LogDbg("RES: [%s]", head.c_str());
+
+    tcp_server_.send(ct, head.data(), head.size());
+    resetOutput(*findOutput(conn, index));
+
+    sp_handler->wp_server_ = this;
+    sp_handler->ct_ = ct;
+    conn->sp_upgrade = sp_handler;
+    sp_handler->onUpgraded();
+    return true;
+}
+
+event::Loop* UpgradeHandler::loop() const
+{
+    return wp_server_->wp_loop_;
+}
+
+bool UpgradeHandler::send(const struct iovec *iov, int iovcnt)
+{
+    return wp_server_->tcp_server_.sendv(ct_, iov, iovcnt);
+}
+
+size_t UpgradeHandler::getSendBufferSize() const
+{
+    return wp_server_->tcp_server_.getSendBufferSize(ct_);
+}
+
+void UpgradeHandler::close(bool is_wait_sent)
+{
+    if (is_wait_sent)
+        wp_server_->closeConnection(ct_);
+    else
+        wp_server_->abortConnection(ct_);
+}
+
+void Server::Impl::markClose(const TcpServer::ConnToken &ct, int index)
+{
+    if (!tcp_server_.isClientValid(ct))
+        return;
+
+    Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
+    if (conn != nullptr && index < conn->close_index)
+        conn->close_index = index;
+}
+
+/**
+ * 发送缓冲为空时不会有发送完成的回调，所以当前回复可写时，要在下一轮主动回调一次
+ * 不能在当前调用栈中直接回调，因为调用者可能正处于 Context 的析构中
+ */
+void Server::Impl::scheduleWritable(const TcpServer::ConnToken &ct, Connection *conn)
+{
+    if (conn->writable_run_id != 0)
+        return;
+
+    auto output = findOutput(conn, conn->res_index);
+    if (output == nullptr || !output->writable_cb)
+        return;
+
+    conn->writable_run_id = wp_loop_->runNext(
+        [this, ct] {
+            Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
+            if (conn == nullptr)
                 return;
-            }
 
-            res_buff.erase(iter);
+            conn->writable_run_id = 0;
+            auto output = findOutput(conn, conn->res_index);
+            if (output == nullptr || !output->writable_cb)
+                return;
 
-            ++conn->res_index;
-            iter = res_buff.find(conn->res_index);
-        }
+            if (isWritable(ct, conn->res_index)) {
+                auto cb = output->writable_cb;
+                ++cb_level_;
+                cb();
+                --cb_level_;
+            }
+        },
+        "http::Server::scheduleWritable"
+    );
+}
+
+//! 关闭连接前要等发送缓冲中的数据发送完成，否则会丢失
+void Server::Impl::closeConnection(const TcpServer::ConnToken &ct, Connection *conn)
+{
+    if (tcp_server_.getSendBufferSize(ct) > 0) {
+        conn->is_closing = true;
+        tcp_server_.shutdown(ct, SHUT_RD);
     } else {
-        //! 放入到 conn.res_buff 中暂存
-        conn->res_buff[index] = res;
+        tcp_server_.disconnect(ct);
+        deleteConnection(ct, conn);
     }
 }
 
-void Server::Impl::handle(ContextSptr sp_ctx, size_t cb_index)
+void Server::Impl::deleteConnection(const TcpServer::ConnToken &ct, Connection *conn)
+{
+    //! 先解除关联，因为释放 outputs 与 sp_stream_ctx 时会析构 Context，回调到 commitRespond()
+    if (tcp_server_.isClientValid(ct))
+        tcp_server_.setContext(ct, nullptr);
+
+    conns_.erase(conn);
+    wp_loop_->cancel(conn->writable_run_id);
+    CHECK_DELETE_RESET_OBJ(conn->sp_h2);
+    CHECK_DELETE_RESET_OBJ(conn->sp_upgrade);
+    delete conn;
+}
+
+void Server::Impl::closeConnection(const TcpServer::ConnToken &ct)
+{
+    if (!tcp_server_.isClientValid(ct))
+        return;
+
+    Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
+    if (conn != nullptr && !conn->is_closing)
+        closeConnection(ct, conn);
+}
+
+void Server::Impl::abortConnection(const TcpServer::ConnToken &ct)
+{
+    if (!tcp_server_.isClientValid(ct))
+        return;
+
+    Connection *conn = static_cast<Connection*>(tcp_server_.getContext(ct));
+    tcp_server_.disconnect(ct);
+    if (conn != nullptr)
+        deleteConnection(ct, conn);
+}
+
+/**
+ * 以连接序言开头的为 prior knowledge 方式的 HTTP/2 连接，只在连接的开头检查。
+ * 返回 true 表示已交给 HTTP/2 处理，或者数据还不足以判断
+ */
+bool Server::Impl::checkHttp2Preface(const TcpServer::ConnToken &ct, Connection *conn, Buffer &buff)
+{
+    if (!http2_enable_ || conn->req_index != 0 ||
+        conn->req_parser.state() != RequestParser::State::kInit)
+        return false;
+
+    size_t size = std::min(buff.readableSize(), http2::kClientPrefaceSize);
+    if (size == 0 || ::memcmp(buff.readableBegin(), http2::kClientPreface, size) != 0)
+        return false;
+
+    if (size < http2::kClientPrefaceSize)
+        return true;
+
+    conn->sp_h2 = new Http2Session(this, ct);
+    conn->sp_h2->start();
+    conn->sp_h2->onReceived(buff);
+    return true;
+}
+
+/**
+ * 带 Upgrade: h2c 与 HTTP2-Settings 的请求，回复 101 后切换到 HTTP/2，该请求作为 stream 1 处理。
+ * 前面还有未完成的回复，或带有Body的请求不升级，按 HTTP/1.1 处理
+ * 返回 true 时 req 已被接管
+ */
+bool Server::Impl::checkHttp2Upgrade(const TcpServer::ConnToken &ct, Connection *conn, Request *req)
+{
+    if (!http2_enable_ || req->http_ver != HttpVer::k1_1 ||
+        conn->res_index != conn->req_index || !req->body.empty())
+        return false;
+
+    auto upgrade = req->headers.get(HeaderId::kUpgrade);
+    if (upgrade == nullptr || ::strcasestr(upgrade->c_str(), "h2c") == nullptr)
+        return false;
+
+    auto settings_value = req->headers.get("HTTP2-Settings");
+    std::string settings;
+    if (settings_value == nullptr || !Http2Session::DecodeSettings(*settings_value, settings))
+        return false;
+
+    const char *switching = "HTTP/1.1 101 Switching Protocols" CRLF
+                            "Connection: Upgrade" CRLF
+                            "Upgrade: h2c" CRLF CRLF;
+    tcp_server_.send(ct, switching, ::strlen(switching));
+
+    req->headers.erase(HeaderId::kUpgrade);
+    req->headers.erase(HeaderId::kConnection);
+
+    conn->sp_h2 = new Http2Session(this, ct);
+    conn->sp_h2->startUpgrade(settings, req);
+    return true;
+}
+
+void Server::Impl::handle(ContextSptr sp_ctx, size_t cb_index, const NextFunc &next)
 {
     if (cb_index >= req_cb_.size())
         return;
 
-    auto func = req_cb_.at(cb_index);
+    auto &func = req_cb_[cb_index];
 
     ++cb_level_;
     if (func)
-        func(sp_ctx, std::bind(&Impl::handle, this, sp_ctx, cb_index + 1));
+        func(std::move(sp_ctx), next);
     --cb_level_;
 }
 
-Server::Impl::Connection::~Connection()
+void Server::Impl::prepareOutput(Connection *conn)
+{
+    auto &outputs = conn->outputs;
+    size_t count = conn->req_index - conn->res_index + 1;
+    if (count <= outputs.size())
+        return;
+
+    //! 扩容时按新的容量重新摆放已有的输出
+    size_t new_size = outputs.empty() ? 4 : outputs.size() * 2;
+    vector<Output> new_outputs(new_size);
+    for (int index = conn->res_index; index < conn->req_index; ++index)
+        new_outputs[index & (new_size - 1)] = std::move(outputs[index & (outputs.size() - 1)]);
+    outputs.swap(new_outputs);
+}
+
+auto Server::Impl::findOutput(Connection *conn, int index) const -> Output*
+{
+    if (index < conn->res_index || index >= conn->req_index)
+        return nullptr;
+    return &conn->outputs[index & (conn->outputs.size() - 1)];
+}
+
+void Server::Impl::resetOutput(Output &output)
 {
-    //! 一定要记得清除非发送的Respond
-    for (auto & item : res_buff)
-        delete item.second;
+    if (output.data.capacity() > kMaxKeepOutputCapacity)
+        string().swap(output.data);
+    else
+        output.data.clear();
+    output.files.clear();
+    output.is_finished = false;
+    //! 可能持有 Context，最后释放
+    auto writable_cb = std::move(output.writable_cb);
+    output.writable_cb = nullptr;
 }
 
 }
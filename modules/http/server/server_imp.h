@@ -21,9 +21,10 @@
 #define TBOX_HTTP_SERVER_H_20220502
 
 #include <vector>
-#include <map>
+#include <deque>
 #include <set>
 #include <limits>
+#include <functional>
 #include <tbox/network/tcp_server.h>
 
 #include "server.h"
@@ -36,11 +37,18 @@ struct Respond;
 
 namespace server {
 
+class Http2Session;
+class UpgradeHandler;
+class ContextPool;
+
 using namespace event;
 using namespace network;
 using namespace std;
 
 class Server::Impl {
+    friend Http2Session;
+    friend UpgradeHandler;
+
   public:
     Impl(Server *wp_parent, event::Loop *wp_loop);
     ~Impl();
@@ -53,18 +61,55 @@ class Server::Impl {
 
     State state() const { return state_; }
     void setContextLogEnable(bool enable) { context_log_enable_ = enable; }
+    void setBodyStreamThreshold(size_t threshold);
+    void setHttp2Enable(bool enable) { http2_enable_ = enable; }
 
   public:
     void use(const RequestCallback &cb);
     void use(Middleware *wp_middleware);
 
+    //! 依次调用中间件，由 Context 发起与推进
+    void handle(ContextSptr sp_ctx, size_t cb_index, const NextFunc &next);
+
     void commitRespond(const TcpServer::ConnToken &ct, int index, Respond *res);
 
+    //! 以下供 Context 流式回复使用
+    //! 流式回复的头部，仅 HTTP/2 使用，HTTP/1.x 的头部由 Context 拼好后经 appendRespond() 发出
+    void appendRespondHead(const TcpServer::ConnToken &ct, int index, const Respond &res);
+    void appendRespond(const TcpServer::ConnToken &ct, int index, const struct iovec *iov, int iovcnt, bool is_finished);
+    void appendRespond(const TcpServer::ConnToken &ct, int index, const char *data_ptr, size_t data_size, bool is_finished) {
+        struct iovec iov = { const_cast<char*>(data_ptr), data_size };
+        appendRespond(ct, index, &iov, 1, is_finished);
+    }
+    void appendFile(const TcpServer::ConnToken &ct, int index, Fd file_fd, off_t offset, size_t size);
+    bool isWritable(const TcpServer::ConnToken &ct, int index) const;
+    void setWritableCallback(const TcpServer::ConnToken &ct, int index, const std::function<void()> &cb);
+    void markClose(const TcpServer::ConnToken &ct, int index);
+    bool upgrade(const TcpServer::ConnToken &ct, int index, const Respond &res, UpgradeHandler *sp_handler);
+
+    //! 获取 "Date: ...\r\n" 头，每秒只格式化一次
+    const string& dateHeader();
+
   private:
 
     void onTcpConnected(const TcpServer::ConnToken &ct);
     void onTcpDisconnected(const TcpServer::ConnToken &ct);
     void onTcpReceived(const TcpServer::ConnToken &ct, Buffer &buff);
+    void onTcpSendCompleted(const TcpServer::ConnToken &ct);
+
+    //! 一个请求的回复输出
+    struct Output {
+        string data;        //!< 未能发出的数据
+        struct File {
+            Fd fd;
+            off_t offset;
+            size_t size;
+            string tail;    //!< 排在该文件之后的数据
+        };
+        deque<File> files;  //!< 排在 data 之后未能发出的文件
+        bool is_finished = false;
+        std::function<void()> writable_cb;
+    };
 
     //! 连接信息
     struct Connection {
@@ -72,21 +117,53 @@ class Server::Impl {
         int req_index = 0;  //!< 下一个请求的index
         int res_index = 0;  //!< 下一个要求回复的index，用于实现按顺序回复
         int close_index = numeric_limits<int>::max();   //!< 需要关闭连接的index
-        map<int, Respond*> res_buff;  //!< 暂存器
-
-        ~Connection();
+        bool is_closing = false;    //!< 等待发送缓冲中的数据发送完成后断开
+        /**
+         * 各请求的回复输出，实现按顺序回复
+         * 环形缓冲，[res_index, req_index) 中的 index 存放在 outputs[index & (size - 1)]。
+         * 容量为2的幂，不够时翻倍，槽位复用，其中的缓冲也随之复用
+         */
+        vector<Output> outputs;
+        ContextSptr sp_stream_ctx;  //!< 正在流式接收Body的请求
+        bool is_stream_ended = false;
+        Loop::RunId writable_run_id = 0;
+        Http2Session *sp_h2 = nullptr;  //!< 已切换到 HTTP/2 时不为空，由其接管收发
+        UpgradeHandler *sp_upgrade = nullptr;   //!< 已升级为其它协议时不为空，如 WebSocket
     };
 
-    void handle(ContextSptr ctx, size_t cb_index);
+    //! 为下一个请求 (req_index) 准备好输出的槽位
+    void prepareOutput(Connection *conn);
+    //! 获取 index 的输出，index 不在 [res_index, req_index) 中时返回 nullptr
+    Output* findOutput(Connection *conn, int index) const;
+    void resetOutput(Output &output);
+
+    //! 检查是否要切换到 HTTP/2，已切换时返回 true
+    bool checkHttp2Preface(const TcpServer::ConnToken &ct, Connection *conn, Buffer &buff);
+    bool checkHttp2Upgrade(const TcpServer::ConnToken &ct, Connection *conn, Request *req);
+
+    void flush(const TcpServer::ConnToken &ct, Connection *conn);
+    void scheduleWritable(const TcpServer::ConnToken &ct, Connection *conn);
+    void closeConnection(const TcpServer::ConnToken &ct, Connection *conn);
+    void deleteConnection(const TcpServer::ConnToken &ct, Connection *conn);
+    void closeConnection(const TcpServer::ConnToken &ct);
+    void abortConnection(const TcpServer::ConnToken &ct);
 
   private:
     Server *wp_parent_;
+    Loop *wp_loop_;
 
     TcpServer tcp_server_;
     vector<RequestCallback> req_cb_;
     set<Connection*> conns_;    //! 仅用于保存Connection指针，用于释放
+    ContextPool *sp_pool_;      //!< Request, Respond, Context 的池
     State state_ = State::kNone;
     bool context_log_enable_ = false;
+    size_t body_stream_threshold_ = numeric_limits<size_t>::max();
+    bool http2_enable_ = true;
+
+    string head_buff_;          //!< 复用的回复头缓冲
+    time_t date_time_ = 0;
+    string date_header_;
 
     int cb_level_ = 0;
 };
@@ -0,0 +1,358 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <tbox/event/loop.h>
+#include <tbox/event/timer_event.h>
+#include <tbox/network/buffered_fd.h>
+
+#include "server.h"
+
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::network;
+using namespace tbox::http;
+using namespace tbox::http::server;
+
+namespace {
+
+const char *kBindAddr = "127.0.0.1:51080";
+
+//! 连接到服务端，返回由 BufferedFd 管理的客户端
+BufferedFd* Connect(Loop *wp_loop)
+{
+    int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(51080);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (::connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        ::close(sock);
+        return nullptr;
+    }
+
+    Fd fd(sock);
+    fd.setNonBlock(true);
+
+    auto client = new BufferedFd(wp_loop);
+    client->initialize(fd);
+    client->enable();
+    return client;
+}
+
+//! 去掉所有的 Date 头，以便比较
+std::string RemoveDate(std::string text)
+{
+    for (;;) {
+        auto pos = text.find("\r\nDate: ");
+        if (pos == std::string::npos)
+            return text;
+        text.erase(pos + 2, text.find("\r\n", pos + 2) - pos);
+    }
+}
+
+}
+
+TEST(Server, StreamRequestAndRespond)
+{
+    auto sp_loop = Loop::New();
+    Server server(sp_loop);
+    ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+    server.setBodyStreamThreshold(16);
+
+    std::string req_body;
+    server.use(
+        [&] (ContextSptr ctx, const NextFunc &) {
+            EXPECT_TRUE(ctx->isBodyStreaming());
+            EXPECT_EQ(ctx->req().body, "");
+            ctx->res().status_code = StatusCode::k200_OK;
+            ctx->setBodyReader(
+                [&, ctx] (const char *data_ptr, size_t data_size) {
+                    if (data_size != 0) {
+                        req_body.append(data_ptr, data_size);
+                    } else {
+                        ctx->write("got " + std::to_string(req_body.size()));
+                        ctx->end();
+                    }
+                }
+            );
+        }
+    );
+    server.start();
+
+    auto client = Connect(sp_loop);
+    ASSERT_NE(client, nullptr);
+
+    std::string received;
+    client->setReceiveCallback(
+        [&] (Buffer &buff) {
+            received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+        }, 0
+    );
+
+    std::string text = \
+        "POST /upload HTTP/1.1\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "3\r\nabc\r\n";
+    client->send(text.data(), text.size());
+
+    //! Body 分多次到达
+    auto timer = sp_loop->newTimerEvent();
+    timer->initialize(std::chrono::milliseconds(10), Event::Mode::kOneshot);
+    timer->setCallback(
+        [&] {
+            EXPECT_EQ(req_body, "abc");
+            std::string text = "4\r\ndefg\r\n0\r\n\r\n";
+            client->send(text.data(), text.size());
+        }
+    );
+    timer->enable();
+
+    sp_loop->exitLoop(std::chrono::milliseconds(100));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(req_body, "abcdefg");
+    EXPECT_NE(received.find("\r\nDate: "), std::string::npos);
+    EXPECT_EQ(RemoveDate(received),
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5\r\ngot 7\r\n"
+        "0\r\n\r\n");
+
+    delete timer;
+    delete client;
+    server.cleanup();
+    delete sp_loop;
+}
+
+//! 流式回复时，发送缓冲满则暂停，待可写时继续
+TEST(Server, RespondBackpressure)
+{
+    auto sp_loop = Loop::New();
+    Server server(sp_loop);
+    ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+    const size_t kTotalSize = 8 << 20;
+    const std::string piece(64 << 10, 'x');
+    size_t sent_size = 0;
+    int pause_times = 0;
+
+    server.use(
+        [&] (ContextSptr ctx, const NextFunc &) {
+            ctx->res().status_code = StatusCode::k200_OK;
+            ctx->res().headers["Content-Length"] = std::to_string(kTotalSize);
+
+            auto send_func = [&, ctx] {
+                while (sent_size < kTotalSize) {
+                    sent_size += piece.size();
+                    if (!ctx->write(piece)) {
+                        ++pause_times;
+                        return;
+                    }
+                }
+                ctx->end();
+            };
+            ctx->setWritableCallback(send_func);
+        }
+    );
+    server.start();
+
+    auto client = Connect(sp_loop);
+    ASSERT_NE(client, nullptr);
+
+    size_t received_size = 0;
+    std::string head;
+    client->setReceiveCallback(
+        [&] (Buffer &buff) {
+            if (head.empty()) {
+                const char *begin = reinterpret_cast<const char*>(buff.readableBegin());
+                std::string text(begin, buff.readableSize());
+                auto pos = text.find("\r\n\r\n");
+                if (pos == std::string::npos)
+                    return;
+                head = text.substr(0, pos + 4);
+                buff.hasRead(pos + 4);
+            }
+            received_size += buff.readableSize();
+            buff.hasReadAll();
+        }, 0
+    );
+
+    std::string text = "GET /big HTTP/1.1\r\n\r\n";
+    client->send(text.data(), text.size());
+
+    sp_loop->exitLoop(std::chrono::seconds(1));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(RemoveDate(head), "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(kTotalSize) + "\r\n\r\n");
+    EXPECT_EQ(received_size, kTotalSize);
+    EXPECT_GT(pause_times, 0);
+
+    delete client;
+    server.cleanup();
+    delete sp_loop;
+}
+
+//! 管道化请求中，后面的请求先完成，也要等前面的流式回复结束后才发出
+TEST(Server, PipelinedStreamOrder)
+{
+    auto sp_loop = Loop::New();
+    Server server(sp_loop);
+    ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+    auto timer = sp_loop->newTimerEvent();
+    timer->initialize(std::chrono::milliseconds(10), Event::Mode::kOneshot);
+
+    server.use(
+        [&] (ContextSptr ctx, const NextFunc &) {
+            ctx->res().status_code = StatusCode::k200_OK;
+            if (ctx->req().url.path == "/slow") {
+                ctx->write("a");
+                timer->setCallback([ctx] { ctx->write("b"); ctx->end(); });
+                timer->enable();
+            } else {
+                ctx->res().body = "fast";
+            }
+        }
+    );
+    server.start();
+
+    auto client = Connect(sp_loop);
+    ASSERT_NE(client, nullptr);
+
+    std::string received;
+    client->setReceiveCallback(
+        [&] (Buffer &buff) {
+            received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+        }, 0
+    );
+
+    std::string text = \
+        "GET /slow HTTP/1.1\r\n\r\n"
+        "GET /fast HTTP/1.1\r\n\r\n";
+    client->send(text.data(), text.size());
+
+    sp_loop->exitLoop(std::chrono::milliseconds(100));
+    sp_loop->runLoop();
+
+    EXPECT_NE(received.find("\r\nDate: "), std::string::npos);
+    EXPECT_EQ(RemoveDate(received),
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "1\r\na\r\n"
+        "1\r\nb\r\n"
+        "0\r\n\r\n"
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 4\r\n"
+        "\r\n"
+        "fast");
+
+    delete timer;
+    delete client;
+    server.cleanup();
+    delete sp_loop;
+}
+
+/**
+ * 大量流水线请求，前面的请求延后回复：回复仍须按顺序发出。
+ * 中间件延后调用 next()，请求对象在复用后不应残留上一个请求的内容
+ */
+TEST(Server, DeepPipelineWithDeferredNext)
+{
+    const int kRequestNum = 40;
+
+    auto sp_loop = Loop::New();
+    Server server(sp_loop);
+    ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+    std::vector<std::pair<ContextSptr, NextFunc>> deferred;
+    server.use(
+        [&] (ContextSptr ctx, const NextFunc &next) {
+            if (ctx->req().url.path == "/0")
+                deferred.emplace_back(ctx, next);
+            else
+                next();
+        }
+    );
+    server.use(
+        [&] (ContextSptr ctx, const NextFunc &) {
+            EXPECT_EQ(ctx->req().headers.count("X-First"), ctx->req().url.path == "/0" ? 1u : 0u);
+            ctx->res().status_code = StatusCode::k200_OK;
+            ctx->res().body = ctx->req().url.path + ctx->req().body;
+        }
+    );
+    server.start();
+
+    auto timer = sp_loop->newTimerEvent();
+    timer->initialize(std::chrono::milliseconds(20), Event::Mode::kOneshot);
+    timer->setCallback(
+        [&] {
+            for (auto &item : deferred)
+                item.second();
+            deferred.clear();
+        }
+    );
+    timer->enable();
+
+    auto client = Connect(sp_loop);
+    ASSERT_NE(client, nullptr);
+
+    std::string received;
+    client->setReceiveCallback(
+        [&] (Buffer &buff) {
+            received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+        }, 0
+    );
+
+    std::string text = "GET /0 HTTP/1.1\r\nX-First: 1\r\n\r\n";
+    std::string expect = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n/0";
+    for (int i = 1; i < kRequestNum; ++i) {
+        auto path = "/" + std::to_string(i);
+        text += "POST " + path + " HTTP/1.1\r\nContent-Length: 1\r\n\r\nx";
+        auto body = path + "x";
+        expect += "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+
+    //! 分两次发，第二批到达时前面的Context已有部分被释放并复用
+    client->send(text.data(), text.size() / 2);
+    sp_loop->exitLoop(std::chrono::milliseconds(10));
+    sp_loop->runLoop();
+    client->send(text.data() + text.size() / 2, text.size() - text.size() / 2);
+
+    sp_loop->exitLoop(std::chrono::milliseconds(100));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(RemoveDate(received), expect);
+
+    delete timer;
+    delete client;
+    server.cleanup();
+    delete sp_loop;
+}
@@ -0,0 +1,440 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "static_file.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <ctime>
+#include <cstring>
+#include <cstdio>
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+#include <tbox/base/log.h>
+
+namespace tbox {
+namespace http {
+namespace server {
+
+namespace {
+
+//! 文件信息
+struct FileInfo {
+    network::Fd fd;
+    size_t size = 0;
+    time_t mtime = 0;
+    ino_t ino = 0;
+    std::string etag;
+    std::string last_modified;
+    const std::string *mime_type = nullptr;
+};
+
+std::string TimeToHttpDate(time_t t)
+{
+    struct tm tm;
+    ::gmtime_r(&t, &tm);
+    char buff[32];
+    size_t len = ::strftime(buff, sizeof(buff), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(buff, len);
+}
+
+bool HttpDateToTime(const std::string &str, time_t &t)
+{
+    struct tm tm;
+    ::memset(&tm, 0, sizeof(tm));
+    const char *end = ::strptime(str.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (end == nullptr || *end != '\0')
+        return false;
+    t = ::timegm(&tm);
+    return true;
+}
+
+//! path 是否以 prefix 开头，且匹配止于路径段的边界，避免 "/static" 匹配到 "/staticfoo"
+bool IsPrefixMatch(const std::string &path, const std::string &prefix)
+{
+    if (path.compare(0, prefix.size(), prefix) != 0)
+        return false;
+
+    return path.size() == prefix.size() ||
+           prefix.back() == '/' ||
+           path[prefix.size()] == '/';
+}
+
+//! 路径中不允许出现 ".." 段，防止访问到目录之外的文件
+bool IsPathSafe(const std::string &path)
+{
+    if (path.find('\0') != std::string::npos)
+        return false;
+
+    size_t pos = 0;
+    while (pos <= path.size()) {
+        size_t end = path.find('/', pos);
+        if (end == std::string::npos)
+            end = path.size();
+        if (end - pos == 2 && path[pos] == '.' && path[pos + 1] == '.')
+            return false;
+        pos = end + 1;
+    }
+    return true;
+}
+
+//! If-None-Match 中是否有与 etag 匹配的项
+bool IsEtagMatch(const std::string &value, const std::string &etag)
+{
+    if (value == "*")
+        return true;
+
+    size_t pos = 0;
+    while (pos < value.size()) {
+        size_t end = value.find(',', pos);
+        if (end == std::string::npos)
+            end = value.size();
+
+        size_t begin = pos;
+        while (begin < end && value[begin] == ' ')
+            ++begin;
+        //! 弱比较，忽略 W/ 前缀
+        if (value.compare(begin, 2, "W/") == 0)
+            begin += 2;
+        size_t item_end = end;
+        while (item_end > begin && value[item_end - 1] == ' ')
+            --item_end;
+
+        if (value.compare(begin, item_end - begin, etag) == 0)
+            return true;
+        pos = end + 1;
+    }
+    return false;
+}
+
+enum class RangeResult { kNone, kOk, kUnsatisfiable };
+
+/**
+ * 解析 Range，只支持单个区间：
+ *   bytes=a-b, bytes=a-, bytes=-n
+ * 格式不对或有多个区间时返回 kNone，按没有 Range 处理
+ */
+RangeResult ParseRange(const std::string &value, size_t file_size, size_t &begin, size_t &end)
+{
+    if (value.compare(0, 6, "bytes=") != 0 || value.find(',') != std::string::npos)
+        return RangeResult::kNone;
+
+    const char *p = value.c_str() + 6;
+    const char *dash = ::strchr(p, '-');
+    if (dash == nullptr)
+        return RangeResult::kNone;
+
+    auto parse_num = [] (const char *b, const char *e, size_t &num) {
+        if (b == e || e - b > 19)
+            return false;
+        num = 0;
+        for (; b < e; ++b) {
+            if (*b < '0' || *b > '9')
+                return false;
+            num = num * 10 + (*b - '0');
+        }
+        return true;
+    };
+
+    const char *value_end = value.c_str() + value.size();
+    size_t first = 0, last = 0;
+    bool has_first = parse_num(p, dash, first);
+    bool has_last = parse_num(dash + 1, value_end, last);
+
+    if (!has_first && p != dash)
+        return RangeResult::kNone;
+    if (!has_last && dash + 1 != value_end)
+        return RangeResult::kNone;
+
+    if (has_first) {
+        if (first >= file_size)
+            return RangeResult::kUnsatisfiable;
+        if (has_last && last < first)
+            return RangeResult::kNone;
+        begin = first;
+        end = (has_last && last < file_size) ? last + 1 : file_size;
+
+    } else if (has_last) {  //! 最后 n 个字节
+        if (last == 0)
+            return RangeResult::kUnsatisfiable;
+        begin = last < file_size ? file_size - last : 0;
+        end = file_size;
+
+    } else {
+        return RangeResult::kNone;
+    }
+
+    return RangeResult::kOk;
+}
+
+const char* GetHeader(const Request &req, HeaderId id)
+{
+    auto value = req.headers.get(id);
+    return value != nullptr ? value->c_str() : nullptr;
+}
+
+}
+
+struct StaticFile::Data {
+    std::vector<std::pair<std::string, std::string>> binds;   //!< url_prefix -> dir
+    std::string index_file = "index.html";
+    std::unordered_map<std::string, std::string> mime_types;
+    std::string default_mime_type = "application/octet-stream";
+
+    //! LRU 缓存，最近使用的在前面
+    using CacheList = std::list<std::pair<std::string, FileInfo>>;
+    CacheList cache_list;
+    std::unordered_map<std::string, CacheList::iterator> cache_map;
+    size_t cache_capacity = 32;
+
+    const FileInfo* openFile(std::string &file_path);
+    void shrinkCache();
+};
+
+StaticFile::StaticFile() :
+    d_(new Data)
+{
+    d_->mime_types = {
+        {"html", "text/html; charset=utf-8"},
+        {"htm",  "text/html; charset=utf-8"},
+        {"css",  "text/css; charset=utf-8"},
+        {"js",   "application/javascript; charset=utf-8"},
+        {"json", "application/json"},
+        {"txt",  "text/plain; charset=utf-8"},
+        {"xml",  "application/xml"},
+        {"svg",  "image/svg+xml"},
+        {"png",  "image/png"},
+        {"jpg",  "image/jpeg"},
+        {"jpeg", "image/jpeg"},
+        {"gif",  "image/gif"},
+        {"ico",  "image/x-icon"},
+        {"webp", "image/webp"},
+        {"wasm", "application/wasm"},
+        {"pdf",  "application/pdf"},
+        {"zip",  "application/zip"},
+        {"gz",   "application/gzip"},
+    };
+}
+
+StaticFile::~StaticFile()
+{
+    delete d_;
+}
+
+bool StaticFile::bind(const std::string &url_prefix, const std::string &dir)
+{
+    if (url_prefix.empty() || url_prefix[0] != '/' || dir.empty()) {
+        LogWarn("invalid bind, url_prefix:%s, dir:%s", url_prefix.c_str(), dir.c_str());
+        return false;
+    }
+
+    d_->binds.emplace_back(url_prefix, dir);
+    return true;
+}
+
+void StaticFile::setIndexFile(const std::string &name)
+{
+    d_->index_file = name;
+}
+
+void StaticFile::setCacheCapacity(size_t capacity)
+{
+    d_->cache_capacity = capacity;
+    d_->shrinkCache();
+}
+
+void StaticFile::setMimeType(const std::string &ext, const std::string &mime_type)
+{
+    d_->mime_types[ext] = mime_type;
+}
+
+//! 至少保留最近的一个，因为本次请求还要用
+void StaticFile::Data::shrinkCache()
+{
+    while (cache_list.size() > 1 && cache_list.size() > cache_capacity) {
+        cache_map.erase(cache_list.back().first);
+        cache_list.pop_back();
+    }
+}
+
+/**
+ * 先查缓存，若文件的 inode、大小、修改时间都没有变，则直接使用缓存中的fd
+ * 否则重新打开。file_path 为目录时，会被改为其下的 index 文件
+ */
+const FileInfo* StaticFile::Data::openFile(std::string &file_path)
+{
+    struct stat st;
+    if (::stat(file_path.c_str(), &st) != 0)
+        return nullptr;
+
+    if (S_ISDIR(st.st_mode)) {
+        if (file_path.back() != '/')
+            file_path.push_back('/');
+        file_path += index_file;
+        if (::stat(file_path.c_str(), &st) != 0)
+            return nullptr;
+    }
+
+    if (!S_ISREG(st.st_mode))
+        return nullptr;
+
+    auto iter = cache_map.find(file_path);
+    if (iter != cache_map.end()) {
+        auto &info = iter->second->second;
+        if (info.ino == st.st_ino && info.size == static_cast<size_t>(st.st_size) && info.mtime == st.st_mtime) {
+            cache_list.splice(cache_list.begin(), cache_list, iter->second);
+            return &info;
+        }
+        cache_list.erase(iter->second);
+        cache_map.erase(iter);
+    }
+
+    int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LogNotice("open %s fail, errno:%d, %s", file_path.c_str(), errno, strerror(errno));
+        return nullptr;
+    }
+
+    FileInfo info;
+    info.fd = network::Fd(fd);
+    info.size = st.st_size;
+    info.mtime = st.st_mtime;
+    info.ino = st.st_ino;
+
+    char etag[48];
+    ::snprintf(etag, sizeof(etag), "\"%lx-%zx\"", static_cast<unsigned long>(st.st_mtime), info.size);
+    info.etag = etag;
+    info.last_modified = TimeToHttpDate(st.st_mtime);
+
+    info.mime_type = &default_mime_type;
+    auto dot_pos = file_path.rfind('.');
+    auto slash_pos = file_path.rfind('/');
+    if (dot_pos != std::string::npos && (slash_pos == std::string::npos || dot_pos > slash_pos)) {
+        auto mime_iter = mime_types.find(file_path.substr(dot_pos + 1));
+        if (mime_iter != mime_types.end())
+            info.mime_type = &mime_iter->second;
+    }
+
+    cache_list.emplace_front(file_path, std::move(info));
+    cache_map[file_path] = cache_list.begin();
+    shrinkCache();
+
+    return &cache_list.front().second;
+}
+
+void StaticFile::handle(ContextSptr sp_ctx, const NextFunc &next)
+{
+    const auto &req = sp_ctx->req();
+    if (req.method != Method::kGet && req.method != Method::kHead) {
+        next();
+        return;
+    }
+
+    const std::string &path = req.url.path;
+    const std::pair<std::string, std::string> *wp_bind = nullptr;
+    for (auto &item : d_->binds) {
+        if (IsPrefixMatch(path, item.first)) {
+            wp_bind = &item;
+            break;
+        }
+    }
+
+    if (wp_bind == nullptr) {
+        next();
+        return;
+    }
+
+    auto &res = sp_ctx->res();
+
+    std::string rel_path = path.substr(wp_bind->first.size());
+    if (!IsPathSafe(rel_path)) {
+        res.status_code = StatusCode::k403_Forbidden;
+        return;
+    }
+
+    std::string file_path = wp_bind->second;
+    if (!rel_path.empty() && file_path.back() != '/' && rel_path[0] != '/')
+        file_path.push_back('/');
+    file_path += rel_path;
+
+    auto info = d_->openFile(file_path);
+    if (info == nullptr) {
+        next();
+        return;
+    }
+
+    //! 在下一次 openFile() 之前，info 都是有效的；而 Fd 是引用计数的，发送中不会被关闭
+    res.headers[HeaderId::kETag] = info->etag;
+    res.headers[HeaderId::kLastModified] = info->last_modified;
+    res.headers[HeaderId::kAcceptRanges] = "bytes";
+    res.headers[HeaderId::kContentType] = *info->mime_type;
+
+    //! 条件请求，If-None-Match 优先
+    bool is_not_modified = false;
+    auto if_none_match = GetHeader(req, HeaderId::kIfNoneMatch);
+    if (if_none_match != nullptr) {
+        is_not_modified = IsEtagMatch(if_none_match, info->etag);
+    } else {
+        auto if_modified_since = GetHeader(req, HeaderId::kIfModifiedSince);
+        time_t since = 0;
+        if (if_modified_since != nullptr && HttpDateToTime(if_modified_since, since))
+            is_not_modified = info->mtime <= since;
+    }
+
+    size_t begin = 0, end = info->size;
+    auto range = RangeResult::kNone;
+    auto range_value = GetHeader(req, HeaderId::kRange);
+    if (range_value != nullptr && !is_not_modified) {
+        //! If-Range 不匹配时，要回复整个文件
+        auto if_range = GetHeader(req, HeaderId::kIfRange);
+        if (if_range == nullptr || info->etag == if_range || info->last_modified == if_range)
+            range = ParseRange(range_value, info->size, begin, end);
+    }
+
+    if (range == RangeResult::kUnsatisfiable) {
+        res.status_code = StatusCode::k416_RequestedRangeNotSatisfiable;
+        res.headers[HeaderId::kContentRange] = "bytes */" + std::to_string(info->size);
+        return;
+    }
+
+    if (is_not_modified) {
+        res.status_code = StatusCode::k304_NotModified;
+    } else if (range == RangeResult::kOk) {
+        res.status_code = StatusCode::k206_PartialContent;
+        res.headers[HeaderId::kContentRange] = "bytes " + std::to_string(begin) + "-"
+                                     + std::to_string(end - 1) + "/" + std::to_string(info->size);
+    } else {
+        res.status_code = StatusCode::k200_OK;
+    }
+
+    res.headers[HeaderId::kContentLength] = std::to_string(end - begin);
+
+    //! 有 Content-Length，不会使用 chunked，HEAD 与 304 只回复头
+    if (req.method == Method::kGet && !is_not_modified)
+        sp_ctx->writeFile(info->fd, begin, end - begin);
+    else
+        sp_ctx->write(nullptr, 0);
+    sp_ctx->end();
+}
+
+}
+}
+}
@@ -0,0 +1,73 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_SERVER_STATIC_FILE_H_20251019
+#define TBOX_HTTP_SERVER_STATIC_FILE_H_20251019
+
+#include "middleware.h"
+#include "context.h"
+
+namespace tbox {
+namespace http {
+namespace server {
+
+/**
+ * 静态文件中间件
+ *
+ * 将指定前缀的 GET/HEAD 请求映射到目录下的文件，文件内容通过 sendfile() 直接由内核
+ * 发送到socket，不经过用户空间。支持：
+ * - Range: bytes=a-b，只支持单个区间，多区间时回复整个文件
+ * - ETag 与 If-None-Match，Last-Modified 与 If-Modified-Since，If-Range
+ * - 以LRU方式缓存打开的文件描述符及其元信息。每次请求仍会 stat() 一次，文件有变化时重新打开
+ *
+ * 找不到文件时交给下一个中间件处理
+ *
+ * 示例：
+ *   StaticFile static_file;
+ *   static_file.bind("/static/", "/var/www/");
+ *   srv.use(&static_file);
+ */
+class StaticFile : public Middleware {
+  public:
+    StaticFile();
+    ~StaticFile();
+
+  public:
+    //! 将以 url_prefix 开头的请求映射到 dir 目录，按路径段匹配，"/static" 不匹配 "/staticfoo"
+    bool bind(const std::string &url_prefix, const std::string &dir);
+    //! 设置请求目录时回复的文件，默认为 index.html
+    void setIndexFile(const std::string &name);
+    //! 设置文件描述符缓存的数量，默认为 32
+    void setCacheCapacity(size_t capacity);
+    //! 设置扩展名对应的 Content-Type，如 setMimeType("md", "text/markdown")
+    void setMimeType(const std::string &ext, const std::string &mime_type);
+
+  public:
+    virtual void handle(ContextSptr sp_ctx, const NextFunc &next) override;
+
+  private:
+    struct Data;
+    Data *d_;
+};
+
+}
+}
+}
+
+#endif //TBOX_HTTP_SERVER_STATIC_FILE_H_20251019
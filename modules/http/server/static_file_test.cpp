@@ -0,0 +1,237 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <tbox/event/loop.h>
+#include <tbox/network/buffered_fd.h>
+
+#include "server.h"
+#include "static_file.h"
+
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::network;
+using namespace tbox::http;
+using namespace tbox::http::server;
+
+namespace {
+
+const char *kRootDir = "/tmp/tbox_static_file_test";
+
+class StaticFileTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        ::mkdir(kRootDir, 0755);
+        ::mkdir((std::string(kRootDir) + "/sub").c_str(), 0755);
+
+        for (int i = 0; i < 1000; ++i)
+            content_.push_back('a' + i % 26);
+        writeFile("data.txt", content_);
+        writeFile("sub/index.html", "<p>index</p>");
+
+        sp_loop_ = Loop::New();
+        sp_server_ = new Server(sp_loop_);
+        ASSERT_TRUE(sp_server_->initialize(SockAddr::FromString("127.0.0.1:51081"), 5));
+        static_file_.bind("/static/", kRootDir);
+        sp_server_->use(&static_file_);
+        sp_server_->start();
+    }
+
+    void TearDown() override {
+        sp_server_->cleanup();
+        delete sp_server_;
+        delete sp_loop_;
+
+        ::unlink((std::string(kRootDir) + "/data.txt").c_str());
+        ::unlink((std::string(kRootDir) + "/sub/index.html").c_str());
+        ::rmdir((std::string(kRootDir) + "/sub").c_str());
+        ::rmdir(kRootDir);
+    }
+
+    void writeFile(const std::string &name, const std::string &content) {
+        int fd = ::open((std::string(kRootDir) + "/" + name).c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(::write(fd, content.data(), content.size()), (ssize_t)content.size());
+        ::close(fd);
+    }
+
+    //! 发送请求，返回收到的所有数据
+    std::string request(const std::string &text) {
+        int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(51081);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        if (::connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            ::close(sock);
+            return "";
+        }
+
+        std::string received;
+        BufferedFd client(sp_loop_);
+        client.initialize(Fd(sock));
+        client.setReceiveCallback(
+            [&] (Buffer &buff) {
+                received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+        client.enable();
+        client.send(text.data(), text.size());
+
+        sp_loop_->exitLoop(std::chrono::milliseconds(50));
+        sp_loop_->runLoop();
+        return received;
+    }
+
+    static std::string GetHeader(const std::string &res, const std::string &key) {
+        auto pos = res.find("\r\n" + key + ": ");
+        if (pos == std::string::npos)
+            return "";
+        pos += key.size() + 4;
+        return res.substr(pos, res.find("\r\n", pos) - pos);
+    }
+
+    static std::string GetBody(const std::string &res) {
+        auto pos = res.find("\r\n\r\n");
+        return pos == std::string::npos ? "" : res.substr(pos + 4);
+    }
+
+    std::string content_;
+    Loop *sp_loop_ = nullptr;
+    Server *sp_server_ = nullptr;
+    StaticFile static_file_;
+};
+
+}
+
+TEST_F(StaticFileTest, GetFile)
+{
+    auto res = request("GET /static/data.txt HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+    EXPECT_EQ(GetHeader(res, "Content-Length"), "1000");
+    EXPECT_EQ(GetHeader(res, "Content-Type"), "text/plain; charset=utf-8");
+    EXPECT_EQ(GetHeader(res, "Accept-Ranges"), "bytes");
+    EXPECT_FALSE(GetHeader(res, "ETag").empty());
+    EXPECT_FALSE(GetHeader(res, "Last-Modified").empty());
+    EXPECT_TRUE(GetBody(res) == content_);
+}
+
+TEST_F(StaticFileTest, IndexFile)
+{
+    auto res = request("GET /static/sub/ HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(GetHeader(res, "Content-Type"), "text/html; charset=utf-8");
+    EXPECT_EQ(GetBody(res), "<p>index</p>");
+}
+
+TEST_F(StaticFileTest, Head)
+{
+    auto res = request("HEAD /static/data.txt HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+    EXPECT_EQ(GetHeader(res, "Content-Length"), "1000");
+    EXPECT_EQ(GetBody(res), "");
+}
+
+TEST_F(StaticFileTest, Range)
+{
+    auto res = request("GET /static/data.txt HTTP/1.1\r\nRange: bytes=10-19\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 28, "HTTP/1.1 206 Partial Content"), 0);
+    EXPECT_EQ(GetHeader(res, "Content-Range"), "bytes 10-19/1000");
+    EXPECT_EQ(GetBody(res), content_.substr(10, 10));
+
+    res = request("GET /static/data.txt HTTP/1.1\r\nRange: bytes=-5\r\n\r\n");
+    EXPECT_EQ(GetHeader(res, "Content-Range"), "bytes 995-999/1000");
+    EXPECT_EQ(GetBody(res), content_.substr(995));
+
+    res = request("GET /static/data.txt HTTP/1.1\r\nRange: bytes=990-\r\n\r\n");
+    EXPECT_EQ(GetBody(res), content_.substr(990));
+
+    res = request("GET /static/data.txt HTTP/1.1\r\nRange: bytes=1000-\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 12, "HTTP/1.1 416"), 0);
+    EXPECT_EQ(GetHeader(res, "Content-Range"), "bytes */1000");
+
+    //! 多区间不支持，回复整个文件
+    res = request("GET /static/data.txt HTTP/1.1\r\nRange: bytes=0-1,5-6\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+    EXPECT_TRUE(GetBody(res) == content_);
+}
+
+TEST_F(StaticFileTest, Conditional)
+{
+    auto res = request("GET /static/data.txt HTTP/1.1\r\n\r\n");
+    auto etag = GetHeader(res, "ETag");
+    auto last_modified = GetHeader(res, "Last-Modified");
+
+    res = request("GET /static/data.txt HTTP/1.1\r\nIf-None-Match: " + etag + "\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 25, "HTTP/1.1 304 Not Modified"), 0);
+    EXPECT_EQ(GetBody(res), "");
+
+    res = request("GET /static/data.txt HTTP/1.1\r\nIf-None-Match: \"other\"\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+
+    res = request("GET /static/data.txt HTTP/1.1\r\nIf-Modified-Since: " + last_modified + "\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 12, "HTTP/1.1 304"), 0);
+
+    //! If-Range 不匹配时回复整个文件
+    res = request("GET /static/data.txt HTTP/1.1\r\nRange: bytes=0-9\r\nIf-Range: \"other\"\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+}
+
+TEST_F(StaticFileTest, FileChanged)
+{
+    auto res = request("GET /static/data.txt HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(GetHeader(res, "Content-Length"), "1000");
+
+    writeFile("data.txt", "new content");
+    res = request("GET /static/data.txt HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(GetBody(res), "new content");
+}
+
+TEST_F(StaticFileTest, NotFoundAndForbidden)
+{
+    auto res = request("GET /static/none.txt HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 12, "HTTP/1.1 404"), 0);
+
+    res = request("GET /static/../etc/passwd HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 12, "HTTP/1.1 403"), 0);
+
+    res = request("POST /static/data.txt HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 12, "HTTP/1.1 404"), 0);
+}
+
+TEST_F(StaticFileTest, PrefixBoundary)
+{
+    static_file_.bind("/files", kRootDir);
+
+    auto res = request("GET /files/data.txt HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 12, "HTTP/1.1 200"), 0);
+
+    res = request("GET /filesdata.txt HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 12, "HTTP/1.1 404"), 0);
+
+    res = request("GET /static HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(res.compare(0, 12, "HTTP/1.1 404"), 0);
+}
@@ -29,6 +29,7 @@ namespace server {
 
 class Context;
 using ContextSptr = std::shared_ptr<Context>;
+//! 交给下一个中间件处理，须在 Context 释放之前调用
 using NextFunc = std::function<void()>;
 using RequestCallback = std::function<void(ContextSptr, const NextFunc &)>;
 
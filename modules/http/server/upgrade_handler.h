@@ -0,0 +1,71 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_SERVER_UPGRADE_HANDLER_H_20251019
+#define TBOX_HTTP_SERVER_UPGRADE_HANDLER_H_20251019
+
+#include <sys/uio.h>
+#include <tbox/event/loop.h>
+#include <tbox/network/tcp_server.h>
+
+#include "server.h"
+
+namespace tbox {
+namespace http {
+namespace server {
+
+/**
+ * 协议升级后接管连接的处理者，如 WebSocket
+ *
+ * 由 Context::upgrade() 交给 Server，之后该连接上收到的数据不再按 HTTP 解析，而是交给它处理。
+ * 由 Server 负责释放，连接断开时释放，所以子类在析构函数中处理连接断开
+ */
+class UpgradeHandler {
+    friend Server::Impl;
+
+  public:
+    virtual ~UpgradeHandler() { }
+
+    //! 已接管连接，此时可以发送数据
+    virtual void onUpgraded() { }
+    virtual void onReceived(network::Buffer &buff) = 0;
+    //! 发送缓冲已空
+    virtual void onSendCompleted() { }
+
+  protected:
+    event::Loop* loop() const;
+    bool send(const struct iovec *iov, int iovcnt);
+    size_t getSendBufferSize() const;
+
+    /**
+     * 断开连接，本对象会在此调用中被释放，调用后不可再访问成员
+     * \param   is_wait_sent    是否等发送缓冲中的数据发完再断开
+     */
+    void close(bool is_wait_sent);
+
+  private:
+    Server::Impl *wp_server_ = nullptr;
+    network::TcpServer::ConnToken ct_;
+};
+
+}
+}
+}
+
+#endif //TBOX_HTTP_SERVER_UPGRADE_HANDLER_H_20251019
@@ -0,0 +1,620 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "websocket.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include <tbox/base/log.h>
+#include <tbox/base/cabinet.hpp>
+#include <tbox/event/timer_event.h>
+#include <tbox/util/string.h>
+
+#include "upgrade_handler.h"
+#include "../websocket/frame.h"
+#include "../websocket/deflate.h"
+
+namespace tbox {
+namespace http {
+namespace server {
+
+using namespace websocket;
+
+struct WebSocket::Data {
+    event::Loop *wp_loop = nullptr;
+    std::string path;
+    std::chrono::milliseconds ping_interval = std::chrono::seconds(30);
+    size_t max_message_size = 1 << 20;
+    size_t send_buffer_limit = 4 << 20;
+    bool is_deflate_enable = true;
+    size_t deflate_threshold = 256;
+
+    ConnectedCallback connected_cb;
+    MessageCallback message_cb;
+    DisconnectedCallback disconnected_cb;
+
+    cabinet::Cabinet<Conn> conns;
+    event::TimerEvent *sp_ping_timer = nullptr;
+
+    Deflater deflater;          //!< 不沿用上下文，所有连接共用
+    std::string deflate_buff;   //!< 复用的压缩结果缓冲
+
+    void updatePingTimer();
+    //! 将同一条消息发给 conns 中的每个连接，返回发送成功的个数
+    size_t broadcast(const std::vector<Conn*> &conns, MessageType type, const void *data_ptr, size_t data_size);
+};
+
+/**
+ * 一个 WebSocket 连接，由 Server 持有，连接断开时由 Server 释放
+ *
+ * 接收时等一个帧收齐后就地去掩码，未分片且未压缩的消息直接交出，不拷贝。
+ * 断开总是放到下一轮进行，因为调用者可能正处于本对象的 onReceived() 中
+ */
+class WebSocket::Conn : public UpgradeHandler {
+  public:
+    explicit Conn(bool is_deflate) : is_deflate_(is_deflate) { }
+    virtual ~Conn() override;
+
+    ConnToken token;
+
+    bool isDeflate() const { return is_deflate_; }
+    bool isClosing() const { return is_closing_; }
+    //! 接管连接成功后才关联，未关联时析构不做任何事
+    void attach(WebSocket::Data *wp_ws) { wp_ws_ = wp_ws; }
+    void detach() { wp_ws_ = nullptr; }
+
+    bool sendFrame(Opcode opcode, bool rsv1, const void *data_ptr, size_t data_size);
+    bool sendFrame(const uint8_t *head, size_t head_size, const void *data_ptr, size_t data_size);
+    void close(uint16_t code, const std::string &reason);
+    void onTick();
+
+  protected:
+    virtual void onReceived(network::Buffer &buff) override;
+
+  private:
+    void onFrame(const FrameHead &head, const uint8_t *payload, size_t payload_size);
+    void onMessage(Opcode opcode, bool is_compressed, const uint8_t *data_ptr, size_t data_size);
+    void onClose(const uint8_t *payload, size_t payload_size);
+    void fail(uint16_t code);
+    void closeLater(bool is_wait_sent);
+
+  private:
+    WebSocket::Data *wp_ws_ = nullptr;
+    bool is_deflate_;
+
+    bool is_closing_ = false;
+    bool is_active_ = true;     //!< 上一个心跳周期内是否收到过数据
+    bool is_ping_sent_ = false;
+
+    //! 未收齐的分片消息
+    bool is_fragmented_ = false;
+    Opcode message_opcode_ = Opcode::kText;
+    bool is_message_compressed_ = false;
+    std::string message_;
+
+    Inflater inflater_;
+    std::string inflate_buff_;
+
+    event::Loop::RunId close_run_id_ = 0;
+};
+
+namespace {
+
+//! 检查客户端提供的 permessage-deflate 参数是否可以接受
+bool AcceptDeflateOffer(const std::string &offer)
+{
+    std::vector<std::string> params;
+    util::string::Split(offer, ";", params);
+    if (params.empty() || util::string::Strip(params[0]) != "permessage-deflate")
+        return false;
+
+    for (size_t i = 1; i < params.size(); ++i) {
+        auto param = util::string::Strip(params[i]);
+        auto pos = param.find('=');
+        auto name = util::string::Strip(param.substr(0, pos));
+        auto value = pos == std::string::npos ? "" : util::string::Strip(param.substr(pos + 1));
+        if (!value.empty() && value.front() == '"' && value.back() == '"')
+            value = value.substr(1, value.size() - 2);
+
+        if (name == "server_no_context_takeover" || name == "client_no_context_takeover" ||
+            name == "client_max_window_bits") {
+            continue;
+        } else if (name == "server_max_window_bits") {
+            //! 广播时所有连接共用压缩结果，只能用同一个窗口
+            if (value != "15")
+                return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsValidCloseCode(uint16_t code)
+{
+    return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011) ||
+           (code >= 3000 && code <= 4999);
+}
+
+}
+
+WebSocket::Conn::~Conn()
+{
+    //! 只有接管了连接后才会有 close_run_id_，未接管时 loop() 不可用
+    if (close_run_id_ != 0)
+        loop()->cancel(close_run_id_);
+
+    if (wp_ws_ != nullptr) {
+        auto wp_ws = wp_ws_;
+        wp_ws->conns.free(token);
+        wp_ws->updatePingTimer();
+        if (wp_ws->disconnected_cb)
+            wp_ws->disconnected_cb(token);
+    }
+}
+
+void WebSocket::Conn::onReceived(network::Buffer &buff)
+{
+    is_active_ = true;
+
+    while (!is_closing_ && wp_ws_ != nullptr) {
+        uint8_t *data_ptr = buff.readableBegin();
+        size_t data_size = buff.readableSize();
+
+        FrameHead head;
+        int head_size = ParseFrameHead(data_ptr, data_size, head);
+        if (head_size == 0)
+            return;
+
+        //! 客户端发来的帧必须带掩码
+        if (head_size < 0 || !head.is_masked) {
+            fail(kCloseProtocolError);
+            break;
+        }
+
+        if (head.payload_size > wp_ws_->max_message_size) {
+            fail(kCloseMessageTooBig);
+            break;
+        }
+
+        size_t frame_size = head_size + head.payload_size;
+        if (data_size < frame_size)
+            return;
+
+        uint8_t *payload = data_ptr + head_size;
+        Unmask(payload, head.payload_size, head.mask);
+        onFrame(head, payload, head.payload_size);
+        buff.hasRead(frame_size);
+    }
+
+    buff.hasReadAll();
+}
+
+void WebSocket::Conn::onFrame(const FrameHead &head, const uint8_t *payload, size_t payload_size)
+{
+    if (head.rsv1 && (!is_deflate_ || IsControl(head.opcode) || head.opcode == Opcode::kContinuation)) {
+        fail(kCloseProtocolError);
+        return;
+    }
+
+    switch (head.opcode) {
+        case Opcode::kText:
+        case Opcode::kBinary:
+            if (is_fragmented_) {
+                fail(kCloseProtocolError);
+            } else if (head.fin) {
+                onMessage(head.opcode, head.rsv1, payload, payload_size);
+            } else {
+                is_fragmented_ = true;
+                message_opcode_ = head.opcode;
+                is_message_compressed_ = head.rsv1;
+                message_.assign(reinterpret_cast<const char*>(payload), payload_size);
+            }
+            break;
+
+        case Opcode::kContinuation:
+            if (!is_fragmented_) {
+                fail(kCloseProtocolError);
+            } else if (message_.size() + payload_size > wp_ws_->max_message_size) {
+                fail(kCloseMessageTooBig);
+            } else {
+                message_.append(reinterpret_cast<const char*>(payload), payload_size);
+                if (head.fin) {
+                    is_fragmented_ = false;
+                    std::string message;
+                    message.swap(message_);
+                    onMessage(message_opcode_, is_message_compressed_,
+                              reinterpret_cast<const uint8_t*>(message.data()), message.size());
+                    //! 保留缓冲的容量，供下一个分片消息使用
+                    if (message_.empty()) {
+                        message.clear();
+                        message_.swap(message);
+                    }
+                }
+            }
+            break;
+
+        case Opcode::kPing:
+            sendFrame(Opcode::kPong, false, payload, payload_size);
+            break;
+
+        case Opcode::kPong:
+            break;
+
+        case Opcode::kClose:
+            onClose(payload, payload_size);
+            break;
+    }
+}
+
+void WebSocket::Conn::onMessage(Opcode opcode, bool is_compressed, const uint8_t *data_ptr, size_t data_size)
+{
+    if (is_compressed) {
+        inflate_buff_.clear();
+        if (!inflater_.decompress(data_ptr, data_size, inflate_buff_, wp_ws_->max_message_size)) {
+            fail(inflate_buff_.size() > wp_ws_->max_message_size ? kCloseMessageTooBig : kCloseInvalidData);
+            return;
+        }
+        data_ptr = reinterpret_cast<const uint8_t*>(inflate_buff_.data());
+        data_size = inflate_buff_.size();
+    }
+
+    if (opcode == Opcode::kText && !IsValidUtf8(data_ptr, data_size)) {
+        fail(kCloseInvalidData);
+        return;
+    }
+
+    if (wp_ws_->message_cb) {
+        auto type = opcode == Opcode::kText ? MessageType::kText : MessageType::kBinary;
+        wp_ws_->message_cb(token, type, reinterpret_cast<const char*>(data_ptr), data_size);
+    }
+}
+
+//! 按协议回复关闭帧后断开
+void WebSocket::Conn::onClose(const uint8_t *payload, size_t payload_size)
+{
+    if (payload_size == 0) {
+        close(0, "");
+        return;
+    }
+
+    uint16_t code = payload_size >= 2 ? (payload[0] << 8) | payload[1] : 0;
+    if (payload_size == 1 || !IsValidCloseCode(code)) {
+        fail(kCloseProtocolError);
+        return;
+    }
+
+    if (!IsValidUtf8(payload + 2, payload_size - 2)) {
+        fail(kCloseInvalidData);
+        return;
+    }
+
+    close(code, "");
+}
+
+void WebSocket::Conn::fail(uint16_t code)
+{
+    LogNotice("websocket fail, code:%u", code);
+    close(code, "");
+}
+
+//! code 为 0 时发出不带关闭码的关闭帧
+void WebSocket::Conn::close(uint16_t code, const std::string &reason)
+{
+    if (is_closing_)
+        return;
+
+    std::string payload;
+    if (code != 0) {
+        payload.push_back(static_cast<char>(code >> 8));
+        payload.push_back(static_cast<char>(code));
+        payload.append(reason, 0, kMaxControlPayloadSize - 2);
+    }
+
+    sendFrame(Opcode::kClose, false, payload.data(), payload.size());
+    is_closing_ = true;
+    closeLater(true);
+}
+
+void WebSocket::Conn::closeLater(bool is_wait_sent)
+{
+    if (close_run_id_ != 0)
+        return;
+
+    close_run_id_ = loop()->runNext(
+        [this, is_wait_sent] {
+            close_run_id_ = 0;
+            UpgradeHandler::close(is_wait_sent);
+        },
+        "http::WebSocket::close"
+    );
+}
+
+bool WebSocket::Conn::sendFrame(Opcode opcode, bool rsv1, const void *data_ptr, size_t data_size)
+{
+    uint8_t head[kMaxFrameHeadSize];
+    size_t head_size = WriteFrameHead(head, opcode, true, rsv1, data_size);
+    return sendFrame(head, head_size, data_ptr, data_size);
+}
+
+bool WebSocket::Conn::sendFrame(const uint8_t *head, size_t head_size, const void *data_ptr, size_t data_size)
+{
+    if (is_closing_)
+        return false;
+
+    struct iovec iov[2] = {
+        { const_cast<uint8_t*>(head), head_size },
+        { const_cast<void*>(data_ptr), data_size },
+    };
+    send(iov, data_size > 0 ? 2 : 1);
+
+    //! 对方收得太慢，再发下去只会积压在内存中
+    if (wp_ws_ != nullptr && getSendBufferSize() > wp_ws_->send_buffer_limit) {
+        LogNotice("websocket too slow, disconnect");
+        is_closing_ = true;
+        closeLater(false);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * 每个心跳周期调用一次。一个周期内没有收到数据就发 ping，下一个周期仍没有就断开
+ */
+void WebSocket::Conn::onTick()
+{
+    if (is_closing_)
+        return;
+
+    if (is_active_) {
+        is_active_ = false;
+        is_ping_sent_ = false;
+
+    } else if (!is_ping_sent_) {
+        sendFrame(Opcode::kPing, false, nullptr, 0);
+        is_ping_sent_ = true;
+
+    } else {
+        LogNotice("websocket ping timeout");
+        is_closing_ = true;
+        closeLater(false);
+    }
+}
+
+void WebSocket::Data::updatePingTimer()
+{
+    bool is_need = !conns.empty() && ping_interval.count() > 0;
+    if (is_need && !sp_ping_timer->isEnabled()) {
+        sp_ping_timer->initialize(ping_interval, event::Event::Mode::kPersist);
+        sp_ping_timer->enable();
+    } else if (!is_need && sp_ping_timer->isEnabled()) {
+        sp_ping_timer->disable();
+    }
+}
+
+/**
+ * 帧头只生成一次；压缩的结果只在第一次遇到启用了压缩的连接时生成一次。
+ * 之后对每个连接只是把同一份数据交给 writev()
+ */
+size_t WebSocket::Data::broadcast(const std::vector<Conn*> &conns, MessageType type, const void *data_ptr, size_t data_size)
+{
+    auto opcode = type == MessageType::kText ? Opcode::kText : Opcode::kBinary;
+
+    uint8_t plain_head[kMaxFrameHeadSize];
+    size_t plain_head_size = WriteFrameHead(plain_head, opcode, true, false, data_size);
+
+    bool is_compress_tried = false;
+    bool is_compressed = false;
+    uint8_t deflate_head[kMaxFrameHeadSize];
+    size_t deflate_head_size = 0;
+
+    size_t count = 0;
+    for (auto conn : conns) {
+        if (conn->isClosing())
+            continue;
+
+        bool is_use_deflate = conn->isDeflate() && data_size >= deflate_threshold;
+        if (is_use_deflate && !is_compress_tried) {
+            is_compress_tried = true;
+            deflate_buff.clear();
+            is_compressed = deflater.compress(data_ptr, data_size, deflate_buff);
+            if (is_compressed)
+                deflate_head_size = WriteFrameHead(deflate_head, opcode, true, true, deflate_buff.size());
+        }
+
+        bool is_sent = (is_use_deflate && is_compressed) ?
+            conn->sendFrame(deflate_head, deflate_head_size, deflate_buff.data(), deflate_buff.size()) :
+            conn->sendFrame(plain_head, plain_head_size, data_ptr, data_size);
+        if (is_sent)
+            ++count;
+    }
+    return count;
+}
+
+WebSocket::WebSocket(event::Loop *wp_loop) :
+    d_(new Data)
+{
+    d_->wp_loop = wp_loop;
+    d_->sp_ping_timer = wp_loop->newTimerEvent("http::WebSocket::ping");
+    d_->sp_ping_timer->setCallback(
+        [this] {
+            d_->conns.foreach([] (Conn *conn) { conn->onTick(); });
+        }
+    );
+}
+
+WebSocket::~WebSocket()
+{
+    //! 连接由 Server 持有，这里只解除关联并通知对方关闭
+    d_->conns.foreach(
+        [] (Conn *conn) {
+            conn->detach();
+            conn->close(kCloseGoingAway, "");
+        }
+    );
+    d_->conns.clear();
+
+    CHECK_DELETE_RESET_OBJ(d_->sp_ping_timer);
+    CHECK_DELETE_RESET_OBJ(d_);
+}
+
+void WebSocket::setPath(const std::string &path) { d_->path = path; }
+void WebSocket::setMaxMessageSize(size_t max_size) { d_->max_message_size = max_size; }
+void WebSocket::setSendBufferLimit(size_t limit) { d_->send_buffer_limit = limit; }
+
+void WebSocket::setPingInterval(const std::chrono::milliseconds &interval)
+{
+    d_->ping_interval = interval;
+    d_->sp_ping_timer->disable();
+    d_->updatePingTimer();
+}
+
+void WebSocket::setDeflateEnable(bool enable, size_t threshold)
+{
+    d_->is_deflate_enable = enable;
+    d_->deflate_threshold = threshold;
+}
+
+void WebSocket::setConnectedCallback(const ConnectedCallback &cb) { d_->connected_cb = cb; }
+void WebSocket::setMessageCallback(const MessageCallback &cb) { d_->message_cb = cb; }
+void WebSocket::setDisconnectedCallback(const DisconnectedCallback &cb) { d_->disconnected_cb = cb; }
+
+bool WebSocket::send(const ConnToken &token, MessageType type, const void *data_ptr, size_t data_size)
+{
+    auto conn = d_->conns.at(token);
+    if (conn == nullptr)
+        return false;
+
+    auto opcode = type == MessageType::kText ? Opcode::kText : Opcode::kBinary;
+    if (conn->isDeflate() && data_size >= d_->deflate_threshold) {
+        auto &buff = d_->deflate_buff;
+        buff.clear();
+        if (d_->deflater.compress(data_ptr, data_size, buff))
+            return conn->sendFrame(opcode, true, buff.data(), buff.size());
+    }
+
+    return conn->sendFrame(opcode, false, data_ptr, data_size);
+}
+
+size_t WebSocket::broadcast(MessageType type, const void *data_ptr, size_t data_size)
+{
+    std::vector<Conn*> conns;
+    conns.reserve(d_->conns.size());
+    d_->conns.foreach([&conns] (Conn *conn) { conns.push_back(conn); });
+    return d_->broadcast(conns, type, data_ptr, data_size);
+}
+
+size_t WebSocket::broadcast(const std::vector<ConnToken> &tokens, MessageType type, const void *data_ptr, size_t data_size)
+{
+    std::vector<Conn*> conns;
+    conns.reserve(tokens.size());
+    for (auto &token : tokens) {
+        auto conn = d_->conns.at(token);
+        if (conn != nullptr)
+            conns.push_back(conn);
+    }
+    return d_->broadcast(conns, type, data_ptr, data_size);
+}
+
+bool WebSocket::close(const ConnToken &token, uint16_t code, const std::string &reason)
+{
+    auto conn = d_->conns.at(token);
+    if (conn == nullptr || conn->isClosing())
+        return false;
+
+    conn->close(code, reason);
+    return true;
+}
+
+bool WebSocket::isValid(const ConnToken &token) const
+{
+    return d_->conns.at(token) != nullptr;
+}
+
+size_t WebSocket::size() const
+{
+    return d_->conns.size();
+}
+
+void WebSocket::handle(ContextSptr sp_ctx, const NextFunc &next)
+{
+    auto &req = sp_ctx->req();
+    auto &res = sp_ctx->res();
+
+    auto upgrade = req.headers.get(HeaderId::kUpgrade);
+    if ((!d_->path.empty() && req.url.path != d_->path) ||
+        upgrade == nullptr || ::strcasecmp(upgrade->c_str(), "websocket") != 0) {
+        next();
+        return;
+    }
+
+    auto key = req.headers.get("Sec-WebSocket-Key");
+    auto version = req.headers.get("Sec-WebSocket-Version");
+    auto connection = req.headers.get(HeaderId::kConnection);
+
+    if (req.method != Method::kGet || req.http_ver != HttpVer::k1_1 || key == nullptr || key->empty() ||
+        connection == nullptr || ::strcasestr(connection->c_str(), "upgrade") == nullptr) {
+        res.status_code = StatusCode::k400_BadRequest;
+        return;
+    }
+
+    if (version == nullptr || *version != "13") {
+        res.status_code = StatusCode::k426_UpgradeRequired;
+        res.headers["Sec-WebSocket-Version"] = "13";
+        return;
+    }
+
+    //! 客户端可能提供多个候选，用第一个能接受的
+    bool is_deflate = false;
+    auto extensions = req.headers.get("Sec-WebSocket-Extensions");
+    if (extensions != nullptr && d_->is_deflate_enable && Deflater::IsSupported()) {
+        std::vector<std::string> offers;
+        util::string::Split(*extensions, ",", offers);
+        is_deflate = std::any_of(offers.begin(), offers.end(), AcceptDeflateOffer);
+    }
+
+    res.status_code = StatusCode::k101_SwitchingProtocols;
+    res.headers[HeaderId::kUpgrade] = "websocket";
+    res.headers[HeaderId::kConnection] = "Upgrade";
+    res.headers["Sec-WebSocket-Accept"] = MakeAcceptKey(*key);
+    if (is_deflate)
+        res.headers["Sec-WebSocket-Extensions"] = "permessage-deflate; server_no_context_takeover";
+
+    //! 请求前面还有未回复的请求等情况下会接管失败，此时 conn 尚未关联，可直接释放
+    auto conn = new Conn(is_deflate);
+    if (!sp_ctx->upgrade(conn)) {
+        delete conn;
+        LogNotice("websocket upgrade fail");
+        res.headers.clear();
+        res.status_code = StatusCode::k400_BadRequest;
+        return;
+    }
+
+    conn->attach(d_);
+    conn->token = d_->conns.alloc(conn);
+    d_->updatePingTimer();
+
+    if (d_->connected_cb)
+        d_->connected_cb(conn->token, req);
+}
+
+}
+}
+}
@@ -0,0 +1,127 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_SERVER_WEBSOCKET_H_20251019
+#define TBOX_HTTP_SERVER_WEBSOCKET_H_20251019
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <tbox/base/defines.h>
+#include <tbox/base/cabinet_token.h>
+#include <tbox/event/loop.h>
+
+#include "middleware.h"
+#include "context.h"
+
+namespace tbox {
+namespace http {
+namespace server {
+
+/**
+ * WebSocket 中间件 (RFC 6455)
+ *
+ * 处理指定路径上的 Upgrade: websocket 请求，握手成功后由 Server 的连接直接转为 WebSocket 连接，
+ * 不另建连接。其它请求交给下一个中间件。支持：
+ * - 分片消息的重组，控制帧可穿插在分片之间
+ * - 所有连接共用一个定时器做心跳：空闲一个周期发 ping，再空闲一个周期断开
+ * - permessage-deflate (RFC 7692，编译时需启用 zlib)。服务端不沿用压缩上下文，
+ *   所以同一条消息对所有连接的压缩结果相同
+ * - 广播：帧头与压缩只做一次，各连接共用同一份数据
+ * - 发送缓冲超过上限的连接视为过慢，直接断开，以免拖累整个进程
+ *
+ * 示例：
+ *   WebSocket ws(sp_loop);
+ *   ws.setPath("/ws");
+ *   ws.setMessageCallback(
+ *       [&] (const WebSocket::ConnToken &token, WebSocket::MessageType type, const char *data_ptr, size_t data_size) {
+ *           ws.broadcast(type, data_ptr, data_size);
+ *       }
+ *   );
+ *   srv.use(&ws);
+ */
+class WebSocket : public Middleware {
+  public:
+    explicit WebSocket(event::Loop *wp_loop);
+    ~WebSocket();
+
+    NONCOPYABLE(WebSocket);
+
+  public:
+    using ConnToken = cabinet::Token;
+    enum class MessageType { kText, kBinary };
+
+    //! 只处理该路径上的升级请求，默认为空，表示不限路径
+    void setPath(const std::string &path);
+    //! 设置心跳周期，默认 30 秒，为 0 时不检测
+    void setPingInterval(const std::chrono::milliseconds &interval);
+    //! 设置单条消息(解压后)的最大长度，超过时以 1009 断开，默认 1MB
+    void setMaxMessageSize(size_t max_size);
+    //! 设置每个连接发送缓冲的上限，超过时断开该连接，默认 4MB
+    void setSendBufferLimit(size_t limit);
+    //! 是否启用 permessage-deflate，默认启用。小于 threshold 的消息不压缩
+    void setDeflateEnable(bool enable, size_t threshold = 256);
+
+    //! 新连接，req 为握手请求，可从中获取路径参数与头部
+    using ConnectedCallback = std::function<void(const ConnToken &, const Request &req)>;
+    using MessageCallback = std::function<void(const ConnToken &, MessageType, const char *data_ptr, size_t data_size)>;
+    using DisconnectedCallback = std::function<void(const ConnToken &)>;
+
+    void setConnectedCallback(const ConnectedCallback &cb);
+    void setMessageCallback(const MessageCallback &cb);
+    void setDisconnectedCallback(const DisconnectedCallback &cb);
+
+  public:
+    bool send(const ConnToken &token, MessageType type, const void *data_ptr, size_t data_size);
+    bool send(const ConnToken &token, const std::string &text) {
+        return send(token, MessageType::kText, text.data(), text.size());
+    }
+
+    /**
+     * \brief   广播，消息只编码一次
+     * \return  发出的连接数
+     */
+    size_t broadcast(MessageType type, const void *data_ptr, size_t data_size);
+    size_t broadcast(const std::string &text) { return broadcast(MessageType::kText, text.data(), text.size()); }
+    //! 只发给指定的连接
+    size_t broadcast(const std::vector<ConnToken> &tokens, MessageType type, const void *data_ptr, size_t data_size);
+
+    //! 发出关闭帧后断开连接
+    bool close(const ConnToken &token, uint16_t code = 1000, const std::string &reason = "");
+
+    bool isValid(const ConnToken &token) const;
+    //! 当前连接数
+    size_t size() const;
+
+  public:
+    virtual void handle(ContextSptr sp_ctx, const NextFunc &next) override;
+
+  private:
+    struct Data;
+    class Conn;
+    Data *d_;
+};
+
+}
+}
+}
+
+#endif //TBOX_HTTP_SERVER_WEBSOCKET_H_20251019
@@ -0,0 +1,562 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <iostream>
+
+#include <tbox/event/loop.h>
+#include <tbox/event/timer_event.h>
+#include <tbox/network/buffered_fd.h>
+
+#include "server.h"
+#include "websocket.h"
+#include "../websocket/frame.h"
+#include "../websocket/deflate.h"
+
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::network;
+using namespace tbox::http;
+using namespace tbox::http::server;
+using namespace tbox::http::websocket;
+
+namespace {
+
+const char *kBindAddr = "127.0.0.1:51085";
+
+const char *kHandshake = \
+    "GET /ws HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+    "Sec-WebSocket-Version: 13\r\n";
+
+BufferedFd* Connect(Loop *wp_loop)
+{
+    int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(51085);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (::connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        ::close(sock);
+        return nullptr;
+    }
+
+    Fd fd(sock);
+    fd.setNonBlock(true);
+
+    auto client = new BufferedFd(wp_loop);
+    client->initialize(fd);
+    client->enable();
+    return client;
+}
+
+//! 客户端的帧，必须带掩码
+std::string MakeFrame(Opcode opcode, const std::string &payload, bool fin = true, bool rsv1 = false, bool is_masked = true)
+{
+    uint8_t head[kMaxFrameHeadSize];
+    size_t head_size = WriteFrameHead(head, opcode, fin, rsv1, payload.size());
+    std::string frame(reinterpret_cast<char*>(head), head_size);
+    if (!is_masked)
+        return frame + payload;
+
+    const uint8_t mask[4] = {0x12, 0x34, 0x56, 0x78};
+    frame[1] |= 0x80;
+    frame.append(reinterpret_cast<const char*>(mask), 4);
+
+    std::string masked = payload;
+    Unmask(reinterpret_cast<uint8_t*>(&masked[0]), masked.size(), mask);
+    return frame + masked;
+}
+
+struct Message {
+    Opcode opcode;
+    bool rsv1;
+    std::string payload;
+};
+
+//! 客户端的一端：完成握手后解析服务端发来的帧
+struct Client {
+    BufferedFd *sp_fd = nullptr;
+    std::string handshake;
+    std::vector<Message> messages;
+    bool is_closed = false;
+
+    Client(Loop *wp_loop, const std::string &extra_heads = "") {
+        sp_fd = Connect(wp_loop);
+        sp_fd->setReceiveCallback(
+            [this] (Buffer &buff) { onReceived(buff); }, 0
+        );
+        sp_fd->setReadZeroCallback([this] { is_closed = true; });
+        std::string text = std::string(kHandshake) + extra_heads + "\r\n";
+        sp_fd->send(text.data(), text.size());
+    }
+
+    ~Client() { delete sp_fd; }
+
+    void send(const std::string &data) { sp_fd->send(data.data(), data.size()); }
+
+    void onReceived(Buffer &buff) {
+        if (handshake.empty() || handshake.find("\r\n\r\n") == std::string::npos) {
+            std::string data(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            auto pos = data.find("\r\n\r\n");
+            if (pos == std::string::npos)
+                return;
+            handshake = data.substr(0, pos + 4);
+            buff.hasRead(pos + 4);
+        }
+
+        for (;;) {
+            FrameHead head;
+            int head_size = ParseFrameHead(buff.readableBegin(), buff.readableSize(), head);
+            if (head_size <= 0 || buff.readableSize() < head_size + head.payload_size)
+                break;
+            const char *payload = reinterpret_cast<const char*>(buff.readableBegin()) + head_size;
+            messages.push_back(Message{head.opcode, head.rsv1, std::string(payload, head.payload_size)});
+            buff.hasRead(head_size + head.payload_size);
+        }
+    }
+};
+
+uint16_t GetCloseCode(const Message &msg)
+{
+    if (msg.opcode != Opcode::kClose || msg.payload.size() < 2)
+        return 0;
+    return (static_cast<uint8_t>(msg.payload[0]) << 8) | static_cast<uint8_t>(msg.payload[1]);
+}
+
+void RunLoop(Loop *wp_loop, int ms = 50)
+{
+    wp_loop->exitLoop(std::chrono::milliseconds(ms));
+    wp_loop->runLoop();
+}
+
+}
+
+TEST(WebSocket, HandshakeAndEcho)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        WebSocket ws(sp_loop);
+        ws.setPath("/ws");
+
+        int connected_count = 0, disconnected_count = 0;
+        ws.setConnectedCallback(
+            [&] (const WebSocket::ConnToken &, const Request &req) {
+                EXPECT_EQ(req.url.path, "/ws");
+                ++connected_count;
+            }
+        );
+        ws.setMessageCallback(
+            [&] (const WebSocket::ConnToken &token, WebSocket::MessageType type, const char *data_ptr, size_t data_size) {
+                ws.send(token, type, data_ptr, data_size);
+            }
+        );
+        ws.setDisconnectedCallback([&] (const WebSocket::ConnToken &) { ++disconnected_count; });
+
+        server.use(&ws);
+        server.use(
+            [&] (ContextSptr ctx, const NextFunc &) {
+                ctx->res().status_code = StatusCode::k200_OK;
+                ctx->res().body = "plain";
+            }
+        );
+        server.start();
+
+        Client client(sp_loop);
+        RunLoop(sp_loop);
+
+        EXPECT_EQ(client.handshake.compare(0, 34, "HTTP/1.1 101 Switching Protocols\r\n"), 0);
+        EXPECT_NE(client.handshake.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"), std::string::npos);
+        EXPECT_EQ(client.handshake.find("Sec-WebSocket-Extensions"), std::string::npos);
+        EXPECT_EQ(connected_count, 1);
+        EXPECT_EQ(ws.size(), 1u);
+
+        //! 跨越 16 位与 64 位长度的帧
+        std::string big(70000, 'x');
+        client.send(MakeFrame(Opcode::kText, "hello") + MakeFrame(Opcode::kBinary, big));
+        RunLoop(sp_loop);
+
+        ASSERT_EQ(client.messages.size(), 2u);
+        EXPECT_EQ(client.messages[0].opcode, Opcode::kText);
+        EXPECT_EQ(client.messages[0].payload, "hello");
+        EXPECT_EQ(client.messages[1].opcode, Opcode::kBinary);
+        EXPECT_EQ(client.messages[1].payload, big);
+
+        client.send(MakeFrame(Opcode::kClose, std::string("\x03\xe8", 2)));
+        RunLoop(sp_loop);
+
+        ASSERT_EQ(client.messages.size(), 3u);
+        EXPECT_EQ(GetCloseCode(client.messages[2]), kCloseNormal);
+        EXPECT_TRUE(client.is_closed);
+        EXPECT_EQ(disconnected_count, 1);
+        EXPECT_EQ(ws.size(), 0u);
+    }
+    delete sp_loop;
+}
+
+TEST(WebSocket, NotUpgradeRequest)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        WebSocket ws(sp_loop);
+        ws.setPath("/ws");
+        server.use(&ws);
+        server.use(
+            [&] (ContextSptr ctx, const NextFunc &) {
+                ctx->res().status_code = StatusCode::k200_OK;
+                ctx->res().body = "plain";
+            }
+        );
+        server.start();
+
+        auto client = Connect(sp_loop);
+        ASSERT_NE(client, nullptr);
+        std::string received;
+        client->setReceiveCallback(
+            [&] (Buffer &buff) {
+                received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+
+        std::string text = \
+            "GET /ws HTTP/1.1\r\n\r\n"
+            "GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 8\r\n\r\n";
+        client->send(text.data(), text.size());
+        RunLoop(sp_loop);
+
+        EXPECT_EQ(received.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+        EXPECT_NE(received.find("HTTP/1.1 426 Upgrade Required\r\n"), std::string::npos);
+        EXPECT_NE(received.find("Sec-WebSocket-Version: 13\r\n"), std::string::npos);
+        EXPECT_EQ(ws.size(), 0u);
+
+        delete client;
+    }
+    delete sp_loop;
+}
+
+//! 握手请求排在未回复的请求之后，接管连接失败，不能影响服务
+TEST(WebSocket, UpgradeFail)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        int connected_count = 0, disconnected_count = 0;
+        WebSocket ws(sp_loop);
+        ws.setPath("/ws");
+        ws.setConnectedCallback([&] (const WebSocket::ConnToken &, const Request &) { ++connected_count; });
+        ws.setDisconnectedCallback([&] (const WebSocket::ConnToken &) { ++disconnected_count; });
+        server.use(&ws);
+
+        ContextSptr pending_ctx;
+        server.use(
+            [&] (ContextSptr ctx, const NextFunc &) {
+                ctx->res().status_code = StatusCode::k200_OK;
+                ctx->res().body = "slow";
+                pending_ctx = ctx;
+            }
+        );
+        server.start();
+
+        auto client = Connect(sp_loop);
+        ASSERT_NE(client, nullptr);
+        std::string received;
+        client->setReceiveCallback(
+            [&] (Buffer &buff) {
+                received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+
+        std::string text = std::string("GET /slow HTTP/1.1\r\n\r\n") + kHandshake + "\r\n";
+        client->send(text.data(), text.size());
+        RunLoop(sp_loop);
+
+        pending_ctx.reset();
+        RunLoop(sp_loop);
+
+        EXPECT_EQ(received.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+        EXPECT_NE(received.find("HTTP/1.1 400 Bad Request\r\n"), std::string::npos);
+        EXPECT_EQ(ws.size(), 0u);
+        EXPECT_EQ(connected_count, 0);
+        EXPECT_EQ(disconnected_count, 0);
+
+        delete client;
+    }
+    delete sp_loop;
+}
+
+TEST(WebSocket, Fragmentation)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        WebSocket ws(sp_loop);
+        std::vector<std::string> received;
+        ws.setMessageCallback(
+            [&] (const WebSocket::ConnToken &, WebSocket::MessageType type, const char *data_ptr, size_t data_size) {
+                EXPECT_EQ(type, WebSocket::MessageType::kText);
+                received.emplace_back(data_ptr, data_size);
+            }
+        );
+        server.use(&ws);
+        server.start();
+
+        Client client(sp_loop);
+        RunLoop(sp_loop, 20);
+
+        //! 控制帧可以插在分片中间；分片逐字节发出
+        std::string text = MakeFrame(Opcode::kText, "Hel", false)
+                         + MakeFrame(Opcode::kPing, "p")
+                         + MakeFrame(Opcode::kContinuation, "lo ", false)
+                         + MakeFrame(Opcode::kContinuation, "world");
+        for (char c : text)
+            client.send(std::string(1, c));
+        RunLoop(sp_loop);
+
+        ASSERT_EQ(received.size(), 1u);
+        EXPECT_EQ(received[0], "Hello world");
+        ASSERT_EQ(client.messages.size(), 1u);
+        EXPECT_EQ(client.messages[0].opcode, Opcode::kPong);
+        EXPECT_EQ(client.messages[0].payload, "p");
+    }
+    delete sp_loop;
+}
+
+TEST(WebSocket, ProtocolError)
+{
+    struct Case {
+        std::string frames;
+        uint16_t code;
+    };
+    std::vector<Case> cases = {
+        { MakeFrame(Opcode::kText, "abc", true, false, false), kCloseProtocolError },
+        { MakeFrame(Opcode::kContinuation, "abc"), kCloseProtocolError },
+        { MakeFrame(Opcode::kText, "a", false) + MakeFrame(Opcode::kText, "b"), kCloseProtocolError },
+        { MakeFrame(Opcode::kText, "abc", true, true), kCloseProtocolError },
+        { MakeFrame(Opcode::kText, "\xc0\xaf"), kCloseInvalidData },
+        { MakeFrame(Opcode::kClose, std::string("\x03\xed", 2)), kCloseProtocolError },
+        { MakeFrame(Opcode::kBinary, std::string(2000, 'x')), kCloseMessageTooBig },
+    };
+
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        WebSocket ws(sp_loop);
+        ws.setMaxMessageSize(1000);
+        int message_count = 0;
+        ws.setMessageCallback(
+            [&] (const WebSocket::ConnToken &, WebSocket::MessageType, const char *, size_t) { ++message_count; }
+        );
+        server.use(&ws);
+        server.start();
+
+        for (auto &item : cases) {
+            Client client(sp_loop);
+            RunLoop(sp_loop, 20);
+            client.send(item.frames + MakeFrame(Opcode::kText, "after"));
+            RunLoop(sp_loop);
+
+            ASSERT_FALSE(client.messages.empty());
+            EXPECT_EQ(GetCloseCode(client.messages.back()), item.code);
+            EXPECT_TRUE(client.is_closed);
+        }
+
+        EXPECT_EQ(message_count, 0);
+        EXPECT_EQ(ws.size(), 0u);
+    }
+    delete sp_loop;
+}
+
+TEST(WebSocket, PingTimeout)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        WebSocket ws(sp_loop);
+        ws.setPingInterval(std::chrono::milliseconds(20));
+        server.use(&ws);
+        server.start();
+
+        Client client(sp_loop);
+        RunLoop(sp_loop, 150);
+
+        //! 第一个周期内有握手数据，第二个周期发 ping，第三个周期断开
+        ASSERT_EQ(client.messages.size(), 1u);
+        EXPECT_EQ(client.messages[0].opcode, Opcode::kPing);
+        EXPECT_TRUE(client.is_closed);
+        EXPECT_EQ(ws.size(), 0u);
+    }
+    delete sp_loop;
+}
+
+TEST(WebSocket, Deflate)
+{
+    if (!Deflater::IsSupported())
+        GTEST_SKIP();
+
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 1));
+
+        WebSocket ws(sp_loop);
+        ws.setDeflateEnable(true, 100);
+        ws.setMessageCallback(
+            [&] (const WebSocket::ConnToken &token, WebSocket::MessageType type, const char *data_ptr, size_t data_size) {
+                ws.send(token, type, data_ptr, data_size);
+            }
+        );
+        server.use(&ws);
+        server.start();
+
+        Client client(sp_loop, "Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n");
+        RunLoop(sp_loop, 20);
+        EXPECT_NE(client.handshake.find("Sec-WebSocket-Extensions: permessage-deflate; server_no_context_takeover\r\n"),
+                  std::string::npos);
+
+        std::string text;
+        for (int i = 0; i < 50; ++i)
+            text += "{\"seq\":" + std::to_string(i) + ",\"payload\":\"websocket\"}";
+
+        Deflater deflater;
+        std::string compressed;
+        ASSERT_TRUE(deflater.compress(text.data(), text.size(), compressed));
+        client.send(MakeFrame(Opcode::kText, compressed, true, true) + MakeFrame(Opcode::kText, "short"));
+        RunLoop(sp_loop);
+
+        ASSERT_EQ(client.messages.size(), 2u);
+        EXPECT_TRUE(client.messages[0].rsv1);
+        EXPECT_LT(client.messages[0].payload.size(), text.size());
+        Inflater inflater;
+        std::string out;
+        ASSERT_TRUE(inflater.decompress(client.messages[0].payload.data(), client.messages[0].payload.size(), out, 1 << 20));
+        EXPECT_EQ(out, text);
+
+        EXPECT_FALSE(client.messages[1].rsv1);
+        EXPECT_EQ(client.messages[1].payload, "short");
+    }
+    delete sp_loop;
+}
+
+TEST(WebSocket, Broadcast)
+{
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), 5));
+
+        WebSocket ws(sp_loop);
+        ws.setDeflateEnable(true, 10);
+        std::vector<WebSocket::ConnToken> tokens;
+        ws.setConnectedCallback(
+            [&] (const WebSocket::ConnToken &token, const Request &) { tokens.push_back(token); }
+        );
+        server.use(&ws);
+        server.start();
+
+        //! 一个协商了压缩，一个没有
+        Client plain_client(sp_loop);
+        RunLoop(sp_loop, 20);
+        Client deflate_client(sp_loop, "Sec-WebSocket-Extensions: permessage-deflate\r\n");
+        RunLoop(sp_loop, 20);
+        ASSERT_EQ(tokens.size(), 2u);
+
+        EXPECT_EQ(ws.broadcast("hello everyone"), 2u);
+        EXPECT_EQ(ws.broadcast({tokens[1]}, WebSocket::MessageType::kBinary, "only", 4), 1u);
+        RunLoop(sp_loop);
+
+        ASSERT_EQ(plain_client.messages.size(), 1u);
+        EXPECT_FALSE(plain_client.messages[0].rsv1);
+        EXPECT_EQ(plain_client.messages[0].payload, "hello everyone");
+
+        ASSERT_EQ(deflate_client.messages.size(), 2u);
+        EXPECT_TRUE(deflate_client.messages[0].rsv1);
+        Inflater inflater;
+        std::string out;
+        ASSERT_TRUE(inflater.decompress(deflate_client.messages[0].payload.data(),
+                                        deflate_client.messages[0].payload.size(), out, 1 << 20));
+        EXPECT_EQ(out, "hello everyone");
+        EXPECT_EQ(deflate_client.messages[1].opcode, Opcode::kBinary);
+        EXPECT_EQ(deflate_client.messages[1].payload, "only");
+    }
+    delete sp_loop;
+}
+
+TEST(WebSocket, BenchmarkBroadcast)
+{
+    const int kClientNum = 100;
+    const int kMessageNum = 1000;
+
+    auto sp_loop = Loop::New();
+    {
+        Server server(sp_loop);
+        ASSERT_TRUE(server.initialize(SockAddr::FromString(kBindAddr), kClientNum));
+
+        WebSocket ws(sp_loop);
+        ws.setDeflateEnable(false);
+        server.use(&ws);
+        server.start();
+
+        std::vector<Client*> clients;
+        for (int i = 0; i < kClientNum; ++i)
+            clients.push_back(new Client(sp_loop));
+        RunLoop(sp_loop, 100);
+        ASSERT_EQ(ws.size(), static_cast<size_t>(kClientNum));
+
+        std::string message(1024, 'm');
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kMessageNum; ++i)
+            ws.broadcast(WebSocket::MessageType::kBinary, message.data(), message.size());
+        auto cost = std::chrono::steady_clock::now() - start;
+
+        auto cost_us = std::chrono::duration_cast<std::chrono::microseconds>(cost).count();
+        std::cout << "broadcast " << kMessageNum << " x " << message.size() << " bytes to " << kClientNum
+              << " conns, cost: " << cost_us << " us" << std::endl;
+
+        RunLoop(sp_loop, 500);
+        for (auto client : clients) {
+            EXPECT_EQ(client->messages.size(), static_cast<size_t>(kMessageNum));
+            delete client;
+        }
+    }
+    delete sp_loop;
+}
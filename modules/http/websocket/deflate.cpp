@@ -0,0 +1,173 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "deflate.h"
+
+#ifdef TBOX_HTTP_ENABLE_ZLIB
+#include <cstring>
+#include <algorithm>
+#include <zlib.h>
+#endif
+
+namespace tbox {
+namespace http {
+namespace websocket {
+
+#ifdef TBOX_HTTP_ENABLE_ZLIB
+
+namespace {
+const uint8_t kTail[4] = { 0x00, 0x00, 0xff, 0xff };
+constexpr size_t kChunkSize = 16 << 10;
+}
+
+Deflater::Deflater()
+{
+    auto stream = new z_stream;
+    ::memset(stream, 0, sizeof(*stream));
+    //! 负的 windowBits 表示不带 zlib 头的原始 deflate 数据
+    if (::deflateInit2(stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        delete stream;
+        return;
+    }
+    sp_stream_ = stream;
+}
+
+Deflater::~Deflater()
+{
+    auto stream = static_cast<z_stream*>(sp_stream_);
+    if (stream != nullptr) {
+        ::deflateEnd(stream);
+        delete stream;
+    }
+}
+
+bool Deflater::IsSupported() { return true; }
+
+bool Deflater::compress(const void *data_ptr, size_t data_size, std::string &out)
+{
+    auto stream = static_cast<z_stream*>(sp_stream_);
+    if (stream == nullptr)
+        return false;
+
+    size_t start_size = out.size();
+    stream->next_in = static_cast<Bytef*>(const_cast<void*>(data_ptr));
+    stream->avail_in = static_cast<uInt>(data_size);
+
+    int ret;
+    do {
+        size_t old_size = out.size();
+        size_t chunk_size = std::max(kChunkSize, static_cast<size_t>(::deflateBound(stream, stream->avail_in)));
+        out.resize(old_size + chunk_size);
+        stream->next_out = reinterpret_cast<Bytef*>(&out[old_size]);
+        stream->avail_out = static_cast<uInt>(chunk_size);
+        ret = ::deflate(stream, Z_SYNC_FLUSH);
+        out.resize(out.size() - stream->avail_out);
+    } while (ret == Z_OK && stream->avail_out == 0);
+
+    ::deflateReset(stream);
+
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        out.resize(start_size);
+        return false;
+    }
+
+    //! Z_SYNC_FLUSH 的结尾总是 00 00 ff ff，按协议要去掉
+    if (out.size() - start_size >= 4 && ::memcmp(out.data() + out.size() - 4, kTail, 4) == 0)
+        out.resize(out.size() - 4);
+    return true;
+}
+
+Inflater::Inflater()
+{
+    auto stream = new z_stream;
+    ::memset(stream, 0, sizeof(*stream));
+    if (::inflateInit2(stream, -15) != Z_OK) {
+        delete stream;
+        return;
+    }
+    sp_stream_ = stream;
+}
+
+Inflater::~Inflater()
+{
+    auto stream = static_cast<z_stream*>(sp_stream_);
+    if (stream != nullptr) {
+        ::inflateEnd(stream);
+        delete stream;
+    }
+}
+
+bool Inflater::decompress(const void *data_ptr, size_t data_size, std::string &out, size_t max_size)
+{
+    auto stream = static_cast<z_stream*>(sp_stream_);
+    if (stream == nullptr)
+        return false;
+
+    size_t start_size = out.size();
+
+    //! 先解消息本身，再补上发送方去掉的 00 00 ff ff
+    const Bytef *inputs[2] = { static_cast<const Bytef*>(data_ptr), kTail };
+    size_t input_sizes[2] = { data_size, sizeof(kTail) };
+
+    for (int i = 0; i < 2; ++i) {
+        stream->next_in = const_cast<Bytef*>(inputs[i]);
+        stream->avail_in = static_cast<uInt>(input_sizes[i]);
+
+        //! 输出区被填满时，zlib 中可能还有未输出的数据，要继续
+        for (;;) {
+            size_t old_size = out.size();
+            out.resize(old_size + kChunkSize);
+            stream->next_out = reinterpret_cast<Bytef*>(&out[old_size]);
+            stream->avail_out = kChunkSize;
+
+            int ret = ::inflate(stream, Z_SYNC_FLUSH);
+            bool is_full = stream->avail_out == 0;
+            out.resize(out.size() - stream->avail_out);
+
+            if (ret == Z_BUF_ERROR)     //! 没有进展，输入已用完
+                break;
+            if (ret == Z_STREAM_END) {  //! 对方以 BFINAL 块结束了该消息，后面的数据属于新的流
+                ::inflateReset(stream);
+                ret = Z_OK;
+            }
+            if (ret != Z_OK || out.size() - start_size > max_size)
+                return false;
+            if (stream->avail_in == 0 && !is_full)
+                break;
+        }
+    }
+    return true;
+}
+
+#else
+
+Deflater::Deflater() { }
+Deflater::~Deflater() { }
+bool Deflater::IsSupported() { return false; }
+bool Deflater::compress(const void *, size_t, std::string &) { return false; }
+
+Inflater::Inflater() { }
+Inflater::~Inflater() { }
+bool Inflater::decompress(const void *, size_t, std::string &, size_t) { return false; }
+
+#endif
+
+}
+}
+}
@@ -0,0 +1,77 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_WEBSOCKET_DEFLATE_H_20251019
+#define TBOX_HTTP_WEBSOCKET_DEFLATE_H_20251019
+
+#include <string>
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace http {
+namespace websocket {
+
+/**
+ * permessage-deflate (RFC 7692) 的压缩与解压
+ *
+ * 需要在编译时定义 TBOX_HTTP_ENABLE_ZLIB 并链接 zlib，否则 isSupported() 为 false，
+ * 握手时不会协商该扩展
+ */
+
+//! 压缩器。服务端固定使用 server_no_context_takeover，每条消息独立压缩，
+//! 所以一条广播消息只需压缩一次，所有连接共用一个压缩器
+class Deflater {
+  public:
+    Deflater();
+    ~Deflater();
+
+    NONCOPYABLE(Deflater);
+
+    static bool IsSupported();
+
+    //! 压缩一条完整的消息，结果追加到 out，已去掉末尾的 00 00 ff ff
+    bool compress(const void *data_ptr, size_t data_size, std::string &out);
+
+  private:
+    void *sp_stream_ = nullptr;
+};
+
+//! 解压器，每个连接一个。对方可能沿用上一条消息的上下文，所以不能在消息之间重置
+class Inflater {
+  public:
+    Inflater();
+    ~Inflater();
+
+    NONCOPYABLE(Inflater);
+
+    /**
+     * \brief   解压一条完整的消息，结果追加到 out
+     * \param   max_size    解压后的上限，超过时返回 false，以防压缩炸弹
+     */
+    bool decompress(const void *data_ptr, size_t data_size, std::string &out, size_t max_size);
+
+  private:
+    void *sp_stream_ = nullptr;
+};
+
+}
+}
+}
+
+#endif //TBOX_HTTP_WEBSOCKET_DEFLATE_H_20251019
@@ -0,0 +1,83 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+
+#include "deflate.h"
+
+using namespace tbox::http::websocket;
+
+TEST(WebSocketDeflate, RoundTrip)
+{
+    if (!Deflater::IsSupported())
+        GTEST_SKIP();
+
+    Deflater deflater;
+    Inflater inflater;
+
+    std::string text;
+    for (int i = 0; i < 100; ++i)
+        text += "{\"id\":" + std::to_string(i) + ",\"name\":\"websocket\"}";
+
+    //! 每条消息独立压缩，相同的消息结果相同
+    std::string first, second;
+    ASSERT_TRUE(deflater.compress(text.data(), text.size(), first));
+    ASSERT_TRUE(deflater.compress(text.data(), text.size(), second));
+    EXPECT_EQ(first, second);
+    EXPECT_LT(first.size(), text.size() / 4);
+
+    for (int i = 0; i < 2; ++i) {
+        std::string out;
+        ASSERT_TRUE(inflater.decompress(first.data(), first.size(), out, 1 << 20));
+        EXPECT_EQ(out, text);
+    }
+
+    std::string empty_out;
+    ASSERT_TRUE(deflater.compress("", 0, empty_out));
+    std::string out;
+    ASSERT_TRUE(inflater.decompress(empty_out.data(), empty_out.size(), out, 1 << 20));
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(WebSocketDeflate, MaxSize)
+{
+    if (!Deflater::IsSupported())
+        GTEST_SKIP();
+
+    Deflater deflater;
+    Inflater inflater;
+
+    std::string zeros(1 << 20, '\0');
+    std::string compressed;
+    ASSERT_TRUE(deflater.compress(zeros.data(), zeros.size(), compressed));
+
+    std::string out;
+    EXPECT_FALSE(inflater.decompress(compressed.data(), compressed.size(), out, 1000));
+}
+
+TEST(WebSocketDeflate, InvalidData)
+{
+    if (!Deflater::IsSupported())
+        GTEST_SKIP();
+
+    Inflater inflater;
+    const char data[] = "\xff\xff\xff\xff\xff";
+    std::string out;
+    EXPECT_FALSE(inflater.decompress(data, sizeof(data) - 1, out, 1 << 20));
+}
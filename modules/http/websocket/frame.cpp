@@ -0,0 +1,293 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "frame.h"
+
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <tbox/util/base64.h>
+
+namespace tbox {
+namespace http {
+namespace websocket {
+
+namespace {
+
+//! SHA-1 (RFC 3174)，只用于握手，所以只实现一次性计算
+void Sha1(const uint8_t *data_ptr, size_t data_size, uint8_t digest[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    //! 补齐：0x80，若干个0，最后8字节为长度(bit)
+    std::string msg(reinterpret_cast<const char*>(data_ptr), data_size);
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56)
+        msg.push_back(0);
+    uint64_t bits = static_cast<uint64_t>(data_size) * 8;
+    for (int i = 7; i >= 0; --i)
+        msg.push_back(static_cast<char>(bits >> (i * 8)));
+
+    auto rol = [] (uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+
+    for (size_t pos = 0; pos < msg.size(); pos += 64) {
+        const uint8_t *block = reinterpret_cast<const uint8_t*>(msg.data() + pos);
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i)
+            w[i] = (block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+        for (int i = 16; i < 80; ++i)
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4]     = static_cast<uint8_t>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+    }
+}
+
+}
+
+int ParseFrameHead(const uint8_t *data_ptr, size_t data_size, FrameHead &head)
+{
+    if (data_size < 2)
+        return 0;
+
+    uint8_t b0 = data_ptr[0];
+    uint8_t b1 = data_ptr[1];
+
+    if ((b0 & 0x30) != 0)   //! RSV2, RSV3
+        return -1;
+
+    head.fin = (b0 & 0x80) != 0;
+    head.rsv1 = (b0 & 0x40) != 0;
+    head.opcode = static_cast<Opcode>(b0 & 0x0f);
+    head.is_masked = (b1 & 0x80) != 0;
+
+    switch (head.opcode) {
+        case Opcode::kContinuation:
+        case Opcode::kText:
+        case Opcode::kBinary:
+        case Opcode::kClose:
+        case Opcode::kPing:
+        case Opcode::kPong:
+            break;
+        default:
+            return -1;
+    }
+
+    size_t head_size = 2;
+    uint64_t payload_size = b1 & 0x7f;
+    if (payload_size == 126) {
+        head_size += 2;
+        if (data_size < head_size)
+            return 0;
+        payload_size = (data_ptr[2] << 8) | data_ptr[3];
+
+    } else if (payload_size == 127) {
+        head_size += 8;
+        if (data_size < head_size)
+            return 0;
+        payload_size = 0;
+        for (int i = 0; i < 8; ++i)
+            payload_size = (payload_size << 8) | data_ptr[2 + i];
+        if (payload_size >> 63)     //! 最高位必须为0
+            return -1;
+    }
+
+    //! 控制帧不能分片，长度不超过125
+    if (IsControl(head.opcode) && (!head.fin || payload_size > kMaxControlPayloadSize))
+        return -1;
+
+    if (head.is_masked) {
+        if (data_size < head_size + 4)
+            return 0;
+        ::memcpy(head.mask, data_ptr + head_size, 4);
+        head_size += 4;
+    }
+
+    head.payload_size = payload_size;
+    return static_cast<int>(head_size);
+}
+
+size_t WriteFrameHead(uint8_t *buff, Opcode opcode, bool fin, bool rsv1, uint64_t payload_size)
+{
+    buff[0] = static_cast<uint8_t>(opcode) | (fin ? 0x80 : 0) | (rsv1 ? 0x40 : 0);
+
+    if (payload_size < 126) {
+        buff[1] = static_cast<uint8_t>(payload_size);
+        return 2;
+    }
+
+    if (payload_size <= 0xffff) {
+        buff[1] = 126;
+        buff[2] = static_cast<uint8_t>(payload_size >> 8);
+        buff[3] = static_cast<uint8_t>(payload_size);
+        return 4;
+    }
+
+    buff[1] = 127;
+    for (int i = 0; i < 8; ++i)
+        buff[2 + i] = static_cast<uint8_t>(payload_size >> ((7 - i) * 8));
+    return 10;
+}
+
+void Unmask(uint8_t *data_ptr, size_t data_size, const uint8_t mask[4], size_t offset)
+{
+    uint8_t *p = data_ptr;
+    uint8_t *end = data_ptr + data_size;
+
+    //! 逐字节处理到8字节对齐，之后按组处理
+    while (p < end && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+        *p++ ^= mask[offset & 3];
+        ++offset;
+    }
+
+    //! 把掩码按当前的偏移旋转后铺满一组
+    uint8_t rotated[16];
+    for (int i = 0; i < 16; ++i)
+        rotated[i] = mask[(offset + i) & 3];
+
+#if defined(__SSE2__)
+    __m128i mask128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rotated));
+    for (; end - p >= 64; p += 64) {
+        __m128i *q = reinterpret_cast<__m128i*>(p);
+        _mm_storeu_si128(q + 0, _mm_xor_si128(_mm_loadu_si128(q + 0), mask128));
+        _mm_storeu_si128(q + 1, _mm_xor_si128(_mm_loadu_si128(q + 1), mask128));
+        _mm_storeu_si128(q + 2, _mm_xor_si128(_mm_loadu_si128(q + 2), mask128));
+        _mm_storeu_si128(q + 3, _mm_xor_si128(_mm_loadu_si128(q + 3), mask128));
+    }
+    for (; end - p >= 16; p += 16) {
+        __m128i *q = reinterpret_cast<__m128i*>(p);
+        _mm_storeu_si128(q, _mm_xor_si128(_mm_loadu_si128(q), mask128));
+    }
+#endif
+
+    uint64_t mask64;
+    ::memcpy(&mask64, rotated, 8);
+    for (; end - p >= 8; p += 8) {
+        uint64_t value;
+        ::memcpy(&value, p, 8);
+        value ^= mask64;
+        ::memcpy(p, &value, 8);
+    }
+
+    //! 组内偏移都是4的倍数，剩下的从 rotated 开头取
+    for (size_t i = 0; p < end; ++i)
+        *p++ ^= rotated[i];
+}
+
+bool IsValidUtf8(const uint8_t *data_ptr, size_t data_size)
+{
+    const uint8_t *p = data_ptr;
+    const uint8_t *end = data_ptr + data_size;
+
+    while (p < end) {
+        //! ASCII 按8字节一组快速跳过
+        if (end - p >= 8) {
+            uint64_t value;
+            ::memcpy(&value, p, 8);
+            if ((value & 0x8080808080808080ull) == 0) {
+                p += 8;
+                continue;
+            }
+        }
+
+        uint8_t c = *p;
+        if (c < 0x80) {
+            ++p;
+            continue;
+        }
+
+        size_t len;
+        uint8_t min_second = 0x80, max_second = 0xbf;
+        if (c >= 0xc2 && c <= 0xdf) {
+            len = 2;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            len = 3;
+            if (c == 0xe0)
+                min_second = 0xa0;  //! 过长编码
+            else if (c == 0xed)
+                max_second = 0x9f;  //! UTF-16 代理区
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            len = 4;
+            if (c == 0xf0)
+                min_second = 0x90;
+            else if (c == 0xf4)
+                max_second = 0x8f;  //! 超过 U+10FFFF
+        } else {
+            return false;
+        }
+
+        if (static_cast<size_t>(end - p) < len)
+            return false;
+        if (p[1] < min_second || p[1] > max_second)
+            return false;
+        for (size_t i = 2; i < len; ++i)
+            if ((p[i] & 0xc0) != 0x80)
+                return false;
+        p += len;
+    }
+    return true;
+}
+
+std::string MakeAcceptKey(const std::string &key)
+{
+    std::string text = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t digest[20];
+    Sha1(reinterpret_cast<const uint8_t*>(text.data()), text.size(), digest);
+    return util::base64::Encode(digest, sizeof(digest));
+}
+
+}
+}
+}
@@ -0,0 +1,99 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_HTTP_WEBSOCKET_FRAME_H_20251019
+#define TBOX_HTTP_WEBSOCKET_FRAME_H_20251019
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace tbox {
+namespace http {
+namespace websocket {
+
+//! 帧类型 (RFC 6455 5.2)
+enum class Opcode : uint8_t {
+    kContinuation = 0x0,
+    kText = 0x1,
+    kBinary = 0x2,
+    kClose = 0x8,
+    kPing = 0x9,
+    kPong = 0xa,
+};
+
+//! 关闭码 (RFC 6455 7.4.1)
+constexpr uint16_t kCloseNormal = 1000;
+constexpr uint16_t kCloseGoingAway = 1001;
+constexpr uint16_t kCloseProtocolError = 1002;
+constexpr uint16_t kCloseUnsupportedData = 1003;
+constexpr uint16_t kCloseNoStatus = 1005;
+constexpr uint16_t kCloseInvalidData = 1007;
+constexpr uint16_t kClosePolicyViolation = 1008;
+constexpr uint16_t kCloseMessageTooBig = 1009;
+constexpr uint16_t kCloseInternalError = 1011;
+
+constexpr size_t kMaxFrameHeadSize = 14;
+constexpr size_t kMaxControlPayloadSize = 125;
+
+struct FrameHead {
+    bool fin = false;
+    bool rsv1 = false;      //!< permessage-deflate 中表示该消息已压缩
+    Opcode opcode = Opcode::kContinuation;
+    bool is_masked = false;
+    uint8_t mask[4] = {0};
+    uint64_t payload_size = 0;
+};
+
+inline bool IsControl(Opcode opcode) { return (static_cast<uint8_t>(opcode) & 0x8) != 0; }
+
+/**
+ * \brief   解析帧头
+ * \return  > 0     帧头的长度
+ *          = 0     数据不足
+ *          < 0     格式错误：RSV2/RSV3 不为0、未知的类型、控制帧分片或超过125字节
+ */
+int ParseFrameHead(const uint8_t *data_ptr, size_t data_size, FrameHead &head);
+
+/**
+ * \brief   写服务端的帧头，不带掩码
+ * \param   buff    至少 kMaxFrameHeadSize 字节
+ * \return  帧头的长度
+ */
+size_t WriteFrameHead(uint8_t *buff, Opcode opcode, bool fin, bool rsv1, uint64_t payload_size);
+
+/**
+ * \brief   按掩码异或数据，就地进行
+ * \param   offset  data_ptr 在整个负载中的偏移，用于分段处理
+ *
+ * 按 16 字节 (SSE2) 或 8 字节一组处理，只有首尾不足一组的部分逐字节处理
+ */
+void Unmask(uint8_t *data_ptr, size_t data_size, const uint8_t mask[4], size_t offset = 0);
+
+//! 检查是否为合法的 UTF-8，Text 消息与关闭原因须为 UTF-8
+bool IsValidUtf8(const uint8_t *data_ptr, size_t data_size);
+
+//! 由请求的 Sec-WebSocket-Key 计算回复的 Sec-WebSocket-Accept
+std::string MakeAcceptKey(const std::string &key);
+
+}
+}
+}
+
+#endif //TBOX_HTTP_WEBSOCKET_FRAME_H_20251019
@@ -0,0 +1,145 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include "frame.h"
+
+using namespace tbox::http::websocket;
+
+namespace {
+
+void NaiveUnmask(uint8_t *data_ptr, size_t data_size, const uint8_t mask[4], size_t offset)
+{
+    for (size_t i = 0; i < data_size; ++i)
+        data_ptr[i] ^= mask[(i + offset) & 3];
+}
+
+}
+
+TEST(WebSocketFrame, Unmask)
+{
+    const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+    std::vector<uint8_t> orig(300);
+    for (size_t i = 0; i < orig.size(); ++i)
+        orig[i] = static_cast<uint8_t>(i * 7 + 3);
+
+    //! 覆盖各种起始对齐、长度与偏移
+    for (size_t start = 0; start < 16; ++start) {
+        for (size_t size : {0, 1, 3, 7, 8, 15, 16, 17, 63, 64, 65, 130, 250}) {
+            for (size_t offset = 0; offset < 4; ++offset) {
+                auto expect = orig;
+                auto actual = orig;
+                NaiveUnmask(expect.data() + start, size, mask, offset);
+                Unmask(actual.data() + start, size, mask, offset);
+                ASSERT_EQ(expect, actual) << "start:" << start << ", size:" << size << ", offset:" << offset;
+            }
+        }
+    }
+}
+
+TEST(WebSocketFrame, WriteAndParse)
+{
+    for (uint64_t size : {0ull, 125ull, 126ull, 65535ull, 65536ull, 0x123456789ull}) {
+        uint8_t buff[kMaxFrameHeadSize];
+        size_t head_size = WriteFrameHead(buff, Opcode::kBinary, true, true, size);
+
+        FrameHead head;
+        //! 帧头不完整时需要更多数据
+        EXPECT_EQ(ParseFrameHead(buff, head_size - 1, head), 0);
+        ASSERT_EQ(ParseFrameHead(buff, head_size, head), static_cast<int>(head_size));
+        EXPECT_TRUE(head.fin);
+        EXPECT_TRUE(head.rsv1);
+        EXPECT_FALSE(head.is_masked);
+        EXPECT_EQ(head.opcode, Opcode::kBinary);
+        EXPECT_EQ(head.payload_size, size);
+    }
+}
+
+TEST(WebSocketFrame, ParseMasked)
+{
+    //! RFC 6455 5.7 中带掩码的 "Hello"
+    uint8_t data[] = {0x81, 0x85, 0x37, 0xfa, 0x21, 0x3d, 0x7f, 0x9f, 0x4d, 0x51, 0x58};
+    FrameHead head;
+    ASSERT_EQ(ParseFrameHead(data, sizeof(data), head), 6);
+    EXPECT_TRUE(head.is_masked);
+    EXPECT_EQ(head.opcode, Opcode::kText);
+    ASSERT_EQ(head.payload_size, 5u);
+
+    Unmask(data + 6, 5, head.mask);
+    EXPECT_EQ(std::string(reinterpret_cast<char*>(data + 6), 5), "Hello");
+}
+
+TEST(WebSocketFrame, ParseInvalid)
+{
+    FrameHead head;
+    uint8_t rsv2[] = {0xa1, 0x00};
+    EXPECT_LT(ParseFrameHead(rsv2, sizeof(rsv2), head), 0);
+
+    uint8_t unknown_opcode[] = {0x83, 0x00};
+    EXPECT_LT(ParseFrameHead(unknown_opcode, sizeof(unknown_opcode), head), 0);
+
+    uint8_t fragmented_ping[] = {0x09, 0x00};
+    EXPECT_LT(ParseFrameHead(fragmented_ping, sizeof(fragmented_ping), head), 0);
+
+    uint8_t big_ping[] = {0x89, 0x7e, 0x00, 0x7e};
+    EXPECT_LT(ParseFrameHead(big_ping, sizeof(big_ping), head), 0);
+
+    uint8_t huge[] = {0x82, 0x7f, 0x80, 0, 0, 0, 0, 0, 0, 0};
+    EXPECT_LT(ParseFrameHead(huge, sizeof(huge), head), 0);
+}
+
+TEST(WebSocketFrame, Utf8)
+{
+    auto check = [] (const std::string &str) {
+        return IsValidUtf8(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+    };
+
+    EXPECT_TRUE(check(""));
+    EXPECT_TRUE(check("hello world, this is ascii"));
+    EXPECT_TRUE(check("中文 κόσμε \xf0\x9f\x98\x80"));
+    EXPECT_FALSE(check("abc\x80"));
+    EXPECT_FALSE(check("\xc0\xaf"));            //!< 过长编码
+    EXPECT_FALSE(check("\xed\xa0\x80"));        //!< 代理区
+    EXPECT_FALSE(check("\xf4\x90\x80\x80"));    //!< 超过 U+10FFFF
+    EXPECT_FALSE(check("abcdefgh\xe4\xb8"));    //!< 不完整
+}
+
+TEST(WebSocketFrame, AcceptKey)
+{
+    //! RFC 6455 1.3 中的示例
+    EXPECT_EQ(MakeAcceptKey("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(WebSocketFrame, BenchmarkUnmask)
+{
+    const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+    std::vector<uint8_t> data(64 << 10, 0x5a);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10000; ++i)
+        Unmask(data.data() + 1, data.size() - 1, mask, i);
+    auto cost = std::chrono::steady_clock::now() - start;
+
+    auto cost_us = std::chrono::duration_cast<std::chrono::microseconds>(cost).count();
+    std::cout << "unmask " << ((data.size() * 10000) >> 20) << " MB, cost: " << cost_us << " us" << std::endl;
+}
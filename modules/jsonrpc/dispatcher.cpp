@@ -0,0 +1,195 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "dispatcher.h"
+
+#include <tbox/base/log.h>
+#include <tbox/base/json.hpp>
+#include <tbox/base/catch_throw.h>
+#include <tbox/network/tcp_server.h>
+
+#include "inner_types.h"
+
+namespace tbox {
+namespace jsonrpc {
+
+using namespace std::placeholders;
+
+template <typename ConnKey, typename ConnKeyHash>
+Dispatcher<ConnKey, ConnKeyHash>::Dispatcher(event::Loop *wp_loop)
+    : respond_timeout_(wp_loop)
+{
+    respond_timeout_.setCallback(std::bind(&Dispatcher::onRespondTimeout, this, _1));
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::initialize(int timeout_sec, GetProtoFunc &&get_proto)
+{
+    get_proto_ = std::move(get_proto);
+    respond_timeout_.initialize(std::chrono::seconds(1), timeout_sec);
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::cleanup()
+{
+    respond_timeout_.cleanup();
+    method_services_.clear();
+    tobe_respond_.clear();
+    get_proto_ = nullptr;
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::addService(const std::string &method, ServiceCallback &&cb)
+{
+    auto &service = method_services_[method];
+    service.cb = std::move(cb);
+    service.raw_cb = nullptr;
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::addRawService(const std::string &method, RawServiceCallback &&cb)
+{
+    auto &service = method_services_[method];
+    service.raw_cb = std::move(cb);
+    service.cb = nullptr;
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::dispatch(const ConnKey &conn, int64_t id, const std::string &method, const JsonView &js_params)
+{
+    auto iter = method_services_.find(method);
+    if (iter == method_services_.end() || (!iter->second.cb && !iter->second.raw_cb)) {
+        auto proto = get_proto_ ? get_proto_(conn) : nullptr;
+        if (proto != nullptr)
+            proto->sendError(id, ErrorCode::kMethodNotFound);
+        return;
+    }
+
+    auto &service = iter->second;
+    if (id != 0)
+        tobe_respond_.insert(RespondKey{ conn, id });
+
+    int errcode = 0;
+    bool is_sync = false;
+
+    if (service.raw_cb) {
+        std::string result_text;
+        is_sync = service.raw_cb(conn, id, js_params, errcode, result_text);
+        if (is_sync && id != 0) {
+            if (errcode != 0)
+                respond(conn, id, errcode);
+            else if (result_text.empty())
+                respond(conn, id, Json());
+            else
+                respond(conn, id, JsonView(result_text.data(), result_text.size()));
+            return;
+        }
+
+    } else {
+        //! 参数到这时才解析
+        const Json *js_params_ptr = nullptr;
+        if (CatchThrow([&] { js_params_ptr = &js_params.json(); })) {
+            LogNotice("parse params fail");
+            if (id != 0)
+                respond(conn, id, ErrorCode::kParseError);
+            return;
+        }
+
+        Json js_result;
+        is_sync = service.cb(conn, id, *js_params_ptr, errcode, js_result);
+        if (is_sync && id != 0) {
+            respond(conn, id, errcode, js_result);
+            return;
+        }
+    }
+
+    if (id != 0)
+        respond_timeout_.add(RespondKey{ conn, id });
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+Proto* Dispatcher<ConnKey, ConnKeyHash>::beginRespond(const ConnKey &conn, int64_t id)
+{
+    if (id == 0) {
+        LogWarn("send id == 0 respond");
+        return nullptr;
+    }
+
+    tobe_respond_.erase(RespondKey{ conn, id });
+    return get_proto_ ? get_proto_(conn) : nullptr;
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::respond(const ConnKey &conn, int64_t id, int errcode, const Json &js_result)
+{
+    if (errcode == 0)
+        respond(conn, id, js_result);
+    else
+        respond(conn, id, errcode);
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::respond(const ConnKey &conn, int64_t id, const Json &js_result)
+{
+    auto proto = beginRespond(conn, id);
+    if (proto != nullptr)
+        proto->sendResult(id, js_result);
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::respond(const ConnKey &conn, int64_t id, int errcode)
+{
+    auto proto = beginRespond(conn, id);
+    if (proto != nullptr)
+        proto->sendError(id, errcode);
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::respond(const ConnKey &conn, int64_t id, const JsonView &js_result)
+{
+    auto proto = beginRespond(conn, id);
+    if (proto != nullptr)
+        proto->sendResult(id, js_result);
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::respondByWriter(const ConnKey &conn, int64_t id, const Proto::WriteJsonFunc &write_result)
+{
+    auto proto = beginRespond(conn, id);
+    if (proto != nullptr)
+        proto->sendResultByWriter(id, write_result);
+}
+
+template <typename ConnKey, typename ConnKeyHash>
+void Dispatcher<ConnKey, ConnKeyHash>::onRespondTimeout(const RespondKey &key)
+{
+    auto iter = tobe_respond_.find(key);
+    if (iter != tobe_respond_.end()) {
+        LogWarn("respond timeout"); //! 仅仅是提示作用
+        tobe_respond_.erase(iter);
+    }
+}
+
+//! Rpc 用
+template class Dispatcher<Proto*>;
+//! Server 用
+template class Dispatcher<network::TcpServer::ConnToken>;
+
+}
+}
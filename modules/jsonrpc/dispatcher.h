@@ -0,0 +1,107 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_JSONRPC_DISPATCHER_H_20251019
+#define TBOX_JSONRPC_DISPATCHER_H_20251019
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <tbox/base/json_fwd.h>
+#include <tbox/event/forward.h>
+#include <tbox/eventx/timeout_monitor.hpp>
+
+#include "json_view.h"
+#include "proto.h"
+
+namespace tbox {
+namespace jsonrpc {
+
+/**
+ * 收到的请求的分发与回复，由 Rpc 与 Server 共用
+ *
+ * 负责方法表、参数的按需解析、同步回复，以及待回复请求的记录与回复超时监测。
+ * ConnKey 标识请求来自哪个连接：Rpc 只有一个连接，用的是 Proto*；Server 用的是 ConnToken。
+ * 只对这两种 ConnKey 做了实例化，见 dispatcher.cpp
+ */
+template <typename ConnKey, typename ConnKeyHash = std::hash<ConnKey>>
+class Dispatcher {
+  public:
+    //! 同 Rpc::ServiceCallback，多了发起请求的连接
+    using ServiceCallback = std::function<bool(const ConnKey &conn, int64_t id, const Json &js_params, int &errcode, Json &js_result)>;
+    //! 同 Rpc::RawServiceCallback，多了发起请求的连接
+    using RawServiceCallback = std::function<bool(const ConnKey &conn, int64_t id, const JsonView &js_params, int &errcode, std::string &result_text)>;
+
+    /**
+     * 取连接所用的协议对象，并做好发送前的准备（如开始合并）
+     * 连接已不存在时返回 nullptr，回复被丢弃
+     */
+    using GetProtoFunc = std::function<Proto*(const ConnKey &conn)>;
+
+  public:
+    explicit Dispatcher(event::Loop *wp_loop);
+
+    void initialize(int timeout_sec, GetProtoFunc &&get_proto);
+    void cleanup();
+
+    void addService(const std::string &method, ServiceCallback &&cb);
+    void addRawService(const std::string &method, RawServiceCallback &&cb);
+
+    //! 分发收到的请求，找不到方法时回复 -32601，参数解析失败时回复 -32700
+    void dispatch(const ConnKey &conn, int64_t id, const std::string &method, const JsonView &js_params);
+
+    void respond(const ConnKey &conn, int64_t id, int errcode, const Json &js_result);
+    void respond(const ConnKey &conn, int64_t id, const Json &js_result);
+    void respond(const ConnKey &conn, int64_t id, int errcode);
+    void respond(const ConnKey &conn, int64_t id, const JsonView &js_result);
+    void respondByWriter(const ConnKey &conn, int64_t id, const Proto::WriteJsonFunc &write_result);
+
+  private:
+    struct Service {
+        ServiceCallback cb;
+        RawServiceCallback raw_cb;
+    };
+
+    //! 等待本端回复的请求
+    struct RespondKey {
+        ConnKey conn;
+        int64_t id;
+
+        bool operator == (const RespondKey &rhs) const { return conn == rhs.conn && id == rhs.id; }
+    };
+
+    struct RespondKeyHash {
+        size_t operator () (const RespondKey &key) const { return ConnKeyHash()(key.conn) ^ std::hash<int64_t>()(key.id); }
+    };
+
+    //! 回复前的检查与记录，返回要用的协议对象，不能回复时返回 nullptr
+    Proto* beginRespond(const ConnKey &conn, int64_t id);
+    void onRespondTimeout(const RespondKey &key);
+
+    GetProtoFunc get_proto_;
+    std::unordered_map<std::string, Service> method_services_;
+    std::unordered_set<RespondKey, RespondKeyHash> tobe_respond_;
+    eventx::TimeoutMonitor<RespondKey> respond_timeout_;    //! 回复超时监测
+};
+
+}
+}
+
+#endif //TBOX_JSONRPC_DISPATCHER_H_20251019
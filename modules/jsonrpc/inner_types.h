@@ -11,6 +11,7 @@ enum ErrorCode {
     kInvalidParams  = -32602,
     kInternalError  = -32603,
     kRequestTimeout = -32000,
+    kRequestOverload = -32001,  //!< 本端等待回复与排队的请求都已满
 };
 
 }
@@ -0,0 +1,55 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "json_view.h"
+
+#include <tbox/base/json.hpp>
+
+namespace tbox {
+namespace jsonrpc {
+
+JsonView::~JsonView()
+{
+    delete sp_parsed_js_;
+}
+
+std::string JsonView::dump() const
+{
+    if (text_ptr_ != nullptr)
+        return std::string(text_ptr_, text_size_);
+    return json().dump();
+}
+
+const Json& JsonView::json() const
+{
+    if (js_ptr_ != nullptr)
+        return *js_ptr_;
+
+    if (text_ptr_ == nullptr) {
+        static const Json js_null;
+        return js_null;
+    }
+
+    if (sp_parsed_js_ == nullptr)
+        sp_parsed_js_ = new Json(Json::parse(text_ptr_, text_ptr_ + text_size_));
+    return *sp_parsed_js_;
+}
+
+}
+}
@@ -0,0 +1,75 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_JSONRPC_JSON_VIEW_H_20251019
+#define TBOX_JSONRPC_JSON_VIEW_H_20251019
+
+#include <string>
+#include <tbox/base/json_fwd.h>
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace jsonrpc {
+
+/**
+ * JSON 视图
+ *
+ * 指向收到的数据中未解析的JSON文本，或是已有的 Json 对象。
+ * 只在首次调用 json() 时才解析，不关心内容的可以直接转发 text()。
+ *
+ * 不持有数据，只在回调期间有效
+ */
+class JsonView {
+  public:
+    JsonView() { }
+    JsonView(const char *text_ptr, size_t text_size) : text_ptr_(text_ptr), text_size_(text_size) { }
+    explicit JsonView(const Json &js) : js_ptr_(&js) { }
+    ~JsonView();
+
+    NONCOPYABLE(JsonView);
+
+  public:
+    bool empty() const { return text_ptr_ == nullptr && js_ptr_ == nullptr; }
+    bool isText() const { return text_ptr_ != nullptr; }
+
+    //! 原文本，只在 isText() 时有效
+    const char* text() const { return text_ptr_; }
+    size_t textSize() const { return text_size_; }
+
+    //! 取JSON文本，是文本时直接复制原文本，为空时返回 "null"
+    std::string dump() const;
+
+    /**
+     * 取解析后的 Json，为空时返回 null
+     *
+     * \throw Json::parse_error   文本不是合法的JSON
+     */
+    const Json& json() const;
+
+  private:
+    const char *text_ptr_ = nullptr;
+    size_t text_size_ = 0;
+    const Json *js_ptr_ = nullptr;
+    mutable Json *sp_parsed_js_ = nullptr;
+};
+
+}
+}
+
+#endif //TBOX_JSONRPC_JSON_VIEW_H_20251019
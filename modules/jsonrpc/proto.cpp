@@ -18,15 +18,278 @@
  * of the source tree.
  */
 #include "proto.h"
+#include "inner_types.h"
+
+#include <cstring>
 #include <tbox/base/json.hpp>
 #include <tbox/base/assert.h>
+#include <tbox/base/catch_throw.h>
 #include <tbox/util/json.h>
 
 namespace tbox {
 namespace jsonrpc {
 
-void Proto::sendRequest(int id, const std::string &method, const Json &js_params)
+namespace {
+
+//! 指向收到的文本中的一段
+struct Span {
+    const char *ptr = nullptr;
+    size_t size = 0;
+
+    bool empty() const { return ptr == nullptr; }
+};
+
+//! 顶层的各字段，缺少的字段为空
+struct Envelope {
+    Span jsonrpc;
+    Span method;
+    Span id;
+    Span params;
+    Span result;
+    Span error;
+};
+
+inline bool IsSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+/**
+ * 扫描JSON对象的顶层字段，只识别结构，不校验值的内容
+ */
+class EnvelopeScanner {
+  public:
+    EnvelopeScanner(const char *text_ptr, size_t text_size) :
+        ptr_(text_ptr), end_(text_ptr + text_size)
+    { }
+
+    //! 遇到不认识的写法，如键中有转义符，也返回false
+    bool scan(Envelope &env);
+
+  private:
+    void skipSpace();
+    bool skipString(bool &has_escape);
+    bool skipValue();
+    Span* findField(Envelope &env, const char *key_ptr, size_t key_size) const;
+
+    const char *ptr_;
+    const char *end_;
+};
+
+void EnvelopeScanner::skipSpace()
+{
+    while (ptr_ != end_ && IsSpace(*ptr_))
+        ++ptr_;
+}
+
+bool EnvelopeScanner::skipString(bool &has_escape)
+{
+    has_escape = false;
+    ++ptr_; //! 跳过 "
+    while (ptr_ != end_) {
+        char ch = *ptr_++;
+        if (ch == '"')
+            return true;
+
+        if (ch == '\\') {
+            has_escape = true;
+            if (ptr_ == end_)
+                return false;
+            ++ptr_;
+        }
+    }
+    return false;
+}
+
+bool EnvelopeScanner::skipValue()
+{
+    if (ptr_ == end_)
+        return false;
+
+    char ch = *ptr_;
+    if (ch == '"') {
+        bool has_escape = false;
+        return skipString(has_escape);
+    }
+
+    if (ch == '{' || ch == '[') {
+        util::json::EndPosFinder finder;
+        int value_size = finder.find(ptr_, end_ - ptr_);
+        if (value_size <= 0)
+            return false;
+        ptr_ += value_size;
+        return true;
+    }
+
+    //! 数字、true、false、null
+    const char *begin = ptr_;
+    while (ptr_ != end_ && *ptr_ != ',' && *ptr_ != '}' && !IsSpace(*ptr_))
+        ++ptr_;
+    return ptr_ != begin;
+}
+
+Span* EnvelopeScanner::findField(Envelope &env, const char *key_ptr, size_t key_size) const
 {
+    struct Field {
+        const char *name;
+        size_t size;
+        Span Envelope::*member;
+    };
+
+    static const Field fields[] = {
+        { "jsonrpc", 7, &Envelope::jsonrpc },
+        { "method", 6, &Envelope::method },
+        { "id", 2, &Envelope::id },
+        { "params", 6, &Envelope::params },
+        { "result", 6, &Envelope::result },
+        { "error", 5, &Envelope::error },
+    };
+
+    for (auto &field : fields) {
+        if (field.size == key_size && ::memcmp(field.name, key_ptr, key_size) == 0)
+            return &(env.*field.member);
+    }
+    return nullptr;
+}
+
+bool EnvelopeScanner::scan(Envelope &env)
+{
+    skipSpace();
+    if (ptr_ == end_ || *ptr_ != '{')
+        return false;
+    ++ptr_;
+
+    skipSpace();
+    if (ptr_ != end_ && *ptr_ == '}') {
+        ++ptr_;
+    } else {
+        for (;;) {
+            skipSpace();
+            if (ptr_ == end_ || *ptr_ != '"')
+                return false;
+
+            const char *key_ptr = ptr_ + 1;
+            bool has_escape = false;
+            if (!skipString(has_escape) || has_escape)
+                return false;
+            size_t key_size = ptr_ - key_ptr - 1;
+
+            skipSpace();
+            if (ptr_ == end_ || *ptr_ != ':')
+                return false;
+            ++ptr_;
+            skipSpace();
+
+            Span value;
+            value.ptr = ptr_;
+            if (!skipValue())
+                return false;
+            value.size = ptr_ - value.ptr;
+
+            auto field = findField(env, key_ptr, key_size);
+            if (field != nullptr)
+                *field = value;
+
+            skipSpace();
+            if (ptr_ == end_)
+                return false;
+
+            char ch = *ptr_++;
+            if (ch == '}')
+                break;
+            if (ch != ',')
+                return false;
+        }
+    }
+
+    skipSpace();
+    return ptr_ == end_;
+}
+
+//! 与 util::json::Get() 相同，但不带转义的字串与较短的整数不经过 Json 对象
+
+/// \throw Json::parse_error
+bool GetString(const Span &span, std::string &value)
+{
+    if (span.size >= 2 && span.ptr[0] == '"' && ::memchr(span.ptr, '\\', span.size) == nullptr) {
+        value.assign(span.ptr + 1, span.size - 2);
+        return true;
+    }
+    return util::json::Get(Json::parse(span.ptr, span.ptr + span.size), value);
+}
+
+bool GetId(const Json &js, int64_t &id)
+{
+    if (!js.is_number_integer())
+        return false;
+    id = js.get<int64_t>();
+    return true;
+}
+
+bool GetIdField(const Json &js, int64_t &id)
+{
+    auto iter = js.find("id");
+    return iter != js.end() && GetId(*iter, id);
+}
+
+/// \throw Json::parse_error
+bool GetId(const Span &span, int64_t &id)
+{
+    const char *ptr = span.ptr;
+    const char *end = span.ptr + span.size;
+    bool is_negative = (ptr != end && *ptr == '-');
+    if (is_negative)
+        ++ptr;
+
+    //! 不超过18位的十进制整数不会溢出
+    if (end > ptr && end - ptr <= 18 && (*ptr != '0' || end - ptr == 1)) {
+        int64_t tmp = 0;
+        for (; ptr != end; ++ptr) {
+            if (*ptr < '0' || *ptr > '9')
+                break;
+            tmp = tmp * 10 + (*ptr - '0');
+        }
+        if (ptr == end) {
+            id = is_negative ? -tmp : tmp;
+            return true;
+        }
+    }
+
+    return GetId(Json::parse(span.ptr, span.ptr + span.size), id);
+}
+
+Json Parse(const Span &span)
+{
+    if (span.empty())
+        return Json();
+    return Json::parse(span.ptr, span.ptr + span.size);
+}
+
+const char * const kResultHead = R"(,"jsonrpc":"2.0","result":)";
+
+}
+
+void Proto::sendRequest(int64_t id, const std::string &method, const Json &js_params)
+{
+    if (isTextMode()) {
+        //! 键的顺序与 Json::dump() 的相同
+        std::string json_text = "{";
+        if (id != 0) {
+            json_text += R"("id":)";
+            json_text += std::to_string(id);
+            json_text += ',';
+        }
+        json_text += R"("jsonrpc":"2.0","method":)";
+        json_text += Json(method).dump();
+        if (!js_params.is_null()) {
+            json_text += R"(,"params":)";
+            json_text += js_params.dump();
+        }
+        json_text += '}';
+        sendMessageText(json_text);
+        return;
+    }
+
     Json js = {
         {"jsonrpc", "2.0"},
         {"method", method}
@@ -38,26 +301,53 @@ void Proto::sendRequest(int id, const std::string &method, const Json &js_params
     if (!js_params.is_null())
         js["params"] = js_params;
 
-    sendJson(js);
+    sendMessage(js);
 }
 
-void Proto::sendRequest(int id, const std::string &method)
+void Proto::sendRequest(int64_t id, const std::string &method)
 {
     sendRequest(id, method, Json());
 }
 
-void Proto::sendResult(int id, const Json &js_result)
+void Proto::sendResult(int64_t id, const Json &js_result)
 {
+    if (isTextMode()) {
+        std::string json_text = R"({"id":)";
+        json_text += std::to_string(id);
+        json_text += kResultHead;
+        json_text += js_result.dump();
+        json_text += '}';
+        sendMessageText(json_text);
+        return;
+    }
+
     Json js = {
         {"jsonrpc", "2.0"},
         {"id", id},
         {"result", js_result}
     };
 
-    sendJson(js);
+    sendMessage(js);
 }
 
-void Proto::sendError(int id, int errcode, const std::string &message)
+void Proto::sendResult(int64_t id, const JsonView &js_result)
+{
+    if (!js_result.isText() || !isTextMode()) {
+        sendResult(id, js_result.json());
+        return;
+    }
+
+    std::string json_text;
+    json_text.reserve(js_result.textSize() + 48);
+    json_text += R"({"id":)";
+    json_text += std::to_string(id);
+    json_text += kResultHead;
+    json_text.append(js_result.text(), js_result.textSize());
+    json_text += '}';
+    sendMessageText(json_text);
+}
+
+void Proto::sendError(int64_t id, int errcode, const std::string &message)
 {
     Json js = {
         {"jsonrpc", "2.0"},
@@ -68,7 +358,28 @@ void Proto::sendError(int id, int errcode, const std::string &message)
     if (!message.empty())
         js["error"]["message"] = message;
 
-    sendJson(js);
+    sendMessage(js);
+}
+
+void Proto::sendResultByWriter(int64_t id, const WriteJsonFunc &write_result)
+{
+    //! 键的顺序与 Json::dump() 的相同
+    std::string json_text;
+    {
+        util::json::Writer writer(json_text);
+        writer.beginObject()
+                .field("id", id)
+                .field("jsonrpc", "2.0")
+                .key("result");
+        write_result(writer);
+        writer.endObject();
+    }
+    sendMessageText(json_text);
+}
+
+void Proto::sendJsonText(const std::string &json_text)
+{
+    sendJson(Json::parse(json_text));
 }
 
 void Proto::setRecvCallback(RecvRequestCallback &&req_cb, RecvRespondCallback &&rsp_cb)
@@ -82,6 +393,87 @@ void Proto::setSendCallback(SendDataCallback &&cb)
     send_data_cb_ = std::move(cb);
 }
 
+void Proto::setRecvRequestViewCallback(RecvRequestViewCallback &&cb)
+{
+    recv_request_view_cb_ = std::move(cb);
+}
+
+Proto::~Proto()
+{
+    delete sp_batch_js_;
+}
+
+void Proto::beginBatch()
+{
+    if (batch_level_++ > 0)
+        return;
+
+    is_batch_text_ = isTextMode();
+    is_batch_array_ = false;
+    batch_count_ = 0;
+}
+
+void Proto::endBatch()
+{
+    TBOX_ASSERT(batch_level_ > 0);
+    if (--batch_level_ > 0 || batch_count_ == 0)
+        return;
+
+    if (is_batch_text_) {
+        std::string json_text;
+        json_text.swap(batch_text_);
+        if (batch_count_ == 1 && !is_batch_array_) {
+            json_text.erase(0, 1);
+        } else {
+            json_text.push_back(']');
+        }
+        sendJsonText(json_text);
+
+    } else {
+        Json js;
+        std::swap(js, *sp_batch_js_);
+        if (batch_count_ == 1 && !is_batch_array_)
+            sendJson(js.front());
+        else
+            sendJson(js);
+    }
+}
+
+void Proto::sendMessage(const Json &js)
+{
+    if (batch_level_ == 0) {
+        sendJson(js);
+        return;
+    }
+
+    if (is_batch_text_) {
+        sendMessageText(js.dump());
+        return;
+    }
+
+    if (sp_batch_js_ == nullptr)
+        sp_batch_js_ = new Json(Json::array());
+    sp_batch_js_->push_back(js);
+    ++batch_count_;
+}
+
+void Proto::sendMessageText(const std::string &json_text)
+{
+    if (batch_level_ == 0) {
+        sendJsonText(json_text);
+        return;
+    }
+
+    if (!is_batch_text_) {
+        sendMessage(Json::parse(json_text));
+        return;
+    }
+
+    batch_text_.push_back(batch_count_ == 0 ? '[' : ',');
+    batch_text_ += json_text;
+    ++batch_count_;
+}
+
 void Proto::onRecvJson(const Json &js)
 {
     if (js.is_object()) {
@@ -93,26 +485,34 @@ void Proto::onRecvJson(const Json &js)
         }
 
         if (js.contains("method")) {
-            if (!recv_request_cb_)
+            if (!recv_request_cb_ && !recv_request_view_cb_)
                 return;
 
             //! 按请求进行处理
             std::string method;
-            int id = 0;
+            int64_t id = 0;
             if (!util::json::GetField(js, "method", method)) {
                 LogNotice("method type not string");
                 return;
             }
-            util::json::GetField(js, "id", id);
-            recv_request_cb_(id, method, js.contains("params") ? js["params"] : Json());
+            GetIdField(js, id);
+
+            if (recv_request_view_cb_) {
+                if (js.contains("params"))
+                    recv_request_view_cb_(id, method, JsonView(js["params"]));
+                else
+                    recv_request_view_cb_(id, method, JsonView());
+            } else {
+                recv_request_cb_(id, method, js.contains("params") ? js["params"] : Json());
+            }
 
         } else if (js.contains("result")) {
             //! 按结果回复进行处理
             if (!recv_respond_cb_)
                 return;
 
-            int id = 0; 
-            if (!util::json::GetField(js, "id", id)) {
+            int64_t id = 0;
+            if (!GetIdField(js, id)) {
                 LogNotice("no method field in respond");
                 return;
             }
@@ -123,8 +523,8 @@ void Proto::onRecvJson(const Json &js)
             if (!recv_respond_cb_)
                 return;
 
-            int id = 0; 
-            util::json::GetField(js, "id", id);
+            int64_t id = 0;
+            GetIdField(js, id);
 
             auto &js_error = js["error"];
             int errcode = 0;
@@ -140,10 +540,127 @@ void Proto::onRecvJson(const Json &js)
         }
 
     } else if (js.is_array()) {
+        //! 空的批量按规范只回复一个错误
+        if (js.empty()) {
+            sendInvalidRequest();
+            return;
+        }
+
+        //! 对批量请求的同步回复也批量发出，按规范即使只有一条也须是数组。
+        //! 批量中的每一项须是对象，其它的回复错误，不递归处理嵌套的数组
+        beginBatch();
+        is_batch_array_ = true;
         for (auto &js_item : js) {
-            onRecvJson(js_item);
+            if (js_item.is_object())
+                onRecvJson(js_item);
+            else
+                sendInvalidRequest();
+        }
+        endBatch();
+    }
+}
+
+void Proto::sendInvalidRequest()
+{
+    //! 无法取得请求的 id，按规范 id 为 null
+    Json js = {
+        {"jsonrpc", "2.0"},
+        {"id", nullptr},
+        {"error", { {"code", ErrorCode::kInvalidRequest } } }
+    };
+    sendMessage(js);
+}
+
+bool Proto::onRecvJsonText(const char *text_ptr, size_t text_size)
+{
+    Envelope env;
+    if (!EnvelopeScanner(text_ptr, text_size).scan(env)) {
+        //! 批量请求或不常见的写法，按完整的JSON处理
+        Json js;
+        if (CatchThrow([&] { js = Json::parse(text_ptr, text_ptr + text_size); }))
+            return false;
+        onRecvJson(js);
+        return true;
+    }
+
+    //! 先取出用到的字段，只有用到的字段才会解析，其内容有误时会抛出异常
+    bool is_request = false;
+    bool is_respond = false;
+    int64_t id = 0;
+    int errcode = 0;
+    std::string method;
+    Json js_value;
+
+    bool is_throw = CatchThrow([&] {
+        std::string version;
+        if (env.jsonrpc.empty() || !GetString(env.jsonrpc, version) || version != "2.0") {
+            LogNotice("no jsonrpc field, or version not match");
+            return;
         }
+
+        if (!env.method.empty()) {
+            if (!recv_request_cb_ && !recv_request_view_cb_)
+                return;
+
+            //! 按请求进行处理
+            if (!GetString(env.method, method)) {
+                LogNotice("method type not string");
+                return;
+            }
+            if (!env.id.empty())
+                GetId(env.id, id);
+
+            if (!recv_request_view_cb_)
+                js_value = Parse(env.params);
+            is_request = true;
+
+        } else if (!env.result.empty()) {
+            //! 按结果回复进行处理
+            if (!recv_respond_cb_)
+                return;
+
+            if (env.id.empty() || !GetId(env.id, id)) {
+                LogNotice("no method field in respond");
+                return;
+            }
+            js_value = Parse(env.result);
+            is_respond = true;
+
+        } else if (!env.error.empty()) {
+            //! 按错误回复进行处理
+            if (!recv_respond_cb_)
+                return;
+
+            if (!env.id.empty())
+                GetId(env.id, id);
+
+            if (!util::json::GetField(Parse(env.error), "code", errcode)) {
+                LogNotice("no code field in error");
+                return;
+            }
+            is_respond = true;
+
+        } else {
+            LogNotice("not jsonrpc format");
+        }
+    });
+
+    if (is_throw)
+        return false;
+
+    if (is_request) {
+        if (!recv_request_view_cb_)
+            recv_request_cb_(id, method, js_value);
+        else if (env.params.empty())
+            recv_request_view_cb_(id, method, JsonView());
+        else
+            recv_request_view_cb_(id, method, JsonView(env.params.ptr, env.params.size));
+
+    } else if (is_respond) {
+        recv_respond_cb_(id, errcode, js_value);
     }
+
+    return true;
 }
 
 }
@@ -20,27 +20,56 @@
 #ifndef TBOX_JSONRPC_PROTO_H_20230812
 #define TBOX_JSONRPC_PROTO_H_20230812
 
+#include <cstdint>
 #include <functional>
 #include <tbox/base/json_fwd.h>
+#include <tbox/util/json_writer.h>
+#include "json_view.h"
 
 namespace tbox {
 namespace jsonrpc {
 
 class Proto {
   public:
-    using RecvRequestCallback = std::function<void(int id, const std::string &method, const Json &params)>;
-    using RecvRespondCallback = std::function<void(int id, int errcode, const Json &result)>;
+    virtual ~Proto();
+
+    using RecvRequestCallback = std::function<void(int64_t id, const std::string &method, const Json &params)>;
+    using RecvRespondCallback = std::function<void(int64_t id, int errcode, const Json &result)>;
     using SendDataCallback = std::function<void(const void* data_ptr, size_t data_size)>;
+    //! params 为未解析的视图，不需要的话就不用解析
+    using RecvRequestViewCallback = std::function<void(int64_t id, const std::string &method, const JsonView &params)>;
+    //! 用 Writer 直接写出JSON，免去构建 Json 对象
+    using WriteJsonFunc = std::function<void(util::json::Writer &writer)>;
 
     void setRecvCallback(RecvRequestCallback &&req_cb, RecvRespondCallback &&rsp_cb);
     void setSendCallback(SendDataCallback &&cb);
+    //! 设置后，收到的请求交给它处理，而不是 RecvRequestCallback
+    void setRecvRequestViewCallback(RecvRequestViewCallback &&cb);
 
   public:
-    void sendRequest(int id, const std::string &method);
-    void sendRequest(int id, const std::string &method, const Json &js_params);
+    void sendRequest(int64_t id, const std::string &method);
+    void sendRequest(int64_t id, const std::string &method, const Json &js_params);
 
-    void sendResult(int id, const Json &js_result);
-    void sendError(int id, int errcode, const std::string &message = "");
+    void sendResult(int64_t id, const Json &js_result);
+    //! js_result 为文本时，须是合法的JSON，直接拼到回复中
+    void sendResult(int64_t id, const JsonView &js_result);
+    void sendError(int64_t id, int errcode, const std::string &message = "");
+    /**
+     * 由 write_result 直接写出 result，适合很大的结果
+     *
+     * 不取名为 sendResult() 的重载，以免 sendResult(id, nullptr) 有歧义
+     */
+    void sendResultByWriter(int64_t id, const WriteJsonFunc &write_result);
+
+    /**
+     * 批量发送
+     *
+     * 在 beginBatch() 与 endBatch() 之间发送的请求与回复不会立即发出，
+     * 而是在 endBatch() 时以JSON数组的形式一次发出。只有一条时不加数组，
+     * 但对收到的批量请求的回复总是数组。可以嵌套
+     */
+    void beginBatch();
+    void endBatch();
 
   public:
     /**
@@ -51,11 +80,41 @@ class Proto {
   protected:
     virtual void sendJson(const Json &js) = 0;
 
+    /**
+     * 文本类的协议重写以下两个函数后，请求与回复直接以字串拼接的方式生成，
+     * 免去构建整个 Json 对象再 dump() 的开销
+     */
+    virtual bool isTextMode() const { return false; }
+    virtual void sendJsonText(const std::string &json_text);
+
     void onRecvJson(const Json &js);
 
+    /**
+     * 处理收到的JSON文本
+     *
+     * 只扫描顶层的 jsonrpc, method, id, params, result, error 字段，不构建整个 Json 对象，
+     * params 以视图的形式交出。不是对象或有不常见的写法时，按完整的JSON解析处理
+     *
+     * \return false    不是合法的JSON
+     */
+    bool onRecvJsonText(const char *text_ptr, size_t text_size);
+
     RecvRequestCallback recv_request_cb_;
     RecvRespondCallback recv_respond_cb_;
     SendDataCallback    send_data_cb_;
+    RecvRequestViewCallback recv_request_view_cb_;
+
+  private:
+    void sendMessage(const Json &js);
+    void sendMessageText(const std::string &json_text);
+    void sendInvalidRequest();
+
+    int batch_level_ = 0;
+    size_t batch_count_ = 0;
+    bool is_batch_text_ = false;
+    bool is_batch_array_ = false;   //!< 含有对收到的批量请求的回复，只有一条时也要加数组
+    std::string batch_text_;
+    Json *sp_batch_js_ = nullptr;
 };
 
 }
@@ -0,0 +1,331 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <chrono>
+#include <iostream>
+#include <gtest/gtest.h>
+#include <tbox/base/json.hpp>
+#include <tbox/base/log_output.h>
+#include <tbox/base/defines.h>
+
+#include "protos/raw_stream_proto.h"
+
+namespace tbox {
+namespace jsonrpc {
+
+namespace {
+class TestProto : public RawStreamProto {
+  public:
+    explicit TestProto(bool is_text_mode = true) : is_text_mode_(is_text_mode) { }
+
+    using Proto::onRecvJson;
+    using Proto::onRecvJsonText;
+
+  protected:
+    virtual bool isTextMode() const override { return is_text_mode_; }
+
+  private:
+    bool is_text_mode_;
+};
+
+bool RecvText(TestProto &proto, const std::string &text)
+{
+    return proto.onRecvJsonText(text.data(), text.size());
+}
+}
+
+TEST(Proto, RecvRequestText) {
+    LogOutput_Enable();
+    TestProto proto;
+
+    int count = 0;
+    int64_t expect_id = 0;
+    std::string expect_method;
+    Json expect_params;
+    proto.setRecvCallback(
+        [&] (int64_t id, const std::string &method, const Json &js_params) {
+            EXPECT_EQ(id, expect_id);
+            EXPECT_EQ(method, expect_method);
+            EXPECT_EQ(js_params, expect_params);
+            ++count;
+        },
+        nullptr
+    );
+
+    expect_id = 12, expect_method = "a", expect_params = {{"x", {1, "}]"}}};
+    EXPECT_TRUE(RecvText(proto, R"( { "params" : {"x":[1,"}]"]}, "jsonrpc":"2.0", "method":"a", "id":12 } )"));
+
+    //! 方法名中有转义符，id 不是整数
+    expect_id = 0, expect_method = "a\"b", expect_params = Json();
+    EXPECT_TRUE(RecvText(proto, R"({"jsonrpc":"2.0","method":"a\"b","id":"12"})"));
+
+    //! 64位的id
+    expect_id = 1099511627776, expect_method = "b", expect_params = Json();
+    EXPECT_TRUE(RecvText(proto, R"({"jsonrpc":"2.0","method":"b","id":1099511627776})"));
+    EXPECT_TRUE(RecvText(proto, R"([{"jsonrpc":"2.0","method":"b","id":1099511627776}])"));
+
+    expect_id = -7, expect_method = "c", expect_params = {1, 2};
+    EXPECT_TRUE(RecvText(proto, R"({"id":-7,"jsonrpc":"2.0","method":"c","params":[1,2],"unknown":{"a":null}})"));
+
+    //! 批量请求，按完整的JSON处理
+    expect_id = 1, expect_method = "d", expect_params = Json();
+    EXPECT_TRUE(RecvText(proto, R"([{"id":1,"jsonrpc":"2.0","method":"d"},{"id":1,"jsonrpc":"2.0","method":"d"}])"));
+    EXPECT_EQ(count, 7);
+
+    //! 版本不对，或缺少方法，不处理
+    EXPECT_TRUE(RecvText(proto, R"({"id":1,"jsonrpc":"1.0","method":"d"})"));
+    EXPECT_TRUE(RecvText(proto, R"({"id":1,"jsonrpc":"2.0","method":1})"));
+    EXPECT_EQ(count, 7);
+
+    //! 不合法的JSON
+    EXPECT_FALSE(RecvText(proto, R"({"id":1,"jsonrpc":"2.0","method":"d",})"));
+    EXPECT_FALSE(RecvText(proto, R"({"id":1,"jsonrpc":"2.0","method":"d","params":[1,}]})"));
+    EXPECT_FALSE(RecvText(proto, R"({"id":1x,"jsonrpc":"2.0","method":"d"})"));
+    EXPECT_EQ(count, 7);
+
+    LogOutput_Disable();
+}
+
+TEST(Proto, RecvRequestView) {
+    TestProto proto;
+
+    int count = 0;
+    proto.setRecvRequestViewCallback(
+        [&] (int id, const std::string &method, const JsonView &js_params) {
+            EXPECT_EQ(id, 3);
+            EXPECT_EQ(method, "a");
+            if (js_params.isText()) {
+                EXPECT_EQ(std::string(js_params.text(), js_params.textSize()), R"([1, {"b":2}])");
+                EXPECT_EQ(js_params.json(), Json::parse(R"([1,{"b":2}])"));
+            } else {
+                EXPECT_TRUE(js_params.empty());
+                EXPECT_TRUE(js_params.json().is_null());
+            }
+            ++count;
+        }
+    );
+
+    EXPECT_TRUE(RecvText(proto, R"({"id":3,"jsonrpc":"2.0","method":"a","params":[1, {"b":2}]})"));
+    EXPECT_TRUE(RecvText(proto, R"({"id":3,"jsonrpc":"2.0","method":"a"})"));
+    EXPECT_EQ(count, 2);
+}
+
+TEST(Proto, RecvRespondText) {
+    TestProto proto;
+
+    int count = 0;
+    proto.setRecvCallback(nullptr,
+        [&] (int id, int errcode, const Json &js_result) {
+            EXPECT_EQ(id, 5);
+            if (errcode == 0)
+                EXPECT_EQ(js_result, Json::parse(R"({"a":[1,2]})"));
+            else
+                EXPECT_EQ(errcode, -32601);
+            ++count;
+        }
+    );
+
+    EXPECT_TRUE(RecvText(proto, R"({"id":5,"jsonrpc":"2.0","result":{"a":[1,2]}})"));
+    EXPECT_TRUE(RecvText(proto, R"({"id":5,"jsonrpc":"2.0","error":{"code":-32601,"message":"x"}})"));
+    EXPECT_EQ(count, 2);
+}
+
+//! 拼接出的文本与原来构建 Json 对象再 dump() 的相同
+TEST(Proto, SendTextSameAsJson) {
+    Json js_params = {{"a", 1}, {"b", {"x", "\"y\""}}};
+
+    for (int i = 0; i < 2; ++i) {
+        TestProto text_proto(true), json_proto(false);
+        std::string text, json;
+        text_proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { text.assign(static_cast<const char*>(data_ptr), data_size); });
+        json_proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { json.assign(static_cast<const char*>(data_ptr), data_size); });
+
+        int id = i;
+        text_proto.sendRequest(id, "me\"thod", js_params);
+        json_proto.sendRequest(id, "me\"thod", js_params);
+        EXPECT_EQ(text, json);
+
+        text_proto.sendRequest(id, "method");
+        json_proto.sendRequest(id, "method");
+        EXPECT_EQ(text, json);
+
+        text_proto.sendResult(id + 1, js_params);
+        json_proto.sendResult(id + 1, js_params);
+        EXPECT_EQ(text, json);
+
+        const std::string result_text = js_params.dump();
+        text_proto.sendResult(id + 1, JsonView(result_text.data(), result_text.size()));
+        EXPECT_EQ(text, json);
+        json_proto.sendResult(id + 1, JsonView(result_text.data(), result_text.size()));
+        EXPECT_EQ(text, json);
+    }
+}
+
+TEST(Proto, Batch) {
+    for (int i = 0; i < 2; ++i) {
+        TestProto proto(i == 0);
+
+        std::vector<std::string> sent;
+        proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { sent.emplace_back(static_cast<const char*>(data_ptr), data_size); });
+
+        //! 只有一条时不加数组
+        proto.beginBatch();
+        proto.sendResult(1, Json(1));
+        proto.endBatch();
+        ASSERT_EQ(sent.size(), 1u);
+        EXPECT_EQ(Json::parse(sent.back()), Json::parse(R"({"id":1,"jsonrpc":"2.0","result":1})"));
+
+        proto.beginBatch();
+        proto.beginBatch();
+        proto.sendRequest(0, "a");
+        proto.endBatch();
+        proto.sendError(2, -1);
+        EXPECT_EQ(sent.size(), 1u);
+        proto.endBatch();
+        ASSERT_EQ(sent.size(), 2u);
+        EXPECT_EQ(Json::parse(sent.back()), Json::parse(R"([{"jsonrpc":"2.0","method":"a"},{"id":2,"jsonrpc":"2.0","error":{"code":-1}}])"));
+
+        //! 空的批量不发送
+        proto.beginBatch();
+        proto.endBatch();
+        EXPECT_EQ(sent.size(), 2u);
+    }
+}
+
+//! 批量中的非对象项回复 Invalid Request，嵌套很深的数组不能导致栈溢出
+TEST(Proto, RecvBatchInvalidItems) {
+    for (int i = 0; i < 2; ++i) {
+        TestProto proto(i == 0);
+
+        std::vector<std::string> sent;
+        proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { sent.emplace_back(static_cast<const char*>(data_ptr), data_size); });
+        proto.setRecvCallback(
+            [&] (int64_t id, const std::string &, const Json &) { proto.sendResult(id, Json(1)); },
+            nullptr
+        );
+
+        EXPECT_TRUE(RecvText(proto, "[]"));
+        ASSERT_EQ(sent.size(), 1u);
+        EXPECT_EQ(Json::parse(sent.back()), Json::parse(R"({"id":null,"jsonrpc":"2.0","error":{"code":-32600}})"));
+
+        EXPECT_TRUE(RecvText(proto, R"([1,[{"jsonrpc":"2.0","id":2,"method":"a"}],{"jsonrpc":"2.0","id":3,"method":"a"}])"));
+        ASSERT_EQ(sent.size(), 2u);
+        EXPECT_EQ(Json::parse(sent.back()), Json::parse(R"([
+            {"id":null,"jsonrpc":"2.0","error":{"code":-32600}},
+            {"id":null,"jsonrpc":"2.0","error":{"code":-32600}},
+            {"id":3,"jsonrpc":"2.0","result":1}
+        ])"));
+
+        std::string deep_text = std::string(20000, '[') + std::string(20000, ']');
+        EXPECT_TRUE(RecvText(proto, deep_text));
+        ASSERT_EQ(sent.size(), 3u);
+        EXPECT_EQ(Json::parse(sent.back()), Json::parse(R"([{"id":null,"jsonrpc":"2.0","error":{"code":-32600}}])"));
+    }
+}
+
+//! 对收到的批量请求，即使只有一条回复也须是数组
+TEST(Proto, RecvBatchOfOne) {
+    for (int i = 0; i < 2; ++i) {
+        TestProto proto(i == 0);
+
+        std::vector<std::string> sent;
+        proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { sent.emplace_back(static_cast<const char*>(data_ptr), data_size); });
+        proto.setRecvCallback(
+            [&] (int64_t id, const std::string &, const Json &) { proto.sendResult(id, Json(1)); },
+            nullptr
+        );
+
+        EXPECT_TRUE(RecvText(proto, R"([{"jsonrpc":"2.0","id":1,"method":"a"}])"));
+        ASSERT_EQ(sent.size(), 1u);
+        EXPECT_EQ(Json::parse(sent.back()), Json::parse(R"([{"id":1,"jsonrpc":"2.0","result":1}])"));
+
+        //! 嵌套在本地的批量中时也一样
+        proto.beginBatch();
+        EXPECT_TRUE(RecvText(proto, R"([{"jsonrpc":"2.0","id":2,"method":"a"}])"));
+        proto.endBatch();
+        ASSERT_EQ(sent.size(), 2u);
+        EXPECT_EQ(Json::parse(sent.back()), Json::parse(R"([{"id":2,"jsonrpc":"2.0","result":1}])"));
+
+        //! 之后本地的批量只有一条时仍不加数组
+        proto.beginBatch();
+        proto.sendResult(3, Json(1));
+        proto.endBatch();
+        ASSERT_EQ(sent.size(), 3u);
+        EXPECT_EQ(Json::parse(sent.back()), Json::parse(R"({"id":3,"jsonrpc":"2.0","result":1})"));
+    }
+}
+
+//! 比较构建整个 Json 对象与只扫描顶层字段的耗时
+TEST(Proto, BenchmarkEnvelope) {
+    Json js_params = Json::array();
+    for (int i = 0; i < 100; ++i)
+        js_params.push_back({{"id", i}, {"name", "item_" + std::to_string(i)}, {"value", i * 1.5}, {"tags", {1, 2, 3}}});
+
+    std::string request_text;
+    TestProto proto;
+    proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { request_text.assign(static_cast<const char*>(data_ptr), data_size); });
+    proto.sendRequest(1, "test", js_params);
+
+    const int kTimes = 1000;
+    int count = 0;
+
+    auto print_cost = [] (const char *name, std::chrono::steady_clock::time_point start_ts) {
+        auto cost = std::chrono::steady_clock::now() - start_ts;
+        std::cout << name << " cost: " << std::chrono::duration_cast<std::chrono::microseconds>(cost).count() << " us" << std::endl;
+    };
+
+    proto.setRecvCallback([&] (int, const std::string &, const Json &) { ++count; }, nullptr);
+    auto start_ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i)
+        proto.onRecvJson(Json::parse(request_text));
+    print_cost("recv dom", start_ts);
+
+    start_ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i)
+        RecvText(proto, request_text);
+    print_cost("recv envelope, parse params", start_ts);
+
+    proto.setRecvRequestViewCallback([&] (int, const std::string &, const JsonView &) { ++count; });
+    start_ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i)
+        RecvText(proto, request_text);
+    print_cost("recv envelope, params view", start_ts);
+    EXPECT_EQ(count, kTimes * 3);
+
+    TestProto json_proto(false);
+    json_proto.setSendCallback([] (const void *, size_t) { });
+    start_ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i)
+        json_proto.sendResult(i, js_params);
+    print_cost("send dom", start_ts);
+
+    start_ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i)
+        proto.sendResult(i, js_params);
+    print_cost("send concat", start_ts);
+
+    const std::string result_text = js_params.dump();
+    start_ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i)
+        proto.sendResult(i, JsonView(result_text.data(), result_text.size()));
+    print_cost("send encoded", start_ts);
+}
+
+}
+}
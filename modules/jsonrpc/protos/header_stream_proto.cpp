@@ -21,62 +21,79 @@
 
 #include <tbox/base/log.h>
 #include <tbox/base/json.hpp>
-#include <tbox/base/catch_throw.h>
 #include <tbox/util/json.h>
-#include <tbox/util/serializer.h>
+#include <tbox/util/struct_serializer.h>
 #include <tbox/base/assert.h>
+#include <cstring>
 
 namespace tbox {
 namespace jsonrpc {
 
+namespace {
 const uint16_t kHeadMagic = 0xCAFE;
 const uint16_t kHeadSize = 6;   //! HeadMagic(2) + ContentLength(4)
+const size_t kMaxKeepBuffSize = 64 << 10;   //! 发送缓冲超过该大小就在发送后释放
 
-void HeaderStreamProto::sendJson(const Json &js)
-{
-    const auto &json_text = js.dump();
+struct Head {
+    uint16_t magic;
+    uint32_t content_size;
 
-    std::vector<uint8_t> buff;
-    util::Serializer pack(buff);
+    template <typename Archive>
+    void schema(Archive &ar) { ar(magic, content_size); }
+};
+}
 
-    pack << kHeadMagic << static_cast<uint32_t>(json_text.size());
-    pack.append(json_text.data(), json_text.size());
+void HeaderStreamProto::sendJson(const Json &js)
+{
+    sendJsonText(js.dump());
+}
 
-    if (send_data_cb_)
+void HeaderStreamProto::sendJsonText(const std::string &json_text)
+{
+    //! 在发送回调中又发送时，send_buff_ 还在使用，只能另外分配
+    std::vector<uint8_t> tmp_buff;
+    auto &buff = is_sending_ ? tmp_buff : send_buff_;
+
+    Head head = { kHeadMagic, static_cast<uint32_t>(json_text.size()) };
+    buff.resize(kHeadSize + json_text.size());
+    util::SerializeStruct(head, buff.data(), kHeadSize);
+    memcpy(buff.data() + kHeadSize, json_text.data(), json_text.size());
+
+    if (send_data_cb_) {
+        bool is_sending = is_sending_;
+        is_sending_ = true;
         send_data_cb_(buff.data(), buff.size());
+        is_sending_ = is_sending;
+    }
+
+    //! 偶尔的大包不要一直占着内存
+    if (!is_sending_ && send_buff_.capacity() > kMaxKeepBuffSize)
+        std::vector<uint8_t>().swap(send_buff_);
 }
 
 ssize_t HeaderStreamProto::onRecvData(const void *data_ptr, size_t data_size)
 {
     TBOX_ASSERT(data_ptr != nullptr);
 
-    if (data_size < kHeadSize)
+    Head head;
+    if (util::DeserializeStruct(head, data_ptr, data_size) == 0)
         return 0;
 
-    util::Deserializer unpack(data_ptr, data_size);
-
-    uint16_t header_magic = 0;
-    uint32_t content_size = 0;
-    unpack >> header_magic >> content_size; 
-
-    if (header_magic != kHeadMagic) {
+    if (head.magic != kHeadMagic) {
         LogNotice("head magic mismatch");
         return -2;
     }
 
-    if (content_size + kHeadSize > data_size)   //! 不够
+    size_t packet_size = kHeadSize + static_cast<size_t>(head.content_size);
+    if (packet_size > data_size)   //! 不够
         return 0;
 
-    const char *str_ptr = static_cast<const char*>(unpack.fetchNoCopy(content_size));
-    Json js;
-    bool is_throw = tbox::CatchThrow([&] { js = Json::parse(str_ptr, str_ptr + content_size); });
-    if (is_throw) {
+    const char *str_ptr = static_cast<const char*>(data_ptr) + kHeadSize;
+    if (!onRecvJsonText(str_ptr, head.content_size)) {
         LogNotice("parse json fail");
         return -1;
     }
-
-    onRecvJson(js);
-    return unpack.pos();
+    return packet_size;
 }
 
 }
@@ -20,6 +20,7 @@
 #ifndef TBOX_JSONRPC_HEADER_STREAM_PROTO_H_20230812
 #define TBOX_JSONRPC_HEADER_STREAM_PROTO_H_20230812
 
+#include <vector>
 #include "../proto.h"
 
 namespace tbox {
@@ -44,6 +45,12 @@ class HeaderStreamProto : public Proto {
 
   protected:
     virtual void sendJson(const Json &js) override;
+    virtual bool isTextMode() const override { return true; }
+    virtual void sendJsonText(const std::string &json_text) override;
+
+  private:
+    std::vector<uint8_t> send_buff_;    //!< 重复使用，不必每次发送都分配
+    bool is_sending_ = false;
 };
 
 }
@@ -0,0 +1,475 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "msgpack_proto.h"
+
+#include <cctype>
+#include <cstring>
+#include <tbox/base/log.h>
+#include <tbox/base/json.hpp>
+#include <tbox/util/serializer.h>
+#include <tbox/base/assert.h>
+
+namespace tbox {
+namespace jsonrpc {
+
+namespace {
+const uint16_t kMsgPackMagic = 0xCAFB;
+const uint16_t kTextMagic = 0xCAFE;
+const uint16_t kHeadSize = 6;   //! HeadMagic(2) + ContentLength(4)
+const int kMaxDepth = 256;      //! 解码时允许的最大嵌套层数
+
+/**
+ * 直接在 Json 与 MessagePack 之间编解码
+ *
+ * 没有用 Json::to_msgpack() 与 Json::from_msgpack()，它们逐字节经过虚函数与 SAX 回调，
+ * 比 dump() 与 parse() 快不了多少
+ */
+template <typename T>
+inline void PutBig(std::vector<uint8_t> &buff, T value)
+{
+    for (int i = sizeof(T) - 1; i >= 0; --i)
+        buff.push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+void PutHead(std::vector<uint8_t> &buff, uint8_t code8, uint8_t code16, uint8_t code32, size_t size)
+{
+    if (size <= 0xff && code8 != 0) {
+        buff.push_back(code8);
+        buff.push_back(static_cast<uint8_t>(size));
+    } else if (size <= 0xffff) {
+        buff.push_back(code16);
+        PutBig(buff, static_cast<uint16_t>(size));
+    } else {
+        buff.push_back(code32);
+        PutBig(buff, static_cast<uint32_t>(size));
+    }
+}
+
+void PutUnsigned(std::vector<uint8_t> &buff, uint64_t value)
+{
+    if (value < 0x80) {
+        buff.push_back(static_cast<uint8_t>(value));
+    } else if (value <= 0xff) {
+        buff.push_back(0xcc);
+        buff.push_back(static_cast<uint8_t>(value));
+    } else if (value <= 0xffff) {
+        buff.push_back(0xcd);
+        PutBig(buff, static_cast<uint16_t>(value));
+    } else if (value <= 0xffffffff) {
+        buff.push_back(0xce);
+        PutBig(buff, static_cast<uint32_t>(value));
+    } else {
+        buff.push_back(0xcf);
+        PutBig(buff, value);
+    }
+}
+
+void PutSigned(std::vector<uint8_t> &buff, int64_t value)
+{
+    if (value >= 0) {
+        PutUnsigned(buff, value);
+    } else if (value >= -32) {
+        buff.push_back(static_cast<uint8_t>(value));
+    } else if (value >= INT8_MIN) {
+        buff.push_back(0xd0);
+        buff.push_back(static_cast<uint8_t>(value));
+    } else if (value >= INT16_MIN) {
+        buff.push_back(0xd1);
+        PutBig(buff, static_cast<uint16_t>(value));
+    } else if (value >= INT32_MIN) {
+        buff.push_back(0xd2);
+        PutBig(buff, static_cast<uint32_t>(value));
+    } else {
+        buff.push_back(0xd3);
+        PutBig(buff, static_cast<uint64_t>(value));
+    }
+}
+
+void PutString(std::vector<uint8_t> &buff, const std::string &str)
+{
+    if (str.size() < 32)
+        buff.push_back(static_cast<uint8_t>(0xa0 | str.size()));
+    else
+        PutHead(buff, 0xd9, 0xda, 0xdb, str.size());
+    buff.insert(buff.end(), str.begin(), str.end());
+}
+
+void Encode(std::vector<uint8_t> &buff, const Json &js)
+{
+    switch (js.type()) {
+        case Json::value_t::boolean:
+            buff.push_back(js.get<bool>() ? 0xc3 : 0xc2);
+            break;
+
+        case Json::value_t::number_integer:
+            PutSigned(buff, js.get<int64_t>());
+            break;
+
+        case Json::value_t::number_unsigned:
+            PutUnsigned(buff, js.get<uint64_t>());
+            break;
+
+        case Json::value_t::number_float: {
+            double value = js.get<double>();
+            uint64_t bits = 0;
+            ::memcpy(&bits, &value, sizeof(bits));
+            buff.push_back(0xcb);
+            PutBig(buff, bits);
+            break;
+        }
+
+        case Json::value_t::string:
+            PutString(buff, js.get_ref<const std::string&>());
+            break;
+
+        case Json::value_t::binary: {
+            auto &bin = js.get_binary();
+            PutHead(buff, 0xc4, 0xc5, 0xc6, bin.size());
+            buff.insert(buff.end(), bin.begin(), bin.end());
+            break;
+        }
+
+        case Json::value_t::array:
+            if (js.size() < 16)
+                buff.push_back(static_cast<uint8_t>(0x90 | js.size()));
+            else
+                PutHead(buff, 0, 0xdc, 0xdd, js.size());
+            for (auto &js_item : js)
+                Encode(buff, js_item);
+            break;
+
+        case Json::value_t::object:
+            if (js.size() < 16)
+                buff.push_back(static_cast<uint8_t>(0x80 | js.size()));
+            else
+                PutHead(buff, 0, 0xde, 0xdf, js.size());
+            for (auto &item : js.items()) {
+                PutString(buff, item.key());
+                Encode(buff, item.value());
+            }
+            break;
+
+        default:
+            buff.push_back(0xc0);
+            break;
+    }
+}
+
+class Decoder {
+  public:
+    Decoder(const uint8_t *begin, const uint8_t *end) : ptr_(begin), end_(end) { }
+
+    //! 须恰好用完全部数据
+    bool decode(Json &js) { return decodeValue(js, 0) && ptr_ == end_; }
+
+  private:
+    template <typename T>
+    bool getBig(T &value)
+    {
+        if (static_cast<size_t>(end_ - ptr_) < sizeof(T))
+            return false;
+        uint64_t tmp = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            tmp = (tmp << 8) | *ptr_++;
+        value = static_cast<T>(tmp);
+        return true;
+    }
+
+    template <typename T>
+    bool getSize(size_t &size)
+    {
+        T value = 0;
+        if (!getBig(value))
+            return false;
+        size = value;
+        return true;
+    }
+
+    bool getString(size_t size, std::string &str)
+    {
+        if (static_cast<size_t>(end_ - ptr_) < size)
+            return false;
+        str.assign(reinterpret_cast<const char*>(ptr_), size);
+        ptr_ += size;
+        return true;
+    }
+
+    bool getStringSize(uint8_t code, size_t &size)
+    {
+        if ((code & 0xe0) == 0xa0) {
+            size = code & 0x1f;
+            return true;
+        }
+        switch (code) {
+            case 0xd9: return getSize<uint8_t>(size);
+            case 0xda: return getSize<uint16_t>(size);
+            case 0xdb: return getSize<uint32_t>(size);
+            default:   return false;
+        }
+    }
+
+    bool decodeArray(size_t size, Json &js, int depth)
+    {
+        //! 每个元素至少占一个字节，防止被伪造的长度骗去分配大量内存
+        if (static_cast<size_t>(end_ - ptr_) < size)
+            return false;
+
+        js = Json::array();
+        auto &array = js.get_ref<Json::array_t&>();
+        array.resize(size);
+        for (auto &js_item : array) {
+            if (!decodeValue(js_item, depth + 1))
+                return false;
+        }
+        return true;
+    }
+
+    bool decodeObject(size_t size, Json &js, int depth)
+    {
+        if (static_cast<size_t>(end_ - ptr_) < size * 2)
+            return false;
+
+        js = Json::object();
+        auto &object = js.get_ref<Json::object_t&>();
+        std::string key;
+        for (size_t i = 0; i < size; ++i) {
+            size_t key_size = 0;
+            if (ptr_ == end_ || !getStringSize(*ptr_++, key_size) || !getString(key_size, key))
+                return false;
+            if (!decodeValue(object[std::move(key)], depth + 1))
+                return false;
+        }
+        return true;
+    }
+
+    bool decodeValue(Json &js, int depth)
+    {
+        if (ptr_ == end_ || depth > kMaxDepth)
+            return false;
+
+        uint8_t code = *ptr_++;
+        if (code < 0x80) {
+            js = code;
+            return true;
+        } else if (code >= 0xe0) {
+            js = static_cast<int8_t>(code);
+            return true;
+        } else if ((code & 0xf0) == 0x80) {
+            return decodeObject(code & 0x0f, js, depth);
+        } else if ((code & 0xf0) == 0x90) {
+            return decodeArray(code & 0x0f, js, depth);
+        }
+
+        size_t size = 0;
+        switch (code) {
+            case 0xc0: js = nullptr; return true;
+            case 0xc2: js = false; return true;
+            case 0xc3: js = true; return true;
+
+            case 0xcc: { uint8_t  v; if (!getBig(v)) return false; js = v; return true; }
+            case 0xcd: { uint16_t v; if (!getBig(v)) return false; js = v; return true; }
+            case 0xce: { uint32_t v; if (!getBig(v)) return false; js = v; return true; }
+            case 0xcf: { uint64_t v; if (!getBig(v)) return false; js = v; return true; }
+            case 0xd0: { int8_t   v; if (!getBig(v)) return false; js = v; return true; }
+            case 0xd1: { int16_t  v; if (!getBig(v)) return false; js = v; return true; }
+            case 0xd2: { int32_t  v; if (!getBig(v)) return false; js = v; return true; }
+            case 0xd3: { int64_t  v; if (!getBig(v)) return false; js = v; return true; }
+
+            case 0xca: {
+                uint32_t bits;
+                if (!getBig(bits))
+                    return false;
+                float value;
+                ::memcpy(&value, &bits, sizeof(value));
+                js = value;
+                return true;
+            }
+            case 0xcb: {
+                uint64_t bits;
+                if (!getBig(bits))
+                    return false;
+                double value;
+                ::memcpy(&value, &bits, sizeof(value));
+                js = value;
+                return true;
+            }
+
+            case 0xc4:
+            case 0xc5:
+            case 0xc6: {
+                if (!(code == 0xc4 ? getSize<uint8_t>(size) : code == 0xc5 ? getSize<uint16_t>(size) : getSize<uint32_t>(size)))
+                    return false;
+                if (static_cast<size_t>(end_ - ptr_) < size)
+                    return false;
+                js = Json::binary(std::vector<uint8_t>(ptr_, ptr_ + size));
+                ptr_ += size;
+                return true;
+            }
+
+            case 0xdc: return getSize<uint16_t>(size) && decodeArray(size, js, depth);
+            case 0xdd: return getSize<uint32_t>(size) && decodeArray(size, js, depth);
+            case 0xde: return getSize<uint16_t>(size) && decodeObject(size, js, depth);
+            case 0xdf: return getSize<uint32_t>(size) && decodeObject(size, js, depth);
+
+            default: {
+                //! 剩下的只有字串，扩展类型不支持
+                std::string str;
+                if (!getStringSize(code, size) || !getString(size, str))
+                    return false;
+                js = std::move(str);
+                return true;
+            }
+        }
+    }
+
+    const uint8_t *ptr_;
+    const uint8_t *end_;
+};
+}
+
+void MsgPackProto::sendJson(const Json &js)
+{
+    if (send_format_ != Format::kMsgPack) {
+        sendJsonText(js.dump());
+        return;
+    }
+
+    if (!send_data_cb_)
+        return;
+
+    //! 先占住头部，内容直接编码到其后，最后再回填长度
+    std::vector<uint8_t> buff(kHeadSize);
+    Encode(buff, js);
+
+    util::Serializer pack(buff.data(), kHeadSize);
+    pack << kMsgPackMagic << static_cast<uint32_t>(buff.size() - kHeadSize);
+
+    send_data_cb_(buff.data(), buff.size());
+}
+
+void MsgPackProto::sendJsonText(const std::string &json_text)
+{
+    if (send_format_ == Format::kMsgPack) {
+        sendJson(Json::parse(json_text));
+        return;
+    }
+
+    if (!send_data_cb_)
+        return;
+
+    if (send_format_ == Format::kRawText) {
+        send_data_cb_(json_text.data(), json_text.size());
+        return;
+    }
+
+    std::vector<uint8_t> buff;
+    buff.reserve(kHeadSize + json_text.size());
+    util::Serializer pack(buff);
+    pack << kTextMagic << static_cast<uint32_t>(json_text.size());
+    pack.append(json_text.data(), json_text.size());
+
+    send_data_cb_(buff.data(), buff.size());
+}
+
+ssize_t MsgPackProto::onRecvData(const void *data_ptr, size_t data_size)
+{
+    TBOX_ASSERT(data_ptr != nullptr);
+
+    if (data_size < 2)
+        return 0;
+
+    util::Deserializer unpack(data_ptr, data_size);
+    uint16_t header_magic = 0;
+    unpack >> header_magic;
+
+    if (header_magic != kMsgPackMagic && header_magic != kTextMagic)
+        return onRecvRawText(static_cast<const char*>(data_ptr), data_size);
+
+    if (data_size < kHeadSize)
+        return 0;
+
+    uint32_t content_size = 0;
+    unpack >> content_size;
+    //! 须以 size_t 计算，否则很大的 content_size 会回绕而通过检查
+    if (kHeadSize + static_cast<size_t>(content_size) > data_size)   //! 不够
+        return 0;
+
+    const void *content_ptr = unpack.fetchNoCopy(content_size);
+    if (content_ptr == nullptr) {
+        LogNotice("fetch content fail");
+        return -1;
+    }
+    if (header_magic == kTextMagic) {
+        send_format_ = Format::kHeaderText;
+        if (!onRecvJsonText(static_cast<const char*>(content_ptr), content_size)) {
+            LogNotice("parse json fail");
+            return -1;
+        }
+        return unpack.pos();
+    }
+
+    const uint8_t *bytes_ptr = static_cast<const uint8_t*>(content_ptr);
+    Json js;
+    if (!Decoder(bytes_ptr, bytes_ptr + content_size).decode(js)) {
+        LogNotice("parse content fail");
+        return -1;
+    }
+
+    send_format_ = Format::kMsgPack;
+    onRecvJson(js);
+    return unpack.pos();
+}
+
+ssize_t MsgPackProto::onRecvRawText(const char *str_ptr, size_t str_len)
+{
+    //! 文本只接受 [...] {...}，以便尽早发现错误的数据
+    for (size_t i = 0; i < str_len; ++i) {
+        char ch = str_ptr[i];
+        if (ch == '{' || ch == '[')
+            break;
+
+        if (!::isspace(static_cast<unsigned char>(ch))) {
+            LogNotice("head magic mismatch, and not json text");
+            return -2;
+        }
+    }
+
+    auto json_len = end_pos_finder_.find(str_ptr, str_len);
+    if (json_len < 0) {
+        end_pos_finder_.reset();
+        LogNotice("[] {} not match");
+        return -1;
+    }
+
+    if (json_len == 0)
+        return 0;
+
+    end_pos_finder_.reset();
+
+    send_format_ = Format::kRawText;
+    if (!onRecvJsonText(str_ptr, json_len)) {
+        LogNotice("parse json fail");
+        return -1;
+    }
+    return json_len;
+}
+
+}
+}
@@ -0,0 +1,78 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_JSONRPC_MSGPACK_PROTO_H_20251019
+#define TBOX_JSONRPC_MSGPACK_PROTO_H_20251019
+
+#include <tbox/util/json.h>
+#include "../proto.h"
+
+namespace tbox {
+namespace jsonrpc {
+
+/**
+ * MessagePack 流协议
+ *
+ * +--------+--------+---------------+
+ * | 0xCAFB | Length |  MessagePack  |
+ * +--------+--------+---------------+
+ * |   2B   |   4B   |     Length    |
+ * +--------+--------+---------------+
+ *
+ * 与 HeaderStreamProto 的界定方式相同，只是内容为 MessagePack 编码，
+ * 免去了JSON文本的生成与解析
+ *
+ * 接收时同时兼容 HeaderStreamProto 与 RawStreamProto 格式的文本数据包，
+ * 发送时采用对端最近一次所用的格式。这样用 nc 之类的工具直接输入JSON文本调试时，
+ * 得到的回复也是文本。
+ *
+ * 适用于流式协议，如 TCP
+ */
+class MsgPackProto : public Proto {
+  public:
+    enum class Format {
+        kMsgPack,       //!< 0xCAFB + 长度 + MessagePack
+        kHeaderText,    //!< 0xCAFE + 长度 + JSON文本，同 HeaderStreamProto
+        kRawText,       //!< JSON文本，同 RawStreamProto
+    };
+
+    explicit MsgPackProto(Format send_format = Format::kMsgPack) : send_format_(send_format) { }
+
+    //! 设置发送格式，收到对端的数据包后会跟随对端的格式
+    void setSendFormat(Format send_format) { send_format_ = send_format; }
+    Format sendFormat() const { return send_format_; }
+
+    virtual ssize_t onRecvData(const void *data_ptr, size_t data_size) override;
+
+  protected:
+    virtual void sendJson(const Json &js) override;
+    virtual bool isTextMode() const override { return send_format_ != Format::kMsgPack; }
+    virtual void sendJsonText(const std::string &json_text) override;
+
+  private:
+    ssize_t onRecvRawText(const char *str_ptr, size_t str_len);
+
+    Format send_format_;
+    util::json::EndPosFinder end_pos_finder_;
+};
+
+}
+}
+
+#endif //TBOX_JSONRPC_MSGPACK_PROTO_H_20251019
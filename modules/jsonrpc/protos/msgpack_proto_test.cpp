@@ -0,0 +1,281 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <chrono>
+#include <iostream>
+#include <gtest/gtest.h>
+#include <tbox/base/json.hpp>
+#include <tbox/base/log_output.h>
+#include <tbox/base/defines.h>
+
+#include "msgpack_proto.h"
+#include "raw_stream_proto.h"
+#include "header_stream_proto.h"
+#include "packet_proto.h"
+
+namespace tbox {
+namespace jsonrpc {
+
+TEST(MsgPackProto, sendRequestWithParams) {
+    Json js_send_params = {
+        {"a", 123},
+        {"b", {"hello", "world", "!"}},
+        {"c", -1.5},
+    };
+    LogOutput_Enable();
+
+    MsgPackProto proto;
+
+    int count = 0;
+    proto.setRecvCallback(
+        [&] (int id, const std::string &method, const Json &js_params) {
+            EXPECT_EQ(id, 1);
+            EXPECT_EQ(method, "test");
+            EXPECT_EQ(js_params, js_send_params);
+            ++count;
+        },
+        [&] (int id, int errcode, const Json &js_result) { ++count; UNUSED_VAR(id), UNUSED_VAR(errcode), UNUSED_VAR(js_result); }
+    );
+    proto.setSendCallback(
+        [&] (const void *data_ptr, size_t data_size) {
+            auto bytes = static_cast<const uint8_t*>(data_ptr);
+            EXPECT_EQ(bytes[0], 0xCA);
+            EXPECT_EQ(bytes[1], 0xFB);
+            EXPECT_EQ(proto.onRecvData(data_ptr, data_size), data_size);
+        }
+    );
+
+    proto.sendRequest(1, "test", js_send_params);
+    EXPECT_EQ(count, 1);
+
+    LogOutput_Disable();
+}
+
+TEST(MsgPackProto, sendResultAndError) {
+    Json js_send_result = {
+        {"a", 123},
+        {"b", {"hello", "world", "!"}},
+    };
+    LogOutput_Enable();
+
+    MsgPackProto proto;
+
+    int count = 0;
+    proto.setRecvCallback(
+        [&] (int id, const std::string &method, const Json &js_params) { ++count; UNUSED_VAR(id), UNUSED_VAR(method), UNUSED_VAR(js_params);},
+        [&] (int id, int errcode, const Json &js_result) {
+            if (id == 1) {
+                EXPECT_EQ(errcode, 0);
+                EXPECT_EQ(js_result, js_send_result);
+            } else {
+                EXPECT_EQ(id, 2);
+                EXPECT_EQ(errcode, -1000);
+            }
+            ++count;
+        }
+    );
+    proto.setSendCallback(
+        [&] (const void *data_ptr, size_t data_size) {
+            proto.onRecvData(data_ptr, data_size);
+        }
+    );
+
+    proto.sendResult(1, js_send_result);
+    proto.sendError(2, -1000);
+    EXPECT_EQ(count, 2);
+
+    LogOutput_Disable();
+}
+
+TEST(MsgPackProto, RecvUncompleteData) {
+    LogOutput_Enable();
+
+    MsgPackProto proto;
+
+    std::string data;
+    proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { data.append(static_cast<const char*>(data_ptr), data_size); });
+    proto.sendRequest(1, "test");
+
+    int count = 0;
+    proto.setRecvCallback(
+        [&] (int id, const std::string &method, const Json &js_params) {
+            EXPECT_EQ(id, 1);
+            EXPECT_EQ(method, "test");
+            EXPECT_EQ(js_params, Json());
+            ++count;
+        },
+        nullptr
+    );
+
+    for (size_t i = 0; i < data.size(); ++i)
+        EXPECT_EQ(proto.onRecvData(data.data(), i), 0);
+    EXPECT_EQ(proto.onRecvData(data.data(), data.size()), data.size());
+
+    EXPECT_EQ(count, 1);
+    LogOutput_Disable();
+}
+
+//! 长度字段很大时只是等待更多的数据，不能因计算回绕而越界读取
+TEST(MsgPackProto, RecvHugeLength) {
+    MsgPackProto proto;
+    proto.setRecvCallback(
+        [&] (int, const std::string &, const Json &) { ADD_FAILURE(); },
+        nullptr
+    );
+
+    const uint8_t data[] = { 0xCA, 0xFB, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00 };
+    EXPECT_EQ(proto.onRecvData(data, sizeof(data)), 0);
+
+    const uint8_t text_data[] = { 0xCA, 0xFE, 0xFF, 0xFF, 0xFF, 0xFA, '{', '}' };
+    EXPECT_EQ(proto.onRecvData(text_data, sizeof(text_data)), 0);
+}
+
+//! 收到文本格式的请求后，以相同的格式回复
+TEST(MsgPackProto, ReplyInPeerFormat) {
+    LogOutput_Enable();
+
+    MsgPackProto proto;
+
+    std::string reply;
+    proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { reply.assign(static_cast<const char*>(data_ptr), data_size); });
+    proto.setRecvCallback(
+        [&] (int id, const std::string &, const Json &) { proto.sendResult(id, "ok"); },
+        nullptr
+    );
+
+    const char *raw_text = R"( {"id":1,"method":"test","jsonrpc":"2.0"})";
+    EXPECT_EQ(proto.onRecvData(raw_text, 20), 0);
+    EXPECT_EQ(proto.onRecvData(raw_text, ::strlen(raw_text)), ::strlen(raw_text));
+    EXPECT_EQ(proto.sendFormat(), MsgPackProto::Format::kRawText);
+    EXPECT_EQ(Json::parse(reply), Json::parse(R"({"id":1,"jsonrpc":"2.0","result":"ok"})"));
+
+    const char *header_text = "\xCA\xFE\x00\x00\x00\x28{\"id\":2,\"method\":\"test\",\"jsonrpc\":\"2.0\"}";
+    EXPECT_EQ(proto.onRecvData(header_text, 46), 46);
+    EXPECT_EQ(proto.sendFormat(), MsgPackProto::Format::kHeaderText);
+    ASSERT_GT(reply.size(), 6u);
+    EXPECT_EQ(reply.substr(0, 2), "\xCA\xFE");
+    EXPECT_EQ(Json::parse(reply.substr(6)), Json::parse(R"({"id":2,"jsonrpc":"2.0","result":"ok"})"));
+
+    const char *bad_data = "\xCA\xFF\x00\x00\x00\x00";
+    EXPECT_EQ(proto.onRecvData(bad_data, 6), -2);
+
+    LogOutput_Disable();
+}
+
+//! 各种类型与长度都能原样还原，损坏的内容返回 -1
+TEST(MsgPackProto, AllTypes) {
+    Json js_send_params = {
+        {"null", nullptr}, {"true", true}, {"false", false},
+        {"ints", {0, 127, 128, 255, 256, 65535, 65536, 4294967295u, 4294967296u, UINT64_MAX,
+                  -1, -32, -33, -128, -129, -32768, -32769, INT32_MIN, -2147483649ll, INT64_MIN}},
+        {"floats", {0.0, -1.25, 3.14159, 1e300}},
+        {"strs", {"", std::string(31, 'a'), std::string(32, 'b'), std::string(256, 'c'), std::string(65536, 'd')}},
+        {"array16", Json::array()},
+        {"object16", Json::object()},
+    };
+    for (int i = 0; i < 70000; ++i)
+        js_send_params["array16"].push_back(i % 3);
+    for (int i = 0; i < 16; ++i)
+        js_send_params["object16"][std::to_string(i)] = {{"deep", {i}}};
+
+    LogOutput_Enable();
+    MsgPackProto proto;
+
+    int count = 0;
+    proto.setRecvCallback(
+        [&] (int id, const std::string &method, const Json &js_params) {
+            EXPECT_EQ(id, 1);
+            EXPECT_EQ(method, "test");
+            EXPECT_EQ(js_params, js_send_params);
+            ++count;
+        },
+        nullptr
+    );
+
+    std::string data;
+    proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { data.assign(static_cast<const char*>(data_ptr), data_size); });
+    proto.sendRequest(1, "test", js_send_params);
+
+    EXPECT_EQ(proto.onRecvData(data.data(), data.size()), data.size());
+    EXPECT_EQ(count, 1);
+
+    //! 截掉最后一个字节，再改写长度
+    data.pop_back();
+    uint32_t content_size = data.size() - 6;
+    for (int i = 0; i < 4; ++i)
+        data[2 + i] = static_cast<char>(content_size >> ((3 - i) * 8));
+    EXPECT_EQ(proto.onRecvData(data.data(), data.size()), -1);
+    EXPECT_EQ(count, 1);
+
+    LogOutput_Disable();
+}
+
+namespace {
+//! 编码 times 次，再逐个解码，返回编码后的总字节数
+size_t BenchmarkProto(const char *name, Proto &proto, const Json &js_result, int times)
+{
+    std::vector<std::string> packets;
+    proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { packets.emplace_back(static_cast<const char*>(data_ptr), data_size); });
+
+    int count = 0;
+    proto.setRecvCallback(nullptr, [&] (int, int, const Json &) { ++count; });
+
+    auto start_ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < times; ++i)
+        proto.sendResult(i + 1, js_result);
+    auto encode_cost = std::chrono::steady_clock::now() - start_ts;
+
+    start_ts = std::chrono::steady_clock::now();
+    for (auto &packet : packets)
+        proto.onRecvData(packet.data(), packet.size());
+    auto decode_cost = std::chrono::steady_clock::now() - start_ts;
+
+    EXPECT_EQ(count, times);
+
+    std::cout << name
+        << " size: " << packets.front().size()
+        << ", encode cost: " << std::chrono::duration_cast<std::chrono::microseconds>(encode_cost).count() << " us"
+        << ", decode cost: " << std::chrono::duration_cast<std::chrono::microseconds>(decode_cost).count() << " us"
+        << std::endl;
+
+    return packets.front().size();
+}
+}
+
+TEST(MsgPackProto, BenchmarkCompareProtos) {
+    Json js_result = Json::array();
+    for (int i = 0; i < 100; ++i)
+        js_result.push_back({{"id", i}, {"name", "item_" + std::to_string(i)}, {"value", i * 1.5}, {"enable", i % 2 == 0}, {"tags", {1, 2, 3}}});
+
+    const int kTimes = 1000;
+
+    RawStreamProto raw_proto;
+    HeaderStreamProto header_proto;
+    PacketProto packet_proto;
+    MsgPackProto msgpack_proto;
+
+    BenchmarkProto("RawStreamProto", raw_proto, js_result, kTimes);
+    BenchmarkProto("HeaderStreamProto", header_proto, js_result, kTimes);
+    BenchmarkProto("PacketProto", packet_proto, js_result, kTimes);
+    auto msgpack_size = BenchmarkProto("MsgPackProto", msgpack_proto, js_result, kTimes);
+    EXPECT_LT(msgpack_size, js_result.dump().size());
+}
+
+}
+}
@@ -20,7 +20,6 @@
 #include "packet_proto.h"
 
 #include <tbox/base/json.hpp>
-#include <tbox/base/catch_throw.h>
 #include <tbox/util/json.h>
 #include <tbox/base/assert.h>
 
@@ -29,10 +28,13 @@ namespace jsonrpc {
 
 void PacketProto::sendJson(const Json &js)
 {
-    if (send_data_cb_) {
-        const auto &json_text = js.dump();
+    sendJsonText(js.dump());
+}
+
+void PacketProto::sendJsonText(const std::string &json_text)
+{
+    if (send_data_cb_)
         send_data_cb_(json_text.data(), json_text.size());
-    }
 }
 
 /**
@@ -48,14 +50,10 @@ ssize_t PacketProto::onRecvData(const void *data_ptr, size_t data_size)
     const char *str_ptr = static_cast<const char*>(data_ptr);
     const size_t str_len = data_size;
 
-    Json js;
-    bool is_throw = tbox::CatchThrow([&] { js = Json::parse(str_ptr, str_ptr + str_len); });
-    if (is_throw) {
+    if (!onRecvJsonText(str_ptr, str_len)) {
         LogNotice("parse json fail");
         return -1;
     }
-
-    onRecvJson(js);
     return str_len;
 }
 
@@ -37,6 +37,8 @@ class PacketProto : public Proto {
 
   protected:
     virtual void sendJson(const Json &js) override;
+    virtual bool isTextMode() const override { return true; }
+    virtual void sendJsonText(const std::string &json_text) override;
 };
 
 }
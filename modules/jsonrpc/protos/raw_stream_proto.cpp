@@ -20,7 +20,6 @@
 #include "raw_stream_proto.h"
 
 #include <tbox/base/json.hpp>
-#include <tbox/base/catch_throw.h>
 #include <tbox/util/json.h>
 #include <tbox/base/assert.h>
 
@@ -29,10 +28,13 @@ namespace jsonrpc {
 
 void RawStreamProto::sendJson(const Json &js)
 {
-    if (send_data_cb_) {
-        const auto &json_text = js.dump();
+    sendJsonText(js.dump());
+}
+
+void RawStreamProto::sendJsonText(const std::string &json_text)
+{
+    if (send_data_cb_)
         send_data_cb_(json_text.data(), json_text.size());
-    }
 }
 
 ssize_t RawStreamProto::onRecvData(const void *data_ptr, size_t data_size)
@@ -43,16 +45,14 @@ ssize_t RawStreamProto::onRecvData(const void *data_ptr, size_t data_size)
         return 0;
 
     const char *str_ptr = static_cast<const char*>(data_ptr);
-    auto str_len = util::json::FindEndPos(str_ptr, data_size);
+    auto str_len = end_pos_finder_.find(str_ptr, data_size);
     if (str_len > 0) {
-        Json js;
-        bool is_throw = tbox::CatchThrow([&] { js = Json::parse(str_ptr, str_ptr + str_len); });
-        if (is_throw) {
+        end_pos_finder_.reset();
+
+        if (!onRecvJsonText(str_ptr, str_len)) {
             LogNotice("parse json fail");
             return -1;
         }
-
-        onRecvJson(js);
         return str_len;
     }
     return 0;
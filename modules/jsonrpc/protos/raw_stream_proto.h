@@ -20,6 +20,7 @@
 #ifndef TBOX_JSONRPC_RAW_STREAM_PROTO_H_20230812
 #define TBOX_JSONRPC_RAW_STREAM_PROTO_H_20230812
 
+#include <tbox/util/json.h>
 #include "../proto.h"
 
 namespace tbox {
@@ -33,14 +34,25 @@ namespace jsonrpc {
  * 它通过对JSON的特征标志字符'[', ']', '{', '}' 进行计数来界定JSON数据包
  *
  * 适用于流式协议，如 TCP
+ *
+ * 一个包分多次到达时，只扫描新到达的部分。这要求每次 onRecvData() 传入的都是
+ * 从未消费的数据开头起的全部数据；若传输层丢弃了未消费的数据（如断开重连），须调用 reset()
  */
 
 class RawStreamProto : public Proto {
   public:
     virtual ssize_t onRecvData(const void *data_ptr, size_t data_size) override;
 
+    //! 丢弃已扫描的状态
+    void reset() { end_pos_finder_.reset(); }
+
   protected:
     virtual void sendJson(const Json &js) override;
+    virtual bool isTextMode() const override { return true; }
+    virtual void sendJsonText(const std::string &json_text) override;
+
+  private:
+    util::json::EndPosFinder end_pos_finder_;
 };
 
 }
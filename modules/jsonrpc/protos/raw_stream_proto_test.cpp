@@ -167,5 +167,42 @@ TEST(RawStreamProto, RecvUncompleteData) {
     LogOutput_Disable();
 }
 
+//! 大包分段到达，且同一段中还带有下一个包的开头
+TEST(RawStreamProto, RecvLargeDataInSegments) {
+    RawStreamProto proto;
+
+    Json js_params = Json::array();
+    for (int i = 0; i < 2000; ++i)
+        js_params.push_back({{"text", "a \"quoted\" [string] {" + std::to_string(i)}, {"path", "C:\\dir\\"}});
+
+    int count = 0;
+    proto.setRecvCallback(
+        [&] (int id, const std::string &method, const Json &js) {
+            EXPECT_EQ(id, count + 1);
+            EXPECT_EQ(method, "test");
+            EXPECT_EQ(js, js_params);
+            ++count;
+        },
+        nullptr
+    );
+
+    std::string data;
+    proto.setSendCallback([&] (const void *data_ptr, size_t data_size) { data.append(static_cast<const char*>(data_ptr), data_size); });
+    proto.sendRequest(1, "test", js_params);
+    proto.sendRequest(2, "test", js_params);
+
+    std::string buffer;
+    for (size_t pos = 0; pos < data.size(); pos += 1000) {
+        buffer.append(data, pos, 1000);
+        ssize_t ret = 0;
+        while ((ret = proto.onRecvData(buffer.data(), buffer.size())) > 0)
+            buffer.erase(0, ret);
+        EXPECT_EQ(ret, 0);
+    }
+
+    EXPECT_EQ(count, 2);
+    EXPECT_TRUE(buffer.empty());
+}
+
 }
 }
@@ -20,6 +20,7 @@
 #include "rpc.h"
 
 #include <tbox/base/log.h>
+#include <tbox/base/assert.h>
 #include <tbox/base/json.hpp>
 #include "proto.h"
 #include "inner_types.h"
@@ -27,19 +28,65 @@
 namespace tbox {
 namespace jsonrpc {
 
+constexpr size_t Rpc::LatencyStat::kBucketNum;
+constexpr size_t Rpc::kMinSlotSize;
+
+//! 排队等待发出的请求
+struct Rpc::QueuedRequest {
+    std::string method;
+    Json js_params;
+    RequestCallback cb;
+};
+
+void Rpc::LatencyStat::add(uint64_t cost_us)
+{
+    size_t index = 0;
+    if (cost_us > 1)
+        index = 63 - __builtin_clzll(cost_us);
+    if (index >= kBucketNum)
+        index = kBucketNum - 1;
+
+    ++buckets[index];
+    ++count;
+    total_us += cost_us;
+    if (cost_us > max_us)
+        max_us = cost_us;
+}
+
+uint64_t Rpc::LatencyStat::percentile(double percent) const
+{
+    if (count == 0)
+        return 0;
+
+    uint64_t target = static_cast<uint64_t>(count * percent / 100);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < kBucketNum; ++i) {
+        sum += buckets[i];
+        if (sum > target)
+            return i + 1 < kBucketNum ? (1ull << (i + 1)) : max_us;
+    }
+    return max_us;
+}
+
 Rpc::Rpc(event::Loop *loop)
-    : request_timeout_(loop)
-    , respond_timeout_(loop)
+    : wp_loop_(loop)
+    , dispatcher_(loop)
+    , request_timeout_(loop)
 {
     using namespace std::placeholders;
     request_timeout_.setCallback(std::bind(&Rpc::onRequestTimeout, this, _1));
-    respond_timeout_.setCallback(std::bind(&Rpc::onRespondTimeout, this, _1));
 }
 
 Rpc::~Rpc()
 {
-    respond_timeout_.cleanup();
+    dispatcher_.cleanup();
     request_timeout_.cleanup();
+
+    if (batch_run_id_ != 0)
+        wp_loop_->cancel(batch_run_id_);
+
+    for (auto item : request_queue_)
+        delete item;
 }
 
 bool Rpc::initialize(Proto *proto, int timeout_sec)
@@ -47,12 +94,17 @@ bool Rpc::initialize(Proto *proto, int timeout_sec)
     using namespace std::placeholders;
 
     request_timeout_.initialize(std::chrono::seconds(1), timeout_sec);
-    respond_timeout_.initialize(std::chrono::seconds(1), timeout_sec);
-
-    proto->setRecvCallback(
-        std::bind(&Rpc::onRecvRequest, this, _1, _2, _3),
-        std::bind(&Rpc::onRecvRespond, this, _1, _2, _3)
+    dispatcher_.initialize(timeout_sec,
+        [this] (Proto *proto) -> Proto* {
+            if (proto == nullptr || proto != proto_)
+                return nullptr;
+            prepareSend();
+            return proto;
+        }
     );
+
+    proto->setRecvCallback(nullptr, std::bind(&Rpc::onRecvRespond, this, _1, _2, _3));
+    proto->setRecvRequestViewCallback(std::bind(&Rpc::onRecvRequest, this, _1, _2, _3));
     proto_ = proto;
 
     return true;
@@ -60,24 +112,156 @@ bool Rpc::initialize(Proto *proto, int timeout_sec)
 
 void Rpc::cleanup()
 {
-    respond_timeout_.cleanup();
+    //! 把已合并的先发出去
+    if (batch_run_id_ != 0) {
+        wp_loop_->cancel(batch_run_id_);
+        batch_run_id_ = 0;
+        proto_->endBatch();
+    }
+
+    dispatcher_.cleanup();
     request_timeout_.cleanup();
-    method_services_.clear();
+
+    request_slots_.clear();
+    in_flight_number_ = 0;
+    for (auto item : request_queue_)
+        delete item;
+    request_queue_.clear();
+
     proto_->setRecvCallback(nullptr, nullptr);
+    proto_->setRecvRequestViewCallback(nullptr);
     proto_ = nullptr;
 }
 
+void Rpc::setInFlightLimit(size_t max_in_flight, size_t max_queue_size)
+{
+    max_in_flight_ = max_in_flight;
+    max_queue_size_ = max_queue_size;
+    sendQueuedRequests();
+}
+
+void Rpc::resetLatencyStats()
+{
+    //! 槽位中记录了统计项的地址，只能清零，不能删除
+    for (auto &item : latency_stats_)
+        item.second = LatencyStat();
+}
+
+void Rpc::prepareSend()
+{
+    if (!is_batch_enabled_ || batch_run_id_ != 0)
+        return;
+
+    proto_->beginBatch();
+    batch_run_id_ = wp_loop_->runNext(
+        [this] {
+            batch_run_id_ = 0;
+            proto_->endBatch();
+        },
+        "Rpc::endBatch"
+    );
+}
+
 void Rpc::request(const std::string &method, const Json &js_params, RequestCallback &&cb)
 {
-    int id = 0;
+    if (cb && max_in_flight_ != 0 && inFlightNumber() >= max_in_flight_) {
+        if (request_queue_.size() >= max_queue_size_) {
+            LogNotice("too many requests, method: %s", method.c_str());
+            cb(ErrorCode::kRequestOverload, Json());
+            return;
+        }
+
+        request_queue_.push_back(new QueuedRequest{ method, js_params, std::move(cb) });
+        return;
+    }
+
+    sendRequest(method, js_params, std::move(cb));
+}
+
+void Rpc::sendRequest(const std::string &method, const Json &js_params, RequestCallback &&cb)
+{
+    int64_t id = 0;
     if (cb) {
         id = ++id_alloc_;
-        request_callback_[id] = std::move(cb);
+        if ((in_flight_number_ + 1) * 2 > request_slots_.size())
+            resizeSlots(request_slots_.empty() ? kMinSlotSize : request_slots_.size() * 2);
+
+        auto &slot = request_slots_[probeSlot(id)];
+        slot.id = id;
+        slot.cb = std::move(cb);
+        slot.wp_stat = &latency_stats_[method];
+        slot.send_time = std::chrono::steady_clock::now();
+        ++in_flight_number_;
         request_timeout_.add(id);
     }
+
+    prepareSend();
     proto_->sendRequest(id, method, js_params);
 }
 
+Rpc::RequestSlot* Rpc::findSlot(int64_t id)
+{
+    if (id <= 0 || request_slots_.empty())
+        return nullptr;
+
+    auto &slot = request_slots_[probeSlot(id)];
+    return slot.id == id ? &slot : nullptr;
+}
+
+void Rpc::freeSlot(RequestSlot *slot)
+{
+    size_t mask = request_slots_.size() - 1;
+    size_t hole = slot - request_slots_.data();
+
+    //! 把同一簇中后面的、起点不在 (hole, pos] 之间的槽位前移填洞，保证探测不会提前遇到空位
+    for (size_t pos = (hole + 1) & mask; request_slots_[pos].id != 0; pos = (pos + 1) & mask) {
+        size_t home = request_slots_[pos].id & mask;
+        bool can_move = (hole <= pos) ? (home <= hole || home > pos) : (home <= hole && home > pos);
+        if (can_move) {
+            request_slots_[hole] = std::move(request_slots_[pos]);
+            hole = pos;
+        }
+    }
+
+    auto &empty_slot = request_slots_[hole];
+    empty_slot.id = 0;
+    empty_slot.cb = nullptr;
+    empty_slot.wp_stat = nullptr;
+    --in_flight_number_;
+
+    if (request_slots_.size() > kMinSlotSize && in_flight_number_ * 8 < request_slots_.size())
+        resizeSlots(request_slots_.size() / 2);
+}
+
+//! 返回id所在的下标，不存在时返回探测到的第一个空闲下标。表中始终有空闲的槽位
+size_t Rpc::probeSlot(int64_t id) const
+{
+    size_t mask = request_slots_.size() - 1;
+    size_t pos = id & mask;
+    while (request_slots_[pos].id != 0 && request_slots_[pos].id != id)
+        pos = (pos + 1) & mask;
+    return pos;
+}
+
+void Rpc::resizeSlots(size_t size)
+{
+    std::vector<RequestSlot> old_slots(size);
+    request_slots_.swap(old_slots);
+    for (auto &slot : old_slots) {
+        if (slot.id != 0)
+            request_slots_[probeSlot(slot.id)] = std::move(slot);
+    }
+}
+
+void Rpc::sendQueuedRequests()
+{
+    while (!request_queue_.empty() && (max_in_flight_ == 0 || inFlightNumber() < max_in_flight_)) {
+        auto item = request_queue_.front();
+        request_queue_.pop_front();
+        sendRequest(item->method, item->js_params, std::move(item->cb));
+        delete item;
+    }
+}
 void Rpc::request(const std::string &method, RequestCallback &&cb)
 {
     request(method, Json(), std::move(cb));
@@ -95,95 +279,88 @@ void Rpc::notify(const std::string &method)
 
 void Rpc::addService(const std::string &method, ServiceCallback &&cb)
 {
-    method_services_[method] = std::move(cb);
+    Dispatcher<Proto*>::ServiceCallback func;
+    if (cb) {
+        func = [cb] (Proto *, int64_t id, const Json &js_params, int &errcode, Json &js_result) {
+            return cb(id, js_params, errcode, js_result);
+        };
+    }
+    dispatcher_.addService(method, std::move(func));
 }
 
-void Rpc::respond(int id, int errcode, const Json &js_result)
+void Rpc::addRawService(const std::string &method, RawServiceCallback &&cb)
 {
-    if (id == 0) {
-        LogWarn("send id == 0 respond");
-        return;
-    }
-
-    if (errcode == 0) {
-        proto_->sendResult(id, js_result);
-    } else {
-        proto_->sendError(id, errcode);
+    Dispatcher<Proto*>::RawServiceCallback func;
+    if (cb) {
+        func = [cb] (Proto *, int64_t id, const JsonView &js_params, int &errcode, std::string &result_text) {
+            return cb(id, js_params, errcode, result_text);
+        };
     }
+    dispatcher_.addRawService(method, std::move(func));
+}
 
-    tobe_respond_.erase(id);
+void Rpc::respond(int64_t id, int errcode, const Json &js_result)
+{
+    dispatcher_.respond(proto_, id, errcode, js_result);
 }
 
-void Rpc::respond(int id, const Json &js_result)
+void Rpc::respond(int64_t id, const Json &js_result)
 {
-    if (id == 0) {
-        LogWarn("send id == 0 respond");
-        return;
-    }
+    dispatcher_.respond(proto_, id, js_result);
+}
 
-    proto_->sendResult(id, js_result);
-    tobe_respond_.erase(id);
+void Rpc::respond(int64_t id, int errcode)
+{
+    dispatcher_.respond(proto_, id, errcode);
 }
 
-void Rpc::respond(int id, int errcode)
+void Rpc::respond(int64_t id, const JsonView &js_result)
 {
-    if (id == 0) {
-        LogWarn("send id == 0 respond");
-        return;
-    }
+    dispatcher_.respond(proto_, id, js_result);
+}
 
-    proto_->sendError(id, errcode);
-    tobe_respond_.erase(id);
-}
-
-void Rpc::onRecvRequest(int id, const std::string &method, const Json &js_params)
-{
-    auto iter = method_services_.find(method);
-    if (iter != method_services_.end() && iter->second) {
-        int errcode = 0;
-        Json js_result;
-        if (id != 0) {
-            tobe_respond_.insert(id);
-            if (iter->second(id, js_params, errcode, js_result)) {
-                respond(id, errcode, js_result);
-            } else {
-                respond_timeout_.add(id);
-            }
-        } else {
-            iter->second(id, js_params, errcode, js_result);
-        }
-    } else {
-        proto_->sendError(id, ErrorCode::kMethodNotFound);
-    }
+void Rpc::respondByWriter(int64_t id, const Proto::WriteJsonFunc &write_result)
+{
+    dispatcher_.respondByWriter(proto_, id, write_result);
 }
 
-void Rpc::onRecvRespond(int id, int errcode, const Json &js_result)
+void Rpc::onRecvRequest(int64_t id, const std::string &method, const JsonView &js_params)
 {
-    auto iter = request_callback_.find(id);
-    if (iter != request_callback_.end()) {
-        if (iter->second)
-            iter->second(errcode, js_result);
-        request_callback_.erase(iter);
-    }
+    dispatcher_.dispatch(proto_, id, method, js_params);
 }
 
-void Rpc::onRequestTimeout(int id)
+void Rpc::onRecvRespond(int64_t id, int errcode, const Json &js_result)
 {
-    auto iter = request_callback_.find(id);
-    if (iter != request_callback_.end()) {
-        if (iter->second)
-            iter->second(ErrorCode::kRequestTimeout, Json());
-        request_callback_.erase(iter);
-    }
+    auto slot = findSlot(id);
+    if (slot == nullptr)
+        return;
+
+    auto cost = std::chrono::steady_clock::now() - slot->send_time;
+    slot->wp_stat->add(std::chrono::duration_cast<std::chrono::microseconds>(cost).count());
+
+    //! 先让排队的请求用上空出的槽位，再回调，保证先来先发
+    auto cb = std::move(slot->cb);
+    freeSlot(slot);
+    sendQueuedRequests();
+
+    if (cb)
+        cb(errcode, js_result);
 }
 
-void Rpc::onRespondTimeout(int id)
+void Rpc::onRequestTimeout(int64_t id)
 {
-    auto iter = tobe_respond_.find(id);
-    if (iter != tobe_respond_.end()) {
-        LogWarn("respond timeout"); //! 仅仅是提示作用
-        tobe_respond_.erase(iter);
-    }
+    auto slot = findSlot(id);
+    if (slot == nullptr)
+        return;
+
+    ++slot->wp_stat->timeout_count;
+
+    auto cb = std::move(slot->cb);
+    freeSlot(slot);
+    sendQueuedRequests();
+
+    if (cb)
+        cb(ErrorCode::kRequestTimeout, Json());
 }
 
 }
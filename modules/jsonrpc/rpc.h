@@ -20,18 +20,22 @@
 #ifndef TBOX_JSONRPC_RPC_H
 #define TBOX_JSONRPC_RPC_H
 
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 #include <tbox/base/json_fwd.h>
 #include <tbox/event/forward.h>
 #include <tbox/eventx/timeout_monitor.hpp>
 
+#include "json_view.h"
+#include "proto.h"
+#include "dispatcher.h"
+
 namespace tbox {
 namespace jsonrpc {
 
-class Proto;
-
 class Rpc {
   public:
     /**
@@ -53,7 +57,34 @@ class Rpc {
      * \return  true        同步回复：在函数返回后自动回复，根据errcode与js_result进行回复
      * \return  false       异步回复：不在函数返回后自动回复，而是在稍候通过调respond()进行回复
      */
-    using ServiceCallback = std::function<bool(int id, const Json &js_params, int &errcode, Json &js_result)>;
+    using ServiceCallback = std::function<bool(int64_t id, const Json &js_params, int &errcode, Json &js_result)>;
+
+    /**
+     * 同 ServiceCallback，但参数与结果都不经过 Json 对象
+     *
+     * \param   js_params   请求参数的视图，需要时才解析，也可以直接转发其文本
+     * \param   result_text 将要回复的结果，须是合法的JSON文本，为空则回复 null（仅同步回复有效）
+     */
+    using RawServiceCallback = std::function<bool(int64_t id, const JsonView &js_params, int &errcode, std::string &result_text)>;
+
+    /**
+     * 请求耗时的统计
+     *
+     * 第 i 个桶统计耗时在 [2^i, 2^(i+1)) 微秒之间的次数，第0个桶包括0，最后一个桶包括更大的
+     */
+    struct LatencyStat {
+        static constexpr size_t kBucketNum = 25;
+
+        uint64_t count = 0;         //!< 收到回复的次数
+        uint64_t timeout_count = 0; //!< 超时的次数
+        uint64_t total_us = 0;
+        uint64_t max_us = 0;
+        uint64_t buckets[kBucketNum] = { 0 };
+
+        void add(uint64_t cost_us);
+        //! 估算百分位数，返回所在桶的上限
+        uint64_t percentile(double percent) const;
+    };
 
   public:
     explicit Rpc(event::Loop *loop);
@@ -64,6 +95,7 @@ class Rpc {
 
     //! 添加方法被调用时的回调函数
     void addService(const std::string &method, ServiceCallback &&cb);
+    void addRawService(const std::string &method, RawServiceCallback &&cb);
 
     //! 发送请求（需要回复的）
     void request(const std::string &method, const Json &js_params, RequestCallback &&cb);
@@ -74,26 +106,90 @@ class Rpc {
     void notify(const std::string &method);
 
     //! 发送异步回复
-    void respond(int id, int errcode, const Json &js_result);
-    void respond(int id, const Json &js_result);
-    void respond(int id, int errcode);
+    void respond(int64_t id, int errcode, const Json &js_result);
+    void respond(int64_t id, const Json &js_result);
+    void respond(int64_t id, int errcode);
+    //! 回复已编码好的结果，文本直接拼接到回复中
+    void respond(int64_t id, const JsonView &js_result);
+    //! 由 write_result 直接写出结果，不构建 Json 对象，适合很大的结果
+    void respondByWriter(int64_t id, const Proto::WriteJsonFunc &write_result);
+
+    /**
+     * 限制等待回复的请求数
+     *
+     * 超出的请求先排队，待有回复或超时后再发出。队列也满了的，直接以 -32001 错误码回调，
+     * 使对端过载时本端不会无限地积压请求
+     *
+     * \param max_in_flight   最多同时等待回复的请求数，0 表示不限
+     * \param max_queue_size  最多排队的请求数
+     */
+    void setInFlightLimit(size_t max_in_flight, size_t max_queue_size);
+    size_t inFlightNumber() const { return in_flight_number_; }
+    size_t queueSize() const { return request_queue_.size(); }
+
+    //! 开启后，同一轮事件回调中发出的请求、通知与回复合并成一个JSON数组一次发出
+    void setBatchEnable(bool enable) { is_batch_enabled_ = enable; }
+
+    //! 各方法的请求耗时统计
+    const std::unordered_map<std::string, LatencyStat>& getLatencyStats() const { return latency_stats_; }
+    void resetLatencyStats();
 
   protected:
-    void onRecvRequest(int id, const std::string &method, const Json &params);
-    void onRecvRespond(int id, int errcode, const Json &result);
-    void onRequestTimeout(int id);
-    void onRespondTimeout(int id);
+    void onRecvRequest(int64_t id, const std::string &method, const JsonView &params);
+    void onRecvRespond(int64_t id, int errcode, const Json &result);
+    void onRequestTimeout(int64_t id);
 
   private:
+    struct RequestSlot;
+    struct QueuedRequest;
+
+    void sendRequest(const std::string &method, const Json &js_params, RequestCallback &&cb);
+    RequestSlot* findSlot(int64_t id);
+    void freeSlot(RequestSlot *slot);
+    size_t probeSlot(int64_t id) const;
+    void resizeSlots(size_t size);
+    void sendQueuedRequests();
+    void prepareSend();
+
+    event::Loop *wp_loop_;
     Proto *proto_ = nullptr;
 
-    std::unordered_map<std::string, ServiceCallback> method_services_;
+    Dispatcher<Proto*> dispatcher_;    //!< 收到的请求的分发与回复，以 proto_ 作为连接
+
+    static constexpr size_t kMinSlotSize = 16;
+
+    /**
+     * 等待回复的请求
+     *
+     * 开放寻址的哈希表，请求id是递增的，以 id & (size - 1) 为起点线性探测。
+     * 新的id绕回到仍在等待的旧请求的下标上时，顺延到下一个空闲槽位，而不是扩容。
+     * 删除时把后面同一簇的槽位前移（backward shift），不留墓碑。
+     *
+     * 容量只随同时等待回复的请求数变化：占用超过 1/2 时翻倍，低于 1/8 时减半，最小 16。
+     * 所以容量最大是同时等待数峰值的 4 倍以内；设置了 max_in_flight 时，不超过
+     * 2 * max_in_flight 向上取2的幂。最坏情况下一次查找要探测整个簇，簇长不超过同时等待数
+     */
+    struct RequestSlot {
+        int64_t id = 0;     //!< 0 表示空闲
+        RequestCallback cb;
+        LatencyStat *wp_stat = nullptr;
+        std::chrono::steady_clock::time_point send_time;
+    };
+
+    std::vector<RequestSlot> request_slots_;
+    size_t in_flight_number_ = 0;
+    int64_t id_alloc_ = 0;
+
+    size_t max_in_flight_ = 0;
+    size_t max_queue_size_ = 0;
+    std::deque<QueuedRequest*> request_queue_;
+
+    bool is_batch_enabled_ = false;
+    event::Loop::RunId batch_run_id_ = 0;
+
+    std::unordered_map<std::string, LatencyStat> latency_stats_;
 
-    int id_alloc_ = 0;
-    std::unordered_map<int, RequestCallback> request_callback_;
-    std::unordered_set<int> tobe_respond_;
-    eventx::TimeoutMonitor<int> request_timeout_;   //! 请求超时监测
-    eventx::TimeoutMonitor<int> respond_timeout_;   //! 回复超时监测
+    eventx::TimeoutMonitor<int64_t> request_timeout_;   //! 请求超时监测
 };
 
 }
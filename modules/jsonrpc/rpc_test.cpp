@@ -24,6 +24,8 @@
 #include <tbox/base/scope_exit.hpp>
 #include <tbox/base/defines.h>
 
+#include <tbox/network/shm_stream.h>
+
 #include "protos/raw_stream_proto.h"
 #include "rpc.h"
 
@@ -174,6 +176,262 @@ TEST_F(RpcTest, SendRequestNoMethod) {
     EXPECT_TRUE(is_method_cb_invoke);
 }
 
+TEST_F(RpcTest, RawService) {
+    Json js_req_params = { {"a", 12}, {"b", "test jsonrpc"} };
+
+    //! 不解析参数，直接把参数的文本作为结果回复
+    int service_invoke_count = 0;
+    rpc_b.addRawService("echo",
+        [&] (int id, const JsonView &js_params, int &errcode, std::string &result_text) {
+            EXPECT_TRUE(js_params.isText());
+            result_text = js_params.dump();
+            errcode = 0;
+            ++service_invoke_count;
+            UNUSED_VAR(id);
+            return true;
+        }
+    );
+    rpc_b.addRawService("async",
+        [&] (int id, const JsonView &js_params, int &, std::string &) {
+            EXPECT_EQ(js_params.json(), js_req_params);
+            loop->run([=] { rpc_b.respond(id, JsonView(R"({"r":1})", 7)); });
+            ++service_invoke_count;
+            return false;
+        }
+    );
+
+    int method_cb_invoke_count = 0;
+    loop->run(
+        [&] {
+            rpc_a.request("echo", js_req_params,
+                [&] (int errcode, const Json &js_result) {
+                    EXPECT_EQ(errcode, 0);
+                    EXPECT_EQ(js_result, js_req_params);
+                    ++method_cb_invoke_count;
+                }
+            );
+            rpc_a.request("async", js_req_params,
+                [&] (int errcode, const Json &js_result) {
+                    EXPECT_EQ(errcode, 0);
+                    EXPECT_EQ(js_result, Json({{"r", 1}}));
+                    ++method_cb_invoke_count;
+                }
+            );
+        }
+    );
+    loop->exitLoop(std::chrono::milliseconds(10));
+    loop->runLoop();
+
+    EXPECT_EQ(service_invoke_count, 2);
+    EXPECT_EQ(method_cb_invoke_count, 2);
+}
+
+TEST_F(RpcTest, RespondByWriter) {
+    Json js_rsp_result = { {"r", "aabbcc"}, {"list", {1, 2.5, nullptr, true}} };
+
+    rpc_b.addService("A",
+        [&] (int id, const Json &, int &, Json &) {
+            loop->run(
+                [=] {
+                    rpc_b.respondByWriter(id,
+                        [] (util::json::Writer &writer) {
+                            writer.beginObject()
+                                    .key("r").value("aabbcc")
+                                    .key("list").beginArray()
+                                        .value(1).value(2.5).value(nullptr).value(true)
+                                    .endArray()
+                                  .endObject();
+                        }
+                    );
+                }
+            );
+            return false;
+        }
+    );
+
+    bool is_method_cb_invoke = false;
+    loop->run(
+        [&] {
+            rpc_a.request("A",
+                [&] (int errcode, const Json &js_result) {
+                    EXPECT_EQ(errcode, 0);
+                    EXPECT_EQ(js_result, js_rsp_result);
+                    is_method_cb_invoke = true;
+                }
+            );
+        }
+    );
+    loop->exitLoop(std::chrono::milliseconds(10));
+    loop->runLoop();
+
+    EXPECT_TRUE(is_method_cb_invoke);
+}
+
+TEST_F(RpcTest, InFlightLimit) {
+    std::vector<int64_t> pending_ids;
+    rpc_b.addService("A",
+        [&] (int64_t id, const Json &js_params, int &, Json &) {
+            EXPECT_EQ(js_params, Json(pending_ids.size()));
+            pending_ids.push_back(id);
+            return false;
+        }
+    );
+
+    rpc_a.setInFlightLimit(2, 3);
+
+    std::vector<int> errcodes;
+    loop->run(
+        [&] {
+            for (int i = 0; i < 6; ++i) {
+                rpc_a.request("A", i,
+                    [&, i] (int errcode, const Json &js_result) {
+                        if (errcode == 0) {
+                            EXPECT_EQ(js_result, Json(i));
+                        }
+                        errcodes.push_back(errcode);
+                    }
+                );
+            }
+            //! 2个已发出，3个在排队，最后一个被拒绝
+            EXPECT_EQ(pending_ids.size(), 2u);
+            EXPECT_EQ(rpc_a.inFlightNumber(), 2u);
+            EXPECT_EQ(rpc_a.queueSize(), 3u);
+            EXPECT_EQ(errcodes, std::vector<int>({-32001}));
+
+            //! 每回复一个，就发出一个排队的
+            for (size_t i = 0; i < 5; ++i)
+                rpc_b.respond(pending_ids.at(i), Json(i));
+        }
+    );
+    loop->exitLoop(std::chrono::milliseconds(10));
+    loop->runLoop();
+
+    EXPECT_EQ(pending_ids.size(), 5u);
+    EXPECT_EQ(errcodes, std::vector<int>({-32001, 0, 0, 0, 0, 0}));
+    EXPECT_EQ(rpc_a.inFlightNumber(), 0u);
+    EXPECT_EQ(rpc_a.queueSize(), 0u);
+
+    auto &stat = rpc_a.getLatencyStats().at("A");
+    EXPECT_EQ(stat.count, 5u);
+    EXPECT_EQ(stat.timeout_count, 0u);
+    EXPECT_GE(stat.percentile(99), stat.percentile(50));
+}
+
+//! 有请求长期不回复，新的id不断绕回到它的槽位上，其它请求乱序回复，都要回调到正确的请求上
+TEST_F(RpcTest, LongPendingRequest) {
+    std::vector<int64_t> pending_ids;
+    std::vector<Json> pending_params;
+    rpc_b.addService("A",
+        [&] (int64_t id, const Json &js_params, int &, Json &) {
+            pending_ids.push_back(id);
+            pending_params.push_back(js_params);
+            return false;
+        }
+    );
+
+    int cb_count = 0;
+    auto send = [&] (int i) {
+        rpc_a.request("A", i,
+            [&, i] (int errcode, const Json &js_result) {
+                EXPECT_EQ(errcode, 0);
+                EXPECT_EQ(js_result, Json(i));
+                ++cb_count;
+            }
+        );
+    };
+
+    //! 回复 pending 中的第 index 个
+    auto respond = [&] (size_t index) {
+        int64_t id = pending_ids.at(index);
+        Json js_result = pending_params.at(index);
+        pending_ids.erase(pending_ids.begin() + index);
+        pending_params.erase(pending_params.begin() + index);
+        rpc_b.respond(id, js_result);
+    };
+
+    loop->run(
+        [&] {
+            send(0);    //! 这个一直不回复
+
+            for (int i = 1; i <= 1000; ++i) {
+                send(i);
+                //! 维持 1 + 3 个等待中的请求，每次回复中间的一个，使同一簇中的槽位前移
+                if (pending_ids.size() > 4)
+                    respond(2);
+            }
+            //! 突发很多请求后全部回复，容量应能缩回去
+            for (int i = 1001; i <= 1200; ++i)
+                send(i);
+            EXPECT_EQ(rpc_a.inFlightNumber(), 204u);
+            while (pending_ids.size() > 1)
+                respond(pending_ids.size() / 2);
+
+            EXPECT_EQ(rpc_a.inFlightNumber(), 1u);
+            respond(0);
+        }
+    );
+    loop->exitLoop(std::chrono::milliseconds(10));
+    loop->runLoop();
+
+    EXPECT_EQ(cb_count, 1201);
+    EXPECT_EQ(rpc_a.inFlightNumber(), 0u);
+}
+
+TEST_F(RpcTest, Batch) {
+    int a_send_count = 0;
+    int b_send_count = 0;
+    proto_a.setSendCallback(
+        [&](const void *data_ptr, size_t data_size) {
+            ++a_send_count;
+            proto_b.onRecvData(data_ptr, data_size);
+        }
+    );
+    proto_b.setSendCallback(
+        [&](const void *data_ptr, size_t data_size) {
+            ++b_send_count;
+            proto_a.onRecvData(data_ptr, data_size);
+        }
+    );
+
+    rpc_b.addService("add_one",
+        [&] (int64_t, const Json &js_params, int &errcode, Json &js_result) {
+            errcode = 0;
+            js_result = js_params.get<int>() + 1;
+            return true;
+        }
+    );
+
+    rpc_a.setBatchEnable(true);
+
+    int notify_count = 0;
+    rpc_b.addService("notify", [&] (int64_t, const Json &, int &, Json &) { ++notify_count; return true; });
+
+    int result_sum = 0;
+    loop->run(
+        [&] {
+            for (int i = 0; i < 10; ++i) {
+                rpc_a.request("add_one", i,
+                    [&] (int errcode, const Json &js_result) {
+                        EXPECT_EQ(errcode, 0);
+                        result_sum += js_result.get<int>();
+                    }
+                );
+            }
+            rpc_a.notify("notify");
+            rpc_a.request("not_exist", [&] (int errcode, const Json &) { EXPECT_EQ(errcode, -32601); });
+            EXPECT_EQ(a_send_count, 0);
+        }
+    );
+    loop->exitLoop(std::chrono::milliseconds(10));
+    loop->runLoop();
+
+    //! 请求一次发出，对端的同步回复也一次发回
+    EXPECT_EQ(a_send_count, 1);
+    EXPECT_EQ(b_send_count, 1);
+    EXPECT_EQ(result_sum, 55);
+    EXPECT_EQ(notify_count, 1);
+}
+
 TEST(Rpc, RequestTimeout) {
     auto loop = event::Loop::New();
     SetScopeExitAction([=] { delete loop; });
@@ -198,6 +456,72 @@ TEST(Rpc, RequestTimeout) {
     loop->runLoop();
 
     EXPECT_TRUE(is_method_cb_invoke);
+    EXPECT_EQ(rpc.getLatencyStats().at("A").timeout_count, 1u);
+    EXPECT_EQ(rpc.inFlightNumber(), 0u);
+}
+
+//! 经共享内存字节流通信，Rpc 不需要改动
+TEST(Rpc, OverShmStream) {
+    LogOutput_Enable();
+    auto loop = event::Loop::New();
+    SetScopeExitAction([=] { delete loop; LogOutput_Disable(); });
+
+    network::ShmStream stream_a(loop), stream_b(loop);
+    ASSERT_TRUE(stream_a.create());
+    ASSERT_TRUE(stream_b.attach(stream_a.fds()));
+
+    RawStreamProto proto_a, proto_b;
+    Rpc rpc_a(loop), rpc_b(loop);
+    rpc_a.initialize(&proto_a);
+    rpc_b.initialize(&proto_b);
+
+    auto bind_stream = [] (network::ShmStream &stream, Proto &proto) {
+        proto.setSendCallback([&stream] (const void *data_ptr, size_t data_size) { stream.send(data_ptr, data_size); });
+        stream.setReceiveCallback(
+            [&proto] (network::Buffer &buff) {
+                while (buff.readableSize() > 0) {
+                    auto ret = proto.onRecvData(buff.readableBegin(), buff.readableSize());
+                    if (ret <= 0)
+                        break;
+                    buff.hasRead(ret);
+                }
+            }, 0
+        );
+        stream.enable();
+    };
+    bind_stream(stream_a, proto_a);
+    bind_stream(stream_b, proto_b);
+
+    rpc_b.addService("echo",
+        [] (int64_t, const Json &js_params, int &, Json &js_result) {
+            js_result = js_params;
+            return true;
+        }
+    );
+
+    const int kRequestNum = 1000;
+    int respond_count = 0;
+    loop->run(
+        [&] {
+            for (int i = 0; i < kRequestNum; ++i) {
+                rpc_a.request("echo", Json{{"index", i}, {"data", std::string(i, 'x')}},
+                    [&, i] (int errcode, const Json &js_result) {
+                        EXPECT_EQ(errcode, 0);
+                        EXPECT_EQ(js_result["index"], i);
+                        if (++respond_count == kRequestNum)
+                            loop->exitLoop();
+                    }
+                );
+            }
+        }
+    );
+    loop->exitLoop(std::chrono::seconds(3));
+    loop->runLoop();
+
+    EXPECT_EQ(respond_count, kRequestNum);
+
+    rpc_a.cleanup();
+    rpc_b.cleanup();
 }
 
 }
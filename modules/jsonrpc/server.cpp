@@ -0,0 +1,331 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "server.h"
+
+#include <tbox/base/log.h>
+#include <tbox/base/assert.h>
+#include <tbox/base/json.hpp>
+#include <tbox/base/catch_throw.h>
+#include <tbox/eventx/thread_pool.h>
+
+#include "proto.h"
+#include "protos/raw_stream_proto.h"
+#include "inner_types.h"
+
+namespace tbox {
+namespace jsonrpc {
+
+using namespace std::placeholders;
+
+struct Server::Connection {
+    ConnToken client;
+    Proto *sp_proto = nullptr;
+
+    ~Connection() { CHECK_DELETE_OBJ(sp_proto); }
+};
+
+namespace {
+//! 交给线程池执行的请求
+struct WorkerTask {
+    Json js_params;
+    int errcode = 0;
+    Json js_result;
+    bool is_done = false;
+};
+}
+
+Server::Server(event::Loop *wp_loop)
+    : wp_loop_(wp_loop)
+    , tcp_server_(wp_loop)
+    , dispatcher_(wp_loop)
+    , request_timeout_(wp_loop)
+{
+    request_timeout_.setCallback(std::bind(&Server::onRequestTimeout, this, _1));
+}
+
+Server::~Server()
+{
+    cleanup();
+}
+
+bool Server::initialize(const network::SockAddr &bind_addr, int listen_backlog, int timeout_sec)
+{
+    if (!tcp_server_.initialize(bind_addr, listen_backlog))
+        return false;
+
+    request_timeout_.initialize(std::chrono::seconds(1), timeout_sec);
+    dispatcher_.initialize(timeout_sec,
+        [this] (const ConnToken &client) -> Proto* {
+            auto conn = findConnection(client);
+            return conn != nullptr ? conn->sp_proto : nullptr;
+        }
+    );
+
+    tcp_server_.setConnectedCallback(std::bind(&Server::onTcpConnected, this, _1));
+    tcp_server_.setDisconnectedCallback(std::bind(&Server::onTcpDisconnected, this, _1));
+    tcp_server_.setReceiveCallback(std::bind(&Server::onTcpReceived, this, _1, _2), 0);
+
+    life_tag_ = std::make_shared<int>(0);
+    return true;
+}
+
+bool Server::start()
+{
+    return tcp_server_.start();
+}
+
+void Server::stop()
+{
+    tcp_server_.stop();
+    conn_number_ = 0;
+}
+
+void Server::cleanup()
+{
+    //! 还在线程池中的任务完成后不再回复
+    life_tag_.reset();
+
+    tcp_server_.cleanup();
+    conn_number_ = 0;
+
+    dispatcher_.cleanup();
+    request_timeout_.cleanup();
+    pending_requests_.clear();
+}
+
+void Server::addService(const std::string &method, ServiceCallback &&cb)
+{
+    dispatcher_.addService(method, std::move(cb));
+}
+
+void Server::addRawService(const std::string &method, RawServiceCallback &&cb)
+{
+    dispatcher_.addRawService(method, std::move(cb));
+}
+
+void Server::addWorkerService(const std::string &method, WorkerServiceCallback &&cb, int prio)
+{
+    //! 以 RawService 的形式注册，参数直接解析到任务中，因为视图在返回后就失效了
+    dispatcher_.addRawService(method,
+        [this, cb, prio] (const ConnToken &client, int64_t id, const JsonView &js_params, int &errcode, std::string &result_text) {
+            auto task = std::make_shared<WorkerTask>();
+            bool is_parse_fail = CatchThrow(
+                [&] {
+                    if (js_params.isText())
+                        task->js_params = Json::parse(js_params.text(), js_params.text() + js_params.textSize());
+                    else
+                        task->js_params = js_params.json();
+                }
+            );
+
+            if (is_parse_fail) {
+                LogNotice("parse params fail");
+                errcode = ErrorCode::kParseError;
+                return true;
+            }
+
+            auto backend_task = [task, cb] {
+                cb(task->js_params, task->errcode, task->js_result);
+                task->is_done = true;
+            };
+
+            if (wp_thread_pool_ == nullptr) {
+                CatchThrow(backend_task, true);
+                errcode = task->is_done ? task->errcode : ErrorCode::kInternalError;
+                if (errcode == 0)
+                    result_text = task->js_result.dump();
+                return true;
+            }
+
+            std::weak_ptr<int> life_tag = life_tag_;
+            wp_thread_pool_->execute(
+                std::move(backend_task),
+                [this, life_tag, task, client, id] {
+                    if (life_tag.expired() || id == 0)
+                        return;
+                    respond(client, id, task->is_done ? task->errcode : ErrorCode::kInternalError, task->js_result);
+                },
+                prio
+            );
+            return false;
+        }
+    );
+}
+
+bool Server::request(const ConnToken &client, const std::string &method, const Json &js_params, RequestCallback &&cb)
+{
+    auto conn = findConnection(client);
+    if (conn == nullptr) {
+        LogNotice("client not found, method: %s", method.c_str());
+        return false;
+    }
+
+    int64_t id = 0;
+    if (cb) {
+        id = ++id_alloc_;
+        pending_requests_[id] = PendingRequest{ client, std::move(cb) };
+        request_timeout_.add(id);
+    }
+
+    conn->sp_proto->sendRequest(id, method, js_params);
+    return true;
+}
+
+bool Server::request(const ConnToken &client, const std::string &method, RequestCallback &&cb)
+{
+    return request(client, method, Json(), std::move(cb));
+}
+
+bool Server::notify(const ConnToken &client, const std::string &method, const Json &js_params)
+{
+    return request(client, method, js_params, nullptr);
+}
+
+bool Server::notify(const ConnToken &client, const std::string &method)
+{
+    return request(client, method, Json(), nullptr);
+}
+
+void Server::respond(const ConnToken &client, int64_t id, int errcode, const Json &js_result)
+{
+    dispatcher_.respond(client, id, errcode, js_result);
+}
+
+void Server::respond(const ConnToken &client, int64_t id, const Json &js_result)
+{
+    dispatcher_.respond(client, id, js_result);
+}
+
+void Server::respond(const ConnToken &client, int64_t id, int errcode)
+{
+    dispatcher_.respond(client, id, errcode);
+}
+
+void Server::respond(const ConnToken &client, int64_t id, const JsonView &js_result)
+{
+    dispatcher_.respond(client, id, js_result);
+}
+
+void Server::respondByWriter(const ConnToken &client, int64_t id, const Proto::WriteJsonFunc &write_result)
+{
+    dispatcher_.respondByWriter(client, id, write_result);
+}
+
+bool Server::disconnect(const ConnToken &client)
+{
+    if (!tcp_server_.disconnect(client))
+        return false;
+
+    --conn_number_;
+    return true;
+}
+
+Server::Connection* Server::findConnection(const ConnToken &client) const
+{
+    return static_cast<Connection*>(tcp_server_.getContext(client));
+}
+
+void Server::onTcpConnected(const ConnToken &client)
+{
+    auto conn = new Connection;
+    conn->client = client;
+    conn->sp_proto = proto_factory_ ? proto_factory_() : new RawStreamProto;
+    TBOX_ASSERT(conn->sp_proto != nullptr);
+
+    conn->sp_proto->setRecvRequestViewCallback(
+        [this, client] (int64_t id, const std::string &method, const JsonView &js_params) {
+            dispatcher_.dispatch(client, id, method, js_params);
+        }
+    );
+    conn->sp_proto->setRecvCallback(nullptr, std::bind(&Server::onRecvRespond, this, conn, _1, _2, _3));
+    conn->sp_proto->setSendCallback(
+        [this, client] (const void *data_ptr, size_t data_size) {
+            tcp_server_.send(client, data_ptr, data_size);
+        }
+    );
+
+    //! 连接对象释放时一并释放
+    tcp_server_.setContext(client, conn, [] (void *ptr) { delete static_cast<Connection*>(ptr); });
+    ++conn_number_;
+
+    if (connected_cb_)
+        connected_cb_(client);
+}
+
+void Server::onTcpDisconnected(const ConnToken &client)
+{
+    --conn_number_;
+
+    if (disconnected_cb_)
+        disconnected_cb_(client);
+}
+
+void Server::onTcpReceived(const ConnToken &client, network::Buffer &buff)
+{
+    auto conn = findConnection(client);
+    if (conn == nullptr)
+        return;
+
+    while (buff.readableSize() > 0) {
+        auto ret = conn->sp_proto->onRecvData(buff.readableBegin(), buff.readableSize());
+        if (ret > 0) {
+            buff.hasRead(ret);
+        } else if (ret < 0) {
+            LogNotice("recv invalid data, disconnect");
+            disconnect(client);
+            return;
+        } else {
+            break;
+        }
+
+        //! 可能在处理请求时断开了连接
+        if (!tcp_server_.isClientValid(client))
+            return;
+    }
+}
+
+void Server::onRecvRespond(Connection *conn, int64_t id, int errcode, const Json &js_result)
+{
+    auto iter = pending_requests_.find(id);
+    if (iter == pending_requests_.end() || iter->second.client != conn->client)
+        return;
+
+    auto cb = std::move(iter->second.cb);
+    pending_requests_.erase(iter);
+
+    if (cb)
+        cb(errcode, js_result);
+}
+
+void Server::onRequestTimeout(int64_t id)
+{
+    auto iter = pending_requests_.find(id);
+    if (iter == pending_requests_.end())
+        return;
+
+    auto cb = std::move(iter->second.cb);
+    pending_requests_.erase(iter);
+
+    if (cb)
+        cb(ErrorCode::kRequestTimeout, Json());
+}
+
+}
+}
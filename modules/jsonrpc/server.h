@@ -0,0 +1,170 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_JSONRPC_SERVER_H_20251019
+#define TBOX_JSONRPC_SERVER_H_20251019
+
+#include <functional>
+#include <unordered_map>
+#include <memory>
+#include <tbox/base/defines.h>
+#include <tbox/base/json_fwd.h>
+#include <tbox/event/forward.h>
+#include <tbox/network/tcp_server.h>
+#include <tbox/eventx/timeout_monitor.hpp>
+
+#include "json_view.h"
+#include "proto.h"
+#include "dispatcher.h"
+
+namespace tbox {
+
+namespace eventx {
+class ThreadPool;
+}
+
+namespace jsonrpc {
+
+/**
+ * 基于 TcpServer 的 JSON-RPC 服务端
+ *
+ * 与每个连接各配一套 Proto + Rpc 不同，本类中所有连接共用同一张方法表与同一对超时监测器，
+ * 每个连接只有一个 Proto 对象，连接数多时开销很小
+ *
+ * 耗时的方法可以用 addWorkerService() 注册，交给线程池执行，结果回到主线程后再回复
+ */
+class Server {
+  public:
+    using ConnToken = network::TcpServer::ConnToken;
+
+    //! 创建每个连接所用的协议对象，默认是 RawStreamProto
+    using ProtoFactory = std::function<Proto*()>;
+
+    //! 同 Rpc::RequestCallback
+    using RequestCallback = std::function<void(int errcode, const Json &js_result)>;
+
+    //! 同 Rpc::ServiceCallback，多了发起请求的客户端
+    using ServiceCallback = Dispatcher<ConnToken>::ServiceCallback;
+    //! 同 Rpc::RawServiceCallback，多了发起请求的客户端
+    using RawServiceCallback = Dispatcher<ConnToken>::RawServiceCallback;
+
+    /**
+     * 在线程池中执行的方法
+     *
+     * 只能同步回复，在 worker 线程中执行，不能访问主线程中的对象
+     */
+    using WorkerServiceCallback = std::function<void(const Json &js_params, int &errcode, Json &js_result)>;
+
+    using ConnectedCallback     = std::function<void(const ConnToken &client)>;
+    using DisconnectedCallback  = std::function<void(const ConnToken &client)>;
+
+  public:
+    explicit Server(event::Loop *wp_loop);
+    virtual ~Server();
+
+    NONCOPYABLE(Server);
+    IMMOVABLE(Server);
+
+  public:
+    bool initialize(const network::SockAddr &bind_addr, int listen_backlog, int timeout_sec = 30);
+
+    //! 设置协议，须在 start() 前设置
+    void setProtoFactory(ProtoFactory &&factory) { proto_factory_ = std::move(factory); }
+    //! 设置执行 WorkerService 的线程池，不设置则在主线程中直接执行
+    void setThreadPool(eventx::ThreadPool *wp_thread_pool) { wp_thread_pool_ = wp_thread_pool; }
+
+    void setConnectedCallback(ConnectedCallback &&cb) { connected_cb_ = std::move(cb); }
+    void setDisconnectedCallback(DisconnectedCallback &&cb) { disconnected_cb_ = std::move(cb); }
+
+    bool start();
+    void stop();    //!< 停止服务，断开所有连接
+    void cleanup();
+
+    //! 添加方法被调用时的回调函数
+    void addService(const std::string &method, ServiceCallback &&cb);
+    void addRawService(const std::string &method, RawServiceCallback &&cb);
+    void addWorkerService(const std::string &method, WorkerServiceCallback &&cb, int prio = 0);
+
+    /**
+     * 向客户端发送请求（需要回复的）
+     *
+     * \return false   客户端不存在，不会回调 cb
+     *
+     * \note   客户端在回复前断开的，请求以超时结束
+     */
+    bool request(const ConnToken &client, const std::string &method, const Json &js_params, RequestCallback &&cb);
+    bool request(const ConnToken &client, const std::string &method, RequestCallback &&cb);
+
+    //! 向客户端发送通知（不需要回复的）
+    bool notify(const ConnToken &client, const std::string &method, const Json &js_params);
+    bool notify(const ConnToken &client, const std::string &method);
+
+    //! 发送异步回复
+    void respond(const ConnToken &client, int64_t id, int errcode, const Json &js_result);
+    void respond(const ConnToken &client, int64_t id, const Json &js_result);
+    void respond(const ConnToken &client, int64_t id, int errcode);
+    void respond(const ConnToken &client, int64_t id, const JsonView &js_result);
+    void respondByWriter(const ConnToken &client, int64_t id, const Proto::WriteJsonFunc &write_result);
+
+    bool disconnect(const ConnToken &client);
+    bool isClientValid(const ConnToken &client) const { return tcp_server_.isClientValid(client); }
+    size_t connectionNumber() const { return conn_number_; }
+
+  protected:
+    struct Connection;
+
+    void onTcpConnected(const ConnToken &client);
+    void onTcpDisconnected(const ConnToken &client);
+    void onTcpReceived(const ConnToken &client, network::Buffer &buff);
+
+    void onRecvRespond(Connection *conn, int64_t id, int errcode, const Json &js_result);
+    void onRequestTimeout(int64_t id);
+
+  private:
+    Connection* findConnection(const ConnToken &client) const;
+
+    //! 本端发往客户端、等待回复的请求
+    struct PendingRequest {
+        ConnToken client;
+        RequestCallback cb;
+    };
+
+    event::Loop *wp_loop_;
+    network::TcpServer tcp_server_;
+    eventx::ThreadPool *wp_thread_pool_ = nullptr;
+
+    ProtoFactory proto_factory_;
+    ConnectedCallback connected_cb_;
+    DisconnectedCallback disconnected_cb_;
+    size_t conn_number_ = 0;
+
+    Dispatcher<ConnToken> dispatcher_;  //!< 收到的请求的分发与回复，所有连接共用
+
+    int64_t id_alloc_ = 0;
+    std::unordered_map<int64_t, PendingRequest> pending_requests_;
+    eventx::TimeoutMonitor<int64_t> request_timeout_;   //! 请求超时监测，所有连接共用
+
+    //! 线程池中的任务完成时，用它判断本对象是否还在
+    std::shared_ptr<int> life_tag_;
+};
+
+}
+}
+
+#endif //TBOX_JSONRPC_SERVER_H_20251019
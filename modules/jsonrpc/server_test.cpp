@@ -0,0 +1,245 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <thread>
+#include <gtest/gtest.h>
+#include <tbox/base/json.hpp>
+#include <tbox/base/log_output.h>
+#include <tbox/base/scope_exit.hpp>
+#include <tbox/event/loop.h>
+#include <tbox/network/tcp_client.h>
+#include <tbox/eventx/thread_pool.h>
+
+#include "protos/raw_stream_proto.h"
+#include "rpc.h"
+#include "server.h"
+
+namespace tbox {
+namespace jsonrpc {
+
+namespace {
+
+const char *kServerAddr = "/tmp/tbox_jsonrpc_server_test.sock";
+
+//! 一个客户端：TcpClient + RawStreamProto + Rpc
+struct Client {
+    network::TcpClient tcp;
+    RawStreamProto proto;
+    Rpc rpc;
+
+    explicit Client(event::Loop *loop) : tcp(loop), rpc(loop) {
+        rpc.initialize(&proto, 3);
+        tcp.initialize(network::SockAddr::FromString(kServerAddr));
+        tcp.setReceiveCallback(
+            [this] (network::Buffer &buff) {
+                while (buff.readableSize() > 0) {
+                    auto ret = proto.onRecvData(buff.readableBegin(), buff.readableSize());
+                    if (ret <= 0)
+                        break;
+                    buff.hasRead(ret);
+                }
+            }, 0
+        );
+        proto.setSendCallback([this] (const void *data_ptr, size_t data_size) { tcp.send(data_ptr, data_size); });
+    }
+
+    ~Client() {
+        rpc.cleanup();
+        tcp.cleanup();
+    }
+};
+
+}
+
+TEST(Server, MultiClient) {
+    LogOutput_Enable();
+    auto loop = event::Loop::New();
+    SetScopeExitAction([=] { delete loop; LogOutput_Disable(); });
+
+    eventx::ThreadPool thread_pool(loop);
+    ASSERT_TRUE(thread_pool.initialize(1, 2));
+
+    const int kClientNum = 20;
+
+    Server server(loop);
+    ASSERT_TRUE(server.initialize(network::SockAddr::FromString(kServerAddr), kClientNum));
+    server.setThreadPool(&thread_pool);
+
+    //! 同步回复
+    server.addService("add",
+        [] (const Server::ConnToken &, int64_t, const Json &js_params, int &, Json &js_result) {
+            js_result = js_params.at(0).get<int>() + js_params.at(1).get<int>();
+            return true;
+        }
+    );
+
+    //! 异步回复：先向客户端反问，得到回复后再回复
+    server.addService("ask_back",
+        [&] (const Server::ConnToken &client, int64_t id, const Json &js_params, int &, Json &) {
+            server.request(client, "double", js_params,
+                [&server, client, id] (int errcode, const Json &js_result) {
+                    EXPECT_EQ(errcode, 0);
+                    server.respond(client, id, js_result);
+                }
+            );
+            return false;
+        }
+    );
+
+    //! 在线程池中执行
+    std::thread::id main_thread_id = std::this_thread::get_id();
+    server.addWorkerService("heavy",
+        [main_thread_id] (const Json &js_params, int &, Json &js_result) {
+            EXPECT_NE(std::this_thread::get_id(), main_thread_id);
+            js_result = js_params.get<int>() * 10;
+        }
+    );
+
+    server.addWorkerService("throw",
+        [] (const Json &, int &, Json &) { throw std::runtime_error("oops"); }
+    );
+
+    int connected_count = 0;
+    server.setConnectedCallback([&] (const Server::ConnToken &) { ++connected_count; });
+
+    ASSERT_TRUE(server.start());
+
+    std::vector<Client*> clients;
+    SetScopeExitAction([&] { for (auto c : clients) delete c; });
+
+    int done_count = 0;
+    auto on_done = [&] { if (++done_count == kClientNum * 4) loop->exitLoop(); };
+
+    for (int i = 0; i < kClientNum; ++i) {
+        auto client = new Client(loop);
+        clients.push_back(client);
+
+        client->rpc.addService("double",
+            [] (int64_t, const Json &js_params, int &, Json &js_result) {
+                js_result = js_params.get<int>() * 2;
+                return true;
+            }
+        );
+
+        client->tcp.setConnectedCallback(
+            [&, client, i] {
+                client->rpc.request("add", Json::array({i, 1}),
+                    [&, i] (int errcode, const Json &js_result) {
+                        EXPECT_EQ(errcode, 0);
+                        EXPECT_EQ(js_result, Json(i + 1));
+                        on_done();
+                    }
+                );
+                client->rpc.request("ask_back", i,
+                    [&, i] (int errcode, const Json &js_result) {
+                        EXPECT_EQ(errcode, 0);
+                        EXPECT_EQ(js_result, Json(i * 2));
+                        on_done();
+                    }
+                );
+                client->rpc.request("heavy", i,
+                    [&, i] (int errcode, const Json &js_result) {
+                        EXPECT_EQ(errcode, 0);
+                        EXPECT_EQ(js_result, Json(i * 10));
+                        on_done();
+                    }
+                );
+                client->rpc.request("throw",
+                    [&] (int errcode, const Json &) {
+                        EXPECT_EQ(errcode, -32603);
+                        on_done();
+                    }
+                );
+            }
+        );
+        client->tcp.start();
+    }
+
+    loop->exitLoop(std::chrono::seconds(3));
+    loop->runLoop();
+
+    EXPECT_EQ(done_count, kClientNum * 4);
+    EXPECT_EQ(connected_count, kClientNum);
+    EXPECT_EQ(server.connectionNumber(), size_t(kClientNum));
+
+    server.cleanup();
+    thread_pool.cleanup();
+}
+
+TEST(Server, Disconnect) {
+    LogOutput_Enable();
+    auto loop = event::Loop::New();
+    SetScopeExitAction([=] { delete loop; LogOutput_Disable(); });
+
+    Server server(loop);
+    ASSERT_TRUE(server.initialize(network::SockAddr::FromString(kServerAddr), 10));
+
+    //! 没有设置线程池，在主线程中直接执行
+    server.addWorkerService("heavy",
+        [] (const Json &js_params, int &, Json &js_result) { js_result = js_params; }
+    );
+
+    Server::ConnToken last_client;
+    server.addService("bye",
+        [&] (const Server::ConnToken &client, int64_t, const Json &, int &, Json &) {
+            last_client = client;
+            server.disconnect(client);
+            return false;
+        }
+    );
+
+    int disconnected_count = 0;
+    server.setDisconnectedCallback([&] (const Server::ConnToken &) { ++disconnected_count; });
+    ASSERT_TRUE(server.start());
+
+    Client client(loop);
+    bool is_heavy_done = false;
+    client.tcp.setConnectedCallback(
+        [&] {
+            client.rpc.request("heavy", 12,
+                [&] (int errcode, const Json &js_result) {
+                    EXPECT_EQ(errcode, 0);
+                    EXPECT_EQ(js_result, Json(12));
+                    is_heavy_done = true;
+                    client.rpc.notify("bye");
+                }
+            );
+        }
+    );
+
+    bool is_client_disconnected = false;
+    client.tcp.setDisconnectedCallback([&] { is_client_disconnected = true; loop->exitLoop(); });
+    client.tcp.start();
+
+    loop->exitLoop(std::chrono::seconds(3));
+    loop->runLoop();
+
+    EXPECT_TRUE(is_heavy_done);
+    EXPECT_TRUE(is_client_disconnected);
+    EXPECT_EQ(server.connectionNumber(), 0u);
+    EXPECT_FALSE(server.isClientValid(last_client));
+    EXPECT_FALSE(server.notify(last_client, "hello"));
+    //! 主动断开的不回调
+    EXPECT_EQ(disconnected_count, 0);
+
+    server.cleanup();
+}
+
+}
+}
@@ -18,12 +18,13 @@
  * of the source tree.
  */
 #include "async_sink.h"
+#include "encoder.h"
 
 #include <cstring>
-#include <algorithm>
 #include <iostream>
 
 constexpr uint32_t LOG_MAX_LEN = (100 << 10);   //! 限定单条日志最大长度
+constexpr size_t LOG_LINE_KEEP_CAPACITY = 4096; //! 编码缓冲超过该容量就释放，避免长日志后一直占用
 
 namespace tbox {
 namespace log {
@@ -50,122 +51,153 @@ void AsyncSink::onDisable()
     is_pipe_inited_ = false;
 }
 
-void AsyncSink::onLogFrontEnd(const LogContent *content)
+/**
+ * 每条日志在管道中都是一个连续的帧，布局如下：
+ * [LogContent] [text] [fields_size:uint32_t] { [LogField] [key\0] [字串值] } * field_num [padding]
+ * 其中，只有 field_num 不为0时才有 fields_size 及之后的字段部分；
+ * LogField 中的指针在后端无效，由 restoreFields() 重新指向帧中的数据；
+ * 帧长按 LogContent 的对齐要求补齐，以便后端直接在缓冲上访问
+ */
+namespace {
+size_t CalcFieldsSize(const LogContent *content)
 {
-    async_pipe_.append(content, sizeof(LogContent));
-    if (content->text_len != 0)
-        async_pipe_.append(content->text_ptr, content->text_len);
+    size_t fields_size = 0;
+    for (uint32_t i = 0; i < content->field_num; ++i) {
+        const auto &field = content->fields[i];
+        fields_size += sizeof(LogField) + ::strlen(field.key) + 1;
+        if (field.type == LOG_FIELD_TYPE_STRING)
+            fields_size += field.value.s.len;
+    }
+    return fields_size;
 }
 
-void AsyncSink::onLogBackEndReadPipe(const void *data_ptr, size_t data_size)
+inline size_t AlignFrameSize(size_t size)
 {
-    constexpr auto LogContentSize = sizeof(LogContent);
-    const char *p = reinterpret_cast<const char*>(data_ptr);
-
-    buffer_.reserve(buffer_.size() + data_size);
-    std::back_insert_iterator<std::vector<char>>  back_insert_iter(buffer_);
-    std::copy(p, p + data_size, back_insert_iter);
-
-    bool is_need_flush = false;
-    while (buffer_.size() >= LogContentSize) {
-        auto content = reinterpret_cast<LogContent*>(buffer_.data());
-        auto frame_size = LogContentSize + content->text_len;
-        if (frame_size > buffer_.size())    //! 总结长度不够
-            break;
-        content->text_ptr = reinterpret_cast<const char *>(content + 1);
-        onLogBackEnd(content);
-        is_need_flush = true;
-        buffer_.erase(buffer_.begin(), (buffer_.begin() + frame_size));
-    }
-
-    if (is_need_flush) {
-        flushLog();
-        if (buffer_.capacity() > 1024)
-            buffer_.shrink_to_fit();
-    }
+    constexpr size_t kAlign = alignof(LogContent);
+    return (size + kAlign - 1) & ~(kAlign - 1);
+}
 }
 
-void AsyncSink::onLogBackEnd(const LogContent *content)
+void AsyncSink::onLogFrontEnd(const LogContent *content)
 {
-    size_t buff_size = 1024;    //! 初始大小，可应对绝大数情况
+    size_t fields_size = (content->field_num != 0) ? CalcFieldsSize(content) : 0;
+    size_t frame_size = sizeof(LogContent) + content->text_len;
+    if (content->field_num != 0)
+        frame_size += sizeof(uint32_t) + fields_size;
+    frame_size = AlignFrameSize(frame_size);
+
+    //! 直接在管道的缓冲上构造帧，整帧不会被拆分到两个缓冲中
+    char *p = static_cast<char*>(async_pipe_.reserve(frame_size));
+    if (p == nullptr)
+        return;
 
-    udpateTimestampStr(content->timestamp.sec);
+    ::memcpy(p, content, sizeof(LogContent));
+    p += sizeof(LogContent);
 
-    //! 加循环为了应对缓冲不够的情况
-    for (;;) {
-        char buff[buff_size];
-        size_t pos = 0;
+    if (content->text_len != 0) {
+        ::memcpy(p, content->text_ptr, content->text_len);
+        p += content->text_len;
+    }
+
+    if (content->field_num != 0) {
+        uint32_t size = fields_size;
+        ::memcpy(p, &size, sizeof(size));
+        p += sizeof(size);
 
-#define REMAIN_SIZE ((buff_size > pos) ? (buff_size - pos) : 0)
-#define WRITE_PTR   (buff + pos)
+        for (uint32_t i = 0; i < content->field_num; ++i) {
+            const auto &field = content->fields[i];
+            ::memcpy(p, &field, sizeof(LogField));
+            p += sizeof(LogField);
 
-        size_t len = 0;
+            auto key_size = ::strlen(field.key) + 1;
+            ::memcpy(p, field.key, key_size);
+            p += key_size;
 
-        //! 开启色彩，显示日志等级
-        if (enable_color_) {
-            len = snprintf(WRITE_PTR, REMAIN_SIZE, "\033[%sm", LOG_LEVEL_COLOR_CODE[content->level]);
-            pos += len;
+            if (field.type == LOG_FIELD_TYPE_STRING && field.value.s.len != 0) {
+                ::memcpy(p, field.value.s.ptr, field.value.s.len);
+                p += field.value.s.len;
+            }
         }
+    }
 
-        //! 打印等级、时间戳、线程号、模块名
-        len = snprintf(WRITE_PTR, REMAIN_SIZE, "%c %s.%06u %ld %s ",
-                       LOG_LEVEL_LEVEL_CODE[content->level],
-                       timestamp_str_, content->timestamp.usec,
-                       content->thread_id, content->module_id);
-        pos += len;
+    async_pipe_.commit(frame_size);
+}
 
-        if (content->func_name != nullptr) {
-            len = snprintf(WRITE_PTR, REMAIN_SIZE, "%s() ", content->func_name);
-            pos += len;
-        }
+void AsyncSink::onLogBackEndReadPipe(const void *data_ptr, size_t data_size)
+{
+    constexpr auto LogContentSize = sizeof(LogContent);
 
-        if (content->text_len > 0) {
-            if (REMAIN_SIZE >= content->text_len)
-                memcpy(WRITE_PTR, content->text_ptr, content->text_len);
-            pos += content->text_len;
+    //! 帧不会被拆分，可以直接在缓冲上解析，不需要再拷贝拼接
+    char *p = static_cast<char*>(const_cast<void*>(data_ptr));
+    char *end = p + data_size;
 
-            if (REMAIN_SIZE >= 1)    //! 追加一个空格
-                *WRITE_PTR = ' ';
-            ++pos;
-        }
+    bool is_need_flush = false;
+    while (static_cast<size_t>(end - p) >= LogContentSize) {
+        auto content = reinterpret_cast<LogContent*>(p);
+        auto frame_size = LogContentSize + content->text_len;
+        content->text_ptr = p + LogContentSize;
 
-        if (content->file_name != nullptr) {
-            len = snprintf(WRITE_PTR, REMAIN_SIZE, "-- %s:%d", content->file_name, content->line);
-            pos += len;
+        if (content->field_num != 0) {
+            uint32_t fields_size = 0;
+            ::memcpy(&fields_size, p + frame_size, sizeof(fields_size));
+            restoreFields(content, p + frame_size + sizeof(fields_size));
+            frame_size += sizeof(fields_size) + fields_size;
         }
 
-        if (enable_color_) {
-            if (REMAIN_SIZE >= 4)
-                memcpy(WRITE_PTR, "\033[0m", 4);
-            pos += 4;
-        }
+        onLogBackEnd(content);
+        is_need_flush = true;
+        p += AlignFrameSize(frame_size);
+    }
 
-        if (REMAIN_SIZE >= 2) {
-            *WRITE_PTR = '\n';  //! 追加结束符
-            ++pos;
-            *WRITE_PTR = '\0';  //! 追加结束符
-            ++pos;
-        } else {
-          pos += 2;
-        }
+    if (is_need_flush)
+        flushLog();
+}
 
-#undef REMAIN_SIZE
-#undef WRITE_PTR
+void AsyncSink::restoreFields(LogContent *content, const char *fields_ptr)
+{
+    fields_.resize(content->field_num);
+    for (auto &field : fields_) {
+        ::memcpy(&field, fields_ptr, sizeof(LogField));
+        fields_ptr += sizeof(LogField);
 
-        //! 如果缓冲区是够用的，就完成
-        if (pos <= buff_size) {
-            appendLog(buff, pos);
-            break;
+        field.key = fields_ptr;
+        fields_ptr += ::strlen(fields_ptr) + 1;
+
+        if (field.type == LOG_FIELD_TYPE_STRING) {
+            field.value.s.ptr = fields_ptr;
+            fields_ptr += field.value.s.len;
         }
+    }
+    content->fields = fields_.data();
+}
 
-        //! 否则扩展缓冲区，重来
-        buff_size = pos;
+void AsyncSink::onLogBackEnd(const LogContent *content)
+{
+    udpateTimestampStr(content->timestamp.sec);
 
-        if (buff_size > LOG_MAX_LEN) {
-            std::cerr << "WARN: log length " << buff_size << ", too long!" << std::endl;
+    line_.clear();
+    switch (format_) {
+        case Format::kJson:
+            EncodeJson(content, timestamp_str_, line_);
             break;
-        }
+        case Format::kLogfmt:
+            EncodeLogfmt(content, timestamp_str_, line_);
+            break;
+        default:
+            EncodeText(content, timestamp_str_, enable_color_, line_);
+    }
+    line_.push_back('\n');
+
+    if (line_.size() >= LOG_MAX_LEN) {
+        std::cerr << "WARN: log length " << line_.size() << ", too long!" << std::endl;
+        return;
     }
+
+    //! 与原来保持一致，长度包含结束符'\0'
+    appendLog(line_.c_str(), line_.size() + 1);
+
+    if (line_.capacity() > LOG_LINE_KEEP_CAPACITY)
+        std::string().swap(line_);
 }
 
 }
@@ -23,6 +23,7 @@
 #include "sink.h"
 
 #include <vector>
+#include <string>
 #include <tbox/util/async_pipe.h>
 
 namespace tbox {
@@ -41,6 +42,7 @@ class AsyncSink : public Sink {
 
     virtual void onLogFrontEnd(const LogContent *content) override;
     void onLogBackEndReadPipe(const void *data_ptr, size_t data_size);
+    void restoreFields(LogContent *content, const char *fields_ptr);
     void onLogBackEnd(const LogContent *content);
     virtual void appendLog(const char *str, size_t len) = 0;
     virtual void flushLog() { }
@@ -50,7 +52,8 @@ class AsyncSink : public Sink {
     util::AsyncPipe async_pipe_;
     bool is_pipe_inited_ = false;
 
-    std::vector<char> buffer_;
+    std::vector<LogField> fields_;  //!< 后端还原出来的结构化字段
+    std::string line_;              //!< 后端编码日志行用的缓冲
 };
 
 }
@@ -23,6 +23,7 @@
 #include <chrono>
 #include <algorithm>
 
+#include <tbox/base/log_kv.h>
 #include "async_sink.h"
 
 using namespace std;
@@ -88,6 +89,80 @@ TEST(AsyncSink, LongString)
     ch.cleanup();
 }
 
+class CaptureAsyncSink : public AsyncSink {
+  public:
+    std::vector<std::string> lines;
+  protected:
+    virtual void appendLog(const char *str, size_t len) {
+        lines.emplace_back(str, len - 1);
+    }
+};
+
+TEST(AsyncSink, KeyValueText)
+{
+    CaptureAsyncSink ch;
+    ch.enable();
+
+    std::string name(2000, 'n');   //! 超过管道缓冲大小，验证能被正确拼接
+    LogKvInfo("text", {"a", 1}, {"name", name});
+    LogKvInfo("text");
+
+    ch.cleanup();
+
+    ASSERT_EQ(ch.lines.size(), 2u);
+    EXPECT_NE(ch.lines[0].find(" text a=1 name=" + name + " -- "), std::string::npos);
+    EXPECT_NE(ch.lines[1].find(" text -- "), std::string::npos);
+}
+
+TEST(AsyncSink, KeyValueJson)
+{
+    CaptureAsyncSink ch;
+    ch.setFormat(Sink::Format::kJson);
+    ch.enable();
+
+    LogKvInfo("json", {"a", 2}, {"b", "x y"});
+
+    ch.cleanup();
+
+    ASSERT_EQ(ch.lines.size(), 1u);
+    EXPECT_EQ(ch.lines[0].front(), '{');
+    EXPECT_NE(ch.lines[0].find(R"("msg":"json","file":"async_sink_test.cpp")"), std::string::npos);
+    EXPECT_NE(ch.lines[0].find(R"("a":2,"b":"x y"})"), std::string::npos);
+}
+
+TEST(AsyncSink, KeyValueLogfmt)
+{
+    CaptureAsyncSink ch;
+    ch.setFormat(Sink::Format::kLogfmt);
+    ch.enable();
+
+    LogKvInfo("logfmt", {"a", 3}, {"b", "x y"});
+    LogInfo("%d", 4);
+
+    ch.cleanup();
+
+    ASSERT_EQ(ch.lines.size(), 2u);
+    EXPECT_NE(ch.lines[0].find(" msg=logfmt "), std::string::npos);
+    EXPECT_NE(ch.lines[0].find(R"( a=3 b="x y")"), std::string::npos);
+    EXPECT_NE(ch.lines[1].find(" msg=4 "), std::string::npos);
+}
+
+TEST(AsyncSink, KeyValueFilter)
+{
+    CaptureAsyncSink ch;
+    ch.enable();
+    ch.setLevel(LOG_LEVEL_INFO);
+    ch.setLevel(LOG_MODULE_ID, LOG_LEVEL_WARN);
+
+    LogKvInfo("filtered", {"a", 1});
+    LogKvWarn("passed", {"a", 2});
+
+    ch.cleanup();
+
+    ASSERT_EQ(ch.lines.size(), 1u);
+    EXPECT_NE(ch.lines[0].find("passed a=2"), std::string::npos);
+}
+
 #include <tbox/event/loop.h>
 using namespace tbox::event;
 
@@ -0,0 +1,308 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "encoder.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace tbox {
+namespace log {
+
+namespace {
+
+const char* LOG_LEVEL_NAME[LOG_LEVEL_MAX] = {
+    "fatal", "error", "warn", "notice", "important", "info", "debug", "trace"
+};
+
+template <typename ... Args>
+void AppendFormat(std::string &out, const char *fmt, Args ... args)
+{
+    char tmp[32];
+    int len = snprintf(tmp, sizeof(tmp), fmt, args...);
+    if (len > 0)
+        out.append(tmp, (static_cast<size_t>(len) < sizeof(tmp)) ? len : (sizeof(tmp) - 1));
+}
+
+//! 热路径上的整数转字串，避免 snprintf() 解析格式串的开销
+void AppendDecimal(unsigned long long value, std::string &out)
+{
+    char tmp[24];
+    char *p = tmp + sizeof(tmp);
+    do {
+        *--p = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    out.append(p, tmp + sizeof(tmp));
+}
+
+void AppendDecimal(long long value, std::string &out)
+{
+    if (value < 0) {
+        out.push_back('-');
+        AppendDecimal(0ull - static_cast<unsigned long long>(value), out);
+    } else {
+        AppendDecimal(static_cast<unsigned long long>(value), out);
+    }
+}
+
+void AppendTimestamp(const LogContent *content, const char *timestamp_str, std::string &out)
+{
+    char usec_str[7] = { '.' };
+    uint32_t usec = content->timestamp.usec;
+    for (int i = 6; i > 0; --i) {
+        usec_str[i] = '0' + (usec % 10);
+        usec /= 10;
+    }
+
+    out += timestamp_str;
+    out.append(usec_str, sizeof(usec_str));
+}
+
+void AppendJsonString(const char *str, size_t len, std::string &out)
+{
+    out.push_back('"');
+    const char *seg_begin = str;
+    for (const char *p = str, *end = str + len; p != end; ++p) {
+        unsigned char c = *p;
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        out.append(seg_begin, p);
+        seg_begin = p + 1;
+
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:   AppendFormat(out, "\\u%04x", c);
+        }
+    }
+    out.append(seg_begin, str + len);
+    out.push_back('"');
+}
+
+void AppendJsonString(const char *str, std::string &out)
+{
+    AppendJsonString(str, ::strlen(str), out);
+}
+
+//! logfmt 中，含空格、等号、引号、控制字符的值，或是空值，需要加引号
+bool IsLogfmtNeedQuote(const char *str, size_t len)
+{
+    if (len == 0)
+        return true;
+
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = str[i];
+        if (c <= ' ' || c == '=' || c == '"' || c == '\\')
+            return true;
+    }
+    return false;
+}
+
+void AppendLogfmtString(const char *str, size_t len, std::string &out)
+{
+    if (!IsLogfmtNeedQuote(str, len)) {
+        out.append(str, len);
+        return;
+    }
+    //! 转义规则与JSON字串一致
+    AppendJsonString(str, len, out);
+}
+
+void AppendLogfmtString(const char *str, std::string &out)
+{
+    AppendLogfmtString(str, ::strlen(str), out);
+}
+
+//! 输出数值类型的字段值，返回false表示是字串类型，需调用者处理
+bool AppendScalarValue(const LogField &field, bool is_json, std::string &out)
+{
+    switch (field.type) {
+        case LOG_FIELD_TYPE_BOOL:
+            out += field.value.b ? "true" : "false";
+            return true;
+
+        case LOG_FIELD_TYPE_INT:
+            AppendDecimal(static_cast<long long>(field.value.i), out);
+            return true;
+
+        case LOG_FIELD_TYPE_UINT:
+            AppendDecimal(static_cast<unsigned long long>(field.value.u), out);
+            return true;
+
+        case LOG_FIELD_TYPE_DOUBLE:
+            if (is_json && !std::isfinite(field.value.d))
+                out += "null";  //! JSON 不支持 nan 与 inf
+            else
+                AppendFormat(out, "%.15g", field.value.d);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+}
+
+void EncodeFields(const LogContent *content, std::string &out)
+{
+    for (uint32_t i = 0; i < content->field_num; ++i) {
+        const auto &field = content->fields[i];
+        out.push_back(' ');
+        out += field.key;
+        out.push_back('=');
+        if (!AppendScalarValue(field, false, out))
+            out.append(field.value.s.ptr, field.value.s.len);
+    }
+}
+
+void EncodeText(const LogContent *content, const char *timestamp_str, bool enable_color, std::string &out)
+{
+    //! 开启色彩，显示日志等级
+    if (enable_color) {
+        out += "\033[";
+        out += LOG_LEVEL_COLOR_CODE[content->level];
+        out.push_back('m');
+    }
+
+    //! 打印等级、时间戳、线程号、模块名
+    out.push_back(LOG_LEVEL_LEVEL_CODE[content->level]);
+    out.push_back(' ');
+    AppendTimestamp(content, timestamp_str, out);
+    out.push_back(' ');
+    AppendDecimal(static_cast<long long>(content->thread_id), out);
+    out.push_back(' ');
+    out += content->module_id;
+    out.push_back(' ');
+
+    if (content->func_name != nullptr) {
+        out += content->func_name;
+        out += "() ";
+    }
+
+    if (content->text_len > 0) {
+        out.append(content->text_ptr, content->text_len);
+        if (content->field_num == 0)
+            out.push_back(' ');
+    }
+
+    if (content->field_num > 0) {
+        //! EncodeFields() 以空格开头，如果前面没有内容就去掉多余的空格
+        if (content->text_len == 0)
+            out.pop_back();
+        EncodeFields(content, out);
+        out.push_back(' ');
+    }
+
+    if (content->file_name != nullptr) {
+        out += "-- ";
+        out += content->file_name;
+        out.push_back(':');
+        AppendDecimal(static_cast<long long>(content->line), out);
+    }
+
+    if (enable_color)
+        out += "\033[0m";
+}
+
+void EncodeJson(const LogContent *content, const char *timestamp_str, std::string &out)
+{
+    out += "{\"time\":\"";
+    AppendTimestamp(content, timestamp_str, out);
+    out += "\",\"level\":\"";
+    out += LOG_LEVEL_NAME[content->level];
+    out += "\",\"thread\":";
+    AppendDecimal(static_cast<long long>(content->thread_id), out);
+    out += ",\"module\":";
+    AppendJsonString(content->module_id, out);
+
+    if (content->func_name != nullptr) {
+        out += ",\"func\":";
+        AppendJsonString(content->func_name, out);
+    }
+
+    if (content->text_len > 0) {
+        out += ",\"msg\":";
+        AppendJsonString(content->text_ptr, content->text_len, out);
+    }
+
+    if (content->file_name != nullptr) {
+        out += ",\"file\":";
+        AppendJsonString(content->file_name, out);
+        out += ",\"line\":";
+        AppendDecimal(static_cast<long long>(content->line), out);
+    }
+
+    for (uint32_t i = 0; i < content->field_num; ++i) {
+        const auto &field = content->fields[i];
+        out.push_back(',');
+        AppendJsonString(field.key, out);
+        out.push_back(':');
+        if (!AppendScalarValue(field, true, out))
+            AppendJsonString(field.value.s.ptr, field.value.s.len, out);
+    }
+
+    out.push_back('}');
+}
+
+void EncodeLogfmt(const LogContent *content, const char *timestamp_str, std::string &out)
+{
+    out += "time=\"";
+    AppendTimestamp(content, timestamp_str, out);
+    out += "\" level=";
+    out += LOG_LEVEL_NAME[content->level];
+    out += " thread=";
+    AppendDecimal(static_cast<long long>(content->thread_id), out);
+    out += " module=";
+    AppendLogfmtString(content->module_id, out);
+
+    if (content->func_name != nullptr) {
+        out += " func=";
+        AppendLogfmtString(content->func_name, out);
+    }
+
+    if (content->text_len > 0) {
+        out += " msg=";
+        AppendLogfmtString(content->text_ptr, content->text_len, out);
+    }
+
+    if (content->file_name != nullptr) {
+        out += " file=";
+        AppendLogfmtString(content->file_name, out);
+        out += " line=";
+        AppendDecimal(static_cast<long long>(content->line), out);
+    }
+
+    for (uint32_t i = 0; i < content->field_num; ++i) {
+        const auto &field = content->fields[i];
+        out.push_back(' ');
+        out += field.key;
+        out.push_back('=');
+        if (!AppendScalarValue(field, false, out))
+            AppendLogfmtString(field.value.s.ptr, field.value.s.len, out);
+    }
+}
+
+}
+}
@@ -0,0 +1,50 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_LOG_ENCODER_H_20251019
+#define TBOX_LOG_ENCODER_H_20251019
+
+/**
+ * 日志编码器
+ *
+ * 将 LogContent 编码成一行日志，追加到 out 尾部，不含换行符。
+ * 提供三种格式：
+ * - Text  : 与原有格式保持一致，结构化字段以 key=value 形式附在内容后面；
+ * - Json  : 一行一个JSON对象（JSON Lines），便于日志系统直接采集；
+ * - Logfmt: key=value 形式，字串中有空格或特殊字符时加引号；
+ */
+
+#include <string>
+#include <tbox/base/log_imp.h>
+
+namespace tbox {
+namespace log {
+
+//! timestamp_str 格式为 "2022-04-12 14:33:30"，由 Sink::udpateTimestampStr() 生成
+void EncodeText(const LogContent *content, const char *timestamp_str, bool enable_color, std::string &out);
+void EncodeJson(const LogContent *content, const char *timestamp_str, std::string &out);
+void EncodeLogfmt(const LogContent *content, const char *timestamp_str, std::string &out);
+
+//! 仅编码结构化字段，格式为 " key=value key=value"
+void EncodeFields(const LogContent *content, std::string &out);
+
+}
+}
+
+#endif //TBOX_LOG_ENCODER_H_20251019
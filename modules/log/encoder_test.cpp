@@ -0,0 +1,91 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <tbox/base/log_kv.h>
+
+#include "encoder.h"
+
+using namespace tbox::log;
+
+namespace {
+
+LogContent MakeTestContent(const LogField *fields, uint32_t field_num)
+{
+    LogContent content = {
+        .thread_id = 100,
+        .timestamp = { .sec = 0, .usec = 123 },
+        .module_id = "test",
+        .func_name = "func",
+        .file_name = "a.cpp",
+        .line = 12,
+        .level = LOG_LEVEL_INFO,
+        .text_len = 5,
+        .text_ptr = "hello",
+        .field_num = field_num,
+        .fields = fields,
+    };
+    return content;
+}
+
+}
+
+TEST(Encoder, Text)
+{
+    LogKvField fields[] = { {"uid", 1001}, {"name", "bob"} };
+    auto content = MakeTestContent(fields, 2);
+
+    std::string out;
+    EncodeText(&content, "2025-10-19 10:00:00", false, out);
+    EXPECT_EQ(out, "I 2025-10-19 10:00:00.000123 100 test func() hello uid=1001 name=bob -- a.cpp:12");
+}
+
+TEST(Encoder, TextWithoutFields)
+{
+    auto content = MakeTestContent(nullptr, 0);
+
+    std::string out;
+    EncodeText(&content, "2025-10-19 10:00:00", false, out);
+    EXPECT_EQ(out, "I 2025-10-19 10:00:00.000123 100 test func() hello -- a.cpp:12");
+}
+
+TEST(Encoder, Json)
+{
+    LogKvField fields[] = {
+        {"uid", 1001}, {"ratio", 0.5}, {"ok", true}, {"size", 12u}, {"path", "a\"b\\c\n"}
+    };
+    auto content = MakeTestContent(fields, 5);
+
+    std::string out;
+    EncodeJson(&content, "2025-10-19 10:00:00", out);
+    EXPECT_EQ(out, R"({"time":"2025-10-19 10:00:00.000123","level":"info","thread":100,"module":"test",)"
+                   R"("func":"func","msg":"hello","file":"a.cpp","line":12,)"
+                   R"("uid":1001,"ratio":0.5,"ok":true,"size":12,"path":"a\"b\\c\n"})");
+}
+
+TEST(Encoder, Logfmt)
+{
+    LogKvField fields[] = { {"uid", -1}, {"name", "bob smith"}, {"empty", ""} };
+    auto content = MakeTestContent(fields, 3);
+
+    std::string out;
+    EncodeLogfmt(&content, "2025-10-19 10:00:00", out);
+    EXPECT_EQ(out, R"(time="2025-10-19 10:00:00.000123" level=info thread=100 module=test func=func msg=hello )"
+                   R"(file=a.cpp line=12 uid=-1 name="bob smith" empty="")");
+}
@@ -0,0 +1,157 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "mmap_ring.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace tbox {
+namespace log {
+
+bool MmapRingReader::open(const std::string &file_path)
+{
+    data_.clear();
+
+    FILE *fp = fopen(file_path.c_str(), "rb");
+    if (fp == nullptr)
+        return false;
+
+    char buff[4096];
+    for (;;) {
+        size_t rsize = fread(buff, 1, sizeof(buff), fp);
+        if (rsize == 0)
+            break;
+        data_.insert(data_.end(), buff, buff + rsize);
+    }
+    fclose(fp);
+
+    if (data_.size() < kMmapRingHeaderSize)
+        return false;
+
+    auto header = reinterpret_cast<const MmapRingHeader *>(data_.data());
+    if (header->magic != kMmapRingMagic ||
+        header->version != kMmapRingVersion ||
+        header->header_size != kMmapRingHeaderSize ||
+        header->data_size % 8 != 0 ||
+        data_.size() < (size_t)header->header_size + header->data_size)
+        return false;
+
+    data_size_ = header->data_size;
+    commit_pos_ = header->commit_pos.load();
+    reserve_pos_ = header->reserve_pos.load();
+    if (reserve_pos_ < commit_pos_)
+        reserve_pos_ = commit_pos_;
+    pid_ = header->pid;
+    crash_signo_ = header->crash_signo;
+    return true;
+}
+
+size_t MmapRingReader::foreach(const Func &func) const
+{
+    if (data_size_ == 0)
+        return 0;
+
+    //! 正在写的记录可能已覆盖了最旧的部分，所以从 reserve_pos 往回数一圈
+    uint64_t begin = reserve_pos_ > data_size_ ? reserve_pos_ - data_size_ : 0;
+    begin = (begin + 7) & ~7ull;
+
+    //! 起点可能落在某条记录的中间，逐个8字节位置尝试，直到能完整衔接到 commit_pos 为止
+    for (uint64_t start = begin; start < commit_pos_; start += 8) {
+        if (walk(start, commit_pos_, nullptr)) {
+            size_t count = 0;
+            Func counter = [&] (const LogContent *content) { func(content); ++count; };
+            walk(start, commit_pos_, &counter);
+            return count;
+        }
+    }
+    return 0;
+}
+
+bool MmapRingReader::walk(uint64_t begin, uint64_t end, const Func *func) const
+{
+    const char *ring = data_.data() + kMmapRingHeaderSize;
+    std::string module, func_name, file_name, text;
+
+    uint64_t pos = begin;
+    while (pos < end) {
+        uint32_t offset = pos % data_size_;
+        uint32_t remain = data_size_ - offset;
+
+        //! 环尾放不下记录头，写入方会直接回绕
+        if (remain < sizeof(MmapRingRecord)) {
+            pos += remain;
+            continue;
+        }
+
+        MmapRingRecord record;
+        memcpy(&record, ring + offset, sizeof(record));
+
+        if (record.magic != kMmapRingRecordMagic ||
+            record.size < sizeof(MmapRingRecord) ||
+            record.size % 8 != 0 ||
+            record.size > remain ||
+            pos + record.size > end)
+            return false;
+
+        if (record.type == kMmapRingRecordPadding) {
+            if (record.size != remain)
+                return false;
+            pos += remain;
+            continue;
+        }
+
+        if (record.type != kMmapRingRecordLog || record.level >= LOG_LEVEL_MAX)
+            return false;
+
+        uint64_t body_size = (uint64_t)record.module_len + record.func_len + record.file_len
+                           + record.text_len + record.fields_len;
+        if (sizeof(MmapRingRecord) + body_size > record.size)
+            return false;
+
+        if (func != nullptr) {
+            const char *p = ring + offset + sizeof(MmapRingRecord);
+            module.assign(p, record.module_len);    p += record.module_len;
+            func_name.assign(p, record.func_len);   p += record.func_len;
+            file_name.assign(p, record.file_len);   p += record.file_len;
+            text.assign(p, record.text_len + record.fields_len);
+
+            LogContent content;
+            memset(&content, 0, sizeof(content));
+            content.thread_id = record.thread_id;
+            content.timestamp.sec = record.sec;
+            content.timestamp.usec = record.usec;
+            content.module_id = module.c_str();
+            content.func_name = record.func_len > 0 ? func_name.c_str() : nullptr;
+            content.file_name = record.file_len > 0 ? file_name.c_str() : nullptr;
+            content.line = record.line;
+            content.level = record.level;
+            content.text_len = text.size();
+            content.text_ptr = text.c_str();
+            (*func)(&content);
+        }
+
+        pos += record.size;
+    }
+
+    return pos == end;
+}
+
+}
+}
@@ -0,0 +1,124 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_LOG_MMAP_RING_H_20251019
+#define TBOX_LOG_MMAP_RING_H_20251019
+
+/**
+ * 崩溃可恢复的日志环形缓冲文件格式
+ *
+ * 文件由一页头部与一段环形数据区组成，由 MmapRingSink 以 MAP_SHARED 方式映射后直接写内存。
+ * 进程崩溃后，已写入的数据仍留在内核页缓存中，不会丢失，事后由 MmapRingReader 解出尾部日志。
+ *
+ * 写入一条记录的顺序：
+ * 1. 先推进 reserve_pos，声明即将覆盖的区域；
+ * 2. 写入记录头与内容；
+ * 3. 再推进 commit_pos，表示该记录完整。
+ * 读取时只认 [reserve_pos - data_size, commit_pos) 区间内的记录，写了一半的记录自然被忽略。
+ */
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <functional>
+#include <tbox/base/log_imp.h>
+
+namespace tbox {
+namespace log {
+
+constexpr uint32_t kMmapRingMagic = 0x524c4254;         //!< "TBLR"
+constexpr uint32_t kMmapRingVersion = 1;
+constexpr uint32_t kMmapRingHeaderSize = 4096;          //!< 头部占一页
+constexpr uint32_t kMmapRingRecordMagic = 0x43455254;   //!< "TREC"
+
+//! 文件头
+struct MmapRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;       //!< 头部大小，数据区紧随其后
+    uint32_t data_size;         //!< 数据区大小，8字节对齐
+    int32_t  pid;               //!< 写入进程的PID
+    int32_t  crash_signo;       //!< 进程崩溃时收到的信号，0表示未崩溃
+    std::atomic<uint64_t> reserve_pos;  //!< 已申请的写位置，单调递增
+    std::atomic<uint64_t> commit_pos;   //!< 已完整写入的写位置，单调递增
+};
+
+//! 记录类型
+enum MmapRingRecordType : uint8_t {
+    kMmapRingRecordLog = 0,     //!< 日志
+    kMmapRingRecordPadding,     //!< 回绕前填充环尾的空白
+};
+
+//! 记录头，后面依次跟随 module, func, file, text, fields 字串，均不含'\0'
+struct MmapRingRecord {
+    uint32_t magic;
+    uint32_t size;              //!< 整条记录的大小，含记录头，8字节对齐
+    uint32_t sec;
+    uint32_t usec;
+    int64_t  thread_id;
+    int32_t  line;
+    uint8_t  level;
+    uint8_t  type;              //!< 见 MmapRingRecordType
+    uint16_t module_len;
+    uint16_t func_len;
+    uint16_t file_len;
+    uint32_t text_len;
+    uint32_t fields_len;        //!< 已编码成 " key=value" 形式的结构化字段
+    uint32_t reserved;
+};
+
+static_assert(sizeof(MmapRingHeader) <= kMmapRingHeaderSize, "MmapRingHeader too large");
+static_assert(sizeof(MmapRingRecord) % 8 == 0, "MmapRingRecord must be 8 bytes aligned");
+
+//! 环形日志文件读取器
+class MmapRingReader {
+  public:
+    using Func = std::function<void(const LogContent *)>;
+
+    //! 将整个文件读入内存，并检查文件头
+    bool open(const std::string &file_path);
+
+    int pid() const { return pid_; }
+    int crashSignal() const { return crash_signo_; }
+
+    /**
+     * 按从旧到新的顺序遍历所有完整的记录
+     *
+     * 结构化字段会被附在 text 后面，LogContent::fields 始终为空
+     *
+     * \return  遍历的记录数
+     */
+    size_t foreach(const Func &func) const;
+
+  protected:
+    bool walk(uint64_t begin, uint64_t end, const Func *func) const;
+
+  private:
+    std::vector<char> data_;
+    uint32_t data_size_ = 0;
+    uint64_t reserve_pos_ = 0;
+    uint64_t commit_pos_ = 0;
+    int pid_ = 0;
+    int crash_signo_ = 0;
+};
+
+}
+}
+
+#endif //TBOX_LOG_MMAP_RING_H_20251019
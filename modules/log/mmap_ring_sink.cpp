@@ -0,0 +1,233 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "mmap_ring_sink.h"
+#include "encoder.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <cstring>
+#include <cstdio>
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace log {
+
+namespace {
+
+constexpr int kMaxRingNum = 8;
+constexpr size_t kMaxNameLen = 256;   //!< 模块名、函数名、文件名的最大长度
+
+//! 已映射的环形通道，供 OnCrash() 在信号处理函数中遍历，所以不能用锁
+std::atomic<MmapRingSink*> _ring_sinks[kMaxRingNum];
+
+inline uint32_t Align8(uint32_t size) { return (size + 7) & ~7u; }
+
+uint16_t NameLen(const char *str)
+{
+    return str != nullptr ? strnlen(str, kMaxNameLen) : 0;
+}
+
+}
+
+MmapRingSink::~MmapRingSink()
+{
+    disable();
+    cleanup();
+}
+
+bool MmapRingSink::initialize(const std::string &file_path, size_t data_size)
+{
+    if (header_ != nullptr)
+        return false;
+
+    long page_size = ::sysconf(_SC_PAGESIZE);
+    data_size = (data_size + page_size - 1) / page_size * page_size;
+    if (data_size == 0 || data_size > UINT32_MAX)
+        return false;
+
+    //! 保留上一次运行留下的日志，便于事后分析
+    if (::access(file_path.c_str(), F_OK) == 0)
+        ::rename(file_path.c_str(), (file_path + ".old").c_str());
+
+    int fd = ::open(file_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        perror("open ring file fail");
+        return false;
+    }
+
+    size_t map_size = kMmapRingHeaderSize + data_size;
+
+    //! 预先分配磁盘空间，否则在磁盘满时写映射内存会触发 SIGBUS
+    if (::posix_fallocate(fd, 0, map_size) != 0 && ::ftruncate(fd, map_size) != 0) {
+        perror("resize ring file fail");
+        CHECK_CLOSE_FD(fd);
+        return false;
+    }
+
+    void *ptr = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    CHECK_CLOSE_FD(fd);
+    if (ptr == MAP_FAILED) {
+        perror("mmap ring file fail");
+        return false;
+    }
+
+    //! 新建的文件内容全为0，只需填写非0字段
+    auto header = static_cast<MmapRingHeader *>(ptr);
+    header->version = kMmapRingVersion;
+    header->header_size = kMmapRingHeaderSize;
+    header->data_size = data_size;
+    header->pid = ::getpid();
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = kMmapRingMagic;
+
+    map_size_ = map_size;
+    data_size_ = data_size;
+    //! 单条日志最多占数据区的1/4，避免一条超长日志冲掉所有历史
+    max_text_size_ = data_size / 4;
+    commit_pos_ = 0;
+    ring_ = static_cast<char *>(ptr) + kMmapRingHeaderSize;
+    header_ = header;
+
+    for (auto &item : _ring_sinks) {
+        MmapRingSink *expected = nullptr;
+        if (item.compare_exchange_strong(expected, this))
+            break;
+    }
+
+    return true;
+}
+
+void MmapRingSink::cleanup()
+{
+    if (header_ == nullptr)
+        return;
+
+    for (auto &item : _ring_sinks) {
+        MmapRingSink *expected = this;
+        if (item.compare_exchange_strong(expected, nullptr))
+            break;
+    }
+
+    ::munmap(header_, map_size_);
+    header_ = nullptr;
+    ring_ = nullptr;
+    map_size_ = 0;
+    data_size_ = 0;
+}
+
+void MmapRingSink::sync()
+{
+    if (header_ != nullptr)
+        ::msync(header_, map_size_, MS_SYNC);
+}
+
+void MmapRingSink::OnCrash(int signo)
+{
+    for (auto &item : _ring_sinks) {
+        auto sink = item.load();
+        if (sink != nullptr && sink->header_ != nullptr) {
+            sink->header_->crash_signo = signo;
+            sink->sync();
+        }
+    }
+}
+
+//! 调用者已持有日志分发锁，无需再加锁
+void MmapRingSink::onLogFrontEnd(const LogContent *content)
+{
+    if (header_ == nullptr)
+        return;
+
+    fields_.clear();
+    if (content->field_num > 0)
+        EncodeFields(content, fields_);
+
+    uint16_t module_len = NameLen(content->module_id);
+    uint16_t func_len = NameLen(content->func_name);
+    uint16_t file_len = NameLen(content->file_name);
+    uint32_t text_len = content->text_len;
+    uint32_t fields_len = fields_.size();
+
+    if (text_len > max_text_size_)
+        text_len = max_text_size_;
+    if (fields_len > max_text_size_ - text_len)
+        fields_len = max_text_size_ - text_len;
+
+    uint32_t size = Align8(sizeof(MmapRingRecord) + module_len + func_len + file_len + text_len + fields_len);
+
+    uint32_t offset = commit_pos_ % data_size_;
+    uint32_t remain = data_size_ - offset;
+    uint64_t pos = commit_pos_;
+    if (remain < size)
+        pos += remain;  //! 环尾放不下，回绕到开头
+
+    //! 先声明要覆盖的区域，再写数据
+    header_->reserve_pos.store(pos + size, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (remain < size) {
+        if (remain >= sizeof(MmapRingRecord)) {
+            auto padding = reinterpret_cast<MmapRingRecord *>(ring_ + offset);
+            memset(padding, 0, sizeof(*padding));
+            padding->magic = kMmapRingRecordMagic;
+            padding->size = remain;
+            padding->type = kMmapRingRecordPadding;
+        }
+        offset = 0;
+    }
+
+    auto record = reinterpret_cast<MmapRingRecord *>(ring_ + offset);
+    record->magic = kMmapRingRecordMagic;
+    record->size = size;
+    record->sec = content->timestamp.sec;
+    record->usec = content->timestamp.usec;
+    record->thread_id = content->thread_id;
+    record->line = content->line;
+    record->level = content->level;
+    record->type = kMmapRingRecordLog;
+    record->module_len = module_len;
+    record->func_len = func_len;
+    record->file_len = file_len;
+    record->text_len = text_len;
+    record->fields_len = fields_len;
+    record->reserved = 0;
+
+    char *p = reinterpret_cast<char *>(record + 1);
+    auto append = [&p] (const char *str, uint32_t len) {
+        if (len > 0) {
+            memcpy(p, str, len);
+            p += len;
+        }
+    };
+    append(content->module_id, module_len);
+    append(content->func_name, func_len);
+    append(content->file_name, file_len);
+    append(content->text_ptr, text_len);
+    append(fields_.data(), fields_len);
+
+    //! 记录完整后再推进写位置
+    commit_pos_ = pos + size;
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->commit_pos.store(commit_pos_, std::memory_order_relaxed);
+}
+
+}
+}
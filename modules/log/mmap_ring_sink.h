@@ -0,0 +1,82 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_LOG_MMAP_RING_SINK_H_20251019
+#define TBOX_LOG_MMAP_RING_SINK_H_20251019
+
+/**
+ * 崩溃可恢复的环形日志通道
+ *
+ * 将日志以二进制记录的形式写入 mmap 映射的环形文件中，写日志只是内存拷贝，不产生系统调用。
+ * 进程崩溃时 AsyncSink 缓冲中的日志会丢失，而这里写入的日志仍在内核页缓存中，
+ * 事后可用 examples/log/ring_dump 工具解出崩溃前的最后一段日志。
+ *
+ * 通常与 AsyncFileSink 等通道同时使用，并设置较小的容量，仅用作事后分析。
+ */
+
+#include "sink.h"
+#include "mmap_ring.h"
+
+namespace tbox {
+namespace log {
+
+class MmapRingSink : public Sink {
+  public:
+    virtual ~MmapRingSink() override;
+
+  public:
+    /**
+     * 创建并映射环形文件
+     *
+     * 如果文件已存在，则先将其改名为 <file_path>.old，保留上一次运行的日志
+     *
+     * \param file_path     文件路径
+     * \param data_size     数据区大小，按页对齐
+     */
+    bool initialize(const std::string &file_path, size_t data_size);
+    void cleanup();
+
+    //! 将映射的内容同步到磁盘
+    void sync();
+
+    /**
+     * 进程崩溃时调用，记录信号值，并将所有环形文件同步到磁盘
+     *
+     * 写位置在每条日志写完时已经更新，这里无需再额外处理。
+     * 仅访问映射内存并调用 msync()，可以在信号处理函数中调用
+     */
+    static void OnCrash(int signo);
+
+  protected:
+    virtual void onLogFrontEnd(const LogContent *content) override;
+
+  private:
+    MmapRingHeader *header_ = nullptr;
+    char *ring_ = nullptr;
+    size_t map_size_ = 0;
+    uint32_t data_size_ = 0;
+    uint32_t max_text_size_ = 0;
+    uint64_t commit_pos_ = 0;
+    std::string fields_;
+};
+
+}
+}
+
+#endif //TBOX_LOG_MMAP_RING_SINK_H_20251019
@@ -0,0 +1,227 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include "mmap_ring_sink.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <chrono>
+#include <iostream>
+#include <tbox/base/log_kv.h>
+
+using namespace std;
+using namespace tbox;
+using namespace tbox::log;
+
+namespace {
+const char *kRingFile = "/tmp/tbox_mmap_ring_sink_test.ring";
+
+vector<string> ReadTexts(const string &file_path)
+{
+    vector<string> texts;
+    MmapRingReader reader;
+    if (reader.open(file_path)) {
+        reader.foreach(
+            [&] (const LogContent *content) {
+                texts.push_back(string(content->text_ptr, content->text_len));
+            }
+        );
+    }
+    return texts;
+}
+}
+
+TEST(MmapRingSink, WriteAndRead)
+{
+    ::unlink(kRingFile);
+    {
+        MmapRingSink sink;
+        ASSERT_TRUE(sink.initialize(kRingFile, 64 << 10));
+        sink.enable();
+
+        LogInfo("hello %d", 1);
+        LogWarn("world %s", "2");
+        LogKvNotice("kv", {"a", 1}, {"b", "x"});
+        LogPuts(LOG_LEVEL_DEBUG, "");
+    }
+
+    MmapRingReader reader;
+    ASSERT_TRUE(reader.open(kRingFile));
+    EXPECT_EQ(reader.pid(), ::getpid());
+    EXPECT_EQ(reader.crashSignal(), 0);
+
+    vector<string> texts;
+    vector<string> modules;
+    EXPECT_EQ(reader.foreach(
+        [&] (const LogContent *content) {
+            texts.push_back(string(content->text_ptr, content->text_len));
+            modules.push_back(content->module_id);
+            EXPECT_NE(content->func_name, nullptr);
+            EXPECT_NE(content->file_name, nullptr);
+            EXPECT_GT(content->line, 0);
+            EXPECT_NE(content->timestamp.sec, 0u);
+            EXPECT_EQ(content->thread_id, ::syscall(SYS_gettid));
+        }
+    ), 4u);
+
+    ASSERT_EQ(texts.size(), 4u);
+    EXPECT_EQ(texts[0], "hello 1");
+    EXPECT_EQ(texts[1], "world 2");
+    EXPECT_EQ(texts[2], "kv a=1 b=x");
+    EXPECT_EQ(texts[3], "");
+    EXPECT_EQ(modules[0], LOG_MODULE_ID);
+    ::unlink(kRingFile);
+}
+
+TEST(MmapRingSink, Wrap)
+{
+    ::unlink(kRingFile);
+    MmapRingSink sink;
+    ASSERT_TRUE(sink.initialize(kRingFile, 4096));
+    sink.enable();
+
+    for (int i = 0; i < 1000; ++i)
+        LogInfo("index %d, %s", i, string(i % 37, 'x').c_str());
+
+    auto texts = ReadTexts(kRingFile);
+    ASSERT_GT(texts.size(), 5u);
+    ASSERT_LT(texts.size(), 100u);
+
+    //! 读到的必须是最新的、连续的一段
+    int expect = 1000 - texts.size();
+    for (auto &text : texts) {
+        EXPECT_EQ(text, "index " + to_string(expect) + ", " + string(expect % 37, 'x'));
+        ++expect;
+    }
+    ::unlink(kRingFile);
+}
+
+TEST(MmapRingSink, IgnorePartialRecord)
+{
+    ::unlink(kRingFile);
+    MmapRingSink sink;
+    ASSERT_TRUE(sink.initialize(kRingFile, 4096));
+    sink.enable();
+
+    for (int i = 0; i < 200; ++i)
+        LogInfo("index %d", i);
+    sink.disable();
+
+    auto before = ReadTexts(kRingFile);
+    ASSERT_FALSE(before.empty());
+
+    //! 模拟写到一半崩溃：已推进 reserve_pos，并写乱了即将覆盖的最旧的数据
+    int fd = ::open(kRingFile, O_RDWR);
+    ASSERT_GE(fd, 0);
+    MmapRingHeader header;
+    ASSERT_EQ(::pread(fd, &header, sizeof(header), 0), (ssize_t)sizeof(header));
+    uint64_t commit_pos = header.commit_pos.load();
+    header.reserve_pos = commit_pos + 200;
+    ASSERT_EQ(::pwrite(fd, &header, sizeof(header), 0), (ssize_t)sizeof(header));
+
+    char garbage[200];
+    memset(garbage, 0x5a, sizeof(garbage));
+    uint32_t offset = commit_pos % header.data_size;
+    uint32_t len = std::min<uint32_t>(sizeof(garbage), header.data_size - offset);
+    ASSERT_EQ(::pwrite(fd, garbage, len, kMmapRingHeaderSize + offset), (ssize_t)len);
+    ::close(fd);
+
+    auto after = ReadTexts(kRingFile);
+    ASSERT_FALSE(after.empty());
+    EXPECT_LT(after.size(), before.size());
+    EXPECT_EQ(after.back(), "index 199");
+    for (size_t i = 0; i < after.size(); ++i)
+        EXPECT_EQ(after[after.size() - 1 - i], before[before.size() - 1 - i]);
+    ::unlink(kRingFile);
+}
+
+TEST(MmapRingSink, CrashSignal)
+{
+    ::unlink(kRingFile);
+    MmapRingSink sink;
+    ASSERT_TRUE(sink.initialize(kRingFile, 4096));
+    sink.enable();
+    LogFatal("before crash");
+
+    MmapRingSink::OnCrash(SIGSEGV);
+
+    MmapRingReader reader;
+    ASSERT_TRUE(reader.open(kRingFile));
+    EXPECT_EQ(reader.crashSignal(), SIGSEGV);
+    EXPECT_EQ(ReadTexts(kRingFile).back(), "before crash");
+    ::unlink(kRingFile);
+}
+
+TEST(MmapRingSink, KeepOldFile)
+{
+    string old_file = string(kRingFile) + ".old";
+    ::unlink(kRingFile);
+    ::unlink(old_file.c_str());
+
+    {
+        MmapRingSink sink;
+        ASSERT_TRUE(sink.initialize(kRingFile, 4096));
+        sink.enable();
+        LogInfo("first run");
+    }
+    {
+        MmapRingSink sink;
+        ASSERT_TRUE(sink.initialize(kRingFile, 4096));
+        sink.enable();
+        LogInfo("second run");
+    }
+
+    EXPECT_EQ(ReadTexts(old_file), vector<string>{"first run"});
+    EXPECT_EQ(ReadTexts(kRingFile), vector<string>{"second run"});
+
+    ::unlink(kRingFile);
+    ::unlink(old_file.c_str());
+}
+
+TEST(MmapRingSink, InvalidFile)
+{
+    MmapRingReader reader;
+    EXPECT_FALSE(reader.open("/tmp/tbox_mmap_ring_sink_test.not_exist"));
+    EXPECT_FALSE(reader.open("/proc/self/cmdline"));
+}
+
+TEST(MmapRingSink, Benchmark)
+{
+    ::unlink(kRingFile);
+    MmapRingSink sink;
+    ASSERT_TRUE(sink.initialize(kRingFile, 1 << 20));
+    sink.enable();
+
+    const int kCount = 100000;
+    auto start_ts = chrono::steady_clock::now();
+    for (int i = 0; i < kCount; ++i)
+        LogInfo("index:%d, %s", i, "mmap ring benchmark");
+    auto cost = chrono::steady_clock::now() - start_ts;
+
+    cout << "records: " << kCount
+         << ", cost: " << chrono::duration_cast<chrono::microseconds>(cost).count() << " us"
+         << ", per record: " << chrono::duration_cast<chrono::nanoseconds>(cost).count() / kCount << " ns"
+         << endl;
+
+    sink.cleanup();
+    ::unlink(kRingFile);
+}
@@ -28,6 +28,33 @@
 namespace tbox {
 namespace log {
 
+namespace {
+
+/**
+ * 所有Sink共享的时间戳字串缓存
+ *
+ * 各Sink在自己的秒数变化时才来取，每秒每个Sink只加一次锁；
+ * 而 localtime_r() 与 strftime() 在整个进程中每秒只执行一次
+ */
+std::mutex _timestamp_lock;
+uint32_t _timestamp_sec = 0;
+char _timestamp_str[TIMESTAMP_STRING_SIZE] = { 0 };
+
+void GetSharedTimestampStr(uint32_t sec, char *str)
+{
+    std::lock_guard<std::mutex> lg(_timestamp_lock);
+    if (_timestamp_sec != sec) {
+        time_t ts_sec = sec;
+        struct tm tm;
+        localtime_r(&ts_sec, &tm);
+        strftime(_timestamp_str, sizeof(_timestamp_str), "%F %H:%M:%S", &tm);
+        _timestamp_sec = sec;
+    }
+    ::memcpy(str, _timestamp_str, TIMESTAMP_STRING_SIZE);
+}
+
+}
+
 Sink::~Sink()
 {
     disable();
@@ -58,6 +85,11 @@ void Sink::enableColor(bool enable)
     enable_color_ = enable;
 }
 
+void Sink::setFormat(Format format)
+{
+    format_ = format;
+}
+
 bool Sink::enable()
 {
     using namespace std::placeholders;
@@ -105,10 +137,7 @@ void Sink::handleLog(const LogContent *content)
 void Sink::udpateTimestampStr(uint32_t sec)
 {
     if (timestamp_sec_ != sec) {
-        time_t ts_sec = sec;
-        struct tm tm;
-        localtime_r(&ts_sec, &tm);
-        strftime(timestamp_str_, sizeof(timestamp_str_), "%F %H:%M:%S", &tm);
+        GetSharedTimestampStr(sec, timestamp_str_);
         timestamp_sec_ = sec;
     }
 }
@@ -34,6 +34,13 @@ namespace log {
 //! 日志打印通道类
 class Sink {
   public:
+    //! 日志输出格式
+    enum class Format {
+        kText,      //!< 普通文本
+        kJson,      //!< 一行一个JSON对象
+        kLogfmt,    //!< key=value
+    };
+
     virtual ~Sink();
 
     void setLevel(int level);
@@ -41,6 +48,7 @@ class Sink {
     void unsetLevel(const std::string &module);
 
     void enableColor(bool enable);
+    void setFormat(Format format);
 
     bool enable();
     void disable();
@@ -60,6 +68,7 @@ class Sink {
 
   protected:
     bool enable_color_ = false;
+    Format format_ = Format::kText;
     char timestamp_str_[TIMESTAMP_STRING_SIZE]; //!2022-04-12 14:33:30
 
   private:
@@ -18,6 +18,7 @@
  * of the source tree.
  */
 #include "sync_stdout_sink.h"
+#include "encoder.h"
 
 #include <unistd.h>
 #include <algorithm>
@@ -29,6 +30,16 @@ void SyncStdoutSink::onLogFrontEnd(const LogContent *content)
 {
     udpateTimestampStr(content->timestamp.sec);
 
+    if (format_ != Format::kText) {
+        line_.clear();
+        if (format_ == Format::kJson)
+            EncodeJson(content, timestamp_str_, line_);
+        else
+            EncodeLogfmt(content, timestamp_str_, line_);
+        puts(line_.c_str());
+        return;
+    }
+
     //! 开启色彩，显示日志等级
     if (enable_color_)
         printf("\033[%sm", LOG_LEVEL_COLOR_CODE[content->level]);
@@ -44,6 +55,12 @@ void SyncStdoutSink::onLogFrontEnd(const LogContent *content)
     if (content->text_len > 0)
         printf("%s ", content->text_ptr);
 
+    if (content->field_num > 0) {
+        line_.clear();
+        EncodeFields(content, line_);
+        printf("%s ", line_.c_str() + 1);   //! 跳过开头的空格
+    }
+
     if (content->file_name != nullptr)
         printf("-- %s:%d", content->file_name, content->line);
 
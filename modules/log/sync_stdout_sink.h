@@ -22,12 +22,17 @@
 
 #include "sink.h"
 
+#include <string>
+
 namespace tbox {
 namespace log {
 
 class SyncStdoutSink : public Sink {
   protected:
     virtual void onLogFrontEnd(const LogContent *content) override;
+
+  private:
+    std::string line_;
 };
 
 }
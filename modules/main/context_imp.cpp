@@ -30,6 +30,7 @@
 #include <tbox/base/catch_throw.h>
 #include <tbox/util/string.h>
 #include <tbox/util/json.h>
+#include <tbox/util/json_binding.h>
 #include <tbox/terminal/session.h>
 
 #include "main.h"
@@ -38,6 +39,18 @@ namespace tbox {
 namespace main {
 
 namespace {
+
+//! cfg.thread_pool
+struct ThreadPoolConfig {
+    int min = 0;
+    int max = 1;
+
+    static void jsonSchema(util::json::Schema<ThreadPoolConfig> &s) {
+        s.field("min", &ThreadPoolConfig::min)
+         .field("max", &ThreadPoolConfig::max);
+    }
+};
+
 std::string ToString(const std::chrono::milliseconds msec)
 {
     uint64_t ms = msec.count();
@@ -101,7 +114,7 @@ ContextImp::~ContextImp()
 
 void ContextImp::fillDefaultConfig(Json &cfg) const
 {
-    cfg["thread_pool"] = R"({"min":0, "max":1})"_json;
+    util::json::ToJson(ThreadPoolConfig(), cfg["thread_pool"]);
 }
 
 bool ContextImp::initialize(const Json &cfg)
@@ -175,14 +188,15 @@ bool ContextImp::initLoop(const Json &js)
 
 bool ContextImp::initThreadPool(const Json &js)
 {
-    int thread_pool_min = 0, thread_pool_max = 0;
-    if (!util::json::GetField(js, "min", thread_pool_min) ||
-        !util::json::GetField(js, "max", thread_pool_max)) {
-        LogWarn("in cfg.thread_pool, min or max is not number");
+    ThreadPoolConfig config;
+    std::vector<std::string> errors;
+    if (!util::json::FromJson(js, config, errors)) {
+        for (auto &error : errors)
+            LogWarn("in cfg.thread_pool, %s", error.c_str());
         return false;
     }
 
-    if (!sp_thread_pool_->initialize(thread_pool_min, thread_pool_max))
+    if (!sp_thread_pool_->initialize(config.min, config.max))
         return false;
 
     return true;
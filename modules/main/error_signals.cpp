@@ -29,6 +29,7 @@
 #include <tbox/base/log.h>
 #include <tbox/base/scope_exit.hpp>
 #include <tbox/base/backtrace.h>
+#include <tbox/log/mmap_ring_sink.h>
 
 #define TBOX_USE_SIGACTION
 
@@ -108,6 +109,9 @@ void OnErrorSignal(int signo)
         LogFatal("Recursion signal %d", signo);
     }
 
+    //! 记录崩溃信号，并将环形日志同步到磁盘
+    log::MmapRingSink::OnCrash(signo);
+
     AbnormalExit();
 }
 
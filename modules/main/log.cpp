@@ -50,6 +50,11 @@ void Log::fillDefaultConfig(Json &cfg) const
   "syslog": {
     "enable": false,
     "levels": {"":7}
+  },
+  "ring": {
+    "enable": false,
+    "levels": {"":7},
+    "size": 256
   }
 }
 )"_json;
@@ -61,6 +66,11 @@ bool Log::initialize(const char *proc_name, Context &ctx, const Json &cfg)
 
     if (util::json::HasObjectField(cfg, "log")) {
         auto &js_log = cfg.at("log");
+
+        bool enable_coarse_clock = false;
+        if (util::json::GetField(js_log, "enable_coarse_clock", enable_coarse_clock))
+            LogEnableCoarseClock(enable_coarse_clock);
+
         //! STDOUT
         if (util::json::HasObjectField(js_log, "stdout")) {
             auto &js_stdout = js_log.at("stdout");
@@ -95,16 +105,39 @@ bool Log::initialize(const char *proc_name, Context &ctx, const Json &cfg)
 
             initSink(js_file, async_file_sink_);
         }
+
+        //! RING，崩溃后可从中恢复最后一段日志
+        if (util::json::HasObjectField(js_log, "ring")) {
+            auto &js_ring = js_log.at("ring");
+
+            bool enable = false;
+            util::json::GetField(js_ring, "enable", enable);
+            if (enable) {
+                std::string path = "/var/log";
+                util::json::GetField(js_ring, "path", path);
+
+                std::string prefix = util::fs::Basename(proc_name);
+                util::json::GetField(js_ring, "prefix", prefix);
+
+                unsigned int size = 256;
+                util::json::GetField(js_ring, "size", size);
+
+                if (mmap_ring_sink_.initialize(path + '/' + prefix + ".ring", size * 1024))
+                    initSink(js_ring, mmap_ring_sink_);
+            }
+        }
     }
     return true;
 }
 
 void Log::cleanup()
 {
+    mmap_ring_sink_.disable();
     async_file_sink_.disable();
     async_syslog_sink_.disable();
     sync_stdout_sink_.disable();
 
+    mmap_ring_sink_.cleanup();
     async_file_sink_.cleanup();
     async_syslog_sink_.cleanup();
 }
@@ -123,6 +156,16 @@ void Log::initSink(const Json &js, log::Sink &ch)
     if (util::json::GetField(js, "enable_color", enable_color))
         ch.enableColor(enable_color);
 
+    std::string format;
+    if (util::json::GetField(js, "format", format)) {
+        if (format == "json")
+            ch.setFormat(log::Sink::Format::kJson);
+        else if (format == "logfmt")
+            ch.setFormat(log::Sink::Format::kLogfmt);
+        else
+            ch.setFormat(log::Sink::Format::kText);
+    }
+
     if (util::json::HasObjectField(js, "levels")) {
         auto &js_levels = js.at("levels");
         for (auto &item : js_levels.items())
@@ -151,6 +194,11 @@ void Log::initShell(TerminalNodes &term)
         initShellForSink(async_file_sink_, term, dir_node);
         initShellForAsyncFileSink(term, dir_node);
     }
+    {
+        auto dir_node = term.createDirNode();
+        term.mountNode(log_node, dir_node, "ring");
+        initShellForSink(mmap_ring_sink_, term, dir_node);
+    }
 }
 
 void Log::initShellForSink(log::Sink &log_ch, terminal::TerminalNodes &term, terminal::NodeToken dir_node)
@@ -209,6 +257,36 @@ void Log::initShellForSink(log::Sink &log_ch, terminal::TerminalNodes &term, ter
         term.mountNode(dir_node, func_node, "enable_color");
     }
 
+    {
+        auto func_node = term.createFuncNode(
+            [&log_ch] (const Session &s, const Args &args) {
+                std::ostringstream oss;
+                bool print_usage = true;
+                if (args.size() >= 2) {
+                    const auto &opt = args[1];
+                    print_usage = false;
+                    if (opt == "text")
+                        log_ch.setFormat(log::Sink::Format::kText);
+                    else if (opt == "json")
+                        log_ch.setFormat(log::Sink::Format::kJson);
+                    else if (opt == "logfmt")
+                        log_ch.setFormat(log::Sink::Format::kLogfmt);
+                    else
+                        print_usage = true;
+
+                    if (!print_usage)
+                        oss << "done\r\n";
+                }
+
+                if (print_usage)
+                    oss << "Usage: " << args[0] << " text|json|logfmt\r\n";
+
+                s.send(oss.str());
+            }
+        , "set log format");
+        term.mountNode(dir_node, func_node, "set_format");
+    }
+
     {
         auto func_node = term.createFuncNode(
             [&log_ch] (const Session &s, const Args &args) {
@@ -25,6 +25,7 @@
 #include <tbox/log/sync_stdout_sink.h>
 #include <tbox/log/async_syslog_sink.h>
 #include <tbox/log/async_file_sink.h>
+#include <tbox/log/mmap_ring_sink.h>
 
 #include <tbox/terminal/terminal_nodes.h>
 
@@ -49,6 +50,7 @@ class Log {
     log::SyncStdoutSink  sync_stdout_sink_;
     log::AsyncSyslogSink async_syslog_sink_;
     log::AsyncFileSink   async_file_sink_;
+    log::MmapRingSink    mmap_ring_sink_;
 };
 
 }
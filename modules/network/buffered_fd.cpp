@@ -20,7 +20,9 @@
 #include "buffered_fd.h"
 
 #include <cstring>
+#include <sys/sendfile.h>
 #include <tbox/base/log.h>
+#include <tbox/base/log_limit.h>
 #include <tbox/base/assert.h>
 #include <tbox/event/loop.h>
 #include <tbox/event/fd_event.h>
@@ -105,6 +107,10 @@ bool BufferedFd::enable()
     if (sp_read_event_ != nullptr)
         sp_read_event_->enable();
 
+    //! 在 enable() 之前 send() 的数据，需要可写事件来发出
+    if (sp_write_event_ != nullptr && (send_buff_.readableSize() > 0 || !send_files_.empty()))
+        sp_write_event_->enable();
+
     state_ = State::kRunning;
 
     return true;
@@ -138,8 +144,12 @@ bool BufferedFd::send(const void *data_ptr, size_t data_size)
         return false;
     }
 
+    //! 如果前面还有文件没有发送完，则要排在文件之后
+    if (!send_files_.empty()) {
+        send_files_.back().tail_buff.append(data_ptr, data_size);
+
     //! 如果当前没有 enable() 或者发送缓冲区中还有没有发送完成的数据
-    if ((state_ != State::kRunning) || (send_buff_.readableSize() > 0)) {
+    } else if ((state_ != State::kRunning) || (send_buff_.readableSize() > 0)) {
         //! 则新的数据就直接放到发送缓冲区
         send_buff_.append(data_ptr, data_size);
     } else {
@@ -158,7 +168,7 @@ bool BufferedFd::send(const void *data_ptr, size_t data_size)
                 send_buff_.append(data_ptr, data_size);
                 sp_write_event_->enable();  //! 等待可写事件
             } else {
-                LogWarn("send fail, drop data. errno:%d, %s", errno, strerror(errno));
+                LogEveryMs(LOG_LEVEL_WARN, 1000, "send fail, drop data. errno:%d, %s", errno, strerror(errno));
                 //!TODO
             }
         }
@@ -167,6 +177,122 @@ bool BufferedFd::send(const void *data_ptr, size_t data_size)
     return true;
 }
 
+bool BufferedFd::sendv(const struct iovec *iov, int iovcnt)
+{
+    if (sp_write_event_ == nullptr) {
+        LogWarn("send is disabled");
+        return false;
+    }
+
+    //! 有数据或文件排在前面，只能放入缓冲
+    Buffer *wp_buff = nullptr;
+    if (!send_files_.empty())
+        wp_buff = &send_files_.back().tail_buff;
+    else if ((state_ != State::kRunning) || (send_buff_.readableSize() > 0))
+        wp_buff = &send_buff_;
+
+    if (wp_buff != nullptr) {
+        for (int i = 0; i < iovcnt; ++i)
+            wp_buff->append(iov[i].iov_base, iov[i].iov_len);
+        return true;
+    }
+
+    ssize_t wsize = fd_.writev(iov, iovcnt);
+    if (wsize < 0) {
+        if (errno != EAGAIN) {
+            LogEveryMs(LOG_LEVEL_WARN, 1000, "send fail, drop data. errno:%d, %s", errno, strerror(errno));
+            return true;
+        }
+        wsize = 0;
+    }
+
+    //! 将没有发送完的部分放入到缓冲区
+    size_t skip_size = wsize;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (skip_size >= iov[i].iov_len) {
+            skip_size -= iov[i].iov_len;
+            continue;
+        }
+        const uint8_t *p_remain = static_cast<const uint8_t*>(iov[i].iov_base) + skip_size;
+        send_buff_.append(p_remain, iov[i].iov_len - skip_size);
+        skip_size = 0;
+    }
+
+    if (send_buff_.readableSize() > 0)
+        sp_write_event_->enable();  //! 等待可写事件
+
+    return true;
+}
+
+bool BufferedFd::sendFile(Fd file_fd, off_t offset, size_t size)
+{
+    if (sp_write_event_ == nullptr) {
+        LogWarn("send is disabled");
+        return false;
+    }
+
+    if (file_fd.isNull())
+        return false;
+
+    if (size == 0)
+        return true;
+
+    send_files_.push_back(SendFileItem{ file_fd, offset, size, Buffer(0) });
+
+    //! 前面没有要发送的数据，则直接尝试发送
+    if (state_ == State::kRunning && send_buff_.readableSize() == 0 && send_files_.size() == 1) {
+        int err = 0;
+        if (!trySendFile(send_files_.front(), err)) {
+            //! 文件发不出去，将排在其后的数据移入发送缓冲，不然后续 send() 的数据永远发不出
+            send_buff_.swap(send_files_.front().tail_buff);
+            send_files_.pop_front();
+            return false;
+        }
+
+        if (send_files_.front().remain_size == 0) {
+            send_files_.pop_front();
+            return true;
+        }
+    }
+
+    if (state_ == State::kRunning)
+        sp_write_event_->enable();  //! 等待可写事件
+
+    return true;
+}
+
+bool BufferedFd::trySendFile(SendFileItem &item, int &err)
+{
+    ssize_t wsize = ::sendfile(fd_.get(), item.fd.get(), &item.offset, item.remain_size);
+    if (wsize > 0) {
+        item.remain_size -= wsize;
+        return true;
+    }
+
+    if (wsize < 0 && errno == EAGAIN)
+        return true;
+
+    //! 返回0表示文件比预期的短，被截断了，剩余的部分只能放弃。此时 errno 无意义，以 ENODATA 报告
+    if (wsize == 0) {
+        err = ENODATA;
+        LogWarn("file is shorter than expected, drop %zu bytes", item.remain_size);
+    } else {
+        err = errno;
+        LogEveryMs(LOG_LEVEL_WARN, 1000, "sendfile fail, errno:%d, %s", errno, strerror(errno));
+    }
+
+    item.remain_size = 0;
+    return false;
+}
+
+size_t BufferedFd::getSendBufferSize() const
+{
+    size_t size = send_buff_.readableSize();
+    for (auto &item : send_files_)
+        size += item.remain_size + item.tail_buff.readableSize();
+    return size;
+}
+
 void BufferedFd::shrinkRecvBuffer()
 {
     recv_buff_.shrink();
@@ -245,6 +371,29 @@ void BufferedFd::onReadCallback(short)
 
 void BufferedFd::onWriteCallback(short)
 {
+    //! 发送缓冲中的数据已发完，接着发送文件。文件发完后，将排在其后的数据移入发送缓冲
+    while (send_buff_.readableSize() == 0 && !send_files_.empty()) {
+        auto &item = send_files_.front();
+        if (item.remain_size > 0) {
+            int err = 0;
+            if (!trySendFile(item, err)) {
+                send_buff_.swap(item.tail_buff);
+                send_files_.pop_front();
+                if (error_cb_) {
+                    ++cb_level_;
+                    error_cb_(err);
+                    --cb_level_;
+                }
+                return;
+            }
+            if (item.remain_size > 0)
+                return;
+        }
+
+        send_buff_.swap(item.tail_buff);
+        send_files_.pop_front();
+    }
+
     //! 如果发送缓冲中已无数据要发送了，那就关闭可写事件
     if (send_buff_.readableSize() == 0) {
         sp_write_event_->disable();
@@ -267,7 +416,7 @@ void BufferedFd::onWriteCallback(short)
             error_cb_(errno);
             --cb_level_;
         } else
-            LogWarn("write error, wsize:%d, errno:%d, %s", wsize, errno, strerror(errno));
+            LogEveryMs(LOG_LEVEL_WARN, 1000, "write error, wsize:%d, errno:%d, %s", wsize, errno, strerror(errno));
     }
 }
 
@@ -21,6 +21,8 @@
 #define TBOX_NETWORK_BUFFERED_FD_H_20171030
 
 #include <functional>
+#include <deque>
+#include <sys/types.h>
 #include <tbox/event/forward.h>
 #include <tbox/base/defines.h>
 
@@ -72,6 +74,20 @@ class BufferedFd : public ByteStream {
     virtual void bind(ByteStream *receiver) override { wp_receiver_ = receiver; }
     virtual void unbind() override { wp_receiver_ = nullptr; }
 
+    /**
+     * 发送文件中 [offset, offset+size) 的数据
+     *
+     * 使用 sendfile() 直接由内核从文件拷贝到 fd，不经过用户空间，要求 fd 为 socket。
+     * 与 send() 的数据按调用的先后顺序发出。file_fd 会被引用到发送完成为止
+     *
+     * 文件读出错或比预期的短时，其余部分被放弃，后续的数据照常发送。
+     * 立即发送时出错则返回 false，否则通过 ErrorCallback 报告，截断时的出错码为 ENODATA
+     */
+    bool sendFile(Fd file_fd, off_t offset, size_t size);
+
+    //! 一次发送多块数据，用 writev() 发送，未发完的部分才拷贝到发送缓冲
+    bool sendv(const struct iovec *iov, int iovcnt);
+
     //! 启动与关闭内部事件驱动机制
     bool enable();
     bool disable();
@@ -82,11 +98,23 @@ class BufferedFd : public ByteStream {
 
     inline Fd fd() const { return fd_; }
     inline State state() const { return state_; }
+    //! 发送缓冲中还未发送出去的数据大小，包含待发送的文件数据
+    size_t getSendBufferSize() const;
 
   private:
     void onReadCallback(short);
     void onWriteCallback(short);
 
+    //! 待发送的文件
+    struct SendFileItem {
+        Fd fd;
+        off_t offset;
+        size_t remain_size;
+        Buffer tail_buff;   //!< 在该文件之后 send() 的数据
+    };
+    //! 失败时 err 为出错码，文件被截断时为 ENODATA
+    bool trySendFile(SendFileItem &item, int &err);
+
   private:
     event::Loop *wp_loop_ = nullptr;    //! 事件驱动
 
@@ -98,6 +126,7 @@ class BufferedFd : public ByteStream {
 
     Buffer send_buff_;
     Buffer recv_buff_;
+    std::deque<SendFileItem> send_files_;
 
     ReceiveCallback         receive_cb_;
     WriteCompleteCallback   send_complete_cb_;
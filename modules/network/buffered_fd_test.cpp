@@ -23,7 +23,11 @@
 #include <tbox/network/buffered_fd.h>
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
 #include <iostream>
+#include <vector>
+#include <cerrno>
 
 using namespace std;
 using namespace tbox;
@@ -107,3 +111,169 @@ TEST(BufferedFd, pipe_test)
     delete read_buff_fd;
     delete sp_loop;
 }
+
+//! 测试 sendFile() 与 send() 的数据按调用顺序到达
+TEST(BufferedFd, sendFile)
+{
+    Loop* sp_loop = Loop::New();
+    ASSERT_TRUE(sp_loop);
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    //! 准备一个 1MB 的文件
+    const char *file_path = "/tmp/tbox_buffered_fd_test.bin";
+    std::string file_content;
+    for (int i = 0; i < (1 << 20); ++i)
+        file_content.push_back('a' + i % 26);
+    {
+        Fd fd(::open(file_path, O_CREAT | O_WRONLY | O_TRUNC, 0644));
+        ASSERT_FALSE(fd.isNull());
+        ASSERT_EQ(fd.write(file_content.data(), file_content.size()), (ssize_t)file_content.size());
+    }
+    Fd file_fd = Fd::Open(file_path, O_RDONLY);
+    ASSERT_FALSE(file_fd.isNull());
+
+    std::string received;
+    BufferedFd *read_buff_fd = new BufferedFd(sp_loop);
+    read_buff_fd->initialize(fds[0]);
+    read_buff_fd->setReceiveCallback(
+        [&received] (Buffer &buff) {
+            received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+        }
+    , 0);
+    read_buff_fd->enable();
+
+    bool is_send_completed = false;
+    BufferedFd *write_buff_fd = new BufferedFd(sp_loop);
+    write_buff_fd->initialize(fds[1]);
+    write_buff_fd->setSendCompleteCallback([&] { is_send_completed = true; });
+    write_buff_fd->enable();
+
+    write_buff_fd->send("head", 4);
+    EXPECT_TRUE(write_buff_fd->sendFile(file_fd, 10, file_content.size() - 20));
+    write_buff_fd->send("tail", 4);
+    EXPECT_TRUE(write_buff_fd->sendFile(file_fd, 0, 3));
+    EXPECT_GT(write_buff_fd->getSendBufferSize(), 0u);
+
+    sp_loop->exitLoop(std::chrono::milliseconds(200));
+    sp_loop->runLoop();
+
+    std::string expect = "head" + file_content.substr(10, file_content.size() - 20) + "tail" + "abc";
+    EXPECT_EQ(received.size(), expect.size());
+    EXPECT_TRUE(received == expect);
+    EXPECT_TRUE(is_send_completed);
+    EXPECT_EQ(write_buff_fd->getSendBufferSize(), 0u);
+
+    delete write_buff_fd;
+    delete read_buff_fd;
+    delete sp_loop;
+    ::unlink(file_path);
+}
+
+//! 测试文件比预期的短时，后续 send() 的数据仍能发出
+TEST(BufferedFd, sendTruncatedFile)
+{
+    Loop* sp_loop = Loop::New();
+    ASSERT_TRUE(sp_loop);
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    const char *file_path = "/tmp/tbox_buffered_fd_truncated.bin";
+    {
+        Fd fd(::open(file_path, O_CREAT | O_WRONLY | O_TRUNC, 0644));
+        ASSERT_FALSE(fd.isNull());
+        ASSERT_EQ(fd.write("abc", 3), 3);
+    }
+    Fd file_fd = Fd::Open(file_path, O_RDONLY);
+    ASSERT_FALSE(file_fd.isNull());
+
+    //! 1MB 的数据，填满 socket 缓冲，使后一个文件只能在可写事件中发送
+    std::string big_data(1 << 20, 'x');
+
+    std::string received;
+    BufferedFd *read_buff_fd = new BufferedFd(sp_loop);
+    read_buff_fd->initialize(fds[0]);
+    read_buff_fd->setReceiveCallback(
+        [&received] (Buffer &buff) {
+            received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+        }
+    , 0);
+    read_buff_fd->enable();
+
+    std::vector<int> errors;
+    BufferedFd *write_buff_fd = new BufferedFd(sp_loop);
+    write_buff_fd->initialize(fds[1]);
+    write_buff_fd->setErrorCallback([&] (int err) { errors.push_back(err); });
+    write_buff_fd->enable();
+
+    //! 立即发送时文件已读完，返回 false
+    EXPECT_FALSE(write_buff_fd->sendFile(file_fd, 3, 10));
+    EXPECT_EQ(write_buff_fd->getSendBufferSize(), 0u);
+    write_buff_fd->send("head", 4);
+
+    //! 在可写事件中发送时文件已读完，由 ErrorCallback 报告 ENODATA
+    write_buff_fd->send(big_data.data(), big_data.size());
+    EXPECT_TRUE(write_buff_fd->sendFile(file_fd, 1, 10));
+    write_buff_fd->send("tail", 4);
+
+    sp_loop->exitLoop(std::chrono::milliseconds(200));
+    sp_loop->runLoop();
+
+    EXPECT_TRUE(received == "head" + big_data + "bc" + "tail");
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_EQ(errors[0], ENODATA);
+    EXPECT_EQ(write_buff_fd->getSendBufferSize(), 0u);
+
+    delete write_buff_fd;
+    delete read_buff_fd;
+    delete sp_loop;
+    ::unlink(file_path);
+}
+
+//! 测试 sendv() 一次发送多块数据，数据量大于socket缓冲时余下的能继续发完
+TEST(BufferedFd, sendv)
+{
+    Loop* sp_loop = Loop::New();
+    ASSERT_TRUE(sp_loop);
+
+    int fds[2] = { 0 };
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    std::string received;
+    BufferedFd *read_buff_fd = new BufferedFd(sp_loop);
+    read_buff_fd->initialize(fds[0]);
+    read_buff_fd->setReceiveCallback(
+        [&received] (Buffer &buff) {
+            received.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+        }
+    , 0);
+    read_buff_fd->enable();
+
+    BufferedFd *write_buff_fd = new BufferedFd(sp_loop);
+    write_buff_fd->initialize(fds[1]);
+    write_buff_fd->enable();
+
+    std::string head = "head:";
+    std::string body(4 << 20, 'x');
+    struct iovec iov[3] = {
+        { const_cast<char*>(head.data()), head.size() },
+        { const_cast<char*>(body.data()), body.size() },
+        { const_cast<char*>(":tail"), 5 },
+    };
+    EXPECT_TRUE(write_buff_fd->sendv(iov, 3));
+    EXPECT_TRUE(write_buff_fd->sendv(iov, 1));
+
+    sp_loop->exitLoop(std::chrono::milliseconds(200));
+    sp_loop->runLoop();
+
+    EXPECT_TRUE(received == head + body + ":tail" + head);
+
+    delete write_buff_fd;
+    delete read_buff_fd;
+    delete sp_loop;
+}
@@ -25,7 +25,7 @@
 #include <memory>
 
 #include <tbox/base/assert.h>
-#include <tbox/util/serializer.h>
+#include <tbox/util/struct_serializer.h>
 #include <tbox/util/string.h>
 #include <tbox/util/fs.h>
 
@@ -57,6 +57,19 @@ enum DNS_RC {
     DNS_RC_REFUSED      = 5,    //!< 服务器拒绝
 };
 
+//! 报文头
+struct DnsHeader {
+    uint16_t id;
+    uint16_t flags;
+    uint16_t qd_count;
+    uint16_t an_count;
+    uint16_t ns_count;
+    uint16_t ar_count;
+
+    template <typename Archive>
+    void schema(Archive &ar) { ar(id, flags, qd_count, an_count, ns_count, ar_count); }
+};
+
 /// 将domain写入到缓冲
 /**
  * "www.baidu.com\x0" --> "\x03www\0x5baidu\0x3com\0x0"
@@ -154,18 +167,15 @@ DnsRequest::ReqId DnsRequest::request(const DomainName &domain, const Callback &
 
     util::Serializer dump(send_buff);
 
-    uint16_t flags = 0x0100; //!< QR:请求, OPCODE:标准查询, RA:期望递归
-    uint16_t qd_count = 1;
-    uint16_t an_count = 0;
-    uint16_t ns_count = 0;
-    uint16_t ar_count = 0;
+    DnsHeader header;
+    header.id = req_id;
+    header.flags = 0x0100; //!< QR:请求, OPCODE:标准查询, RA:期望递归
+    header.qd_count = 1;
+    header.an_count = 0;
+    header.ns_count = 0;
+    header.ar_count = 0;
 
-    dump << req_id
-         << flags
-         << qd_count
-         << an_count
-         << ns_count
-         << ar_count;
+    util::AppendStruct(dump, header);
 
     AppendDomain(dump, domain.toString());
 
@@ -212,8 +222,12 @@ void DnsRequest::onUdpRecv(const void *data_ptr, size_t data_size, const SockAdd
 
     util::Deserializer parser(data_ptr, data_size);
 
-    uint16_t req_id, flags;
-    parser >> req_id >> flags;
+    DnsHeader header;
+    if (!util::FetchStruct(parser, header))
+        return;
+
+    uint16_t req_id = header.id;
+    uint16_t flags = header.flags;
 
     Request *req = findRequest(req_id);
     if (req == nullptr)
@@ -228,12 +242,12 @@ void DnsRequest::onUdpRecv(const void *data_ptr, size_t data_size, const SockAdd
     Result result;
 
     if (rcode == 0) {   //! 正常
-        uint16_t qd_count, an_count, ns_count, ar_count;
-        parser >> qd_count >> an_count >> ns_count >> ar_count;
+        uint16_t qd_count = header.qd_count;
+        uint16_t an_count = header.an_count;
 
 #if 0
         LogTrace("id:%d, flags:%04x, qd_count:%d, an_count:%d, ns_count:%d, ar_count:%d",
-               id, flags, qd_count, an_count, an_count, ns_count, ar_count);
+               req_id, flags, qd_count, an_count, header.ns_count, header.ar_count);
 #endif
 
         //! 解析Question字段
@@ -0,0 +1,477 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "shm_stream.h"
+
+#include <atomic>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include <tbox/base/log.h>
+#include <tbox/base/assert.h>
+#include <tbox/event/loop.h>
+#include <tbox/event/fd_event.h>
+
+namespace tbox {
+namespace network {
+
+using namespace std::placeholders;
+
+namespace {
+constexpr uint32_t kMagic = 0x54534d53;    //! "TSMS"
+constexpr uint32_t kVersion = 1;
+constexpr size_t   kHeaderSize = 4096;      //! 控制块独占一页，数据区从页边界开始
+constexpr size_t   kMinRingSize = 4096;
+}
+
+/**
+ * 单向环形缓冲的控制块
+ *
+ * write_pos 只由写端修改，read_pos 只由读端修改，都只增不减，取模后才是下标。
+ * 读写两端的数据放在不同的 cache line 上，避免互相干扰
+ */
+struct ShmStream::Ring {
+    alignas(64) std::atomic<uint64_t> write_pos;
+    alignas(64) std::atomic<uint64_t> read_pos;
+    alignas(64) std::atomic<uint32_t> is_reader_sleeping;   //!< 读端等待门铃中，写入后要唤醒它
+    std::atomic<uint32_t> is_writer_blocked;    //!< 写端因缓冲满而等待，读出后要唤醒它
+    std::atomic<uint32_t> is_writer_closed;     //!< 写端已 cleanup()
+};
+
+//! 共享内存的头部，第 i 端写 rings[i]，读 rings[1-i]
+struct ShmStream::Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t ring_size;
+    Ring rings[2];
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "need lock-free 64bits atomic in shared memory");
+
+ShmStream::ShmStream(event::Loop *wp_loop)
+    : wp_loop_(wp_loop)
+    , send_buff_(0)
+    , recv_buff_(0)
+{ }
+
+ShmStream::~ShmStream()
+{
+    TBOX_ASSERT(cb_level_ == 0);
+    cleanup();
+}
+
+bool ShmStream::create(size_t ring_size)
+{
+    if (state_ != State::kEmpty) {
+        LogWarn("can't reinitialize");
+        return false;
+    }
+
+    if (ring_size < kMinRingSize || (ring_size & (ring_size - 1)) != 0) {
+        LogWarn("ring_size %zu is invalid", ring_size);
+        return false;
+    }
+
+    Fds fds;
+    fds.mem_fd = Fd(::memfd_create("tbox_shm_stream", MFD_CLOEXEC));
+    fds.doorbell_fds[0] = Fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    fds.doorbell_fds[1] = Fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+
+    if (fds.mem_fd.isNull() || fds.doorbell_fds[0].isNull() || fds.doorbell_fds[1].isNull()) {
+        LogErr("create fd fail, errno:%d, %s", errno, strerror(errno));
+        return false;
+    }
+
+    if (::ftruncate(fds.mem_fd.get(), kHeaderSize + ring_size * 2) != 0) {
+        LogErr("ftruncate fail, errno:%d, %s", errno, strerror(errno));
+        return false;
+    }
+
+    return mapMemory(fds, true);
+}
+
+bool ShmStream::attach(const Fds &fds)
+{
+    if (state_ != State::kEmpty) {
+        LogWarn("can't reinitialize");
+        return false;
+    }
+
+    if (fds.mem_fd.isNull() || fds.doorbell_fds[0].isNull() || fds.doorbell_fds[1].isNull()) {
+        LogWarn("fd is null");
+        return false;
+    }
+
+    return mapMemory(fds, false);
+}
+
+bool ShmStream::mapMemory(const Fds &fds, bool is_creator)
+{
+    static_assert(sizeof(Header) <= kHeaderSize, "header too large");
+
+    struct stat st;
+    if (::fstat(fds.mem_fd.get(), &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize + kMinRingSize * 2) {
+        LogWarn("shared memory is too small");
+        return false;
+    }
+
+    size_t mem_size = st.st_size;
+    void *mem_ptr = ::mmap(nullptr, mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds.mem_fd.get(), 0);
+    if (mem_ptr == MAP_FAILED) {
+        LogErr("mmap fail, errno:%d, %s", errno, strerror(errno));
+        return false;
+    }
+
+    auto header = static_cast<Header*>(mem_ptr);
+    if (is_creator) {
+        //! memfd 的内容初始都是0，这里只需设置非0的字段
+        header->magic = kMagic;
+        header->version = kVersion;
+        header->ring_size = (mem_size - kHeaderSize) / 2;
+        for (auto &ring : header->rings)
+            ring.is_reader_sleeping.store(1);
+
+    } else if (header->magic != kMagic || header->version != kVersion
+               || kHeaderSize + header->ring_size * 2 != mem_size) {
+        LogWarn("shared memory is invalid");
+        ::munmap(mem_ptr, mem_size);
+        return false;
+    }
+
+    fds_ = fds;
+    side_ = is_creator ? 0 : 1;
+
+    mem_ptr_ = mem_ptr;
+    mem_size_ = mem_size;
+    header_ = header;
+    ring_mask_ = header->ring_size - 1;
+
+    auto data_ptr = static_cast<uint8_t*>(mem_ptr) + kHeaderSize;
+    tx_ring_ = &header->rings[side_];
+    rx_ring_ = &header->rings[1 - side_];
+    tx_data_ = data_ptr + header->ring_size * side_;
+    rx_data_ = data_ptr + header->ring_size * (1 - side_);
+
+    sp_doorbell_event_ = wp_loop_->newFdEvent("ShmStream::sp_doorbell_event_");
+    sp_doorbell_event_->initialize(fds_.doorbell_fds[side_].get(), event::FdEvent::kReadEvent, event::Event::Mode::kPersist);
+    sp_doorbell_event_->setCallback(std::bind(&ShmStream::onDoorbell, this, _1));
+
+    is_peer_closed_ = false;
+    state_ = State::kInited;
+    return true;
+}
+
+bool ShmStream::sendFdsTo(SocketFd sock) const
+{
+    if (state_ == State::kEmpty) {
+        LogWarn("please create() first");
+        return false;
+    }
+
+    int fds[3] = { fds_.mem_fd.get(), fds_.doorbell_fds[0].get(), fds_.doorbell_fds[1].get() };
+
+    char data = 0;
+    struct iovec iov = { &data, sizeof(data) };
+    char ctrl_buff[CMSG_SPACE(sizeof(fds))];
+    memset(ctrl_buff, 0, sizeof(ctrl_buff));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl_buff;
+    msg.msg_controllen = sizeof(ctrl_buff);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    if (::sendmsg(sock.get(), &msg, MSG_NOSIGNAL) != sizeof(data)) {
+        LogWarn("sendmsg fail, errno:%d, %s", errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool ShmStream::recvFdsFrom(SocketFd sock)
+{
+    int fds[3] = { -1, -1, -1 };
+
+    char data = 0;
+    struct iovec iov = { &data, sizeof(data) };
+    char ctrl_buff[CMSG_SPACE(sizeof(fds))];
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl_buff;
+    msg.msg_controllen = sizeof(ctrl_buff);
+
+    if (::recvmsg(sock.get(), &msg, MSG_CMSG_CLOEXEC) != sizeof(data)) {
+        LogWarn("recvmsg fail, errno:%d, %s", errno, strerror(errno));
+        return false;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS
+        || cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        LogWarn("no fds received");
+        return false;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+    Fds recv_fds;
+    recv_fds.mem_fd = Fd(fds[0]);
+    recv_fds.doorbell_fds[0] = Fd(fds[1]);
+    recv_fds.doorbell_fds[1] = Fd(fds[2]);
+    return attach(recv_fds);
+}
+
+void ShmStream::setReceiveCallback(const ReceiveCallback &cb, size_t threshold)
+{
+    receive_cb_ = cb;
+    receive_threshold_ = threshold;
+}
+
+bool ShmStream::send(const void *data_ptr, size_t data_size)
+{
+    if (state_ == State::kEmpty) {
+        LogWarn("please create() or attach() first");
+        return false;
+    }
+
+    if (is_peer_closed_)
+        return false;
+
+    if (send_buff_.readableSize() > 0) {
+        //! 前面还有没写进去的，只能排在后面
+        send_buff_.append(data_ptr, data_size);
+        return true;
+    }
+
+    size_t wsize = writeRing(data_ptr, data_size);
+    if (wsize < data_size) {
+        send_buff_.append(static_cast<const uint8_t*>(data_ptr) + wsize, data_size - wsize);
+        flushSendBuffer();
+    } else {
+        wakePeerIfSleeping();
+    }
+
+    return true;
+}
+
+bool ShmStream::enable()
+{
+    if (state_ == State::kRunning)
+        return true;
+
+    if (state_ != State::kInited) {
+        LogWarn("please create() or attach() first");
+        return false;
+    }
+
+    //! 之前写入的数据都按过门铃，使能后会被触发
+    sp_doorbell_event_->enable();
+    state_ = State::kRunning;
+    return true;
+}
+
+bool ShmStream::disable()
+{
+    if (state_ != State::kRunning)
+        return true;
+
+    sp_doorbell_event_->disable();
+    state_ = State::kInited;
+    return true;
+}
+
+void ShmStream::cleanup()
+{
+    if (state_ == State::kEmpty)
+        return;
+
+    disable();
+
+    //! 通知对端
+    tx_ring_->is_writer_closed.store(1);
+    ringPeer();
+
+    CHECK_DELETE_RESET_OBJ(sp_doorbell_event_);
+    ::munmap(mem_ptr_, mem_size_);
+
+    mem_ptr_ = nullptr;
+    mem_size_ = 0;
+    header_ = nullptr;
+    tx_ring_ = rx_ring_ = nullptr;
+    tx_data_ = rx_data_ = nullptr;
+    ring_mask_ = 0;
+    fds_ = Fds();
+
+    send_buff_.hasReadAll();
+    recv_buff_.hasReadAll();
+    state_ = State::kEmpty;
+}
+
+size_t ShmStream::writeRing(const void *data_ptr, size_t data_size)
+{
+    uint64_t write_pos = tx_ring_->write_pos.load(std::memory_order_relaxed);
+    uint64_t read_pos  = tx_ring_->read_pos.load(std::memory_order_acquire);
+
+    size_t free_size = (ring_mask_ + 1) - (write_pos - read_pos);
+    size_t wsize = std::min(free_size, data_size);
+    if (wsize == 0)
+        return 0;
+
+    size_t index = write_pos & ring_mask_;
+    size_t first_size = std::min(wsize, ring_mask_ + 1 - index);
+    memcpy(tx_data_ + index, data_ptr, first_size);
+    memcpy(tx_data_, static_cast<const uint8_t*>(data_ptr) + first_size, wsize - first_size);
+
+    tx_ring_->write_pos.store(write_pos + wsize, std::memory_order_release);
+    return wsize;
+}
+
+void ShmStream::readRing()
+{
+    uint64_t read_pos  = rx_ring_->read_pos.load(std::memory_order_relaxed);
+    uint64_t write_pos = rx_ring_->write_pos.load(std::memory_order_acquire);
+
+    size_t rsize = write_pos - read_pos;
+    if (rsize == 0)
+        return;
+
+    recv_buff_.ensureWritableSize(rsize);
+
+    size_t index = read_pos & ring_mask_;
+    size_t first_size = std::min(rsize, ring_mask_ + 1 - index);
+    memcpy(recv_buff_.writableBegin(), rx_data_ + index, first_size);
+    memcpy(recv_buff_.writableBegin() + first_size, rx_data_, rsize - first_size);
+    recv_buff_.hasWritten(rsize);
+
+    rx_ring_->read_pos.store(write_pos, std::memory_order_release);
+
+    //! 腾出了空间，对端若在等待就唤醒它
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (rx_ring_->is_writer_blocked.load(std::memory_order_relaxed) != 0
+        && rx_ring_->is_writer_blocked.exchange(0) != 0)
+        ringPeer();
+}
+
+void ShmStream::flushSendBuffer()
+{
+    bool is_blocked_marked = false;
+    while (send_buff_.readableSize() > 0) {
+        size_t wsize = writeRing(send_buff_.readableBegin(), send_buff_.readableSize());
+        send_buff_.hasRead(wsize);
+
+        if (wsize == 0) {
+            if (is_blocked_marked)
+                break;
+            //! 先标记再重试一次，防止对端在标记之前就腾出了空间而漏掉唤醒
+            tx_ring_->is_writer_blocked.store(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            is_blocked_marked = true;
+        }
+    }
+
+    wakePeerIfSleeping();
+}
+
+void ShmStream::wakePeerIfSleeping()
+{
+    //! 与读端睡眠前的 “先标记，再检查” 配对，保证不会漏掉唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (tx_ring_->is_reader_sleeping.load(std::memory_order_relaxed) != 0
+        && tx_ring_->is_reader_sleeping.exchange(0) != 0)
+        ringPeer();
+}
+
+void ShmStream::ringPeer()
+{
+    uint64_t one = 1;
+    fds_.doorbell_fds[1 - side_].write(&one, sizeof(one));
+}
+
+void ShmStream::deliverRecvData()
+{
+    if (recv_buff_.readableSize() == 0)
+        return;
+
+    //! 如果有绑定接收者，则应将数据直接转发给接收者
+    if (wp_receiver_ != nullptr) {
+        wp_receiver_->send(recv_buff_.readableBegin(), recv_buff_.readableSize());
+        recv_buff_.hasReadAll();
+
+    } else if (recv_buff_.readableSize() >= receive_threshold_) {
+        if (receive_cb_) {
+            ++cb_level_;
+            receive_cb_(recv_buff_);
+            --cb_level_;
+        } else {
+            LogWarn("receive_cb_ is not set");
+            recv_buff_.hasReadAll();    //! 丢弃数据，防止堆积
+        }
+    }
+}
+
+void ShmStream::onDoorbell(short)
+{
+    uint64_t count = 0;
+    fds_.doorbell_fds[side_].read(&count, sizeof(count));
+
+    //! 对端可能因缓冲满在等待
+    flushSendBuffer();
+
+    //! 先取标记，再读数据，保证对端关闭前写入的数据都能读到
+    bool is_writer_closed = rx_ring_->is_writer_closed.load() != 0;
+
+    for (;;) {
+        readRing();
+        deliverRecvData();
+        if (state_ != State::kRunning)  //! 可能在回调中被关闭了
+            return;
+
+        //! 处理期间对端写入不必按门铃，处理完了才进入睡眠，睡前再检查一次
+        rx_ring_->is_reader_sleeping.store(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (rx_ring_->write_pos.load(std::memory_order_acquire) == rx_ring_->read_pos.load(std::memory_order_relaxed))
+            break;
+        rx_ring_->is_reader_sleeping.store(0);
+    }
+
+    if (is_writer_closed && !is_peer_closed_) {
+        is_peer_closed_ = true;
+        disable();
+        if (peer_closed_cb_) {
+            ++cb_level_;
+            peer_closed_cb_();
+            --cb_level_;
+        }
+    }
+}
+
+}
+}
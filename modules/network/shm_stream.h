@@ -0,0 +1,159 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_NETWORK_SHM_STREAM_H_20251019
+#define TBOX_NETWORK_SHM_STREAM_H_20251019
+
+#include <functional>
+#include <tbox/base/defines.h>
+#include <tbox/event/forward.h>
+
+#include "byte_stream.h"
+#include "buffer.h"
+#include "fd.h"
+#include "socket_fd.h"
+
+namespace tbox {
+namespace network {
+
+/**
+ * 基于共享内存的字节流，用于同一主机上两个进程间的通信
+ *
+ * 一块 memfd 共享内存中有两个单生产者单消费者的环形缓冲，每个方向一个。
+ * 数据直接拷贝进对端的环形缓冲，不经过内核；只有对端在睡眠时才通过 eventfd 唤醒，
+ * 对端正在处理时连续发送的数据不会再产生系统调用
+ *
+ * 一端用 create() 创建，再把 fds() 交给另一端的 attach()。
+ * 不相关的进程之间可以通过 Unix 套接字用 sendFdsTo() 与 recvFdsFrom() 传递，
+ * fork() 出来的子进程可直接使用继承的 fd
+ *
+ * 用法:
+ *  ShmStream stream(wp_loop);
+ *  stream.create();
+ *  stream.sendFdsTo(unix_sock);
+ *  stream.setReceiveCallback(...);
+ *  stream.enable();
+ *  stream.send(data_ptr, data_size);
+ */
+class ShmStream : public ByteStream {
+  public:
+    explicit ShmStream(event::Loop *wp_loop);
+    virtual ~ShmStream();
+
+    NONCOPYABLE(ShmStream);
+    IMMOVABLE(ShmStream);
+
+  public:
+    //! 共享内存与两个门铃
+    struct Fds {
+        Fd mem_fd;
+        Fd doorbell_fds[2];
+    };
+
+    using PeerClosedCallback = std::function<void()>;
+
+    enum class State {
+        kEmpty,     //! 未初始化
+        kInited,    //! 已初始化
+        kRunning    //! 正在运行
+    };
+
+    /**
+     * 创建共享内存与门铃
+     *
+     * \param ring_size     每个方向的缓冲大小，须是2的幂，且不小于 4096
+     */
+    bool create(size_t ring_size = 1 << 20);
+    //! 使用另一端 create() 出的 fd
+    bool attach(const Fds &fds);
+
+    //! 获取要交给另一端的 fd
+    Fds fds() const { return fds_; }
+
+    //! 通过 Unix 套接字，把 fd 传给另一端
+    bool sendFdsTo(SocketFd sock) const;
+    //! 通过 Unix 套接字，接收另一端的 fd，并 attach()
+    bool recvFdsFrom(SocketFd sock);
+
+    //! 设置另一端 cleanup() 后的回调
+    void setPeerClosedCallback(const PeerClosedCallback &cb) { peer_closed_cb_ = cb; }
+
+    //! 实现 ByteStream 的接口
+    virtual void setReceiveCallback(const ReceiveCallback &cb, size_t threshold) override;
+    virtual bool send(const void *data_ptr, size_t data_size) override;
+    virtual void bind(ByteStream *receiver) override { wp_receiver_ = receiver; }
+    virtual void unbind() override { wp_receiver_ = nullptr; }
+
+    //! 启动与关闭内部事件驱动机制
+    bool enable();
+    bool disable();
+
+    void cleanup();
+
+    inline State state() const { return state_; }
+    //! 对端缓冲已满，暂存在本端还没有写进去的数据大小
+    size_t getSendBufferSize() const { return send_buff_.readableSize(); }
+
+  private:
+    struct Ring;
+    struct Header;
+
+    bool mapMemory(const Fds &fds, bool is_creator);
+    size_t writeRing(const void *data_ptr, size_t data_size);
+    void readRing();
+    void flushSendBuffer();
+    void wakePeerIfSleeping();
+    void ringPeer();
+    void deliverRecvData();
+    void onDoorbell(short);
+
+  private:
+    event::Loop *wp_loop_ = nullptr;
+    State state_ = State::kEmpty;
+
+    Fds fds_;
+    int side_ = 0;  //!< 创建的一端为0，另一端为1
+
+    void   *mem_ptr_ = nullptr;
+    size_t  mem_size_ = 0;
+    Header *header_ = nullptr;
+    Ring   *tx_ring_ = nullptr;
+    Ring   *rx_ring_ = nullptr;
+    uint8_t *tx_data_ = nullptr;
+    uint8_t *rx_data_ = nullptr;
+    size_t  ring_mask_ = 0;
+
+    event::FdEvent *sp_doorbell_event_ = nullptr;
+
+    Buffer send_buff_;
+    Buffer recv_buff_;
+
+    ReceiveCallback     receive_cb_;
+    PeerClosedCallback  peer_closed_cb_;
+    ByteStream *wp_receiver_ = nullptr;
+
+    size_t  receive_threshold_ = 0;
+    bool    is_peer_closed_ = false;
+    int     cb_level_ = 0;
+};
+
+}
+}
+
+#endif //TBOX_NETWORK_SHM_STREAM_H_20251019
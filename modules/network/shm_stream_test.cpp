@@ -0,0 +1,330 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <tbox/event/loop.h>
+#include <tbox/base/scope_exit.hpp>
+
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "shm_stream.h"
+#include "buffered_fd.h"
+
+using namespace std;
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::network;
+
+/**
+ * 两端在同一个 Loop 中，b 把收到的数据原样发回 a。
+ * a 分多次发出比环形缓冲大很多的数据，检查收回的数据是否一致
+ */
+TEST(ShmStream, Echo)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    ShmStream a(sp_loop), b(sp_loop);
+    ASSERT_TRUE(a.create(4096));
+    ASSERT_TRUE(b.attach(a.fds()));
+    EXPECT_FALSE(a.create(4096));
+
+    b.bind(&b);     //! 回显
+
+    std::string send_data;
+    std::mt19937 rand_engine(123);
+    for (int i = 0; i < 1000000; ++i)
+        send_data.push_back(static_cast<char>(rand_engine()));
+
+    std::string recv_data;
+    a.setReceiveCallback(
+        [&] (Buffer &buff) {
+            recv_data.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+            if (recv_data.size() == send_data.size())
+                sp_loop->exitLoop();
+        }, 0
+    );
+
+    a.enable();
+    b.enable();
+
+    //! 在 enable() 之前写入的也能收到
+    size_t pos = 0;
+    while (pos < send_data.size()) {
+        size_t size = std::min<size_t>(rand_engine() % 10000 + 1, send_data.size() - pos);
+        EXPECT_TRUE(a.send(send_data.data() + pos, size));
+        pos += size;
+    }
+    EXPECT_GT(a.getSendBufferSize(), 0u);
+
+    sp_loop->exitLoop(std::chrono::seconds(5));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(recv_data, send_data);
+    EXPECT_EQ(a.getSendBufferSize(), 0u);
+    EXPECT_EQ(b.getSendBufferSize(), 0u);
+}
+
+/**
+ * 通过 Unix 套接字传递 fd，再检查对端关闭的通知
+ */
+TEST(ShmStream, SendFdsAndPeerClose)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    int sv[2] = { -1, -1 };
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    SocketFd sock_a(sv[0]), sock_b(sv[1]);
+
+    ShmStream a(sp_loop), b(sp_loop);
+    ASSERT_TRUE(a.create());
+    ASSERT_TRUE(a.sendFdsTo(sock_a));
+    ASSERT_TRUE(b.recvFdsFrom(sock_b));
+
+    std::string recv_data;
+    bool is_peer_closed = false;
+    a.setReceiveCallback(
+        [&] (Buffer &buff) {
+            recv_data.append(reinterpret_cast<const char*>(buff.readableBegin()), buff.readableSize());
+            buff.hasReadAll();
+        }, 0
+    );
+    a.setPeerClosedCallback(
+        [&] {
+            is_peer_closed = true;
+            sp_loop->exitLoop();
+        }
+    );
+    a.enable();
+    b.enable();
+
+    sp_loop->run(
+        [&] {
+            b.send("hello ", 6);
+            b.send("world", 5);
+            b.cleanup();
+        }
+    );
+
+    sp_loop->exitLoop(std::chrono::seconds(1));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(recv_data, "hello world");
+    EXPECT_TRUE(is_peer_closed);
+    EXPECT_FALSE(a.send("x", 1));
+    EXPECT_FALSE(b.send("x", 1));
+}
+
+namespace {
+
+//! 在子进程中执行 func，之后直接退出
+pid_t RunInChild(const std::function<void()> &func)
+{
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        func();
+        ::_exit(0);
+    }
+    return pid;
+}
+
+//! 子进程中阻塞地回显，直到对端关闭
+void SocketEcho(int fd)
+{
+    char buff[65536];
+    for (;;) {
+        ssize_t rsize = ::read(fd, buff, sizeof(buff));
+        if (rsize <= 0)
+            break;
+        ssize_t pos = 0;
+        while (pos < rsize) {
+            ssize_t wsize = ::write(fd, buff + pos, rsize - pos);
+            if (wsize <= 0)
+                return;
+            pos += wsize;
+        }
+    }
+}
+
+/**
+ * 测量往返延时与吞吐量
+ *
+ * 先一来一回 kRoundNum 次 64 字节的消息，再连续发送 kTotalSize 字节（在途最多 kWindowSize）
+ */
+void Measure(Loop *wp_loop, ByteStream &stream, const char *name)
+{
+    const int kRoundNum = 20000;
+    const size_t kMsgSize = 64;
+    const size_t kTotalSize = 256 << 20;
+    const size_t kWindowSize = 1 << 20;
+    const size_t kChunkSize = 64 << 10;
+
+    std::string chunk(kChunkSize, 'x');
+
+    int round_count = 0;
+    size_t sent_size = 0;
+    size_t recv_size = 0;
+    bool is_throughput = false;
+
+    stream.setReceiveCallback(
+        [&] (Buffer &buff) {
+            if (!is_throughput) {
+                while (buff.readableSize() >= kMsgSize) {
+                    buff.hasRead(kMsgSize);
+                    if (++round_count == kRoundNum) {
+                        wp_loop->exitLoop();
+                        return;
+                    }
+                    stream.send(chunk.data(), kMsgSize);
+                }
+                return;
+            }
+
+            recv_size += buff.readableSize();
+            buff.hasReadAll();
+            if (recv_size >= kTotalSize) {
+                wp_loop->exitLoop();
+                return;
+            }
+            while (sent_size < kTotalSize && sent_size - recv_size < kWindowSize) {
+                stream.send(chunk.data(), kChunkSize);
+                sent_size += kChunkSize;
+            }
+        }, 0
+    );
+
+    auto start_time = std::chrono::steady_clock::now();
+    wp_loop->run([&] { stream.send(chunk.data(), kMsgSize); });
+    wp_loop->runLoop();
+    auto latency_cost = std::chrono::steady_clock::now() - start_time;
+
+    is_throughput = true;
+    start_time = std::chrono::steady_clock::now();
+    wp_loop->run(
+        [&] {
+            while (sent_size < kWindowSize) {
+                stream.send(chunk.data(), kChunkSize);
+                sent_size += kChunkSize;
+            }
+        }
+    );
+    wp_loop->runLoop();
+    auto throughput_cost = std::chrono::steady_clock::now() - start_time;
+
+    EXPECT_EQ(round_count, kRoundNum);
+    EXPECT_EQ(recv_size, kTotalSize);
+
+    auto latency_us = std::chrono::duration_cast<std::chrono::nanoseconds>(latency_cost).count() / 1000.0 / kRoundNum;
+    auto throughput_us = std::chrono::duration_cast<std::chrono::microseconds>(throughput_cost).count();
+    std::cout << name << ": round trip cost: " << latency_us << " us"
+              << ", " << (kTotalSize >> 20) << "MB echo cost: " << throughput_us << " us"
+              << " (" << (kTotalSize >> 20) * 1000000.0 / throughput_us << " MB/s)" << std::endl;
+}
+
+void MeasureSocket(int parent_fd, int child_fd, const char *name)
+{
+    pid_t pid = RunInChild([=] { ::close(parent_fd); SocketEcho(child_fd); });
+    ::close(child_fd);
+    ASSERT_GT(pid, 0);
+
+    Loop *sp_loop = Loop::New();
+    {
+        BufferedFd stream(sp_loop);
+        stream.initialize(parent_fd);
+        stream.enable();
+        Measure(sp_loop, stream, name);
+    }
+    delete sp_loop;
+
+    ::waitpid(pid, nullptr, 0);
+}
+
+}
+
+/**
+ * 与 Unix 套接字、TCP 回环对比，回显端在子进程中
+ */
+TEST(ShmStream, BenchmarkCompareSocket)
+{
+    {
+        Loop *sp_loop = Loop::New();
+        auto a = new ShmStream(sp_loop);
+        ASSERT_TRUE(a->create());
+        auto fds = a->fds();
+
+        pid_t pid = RunInChild(
+            [fds] {
+                Loop *sp_child_loop = Loop::New();
+                ShmStream b(sp_child_loop);
+                b.attach(fds);
+                b.bind(&b);
+                b.setPeerClosedCallback([sp_child_loop] { sp_child_loop->exitLoop(); });
+                b.enable();
+                sp_child_loop->runLoop();
+            }
+        );
+        ASSERT_GT(pid, 0);
+
+        a->enable();
+        Measure(sp_loop, *a, "shm");
+
+        delete a;   //! 通知子进程退出
+        delete sp_loop;
+        ::waitpid(pid, nullptr, 0);
+    }
+
+    {
+        int sv[2] = { -1, -1 };
+        ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+        MeasureSocket(sv[0], sv[1], "unix");
+    }
+
+    {
+        int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addr_len = sizeof(addr);
+        ASSERT_EQ(::bind(listen_fd, (struct sockaddr*)&addr, addr_len), 0);
+        ASSERT_EQ(::listen(listen_fd, 1), 0);
+        ASSERT_EQ(::getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len), 0);
+
+        int client_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(::connect(client_fd, (struct sockaddr*)&addr, addr_len), 0);
+        int server_fd = ::accept(listen_fd, nullptr, nullptr);
+        ::close(listen_fd);
+
+        int one = 1;
+        ::setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        ::setsockopt(server_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        MeasureSocket(client_fd, server_fd, "tcp");
+    }
+}
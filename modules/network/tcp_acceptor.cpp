@@ -25,6 +25,7 @@
 #include <cstring>
 
 #include <tbox/base/log.h>
+#include <tbox/base/log_limit.h>
 #include <tbox/base/assert.h>
 
 #include "tcp_connection.h"
@@ -151,12 +152,13 @@ void TcpAcceptor::onClientConnected()
     socklen_t addr_len = sizeof(addr);
     SocketFd peer_sock = sock_fd_.accept(&addr, &addr_len);
     if (peer_sock.isNull()) {
-        LogWarn("accept fail");
+        LogEveryMs(LOG_LEVEL_WARN, 1000, "accept fail. errno:%d, %s", errno, strerror(errno));
         return;
     }
 
     SockAddr peer_addr(addr, addr_len);
-    LogInfo("%s accepted new connection: %s", bind_addr_.toString().c_str(), peer_addr.toString().c_str());
+    LogRateLimit(LOG_LEVEL_INFO, 10, 20, "%s accepted new connection: %s",
+                 bind_addr_.toString().c_str(), peer_addr.toString().c_str());
 
     if (new_conn_cb_) {
         auto sp_connection = new TcpConnection(wp_loop_, peer_sock, peer_addr);
@@ -98,6 +98,33 @@ void TcpConnection::setContext(void *context, ContextDeleter &&deleter)
     context_deleter_ = std::move(deleter);
 }
 
+void TcpConnection::setSendCompleteCallback(const SendCompleteCallback &cb)
+{
+    if (sp_buffered_fd_ != nullptr)
+        sp_buffered_fd_->setSendCompleteCallback(cb);
+}
+
+size_t TcpConnection::getSendBufferSize() const
+{
+    if (sp_buffered_fd_ != nullptr)
+        return sp_buffered_fd_->getSendBufferSize();
+    return 0;
+}
+
+bool TcpConnection::sendFile(Fd file_fd, off_t offset, size_t size)
+{
+    if (sp_buffered_fd_ != nullptr)
+        return sp_buffered_fd_->sendFile(file_fd, offset, size);
+    return false;
+}
+
+bool TcpConnection::sendv(const struct iovec *iov, int iovcnt)
+{
+    if (sp_buffered_fd_ != nullptr)
+        return sp_buffered_fd_->sendv(iov, iovcnt);
+    return false;
+}
+
 void TcpConnection::setReceiveCallback(const ReceiveCallback &cb, size_t threshold)
 {
     if (sp_buffered_fd_ != nullptr)
@@ -43,6 +43,15 @@ class TcpConnection : public ByteStream {
   public:
     using DisconnectedCallback = std::function<void ()>;
     void setDisconnectedCallback(const DisconnectedCallback &cb) { disconnected_cb_ = cb; }
+    //! 设置发送缓冲中的数据全部发送完成时的回调，可用于实现流控
+    using SendCompleteCallback = std::function<void ()>;
+    void setSendCompleteCallback(const SendCompleteCallback &cb);
+    //! 发送缓冲中还未发送出去的数据大小
+    size_t getSendBufferSize() const;
+    //! 用 sendfile() 发送文件中的一段，见 BufferedFd::sendFile()
+    bool sendFile(Fd file_fd, off_t offset, size_t size);
+    //! 用 writev() 一次发送多块数据，见 BufferedFd::sendv()
+    bool sendv(const struct iovec *iov, int iovcnt);
     bool disconnect();  //! 主动断开
     bool shutdown(int howto);
 
@@ -43,6 +43,7 @@ struct TcpServer::Data {
     DisconnectedCallback    disconnected_cb;
     ReceiveCallback         receive_cb;
     size_t                  receive_threshold = 0;
+    SendCompleteCallback    send_complete_cb;
 
     TcpAcceptor *sp_acceptor = nullptr;
     TcpConns conns;     //!< TcpConnection 容器
@@ -100,6 +101,11 @@ void TcpServer::setReceiveCallback(const ReceiveCallback &cb, size_t threshold)
     d_->receive_threshold = threshold;
 }
 
+void TcpServer::setSendCompleteCallback(const SendCompleteCallback &cb)
+{
+    d_->send_complete_cb = cb;
+}
+
 bool TcpServer::start()
 {
     if (d_->state != State::kInited)
@@ -142,6 +148,7 @@ void TcpServer::cleanup()
     d_->disconnected_cb = nullptr;
     d_->receive_cb = nullptr;
     d_->receive_threshold = 0;
+    d_->send_complete_cb = nullptr;
 
     d_->state = State::kNone;
 }
@@ -154,6 +161,22 @@ bool TcpServer::send(const ConnToken &client, const void *data_ptr, size_t data_
     return false;
 }
 
+bool TcpServer::sendFile(const ConnToken &client, Fd file_fd, off_t offset, size_t size)
+{
+    auto conn = d_->conns.at(client);
+    if (conn != nullptr)
+        return conn->sendFile(file_fd, offset, size);
+    return false;
+}
+
+bool TcpServer::sendv(const ConnToken &client, const struct iovec *iov, int iovcnt)
+{
+    auto conn = d_->conns.at(client);
+    if (conn != nullptr)
+        return conn->sendv(iov, iovcnt);
+    return false;
+}
+
 bool TcpServer::disconnect(const ConnToken &client)
 {
     auto conn = d_->conns.free(client);
@@ -186,6 +209,22 @@ SockAddr TcpServer::getClientAddress(const ConnToken &client) const
     return SockAddr();
 }
 
+SocketFd TcpServer::getClientSocketFd(const ConnToken &client) const
+{
+    auto conn = d_->conns.at(client);
+    if (conn != nullptr)
+        return conn->socketFd();
+    return SocketFd();
+}
+
+size_t TcpServer::getSendBufferSize(const ConnToken &client) const
+{
+    auto conn = d_->conns.at(client);
+    if (conn != nullptr)
+        return conn->getSendBufferSize();
+    return 0;
+}
+
 void TcpServer::setContext(const ConnToken &client, void* context, ContextDeleter &&deleter)
 {
     auto conn = d_->conns.at(client);
@@ -211,6 +250,7 @@ void TcpServer::onTcpConnected(TcpConnection *new_conn)
     ConnToken client = d_->conns.alloc(new_conn);
     new_conn->setReceiveCallback(std::bind(&TcpServer::onTcpReceived, this, client, _1), d_->receive_threshold);
     new_conn->setDisconnectedCallback(std::bind(&TcpServer::onTcpDisconnected, this, client));
+    new_conn->setSendCompleteCallback(std::bind(&TcpServer::onTcpSendCompleted, this, client));
 
     ++d_->cb_level;
     if (d_->connected_cb)
@@ -241,5 +281,13 @@ void TcpServer::onTcpReceived(const ConnToken &client, Buffer &buff)
     --d_->cb_level;
 }
 
+void TcpServer::onTcpSendCompleted(const ConnToken &client)
+{
+    ++d_->cb_level;
+    if (d_->send_complete_cb)
+        d_->send_complete_cb(client);
+    --d_->cb_level;
+}
+
 }
 }
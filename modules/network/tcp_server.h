@@ -26,6 +26,8 @@
 
 #include "sockaddr.h"
 #include "buffer.h"
+#include "fd.h"
+#include "socket_fd.h"
 
 namespace tbox {
 namespace network {
@@ -56,6 +58,7 @@ class TcpServer {
     using ConnectedCallback     = std::function<void(const ConnToken &)>;
     using DisconnectedCallback  = std::function<void(const ConnToken &)>;
     using ReceiveCallback       = std::function<void(const ConnToken &, Buffer &)>;
+    using SendCompleteCallback  = std::function<void(const ConnToken &)>;
 
     //! 设置有新客户端连接时的回调
     void setConnectedCallback(const ConnectedCallback &cb);
@@ -63,6 +66,8 @@ class TcpServer {
     void setDisconnectedCallback(const DisconnectedCallback &cb);
     //! 设置接收到客户端消息时的回调
     void setReceiveCallback(const ReceiveCallback &cb, size_t threshold);
+    //! 设置客户端发送缓冲中的数据全部发送完成时的回调
+    void setSendCompleteCallback(const SendCompleteCallback &cb);
 
     bool start();   //!< 启动服务
     void stop();    //!< 停止服务，断开所有连接
@@ -70,6 +75,10 @@ class TcpServer {
 
     //! 向指定客户端发送数据
     bool send(const ConnToken &client, const void *data_ptr, size_t data_size);
+    //! 向指定客户端发送文件中的一段，不经过用户空间
+    bool sendFile(const ConnToken &client, Fd file_fd, off_t offset, size_t size);
+    //! 向指定客户端一次发送多块数据
+    bool sendv(const ConnToken &client, const struct iovec *iov, int iovcnt);
     //! 断开指定客户端的连接
     bool disconnect(const ConnToken &client);
     //! 半关闭
@@ -79,6 +88,10 @@ class TcpServer {
     bool isClientValid(const ConnToken &client) const;
     //! 获取客户端的地址
     SockAddr getClientAddress(const ConnToken &client) const;
+    //! 获取客户端发送缓冲中还未发送出去的数据大小
+    size_t getSendBufferSize(const ConnToken &client) const;
+    //! 获取客户端的 socket，用于设置 TCP_NODELAY 等选项
+    SocketFd getClientSocketFd(const ConnToken &client) const;
 
     //! 设置上下文
     using ContextDeleter = std::function<void(void*)>;
@@ -91,6 +104,7 @@ class TcpServer {
     void onTcpConnected(TcpConnection *new_conn);
     void onTcpDisconnected(const ConnToken &client);
     void onTcpReceived(const ConnToken &client, Buffer &buff);
+    void onTcpSendCompleted(const ConnToken &client);
 
   private:
     struct Data;
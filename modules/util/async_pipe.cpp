@@ -53,6 +53,10 @@ class AsyncPipe::Impl {
         inline bool   empty() const { return size_ == 0; }
         inline void  *data()  const { return data_; }
         inline size_t size()  const { return size_; }
+        inline size_t capacity() const { return capacity_; }
+        inline size_t remain() const { return capacity_ - size_; }
+        inline void  *tail()  const { return data_ + size_; }
+        inline void   commit(size_t size) { size_ += size; }
         inline void   reset() { size_ = 0; }
 
       private:
@@ -67,19 +71,30 @@ class AsyncPipe::Impl {
 
     bool initialize(const Config &cfg);
     void setCallback(const Callback &cb) { cb_ = cb; }
+    void setBatchCallback(const BatchCallback &cb) { batch_cb_ = cb; }
     void cleanup();
     void append(const void *data_ptr, size_t data_size);
+    void* reserve(size_t size);
+    void commit(size_t size);
 
   protected:
     void threadFunc();
 
+    void takeFreeBufferAsCurr();    //! 从 free_buffers_ 中取一个作为 curr_buffer_，需持有 curr_buffer_mutex_
+    void pushCurrBufferToFull();    //! 将 curr_buffer_ 放入 full_buffers_，需持有 curr_buffer_mutex_
+    void handleBuffers();           //! 处理 handling_buffers_ 中的缓冲
+    void recycleBuffer(Buffer *buff);
+
   private:
     Config      cfg_;
     Callback    cb_;
+    BatchCallback batch_cb_;
 
     Buffer*         curr_buffer_ = nullptr; //!< 当前缓冲
     vector<Buffer*> free_buffers_;  //!< 可用缓冲数组
     deque<Buffer*>  full_buffers_;  //!< 已满缓冲队列
+    vector<Buffer*> handling_buffers_;  //!< 后台线程正在处理的缓冲
+    vector<struct iovec> iovecs_;       //!< 批量回调用的
     size_t          buff_num_;      //!< 缓冲个数
 
     bool    inited_ = false;        //!< 是否已经启动子线程
@@ -141,11 +156,26 @@ void AsyncPipe::cleanup()
     impl_->cleanup();
 }
 
+void AsyncPipe::setBatchCallback(const BatchCallback &cb)
+{
+    impl_->setBatchCallback(cb);
+}
+
 void AsyncPipe::append(const void *data_ptr, size_t data_size)
 {
     impl_->append(data_ptr, data_size);
 }
 
+void* AsyncPipe::reserve(size_t size)
+{
+    return impl_->reserve(size);
+}
+
+void AsyncPipe::commit(size_t size)
+{
+    impl_->commit(size);
+}
+
 AsyncPipe::Impl::Impl()
 { }
 
@@ -206,6 +236,7 @@ void AsyncPipe::Impl::cleanup()
     free_buffers_.clear();
 
     cb_ = nullptr;
+    batch_cb_ = nullptr;
     inited_ = false;
 }
 
@@ -216,42 +247,88 @@ void AsyncPipe::Impl::append(const void *data_ptr, size_t data_size)
 
     std::lock_guard<std::mutex> lg(curr_buffer_mutex_);
     while (remain_size > 0) {
-        if (curr_buffer_ == nullptr) {
-            //! 如果 curr_buffer_ 没有分配，则应该从 free_buffers_ 中取一个出来
-            std::unique_lock<std::mutex> lk(free_buffers_mutex_);
-            if (free_buffers_.empty()) {    //! 如里 free_buffers_ 为空，则要等
-                buff_num_mutex_.lock();
-                if (buff_num_ < cfg_.buff_max_num) {
-                    ++buff_num_;
-                    buff_num_mutex_.unlock();
-                    //! 如果缓冲数还没有达到最大限值，则可以继续申请
-                    free_buffers_.push_back(new Buffer(cfg_.buff_size));
-                } else {
-                    buff_num_mutex_.unlock();
-                    free_buffers_cv_.wait(lk, [this] { return !free_buffers_.empty(); });
-                }
-            }
+        if (curr_buffer_ == nullptr)
+            takeFreeBufferAsCurr();
 
-            //! 将 free_buffers_ 中最后的一个弹出来，给到 curr_buffer_
-            curr_buffer_ = free_buffers_.back();
-            free_buffers_.pop_back();
-            //! Q: 为什么从 free_buffers_ 尾部取，而不是向 full_buffers_ 那样从头部取呢？
-            //! A: 因为 free_buffers_ 所存空闲缓冲，没有顺序要求。而 full_buffers_ 必须要有顺序性
-            //!    既然不需要顺序性，那么 vector 的尾部进出是最高效的。
-        }
         auto size = curr_buffer_->append(ptr, remain_size);
-        if (curr_buffer_->full()) {
-            //! 如果当前缓冲满了
-            std::lock_guard<std::mutex> lg2(full_buffers_mutex_);
-            full_buffers_.push_back(curr_buffer_);  //! 将 curr_buffer_ 放到 full_buffers_ 中
-            full_buffers_cv_.notify_all();  //! 通知后台线程开始干活
-            curr_buffer_ = nullptr;
-        }
+        if (curr_buffer_->full())
+            pushCurrBufferToFull();
+
         ptr += size;
         remain_size -= size;
     }
 }
 
+void* AsyncPipe::Impl::reserve(size_t size)
+{
+    if (!inited_)
+        return nullptr;
+
+    //! 注意：锁在 commit() 中才释放
+    curr_buffer_mutex_.lock();
+
+    //! 当前缓冲剩余空间不够，就提前交给后台，保证数据不被拆分
+    if (curr_buffer_ != nullptr && curr_buffer_->remain() < size) {
+        if (curr_buffer_->empty()) {
+            recycleBuffer(curr_buffer_);
+            curr_buffer_ = nullptr;
+        } else {
+            pushCurrBufferToFull();
+        }
+    }
+
+    if (curr_buffer_ == nullptr) {
+        if (size > cfg_.buff_size)
+            curr_buffer_ = new Buffer(size);    //! 超大的数据，临时分配一个专用缓冲
+        else
+            takeFreeBufferAsCurr();
+    }
+
+    return curr_buffer_->tail();
+}
+
+void AsyncPipe::Impl::commit(size_t size)
+{
+    curr_buffer_->commit(size);
+    if (curr_buffer_->full() || curr_buffer_->capacity() != cfg_.buff_size)
+        pushCurrBufferToFull();
+
+    curr_buffer_mutex_.unlock();
+}
+
+void AsyncPipe::Impl::takeFreeBufferAsCurr()
+{
+    //! 如果 curr_buffer_ 没有分配，则应该从 free_buffers_ 中取一个出来
+    std::unique_lock<std::mutex> lk(free_buffers_mutex_);
+    if (free_buffers_.empty()) {    //! 如里 free_buffers_ 为空，则要等
+        buff_num_mutex_.lock();
+        if (buff_num_ < cfg_.buff_max_num) {
+            ++buff_num_;
+            buff_num_mutex_.unlock();
+            //! 如果缓冲数还没有达到最大限值，则可以继续申请
+            free_buffers_.push_back(new Buffer(cfg_.buff_size));
+        } else {
+            buff_num_mutex_.unlock();
+            free_buffers_cv_.wait(lk, [this] { return !free_buffers_.empty(); });
+        }
+    }
+
+    //! 将 free_buffers_ 中最后的一个弹出来，给到 curr_buffer_
+    curr_buffer_ = free_buffers_.back();
+    free_buffers_.pop_back();
+    //! Q: 为什么从 free_buffers_ 尾部取，而不是向 full_buffers_ 那样从头部取呢？
+    //! A: 因为 free_buffers_ 所存空闲缓冲，没有顺序要求。而 full_buffers_ 必须要有顺序性
+    //!    既然不需要顺序性，那么 vector 的尾部进出是最高效的。
+}
+
+void AsyncPipe::Impl::pushCurrBufferToFull()
+{
+    std::lock_guard<std::mutex> lg(full_buffers_mutex_);
+    full_buffers_.push_back(curr_buffer_);  //! 将 curr_buffer_ 放到 full_buffers_ 中
+    full_buffers_cv_.notify_all();  //! 通知后台线程开始干活
+    curr_buffer_ = nullptr;
+}
+
 void AsyncPipe::Impl::threadFunc()
 {
     do {
@@ -265,67 +342,87 @@ void AsyncPipe::Impl::threadFunc()
                 }
             );
         }
-        //! 先处理 full_buffers_ 中的数据
+
+        //! 先处理 full_buffers_ 中的数据，每次取出当前所有的缓冲，直到取空为止
         for (;;) {
-            Buffer *buff = nullptr;
             {
-                //! 尝试从 full_buffers_ 中取一个出来
                 std::lock_guard<std::mutex> lg(full_buffers_mutex_);
-                if (!full_buffers_.empty()) {
-                    buff = full_buffers_.front();
-                    full_buffers_.pop_front();
-                } else
-                    break;
+                handling_buffers_.assign(full_buffers_.begin(), full_buffers_.end());
+                full_buffers_.clear();
             }
 
-            if (buff != nullptr) {
-                //! 进行处理
-                if (cb_)
-                    cb_(buff->data(), buff->size());
-                buff->reset();
-
-                buff_num_mutex_.lock();
-                if (buff_num_ > cfg_.buff_min_num) {
-                    --buff_num_;
-                    buff_num_mutex_.unlock();
-                    delete buff;
-                } else {
-                    buff_num_mutex_.unlock();
-                    //! 将处理后的缓冲放回 free_buffers_ 中
-                    std::lock_guard<std::mutex> lg(free_buffers_mutex_);
-                    free_buffers_.push_back(buff);
-                    free_buffers_cv_.notify_all();
-                }
-            }
+            if (handling_buffers_.empty())
+                break;
+
+            handleBuffers();
         }
 
         //! 最后检查 curr_buffer_ 中的数据
-        {
-            Buffer *buff = nullptr;
-            if (curr_buffer_mutex_.try_lock()) {
-                //! 注意：这里一定要用 try_lock()，否则会死锁
-                if (curr_buffer_ != nullptr && !curr_buffer_->empty()) {
-                    buff = curr_buffer_;
-                    curr_buffer_ = nullptr;
-                }
-                curr_buffer_mutex_.unlock();
-            }
-
-            if (buff != nullptr) {  //! 如果没取出来
-                //! 进行处理
-                if (cb_)
-                    cb_(buff->data(), buff->size());
-                buff->reset();
-                //! 然后将处理后的buff放入到free_buffers_中
-                std::lock_guard<std::mutex> lg(free_buffers_mutex_);
-                free_buffers_.push_back(buff);
-                free_buffers_cv_.notify_all();
+        if (curr_buffer_mutex_.try_lock()) {
+            //! 注意：这里一定要用 try_lock()，否则会死锁
+            if (curr_buffer_ != nullptr && !curr_buffer_->empty()) {
+                handling_buffers_.push_back(curr_buffer_);
+                curr_buffer_ = nullptr;
             }
+            curr_buffer_mutex_.unlock();
         }
+
+        handleBuffers();
     } while (!stop_signal_);  //! 如果是停止信号，则直接跳出循环，结束线程
     //! stop_signal_ 信号为什么不在被唤醒时就break呢？
     //! 因为我们期望就算是退出了，Buff中的数据都应该先被处理掉
 }
 
+void AsyncPipe::Impl::handleBuffers()
+{
+    if (handling_buffers_.empty())
+        return;
+
+    if (batch_cb_) {
+        //! 批量模式，一次性交给回调
+        iovecs_.clear();
+        for (auto buff : handling_buffers_)
+            iovecs_.push_back({ buff->data(), buff->size() });
+        batch_cb_(iovecs_.data(), iovecs_.size());
+
+        for (auto buff : handling_buffers_)
+            recycleBuffer(buff);
+
+    } else {
+        //! 逐个处理，处理完一个就回收一个，尽早让前端有空闲缓冲可用
+        for (auto buff : handling_buffers_) {
+            if (cb_)
+                cb_(buff->data(), buff->size());
+            recycleBuffer(buff);
+        }
+    }
+
+    handling_buffers_.clear();
+}
+
+void AsyncPipe::Impl::recycleBuffer(Buffer *buff)
+{
+    //! 由 reserve() 临时分配的超大缓冲，不计入 buff_num_，直接释放
+    if (buff->capacity() != cfg_.buff_size) {
+        delete buff;
+        return;
+    }
+
+    buff->reset();
+
+    buff_num_mutex_.lock();
+    if (buff_num_ > cfg_.buff_min_num) {
+        --buff_num_;
+        buff_num_mutex_.unlock();
+        delete buff;
+    } else {
+        buff_num_mutex_.unlock();
+        //! 将处理后的缓冲放回 free_buffers_ 中
+        std::lock_guard<std::mutex> lg(free_buffers_mutex_);
+        free_buffers_.push_back(buff);
+        free_buffers_cv_.notify_all();
+    }
+}
+
 }
 }
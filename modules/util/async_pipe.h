@@ -40,12 +40,28 @@
  * 1）缓冲写满；2）距上次同步数据超过cfg.interval毫秒数
  *
  * 当对象被销毁或cleanup()时，会自动停止后台的线程，并将所有缓冲的数据同步调用预设置的回调
+ *
+ * 零拷贝写入：
+ * append() 会在缓冲不足时将数据拆分到两个缓冲中。如果希望每条记录都完整地
+ * 落在一个缓冲里，可以使用 reserve() 与 commit()：
+ *
+ * void *ptr = async_pipe.reserve(size);  //! 获取一块连续的空间
+ * ...                                     //! 直接在 ptr 上构造数据
+ * async_pipe.commit(size);                //! 提交实际写入的长度
+ *
+ * 注意：reserve() 与 commit() 必须在同一线程中成对调用，期间其它写入者会被阻塞。
+ *       如果 size 超过 buff_size，会临时分配一个足够大的缓冲。
+ *
+ * 批量读取：
+ * 通过 setBatchCallback() 设置的回调，每次会以 iovec 数组的形式拿到所有待处理的缓冲，
+ * 可一次性处理（如 writev()），减少回调次数。
  */
 #ifndef TBOX_ASYNC_PIPLE_H_20211219
 #define TBOX_ASYNC_PIPLE_H_20211219
 
 #include <cstddef>
 #include <functional>
+#include <sys/uio.h>
 
 namespace tbox {
 namespace util {
@@ -57,6 +73,7 @@ class AsyncPipe {
 
   public:
     using Callback = std::function<void(const void *, size_t)>;
+    using BatchCallback = std::function<void(const struct iovec *, size_t)>;
     struct Config {
         size_t buff_size = 1024;    //!< 缓冲大小，默认1KB
         size_t buff_min_num = 2;    //!< 缓冲保留个数，默认2
@@ -66,8 +83,12 @@ class AsyncPipe {
 
     bool initialize(const Config &cfg);     //! 初始化
     void setCallback(const Callback &cb);   //! 设置回调
+    void setBatchCallback(const BatchCallback &cb); //! 设置批量回调，与 setCallback() 二选一
 
     void append(const void *data_ptr, size_t data_size); //! 异步写入
+
+    void* reserve(size_t size); //! 预留一块连续的空间，未初始化时返回nullptr
+    void commit(size_t size);   //! 提交 reserve() 得到的空间中实际写入的长度
     void cleanup(); //! 清理
 
   private:
@@ -21,6 +21,8 @@
 #include <gtest/gtest.h>
 #include <vector>
 #include <thread>
+#include <cstring>
+#include <algorithm>
 
 using namespace tbox::util;
 using namespace std;
@@ -205,3 +207,94 @@ TEST(AsyncPipe, ForgetCleanup)
     EXPECT_EQ(out_data[0], 12);
     ap.cleanup();
 }
+
+/**
+ * 测试 reserve() 与 commit()
+ *
+ * 每条记录都应该完整地落在同一个缓冲中，不被拆分
+ */
+TEST(AsyncPipe, ReserveCommit)
+{
+    AsyncPipe::Config cfg;
+    cfg.buff_size = 64;
+    cfg.buff_min_num  = 2;
+    cfg.buff_max_num  = 4;
+    cfg.interval = 10;
+
+    vector<size_t> buffer_sizes;
+    vector<uint8_t> out_data;
+
+    AsyncPipe ap;
+    EXPECT_TRUE(ap.initialize(cfg));
+    ap.setCallback(
+        [&] (const void *ptr, size_t size) {
+            const uint8_t *p = static_cast<const uint8_t*>(ptr);
+            buffer_sizes.push_back(size);
+            out_data.insert(out_data.end(), p, p + size);
+        }
+    );
+
+    //! 每条记录10字节，内容为记录序号，64字节的缓冲只能放6条
+    for (uint8_t i = 0; i < 100; ++i) {
+        auto p = static_cast<uint8_t*>(ap.reserve(10));
+        ASSERT_NE(p, nullptr);
+        ::memset(p, i, 10);
+        ap.commit(10);
+    }
+
+    //! 超过 buff_size 的记录
+    vector<uint8_t> big(200, 0xff);
+    ::memcpy(ap.reserve(big.size()), big.data(), big.size());
+    ap.commit(big.size());
+
+    ap.cleanup();
+
+    ASSERT_EQ(out_data.size(), 1200u);
+    for (size_t i = 0; i < 1000; ++i)
+        EXPECT_EQ(out_data[i], i / 10);
+
+    for (auto size : buffer_sizes)
+        EXPECT_TRUE(size % 10 == 0 || size == 200);
+}
+
+TEST(AsyncPipe, ReserveWithoutInit)
+{
+    AsyncPipe ap;
+    EXPECT_EQ(ap.reserve(10), nullptr);
+}
+
+TEST(AsyncPipe, BatchCallback)
+{
+    AsyncPipe::Config cfg;
+    cfg.buff_size = 16;
+    cfg.buff_min_num  = 2;
+    cfg.buff_max_num  = 20;
+    cfg.interval = 10;
+
+    vector<uint8_t> out_data;
+    size_t max_iovcnt = 0;
+
+    AsyncPipe ap;
+    EXPECT_TRUE(ap.initialize(cfg));
+    ap.setBatchCallback(
+        [&] (const struct iovec *iov, size_t iovcnt) {
+            for (size_t i = 0; i < iovcnt; ++i) {
+                const uint8_t *p = static_cast<const uint8_t*>(iov[i].iov_base);
+                out_data.insert(out_data.end(), p, p + iov[i].iov_len);
+            }
+            max_iovcnt = std::max(max_iovcnt, iovcnt);
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+    );
+
+    for (size_t i = 0; i < 256; ++i) {
+        uint8_t v = i;
+        ap.append(&v, 1);
+    }
+    ap.cleanup();
+
+    ASSERT_EQ(out_data.size(), 256u);
+    for (size_t i = 0; i < 256; ++i)
+        EXPECT_EQ(out_data[i], i);
+    EXPECT_GT(max_iovcnt, 1u);
+}
@@ -18,11 +18,22 @@
  * of the source tree.
  */
 #include "json.h"
-
-#include <fstream>
+#include "json_parser.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #include <tbox/base/json.hpp>
 #include <tbox/base/assert.h>
+#include <tbox/base/defines.h>
 
 namespace tbox {
 namespace util {
@@ -166,76 +177,326 @@ bool HasStringField(const Json &js, const std::string &field_name)
     return js_field.is_string();
 }
 
-Json Load(const std::string &filename)
-{
-    Json js;
-    std::ifstream input_json_file(filename);
-    if (input_json_file.is_open()) {
-        try {
-            input_json_file >> js;
-        } catch (const std::exception &e) {
-            throw ParseJsonFileError(filename, e.what());
+namespace {
+
+/**
+ * 以只读方式将整个文件映射到内存
+ *
+ * 省去了先读入 std::string 的拷贝，且可以直接交给 Parse() 在原文上解析。
+ * 对于不能映射的文件（如管道）则退回到 read()。
+ */
+class FileText {
+  public:
+    explicit FileText(const std::string &filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw OpenFileError(filename);
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *ptr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED) {
+                ::madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+                map_ptr_ = ptr;
+                size_ = st.st_size;
+            }
+        }
+
+        if (map_ptr_ == nullptr) {
+            char buff[4096];
+            for (;;) {
+                ssize_t rsize = ::read(fd, buff, sizeof(buff));
+                if (rsize > 0) {
+                    read_buff_.append(buff, rsize);
+                } else if (rsize == 0 || errno != EINTR) {
+                    break;
+                }
+            }
+            size_ = read_buff_.size();
         }
-    } else {
-        throw OpenFileError(filename);
+
+        ::close(fd);
     }
 
-    return js;
+    ~FileText() {
+        if (map_ptr_ != nullptr)
+            ::munmap(map_ptr_, size_);
+    }
+
+    NONCOPYABLE(FileText);
+    IMMOVABLE(FileText);
+
+  public:
+    const char* data() const { return map_ptr_ != nullptr ? static_cast<const char*>(map_ptr_) : read_buff_.data(); }
+    size_t size() const { return size_; }
+
+  private:
+    void *map_ptr_ = nullptr;
+    std::string read_buff_;
+    size_t size_ = 0;
+};
+
+Json ParseText(const FileText &text, const std::string &filename)
+{
+    try {
+        return Parse(text.data(), text.size());
+    } catch (const ParseJsonError &e) {
+        throw ParseJsonFileError(filename, e.what());
+    }
+}
+
+}
+
+Json Load(const std::string &filename)
+{
+    FileText text(filename);
+    return ParseText(text, filename);
+}
+
+Json Load(const std::string &filename, const std::string &keyword, bool &is_keyword_found)
+{
+    FileText text(filename);
+    //! 字串中含有 \uXXXX 转义时，解析后可能拼出 keyword，只好当作找到
+    is_keyword_found = ::memmem(text.data(), text.size(), keyword.data(), keyword.size()) != nullptr ||
+                       ::memmem(text.data(), text.size(), "\\u", 2) != nullptr;
+    return ParseText(text, filename);
 }
 
 /**
  * 通过数[],{},"的方式找JSON字串的结束位置
  */
 int FindEndPos(const char *str_ptr, size_t str_len)
+{
+    EndPosFinder finder;
+    return finder.find(str_ptr, str_len);
+}
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+
+#if defined(__SSE2__)
+//! 一块数据中各特征字符的位置，第 i 位对应第 i 个字节
+struct BlockMasks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t open_brace;
+    uint64_t close_brace;
+    uint64_t open_square;
+    uint64_t close_square;
+};
+
+#if defined(__AVX2__)
+inline uint64_t Match(const __m256i &lo, const __m256i &hi, char ch)
+{
+    const __m256i pattern = _mm256_set1_epi8(ch);
+    uint64_t lo_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, pattern)));
+    uint64_t hi_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, pattern)));
+    return lo_mask | (hi_mask << 32);
+}
+
+void Classify(const char *block, BlockMasks &masks)
+{
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    masks.quote = Match(lo, hi, '"');
+    masks.backslash = Match(lo, hi, '\\');
+    masks.open_brace = Match(lo, hi, '{');
+    masks.close_brace = Match(lo, hi, '}');
+    masks.open_square = Match(lo, hi, '[');
+    masks.close_square = Match(lo, hi, ']');
+}
+#else
+inline uint64_t Match(const __m128i (&chunks)[4], char ch)
+{
+    const __m128i pattern = _mm_set1_epi8(ch);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        uint64_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], pattern)));
+        mask |= bits << (i * 16);
+    }
+    return mask;
+}
+
+void Classify(const char *block, BlockMasks &masks)
+{
+    __m128i chunks[4];
+    for (int i = 0; i < 4; ++i)
+        chunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+    masks.quote = Match(chunks, '"');
+    masks.backslash = Match(chunks, '\\');
+    masks.open_brace = Match(chunks, '{');
+    masks.close_brace = Match(chunks, '}');
+    masks.open_square = Match(chunks, '[');
+    masks.close_square = Match(chunks, ']');
+}
+#endif
+
+/**
+ * 找出被反斜杠转义的字符。连续的反斜杠中，从奇数位开始的与从偶数位开始的，
+ * 被转义的字符的奇偶性相反，借助加法的进位一次区分出所有的序列 (同 simdjson)
+ *
+ * \param prev_escaped  输入时表示本块的第一个字符被上一块转义，输出时表示下一块的
+ */
+inline uint64_t FindEscaped(uint64_t backslash, uint64_t &prev_escaped)
+{
+    const uint64_t even_bits = 0x5555555555555555ull;
+
+    backslash &= ~prev_escaped;
+    uint64_t follows_escape = (backslash << 1) | prev_escaped;
+    uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+    uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+    prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts ? 1 : 0;
+    uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (even_bits ^ invert_mask) & follows_escape;
+}
+
+//! 第 i 位为前 i 位(含)的异或，即引号之间的范围
+inline uint64_t PrefixXor(uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+#endif
+
+}
+
+void EndPosFinder::reset()
+{
+    scanned_size_ = 0;
+    braces_level_ = 0;
+    square_level_ = 0;
+    is_started_ = false;
+    in_string_ = false;
+    is_escaped_ = false;
+}
+
+int EndPosFinder::find(const char *str_ptr, size_t str_len)
 {
     TBOX_ASSERT(str_ptr != nullptr);
 
-    bool is_started = false;//! 是否已开始，防止开头是空格或TAB
-    int braces_level = 0;   //! 花括号的层级
-    int square_level = 0;   //! 方括号的层级
-    bool in_string = false; //! 是否在字串中
+    if (str_len < scanned_size_)
+        reset();
+
+    while (scanned_size_ < str_len) {
+#if defined(__SSE2__)
+        //! 进入 [] {} 后，结束只可能出现在字串外的括号处，可以整块处理
+        if (braces_level_ + square_level_ > 0 && str_len - scanned_size_ >= kBlockSize) {
+            int ret = scanBlocks(str_ptr, str_len);
+            if (ret != 0)
+                return ret;
+            continue;
+        }
+#endif
+        char ch = str_ptr[scanned_size_++];
+        if (!is_started_ && ::isgraph(static_cast<unsigned char>(ch)))
+            is_started_ = true;
 
-    for (size_t i = 0; i < str_len; ++i) {
-        char ch = str_ptr[i];
-        if (!is_started && ::isgraph(ch))
-            is_started = true;
+        //! 连续的 \ 两两抵消，只有落单的 \ 才转义下一个字符
+        bool is_escaped = is_escaped_;
+        is_escaped_ = (ch == '\\') && !is_escaped;
 
         if (ch == '"') {
-            if (in_string) {
-                //! 要防止 \" 与 \\" \\\\\" 这些转义符的情况
-                //! 如果 " 前面是连续的 \ 那就对应数 \ 的个数。如果是单数，则"失效
-                in_string = false;
-                for (size_t j = (i - 1); j != 0 && str_ptr[j] == '\\'; --j)
-                    in_string = !in_string;
-            } else {
-                in_string = true;
-            }
-        } else {
-            if (in_string)  //! 如果在字串里，就直接略过
-                continue;
-
+            if (!is_escaped)
+                in_string_ = !in_string_;
+        } else if (!in_string_) {
             switch (ch) {
-                case '[': ++square_level; break;
-                case ']': --square_level; break;
-                case '{': ++braces_level; break;
-                case '}': --braces_level; break;
+                case '[': ++square_level_; break;
+                case ']': --square_level_; break;
+                case '{': ++braces_level_; break;
+                case '}': --braces_level_; break;
             }
         }
 
-        if (braces_level == 0 &&
-            square_level == 0 &&
-            !in_string &&
-            is_started) {
-            return i + 1;
-        }
+        if (braces_level_ == 0 && square_level_ == 0 && !in_string_ && is_started_)
+            return scanned_size_;
 
-        if (braces_level < 0 || square_level < 0)
+        if (braces_level_ < 0 || square_level_ < 0)
             return -1;
     }
 
     return 0;
 }
 
+#if defined(__SSE2__)
+int EndPosFinder::scanBlocks(const char *str_ptr, size_t str_len)
+{
+    uint64_t prev_in_string = in_string_ ? ~0ull : 0;
+    uint64_t prev_escaped = is_escaped_ ? 1 : 0;
+    int ret = 0;
+
+    while (str_len - scanned_size_ >= kBlockSize) {
+        BlockMasks masks;
+        Classify(str_ptr + scanned_size_, masks);
+
+        uint64_t escaped = FindEscaped(masks.backslash, prev_escaped);
+        uint64_t in_string = PrefixXor(masks.quote & ~escaped) ^ prev_in_string;
+        prev_in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+        uint64_t outside = ~in_string;
+        uint64_t open_brace = masks.open_brace & outside;
+        uint64_t close_brace = masks.close_brace & outside;
+        uint64_t open_square = masks.open_square & outside;
+        uint64_t close_square = masks.close_square & outside;
+
+        int close_brace_num = __builtin_popcountll(close_brace);
+        int close_square_num = __builtin_popcountll(close_square);
+
+        //! 就算所有的右括号都排在前面，层级也不会归零或为负，直接累加
+        if (braces_level_ >= close_brace_num && square_level_ >= close_square_num &&
+            braces_level_ + square_level_ > close_brace_num + close_square_num) {
+            braces_level_ += __builtin_popcountll(open_brace) - close_brace_num;
+            square_level_ += __builtin_popcountll(open_square) - close_square_num;
+            scanned_size_ += kBlockSize;
+            continue;
+        }
+
+        //! 否则按顺序逐个处理括号
+        uint64_t brackets = open_brace | close_brace | open_square | close_square;
+        while (brackets != 0) {
+            int pos = __builtin_ctzll(brackets);
+            uint64_t bit = brackets & (~brackets + 1);
+            brackets ^= bit;
+
+            if (open_brace & bit)
+                ++braces_level_;
+            else if (close_brace & bit)
+                --braces_level_;
+            else if (open_square & bit)
+                ++square_level_;
+            else
+                --square_level_;
+
+            if (braces_level_ == 0 && square_level_ == 0) {
+                scanned_size_ += pos + 1;
+                ret = scanned_size_;
+                break;
+            }
+
+            if (braces_level_ < 0 || square_level_ < 0) {
+                scanned_size_ += pos + 1;
+                ret = -1;
+                break;
+            }
+        }
+
+        if (ret != 0)
+            break;
+
+        scanned_size_ += kBlockSize;
+    }
+
+    in_string_ = prev_in_string != 0;
+    is_escaped_ = prev_escaped != 0;
+    return ret;
+}
+#endif
+
 }
 }
 }
@@ -20,7 +20,10 @@
 #ifndef TBOX_UTIL_JSON_H_20220908
 #define TBOX_UTIL_JSON_H_20220908
 
+#include <cstddef>
+#include <cstdint>
 #include <stdexcept>
+#include <string>
 #include <tbox/base/json_fwd.h>
 
 namespace tbox {
@@ -79,6 +82,8 @@ struct ParseJsonFileError : public std::runtime_error {
 
 /// 加载JSON文件
 /**
+ * 以 mmap 映射文件，再用 Parse() 解析，比 ifstream >> Json 快
+ *
  * \param filename  JSON文件名
  * \return Json     解析所得的Json对象
  *
@@ -87,6 +92,22 @@ struct ParseJsonFileError : public std::runtime_error {
  */
 Json Load(const std::string &filename);
 
+/// 加载JSON文件，同时检查文件原文中是否出现了指定的字串
+/**
+ * \param filename          JSON文件名
+ * \param keyword           要查找的字串
+ * \param is_keyword_found  返回原文中是否出现过 keyword
+ * \return Json             解析所得的Json对象
+ *
+ * \note   查找是在原文上做的，远比解析后再遍历Json树要快。
+ *         原文中含有 \\uXXXX 转义时也视为找到，即可能误报，但不会漏报。
+ *         调用方可据此跳过不必要的遍历，如 DeepLoader 对 "__include__" 的处理。
+ *
+ * \throw OpenFileError
+ *        ParseJsonFileError
+ */
+Json Load(const std::string &filename, const std::string &keyword, bool &is_keyword_found);
+
 /// 从字串中找到JSON的结束位置
 /**
  * \param str_ptr   JSON字串地址
@@ -100,6 +121,39 @@ Json Load(const std::string &filename);
  */
 int FindEndPos(const char *str_ptr, size_t str_len);
 
+/// 可续的JSON结束位置查找
+/**
+ * 与 FindEndPos() 的结果相同，但会记住已扫描的位置与括号、字串的状态。
+ * 数据分多次到达时，每次传入从JSON开头起的全部数据，只扫描新到达的部分，
+ * 而不是每次都从头扫描。
+ *
+ * 进入 [] {} 之后按64字节一块处理：一次比较出整块中引号、反斜杠与括号的位置，
+ * 由位运算算出转义与字串的范围，只逐个处理字串外的括号。有 SSE2 时启用，否则逐字节处理
+ *
+ * 找到结束位置或返回-1后，须 reset() 才能查找下一个JSON
+ */
+class EndPosFinder {
+  public:
+    /**
+     * \param str_ptr   JSON字串地址，开头须与上次调用时的是同一个JSON，地址可以不同
+     * \param str_len   JSON字串长度，比上次短时重新开始扫描
+     *
+     * \return 同 FindEndPos()
+     */
+    int find(const char *str_ptr, size_t str_len);
+    void reset();
+
+  private:
+    int scanBlocks(const char *str_ptr, size_t str_len);
+
+    size_t scanned_size_ = 0;
+    int braces_level_ = 0;
+    int square_level_ = 0;
+    bool is_started_ = false;
+    bool in_string_ = false;
+    bool is_escaped_ = false;   //!< 下一个字符被反斜杠转义
+};
+
 }
 }
 }
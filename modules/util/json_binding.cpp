@@ -0,0 +1,128 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "json_binding.h"
+
+#include <cstring>
+#include <unordered_set>
+
+#include <tbox/base/log.h>
+
+namespace tbox {
+namespace util {
+namespace json {
+namespace binding_impl {
+
+uint32_t KeyIndex::Hash(const char *str, size_t len, uint32_t seed)
+{
+    //! FNV-1a，以 seed 扰动初值
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= static_cast<uint8_t>(str[i]);
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+bool KeyIndex::build(const std::vector<std::string> &keys)
+{
+    //! 重复的键总会冲突，加倍槽数也无济于事
+    std::unordered_set<std::string> key_set;
+    for (auto &key : keys) {
+        if (!key_set.insert(key).second) {
+            LogErr("duplicate key: %s", key.c_str());
+            slots_.clear();
+            keys_.clear();
+            return false;
+        }
+    }
+
+    keys_ = keys;
+
+    //! 槽数取不小于键数2倍的2的幂，逐个尝试 seed 直到没有冲突，找不到就加倍槽数
+    uint32_t slot_number = 1;
+    while (slot_number < keys.size() * 2)
+        slot_number <<= 1;
+
+    for (;;) {
+        for (uint32_t seed = 0; seed < 1000; ++seed) {
+            std::vector<int> slots(slot_number, -1);
+            bool is_collided = false;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                auto &slot = slots[Hash(keys[i].data(), keys[i].size(), seed) & (slot_number - 1)];
+                if (slot >= 0) {
+                    is_collided = true;
+                    break;
+                }
+                slot = static_cast<int>(i);
+            }
+
+            if (!is_collided) {
+                seed_ = seed;
+                mask_ = slot_number - 1;
+                slots_.swap(slots);
+                return true;
+            }
+        }
+        slot_number <<= 1;
+    }
+}
+
+int KeyIndex::find(const std::string &key) const
+{
+    if (slots_.empty())
+        return -1;
+
+    int index = slots_[Hash(key.data(), key.size(), seed_) & mask_];
+    if (index < 0)
+        return -1;
+
+    //! 不在表中的键也可能落到某个槽上，要再比较一次
+    auto &slot_key = keys_[index];
+    if (slot_key.size() != key.size() || ::memcmp(slot_key.data(), key.data(), key.size()) != 0)
+        return -1;
+
+    return index;
+}
+
+std::string Path::toString() const
+{
+    std::string str = parent != nullptr ? parent->toString() : "";
+    if (key != nullptr) {
+        if (!str.empty())
+            str += '.';
+        str += key;
+    } else {
+        str += '[' + std::to_string(index) + ']';
+    }
+    return str;
+}
+
+void AddError(const Path *path, const char *what, std::vector<std::string> &errors)
+{
+    if (path != nullptr)
+        errors.push_back(path->toString() + ": " + what);
+    else
+        errors.push_back(what);
+}
+
+}
+}
+}
+}
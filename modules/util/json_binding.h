@@ -0,0 +1,403 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_UTIL_JSON_BINDING_H_20251019
+#define TBOX_UTIL_JSON_BINDING_H_20251019
+
+/**
+ * 声明式的结构体与JSON绑定，用于代替逐个字段的 GetField() 调用
+ *
+ * 结构体用静态函数 jsonSchema() 列出各字段的键名与成员指针，如：
+ *
+ *  struct ServerConfig {
+ *      std::string bind;
+ *      int backlog = 10;
+ *      std::vector<std::string> allow;
+ *
+ *      static void jsonSchema(util::json::Schema<ServerConfig> &s) {
+ *          s.field("bind", &ServerConfig::bind);           //! 必须有
+ *          s.optional("backlog", &ServerConfig::backlog);  //! 可以没有，没有时保持原值
+ *          s.optional("allow", &ServerConfig::allow);
+ *      }
+ *  };
+ *
+ *  ServerConfig cfg;
+ *  std::vector<std::string> errors;
+ *  if (!util::json::FromJson(js, cfg, errors))
+ *      ...     //! errors 中是所有的错误，如："allow[2]: expect string", "bind: missing"
+ *
+ *  Json js = util::json::ToJson(cfg);
+ *
+ * ToJson() 与 FromJson() 对称，可用于 Module::onFillDefaultConfig() 填写默认配置，
+ * 以及将结构体作为 jsonrpc 的 result 回复，如：rpc.respond(id, util::json::ToJson(result))
+ *
+ * 每个类型的 Schema 在首次使用时构建一次，其中为键名生成一个完美哈希表。
+ * 解析时只遍历一遍JSON对象，每个键经哈希直接定位到字段，不构造 std::string，
+ * 也不在JSON对象中逐个查找。出错时不中止，继续检查其余字段，一次报告全部错误。
+ *
+ * 字段可以是 bool、整数、浮点数、std::string、Json，它们的 std::vector 与
+ * std::map<std::string, T>，以及同样提供了 jsonSchema() 的结构体。
+ * 整数会检查取值范围。JSON中未在 Schema 中声明的键被忽略。
+ */
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <tbox/base/assert.h>
+#include <tbox/base/defines.h>
+#include <tbox/base/json.hpp>
+
+namespace tbox {
+namespace util {
+namespace json {
+
+template <typename T> class Schema;
+
+namespace binding_impl {
+
+//! 键名的完美哈希表，每个键落在不同的槽中
+class KeyIndex {
+  public:
+    //! 有重复的键时返回 false，此时表为空，find() 总是返回 -1
+    bool build(const std::vector<std::string> &keys);
+    //! 返回键的序号，不存在返回 -1
+    int find(const std::string &key) const;
+
+  private:
+    static uint32_t Hash(const char *str, size_t len, uint32_t seed);
+
+    uint32_t seed_ = 0;
+    uint32_t mask_ = 0;
+    std::vector<int> slots_;
+    std::vector<std::string> keys_;
+};
+
+//! 出错位置，只在出错时才拼成字串
+struct Path {
+    const Path *parent;
+    const char *key;    //!< 为 nullptr 时表示数组下标
+    size_t index;
+
+    std::string toString() const;
+};
+
+void AddError(const Path *path, const char *what, std::vector<std::string> &errors);
+
+template <typename T, typename = void>
+struct HasSchema : std::false_type { };
+
+template <typename T>
+struct HasSchema<T, decltype(T::jsonSchema(std::declval<Schema<T>&>()))> : std::true_type { };
+
+template <typename T, typename = void> struct Codec;
+
+template <>
+struct Codec<bool> {
+    static bool Decode(const Json &js, bool &value, const Path *path, std::vector<std::string> &errors) {
+        if (!js.is_boolean()) {
+            AddError(path, "expect boolean", errors);
+            return false;
+        }
+        value = js.get<bool>();
+        return true;
+    }
+    static void Encode(bool value, Json &js) { js = value; }
+};
+
+template <typename T>
+struct Codec<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static bool Decode(const Json &js, T &value, const Path *path, std::vector<std::string> &errors) {
+        if (js.is_number_unsigned()) {
+            auto tmp = js.get<uint64_t>();
+            if (tmp <= static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+                value = static_cast<T>(tmp);
+                return true;
+            }
+        } else if (js.is_number_integer()) {
+            //! 由 int 等有符号类型构造的正数也在这里
+            auto tmp = js.get<int64_t>();
+            bool is_in_range = tmp < 0 ?
+                (std::is_signed<T>::value && tmp >= static_cast<int64_t>(std::numeric_limits<T>::min())) :
+                (static_cast<uint64_t>(tmp) <= static_cast<uint64_t>(std::numeric_limits<T>::max()));
+            if (is_in_range) {
+                value = static_cast<T>(tmp);
+                return true;
+            }
+        } else {
+            AddError(path, "expect integer", errors);
+            return false;
+        }
+        AddError(path, "out of range", errors);
+        return false;
+    }
+    static void Encode(T value, Json &js) { js = value; }
+};
+
+template <typename T>
+struct Codec<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static bool Decode(const Json &js, T &value, const Path *path, std::vector<std::string> &errors) {
+        if (!js.is_number()) {
+            AddError(path, "expect number", errors);
+            return false;
+        }
+        value = js.get<T>();
+        return true;
+    }
+    static void Encode(T value, Json &js) { js = value; }
+};
+
+template <>
+struct Codec<std::string> {
+    static bool Decode(const Json &js, std::string &value, const Path *path, std::vector<std::string> &errors) {
+        if (!js.is_string()) {
+            AddError(path, "expect string", errors);
+            return false;
+        }
+        value = *js.get_ptr<const Json::string_t*>();
+        return true;
+    }
+    static void Encode(const std::string &value, Json &js) { js = value; }
+};
+
+template <>
+struct Codec<Json> {
+    static bool Decode(const Json &js, Json &value, const Path *, std::vector<std::string> &) {
+        value = js;
+        return true;
+    }
+    static void Encode(const Json &value, Json &js) { js = value; }
+};
+
+template <typename T>
+struct Codec<std::vector<T>> {
+    static bool Decode(const Json &js, std::vector<T> &value, const Path *path, std::vector<std::string> &errors) {
+        if (!js.is_array()) {
+            AddError(path, "expect array", errors);
+            return false;
+        }
+
+        bool is_ok = true;
+        value.resize(js.size());
+        for (size_t i = 0; i < value.size(); ++i) {
+            Path item_path = { path, nullptr, i };
+            T item;
+            if (Codec<T>::Decode(js[i], item, &item_path, errors))
+                value[i] = std::move(item);
+            else
+                is_ok = false;
+        }
+        return is_ok;
+    }
+    static void Encode(const std::vector<T> &value, Json &js) {
+        js = Json::array();
+        for (auto &item : value) {
+            js.emplace_back();
+            Codec<T>::Encode(item, js.back());
+        }
+    }
+};
+
+template <typename T>
+struct Codec<std::map<std::string, T>> {
+    static bool Decode(const Json &js, std::map<std::string, T> &value, const Path *path, std::vector<std::string> &errors) {
+        if (!js.is_object()) {
+            AddError(path, "expect object", errors);
+            return false;
+        }
+
+        bool is_ok = true;
+        value.clear();
+        for (auto &item : *js.get_ptr<const Json::object_t*>()) {
+            Path item_path = { path, item.first.c_str(), 0 };
+            if (!Codec<T>::Decode(item.second, value[item.first], &item_path, errors))
+                is_ok = false;
+        }
+        return is_ok;
+    }
+    static void Encode(const std::map<std::string, T> &value, Json &js) {
+        js = Json::object();
+        for (auto &item : value)
+            Codec<T>::Encode(item.second, js[item.first]);
+    }
+};
+
+template <typename T>
+struct Codec<T, typename std::enable_if<HasSchema<T>::value>::type> {
+    static bool Decode(const Json &js, T &value, const Path *path, std::vector<std::string> &errors) {
+        return Schema<T>::Get().decode(js, value, path, errors);
+    }
+    static void Encode(const T &value, Json &js) {
+        Schema<T>::Get().encode(value, js);
+    }
+};
+
+}
+
+/// 结构体的字段描述，由结构体的 jsonSchema() 填写
+template <typename T>
+class Schema {
+  public:
+    //! 声明一个必须有的字段
+    template <typename M>
+    Schema& field(const char *key, M T::*member) { return add(key, member, true); }
+    //! 声明一个可选的字段，JSON中没有时保持原值
+    template <typename M>
+    Schema& optional(const char *key, M T::*member) { return add(key, member, false); }
+
+    //! 取该类型的 Schema，首次调用时构建
+    static const Schema& Get() {
+        static const Schema schema;
+        return schema;
+    }
+
+    bool decode(const Json &js, T &obj, const binding_impl::Path *path, std::vector<std::string> &errors) const;
+    void encode(const T &obj, Json &js) const;
+
+  private:
+    Schema() {
+        T::jsonSchema(*this);
+        std::vector<std::string> keys;
+        for (auto &field : fields_)
+            keys.push_back(field->key);
+        bool is_built = index_.build(keys);
+        TBOX_ASSERT(is_built);  //! Schema 中有重复的键
+        UNUSED_VAR(is_built);
+    }
+
+    struct FieldBase {
+        FieldBase(const char *k, bool r) : key(k), is_required(r) { }
+        virtual ~FieldBase() { }
+        virtual bool decode(const Json &js, T &obj, const binding_impl::Path *path, std::vector<std::string> &errors) const = 0;
+        virtual void encode(const T &obj, Json &js) const = 0;
+
+        std::string key;
+        bool is_required;
+    };
+
+    template <typename M>
+    struct Field : public FieldBase {
+        Field(const char *k, bool r, M T::*m) : FieldBase(k, r), member(m) { }
+        virtual bool decode(const Json &js, T &obj, const binding_impl::Path *path, std::vector<std::string> &errors) const override {
+            return binding_impl::Codec<M>::Decode(js, obj.*member, path, errors);
+        }
+        virtual void encode(const T &obj, Json &js) const override {
+            binding_impl::Codec<M>::Encode(obj.*member, js);
+        }
+
+        M T::*member;
+    };
+
+    template <typename M>
+    Schema& add(const char *key, M T::*member, bool is_required) {
+        fields_.emplace_back(new Field<M>(key, is_required, member));
+        if (is_required)
+            ++required_number_;
+        return *this;
+    }
+
+    std::vector<std::unique_ptr<FieldBase>> fields_;
+    size_t required_number_ = 0;
+    binding_impl::KeyIndex index_;
+};
+
+template <typename T>
+bool Schema<T>::decode(const Json &js, T &obj, const binding_impl::Path *path, std::vector<std::string> &errors) const
+{
+    if (!js.is_object()) {
+        binding_impl::AddError(path, "expect object", errors);
+        return false;
+    }
+
+    bool is_ok = true;
+    size_t found_required_number = 0;
+    for (auto &item : *js.get_ptr<const Json::object_t*>()) {
+        int index = index_.find(item.first);
+        if (index < 0)
+            continue;
+
+        auto &field = fields_[index];
+        binding_impl::Path field_path = { path, field->key.c_str(), 0 };
+        if (!field->decode(item.second, obj, &field_path, errors))
+            is_ok = false;
+        if (field->is_required)
+            ++found_required_number;
+    }
+
+    //! JSON对象中的键不会重复，数目对得上就说明必须有的字段都在
+    if (found_required_number < required_number_) {
+        for (auto &field : fields_) {
+            if (field->is_required && js.find(field->key) == js.end()) {
+                binding_impl::Path field_path = { path, field->key.c_str(), 0 };
+                binding_impl::AddError(&field_path, "missing", errors);
+            }
+        }
+        is_ok = false;
+    }
+
+    return is_ok;
+}
+
+template <typename T>
+void Schema<T>::encode(const T &obj, Json &js) const
+{
+    js = Json::object();
+    for (auto &field : fields_)
+        field->encode(obj, js[field->key]);
+}
+
+/// 按 T::jsonSchema() 将JSON对象解析到结构体
+/**
+ * \param js        JSON对象
+ * \param obj       要填写的结构体，出错时已成功解析的字段仍会被修改
+ * \param errors    追加所有的错误描述，格式为 "<路径>: <原因>"
+ *
+ * \return true     全部成功
+ */
+template <typename T>
+bool FromJson(const Json &js, T &obj, std::vector<std::string> &errors)
+{
+    return binding_impl::Codec<T>::Decode(js, obj, nullptr, errors);
+}
+
+/// 按 T::jsonSchema() 将结构体转成JSON，与 FromJson() 对称
+template <typename T>
+void ToJson(const T &obj, Json &js)
+{
+    binding_impl::Codec<T>::Encode(obj, js);
+}
+
+template <typename T>
+Json ToJson(const T &obj)
+{
+    Json js;
+    ToJson(obj, js);
+    return js;
+}
+
+}
+}
+}
+
+#endif //TBOX_UTIL_JSON_BINDING_H_20251019
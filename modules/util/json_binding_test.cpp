@@ -0,0 +1,297 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <gtest/gtest.h>
+#include <tbox/base/json.hpp>
+#include "json_binding.h"
+#include "json.h"
+
+namespace tbox {
+namespace util {
+namespace json {
+
+namespace {
+
+struct Endpoint {
+    std::string host;
+    uint16_t port;
+
+    static void jsonSchema(Schema<Endpoint> &s) {
+        s.field("host", &Endpoint::host);
+        s.field("port", &Endpoint::port);
+    }
+
+    bool operator == (const Endpoint &other) const { return host == other.host && port == other.port; }
+};
+
+struct ServerConfig {
+    std::string name;
+    int backlog = 10;
+    double ratio = 0.5;
+    bool enable = true;
+    Endpoint listen;
+    std::vector<Endpoint> peers;
+    std::map<std::string, int> limits;
+    Json extra;
+
+    static void jsonSchema(Schema<ServerConfig> &s) {
+        s.field("name", &ServerConfig::name)
+         .optional("backlog", &ServerConfig::backlog)
+         .optional("ratio", &ServerConfig::ratio)
+         .optional("enable", &ServerConfig::enable)
+         .field("listen", &ServerConfig::listen)
+         .optional("peers", &ServerConfig::peers)
+         .optional("limits", &ServerConfig::limits)
+         .optional("extra", &ServerConfig::extra);
+    }
+};
+
+}
+
+TEST(JsonBinding, FromJson) {
+    Json js = R"({
+        "name": "srv",
+        "ratio": 2,
+        "listen": {"host": "0.0.0.0", "port": 8080},
+        "peers": [{"host": "a", "port": 1}, {"host": "b", "port": 2}],
+        "limits": {"conn": 100, "rate": -1},
+        "extra": {"any": [1, "x"]},
+        "unknown": "ignored"
+    })"_json;
+
+    ServerConfig cfg;
+    std::vector<std::string> errors;
+    ASSERT_TRUE(FromJson(js, cfg, errors));
+    EXPECT_TRUE(errors.empty());
+
+    EXPECT_EQ(cfg.name, "srv");
+    EXPECT_EQ(cfg.backlog, 10);     //! 没有的可选字段保持原值
+    EXPECT_DOUBLE_EQ(cfg.ratio, 2);
+    EXPECT_TRUE(cfg.enable);
+    EXPECT_EQ(cfg.listen, (Endpoint{"0.0.0.0", 8080}));
+    ASSERT_EQ(cfg.peers.size(), 2u);
+    EXPECT_EQ(cfg.peers[1], (Endpoint{"b", 2}));
+    EXPECT_EQ(cfg.limits, (std::map<std::string, int>{{"conn", 100}, {"rate", -1}}));
+    EXPECT_EQ(cfg.extra, js["extra"]);
+}
+
+TEST(JsonBinding, AggregatedErrors) {
+    Json js = R"({
+        "backlog": "ten",
+        "enable": 1,
+        "listen": {"host": 1, "port": 70000},
+        "peers": [{"host": "a", "port": 1}, {"port": -1}],
+        "limits": {"conn": 1.5}
+    })"_json;
+
+    ServerConfig cfg;
+    std::vector<std::string> errors;
+    EXPECT_FALSE(FromJson(js, cfg, errors));
+
+    std::vector<std::string> expect_errors = {
+        "backlog: expect integer",
+        "enable: expect boolean",
+        "limits.conn: expect integer",
+        "listen.host: expect string",
+        "listen.port: out of range",
+        "peers[1].host: missing",
+        "peers[1].port: out of range",
+        "name: missing",
+    };
+    std::sort(errors.begin(), errors.end());
+    std::sort(expect_errors.begin(), expect_errors.end());
+    EXPECT_EQ(errors, expect_errors);
+
+    errors.clear();
+    EXPECT_FALSE(FromJson(Json::array(), cfg, errors));
+    EXPECT_EQ(errors, std::vector<std::string>{"expect object"});
+}
+
+//! 由 int 构造的 Json 是有符号整数，正数也要能解到无符号字段，且检查上下限
+TEST(JsonBinding, IntegerRange) {
+    struct Numbers {
+        uint16_t port = 0;
+        int8_t small = 0;
+        uint8_t byte = 0;
+
+        static void jsonSchema(Schema<Numbers> &s) {
+            s.optional("port", &Numbers::port)
+             .optional("small", &Numbers::small)
+             .optional("byte", &Numbers::byte);
+        }
+    };
+
+    Json js;
+    js["port"] = 8080;
+    js["small"] = -128;
+    js["byte"] = 255;
+
+    Numbers nums;
+    std::vector<std::string> errors;
+    EXPECT_TRUE(FromJson(js, nums, errors));
+    EXPECT_TRUE(errors.empty());
+    EXPECT_EQ(nums.port, 8080);
+    EXPECT_EQ(nums.small, -128);
+    EXPECT_EQ(nums.byte, 255);
+
+    js["port"] = 65536;
+    js["small"] = 300;
+    js["byte"] = -1;
+    EXPECT_FALSE(FromJson(js, nums, errors));
+    std::sort(errors.begin(), errors.end());
+    EXPECT_EQ(errors, (std::vector<std::string>{"byte: out of range", "port: out of range", "small: out of range"}));
+
+    errors.clear();
+    js["small"] = 128u;
+    js.erase("port");
+    js.erase("byte");
+    EXPECT_FALSE(FromJson(js, nums, errors));
+    EXPECT_EQ(errors, std::vector<std::string>{"small: out of range"});
+}
+
+TEST(JsonBinding, DuplicateKeys) {
+    binding_impl::KeyIndex index;
+    EXPECT_FALSE(index.build({"a", "b", "a"}));
+    EXPECT_EQ(index.find("a"), -1);
+
+    EXPECT_TRUE(index.build({"a", "b"}));
+    EXPECT_EQ(index.find("b"), 1);
+
+    EXPECT_FALSE(index.build({"b", "b"}));
+    EXPECT_EQ(index.find("b"), -1);
+}
+
+TEST(JsonBinding, ToJsonSymmetric) {
+    ServerConfig cfg;
+    cfg.name = "srv";
+    cfg.listen = {"127.0.0.1", 1234};
+    cfg.peers = {{"a", 1}};
+    cfg.limits["conn"] = 5;
+    cfg.extra = {{"k", "v"}};
+
+    Json js = ToJson(cfg);
+    EXPECT_EQ(js["name"], "srv");
+    EXPECT_EQ(js["backlog"], 10);
+    EXPECT_EQ(js["listen"]["port"], 1234);
+    EXPECT_EQ(js["peers"][0]["host"], "a");
+
+    ServerConfig cfg_parsed;
+    std::vector<std::string> errors;
+    ASSERT_TRUE(FromJson(js, cfg_parsed, errors));
+    EXPECT_EQ(ToJson(cfg_parsed), js);
+}
+
+//! 键很多时完美哈希也能构建，且不在表中的键不会误中
+TEST(JsonBinding, ManyKeys) {
+    struct Item {
+        std::vector<int> values;
+        std::string f00, f01, f02, f03, f04, f05, f06, f07, f08, f09;
+        std::string f10, f11, f12, f13, f14, f15, f16, f17, f18, f19;
+
+        static void jsonSchema(Schema<Item> &s) {
+            s.optional("values", &Item::values)
+             .optional("f00", &Item::f00).optional("f01", &Item::f01).optional("f02", &Item::f02)
+             .optional("f03", &Item::f03).optional("f04", &Item::f04).optional("f05", &Item::f05)
+             .optional("f06", &Item::f06).optional("f07", &Item::f07).optional("f08", &Item::f08)
+             .optional("f09", &Item::f09).optional("f10", &Item::f10).optional("f11", &Item::f11)
+             .optional("f12", &Item::f12).optional("f13", &Item::f13).optional("f14", &Item::f14)
+             .optional("f15", &Item::f15).optional("f16", &Item::f16).optional("f17", &Item::f17)
+             .optional("f18", &Item::f18).field("f19", &Item::f19);
+        }
+    };
+
+    Json js;
+    for (int i = 0; i < 20; ++i) {
+        char key[8];
+        snprintf(key, sizeof(key), "f%02d", i);
+        js[key] = std::string(key) + "-value";
+        snprintf(key, sizeof(key), "g%02d", i);
+        js[key] = 0;
+    }
+    js["values"] = {1, 2, 3};
+
+    Item item;
+    std::vector<std::string> errors;
+    ASSERT_TRUE(FromJson(js, item, errors));
+    EXPECT_EQ(item.f00, "f00-value");
+    EXPECT_EQ(item.f13, "f13-value");
+    EXPECT_EQ(item.f19, "f19-value");
+    EXPECT_EQ(item.values, (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(ToJson(item).size(), 21u);
+}
+
+namespace {
+struct BenchConfig {
+    std::string name;
+    std::string bind;
+    int backlog = 0;
+    int timeout = 0;
+    int retry = 0;
+    double ratio = 0;
+    bool enable = false;
+    std::string path;
+
+    static void jsonSchema(Schema<BenchConfig> &s) {
+        s.field("name", &BenchConfig::name)
+         .field("bind", &BenchConfig::bind)
+         .field("backlog", &BenchConfig::backlog)
+         .field("timeout", &BenchConfig::timeout)
+         .field("retry", &BenchConfig::retry)
+         .field("ratio", &BenchConfig::ratio)
+         .field("enable", &BenchConfig::enable)
+         .field("path", &BenchConfig::path);
+    }
+};
+}
+
+//! 比较逐个 GetField() 与 FromJson() 的耗时
+TEST(JsonBinding, BenchmarkCompareGetField) {
+    Json js = R"({"name":"server-name","bind":"0.0.0.0:12345","backlog":10,"timeout":30,
+                  "retry":3,"ratio":0.75,"enable":true,"path":"/var/run/server.sock","other":1})"_json;
+    const int kTimes = 100000;
+
+    auto start_ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i) {
+        BenchConfig cfg;
+        bool is_ok = GetField(js, "name", cfg.name) && GetField(js, "bind", cfg.bind) &&
+                     GetField(js, "backlog", cfg.backlog) && GetField(js, "timeout", cfg.timeout) &&
+                     GetField(js, "retry", cfg.retry) && GetField(js, "ratio", cfg.ratio) &&
+                     GetField(js, "enable", cfg.enable) && GetField(js, "path", cfg.path);
+        ASSERT_TRUE(is_ok);
+    }
+    auto get_field_cost = std::chrono::steady_clock::now() - start_ts;
+
+    start_ts = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTimes; ++i) {
+        BenchConfig cfg;
+        std::vector<std::string> errors;
+        ASSERT_TRUE(FromJson(js, cfg, errors));
+    }
+    auto binding_cost = std::chrono::steady_clock::now() - start_ts;
+
+    std::cout << "GetField cost: " << std::chrono::duration_cast<std::chrono::microseconds>(get_field_cost).count() << " us" << std::endl;
+    std::cout << "FromJson cost: " << std::chrono::duration_cast<std::chrono::microseconds>(binding_cost).count() << " us" << std::endl;
+}
+
+}
+}
+}
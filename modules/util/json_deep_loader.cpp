@@ -18,7 +18,7 @@
  * of the source tree.
  */
 #include "json_deep_loader.h"
-#include <fstream>
+#include <algorithm>
 
 #include <tbox/base/json.hpp>
 #include "json.h"
@@ -38,8 +38,11 @@ Json DeepLoader::load(const std::string &filename) {
         throw DuplicateIncludeError(filename);
 
     files_.push_back(filename);
-    Json js = Load(filename);
-    traverse(js);
+    bool has_include = false;
+    Json js = Load(filename, kInclude, has_include);
+    //! 原文中都没有出现 "__include__" 的文件，就不必再遍历整棵树了
+    if (has_include)
+        traverse(js);
     files_.pop_back();
     return js;
 }
@@ -0,0 +1,481 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "json_parser.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <clocale>
+#include <cmath>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <tbox/base/json.hpp>
+
+namespace tbox {
+namespace util {
+namespace json {
+
+namespace {
+
+constexpr int kMaxDepth = 1024;
+
+inline bool IsDigit(char ch) { return ch >= '0' && ch <= '9'; }
+
+/**
+ * 找字串中第一个需要特殊处理的字符：引号、反斜杠、控制字符、非ASCII字符
+ * 找不到则返回 end
+ */
+inline const char* FindSpecial(const char *ptr, const char *end)
+{
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+    for (; end - ptr >= 16; ptr += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        //! 有符号比较，0x80~0xff 与 0x00~0x1f 都小于 0x20
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                                    _mm_cmpeq_epi8(block, backslash)),
+                                       _mm_cmplt_epi8(block, space));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0)
+            return ptr + __builtin_ctz(mask);
+    }
+#endif
+    for (; ptr != end; ++ptr) {
+        unsigned char ch = *ptr;
+        if (ch == '"' || ch == '\\' || ch < 0x20 || ch >= 0x80)
+            break;
+    }
+    return ptr;
+}
+
+class Parser {
+  public:
+    Parser(const char *str_ptr, size_t str_len) :
+        begin_(str_ptr), ptr_(str_ptr), end_(str_ptr + str_len),
+        decimal_point_(*std::localeconv()->decimal_point)
+    { }
+
+    void parse(Json &js) {
+        //! 与 Json::parse() 一样跳过UTF-8的BOM
+        if (end_ - ptr_ >= 3 && ::memcmp(ptr_, "\xEF\xBB\xBF", 3) == 0)
+            ptr_ += 3;
+
+        skipSpace();
+        parseValue(js, 0);
+        skipSpace();
+        if (ptr_ != end_)
+            fail("unexpected character after JSON value");
+    }
+
+  protected:
+    [[noreturn]] void fail(const char *what) const {
+        size_t line = 1, column = 1;
+        for (const char *p = begin_; p < ptr_; ++p) {
+            if (*p == '\n') {
+                ++line;
+                column = 1;
+            } else {
+                ++column;
+            }
+        }
+
+        std::string detail = "line " + std::to_string(line) + ", column " + std::to_string(column) + ": " + what;
+        throw ParseJsonError(ptr_ - begin_, detail);
+    }
+
+    void skipSpace() {
+        while (ptr_ != end_ && (*ptr_ == ' ' || *ptr_ == '\n' || *ptr_ == '\r' || *ptr_ == '\t'))
+            ++ptr_;
+    }
+
+    void parseValue(Json &js, int depth) {
+        if (ptr_ == end_)
+            fail("unexpected end of input");
+
+        switch (*ptr_) {
+            case '{':
+                parseObject(js, depth + 1);
+                break;
+            case '[':
+                parseArray(js, depth + 1);
+                break;
+            case '"':
+                js = Json::value_t::string;
+                parseString(*js.get_ptr<Json::string_t*>());
+                break;
+            case 't':
+                parseLiteral("true", 4);
+                js = true;
+                break;
+            case 'f':
+                parseLiteral("false", 5);
+                js = false;
+                break;
+            case 'n':
+                parseLiteral("null", 4);
+                js = nullptr;
+                break;
+            default:
+                if (*ptr_ == '-' || IsDigit(*ptr_))
+                    parseNumber(js);
+                else
+                    fail("unexpected character");
+        }
+    }
+
+    void parseObject(Json &js, int depth) {
+        if (depth > kMaxDepth)
+            fail("nesting too deep");
+
+        ++ptr_; //! 跳过 '{'
+        js = Json::value_t::object;
+        auto &obj = *js.get_ptr<Json::object_t*>();
+
+        skipSpace();
+        if (ptr_ != end_ && *ptr_ == '}') {
+            ++ptr_;
+            return;
+        }
+
+        std::string key;
+        for (;;) {
+            if (ptr_ == end_ || *ptr_ != '"')
+                fail("expect string as object key");
+
+            key.clear();
+            parseString(key);
+
+            skipSpace();
+            if (ptr_ == end_ || *ptr_ != ':')
+                fail("expect ':' after object key");
+            ++ptr_;
+            skipSpace();
+
+            //! 由 dump() 生成的文件中键是有序的，以 end() 为提示可免去查找
+            //! 重复的键会取到已有的结点，其值被后面的覆盖，与 Json::parse() 一致
+            auto iter = obj.emplace_hint(obj.end(), std::move(key), nullptr);
+            parseValue(iter->second, depth);
+
+            skipSpace();
+            if (ptr_ == end_)
+                fail("unexpected end of input in object");
+
+            if (*ptr_ == ',') {
+                ++ptr_;
+                skipSpace();
+            } else if (*ptr_ == '}') {
+                ++ptr_;
+                return;
+            } else {
+                fail("expect ',' or '}' in object");
+            }
+        }
+    }
+
+    void parseArray(Json &js, int depth) {
+        if (depth > kMaxDepth)
+            fail("nesting too deep");
+
+        ++ptr_; //! 跳过 '['
+        js = Json::value_t::array;
+        auto &arr = *js.get_ptr<Json::array_t*>();
+
+        skipSpace();
+        if (ptr_ != end_ && *ptr_ == ']') {
+            ++ptr_;
+            return;
+        }
+
+        for (;;) {
+            arr.emplace_back();
+            parseValue(arr.back(), depth);
+
+            skipSpace();
+            if (ptr_ == end_)
+                fail("unexpected end of input in array");
+
+            if (*ptr_ == ',') {
+                ++ptr_;
+                skipSpace();
+            } else if (*ptr_ == ']') {
+                ++ptr_;
+                return;
+            } else {
+                fail("expect ',' or ']' in array");
+            }
+        }
+    }
+
+    void parseString(std::string &str) {
+        ++ptr_; //! 跳过 '"'
+        const char *start = ptr_;
+        for (;;) {
+            ptr_ = FindSpecial(ptr_, end_);
+            if (ptr_ == end_)
+                fail("unterminated string");
+
+            unsigned char ch = *ptr_;
+            if (ch == '"') {
+                str.append(start, ptr_);
+                ++ptr_;
+                return;
+
+            } else if (ch == '\\') {
+                str.append(start, ptr_);
+                parseEscape(str);
+                start = ptr_;
+
+            } else if (ch < 0x20) {
+                fail("control character must be escaped in string");
+
+            } else {
+                skipUtf8();
+            }
+        }
+    }
+
+    void parseEscape(std::string &str) {
+        ++ptr_; //! 跳过 '\\'
+        if (ptr_ == end_)
+            fail("unterminated string");
+
+        char ch = *ptr_++;
+        switch (ch) {
+            case '"':   str.push_back('"');  break;
+            case '\\':  str.push_back('\\'); break;
+            case '/':   str.push_back('/');  break;
+            case 'b':   str.push_back('\b'); break;
+            case 'f':   str.push_back('\f'); break;
+            case 'n':   str.push_back('\n'); break;
+            case 'r':   str.push_back('\r'); break;
+            case 't':   str.push_back('\t'); break;
+            case 'u':   parseUnicode(str);   break;
+            default:
+                --ptr_;
+                fail("invalid escape in string");
+        }
+    }
+
+    uint32_t parseHex4() {
+        if (end_ - ptr_ < 4)
+            fail("unterminated \\u escape");
+
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i, ++ptr_) {
+            char ch = *ptr_;
+            value <<= 4;
+            if (IsDigit(ch))
+                value |= ch - '0';
+            else if (ch >= 'a' && ch <= 'f')
+                value |= ch - 'a' + 10;
+            else if (ch >= 'A' && ch <= 'F')
+                value |= ch - 'A' + 10;
+            else
+                fail("invalid hex digit in \\u escape");
+        }
+        return value;
+    }
+
+    void parseUnicode(std::string &str) {
+        uint32_t code = parseHex4();
+
+        if (code >= 0xD800 && code <= 0xDBFF) {
+            if (end_ - ptr_ < 2 || ptr_[0] != '\\' || ptr_[1] != 'u')
+                fail("high surrogate must be followed by low surrogate");
+            ptr_ += 2;
+            uint32_t low = parseHex4();
+            if (low < 0xDC00 || low > 0xDFFF)
+                fail("high surrogate must be followed by low surrogate");
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+
+        } else if (code >= 0xDC00 && code <= 0xDFFF) {
+            fail("low surrogate must follow high surrogate");
+        }
+
+        if (code < 0x80) {
+            str.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            str.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            str.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            str.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            str.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            str.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            str.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            str.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            str.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            str.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    //! 按 RFC 3629 检查一个UTF-8多字节字符，并跳过它
+    void skipUtf8() {
+        const unsigned char *p = reinterpret_cast<const unsigned char*>(ptr_);
+        size_t remain = end_ - ptr_;
+        unsigned char lead = p[0];
+
+        size_t len = 0;
+        unsigned char second_min = 0x80, second_max = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            len = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            len = 3;
+            if (lead == 0xE0)
+                second_min = 0xA0;
+            else if (lead == 0xED)
+                second_max = 0x9F;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            len = 4;
+            if (lead == 0xF0)
+                second_min = 0x90;
+            else if (lead == 0xF4)
+                second_max = 0x8F;
+        } else {
+            fail("invalid UTF-8 byte in string");
+        }
+
+        if (remain < len || p[1] < second_min || p[1] > second_max)
+            fail("invalid UTF-8 byte in string");
+        for (size_t i = 2; i < len; ++i) {
+            if (p[i] < 0x80 || p[i] > 0xBF)
+                fail("invalid UTF-8 byte in string");
+        }
+
+        ptr_ += len;
+    }
+
+    void parseLiteral(const char *literal, size_t len) {
+        if (static_cast<size_t>(end_ - ptr_) < len || ::memcmp(ptr_, literal, len) != 0)
+            fail("invalid literal");
+        ptr_ += len;
+    }
+
+    void parseNumber(Json &js) {
+        const char *start = ptr_;
+        bool is_negative = false;
+        if (*ptr_ == '-') {
+            is_negative = true;
+            ++ptr_;
+        }
+
+        if (ptr_ == end_ || !IsDigit(*ptr_))
+            fail("invalid number");
+
+        uint64_t value = 0;
+        bool is_overflow = false;
+        if (*ptr_ == '0') {
+            ++ptr_;
+        } else {
+            for (; ptr_ != end_ && IsDigit(*ptr_); ++ptr_) {
+                unsigned digit = *ptr_ - '0';
+                if (value > (UINT64_MAX - digit) / 10)
+                    is_overflow = true;
+                else
+                    value = value * 10 + digit;
+            }
+        }
+
+        bool is_float = false;
+        if (ptr_ != end_ && *ptr_ == '.') {
+            is_float = true;
+            ++ptr_;
+            if (ptr_ == end_ || !IsDigit(*ptr_))
+                fail("invalid number, expect digit after '.'");
+            while (ptr_ != end_ && IsDigit(*ptr_))
+                ++ptr_;
+        }
+
+        if (ptr_ != end_ && (*ptr_ == 'e' || *ptr_ == 'E')) {
+            is_float = true;
+            ++ptr_;
+            if (ptr_ != end_ && (*ptr_ == '+' || *ptr_ == '-'))
+                ++ptr_;
+            if (ptr_ == end_ || !IsDigit(*ptr_))
+                fail("invalid number, expect digit in exponent");
+            while (ptr_ != end_ && IsDigit(*ptr_))
+                ++ptr_;
+        }
+
+        //! 与 Json::parse() 一样：非负整数为 unsigned，负整数为 integer，超出范围的转为 float
+        if (!is_float && !is_overflow) {
+            if (!is_negative) {
+                js = value;
+                return;
+            }
+            if (value <= static_cast<uint64_t>(INT64_MAX) + 1) {
+                js = static_cast<int64_t>(0 - value);
+                return;
+            }
+        }
+
+        double float_value = toDouble(start, ptr_);
+        if (!std::isfinite(float_value)) {
+            ptr_ = start;
+            fail("number overflow");
+        }
+        js = float_value;
+    }
+
+    //! strtod() 要求以'\0'结尾，且小数点受 locale 影响
+    double toDouble(const char *start, const char *end) const {
+        char buff[64];
+        std::string long_buff;
+        size_t len = end - start;
+
+        char *str = buff;
+        if (len >= sizeof(buff)) {
+            long_buff.resize(len + 1);
+            str = &long_buff[0];
+        }
+
+        ::memcpy(str, start, len);
+        str[len] = '\0';
+        if (decimal_point_ != '.') {
+            char *dot = ::strchr(str, '.');
+            if (dot != nullptr)
+                *dot = decimal_point_;
+        }
+        return std::strtod(str, nullptr);
+    }
+
+  private:
+    const char *begin_;
+    const char *ptr_;
+    const char *end_;
+    char decimal_point_;
+};
+
+}
+
+Json Parse(const char *str_ptr, size_t str_len)
+{
+    Json js;
+    Parser(str_ptr, str_len).parse(js);
+    return js;
+}
+
+}
+}
+}
@@ -0,0 +1,65 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_UTIL_JSON_PARSER_H_20251019
+#define TBOX_UTIL_JSON_PARSER_H_20251019
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <tbox/base/json_fwd.h>
+
+namespace tbox {
+namespace util {
+namespace json {
+
+//! 解析JSON文本失败异常
+struct ParseJsonError : public std::runtime_error {
+    explicit ParseJsonError(size_t pos, const std::string &detail) :
+        std::runtime_error(detail), position(pos) { }
+
+    size_t position;    //!< 出错的位置，从0开始
+};
+
+/// 解析JSON文本
+/**
+ * 结果与 Json::parse() 的完全相同，包括整数与无符号整数的区分、重复键取最后一个、
+ * 溢出的整数转为小数、对UTF-8编码的检查等，只是更快：
+ * - 直接在原文上解析，不经过逐字符的输入适配器与记号缓冲；
+ * - 字串中没有转义时整段拷贝，用SSE2查找引号、反斜杠与非ASCII字符；
+ * - 直接构造到结点中，不经过SAX回调与中间栈。
+ *
+ * 适合用于加载大的配置文件。对小的报文没有明显差别。
+ *
+ * \param str_ptr   JSON文本地址，不要求以'\0'结尾
+ * \param str_len   JSON文本长度
+ *
+ * \return Json     解析所得的Json对象
+ *
+ * \throw ParseJsonError
+ *
+ * \note    嵌套深度超过1024层时视为出错，而 Json::parse() 不限制
+ */
+Json Parse(const char *str_ptr, size_t str_len);
+
+}
+}
+}
+
+#endif //TBOX_UTIL_JSON_PARSER_H_20251019
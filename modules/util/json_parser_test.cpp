@@ -0,0 +1,170 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <gtest/gtest.h>
+#include <tbox/base/json.hpp>
+#include "json_parser.h"
+
+namespace tbox {
+namespace util {
+namespace json {
+
+namespace {
+Json ParseString(const std::string &text) { return Parse(text.data(), text.size()); }
+}
+
+TEST(JsonParser, SameAsNlohmann) {
+    const char *texts[] = {
+        "null", "true", "false", " \t\r\n 0 \n",
+        "0", "-0", "123", "-123", "1.5", "-0.0", "1e3", "1E-3", "2.5e+10",
+        "18446744073709551615", "18446744073709551616", "-9223372036854775808", "-9223372036854775809",
+        "\"\"", "\"hello\"", R"("a\"b\\c\/d\b\f\n\r\t")", R"("Aé中😀")", R"("\u0000")",
+        "\"中文UTF-8\"", "\"\xF0\x9F\x98\x80\"",
+        "[]", "{}", "[1, [2, [3, []]], {}]",
+        R"({"b":1, "a":[true, null], "c":{"d":"e"}})",
+        R"({"a":1, "a":2})",
+        "\xEF\xBB\xBF{\"bom\":1}",
+    };
+
+    for (auto text : texts) {
+        Json js_expect = Json::parse(text);
+        Json js = ParseString(text);
+        EXPECT_EQ(js, js_expect) << text;
+        EXPECT_EQ(js.type(), js_expect.type()) << text;
+        EXPECT_EQ(js.dump(), js_expect.dump()) << text;
+    }
+}
+
+TEST(JsonParser, Invalid) {
+    const char *texts[] = {
+        "", " ", "nul", "True", "[1,]", "[1 2]", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "{a:1}", "{\"a\":1",
+        "[", "]", "01", "-", "1.", ".5", "1e", "1e+", "+1", "1e999", "NaN",
+        "\"abc", "\"a\tb\"", R"("\x")", R"("\u12")", R"("\uZZZZ")", R"("\ud83d")", R"("\ud83dx")", R"("\ude00")",
+        "\"\x80\"", "\"\xC0\xAF\"", "\"\xE0\x80\xAF\"", "\"\xED\xA0\x80\"", "\"\xF4\x90\x80\x80\"", "\"\xC3\"",
+        "1 2", "{} x", "[] []",
+    };
+
+    for (auto text : texts) {
+        EXPECT_ANY_THROW(Json::parse(text)) << text;
+        EXPECT_THROW(ParseString(text), ParseJsonError) << text;
+    }
+
+    EXPECT_THROW(ParseString(std::string(2000, '[') + std::string(2000, ']')), ParseJsonError);
+}
+
+TEST(JsonParser, ErrorPosition) {
+    try {
+        ParseString("{\n  \"a\": 1,\n  \"b\": tru\n}");
+        FAIL();
+    } catch (const ParseJsonError &e) {
+        EXPECT_EQ(e.position, 19u);
+        EXPECT_NE(std::string(e.what()).find("line 3, column 8"), std::string::npos) << e.what();
+    }
+}
+
+TEST(JsonParser, NotNulTerminated) {
+    const std::string text = "[12345, \"abc\"]";
+    EXPECT_EQ(Parse(text.data() + 1, 5), Json(12345));
+    EXPECT_THROW(Parse(text.data(), 4), ParseJsonError);
+    EXPECT_EQ(Parse(text.data() + 1, 3), Json(123));
+}
+
+namespace {
+Json RandomJson(std::mt19937 &rand, int depth)
+{
+    auto random_string = [&rand] {
+        static const char *pieces[] = { "a", "key", " ", "\"", "\\", "/", "\n", "\t", "\x01", "\x1f",
+                                        "中", "é", "\xF0\x9F\x98\x80", "0123456789abcdefghij" };
+        std::string str;
+        for (int n = rand() % 8; n > 0; --n)
+            str += pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+        return str;
+    };
+
+    switch (rand() % (depth < 4 ? 9 : 7)) {
+        case 0: return nullptr;
+        case 1: return (rand() % 2) == 0;
+        case 2: return static_cast<uint64_t>(rand()) << (rand() % 40);
+        case 3: return -static_cast<int64_t>(rand());
+        case 4: return std::ldexp(static_cast<double>(rand()) - (1u << 30), static_cast<int>(rand() % 60) - 30);
+        case 5:
+        case 6: return random_string();
+        case 7: {
+            Json js = Json::array();
+            for (int n = rand() % 6; n > 0; --n)
+                js.push_back(RandomJson(rand, depth + 1));
+            return js;
+        }
+        default: {
+            Json js = Json::object();
+            for (int n = rand() % 6; n > 0; --n)
+                js[random_string()] = RandomJson(rand, depth + 1);
+            return js;
+        }
+    }
+}
+}
+
+TEST(JsonParser, RandomSameAsNlohmann) {
+    std::mt19937 rand(2025);
+    for (int i = 0; i < 500; ++i) {
+        Json js = RandomJson(rand, 0);
+        for (auto text : { js.dump(), js.dump(2), js.dump(-1, ' ', true) }) {
+            Json js_parsed = ParseString(text);
+            EXPECT_EQ(js_parsed, js);
+            EXPECT_EQ(js_parsed.dump(), Json::parse(text).dump());
+        }
+    }
+}
+
+//! 约4MB的配置，比较 Json::parse() 与 Parse() 的耗时
+TEST(JsonParser, BenchmarkCompareNlohmann) {
+    Json js_config;
+    for (int m = 0; m < 64; ++m) {
+        Json &js_module = js_config["module_" + std::to_string(m)];
+        js_module["enable"] = (m % 2 == 0);
+        for (int i = 0; i < 400; ++i) {
+            js_module["items"].push_back({
+                {"id", i}, {"name", "item-" + std::to_string(i)},
+                {"ratio", i * 0.25}, {"tags", {"a", "b", "c"}}, {"valid", true}
+            });
+        }
+    }
+    const std::string text = js_config.dump(2);
+
+    auto start_ts = std::chrono::steady_clock::now();
+    Json js_nlohmann = Json::parse(text);
+    auto nlohmann_cost = std::chrono::steady_clock::now() - start_ts;
+
+    start_ts = std::chrono::steady_clock::now();
+    Json js_tbox = ParseString(text);
+    auto tbox_cost = std::chrono::steady_clock::now() - start_ts;
+
+    EXPECT_EQ(js_tbox, js_nlohmann);
+
+    std::cout << "nlohmann cost: " << std::chrono::duration_cast<std::chrono::microseconds>(nlohmann_cost).count() << " us" << std::endl;
+    std::cout << "tbox cost: " << std::chrono::duration_cast<std::chrono::microseconds>(tbox_cost).count() << " us" << std::endl;
+}
+
+}
+}
+}
@@ -17,9 +17,17 @@
  * project authors may be found in the CONTRIBUTORS.md file in the root
  * of the source tree.
  */
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
 #include <gtest/gtest.h>
 #include <tbox/base/json.hpp>
 #include "json.h"
+#include "json_deep_loader.h"
+#include "fs.h"
 
 namespace tbox {
 namespace util {
@@ -188,6 +196,220 @@ TEST(Json, FindEndPos) {
     EXPECT_EQ(FindEndPos(R"([})", 2), -1);
 }
 
+namespace {
+//! 逐字节的参考实现，用于核对分块扫描的结果
+int RefFindEndPos(const char *str_ptr, size_t str_len)
+{
+    int braces_level = 0, square_level = 0;
+    bool is_started = false, in_string = false, is_escaped = false;
+
+    for (size_t i = 0; i < str_len; ++i) {
+        char ch = str_ptr[i];
+        if (!is_started && ::isgraph(static_cast<unsigned char>(ch)))
+            is_started = true;
+
+        bool curr_escaped = is_escaped;
+        is_escaped = (ch == '\\') && !curr_escaped;
+
+        if (ch == '"') {
+            if (!curr_escaped)
+                in_string = !in_string;
+        } else if (!in_string) {
+            if (ch == '[') ++square_level;
+            else if (ch == ']') --square_level;
+            else if (ch == '{') ++braces_level;
+            else if (ch == '}') --braces_level;
+        }
+
+        if (braces_level == 0 && square_level == 0 && !in_string && is_started)
+            return i + 1;
+        if (braces_level < 0 || square_level < 0)
+            return -1;
+    }
+    return 0;
+}
+
+//! 开头几层括号，让扫描尽快进入分块处理
+std::string MakeRandomJsonText(std::mt19937 &rand, size_t size)
+{
+    const char chars[] = "{}[]\"\"\\\\\\abcdefgh:,";
+    std::string text(1 + rand() % 8, '[');
+    while (text.size() < size)
+        text.push_back(chars[rand() % (sizeof(chars) - 1)]);
+    return text;
+}
+}
+
+TEST(Json, EndPosFinder) {
+    const char *str = R"([1,{"a":"\"ab\\"},{"b":"]}"}])";
+    size_t len = ::strlen(str);
+
+    EndPosFinder finder;
+    for (size_t i = 1; i < len; ++i)
+        EXPECT_EQ(finder.find(str, i), 0) << i;
+    EXPECT_EQ(finder.find(str, len), len);
+
+    finder.reset();
+    EXPECT_EQ(finder.find(R"({])", 2), -1);
+}
+
+//! 长字串中的转义与括号跨越64字节的块边界
+TEST(Json, EndPosFinderCrossBlock) {
+    for (size_t pad = 0; pad < 70; ++pad) {
+        std::string text = R"({"a":")" + std::string(pad, 'x') + R"(\\\"]}\\\\" , "b":[)";
+        text += std::string(130, ' ') + R"("\"" ]})";
+        EXPECT_EQ(FindEndPos(text.data(), text.size()), text.size()) << pad;
+        EXPECT_EQ(FindEndPos(text.data(), text.size() - 1), 0) << pad;
+    }
+}
+
+TEST(Json, EndPosFinderRandomSegments) {
+    std::mt19937 rand(1234);
+    int long_count = 0;
+    for (int round = 0; round < 2000; ++round) {
+        auto text = MakeRandomJsonText(rand, 1 + rand() % 600);
+        int expect = RefFindEndPos(text.data(), text.size());
+        EXPECT_EQ(FindEndPos(text.data(), text.size()), expect) << text;
+
+        EndPosFinder finder;
+        size_t size = 0;
+        int ret = 0;
+        while (ret == 0 && size < text.size()) {
+            size = std::min(text.size(), size + 1 + rand() % 100);
+            ret = finder.find(text.data(), size);
+        }
+        EXPECT_EQ(ret, expect) << text;
+        if (expect == 0 || expect > 64)
+            ++long_count;
+    }
+    EXPECT_GT(long_count, 300);
+}
+
+//! 1MB 的JSON分成64KB到达，比较每次从头扫描与续扫的耗时
+TEST(Json, BenchmarkEndPosFinder) {
+    Json js_item = {{"name", "hevake \"lee\""}, {"path", "C:\\tbox\\[util]"}, {"values", {1, 2.5, true, nullptr}}};
+    Json js_array = Json::array();
+    for (size_t size = 0; size < (1 << 20); size += js_item.dump().size())
+        js_array.push_back(js_item);
+    const std::string text = js_array.dump();
+    const size_t kSegmentSize = 64 << 10;
+
+    auto start_ts = std::chrono::steady_clock::now();
+    int ret = 0;
+    for (size_t size = kSegmentSize; ret == 0; size += kSegmentSize)
+        ret = RefFindEndPos(text.data(), std::min(size, text.size()));
+    auto rescan_cost = std::chrono::steady_clock::now() - start_ts;
+    EXPECT_EQ(ret, text.size());
+
+    start_ts = std::chrono::steady_clock::now();
+    EndPosFinder finder;
+    ret = 0;
+    for (size_t size = kSegmentSize; ret == 0; size += kSegmentSize)
+        ret = finder.find(text.data(), std::min(size, text.size()));
+    auto resume_cost = std::chrono::steady_clock::now() - start_ts;
+    EXPECT_EQ(ret, text.size());
+
+    std::cout << "rescan cost: " << std::chrono::duration_cast<std::chrono::microseconds>(rescan_cost).count() << " us" << std::endl;
+    std::cout << "resume cost: " << std::chrono::duration_cast<std::chrono::microseconds>(resume_cost).count() << " us" << std::endl;
+}
+
+TEST(Json, Load) {
+    const char *filename = "/tmp/tbox-json-load-test.json";
+    Json js_src = {{"name", "hevake"}, {"values", {1, 2.5, true, nullptr}}};
+    ASSERT_TRUE(fs::WriteStringToTextFile(filename, js_src.dump(2)));
+
+    EXPECT_EQ(Load(filename), js_src);
+
+    bool is_found = false;
+    EXPECT_EQ(Load(filename, "values", is_found), js_src);
+    EXPECT_TRUE(is_found);
+    EXPECT_EQ(Load(filename, "__include__", is_found), js_src);
+    EXPECT_FALSE(is_found);
+
+    //! \uXXXX 转义可能在解析后拼出关键字，要当作找到
+    ASSERT_TRUE(fs::WriteStringToTextFile(filename, R"({"\u005f_include__":1})"));
+    EXPECT_EQ(Load(filename, "__include__", is_found), Json({{"__include__", 1}}));
+    EXPECT_TRUE(is_found);
+
+    ASSERT_TRUE(fs::WriteStringToTextFile(filename, ""));
+    EXPECT_THROW(Load(filename), ParseJsonFileError);
+    ASSERT_TRUE(fs::WriteStringToTextFile(filename, "{\"a\":"));
+    EXPECT_THROW(Load(filename), ParseJsonFileError);
+
+    fs::RemoveFile(filename);
+    EXPECT_THROW(Load(filename), OpenFileError);
+}
+
+TEST(Json, LoadDeeply) {
+    const std::string dir = "/tmp/tbox-json-deep-load-test";
+    fs::MakeDirectory(dir + "/sub");
+    ASSERT_TRUE(fs::WriteStringToTextFile(dir + "/main.json", R"({"main.a":1, "__include__":["sub/sub1.json => sub1", "common.json"]})"));
+    ASSERT_TRUE(fs::WriteStringToTextFile(dir + "/common.json", R"({"common.a":2})"));
+    ASSERT_TRUE(fs::WriteStringToTextFile(dir + "/sub/sub1.json", R"({"sub1.a":1, "__include__":"sub2.json => sub2"})"));
+    ASSERT_TRUE(fs::WriteStringToTextFile(dir + "/sub/sub2.json", R"([1, 2, 3, {"__include__":"../sub3.json"}])"));
+    ASSERT_TRUE(fs::WriteStringToTextFile(dir + "/sub3.json", R"({"sub3.a":4})"));
+
+    Json js_expect = {
+        {"common.a", 2},
+        {"main.a", 1},
+        {"sub1", {{"sub1.a", 1}, {"sub2", {1, 2, 3, {{"sub3.a", 4}}}}}}
+    };
+    EXPECT_EQ(LoadDeeply(dir + "/main.json"), js_expect);
+
+    ASSERT_TRUE(fs::WriteStringToTextFile(dir + "/sub3.json", R"({"__include__":"sub3.json"})"));
+    EXPECT_THROW(LoadDeeply(dir + "/main.json"), DuplicateIncludeError);
+
+    fs::RemoveDirectory(dir);
+}
+
+namespace {
+//! 原来的加载方式：经 ifstream 解析，再遍历整棵树处理 "__include__"
+class IfstreamDeepLoader : public DeepLoader {
+  public:
+    Json loadByIfstream(const std::string &filename) {
+        Json js;
+        std::ifstream ifs(filename);
+        ifs >> js;
+        traverse(js);
+        return js;
+    }
+};
+}
+
+//! 生成几MB的配置文件，比较原来的加载方式与 LoadDeeply() 的耗时
+TEST(Json, BenchmarkLoadDeeply) {
+    const char *filename = "/tmp/tbox-json-load-bench.json";
+    Json js_config;
+    for (int m = 0; m < 64; ++m) {
+        Json &js_module = js_config["module_" + std::to_string(m)];
+        js_module["enable"] = (m % 2 == 0);
+        for (int i = 0; i < 400; ++i) {
+            js_module["items"].push_back({
+                {"id", i}, {"name", "item-" + std::to_string(i)},
+                {"ratio", i * 0.25}, {"tags", {"a", "b", "c"}}, {"valid", true}
+            });
+        }
+    }
+    const std::string text = js_config.dump(2);
+    ASSERT_TRUE(fs::WriteStringToTextFile(filename, text));
+
+    auto start_ts = std::chrono::steady_clock::now();
+    Json js_old = IfstreamDeepLoader().loadByIfstream(filename);
+    auto old_cost = std::chrono::steady_clock::now() - start_ts;
+
+    start_ts = std::chrono::steady_clock::now();
+    Json js_new = LoadDeeply(filename);
+    auto new_cost = std::chrono::steady_clock::now() - start_ts;
+
+    EXPECT_EQ(js_old, js_config);
+    EXPECT_EQ(js_new, js_config);
+    fs::RemoveFile(filename);
+
+    std::cout << "file size: " << text.size() << " bytes" << std::endl;
+    std::cout << "ifstream cost: " << std::chrono::duration_cast<std::chrono::microseconds>(old_cost).count() << " us" << std::endl;
+    std::cout << "mmap cost: " << std::chrono::duration_cast<std::chrono::microseconds>(new_cost).count() << " us" << std::endl;
+}
+
 }
 }
 }
@@ -0,0 +1,319 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "json_writer.h"
+
+#include <cmath>
+#include <cstring>
+#include <tbox/base/json.hpp>
+#include <tbox/base/assert.h>
+
+namespace tbox {
+namespace util {
+namespace json {
+
+namespace {
+
+//! 需要转义的字符：控制字符、'"'、'\\'
+inline bool IsNeedEscape(unsigned char ch) { return ch < 0x20 || ch == '"' || ch == '\\'; }
+
+//! 写出无符号整数的十进制，返回长度
+size_t FormatUnsigned(uint64_t v, char *buff)
+{
+    char tmp[20];
+    size_t len = 0;
+    do {
+        tmp[len++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+
+    for (size_t i = 0; i < len; ++i)
+        buff[i] = tmp[len - 1 - i];
+    return len;
+}
+
+}
+
+Writer::Writer(std::string &out) :
+    out_(out)
+{ }
+
+Writer::Writer(Sink &&sink, size_t flush_size) :
+    out_(buffer_),
+    sink_(std::move(sink)),
+    flush_size_(flush_size)
+{
+    buffer_.reserve(flush_size_ + 64);
+}
+
+Writer::~Writer()
+{
+    flush();
+}
+
+void Writer::flush()
+{
+    if (sink_ && !buffer_.empty()) {
+        sink_(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+}
+
+void Writer::checkFlush()
+{
+    if (sink_ && buffer_.size() >= flush_size_)
+        flush();
+}
+
+void Writer::beforeValue()
+{
+    if (is_after_key_) {
+        is_after_key_ = false;
+        return;
+    }
+
+    if (levels_.empty()) {
+        TBOX_ASSERT(!has_value_);
+        has_value_ = true;
+        return;
+    }
+
+    auto &level = levels_.back();
+    TBOX_ASSERT(!level.is_object);  //! 对象中的值前面须先有键
+    if (level.has_item)
+        out_.push_back(',');
+    level.has_item = true;
+}
+
+Writer& Writer::beginObject()
+{
+    beforeValue();
+    out_.push_back('{');
+    levels_.push_back(Level{true, false});
+    return *this;
+}
+
+Writer& Writer::endObject()
+{
+    TBOX_ASSERT(!levels_.empty() && levels_.back().is_object && !is_after_key_);
+    levels_.pop_back();
+    out_.push_back('}');
+    checkFlush();
+    return *this;
+}
+
+Writer& Writer::beginArray()
+{
+    beforeValue();
+    out_.push_back('[');
+    levels_.push_back(Level{false, false});
+    return *this;
+}
+
+Writer& Writer::endArray()
+{
+    TBOX_ASSERT(!levels_.empty() && !levels_.back().is_object);
+    levels_.pop_back();
+    out_.push_back(']');
+    checkFlush();
+    return *this;
+}
+
+Writer& Writer::key(const char *name)
+{
+    TBOX_ASSERT(!levels_.empty() && levels_.back().is_object && !is_after_key_);
+    auto &level = levels_.back();
+    if (level.has_item)
+        out_.push_back(',');
+    level.has_item = true;
+
+    writeString(name, ::strlen(name));
+    out_.push_back(':');
+    is_after_key_ = true;
+    return *this;
+}
+
+Writer& Writer::key(const std::string &name)
+{
+    TBOX_ASSERT(!levels_.empty() && levels_.back().is_object && !is_after_key_);
+    auto &level = levels_.back();
+    if (level.has_item)
+        out_.push_back(',');
+    level.has_item = true;
+
+    writeString(name.data(), name.size());
+    out_.push_back(':');
+    is_after_key_ = true;
+    return *this;
+}
+
+Writer& Writer::value(std::nullptr_t)
+{
+    beforeValue();
+    out_.append("null", 4);
+    return *this;
+}
+
+Writer& Writer::value(bool v)
+{
+    beforeValue();
+    if (v)
+        out_.append("true", 4);
+    else
+        out_.append("false", 5);
+    return *this;
+}
+
+Writer& Writer::value(double v)
+{
+    beforeValue();
+    //! 与 Json::dump() 一样，非有限值写为 null
+    if (!std::isfinite(v)) {
+        out_.append("null", 4);
+    } else {
+        char buff[64];
+        char *end = nlohmann::detail::to_chars(buff, buff + sizeof(buff), v);
+        out_.append(buff, end - buff);
+    }
+    checkFlush();
+    return *this;
+}
+
+Writer& Writer::value(const char *str)
+{
+    beforeValue();
+    writeString(str, ::strlen(str));
+    checkFlush();
+    return *this;
+}
+
+Writer& Writer::value(const std::string &str)
+{
+    beforeValue();
+    writeString(str.data(), str.size());
+    checkFlush();
+    return *this;
+}
+
+Writer& Writer::value(const Json &js)
+{
+    switch (js.type()) {
+        case Json::value_t::null:
+            return value(nullptr);
+        case Json::value_t::boolean:
+            return value(js.get<bool>());
+        case Json::value_t::number_integer:
+            return writeInteger(js.get<int64_t>());
+        case Json::value_t::number_unsigned:
+            return writeUnsigned(js.get<uint64_t>());
+        case Json::value_t::number_float:
+            return value(js.get<double>());
+        case Json::value_t::string:
+            return value(*js.get_ptr<const Json::string_t*>());
+
+        case Json::value_t::array:
+            beginArray();
+            for (auto &js_item : *js.get_ptr<const Json::array_t*>())
+                value(js_item);
+            return endArray();
+
+        case Json::value_t::object:
+            beginObject();
+            for (auto &item : *js.get_ptr<const Json::object_t*>()) {
+                key(item.first);
+                value(item.second);
+            }
+            return endObject();
+
+        default: {
+            //! binary 等不常见的类型交给 dump()
+            auto text = js.dump();
+            return raw(text.data(), text.size());
+        }
+    }
+}
+
+Writer& Writer::raw(const char *json_text, size_t json_size)
+{
+    beforeValue();
+    out_.append(json_text, json_size);
+    checkFlush();
+    return *this;
+}
+
+Writer& Writer::writeInteger(int64_t v)
+{
+    if (v >= 0)
+        return writeUnsigned(static_cast<uint64_t>(v));
+
+    beforeValue();
+    char buff[24];
+    buff[0] = '-';
+    size_t len = FormatUnsigned(0 - static_cast<uint64_t>(v), buff + 1) + 1;
+    out_.append(buff, len);
+    checkFlush();
+    return *this;
+}
+
+Writer& Writer::writeUnsigned(uint64_t v)
+{
+    beforeValue();
+    char buff[24];
+    size_t len = FormatUnsigned(v, buff);
+    out_.append(buff, len);
+    checkFlush();
+    return *this;
+}
+
+void Writer::writeString(const char *str, size_t len)
+{
+    static const char kHex[] = "0123456789abcdef";
+
+    out_.push_back('"');
+    const char *end = str + len;
+    const char *start = str;
+    for (const char *p = str; p != end; ++p) {
+        unsigned char ch = *p;
+        if (!IsNeedEscape(ch))
+            continue;
+
+        out_.append(start, p);
+        start = p + 1;
+
+        switch (ch) {
+            case '"':   out_.append("\\\"", 2); break;
+            case '\\':  out_.append("\\\\", 2); break;
+            case '\b':  out_.append("\\b", 2);  break;
+            case '\f':  out_.append("\\f", 2);  break;
+            case '\n':  out_.append("\\n", 2);  break;
+            case '\r':  out_.append("\\r", 2);  break;
+            case '\t':  out_.append("\\t", 2);  break;
+            default: {
+                char buff[6] = { '\\', 'u', '0', '0', kHex[ch >> 4], kHex[ch & 0xF] };
+                out_.append(buff, sizeof(buff));
+            }
+        }
+    }
+    out_.append(start, end);
+    out_.push_back('"');
+}
+
+}
+}
+}
@@ -0,0 +1,142 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_UTIL_JSON_WRITER_H_20251019
+#define TBOX_UTIL_JSON_WRITER_H_20251019
+
+/**
+ * 流式的JSON生成器
+ *
+ * 按 SAX 的方式逐个写出对象、数组、键与值，直接生成JSON文本，不构建 Json 对象。
+ * 生成大的JSON时，省去了为每个结点分配内存，也不会同时持有 Json 对象与 dump() 的字串。
+ *
+ *  std::string text;
+ *  util::json::Writer writer(text);
+ *  writer.beginObject()
+ *          .field("name", "tbox")
+ *          .key("list").beginArray();
+ *  for (auto &item : items)
+ *      writer.value(item);
+ *  writer.endArray()
+ *        .endObject();
+ *
+ * 也可以指定 Sink，每攒够 flush_size 字节就交给它，用于写到 network::Buffer 或直接发送：
+ *
+ *  util::json::Writer writer([&buffer] (const char *data_ptr, size_t data_size) {
+ *      buffer.append(data_ptr, data_size);
+ *  });
+ *
+ * 生成的文本与 Json::dump() 的相同：没有空白，字串中只转义 '"'、'\\' 与控制字符，
+ * 小数格式一致，NaN 与 Inf 写为 null。
+ *
+ * \note 字串不检查UTF-8编码是否合法，原样写出
+ */
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <tbox/base/json_fwd.h>
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace util {
+namespace json {
+
+class Writer {
+  public:
+    using Sink = std::function<void(const char *data_ptr, size_t data_size)>;
+
+    //! 追加到 out 的末尾
+    explicit Writer(std::string &out);
+    //! 每攒够 flush_size 字节就交给 sink，析构或 flush() 时交出剩余的
+    explicit Writer(Sink &&sink, size_t flush_size = 4096);
+    ~Writer();
+
+    NONCOPYABLE(Writer);
+    IMMOVABLE(Writer);
+
+  public:
+    Writer& beginObject();
+    Writer& endObject();
+    Writer& beginArray();
+    Writer& endArray();
+
+    //! 写对象的键，其后须紧跟一个值
+    Writer& key(const char *name);
+    Writer& key(const std::string &name);
+
+    Writer& value(std::nullptr_t);
+    Writer& value(bool v);
+    Writer& value(double v);
+    Writer& value(const char *str);
+    Writer& value(const std::string &str);
+    //! 将已有的 Json 对象写出，不调用 dump()
+    Writer& value(const Json &js);
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, Writer&>::type
+    value(T v) {
+        if (std::is_signed<T>::value && v < 0)
+            return writeInteger(static_cast<int64_t>(v));
+        return writeUnsigned(static_cast<uint64_t>(v));
+    }
+
+    //! 写已经序列化好的JSON文本，原样写出
+    Writer& raw(const char *json_text, size_t json_size);
+
+    //! 写一个键值对
+    template <typename T>
+    Writer& field(const char *name, const T &v) { key(name); return value(v); }
+
+    //! 把缓存中的数据交给 sink，只在指定了 sink 时有用
+    void flush();
+
+    //! 是否已写完一个完整的JSON值
+    bool isComplete() const { return levels_.empty() && has_value_; }
+
+  private:
+    void beforeValue();
+    void writeString(const char *str, size_t len);
+    Writer& writeInteger(int64_t v);
+    Writer& writeUnsigned(uint64_t v);
+    void checkFlush();
+
+    std::string buffer_;        //!< 指定了 sink 时使用的缓存
+    std::string &out_;
+    Sink sink_;
+    size_t flush_size_ = 0;
+
+    //! 每层是否已写过元素，用于决定要不要加 ','
+    struct Level {
+        bool is_object;
+        bool has_item;
+    };
+    std::vector<Level> levels_;
+    bool is_after_key_ = false;
+    bool has_value_ = false;
+};
+
+}
+}
+}
+
+#endif //TBOX_UTIL_JSON_WRITER_H_20251019
@@ -0,0 +1,186 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <gtest/gtest.h>
+#include <tbox/base/json.hpp>
+#include "json_writer.h"
+
+namespace tbox {
+namespace util {
+namespace json {
+
+TEST(JsonWriter, Basic) {
+    std::string text;
+    {
+        Writer writer(text);
+        writer.beginObject()
+                .field("name", "tbox")
+                .field("int", -12)
+                .field("uint", 34u)
+                .field("float", 1.5)
+                .field("bool", true)
+                .key("null").value(nullptr)
+                .key("empty_array").beginArray().endArray()
+                .key("empty_object").beginObject().endObject()
+                .key("list").beginArray();
+        for (int i = 0; i < 3; ++i)
+            writer.value(i);
+        writer.endArray()
+                .key("raw").raw(R"({"a":[1,2]})", 11)
+                .key("json").value(Json{{"x", {1, "y"}}})
+              .endObject();
+        EXPECT_TRUE(writer.isComplete());
+    }
+
+    Json js_expect = {
+        {"name", "tbox"}, {"int", -12}, {"uint", 34u}, {"float", 1.5}, {"bool", true}, {"null", nullptr},
+        {"empty_array", Json::array()}, {"empty_object", Json::object()}, {"list", {0, 1, 2}},
+        {"raw", {{"a", {1, 2}}}}, {"json", {{"x", {1, "y"}}}}
+    };
+    EXPECT_EQ(Json::parse(text), js_expect);
+    EXPECT_EQ(text, R"({"name":"tbox","int":-12,"uint":34,"float":1.5,"bool":true,"null":null,)"
+                    R"("empty_array":[],"empty_object":{},"list":[0,1,2],"raw":{"a":[1,2]},"json":{"x":[1,"y"]}})");
+}
+
+TEST(JsonWriter, SameAsDump) {
+    std::vector<Json> cases = {
+        nullptr, true, false, 0, -1, 123456789012345ll, std::numeric_limits<int64_t>::min(),
+        std::numeric_limits<uint64_t>::max(), 0.0, -0.0, 1.0, 0.1, -2.5e-10, 1e300, 123456.789,
+        std::nan(""), std::numeric_limits<double>::infinity(),
+        "", "hello", "\"quote\" \\back\\ /slash/", "\b\f\n\r\t\x01\x1f\x7f", "中文 é 😀",
+        Json::array(), Json::object(), Json{1, "a", {2, nullptr}}, Json{{"b", 1}, {"a", {{"c", Json::array()}}}},
+    };
+
+    for (auto &js : cases) {
+        std::string text;
+        Writer(text).value(js);
+        EXPECT_EQ(text, js.dump());
+    }
+}
+
+TEST(JsonWriter, RandomSameAsDump) {
+    std::mt19937 rand(2025);
+    std::function<Json(int)> random_json = [&] (int depth) -> Json {
+        static const char *pieces[] = { "a", "key", " ", "\"", "\\", "/", "\n", "\x01", "中", "😀" };
+        auto random_string = [&] {
+            std::string str;
+            for (int n = rand() % 6; n > 0; --n)
+                str += pieces[rand() % 10];
+            return str;
+        };
+
+        switch (rand() % (depth < 4 ? 8 : 6)) {
+            case 0: return nullptr;
+            case 1: return (rand() % 2) == 0;
+            case 2: return static_cast<int64_t>(rand()) - (1 << 30);
+            case 3: return std::ldexp(static_cast<double>(rand()), static_cast<int>(rand() % 80) - 40);
+            case 4:
+            case 5: return random_string();
+            case 6: {
+                Json js = Json::array();
+                for (int n = rand() % 5; n > 0; --n)
+                    js.push_back(random_json(depth + 1));
+                return js;
+            }
+            default: {
+                Json js = Json::object();
+                for (int n = rand() % 5; n > 0; --n)
+                    js[random_string()] = random_json(depth + 1);
+                return js;
+            }
+        }
+    };
+
+    for (int i = 0; i < 500; ++i) {
+        Json js = random_json(0);
+        std::string text;
+        Writer(text).value(js);
+        EXPECT_EQ(text, js.dump());
+    }
+}
+
+TEST(JsonWriter, Sink) {
+    std::string text;
+    int flush_count = 0;
+    {
+        Writer writer(
+            [&] (const char *data_ptr, size_t data_size) {
+                text.append(data_ptr, data_size);
+                ++flush_count;
+            }, 16
+        );
+
+        writer.beginArray();
+        for (int i = 0; i < 100; ++i)
+            writer.value("item-" + std::to_string(i));
+        writer.endArray();
+        EXPECT_GT(flush_count, 10);
+    }
+
+    Json js = Json::parse(text);
+    ASSERT_EQ(js.size(), 100u);
+    EXPECT_EQ(js[99], "item-99");
+}
+
+//! 生成一个有2万条记录的回复，比较先构建 Json 再 dump() 与直接用 Writer 生成的耗时
+TEST(JsonWriter, BenchmarkCompareDump) {
+    const int kNum = 20000;
+
+    auto start_ts = std::chrono::steady_clock::now();
+    std::string dump_text;
+    {
+        Json js = Json::array();
+        for (int i = 0; i < kNum; ++i)
+            js.push_back({{"id", i}, {"name", "item-" + std::to_string(i)}, {"ratio", i * 0.25}, {"valid", true}});
+        dump_text = js.dump();
+    }
+    auto dump_cost = std::chrono::steady_clock::now() - start_ts;
+
+    start_ts = std::chrono::steady_clock::now();
+    std::string writer_text;
+    {
+        Writer writer(writer_text);
+        writer.beginArray();
+        for (int i = 0; i < kNum; ++i) {
+            writer.beginObject()
+                    .field("id", i)
+                    .field("name", "item-" + std::to_string(i))
+                    .field("ratio", i * 0.25)
+                    .field("valid", true)
+                  .endObject();
+        }
+        writer.endArray();
+    }
+    auto writer_cost = std::chrono::steady_clock::now() - start_ts;
+
+    //! Json 的键是有序的，文本不同，但内容相同
+    EXPECT_EQ(Json::parse(writer_text), Json::parse(dump_text));
+
+    std::cout << "dump cost: " << std::chrono::duration_cast<std::chrono::microseconds>(dump_cost).count() << " us" << std::endl;
+    std::cout << "writer cost: " << std::chrono::duration_cast<std::chrono::microseconds>(writer_cost).count() << " us" << std::endl;
+}
+
+}
+}
+}
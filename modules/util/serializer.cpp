@@ -75,14 +75,9 @@ bool Serializer::append(uint16_t in)
     if (!extendSize(2))
         return false;
 
-    uint8_t *p = start_ + pos_;
-    if (endian_ == Endian::kBig) {
-        p[1] = in & 0xff;
-        in >>= 8; p[0] = in & 0xff;
-    } else {
-        p[0] = in & 0xff;
-        in >>= 8; p[1] = in & 0xff;
-    }
+    if (endian_ != kHostEndian)
+        in = ByteSwap(in);
+    memcpy(start_ + pos_, &in, 2);
 
     pos_ += 2;
     return true;
@@ -93,18 +88,9 @@ bool Serializer::append(uint32_t in)
     if (!extendSize(4))
         return false;
 
-    uint8_t *p = start_ + pos_;
-    if (endian_ == Endian::kBig) {
-        p[3] = in & 0xff;
-        in >>= 8; p[2] = in & 0xff;
-        in >>= 8; p[1] = in & 0xff;
-        in >>= 8; p[0] = in & 0xff;
-    } else {
-        p[0] = in & 0xff;
-        in >>= 8; p[1] = in & 0xff;
-        in >>= 8; p[2] = in & 0xff;
-        in >>= 8; p[3] = in & 0xff;
-    }
+    if (endian_ != kHostEndian)
+        in = ByteSwap(in);
+    memcpy(start_ + pos_, &in, 4);
 
     pos_ += 4;
     return true;
@@ -115,26 +101,9 @@ bool Serializer::append(uint64_t in)
     if (!extendSize(8))
         return false;
 
-    uint8_t *p = start_ + pos_;
-    if (endian_ == Endian::kBig) {
-        p[7] = in & 0xff;
-        in >>= 8; p[6] = in & 0xff;
-        in >>= 8; p[5] = in & 0xff;
-        in >>= 8; p[4] = in & 0xff;
-        in >>= 8; p[3] = in & 0xff;
-        in >>= 8; p[2] = in & 0xff;
-        in >>= 8; p[1] = in & 0xff;
-        in >>= 8; p[0] = in & 0xff;
-    } else {
-        p[0] = in & 0xff;
-        in >>= 8; p[1] = in & 0xff;
-        in >>= 8; p[2] = in & 0xff;
-        in >>= 8; p[3] = in & 0xff;
-        in >>= 8; p[4] = in & 0xff;
-        in >>= 8; p[5] = in & 0xff;
-        in >>= 8; p[6] = in & 0xff;
-        in >>= 8; p[7] = in & 0xff;
-    }
+    if (endian_ != kHostEndian)
+        in = ByteSwap(in);
+    memcpy(start_ + pos_, &in, 8);
 
     pos_ += 8;
     return true;
@@ -152,6 +121,16 @@ bool Serializer::append(const void *p_in, size_t size)
     return true;
 }
 
+void* Serializer::appendNoCopy(size_t size)
+{
+    if (!extendSize(size))
+        return nullptr;
+
+    uint8_t *p = start_ + pos_;
+    pos_ += size;
+    return p;
+}
+
 bool Serializer::appendPOD(const void *p, size_t size)
 {
     if (!extendSize(size))
@@ -222,14 +201,9 @@ bool Deserializer::fetch(uint16_t &out)
     if (!checkSize(2))
         return false;
 
-    const uint8_t *p = start_ + pos_;
-    if (endian_ == Endian::kBig) {
-        out = p[0];
-        out <<= 8; out |= p[1];
-    } else {
-        out = p[1];
-        out <<= 8; out |= p[0];
-    }
+    memcpy(&out, start_ + pos_, 2);
+    if (endian_ != kHostEndian)
+        out = ByteSwap(out);
 
     pos_ += 2;
     return true;
@@ -240,18 +214,9 @@ bool Deserializer::fetch(uint32_t &out)
     if (!checkSize(4))
         return false;
 
-    const uint8_t *p = start_ + pos_;
-    if (endian_ == Endian::kBig) {
-        out = p[0];
-        out <<= 8; out |= p[1];
-        out <<= 8; out |= p[2];
-        out <<= 8; out |= p[3];
-    } else {
-        out = p[3];
-        out <<= 8; out |= p[2];
-        out <<= 8; out |= p[1];
-        out <<= 8; out |= p[0];
-    }
+    memcpy(&out, start_ + pos_, 4);
+    if (endian_ != kHostEndian)
+        out = ByteSwap(out);
 
     pos_ += 4;
     return true;
@@ -262,26 +227,9 @@ bool Deserializer::fetch(uint64_t &out)
     if (!checkSize(8))
         return false;
 
-    const uint8_t *p = start_ + pos_;
-    if (endian_ == Endian::kBig) {
-        out = p[0];
-        out <<= 8; out |= p[1];
-        out <<= 8; out |= p[2];
-        out <<= 8; out |= p[3];
-        out <<= 8; out |= p[4];
-        out <<= 8; out |= p[5];
-        out <<= 8; out |= p[6];
-        out <<= 8; out |= p[7];
-    } else {
-        out = p[7];
-        out <<= 8; out |= p[6];
-        out <<= 8; out |= p[5];
-        out <<= 8; out |= p[4];
-        out <<= 8; out |= p[3];
-        out <<= 8; out |= p[2];
-        out <<= 8; out |= p[1];
-        out <<= 8; out |= p[0];
-    }
+    memcpy(&out, start_ + pos_, 8);
+    if (endian_ != kHostEndian)
+        out = ByteSwap(out);
 
     pos_ += 8;
     return true;
@@ -29,12 +29,26 @@ namespace util {
 
 enum class Endian { kBig, kLittle };
 
+//! 本机的字节序
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr Endian kHostEndian = Endian::kBig;
+#else
+constexpr Endian kHostEndian = Endian::kLittle;
+#endif
+
+//! 字节交换，编译成单条指令
+inline uint8_t  ByteSwap(uint8_t in)  { return in; }
+inline uint16_t ByteSwap(uint16_t in) { return __builtin_bswap16(in); }
+inline uint32_t ByteSwap(uint32_t in) { return __builtin_bswap32(in); }
+inline uint64_t ByteSwap(uint64_t in) { return __builtin_bswap64(in); }
+
 class Serializer {
   public:
     Serializer(void *start, size_t size, Endian endian = Endian::kBig);     //! 固定大小的缓冲区
     Serializer(std::vector<uint8_t> &block, Endian endian = Endian::kBig);  //! 可变大小的vector<uint8_t>缓冲区
 
     Endian setEndian(Endian e);
+    inline Endian endian() const { return endian_; }
 
     inline size_t pos() const { return pos_; }
 
@@ -44,6 +58,8 @@ class Serializer {
     bool append(uint64_t in);
     bool append(const void *p, size_t s);
     bool appendPOD(const void *p, size_t s);
+    //! 预留 s 字节并返回其地址，由调用者直接写入，空间不够返回 nullptr
+    void* appendNoCopy(size_t s);
 
   protected:
     bool extendSize(size_t size);
@@ -64,6 +80,7 @@ class Deserializer {
     Deserializer(const void *start, size_t size, Endian endian = Endian::kBig);
 
     Endian setEndian(Endian e);
+    inline Endian endian() const { return endian_; }
 
     inline size_t pos() const { return pos_; }
     bool set_pos(size_t pos);
@@ -0,0 +1,315 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_UTIL_STRUCT_SERIALIZER_H_20251019
+#define TBOX_UTIL_STRUCT_SERIALIZER_H_20251019
+
+/**
+ * 按结构体的描述，整体地序列化与反序列化
+ *
+ * 结构体用模板成员函数 schema() 按顺序列出要序列化的字段，如：
+ *
+ *  struct Head {
+ *      uint16_t magic;
+ *      uint32_t length;
+ *      uint8_t  mac[6];
+ *
+ *      template <typename Archive>
+ *      void schema(Archive &ar) { ar(magic, length, mac); }
+ *  };
+ *
+ *  Head head = { 0xCAFE, 10, { 0 } };
+ *  uint8_t buff[12];
+ *  SerializeStruct(head, buff, sizeof(buff));      //! 默认为大端
+ *  DeserializeStruct(head, buff, sizeof(buff));
+ *
+ * 字段可以是整数、枚举、bool、float、double，它们的定长数组（T[N] 或 std::array），
+ * 以及同样提供了 schema() 的结构体。序列化后的大小是固定的，先算出总大小，
+ * 只检查或扩容一次，再逐个字段直接写入；字节序在编译期确定，需要交换时用字节交换指令，
+ * 不需要时数组整块拷贝
+ *
+ * \note schema() 对序列化与反序列化是同一个函数，序列化时不能修改字段
+ */
+
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "serializer.h"
+
+namespace tbox {
+namespace util {
+
+namespace impl {
+
+template <size_t N> struct UIntOfSize;
+template <> struct UIntOfSize<1> { using Type = uint8_t; };
+template <> struct UIntOfSize<2> { using Type = uint16_t; };
+template <> struct UIntOfSize<4> { using Type = uint32_t; };
+template <> struct UIntOfSize<8> { using Type = uint64_t; };
+
+template <typename T>
+struct IsScalar : std::integral_constant<bool, std::is_arithmetic<T>::value || std::is_enum<T>::value> { };
+
+//! 可以整块拷贝的数组元素：标量，且不需要交换字节序
+template <Endian E, typename T>
+struct IsBulkCopyable : std::integral_constant<bool, IsScalar<T>::value && (E == kHostEndian || sizeof(T) == 1)> { };
+
+template <Endian E, typename T>
+inline void StoreScalar(uint8_t *p, const T &in)
+{
+    typename UIntOfSize<sizeof(T)>::Type value;
+    memcpy(&value, &in, sizeof(T));
+    if (E != kHostEndian)
+        value = ByteSwap(value);
+    memcpy(p, &value, sizeof(T));
+}
+
+template <Endian E, typename T>
+inline void LoadScalar(const uint8_t *p, T &out)
+{
+    typename UIntOfSize<sizeof(T)>::Type value;
+    memcpy(&value, p, sizeof(T));
+    if (E != kHostEndian)
+        value = ByteSwap(value);
+    memcpy(&out, &value, sizeof(T));
+}
+
+//! 计算序列化后的大小
+class SizeArchive {
+  public:
+    template <typename ... Fields>
+    void operator () (Fields& ... fields) {
+        int expand[] = { 0, (add(fields), 0)... };
+        (void)expand;
+    }
+
+    size_t size() const { return size_; }
+
+  private:
+    template <typename T>
+    typename std::enable_if<IsScalar<T>::value>::type add(T &) { size_ += sizeof(T); }
+
+    template <typename T>
+    typename std::enable_if<!IsScalar<T>::value>::type add(T &obj) { obj.schema(*this); }
+
+    template <typename T, size_t N>
+    void add(T (&arr)[N]) { addArray(arr, N); }
+
+    template <typename T, size_t N>
+    void add(std::array<T, N> &arr) { addArray(arr.data(), N); }
+
+    template <typename T>
+    typename std::enable_if<IsScalar<T>::value>::type addArray(T *, size_t n) { size_ += sizeof(T) * n; }
+
+    template <typename T>
+    typename std::enable_if<!IsScalar<T>::value>::type addArray(T *arr, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            add(arr[i]);
+    }
+
+    size_t size_ = 0;
+};
+
+//! 写入，调用者须保证空间足够
+template <Endian E>
+class WriteArchive {
+  public:
+    explicit WriteArchive(uint8_t *p) : p_(p) { }
+
+    template <typename ... Fields>
+    void operator () (Fields& ... fields) {
+        int expand[] = { 0, (add(fields), 0)... };
+        (void)expand;
+    }
+
+  private:
+    template <typename T>
+    typename std::enable_if<IsScalar<T>::value>::type add(T &in) {
+        StoreScalar<E>(p_, in);
+        p_ += sizeof(T);
+    }
+
+    template <typename T>
+    typename std::enable_if<!IsScalar<T>::value>::type add(T &obj) { obj.schema(*this); }
+
+    template <typename T, size_t N>
+    void add(T (&arr)[N]) { addArray(arr, N); }
+
+    template <typename T, size_t N>
+    void add(std::array<T, N> &arr) { addArray(arr.data(), N); }
+
+    template <typename T>
+    typename std::enable_if<IsBulkCopyable<E, T>::value>::type addArray(T *arr, size_t n) {
+        memcpy(p_, arr, sizeof(T) * n);
+        p_ += sizeof(T) * n;
+    }
+
+    template <typename T>
+    typename std::enable_if<!IsBulkCopyable<E, T>::value>::type addArray(T *arr, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            add(arr[i]);
+    }
+
+    uint8_t *p_;
+};
+
+//! 读出，调用者须保证数据足够
+template <Endian E>
+class ReadArchive {
+  public:
+    explicit ReadArchive(const uint8_t *p) : p_(p) { }
+
+    template <typename ... Fields>
+    void operator () (Fields& ... fields) {
+        int expand[] = { 0, (add(fields), 0)... };
+        (void)expand;
+    }
+
+  private:
+    template <typename T>
+    typename std::enable_if<IsScalar<T>::value>::type add(T &out) {
+        LoadScalar<E>(p_, out);
+        p_ += sizeof(T);
+    }
+
+    template <typename T>
+    typename std::enable_if<!IsScalar<T>::value>::type add(T &obj) { obj.schema(*this); }
+
+    template <typename T, size_t N>
+    void add(T (&arr)[N]) { addArray(arr, N); }
+
+    template <typename T, size_t N>
+    void add(std::array<T, N> &arr) { addArray(arr.data(), N); }
+
+    template <typename T>
+    typename std::enable_if<IsBulkCopyable<E, T>::value>::type addArray(T *arr, size_t n) {
+        memcpy(arr, p_, sizeof(T) * n);
+        p_ += sizeof(T) * n;
+    }
+
+    template <typename T>
+    typename std::enable_if<!IsBulkCopyable<E, T>::value>::type addArray(T *arr, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            add(arr[i]);
+    }
+
+    const uint8_t *p_;
+};
+
+}
+
+//! 序列化后的字节数，同一类型总是相同的
+template <typename T>
+inline size_t StructSize(const T &obj)
+{
+    impl::SizeArchive ar;
+    const_cast<T&>(obj).schema(ar);
+    return ar.size();
+}
+
+template <typename T>
+inline size_t StructSize()
+{
+    return StructSize(T());
+}
+
+/**
+ * 序列化到缓冲中
+ *
+ * \return  写入的字节数，空间不够时返回0
+ */
+template <Endian E = Endian::kBig, typename T>
+inline size_t SerializeStruct(const T &obj, void *buff_ptr, size_t buff_size)
+{
+    size_t size = StructSize(obj);
+    if (size > buff_size)
+        return 0;
+
+    impl::WriteArchive<E> ar(static_cast<uint8_t*>(buff_ptr));
+    const_cast<T&>(obj).schema(ar);
+    return size;
+}
+
+//! 序列化并追加到 buff 的末尾，只扩容一次
+template <Endian E = Endian::kBig, typename T>
+inline void SerializeStruct(const T &obj, std::vector<uint8_t> &buff)
+{
+    size_t size = StructSize(obj);
+    size_t old_size = buff.size();
+    buff.resize(old_size + size);
+
+    impl::WriteArchive<E> ar(buff.data() + old_size);
+    const_cast<T&>(obj).schema(ar);
+}
+
+/**
+ * 从数据中反序列化
+ *
+ * \return  读出的字节数，数据不够时返回0，obj 不变
+ */
+template <Endian E = Endian::kBig, typename T>
+inline size_t DeserializeStruct(T &obj, const void *data_ptr, size_t data_size)
+{
+    size_t size = StructSize(obj);
+    if (size > data_size)
+        return 0;
+
+    impl::ReadArchive<E> ar(static_cast<const uint8_t*>(data_ptr));
+    obj.schema(ar);
+    return size;
+}
+
+//! 与 Serializer 配合使用，按其当前的字节序写入
+template <typename T>
+inline bool AppendStruct(Serializer &s, const T &obj)
+{
+    size_t size = StructSize(obj);
+    void *p = s.appendNoCopy(size);
+    if (p == nullptr)
+        return false;
+
+    if (s.endian() == Endian::kBig)
+        SerializeStruct<Endian::kBig>(obj, p, size);
+    else
+        SerializeStruct<Endian::kLittle>(obj, p, size);
+    return true;
+}
+
+//! 与 Deserializer 配合使用，按其当前的字节序读出
+template <typename T>
+inline bool FetchStruct(Deserializer &d, T &obj)
+{
+    size_t size = StructSize(obj);
+    const void *p = d.fetchNoCopy(size);
+    if (p == nullptr)
+        return false;
+
+    if (d.endian() == Endian::kBig)
+        DeserializeStruct<Endian::kBig>(obj, p, size);
+    else
+        DeserializeStruct<Endian::kLittle>(obj, p, size);
+    return true;
+}
+
+}
+}
+
+#endif //TBOX_UTIL_STRUCT_SERIALIZER_H_20251019
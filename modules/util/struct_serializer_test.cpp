@@ -0,0 +1,235 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2023 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+
+#include "struct_serializer.h"
+
+using namespace tbox::util;
+
+namespace {
+
+enum class Color : uint16_t { kRed = 1, kGreen = 0x0203 };
+
+struct Point {
+    int16_t x;
+    int16_t y;
+
+    template <typename Archive>
+    void schema(Archive &ar) { ar(x, y); }
+};
+
+struct Packet {
+    uint8_t  type;
+    uint16_t seq;
+    uint32_t length;
+    uint64_t timestamp;
+    Color    color;
+    float    ratio;
+    uint8_t  mac[6];
+    std::array<uint16_t, 3> values;
+    Point    points[2];
+
+    template <typename Archive>
+    void schema(Archive &ar) { ar(type, seq, length, timestamp, color, ratio, mac, values, points); }
+};
+
+Packet MakePacket()
+{
+    Packet p;
+    p.type = 0x01;
+    p.seq = 0x0203;
+    p.length = 0x04050607;
+    p.timestamp = 0x1112131415161718ull;
+    p.color = Color::kGreen;
+    p.ratio = 1.5f;
+    uint8_t mac[6] = { 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6 };
+    memcpy(p.mac, mac, sizeof(mac));
+    p.values = {{ 0x2122, 0x2324, 0x2526 }};
+    p.points[0] = { 0x3132, -2 };
+    p.points[1] = { 0x3334, 0x3536 };
+    return p;
+}
+
+//! 用 Serializer 逐个字段写，作为参照
+void SerializeByField(Serializer &s, const Packet &p)
+{
+    s << p.type << p.seq << p.length << p.timestamp << static_cast<uint16_t>(p.color) << p.ratio;
+    s.append(p.mac, sizeof(p.mac));
+    for (auto v : p.values)
+        s << v;
+    for (auto &pt : p.points)
+        s << pt.x << pt.y;
+}
+
+bool operator == (const Packet &a, const Packet &b)
+{
+    return a.type == b.type && a.seq == b.seq && a.length == b.length
+        && a.timestamp == b.timestamp && a.color == b.color && a.ratio == b.ratio
+        && memcmp(a.mac, b.mac, sizeof(a.mac)) == 0 && a.values == b.values
+        && a.points[0].x == b.points[0].x && a.points[0].y == b.points[0].y
+        && a.points[1].x == b.points[1].x && a.points[1].y == b.points[1].y;
+}
+
+}
+
+TEST(StructSerializer, Size)
+{
+    EXPECT_EQ(StructSize<Point>(), 4u);
+    EXPECT_EQ(StructSize<Packet>(), 1u + 2 + 4 + 8 + 2 + 4 + 6 + 6 + 8);
+}
+
+TEST(StructSerializer, SameAsSerializer)
+{
+    Packet p = MakePacket();
+
+    for (auto endian : { Endian::kBig, Endian::kLittle }) {
+        std::vector<uint8_t> expect;
+        Serializer s(expect, endian);
+        SerializeByField(s, p);
+
+        uint8_t buff[64];
+        size_t size = (endian == Endian::kBig) ?
+                      SerializeStruct<Endian::kBig>(p, buff, sizeof(buff)) :
+                      SerializeStruct<Endian::kLittle>(p, buff, sizeof(buff));
+        ASSERT_EQ(size, expect.size());
+        EXPECT_EQ(memcmp(buff, expect.data(), size), 0);
+
+        Packet out;
+        memset(&out, 0, sizeof(out));
+        if (endian == Endian::kBig)
+            EXPECT_EQ(DeserializeStruct<Endian::kBig>(out, buff, size), size);
+        else
+            EXPECT_EQ(DeserializeStruct<Endian::kLittle>(out, buff, size), size);
+        EXPECT_TRUE(out == p);
+    }
+}
+
+TEST(StructSerializer, NotEnoughSpace)
+{
+    Packet p = MakePacket();
+    uint8_t buff[64];
+
+    EXPECT_EQ(SerializeStruct(p, buff, StructSize<Packet>() - 1), 0u);
+
+    size_t size = SerializeStruct(p, buff, sizeof(buff));
+    Packet out = MakePacket();
+    out.seq = 0;
+    EXPECT_EQ(DeserializeStruct(out, buff, size - 1), 0u);
+    EXPECT_EQ(out.seq, 0);
+}
+
+TEST(StructSerializer, WithSerializer)
+{
+    Packet p = MakePacket();
+
+    std::vector<uint8_t> buff;
+    Serializer s(buff, Endian::kLittle);
+    s << uint8_t(0xee);
+    EXPECT_TRUE(AppendStruct(s, p));
+    s << uint8_t(0xff);
+    EXPECT_EQ(buff.size(), StructSize<Packet>() + 2);
+
+    //! 追加到 vector 末尾
+    std::vector<uint8_t> buff2 = { 0xee };
+    SerializeStruct<Endian::kLittle>(p, buff2);
+    buff2.push_back(0xff);
+    EXPECT_EQ(buff, buff2);
+
+    Deserializer d(buff.data(), buff.size(), Endian::kLittle);
+    uint8_t head = 0, tail = 0;
+    Packet out;
+    d >> head;
+    EXPECT_TRUE(FetchStruct(d, out));
+    d >> tail;
+    EXPECT_EQ(head, 0xee);
+    EXPECT_EQ(tail, 0xff);
+    EXPECT_TRUE(out == p);
+    EXPECT_FALSE(FetchStruct(d, out));
+
+    uint8_t small[4];
+    Serializer s2(small, sizeof(small));
+    EXPECT_FALSE(AppendStruct(s2, p));
+}
+
+namespace {
+
+struct Frame {
+    uint32_t seq;
+    uint16_t flags;
+    int16_t  samples[256];
+
+    template <typename Archive>
+    void schema(Archive &ar) { ar(seq, flags, samples); }
+};
+
+}
+
+//! 比较逐个字段写入 vector 与整体写入
+TEST(StructSerializer, BenchmarkCompareSerializer)
+{
+    const int kTimes = 100000;
+
+    Frame frame;
+    frame.seq = 1;
+    frame.flags = 2;
+    for (int i = 0; i < 256; ++i)
+        frame.samples[i] = i * 3;
+
+    std::vector<uint8_t> expect;
+    size_t checksum = 0;
+
+    for (auto endian : { Endian::kBig, Endian::kLittle }) {
+        const char *endian_name = endian == Endian::kBig ? "big" : "little";
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < kTimes; ++i) {
+                std::vector<uint8_t> buff;
+                Serializer s(buff, endian);
+                s << frame.seq << frame.flags;
+                for (auto v : frame.samples)
+                    s << v;
+                checksum += buff[i & 0xff];
+                expect.swap(buff);
+            }
+            auto cost = std::chrono::steady_clock::now() - start;
+            std::cout << "field by field, " << endian_name << ", cost: "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(cost).count() << " us" << std::endl;
+        }
+        {
+            std::vector<uint8_t> buff;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < kTimes; ++i) {
+                buff.clear();
+                if (endian == Endian::kBig)
+                    SerializeStruct<Endian::kBig>(frame, buff);
+                else
+                    SerializeStruct<Endian::kLittle>(frame, buff);
+                checksum += buff[i & 0xff];
+            }
+            auto cost = std::chrono::steady_clock::now() - start;
+            std::cout << "whole struct, " << endian_name << ", cost: "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(cost).count() << " us" << std::endl;
+            EXPECT_EQ(buff, expect);
+        }
+    }
+    EXPECT_NE(checksum, 0u);
+}